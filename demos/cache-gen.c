@@ -0,0 +1,455 @@
+/* Pre-generates a `pl_cache` for a set of rendering configurations.
+ *
+ * This renders a dummy frame for every combination of the given options,
+ * source formats and target formats on a headless Vulkan device, using the
+ * regular `pl_renderer`, and saves all resulting shaders and pipelines to a
+ * cache file. Shipping this file and loading it with `pl_cache_load` (or
+ * `pl_cache_load_mmap`) avoids compiling these shaders on first use, as long
+ * as the GPU and driver match. Run with `--help` for a list of options.
+ *
+ * License: CC0 / Public Domain
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <libplacebo/cache.h>
+#include <libplacebo/options.h>
+#include <libplacebo/renderer.h>
+#include <libplacebo/vulkan.h>
+
+#define MAX_ITEMS 16
+
+struct list {
+    const char *items[MAX_ITEMS];
+    int num;
+};
+
+static struct config {
+    const char *output;
+    const char *device;
+    int width, height;
+    struct list opts, inputs, targets;
+    enum pl_log_level verbosity;
+} cfg = {
+    .width      = 1920,
+    .height     = 1080,
+    .verbosity  = PL_LOG_WARN,
+};
+
+// Output sizes to render at, relative to the source size. This covers
+// upscaling, unscaled and downscaled output, which all use different passes
+static const float scale_factors[] = { 2.0f, 1.0f, 0.5f };
+
+// Supported source formats, in terms of their planes
+static const struct src_fmt {
+    const char *name;
+    int num_planes;
+    struct {
+        const char *fmt;
+        int components;
+        int mapping[4];
+        bool subsampled;
+    } planes[3];
+    int color_depth; // if different from the sample depth
+} src_fmts[] = {
+    {"yuv420p", 3, {
+        {"r8", 1, {PL_CHANNEL_Y}},
+        {"r8", 1, {PL_CHANNEL_CB}, true},
+        {"r8", 1, {PL_CHANNEL_CR}, true},
+    }},
+    {"yuv420p10", 3, {
+        {"r16", 1, {PL_CHANNEL_Y}},
+        {"r16", 1, {PL_CHANNEL_CB}, true},
+        {"r16", 1, {PL_CHANNEL_CR}, true},
+    }, .color_depth = 10},
+    {"nv12", 2, {
+        {"r8", 1, {PL_CHANNEL_Y}},
+        {"rg8", 2, {PL_CHANNEL_CB, PL_CHANNEL_CR}, true},
+    }},
+    {"p010", 2, {
+        {"r16", 1, {PL_CHANNEL_Y}},
+        {"rg16", 2, {PL_CHANNEL_CB, PL_CHANNEL_CR}, true},
+    }},
+    {"rgba8", 1, {
+        {"rgba8", 4, {PL_CHANNEL_R, PL_CHANNEL_G, PL_CHANNEL_B, PL_CHANNEL_A}},
+    }},
+    {"rgba16", 1, {
+        {"rgba16", 4, {PL_CHANNEL_R, PL_CHANNEL_G, PL_CHANNEL_B, PL_CHANNEL_A}},
+    }},
+    {0}
+};
+
+static bool list_add(struct list *list, const char *item)
+{
+    if (list->num == MAX_ITEMS)
+        return false;
+    list->items[list->num++] = item;
+    return true;
+}
+
+// Splits "name[:color]" into its components. `name` is truncated in-place
+static bool parse_color(char *spec, struct pl_color_space *out)
+{
+    char *sep = strchr(spec, ':');
+    const char *color = sep ? sep + 1 : "sdr";
+    if (sep)
+        *sep = '\0';
+
+    if (!strcmp(color, "sdr")) {
+        *out = pl_color_space_bt709;
+    } else if (!strcmp(color, "srgb")) {
+        *out = pl_color_space_srgb;
+    } else if (!strcmp(color, "hdr10")) {
+        *out = pl_color_space_hdr10;
+    } else if (!strcmp(color, "hlg")) {
+        *out = pl_color_space_bt2020_hlg;
+    } else {
+        fprintf(stderr, "Unknown color space '%s'!\n", color);
+        return false;
+    }
+
+    return true;
+}
+
+static bool parse_args(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"verbose",     no_argument,        NULL, 'v'},
+        {"quiet",       no_argument,        NULL, 'q'},
+        {"output",      required_argument,  NULL, 'o'},
+        {"options",     required_argument,  NULL, 'p'},
+        {"input",       required_argument,  NULL, 'i'},
+        {"target",      required_argument,  NULL, 't'},
+        {"size",        required_argument,  NULL, 's'},
+        {"device",      required_argument,  NULL, 'd'},
+        {"help",        no_argument,        NULL, 'h'},
+        {0}
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "vqo:p:i:t:s:d:h", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'v':
+                if (cfg.verbosity < PL_LOG_TRACE)
+                    cfg.verbosity++;
+                break;
+            case 'q':
+                if (cfg.verbosity > PL_LOG_NONE)
+                    cfg.verbosity--;
+                break;
+            case 'o':
+                cfg.output = optarg;
+                break;
+            case 'p':
+            case 'i':
+            case 't': {
+                struct list *list = option == 'p' ? &cfg.opts :
+                                    option == 'i' ? &cfg.inputs : &cfg.targets;
+                if (!list_add(list, optarg)) {
+                    fprintf(stderr, "Too many values for -%c!\n", option);
+                    goto error;
+                }
+                break;
+            }
+            case 's':
+                if (sscanf(optarg, "%dx%d", &cfg.width, &cfg.height) != 2 ||
+                    cfg.width <= 0 || cfg.height <= 0)
+                {
+                    fprintf(stderr, "Invalid value for -s/--size: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'd':
+                cfg.device = optarg;
+                break;
+            case 'h':
+            case '?':
+            default:
+                goto error;
+        }
+    }
+
+    if (!cfg.output || optind != argc) {
+        fprintf(stderr, "Missing output file!\n");
+        goto error;
+    }
+
+    if (!cfg.opts.num)
+        list_add(&cfg.opts, "preset=default");
+    if (!cfg.inputs.num) {
+        list_add(&cfg.inputs, "yuv420p");
+        list_add(&cfg.inputs, "yuv420p10:hdr10");
+    }
+    if (!cfg.targets.num)
+        list_add(&cfg.targets, "rgba8");
+    return true;
+
+error:
+    fprintf(stderr, "Usage: %s [options] -o output.cache\n\n", argv[0]);
+    fprintf(stderr, "Renders all combinations of the given options, inputs and\n"
+                    "targets, and saves the resulting shader cache. Existing\n"
+                    "contents of the output file are preserved.\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -v, --verbose            Increase verbosity\n");
+    fprintf(stderr, "  -q, --quiet              Decrease verbosity\n");
+    fprintf(stderr, "  -o, --output FILE        Cache file to write\n");
+    fprintf(stderr, "  -p, --options STR        pl_options string (default: preset=default)\n");
+    fprintf(stderr, "  -i, --input FMT[:CSP]    Source format (default: yuv420p, yuv420p10:hdr10)\n");
+    fprintf(stderr, "  -t, --target FMT[:CSP]   Target format (default: rgba8)\n");
+    fprintf(stderr, "  -s, --size WxH           Source size (default: 1920x1080)\n");
+    fprintf(stderr, "  -d, --device NAME        Vulkan device (default: auto)\n");
+    fprintf(stderr, "\nThe -p, -i and -t options may be given multiple times. Known\n"
+                    "source formats are:");
+    for (const struct src_fmt *f = src_fmts; f->name; f++)
+        fprintf(stderr, " %s", f->name);
+    fprintf(stderr, "\nTarget formats are named `pl_fmt`s, e.g. rgba8, rgb10a2 or\n"
+                    "rgba16hf. Known color spaces are: sdr, srgb, hdr10, hlg\n");
+    return false;
+}
+
+static const struct src_fmt *find_src_fmt(const char *name)
+{
+    for (const struct src_fmt *f = src_fmts; f->name; f++) {
+        if (!strcmp(f->name, name))
+            return f;
+    }
+
+    fprintf(stderr, "Unknown source format '%s'!\n", name);
+    return NULL;
+}
+
+// Creates the textures for the given source format, returning the number of
+// planes created, or 0 on failure
+static int create_source(pl_gpu gpu, const struct src_fmt *fmt,
+                         const struct pl_color_space *csp,
+                         pl_tex tex[], struct pl_frame *frame)
+{
+    bool rgb = fmt->planes[0].mapping[0] == PL_CHANNEL_R &&
+               fmt->planes[0].components > 1;
+
+    *frame = (struct pl_frame) {
+        .num_planes = fmt->num_planes,
+        .color      = *csp,
+        .repr       = rgb ? pl_color_repr_rgb :
+                      pl_color_primaries_is_wide_gamut(csp->primaries)
+                            ? pl_color_repr_uhdtv : pl_color_repr_hdtv,
+    };
+
+    for (int i = 0; i < fmt->num_planes; i++) {
+        pl_fmt pfmt = pl_find_named_fmt(gpu, fmt->planes[i].fmt);
+        if (!pfmt || !(pfmt->caps & PL_FMT_CAP_SAMPLEABLE)) {
+            fprintf(stderr, "Format '%s' is not supported!\n", fmt->planes[i].fmt);
+            goto error;
+        }
+
+        int sub = fmt->planes[i].subsampled;
+        tex[i] = pl_tex_create(gpu, pl_tex_params(
+            .w          = (cfg.width + sub) >> sub,
+            .h          = (cfg.height + sub) >> sub,
+            .format     = pfmt,
+            .sampleable = true,
+        ));
+        if (!tex[i])
+            goto error;
+
+        struct pl_plane *plane = &frame->planes[i];
+        plane->texture = tex[i];
+        plane->components = fmt->planes[i].components;
+        memcpy(plane->component_mapping, fmt->planes[i].mapping,
+               sizeof(plane->component_mapping));
+        if (fmt->color_depth) {
+            frame->repr.bits = (struct pl_bit_encoding) {
+                .sample_depth = pfmt->component_depth[0],
+                .color_depth  = fmt->color_depth,
+            };
+        }
+    }
+
+    if (!rgb)
+        pl_frame_set_chroma_location(frame, PL_CHROMA_LEFT);
+    return fmt->num_planes;
+
+error:
+    for (int i = 0; i < fmt->num_planes; i++)
+        pl_tex_destroy(gpu, &tex[i]);
+    return 0;
+}
+
+// Creates a target texture in the given format, mirroring the capabilities a
+// swapchain image of that format would typically have
+static pl_tex create_target(pl_gpu gpu, const char *name, int w, int h)
+{
+    pl_fmt fmt = pl_find_named_fmt(gpu, name);
+    if (!fmt || !(fmt->caps & PL_FMT_CAP_RENDERABLE)) {
+        fprintf(stderr, "Format '%s' is not renderable!\n", name);
+        return NULL;
+    }
+
+    return pl_tex_create(gpu, pl_tex_params(
+        .w          = w,
+        .h          = h,
+        .format     = fmt,
+        .renderable = true,
+        .storable   = fmt->caps & PL_FMT_CAP_STORABLE,
+        .blit_dst   = fmt->caps & PL_FMT_CAP_BLITTABLE,
+    ));
+}
+
+// Renders a single source format to all targets, returning the number of
+// configurations rendered, or -1 on failure
+static int render_input(pl_renderer rr, pl_gpu gpu,
+                        const struct pl_render_params *params,
+                        const char *input_spec)
+{
+    char input[64];
+    snprintf(input, sizeof(input), "%s", input_spec);
+    struct pl_color_space src_csp;
+    if (!parse_color(input, &src_csp))
+        return -1;
+    const struct src_fmt *fmt = find_src_fmt(input);
+    if (!fmt)
+        return -1;
+
+    pl_tex src_tex[3] = {0};
+    struct pl_frame image;
+    if (!create_source(gpu, fmt, &src_csp, src_tex, &image))
+        return -1;
+
+    int count = 0;
+    for (int t = 0; count >= 0 && t < cfg.targets.num; t++) {
+        char target_fmt[64];
+        snprintf(target_fmt, sizeof(target_fmt), "%s", cfg.targets.items[t]);
+        struct pl_color_space dst_csp;
+        if (!parse_color(target_fmt, &dst_csp)) {
+            count = -1;
+            break;
+        }
+
+        for (int s = 0; s < sizeof(scale_factors) / sizeof(scale_factors[0]); s++) {
+            const float scale = scale_factors[s];
+            pl_tex dst_tex = create_target(gpu, target_fmt, cfg.width * scale,
+                                           cfg.height * scale);
+            if (!dst_tex) {
+                count = -1;
+                break;
+            }
+
+            struct pl_frame target;
+            pl_frame_from_swapchain(&target, &(struct pl_swapchain_frame) {
+                .fbo         = dst_tex,
+                .color_repr  = pl_color_repr_rgb,
+                .color_space = dst_csp,
+            });
+
+            // Render twice, since some passes (e.g. for peak detection) are
+            // only used once state from previous frames is available
+            pl_renderer_flush_cache(rr);
+            bool ok = true;
+            for (int n = 0; n < 2; n++)
+                ok &= pl_render_image(rr, &image, &target, params);
+            pl_tex_destroy(gpu, &dst_tex);
+            if (!ok) {
+                fprintf(stderr, "Failed rendering %s -> %s!\n", input_spec,
+                        cfg.targets.items[t]);
+                count = -1;
+                break;
+            }
+            count++;
+        }
+    }
+
+    for (int i = 0; i < fmt->num_planes; i++)
+        pl_tex_destroy(gpu, &src_tex[i]);
+    return count;
+}
+
+static bool generate(pl_log log, pl_gpu gpu)
+{
+    pl_renderer rr = pl_renderer_create(log, gpu);
+    pl_options opts = pl_options_alloc(log);
+    bool ok = true;
+    int count = 0;
+
+    for (int o = 0; ok && o < cfg.opts.num; o++) {
+        pl_options_reset(opts, NULL);
+        if (!pl_options_load(opts, cfg.opts.items[o])) {
+            fprintf(stderr, "Failed parsing options '%s'!\n", cfg.opts.items[o]);
+            ok = false;
+            break;
+        }
+
+        for (int i = 0; ok && i < cfg.inputs.num; i++) {
+            int num = render_input(rr, gpu, &opts->params, cfg.inputs.items[i]);
+            ok = num >= 0;
+            count += num;
+        }
+    }
+
+    pl_gpu_finish(gpu);
+    if (ok)
+        printf("Rendered %d configurations\n", count);
+    pl_options_free(&opts);
+    pl_renderer_destroy(&rr);
+    return ok;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!parse_args(argc, argv))
+        exit(1);
+
+    pl_log log = pl_log_create(PL_API_VER, pl_log_params(
+        .log_cb    = pl_log_color,
+        .log_level = cfg.verbosity,
+    ));
+
+    pl_cache cache = pl_cache_create(pl_cache_params(
+        .log            = log,
+        .max_total_size = SIZE_MAX,
+    ));
+
+    FILE *fp = fopen(cfg.output, "rb");
+    if (fp) {
+        int num = pl_cache_load_file(cache, fp);
+        fclose(fp);
+        if (num < 0) {
+            fprintf(stderr, "Failed loading existing cache file '%s'!\n", cfg.output);
+            exit(1);
+        }
+        printf("Loaded %d existing cache objects\n", num);
+    }
+
+    pl_vulkan vk = pl_vulkan_create(log, pl_vulkan_params(
+        .device_name = cfg.device,
+    ));
+    if (!vk) {
+        fprintf(stderr, "Failed creating Vulkan device!\n");
+        exit(1);
+    }
+
+    pl_gpu_set_cache(vk->gpu, cache);
+    int ret = 0;
+    if (!generate(log, vk->gpu))
+        ret = 1;
+    pl_vulkan_destroy(&vk);
+
+    if (!ret) {
+        fp = fopen(cfg.output, "wb");
+        if (!fp) {
+            fprintf(stderr, "Failed opening '%s' for writing!\n", cfg.output);
+            ret = 1;
+        } else {
+            int num = pl_cache_save_file(cache, fp);
+            ret = fclose(fp) ? 1 : 0;
+            printf("Saved %d cache objects (%zu bytes) to '%s'\n", num,
+                   pl_cache_size(cache), cfg.output);
+        }
+    }
+
+    pl_cache_destroy(&cache);
+    pl_log_destroy(&log);
+    return ret;
+}
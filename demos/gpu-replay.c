@@ -0,0 +1,187 @@
+/* Replays a dummy GPU capture stream onto a real Vulkan device.
+ *
+ * Capture streams are produced by a dummy GPU created with
+ * `pl_gpu_dummy_params.capture` set, and contain every transfer and pass
+ * execution performed on it. Replaying them isolates the cost of the backend
+ * and driver from the renderer that generated the commands. Run with
+ * `--help` for a list of options.
+ *
+ * License: CC0 / Public Domain
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+#include <libplacebo/dummy.h>
+#include <libplacebo/vulkan.h>
+
+#include "pl_clock.h"
+
+static struct config {
+    int loops;
+    int runs;
+    const char *device;
+    enum pl_log_level verbosity;
+} cfg = {
+    .loops      = 100,
+    .runs       = 5,
+    .verbosity  = PL_LOG_WARN,
+};
+
+static bool parse_int(const char *str, int min, int *out)
+{
+    char *end;
+    long val = strtol(str, &end, 10);
+    if (end == str || *end || val < min || val > INT32_MAX)
+        return false;
+    *out = val;
+    return true;
+}
+
+static void *read_file(const char *path, size_t *size)
+{
+    FILE *fp = fopen(path, "rb");
+    if (!fp)
+        return NULL;
+
+    void *data = NULL;
+    if (fseek(fp, 0, SEEK_END) != 0)
+        goto done;
+    long len = ftell(fp);
+    if (len <= 0 || fseek(fp, 0, SEEK_SET) != 0)
+        goto done;
+    data = malloc(len);
+    if (data && fread(data, 1, len, fp) != (size_t) len) {
+        free(data);
+        data = NULL;
+    }
+    *size = len;
+
+done:
+    fclose(fp);
+    return data;
+}
+
+static const char *parse_args(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"verbose",     no_argument,        NULL, 'v'},
+        {"quiet",       no_argument,        NULL, 'q'},
+        {"loops",       required_argument,  NULL, 'n'},
+        {"runs",        required_argument,  NULL, 'r'},
+        {"device",      required_argument,  NULL, 'd'},
+        {"help",        no_argument,        NULL, 'h'},
+        {0}
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "vqn:r:d:h", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'v':
+                if (cfg.verbosity < PL_LOG_TRACE)
+                    cfg.verbosity++;
+                break;
+            case 'q':
+                if (cfg.verbosity > PL_LOG_NONE)
+                    cfg.verbosity--;
+                break;
+            case 'n':
+                if (!parse_int(optarg, 1, &cfg.loops)) {
+                    fprintf(stderr, "Invalid value for -n/--loops: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'r':
+                if (!parse_int(optarg, 1, &cfg.runs)) {
+                    fprintf(stderr, "Invalid value for -r/--runs: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'd':
+                cfg.device = optarg;
+                break;
+            case 'h':
+            case '?':
+            default:
+                goto error;
+        }
+    }
+
+    if (argc - optind != 1) {
+        fprintf(stderr, "Missing capture file!\n");
+        goto error;
+    }
+
+    return argv[optind];
+
+error:
+    fprintf(stderr, "Usage: %s [options] capture.bin\n\n", argv[0]);
+    fprintf(stderr, "Replays a dummy GPU capture stream onto a Vulkan device\n"
+                    "and reports the time spent per iteration.\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -v, --verbose            Increase verbosity\n");
+    fprintf(stderr, "  -q, --quiet              Decrease verbosity\n");
+    fprintf(stderr, "  -n, --loops N            Iterations per run (default: 100)\n");
+    fprintf(stderr, "  -r, --runs N             Number of timed runs (default: 5)\n");
+    fprintf(stderr, "  -d, --device NAME        Vulkan device (default: auto)\n");
+    return NULL;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *path = parse_args(argc, argv);
+    if (!path)
+        exit(1);
+
+    size_t size = 0;
+    void *data = read_file(path, &size);
+    if (!data) {
+        fprintf(stderr, "Failed reading capture file '%s'!\n", path);
+        exit(1);
+    }
+
+    pl_log log = pl_log_create(PL_API_VER, pl_log_params(
+        .log_cb    = pl_log_color,
+        .log_level = cfg.verbosity,
+    ));
+
+    pl_vulkan vk = pl_vulkan_create(log, pl_vulkan_params(
+        .device_name = cfg.device,
+    ));
+    if (!vk) {
+        fprintf(stderr, "Failed creating Vulkan device!\n");
+        exit(1);
+    }
+
+    // The first run includes object creation and pipeline compilation, and
+    // is only reported for reference
+    int ret = 0;
+    double best = 0.0;
+    for (int i = 0; i <= cfg.runs; i++) {
+        int loops = i ? cfg.loops : 1;
+        pl_clock_t start = pl_clock_now();
+        if (!pl_gpu_dummy_replay(vk->gpu, data, size, loops)) {
+            fprintf(stderr, "Failed replaying capture file '%s'!\n", path);
+            ret = 1;
+            break;
+        }
+        pl_gpu_finish(vk->gpu);
+        double ms = 1e3 * pl_clock_diff(pl_clock_now(), start) / loops;
+        if (!i) {
+            printf("warmup: %8.3f ms\n", ms);
+        } else {
+            printf("run %2d: %8.3f ms/iter\n", i, ms);
+            if (!best || ms < best)
+                best = ms;
+        }
+    }
+
+    if (!ret)
+        printf("best:   %8.3f ms/iter\n", best);
+
+    pl_vulkan_destroy(&vk);
+    pl_log_destroy(&log);
+    free(data);
+    return ret;
+}
@@ -1,9 +1,14 @@
-/* GPU->GPU transfer benchmarks. Requires some manual setup.
+/* GPU->GPU transfer benchmarks.
+ *
+ * Measures the throughput and latency of texture transfers between one or
+ * more Vulkan devices, either by way of host memory or through shared
+ * (exported) buffers. Run with `--help` for a list of options.
  *
  * License: CC0 / Public Domain
  */
 
 #include <assert.h>
+#include <getopt.h>
 #include <stddef.h>
 #include <stdlib.h>
 #include <stdio.h>
@@ -18,29 +23,43 @@
 #define ALIGN2(x, align) (((x) + (align) - 1) & ~((align) - 1))
 
 enum {
-    // Image configuration
-    NUM_TEX = 16,
-    WIDTH   = 1920,
-    HEIGHT  = 1080,
-    DEPTH   = 16,
-    COMPS   = 1,
-
-    // Queue configuration
-    NUM_QUEUES = NUM_TEX,
-    ASYNC_TX   = 1,
-    ASYNC_COMP = 1,
-
     // Buffer configuration
-    PTR_ALIGN    = 4096,
-    PIXEL_PITCH  = DEPTH / 8,
-    ROW_PITCH    = ALIGN2(WIDTH * PIXEL_PITCH, 256),
-    IMAGE_SIZE   = ROW_PITCH * HEIGHT,
-    BUFFER_SIZE  = IMAGE_SIZE + PTR_ALIGN - 1,
+    PTR_ALIGN   = 4096,
+    PITCH_ALIGN = 256,
 
     // Test configuration
-    TEST_MS    = 1500,
-    WARMUP_MS  = 500,
-    POLL_FREQ  = 10,
+    POLL_FREQ   = 10,
+    MAX_DEVICES = 8,
+};
+
+static struct config {
+    int width, height;
+    const char *format;
+    int num_tex;
+    int num_queues;
+    bool async_tx;
+    bool async_comp;
+    int test_ms;
+    int warmup_ms;
+    bool json;
+    enum pl_log_level verbosity;
+} cfg = {
+    .width      = 1920,
+    .height     = 1080,
+    .format     = "r16",
+    .num_tex    = 16,
+    .async_tx   = true,
+    .async_comp = true,
+    .test_ms    = 1500,
+    .warmup_ms  = 500,
+    .verbosity  = PL_LOG_WARN,
+};
+
+// Derived from `cfg` and the chosen format
+struct layout {
+    size_t row_pitch;
+    size_t image_size;
+    size_t buffer_size;
 };
 
 static uint8_t* page_align(uint8_t *data)
@@ -68,27 +87,71 @@ struct buffers {
     pl_buf exported[NUM_MEM_TYPES];
     pl_buf imported[NUM_MEM_TYPES];
     struct pl_tex_transfer_params async;
+
+    // Latency tracking, only used for destination textures
+    pl_clock_t start;
+    bool pending;   // frame is in flight
+    bool submitted; // upload to this texture was issued
 };
 
-static struct buffers *alloc_buffers(pl_gpu gpu)
+static const char *handle_name(enum pl_handle_type handle)
+{
+    switch (handle) {
+    case PL_HANDLE_FD:          return "fd";
+    case PL_HANDLE_WIN32:       return "win32";
+    case PL_HANDLE_WIN32_KMT:   return "win32kmt";
+    case PL_HANDLE_DMA_BUF:     return "dmabuf";
+    default:                    return "none";
+    }
+}
+
+// Picks the handle type used to share buffers from `exporter` to `importer`.
+// Opaque handles can only be shared between instances of the same physical
+// device, while dma_bufs are the only way of doing true peer-to-peer copies.
+static enum pl_handle_type pick_handle(pl_gpu exporter, pl_gpu importer)
+{
+    enum pl_handle_type caps = exporter->export_caps.buf &
+                               importer->import_caps.buf;
+
+    if (caps & PL_HANDLE_DMA_BUF)
+        return PL_HANDLE_DMA_BUF;
+    if (memcmp(exporter->uuid, importer->uuid, sizeof(exporter->uuid)))
+        return 0;
+
+    static const enum pl_handle_type opaque[] = {
+        PL_HANDLE_FD,
+        PL_HANDLE_WIN32,
+        PL_HANDLE_WIN32_KMT,
+    };
+
+    for (int i = 0; i < sizeof(opaque) / sizeof(opaque[0]); i++) {
+        if (caps & opaque[i])
+            return opaque[i];
+    }
+
+    return 0;
+}
+
+static struct buffers *alloc_buffers(pl_gpu gpu, const struct layout *layout,
+                                     enum pl_handle_type export)
 {
     struct buffers *buffers = malloc(sizeof(*buffers));
     *buffers = (struct buffers) { .gpu = gpu };
 
     for (enum mem_type type = 0; type < NUM_MEM_TYPES; type++) {
         buffers->buf[type] = pl_buf_create(gpu, pl_buf_params(
-            .size          = BUFFER_SIZE,
+            .size          = layout->buffer_size,
             .memory_type   = type == RAM ? PL_BUF_MEM_HOST : PL_BUF_MEM_DEVICE,
             .host_mapped   = true,
         ));
         if (!buffers->buf[type])
             exit(2);
 
-        if (gpu->export_caps.buf & PL_HANDLE_DMA_BUF) {
+        if (export) {
             buffers->exported[type] = pl_buf_create(gpu, pl_buf_params(
-                .size          = BUFFER_SIZE,
+                .size          = layout->buffer_size,
                 .memory_type   = type == RAM ? PL_BUF_MEM_HOST : PL_BUF_MEM_DEVICE,
-                .export_handle = PL_HANDLE_DMA_BUF,
+                .export_handle = export,
             ));
         }
     }
@@ -109,17 +172,15 @@ static void free_buffers(struct buffers *buffers)
 static void link_buffers(pl_gpu gpu, struct buffers *buffers,
                          const struct buffers *import)
 {
-    if (!(gpu->import_caps.buf & PL_HANDLE_DMA_BUF))
-        return;
-
     for (enum mem_type type = 0; type < NUM_MEM_TYPES; type++) {
-        if (!import->exported[type])
+        pl_buf exported = import->exported[type];
+        if (!exported)
             continue;
         buffers->imported[type] = pl_buf_create(gpu, pl_buf_params(
-            .size          = BUFFER_SIZE,
+            .size          = exported->params.size,
             .memory_type   = type == RAM ? PL_BUF_MEM_HOST : PL_BUF_MEM_DEVICE,
-            .import_handle = PL_HANDLE_DMA_BUF,
-            .shared_mem    = import->exported[type]->shared_mem,
+            .import_handle = exported->params.export_handle,
+            .shared_mem    = exported->shared_mem,
         ));
     }
 }
@@ -127,6 +188,8 @@ static void link_buffers(pl_gpu gpu, struct buffers *buffers,
 struct ctx {
     pl_gpu srcgpu, dstgpu;
     pl_tex src, dst;
+    const struct layout *layout;
+    uint8_t *host_mem; // for owner == CPU
 
     // for copy-based methods
     enum mem_owner  owner;
@@ -145,6 +208,7 @@ static void async_upload(void *priv)
 {
     struct buffers *buffers = priv;
     pl_tex_upload(buffers->gpu, &buffers->async);
+    buffers->submitted = true;
 }
 
 static inline void copy_ptr(struct ctx ctx)
@@ -157,8 +221,7 @@ static inline void copy_ptr(struct ctx ctx)
     uint8_t *data = NULL;
 
     if (ctx.owner == CPU) {
-        static uint8_t static_buffer[BUFFER_SIZE];
-        data = page_align(static_buffer);
+        data = page_align(ctx.host_mem);
     } else {
         struct buffers *b = ctx.owner == SRC ? srcbuffers : dstbuffers;
         buf = b->buf[ctx.type];
@@ -168,7 +231,7 @@ static inline void copy_ptr(struct ctx ctx)
 
     struct pl_tex_transfer_params src_params = {
         .tex       = src,
-        .row_pitch = ROW_PITCH,
+        .row_pitch = ctx.layout->row_pitch,
         .no_import = ctx.noimport,
     };
 
@@ -181,7 +244,7 @@ static inline void copy_ptr(struct ctx ctx)
 
     struct pl_tex_transfer_params dst_params = {
         .tex       = dst,
-        .row_pitch = ROW_PITCH,
+        .row_pitch = ctx.layout->row_pitch,
         .no_import = ctx.noimport,
     };
 
@@ -200,6 +263,7 @@ static inline void copy_ptr(struct ctx ctx)
     } else {
         pl_tex_download(srcgpu, &src_params);
         pl_tex_upload(dstgpu, &dst_params);
+        dstbuffers->submitted = true;
     }
 }
 
@@ -212,12 +276,12 @@ static inline void copy_interop(struct ctx ctx)
 
     struct pl_tex_transfer_params src_params = {
         .tex       = src,
-        .row_pitch = ROW_PITCH,
+        .row_pitch = ctx.layout->row_pitch,
     };
 
     struct pl_tex_transfer_params dst_params = {
         .tex       = dst,
-        .row_pitch = ROW_PITCH,
+        .row_pitch = ctx.layout->row_pitch,
     };
 
     if (ctx.owner == SRC) {
@@ -238,23 +302,107 @@ static inline void copy_interop(struct ctx ctx)
         pl_tex_download(srcgpu, &src_params);
         await_buf(srcgpu, src_params.buf); // manual cross-GPU synchronization
         pl_tex_upload(dstgpu, &dst_params);
+        dstbuffers->submitted = true;
     }
 }
 
 typedef void method(struct ctx ctx);
 
-static double bench(struct ctx ctx, pl_tex srcs[], pl_tex dsts[], method fun)
+struct result {
+    double avg;         // average time per frame (seconds)
+    uint64_t frames;    // number of frames measured
+    double *latency;    // per-frame latencies (seconds), sorted
+    int num_latency;
+    int size_latency;
+};
+
+static void add_latency(struct result *res, double latency)
+{
+    if (res->num_latency == res->size_latency) {
+        res->size_latency = res->size_latency ? res->size_latency * 2 : 1024;
+        res->latency = realloc(res->latency, res->size_latency * sizeof(double));
+        if (!res->latency)
+            exit(2);
+    }
+
+    res->latency[res->num_latency++] = latency;
+}
+
+static int cmp_double(const void *pa, const void *pb)
+{
+    double a = *(const double *) pa, b = *(const double *) pb;
+    return (a > b) - (a < b);
+}
+
+// Nearest-rank percentile, `latency` must be sorted
+static double percentile(const struct result *res, double p)
+{
+    if (!res->num_latency)
+        return 0.0;
+    int idx = ceil(p / 100.0 * res->num_latency) - 1;
+    idx = idx < 0 ? 0 : idx;
+    return res->latency[idx];
+}
+
+// Checks whether the frame last submitted to `dst` has completed, and if so,
+// records its end-to-end latency (from source clear to destination upload
+// completion). If `block` is true, waits for the frame to complete.
+static void retire_frame(struct ctx ctx, pl_tex src, pl_tex dst, bool block,
+                         struct result *res)
+{
+    struct buffers *buffers = dst->params.user_data;
+    const uint64_t timeout = block ? UINT64_MAX : 0;
+    if (!buffers->pending)
+        return;
+
+    // Asynchronous uploads are only issued from the download callback, so
+    // keep polling the source until it fires
+    while (!buffers->submitted) {
+        bool busy = pl_tex_poll(ctx.srcgpu, src, timeout);
+        if (buffers->submitted)
+            break;
+        if (!block)
+            return;
+        if (!busy) {
+            // Callback may be pending on some internal staging buffer
+            pl_gpu_finish(ctx.srcgpu);
+            break;
+        }
+    }
+
+    while (pl_tex_poll(ctx.dstgpu, dst, timeout)) {
+        if (!block)
+            return;
+    }
+
+    add_latency(res, pl_clock_diff(pl_clock_now(), buffers->start));
+    buffers->pending = false;
+}
+
+static struct result bench(struct ctx ctx, pl_tex srcs[], pl_tex dsts[],
+                           method fun)
 {
     const pl_gpu srcgpu = ctx.srcgpu, dstgpu = ctx.dstgpu;
     pl_clock_t start_warmup = 0, start_test = 0;
     uint64_t frames = 0, frames_warmup = 0;
+    struct result res = {0};
 
     start_warmup = pl_clock_now();
     do {
-        const int idx = frames % NUM_TEX;
+        const int idx = frames % cfg.num_tex;
         ctx.src = srcs[idx];
         ctx.dst = dsts[idx];
 
+        struct buffers *dstbuffers = ctx.dst->params.user_data;
+        if (fun) {
+            // Poll for completed frames, and wait for this slot to free up
+            for (int i = 0; i < cfg.num_tex; i++)
+                retire_frame(ctx, srcs[i], dsts[i], i == idx, &res);
+            dstbuffers->start = pl_clock_now();
+            dstbuffers->pending = true;
+            dstbuffers->submitted = false;
+        }
+
         // Generate some quasi-unique data in the source
         float x = M_E * (frames / 100.0);
         pl_tex_clear(srcgpu, ctx.src, (float[4]) {
@@ -274,11 +422,12 @@ static double bench(struct ctx ctx, pl_tex srcs[], pl_tex dsts[], method fun)
         if (frames % POLL_FREQ == 0) {
             pl_clock_t now = pl_clock_now();
             if (start_test) {
-                if (pl_clock_diff(now, start_test) > TEST_MS * 1e-3)
+                if (pl_clock_diff(now, start_test) > cfg.test_ms * 1e-3)
                     break;
-            } else if (pl_clock_diff(now, start_warmup) > WARMUP_MS * 1e-3) {
+            } else if (pl_clock_diff(now, start_warmup) > cfg.warmup_ms * 1e-3) {
                 start_test = now;
                 frames_warmup = frames;
+                res.num_latency = 0; // discard warmup latencies
             }
         }
     } while (true);
@@ -286,29 +435,129 @@ static double bench(struct ctx ctx, pl_tex srcs[], pl_tex dsts[], method fun)
     pl_gpu_finish(srcgpu);
     pl_gpu_finish(dstgpu);
 
-    return pl_clock_diff(pl_clock_now(), start_test) / (frames - frames_warmup);
+    res.frames = frames - frames_warmup;
+    res.avg = pl_clock_diff(pl_clock_now(), start_test) / res.frames;
+
+    // Frames still in flight completed at an unknown point during the
+    // flush, so don't count their latency
+    for (int i = 0; i < cfg.num_tex; i++) {
+        struct buffers *buffers = dsts[i]->params.user_data;
+        buffers->pending = false;
+    }
+
+    qsort(res.latency, res.num_latency, sizeof(double), cmp_double);
+    return res;
 }
 
-static void run_tests(pl_gpu srcgpu, pl_gpu dstgpu)
+static int num_results;
+
+static void json_str(const char *str)
 {
+    putchar('"');
+    for (; *str; str++) {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\') {
+            printf("\\%c", c);
+        } else if (c < 0x20) {
+            printf("\\u%04x", c);
+        } else {
+            putchar(c);
+        }
+    }
+    putchar('"');
+}
+
+static void print_result(const char *srcname, const char *dstname,
+                         const char *owner, const char *type,
+                         const char *path, bool async,
+                         const struct ctx *ctx, double baseline,
+                         struct result *res)
+{
+    double dur = res->avg - baseline;
+    double rate = ctx->layout->image_size / dur / 1e6;
+
+    if (!cfg.json) {
+        printf("  %s %s %-8s %s : avg %.0f μs\t%.3f fps\t%.0f MB/s\t"
+               "latency p50 %.0f μs, p99 %.0f μs\n",
+               owner, type, path, async ? "async" : "     ",
+               1e6 * dur, 1.0 / dur, rate,
+               1e6 * percentile(res, 50), 1e6 * percentile(res, 99));
+        goto done;
+    }
+
+    printf("%s\n    {\"src\": ", num_results ? "," : "");
+    json_str(srcname);
+    printf(", \"dst\": ");
+    json_str(dstname);
+    printf(", \"owner\": \"%s\", \"memory\": \"%s\", \"path\": \"%s\", "
+           "\"async\": %s,\n", owner, type, path, async ? "true" : "false");
+    printf("     \"frames\": %llu, \"baseline_us\": %.3f, \"avg_us\": %.3f, "
+           "\"fps\": %.3f, \"mb_per_s\": %.3f,\n",
+           (unsigned long long) res->frames, 1e6 * baseline, 1e6 * dur,
+           1.0 / dur, rate);
+    printf("     \"latency_us\": {\"samples\": %d, \"min\": %.3f, "
+           "\"p50\": %.3f, \"p90\": %.3f, \"p99\": %.3f, \"max\": %.3f}}",
+           res->num_latency, 1e6 * percentile(res, 0),
+           1e6 * percentile(res, 50), 1e6 * percentile(res, 90),
+           1e6 * percentile(res, 99), 1e6 * percentile(res, 100));
+    fflush(stdout);
+
+done:
+    num_results++;
+    free(res->latency);
+    *res = (struct result) {0};
+}
+
+static void run_tests(pl_vulkan srcdev, const char *srcname,
+                      pl_vulkan dstdev, const char *dstname)
+{
+    const pl_gpu srcgpu = srcdev->gpu, dstgpu = dstdev->gpu;
+    pl_fmt srcfmt = pl_find_named_fmt(srcgpu, cfg.format);
+    pl_fmt dstfmt = pl_find_named_fmt(dstgpu, cfg.format);
     const enum pl_fmt_caps caps = PL_FMT_CAP_HOST_READABLE;
-    pl_fmt srcfmt = pl_find_fmt(srcgpu, PL_FMT_UNORM, COMPS, DEPTH, DEPTH, caps);
-    pl_fmt dstfmt = pl_find_fmt(dstgpu, PL_FMT_UNORM, COMPS, DEPTH, DEPTH, caps);
-    if (!srcfmt || !dstfmt)
+    if (!srcfmt || !dstfmt || (srcfmt->caps & caps) != caps) {
+        fprintf(stderr, "Format '%s' is not supported for transfers!\n",
+                cfg.format);
         exit(2);
+    }
 
-    pl_tex src[NUM_TEX], dst[NUM_TEX];
-    for (int i = 0; i < NUM_TEX; i++) {
-        struct buffers *srcbuffers = alloc_buffers(srcgpu);
-        struct buffers *dstbuffers = alloc_buffers(dstgpu);
-        if (!memcmp(srcgpu->uuid, dstgpu->uuid, sizeof(srcgpu->uuid))) {
-            link_buffers(srcgpu, srcbuffers, dstbuffers);
-            link_buffers(dstgpu, dstbuffers, srcbuffers);
+    assert(srcfmt->texel_size == dstfmt->texel_size);
+    struct layout layout = {
+        .row_pitch = ALIGN2(cfg.width * srcfmt->texel_size, PITCH_ALIGN),
+    };
+    layout.image_size  = layout.row_pitch * cfg.height;
+    layout.buffer_size = layout.image_size + PTR_ALIGN - 1;
+
+    const pl_gpu gpus[] = { srcgpu, dstgpu };
+    const char *names[] = { srcname, dstname };
+    for (int i = 0; i < 2; i++) {
+        if (layout.row_pitch % gpus[i]->limits.align_tex_xfer_pitch) {
+            fprintf(stderr, "Warning: Row pitch %zu is not a multiple of "
+                    "optimal transfer pitch (%zu) for GPU '%s'\n",
+                    layout.row_pitch, gpus[i]->limits.align_tex_xfer_pitch,
+                    names[i]);
         }
+    }
+
+    // Only link buffers when the two devices can actually share memory
+    const enum pl_handle_type src_export = pick_handle(srcgpu, dstgpu);
+    const enum pl_handle_type dst_export = pick_handle(dstgpu, srcgpu);
+
+    pl_tex *src = calloc(cfg.num_tex, sizeof(pl_tex));
+    pl_tex *dst = calloc(cfg.num_tex, sizeof(pl_tex));
+    uint8_t *host_mem = malloc(layout.buffer_size);
+    if (!src || !dst || !host_mem)
+        exit(2);
+
+    for (int i = 0; i < cfg.num_tex; i++) {
+        struct buffers *srcbuffers = alloc_buffers(srcgpu, &layout, src_export);
+        struct buffers *dstbuffers = alloc_buffers(dstgpu, &layout, dst_export);
+        link_buffers(srcgpu, srcbuffers, dstbuffers);
+        link_buffers(dstgpu, dstbuffers, srcbuffers);
 
         src[i] = pl_tex_create(srcgpu, pl_tex_params(
-            .w             = WIDTH,
-            .h             = HEIGHT,
+            .w             = cfg.width,
+            .h             = cfg.height,
             .format        = srcfmt,
             .host_readable = true,
             .blit_dst      = true,
@@ -316,8 +565,8 @@ static void run_tests(pl_gpu srcgpu, pl_gpu dstgpu)
         ));
 
         dst[i] = pl_tex_create(dstgpu, pl_tex_params(
-            .w             = WIDTH,
-            .h             = HEIGHT,
+            .w             = cfg.width,
+            .h             = cfg.height,
             .format        = dstfmt,
             .host_writable = true,
             .blit_dst      = true,
@@ -329,8 +578,10 @@ static void run_tests(pl_gpu srcgpu, pl_gpu dstgpu)
     }
 
     struct ctx ctx = {
-        .srcgpu = srcgpu,
-        .dstgpu = dstgpu,
+        .srcgpu   = srcgpu,
+        .dstgpu   = dstgpu,
+        .layout   = &layout,
+        .host_mem = host_mem,
     };
 
     static const char *owners[] = {
@@ -344,7 +595,12 @@ static void run_tests(pl_gpu srcgpu, pl_gpu dstgpu)
         [GPU] = "gpu",
     };
 
-    double baseline = bench(ctx, src, dst, NULL);
+    if (!cfg.json)
+        printf("%s -> %s:\n", srcname, dstname);
+
+    struct result res = bench(ctx, src, dst, NULL);
+    const double baseline = res.avg;
+    free(res.latency);
 
     // Test all possible generic copy methods
     for (enum mem_owner owner = 0; owner < NUM_MEM_OWNERS; owner++) {
@@ -361,124 +617,258 @@ static void run_tests(pl_gpu srcgpu, pl_gpu dstgpu)
                     if (owner == DST && !noimport)
                         continue; // exhausts source address space
 
-                    struct ctx cfg = ctx;
-                    cfg.noimport = noimport;
-                    cfg.owner    = owner;
-                    cfg.type     = type;
-                    cfg.async    = async;
-
-                    printf("  %s %s %s %s : ",
-                           owners[owner], types[type],
-                           noimport ? "memcpy" : "      ",
-                           async    ? "async" : "     ");
+                    struct ctx cur = ctx;
+                    cur.noimport = noimport;
+                    cur.owner    = owner;
+                    cur.type     = type;
+                    cur.async    = async;
 
-                    double dur = bench(cfg, src, dst, copy_ptr) - baseline;
-                    printf("avg %.0f μs\t%.3f fps\n",
-                           1e6 * dur, 1.0 / dur);
+                    res = bench(cur, src, dst, copy_ptr);
+                    print_result(srcname, dstname, owners[owner], types[type],
+                                 noimport ? "memcpy" : "import", async,
+                                 &cur, baseline, &res);
                 }
             }
         }
     }
 
-    // Test DMABUF interop when supported
+    // Test buffer sharing when supported
     for (enum mem_owner owner = 0; owner < NUM_MEM_OWNERS; owner++) {
         for (enum mem_type type = 0; type < NUM_MEM_TYPES; type++) {
             for (int async = 0; async <= 1; async++) {
                 struct buffers *buffers;
+                enum pl_handle_type handle;
                 switch (owner) {
                 case SRC:
                     buffers = dst[0]->params.user_data;
+                    handle = src_export;
                     if (!buffers->imported[type])
                         continue;
                     break;
                 case DST:
                     buffers = src[0]->params.user_data;
+                    handle = dst_export;
                     if (!buffers->imported[type])
                         continue;
                     break;
                 default: continue;
                 }
 
-                struct ctx cfg = ctx;
-                cfg.owner = owner;
-                cfg.type = type;
+                struct ctx cur = ctx;
+                cur.owner = owner;
+                cur.type  = type;
+                cur.async = async;
 
-                printf("  %s %s %s %s : ",
-                       owners[owner], types[type], "dmabuf",
-                       async ? "async" : "     ");
-
-                double dur = bench(cfg, src, dst, copy_interop) - baseline;
-                        printf("avg %.0f μs\t%.3f fps\n",
-                               1e6 * dur, 1.0 / dur);
+                res = bench(cur, src, dst, copy_interop);
+                print_result(srcname, dstname, owners[owner], types[type],
+                             handle_name(handle), async, &cur, baseline, &res);
             }
         }
     }
 
-    for (int i = 0; i < NUM_TEX; i++) {
+    for (int i = 0; i < cfg.num_tex; i++) {
         free_buffers(src[i]->params.user_data);
         free_buffers(dst[i]->params.user_data);
         pl_tex_destroy(srcgpu, &src[i]);
         pl_tex_destroy(dstgpu, &dst[i]);
     }
+
+    free(src);
+    free(dst);
+    free(host_mem);
 }
 
-int main(int argc, const char *argv[])
+enum {
+    OPT_NO_ASYNC_TX = 256,
+    OPT_NO_ASYNC_COMP,
+};
+
+static bool parse_int(const char *str, int min, int *out)
 {
-    if (argc < 3) {
-        fprintf(stderr, "Usage: %s 'Device 1' 'Device 2'\n\n", argv[0]);
-        fprintf(stderr, "(Use `vulkaninfo` for a list of devices)\n");
-        exit(1);
+    char *end;
+    long val = strtol(str, &end, 10);
+    if (end == str || *end || val < min || val > INT32_MAX)
+        return false;
+    *out = val;
+    return true;
+}
+
+static bool parse_args(int argc, char *argv[], const char *devices[],
+                       int *num_devices)
+{
+    static const struct option long_options[] = {
+        {"verbose",             no_argument,        NULL, 'v'},
+        {"quiet",               no_argument,        NULL, 'q'},
+        {"json",                no_argument,        NULL, 'j'},
+        {"size",                required_argument,  NULL, 's'},
+        {"format",              required_argument,  NULL, 'f'},
+        {"textures",            required_argument,  NULL, 'n'},
+        {"queues",              required_argument,  NULL, 'Q'},
+        {"time",                required_argument,  NULL, 't'},
+        {"warmup",              required_argument,  NULL, 'w'},
+        {"no-async-transfer",   no_argument,        NULL, OPT_NO_ASYNC_TX},
+        {"no-async-compute",    no_argument,        NULL, OPT_NO_ASYNC_COMP},
+        {"help",                no_argument,        NULL, 'h'},
+        {0}
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "vqjs:f:n:Q:t:w:h", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'v':
+                if (cfg.verbosity < PL_LOG_TRACE)
+                    cfg.verbosity++;
+                break;
+            case 'q':
+                if (cfg.verbosity > PL_LOG_NONE)
+                    cfg.verbosity--;
+                break;
+            case 'j':
+                cfg.json = true;
+                break;
+            case 's':
+                if (sscanf(optarg, "%dx%d", &cfg.width, &cfg.height) != 2 ||
+                    cfg.width <= 0 || cfg.height <= 0)
+                {
+                    fprintf(stderr, "Invalid value for -s/--size: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'f':
+                cfg.format = optarg;
+                break;
+            case 'n':
+                if (!parse_int(optarg, 1, &cfg.num_tex)) {
+                    fprintf(stderr, "Invalid value for -n/--textures: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'Q':
+                if (!parse_int(optarg, 1, &cfg.num_queues)) {
+                    fprintf(stderr, "Invalid value for -Q/--queues: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 't':
+                if (!parse_int(optarg, 1, &cfg.test_ms)) {
+                    fprintf(stderr, "Invalid value for -t/--time: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'w':
+                if (!parse_int(optarg, 0, &cfg.warmup_ms)) {
+                    fprintf(stderr, "Invalid value for -w/--warmup: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case OPT_NO_ASYNC_TX:
+                cfg.async_tx = false;
+                break;
+            case OPT_NO_ASYNC_COMP:
+                cfg.async_comp = false;
+                break;
+            case 'h':
+            case '?':
+            default:
+                goto error;
+        }
+    }
+
+    *num_devices = argc - optind;
+    if (*num_devices < 1) {
+        fprintf(stderr, "Missing device name!\n");
+        goto error;
+    } else if (*num_devices > MAX_DEVICES) {
+        fprintf(stderr, "Too many devices (max %d)!\n", MAX_DEVICES);
+        goto error;
     }
 
+    for (int i = 0; i < *num_devices; i++)
+        devices[i] = argv[optind + i];
+
+    if (!cfg.num_queues)
+        cfg.num_queues = cfg.num_tex;
+    return true;
+
+error:
+    fprintf(stderr, "Usage: %s [options] 'Device 1' ['Device 2' ...]\n\n", argv[0]);
+    fprintf(stderr, "Benchmarks transfers between every ordered pair of devices,\n"
+                    "or from a single device to itself. (Use `vulkaninfo` for a\n"
+                    "list of devices)\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -v, --verbose            Increase verbosity\n");
+    fprintf(stderr, "  -q, --quiet              Decrease verbosity\n");
+    fprintf(stderr, "  -j, --json               Output results as JSON\n");
+    fprintf(stderr, "  -s, --size WxH           Image size (default: 1920x1080)\n");
+    fprintf(stderr, "  -f, --format NAME        Texture format (default: r16)\n");
+    fprintf(stderr, "  -n, --textures N         Number of textures in flight (default: 16)\n");
+    fprintf(stderr, "  -Q, --queues N           Queues per device (default: textures)\n");
+    fprintf(stderr, "  -t, --time MS            Test duration (default: 1500)\n");
+    fprintf(stderr, "  -w, --warmup MS          Warmup duration (default: 500)\n");
+    fprintf(stderr, "      --no-async-transfer  Disable async transfer queues\n");
+    fprintf(stderr, "      --no-async-compute   Disable async compute queues\n");
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    const char *names[MAX_DEVICES];
+    pl_vulkan devs[MAX_DEVICES] = {0};
+    int num_devs = 0;
+    if (!parse_args(argc, argv, names, &num_devs))
+        exit(1);
+
     pl_log log = pl_log_create(PL_API_VER, pl_log_params(
         .log_cb    = pl_log_color,
-        .log_level = PL_LOG_WARN,
+        .log_level = cfg.verbosity,
     ));
 
     pl_vk_inst inst = pl_vk_inst_create(log, pl_vk_inst_params(
         .debug = false,
     ));
 
-    pl_vulkan dev1 = pl_vulkan_create(log, pl_vulkan_params(
-        .device_name    = argv[1],
-        .queue_count    = NUM_QUEUES,
-        .async_transfer = ASYNC_TX,
-        .async_compute  = ASYNC_COMP,
-    ));
-
-    pl_vulkan dev2 = pl_vulkan_create(log, pl_vulkan_params(
-        .device_name    = argv[2],
-        .queue_count    = NUM_QUEUES,
-        .async_transfer = ASYNC_TX,
-        .async_compute  = ASYNC_COMP,
-    ));
+    for (int i = 0; i < num_devs; i++) {
+        devs[i] = pl_vulkan_create(log, pl_vulkan_params(
+            .device_name    = names[i],
+            .queue_count    = cfg.num_queues,
+            .async_transfer = cfg.async_tx,
+            .async_compute  = cfg.async_comp,
+        ));
 
-    if (!dev1 || !dev2) {
-        fprintf(stderr, "Failed creating Vulkan device!\n");
-        exit(1);
+        if (!devs[i]) {
+            fprintf(stderr, "Failed creating Vulkan device '%s'!\n", names[i]);
+            exit(1);
+        }
     }
 
-    if (ROW_PITCH % dev1->gpu->limits.align_tex_xfer_pitch) {
-        fprintf(stderr, "Warning: Row pitch %d is not a multiple of optimal "
-                "transfer pitch (%zu) for GPU '%s'\n", ROW_PITCH,
-                dev1->gpu->limits.align_tex_xfer_pitch, argv[1]);
+    if (cfg.json) {
+        printf("{\n  \"config\": {\"width\": %d, \"height\": %d, \"format\": ",
+               cfg.width, cfg.height);
+        json_str(cfg.format);
+        printf(", \"textures\": %d, \"queues\": %d, \"async_transfer\": %s, "
+               "\"async_compute\": %s, \"test_ms\": %d, \"warmup_ms\": %d},\n",
+               cfg.num_tex, cfg.num_queues, cfg.async_tx ? "true" : "false",
+               cfg.async_comp ? "true" : "false", cfg.test_ms, cfg.warmup_ms);
+        printf("  \"results\": [");
     }
 
-    if (ROW_PITCH % dev2->gpu->limits.align_tex_xfer_pitch) {
-        fprintf(stderr, "Warning: Row pitch %d is not a multiple of optimal "
-                "transfer pitch (%zu) for GPU '%s'\n", ROW_PITCH,
-                dev2->gpu->limits.align_tex_xfer_pitch, argv[2]);
+    if (num_devs == 1) {
+        run_tests(devs[0], names[0], devs[0], names[0]);
+    } else {
+        for (int i = 0; i < num_devs; i++) {
+            for (int j = i + 1; j < num_devs; j++) {
+                run_tests(devs[i], names[i], devs[j], names[j]);
+                if (strcmp(names[i], names[j]))
+                    run_tests(devs[j], names[j], devs[i], names[i]);
+            }
+        }
     }
 
-    printf("%s -> %s:\n", argv[1], argv[2]);
-    run_tests(dev1->gpu, dev2->gpu);
-    if (strcmp(argv[1], argv[2])) {
-        printf("%s -> %s:\n", argv[2], argv[1]);
-        run_tests(dev2->gpu, dev1->gpu);
-    }
+    if (cfg.json)
+        printf("\n  ]\n}\n");
 
-    pl_vulkan_destroy(&dev1);
-    pl_vulkan_destroy(&dev2);
+    for (int i = 0; i < num_devs; i++)
+        pl_vulkan_destroy(&devs[i]);
     pl_vk_inst_destroy(&inst);
     pl_log_destroy(&log);
 }
@@ -34,6 +34,79 @@ static inline void log_time(struct timing *t, double ts)
     t->count++;
 }
 
+static inline double timeline_ts(const struct plplay *p, pl_clock_t ts)
+{
+    return ts ? pl_clock_diff(ts, p->timeline.base) : 0.0;
+}
+
+static inline struct timeline_entry *timeline_cur(struct plplay *p)
+{
+    return &p->timeline.entries[p->timeline.pos % MAX_TIMELINE];
+}
+
+// Records the GPU completion time of the last fenced iteration, if any. This
+// is only ever as accurate as the frequency at which it gets polled
+static void timeline_poll(struct plplay *p)
+{
+    if (!p->timeline.fence_pending)
+        return;
+    if (pl_buf_poll(p->win->gpu, p->timeline.fence[1], 0))
+        return;
+
+    p->timeline.fence_pending = false;
+    if (p->timeline.pos - p->timeline.fence_pos < MAX_TIMELINE) {
+        struct timeline_entry *tl;
+        tl = &p->timeline.entries[p->timeline.fence_pos % MAX_TIMELINE];
+        tl->gpu_done = timeline_ts(p, pl_clock_now());
+    }
+}
+
+// Queues a trivial buffer copy behind the current frame's commands, so it can
+// later be polled for completion. Only one fence is in flight at a time, so
+// frames rendered while the previous one is still pending are not tracked
+static void timeline_fence(struct plplay *p)
+{
+    if (p->timeline.fence_pending || !p->timeline.fence[0] || !p->timeline.fence[1])
+        return;
+
+    pl_buf_copy(p->win->gpu, p->timeline.fence[1], 0, p->timeline.fence[0], 0,
+                p->timeline.fence[0]->params.size);
+    p->timeline.fence_pos = p->timeline.pos;
+    p->timeline.fence_pending = true;
+}
+
+bool save_timeline(const struct plplay *p, const char *path)
+{
+    FILE *file = fopen(path, "w");
+    if (!file) {
+        fprintf(stderr, "Failed opening '%s' for writing!\n", path);
+        return false;
+    }
+
+    fprintf(file, "frame,pts,decode_start,decode_end,map_start,map_end,"
+                  "acquire,update,render,render_end,submit,gpu_done,present\n");
+
+    // Skip the iteration in progress, which has recycled the oldest slot
+    const uint64_t end = p->timeline.pos;
+    const uint64_t start = end >= MAX_TIMELINE ? end - (MAX_TIMELINE - 1) : 0;
+    for (uint64_t n = start; n < end; n++) {
+        const struct timeline_entry *tl = &p->timeline.entries[n % MAX_TIMELINE];
+        fprintf(file, "%"PRIu64",%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,"
+                "%.3f,%.3f,%.3f\n", n, tl->pts * 1e3,
+                tl->decode_start * 1e3, tl->decode_end * 1e3,
+                tl->map_start * 1e3, tl->map_end * 1e3,
+                tl->acquire * 1e3, tl->update * 1e3,
+                tl->render * 1e3, tl->render_end * 1e3,
+                tl->submit * 1e3, tl->gpu_done * 1e3, tl->present * 1e3);
+    }
+
+    bool ok = !ferror(file);
+    ok &= fclose(file) == 0;
+    if (ok)
+        printf("Saved frame timeline to '%s'\n", path);
+    return ok;
+}
+
 static void uninit(struct plplay *p)
 {
     if (p->decoder_thread_created) {
@@ -42,6 +115,9 @@ static void uninit(struct plplay *p)
         pl_thread_join(p->decoder_thread);
     }
 
+    if (p->args.timeline_file && p->timeline.pos)
+        save_timeline(p, p->args.timeline_file);
+
     pl_queue_destroy(&p->queue);
     pl_renderer_destroy(&p->renderer);
     pl_options_free(&p->opts);
@@ -58,6 +134,11 @@ static void uninit(struct plplay *p)
             pl_shader_info_deref(&p->blend_info[j][i].shader);
     }
 
+    if (p->win) {
+        pl_buf_destroy(p->win->gpu, &p->timeline.fence[0]);
+        pl_buf_destroy(p->win->gpu, &p->timeline.fence[1]);
+    }
+
     free(p->shader_hooks);
     free(p->shader_paths);
     free(p->icc_name);
@@ -221,6 +302,15 @@ static bool map_frame(pl_gpu gpu, pl_tex *tex,
 {
     AVFrame *frame = src->frame_data;
     struct plplay *p = frame->opaque;
+    struct timeline_entry *tl = timeline_cur(p);
+    if (!tl->map_start)
+        tl->map_start = timeline_ts(p, pl_clock_now());
+    if (frame->opaque_ref) {
+        const struct frame_times *times = (void *) frame->opaque_ref->data;
+        tl->decode_start = timeline_ts(p, times->decode_start);
+        tl->decode_end = timeline_ts(p, times->decode_end);
+    }
+
     bool ok = pl_map_avframe_ex(gpu, out_frame, pl_avframe_params(
         .frame      = frame,
         .tex        = tex,
@@ -228,6 +318,7 @@ static bool map_frame(pl_gpu gpu, pl_tex *tex,
     ));
 
     av_frame_free(&frame); // references are preserved by `out_frame`
+    tl->map_end = timeline_ts(p, pl_clock_now());
     if (!ok) {
         fprintf(stderr, "Failed mapping AVFrame!\n");
         return false;
@@ -266,6 +357,7 @@ static PL_THREAD_VOID decode_loop(void *arg)
     double first_pts = 0.0, base_pts = 0.0, last_pts = 0.0;
     uint64_t num_frames = 0;
 
+    pl_clock_t ts_decode = pl_clock_now();
     while (!p->exit_thread) {
         switch ((ret = av_read_frame(p->format, packet))) {
         case 0:
@@ -299,6 +391,13 @@ static PL_THREAD_VOID decode_loop(void *arg)
             if (num_frames++ == 0)
                 first_pts = last_pts;
             frame->opaque = p;
+            av_buffer_unref(&frame->opaque_ref);
+            frame->opaque_ref = av_buffer_allocz(sizeof(struct frame_times));
+            if (frame->opaque_ref) {
+                struct frame_times *times = (void *) frame->opaque_ref->data;
+                times->decode_start = ts_decode;
+                times->decode_end = pl_clock_now();
+            }
             (void) atomic_fetch_add(&p->stats.decoded, 1);
             pl_queue_push_block(p->queue, UINT64_MAX, &(struct pl_source_frame) {
                 .pts = last_pts - first_pts + base_pts,
@@ -314,6 +413,7 @@ static PL_THREAD_VOID decode_loop(void *arg)
                                     : PL_FIELD_NONE,
             });
             frame = av_frame_alloc();
+            ts_decode = pl_clock_now(); // exclude time spent blocked on the queue
         }
 
         switch (ret) {
@@ -456,6 +556,11 @@ static bool render_frame(struct plplay *p, const struct pl_swapchain_frame *fram
     if (!ui_draw(p->ui, frame))
         return false;
     pl_clock_t ts_ui_drawn = pl_clock_now();
+    timeline_fence(p);
+
+    struct timeline_entry *tl = timeline_cur(p);
+    tl->render = timeline_ts(p, ts_pre);
+    tl->render_end = timeline_ts(p, ts_ui_drawn);
 
     log_time(&p->stats.render, pl_clock_diff(ts_rendered, ts_pre));
     log_time(&p->stats.draw_ui, pl_clock_diff(ts_ui_drawn, ts_rendered));
@@ -517,7 +622,10 @@ static bool render_loop(struct plplay *p)
             window_toggle_fullscreen(p->win, !window_is_fullscreen(p->win));
 
         update_colorspace_hint(p, &mix);
+        timeline_poll(p);
         pl_clock_t ts_acquire = pl_clock_now();
+        struct timeline_entry *tl = timeline_cur(p);
+        *tl = (struct timeline_entry) { .acquire = timeline_ts(p, ts_acquire) };
         if (!pl_swapchain_start_frame(p->win->swapchain, &frame)) {
             // Window stuck/invisible? Block for events and try again.
             window_poll(p->win, true);
@@ -531,8 +639,11 @@ static bool render_loop(struct plplay *p)
 
         qparams.timeout = 0; // non-blocking update
         qparams.radius = pl_frame_mix_radius(&p->opts->params);
+        qparams.vrr = !opts->params.frame_mixer;
         qparams.pts = fmax(pts_target, pl_clock_diff(ts_pre_update, ts_start));
         p->stats.current_pts = qparams.pts;
+        tl->pts = qparams.pts;
+        tl->update = timeline_ts(p, ts_pre_update);
         if (qparams.pts != prev_pts)
             log_time(&p->stats.pts_interval, qparams.pts - prev_pts);
         prev_pts = qparams.pts;
@@ -582,7 +693,9 @@ retry:
             pts_target = 0.0;
         }
 
+        timeline_poll(p);
         pl_clock_t ts_pre_submit = pl_clock_now();
+        tl->submit = timeline_ts(p, ts_pre_submit);
         if (!pl_swapchain_submit_frame(p->win->swapchain)) {
             fprintf(stderr, "libplacebo: failed presenting frame!\n");
             goto error;
@@ -597,21 +710,19 @@ retry:
         pl_swapchain_swap_buffers(p->win->swapchain);
         pl_clock_t ts_post_swap = pl_clock_now();
         log_time(&p->stats.swap, pl_clock_diff(ts_post_swap, ts_post_submit));
+        tl->present = timeline_ts(p, ts_post_swap);
+        p->timeline.pos++;
+        timeline_poll(p);
 
         window_poll(p->win, false);
 
         // In content-timed mode (frame mixing disabled), delay rendering
         // until the next frame should become visible
-        if (!opts->params.frame_mixer) {
-            struct pl_source_frame next;
-            for (int i = 0;; i++) {
-                if (!pl_queue_peek(p->queue, i, &next))
-                    break;
-                if (next.pts > qparams.pts) {
-                    pts_target = next.pts;
-                    break;
-                }
-            }
+        double next_pts;
+        if (qparams.vrr && pl_queue_vrr_timing(p->queue, NULL, &next_pts) &&
+            isfinite(next_pts))
+        {
+            pts_target = next_pts;
         }
 
         if (p->fps_override)
@@ -743,6 +854,14 @@ int main(int argc, char *argv[])
         }
     }
 
+    for (int i = 0; i < 2; i++) {
+        p->timeline.fence[i] = pl_buf_create(p->win->gpu, pl_buf_params(
+            .size = sizeof(uint32_t),
+            .debug_tag = PL_DEBUG_TAG,
+        ));
+    }
+
+    p->timeline.base = pl_clock_now();
     p->queue = pl_queue_create(p->win->gpu);
     int ret = pl_thread_create(&p->decoder_thread, decode_loop, p);
     if (ret != 0) {
@@ -5,11 +5,13 @@
 #include <libplacebo/utils/frame_queue.h>
 
 #include "common.h"
+#include "pl_clock.h"
 #include "pl_thread.h"
 
 #define MAX_FRAME_PASSES 256
 #define MAX_BLEND_PASSES 8
 #define MAX_BLEND_FRAMES 8
+#define MAX_TIMELINE 1024
 
 enum {
     ZOOM_PAD = 0,
@@ -30,11 +32,37 @@ struct plplay_args {
     enum pl_log_level verbosity;
     const char *window_impl;
     const char *filename;
+    const char *timeline_file;
     bool hwdec;
 };
 
 bool parse_args(struct plplay_args *args, int argc, char *argv[]);
 
+// Timestamps of a single render loop iteration, in seconds relative to the
+// start of playback. Events which did not happen are left as 0.0.
+struct timeline_entry {
+    double pts;          // playback position
+    double acquire;      // before pl_swapchain_start_frame
+    double update;       // before pl_queue_update
+    double map_start;    // first `map_frame` call started
+    double map_end;      // last `map_frame` call finished
+    double render;       // before pl_render_image_mix
+    double render_end;   // all rendering commands (including UI) recorded
+    double submit;       // before pl_swapchain_submit_frame
+    double present;      // after pl_swapchain_swap_buffers
+    double gpu_done;     // GPU first observed idle after this frame's commands
+
+    // Decoder timestamps of the last source frame mapped in this iteration
+    double decode_start; // decoder started working towards this frame
+    double decode_end;   // frame received from the decoder and pushed
+};
+
+// Attached to every decoded AVFrame via `opaque_ref`
+struct frame_times {
+    pl_clock_t decode_start;
+    pl_clock_t decode_end;
+};
+
 struct plplay {
     struct plplay_args args;
     struct window *win;
@@ -110,10 +138,23 @@ struct plplay {
         } acquire, update, render, draw_ui, sleep, submit, swap,
           vsync_interval, pts_interval;
     } stats;
+
+    // frame timeline, `entries[n % MAX_TIMELINE]` holds iteration `n`
+    struct {
+        pl_clock_t base;
+        struct timeline_entry entries[MAX_TIMELINE];
+        uint64_t pos; // iteration currently being recorded
+        pl_buf fence[2];
+        uint64_t fence_pos; // iteration whose GPU completion is pending
+        bool fence_pending;
+    } timeline;
 };
 
 void update_settings(struct plplay *p, const struct pl_frame *target);
 
+// Writes the recorded frame timeline to `path` as CSV, in milliseconds
+bool save_timeline(const struct plplay *p, const char *path);
+
 static inline void apply_csp_overrides(struct plplay *p, struct pl_color_space *csp)
 {
     if (p->force_prim) {
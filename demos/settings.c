@@ -25,11 +25,12 @@ bool parse_args(struct plplay_args *args, int argc, char *argv[])
         {"preset",  required_argument,  NULL, 'p'},
         {"hwdec",   no_argument,        NULL, 'H'},
         {"window",  required_argument,  NULL, 'w'},
+        {"timeline", required_argument, NULL, 't'},
         {0}
     };
 
     int option;
-    while ((option = getopt_long(argc, argv, "vqp:Hw:", long_options, NULL)) != -1) {
+    while ((option = getopt_long(argc, argv, "vqp:Hw:t:", long_options, NULL)) != -1) {
         switch (option) {
             case 'v':
                 if (args->verbosity < PL_LOG_TRACE)
@@ -57,6 +58,9 @@ bool parse_args(struct plplay_args *args, int argc, char *argv[])
             case 'w':
                 args->window_impl = optarg;
                 break;
+            case 't':
+                args->timeline_file = optarg;
+                break;
             case '?':
             default:
                 goto error;
@@ -79,13 +83,14 @@ bool parse_args(struct plplay_args *args, int argc, char *argv[])
     return true;
 
 error:
-    fprintf(stderr, "Usage: %s [-v/--verbose] [-q/--quiet] [-p/--preset <default|fast|hq|highquality>] [--hwdec] [-w/--window <api>] <filename>\n", argv[0]);
+    fprintf(stderr, "Usage: %s [-v/--verbose] [-q/--quiet] [-p/--preset <default|fast|hq|highquality>] [--hwdec] [-w/--window <api>] [-t/--timeline <file>] <filename>\n", argv[0]);
     fprintf(stderr, "Options:\n");
     fprintf(stderr, "  -v, --verbose   Increase verbosity\n");
     fprintf(stderr, "  -q, --quiet     Decrease verbosity\n");
     fprintf(stderr, "  -p, --preset    Set the rendering preset (default|fast|hq|highquality)\n");
     fprintf(stderr, "  -H, --hwdec     Enable hardware decoding\n");
     fprintf(stderr, "  -w, --window    Specify the windowing API\n");
+    fprintf(stderr, "  -t, --timeline  Save the frame timeline as CSV on exit\n");
     return false;
 }
 
@@ -190,6 +195,132 @@ static void draw_timing(struct nk_context *nk, const char *label,
               avg * 1e3, stddev * 1e3, t->peak * 1e3);
 }
 
+enum {
+    TL_INTERVAL,
+    TL_DECODE,
+    TL_QUEUE,
+    TL_UPLOAD,
+    TL_RENDER,
+    TL_GPU,
+    TL_PRESENT,
+    TL_COUNT,
+};
+
+static const char *const timeline_labels[TL_COUNT] = {
+    [TL_INTERVAL]   = "Frame interval:",
+    [TL_DECODE]     = "Decode:",
+    [TL_QUEUE]      = "Queue latency:",
+    [TL_UPLOAD]     = "Upload (map):",
+    [TL_RENDER]     = "Render (CPU):",
+    [TL_GPU]        = "Render to GPU idle:",
+    [TL_PRESENT]    = "Present:",
+};
+
+// Time between two timeline events, or a negative value if either is missing
+static inline double timeline_diff(double end, double start)
+{
+    return end && start ? end - start : -1.0;
+}
+
+static double timeline_metric(const struct plplay *p, uint64_t n, int metric)
+{
+    const struct timeline_entry *tl = &p->timeline.entries[n % MAX_TIMELINE];
+    switch (metric) {
+    case TL_INTERVAL: ;
+        const struct timeline_entry *prev;
+        prev = &p->timeline.entries[(n + MAX_TIMELINE - 1) % MAX_TIMELINE];
+        return timeline_diff(tl->present, prev->present);
+    case TL_DECODE:     return timeline_diff(tl->decode_end, tl->decode_start);
+    case TL_QUEUE:      return timeline_diff(tl->map_start, tl->decode_end);
+    case TL_UPLOAD:     return timeline_diff(tl->map_end, tl->map_start);
+    case TL_RENDER:     return timeline_diff(tl->render_end, tl->render);
+    case TL_GPU:        return timeline_diff(tl->gpu_done, tl->render);
+    case TL_PRESENT:    return timeline_diff(tl->present, tl->submit);
+    }
+
+    abort();
+}
+
+static int cmp_double(const void *pa, const void *pb)
+{
+    const double a = *(const double *) pa, b = *(const double *) pb;
+    return (a > b) - (a < b);
+}
+
+#define TIMELINE_GRAPH 240
+
+static void draw_timeline(struct nk_context *nk, struct plplay *p)
+{
+    // The slot of the iteration in progress has already been recycled, and
+    // the oldest remaining iteration has no predecessor to measure against
+    const uint64_t end = p->timeline.pos;
+    const uint64_t start = end > MAX_TIMELINE - 2 ? end - (MAX_TIMELINE - 2) : 1;
+
+    // Frame interval and GPU completion latency of the most recent frames
+    const uint64_t graph_start = end > TIMELINE_GRAPH ? end - TIMELINE_GRAPH : start;
+    float peak = 1.0f / 60.0f;
+    for (uint64_t n = graph_start; n < end; n++) {
+        peak = fmaxf(peak, timeline_metric(p, n, TL_INTERVAL));
+        peak = fmaxf(peak, timeline_metric(p, n, TL_GPU));
+    }
+
+    nk_layout_row_dynamic(nk, 64, 1);
+    if (end > graph_start &&
+        nk_chart_begin(nk, NK_CHART_LINES, end - graph_start, 0.0f, peak * 1e3f))
+    {
+        nk_chart_add_slot(nk, NK_CHART_LINES, end - graph_start, 0.0f, peak * 1e3f);
+        for (uint64_t n = graph_start; n < end; n++) {
+            nk_chart_push_slot(nk, fmax(timeline_metric(p, n, TL_INTERVAL), 0.0) * 1e3, 0);
+            nk_chart_push_slot(nk, fmax(timeline_metric(p, n, TL_GPU), 0.0) * 1e3, 1);
+        }
+        nk_chart_end(nk);
+    }
+
+    nk_layout_row_dynamic(nk, 24, 1);
+    nk_label(nk, "Frame interval (top) / render to GPU idle (bottom) in ms:", NK_TEXT_LEFT);
+
+    nk_layout_row_dynamic(nk, 24, 5);
+    nk_label(nk, "", NK_TEXT_LEFT);
+    nk_label(nk, "p50", NK_TEXT_LEFT);
+    nk_label(nk, "p95", NK_TEXT_LEFT);
+    nk_label(nk, "p99", NK_TEXT_LEFT);
+    nk_label(nk, "max", NK_TEXT_LEFT);
+
+    static double values[MAX_TIMELINE];
+    for (int metric = 0; metric < TL_COUNT; metric++) {
+        int num = 0;
+        for (uint64_t n = start; n < end; n++) {
+            double val = timeline_metric(p, n, metric);
+            if (val >= 0.0)
+                values[num++] = val;
+        }
+
+        nk_label(nk, timeline_labels[metric], NK_TEXT_LEFT);
+        if (!num) {
+            for (int i = 0; i < 4; i++)
+                nk_label(nk, "-", NK_TEXT_LEFT);
+            continue;
+        }
+
+        qsort(values, num, sizeof(values[0]), cmp_double);
+        nk_labelf(nk, NK_TEXT_LEFT, "%.3f", values[(num - 1) * 50 / 100] * 1e3);
+        nk_labelf(nk, NK_TEXT_LEFT, "%.3f", values[(num - 1) * 95 / 100] * 1e3);
+        nk_labelf(nk, NK_TEXT_LEFT, "%.3f", values[(num - 1) * 99 / 100] * 1e3);
+        nk_labelf(nk, NK_TEXT_LEFT, "%.3f", values[num - 1] * 1e3);
+    }
+
+    nk_layout_row_dynamic(nk, 24, 2);
+    if (nk_button_label(nk, "Export CSV")) {
+        const char *path = p->args.timeline_file;
+        save_timeline(p, path ? path : "plplay-timeline.csv");
+    }
+    if (nk_button_label(nk, "Reset timeline")) {
+        memset(p->timeline.entries, 0, sizeof(p->timeline.entries));
+        p->timeline.pos = 0;
+        p->timeline.fence_pending = false;
+    }
+}
+
 static void draw_opt_data(void *priv, pl_opt_data data)
 {
     struct nk_context *nk = priv;
@@ -1110,6 +1241,7 @@ void update_settings(struct plplay *p, const struct pl_frame *target)
             nk_checkbox_label(nk, "Disable gamma-aware dither", &par->disable_dither_gamma_correction);
             nk_checkbox_label(nk, "Disable FBOs / advanced rendering", &par->disable_fbos);
             nk_checkbox_label(nk, "Force low-bit depth FBOs", &par->force_low_bit_depth_fbos);
+            nk_checkbox_label(nk, "Reduce FBO precision when safe", &par->auto_fbo_precision);
             nk_checkbox_label(nk, "Disable constant hard-coding", &par->dynamic_constants);
 
             if (nk_check_label(nk, "Ignore Dolby Vision metadata", p->ignore_dovi) != p->ignore_dovi) {
@@ -1185,6 +1317,11 @@ void update_settings(struct plplay *p, const struct pl_frame *target)
                 nk_tree_pop(nk);
             }
 
+            if (nk_tree_push(nk, NK_TREE_NODE, "Frame timeline", NK_MINIMIZED)) {
+                draw_timeline(nk, p);
+                nk_tree_pop(nk);
+            }
+
             if (nk_tree_push(nk, NK_TREE_NODE, "Settings dump", NK_MINIMIZED)) {
 
                 nk_layout_row_dynamic(nk, 24, 2);
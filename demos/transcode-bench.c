@@ -0,0 +1,602 @@
+/* Headless decode -> upload -> render -> download throughput benchmark.
+ *
+ * Decodes a video file with libavcodec and pushes every frame through a
+ * pipeline of four stages, each running on its own thread and connected to
+ * the next one by a bounded queue, like a batch transcoding job would:
+ *
+ *   decode:    libavcodec (software), optionally into mapped GPU buffers
+ *   upload:    `pl_map_avframe_ex`
+ *   render:    `pl_render_image` to an RGBA target, followed by issuing an
+ *              asynchronous download of the result into a host buffer
+ *   download:  waits for the download and copies the pixels out
+ *
+ * The number of frames in flight bounds how far ahead of the downloader the
+ * decoder may run. At the end, the sustained frame rate and the fraction of
+ * time each stage spent busy (rather than waiting on its neighbours) are
+ * reported, which shows which stage limits the throughput. Run with `--help`
+ * for a list of options.
+ *
+ * License: CC0 / Public Domain
+ */
+
+#include <assert.h>
+#include <getopt.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/cpu.h>
+
+#include <libplacebo/renderer.h>
+#include <libplacebo/vulkan.h>
+#include <libplacebo/utils/libav.h>
+
+#include "pl_clock.h"
+#include "pl_thread.h"
+
+#define MAX_IN_FLIGHT 64
+
+static struct config {
+    const char *device;
+    const char *format;
+    int in_flight;
+    int frames;
+    int width, height;
+    bool async_tx;
+    bool async_comp;
+    bool direct;
+    bool hq;
+    enum pl_log_level verbosity;
+} cfg = {
+    .format     = "rgba8",
+    .in_flight  = 4,
+    .async_tx   = true,
+    .async_comp = true,
+    .direct     = true,
+    .verbosity  = PL_LOG_WARN,
+};
+
+enum stage {
+    DECODE,
+    UPLOAD,
+    RENDER,
+    DOWNLOAD,
+    NUM_STAGES,
+};
+
+static const char *const stage_names[NUM_STAGES] = {
+    [DECODE]    = "decode",
+    [UPLOAD]    = "upload",
+    [RENDER]    = "render",
+    [DOWNLOAD]  = "download",
+};
+
+// One frame in flight, owning all of the resources it needs along the way
+struct slot {
+    AVFrame *frame;
+    pl_tex planes[4];
+    struct pl_frame image;
+    pl_tex target;
+    pl_buf readback;
+};
+
+// Bounded FIFO handing slots from one stage to the next. A NULL slot marks
+// the end of the stream. Can never overflow, since there are only ever
+// `cfg.in_flight` slots in circulation.
+struct queue {
+    pl_mutex lock;
+    pl_cond cond;
+    struct slot *slots[MAX_IN_FLIGHT + 1];
+    int head, num;
+};
+
+struct stage_stats {
+    pl_thread thread;
+    pl_clock_t start, end;
+    double wait;        // time spent blocked on the input queue
+    uint64_t frames;
+};
+
+struct bench {
+    pl_gpu gpu;
+    pl_log log;
+    AVFormatContext *format;
+    AVCodecContext *codec;
+    const AVStream *stream;
+    pl_avbuffer_pool pool;
+
+    struct slot slots[MAX_IN_FLIGHT];
+    struct queue queues[NUM_STAGES]; // input queue of each stage
+    struct stage_stats stats[NUM_STAGES];
+    uint8_t *host;      // destination of the downloaded pixels
+    size_t frame_size;
+    _Atomic bool failed;
+
+    // first and last completed frame, for the sustained frame rate
+    pl_clock_t first_done, last_done;
+};
+
+static void queue_init(struct queue *q)
+{
+    *q = (struct queue) {0};
+    pl_mutex_init(&q->lock);
+    pl_cond_init(&q->cond);
+}
+
+static void queue_uninit(struct queue *q)
+{
+    pl_cond_destroy(&q->cond);
+    pl_mutex_destroy(&q->lock);
+}
+
+static void queue_push(struct queue *q, struct slot *slot)
+{
+    pl_mutex_lock(&q->lock);
+    assert(q->num < MAX_IN_FLIGHT + 1);
+    q->slots[(q->head + q->num++) % (MAX_IN_FLIGHT + 1)] = slot;
+    pl_cond_signal(&q->cond);
+    pl_mutex_unlock(&q->lock);
+}
+
+static struct slot *queue_pop(struct queue *q, struct stage_stats *stats)
+{
+    pl_clock_t start = pl_clock_now();
+    pl_mutex_lock(&q->lock);
+    while (!q->num)
+        pl_cond_wait(&q->cond, &q->lock);
+    struct slot *slot = q->slots[q->head];
+    q->head = (q->head + 1) % (MAX_IN_FLIGHT + 1);
+    q->num--;
+    pl_mutex_unlock(&q->lock);
+    stats->wait += pl_clock_diff(pl_clock_now(), start);
+    return slot;
+}
+
+static PL_THREAD_VOID decode_thread(void *arg)
+{
+    struct bench *b = arg;
+    struct stage_stats *stats = &b->stats[DECODE];
+    AVPacket *packet = av_packet_alloc();
+    bool eof = false;
+    int ret;
+
+    stats->start = pl_clock_now();
+    while (!eof && !b->failed && packet) {
+        if (cfg.frames && stats->frames >= (uint64_t) cfg.frames)
+            break;
+
+        struct slot *slot = queue_pop(&b->queues[DECODE], stats);
+        while ((ret = avcodec_receive_frame(b->codec, slot->frame)) == AVERROR(EAGAIN)) {
+            ret = av_read_frame(b->format, packet);
+            if (ret == AVERROR_EOF) {
+                ret = avcodec_send_packet(b->codec, NULL);
+            } else if (ret == 0) {
+                if (packet->stream_index == b->stream->index)
+                    ret = avcodec_send_packet(b->codec, packet);
+                av_packet_unref(packet);
+            }
+
+            if (ret < 0 && ret != AVERROR_EOF && ret != AVERROR(EAGAIN)) {
+                fprintf(stderr, "libavcodec: Failed decoding: %s\n", av_err2str(ret));
+                b->failed = true;
+                break;
+            }
+        }
+
+        if (ret < 0) {
+            eof = true;
+            queue_push(&b->queues[DECODE], slot); // return unused slot
+            continue;
+        }
+
+        stats->frames++;
+        queue_push(&b->queues[UPLOAD], slot);
+    }
+
+    stats->end = pl_clock_now();
+    queue_push(&b->queues[UPLOAD], NULL);
+    av_packet_free(&packet);
+    PL_THREAD_RETURN();
+}
+
+static PL_THREAD_VOID upload_thread(void *arg)
+{
+    struct bench *b = arg;
+    struct stage_stats *stats = &b->stats[UPLOAD];
+    struct slot *slot;
+
+    stats->start = pl_clock_now();
+    while ((slot = queue_pop(&b->queues[UPLOAD], stats))) {
+        if (!pl_map_avframe_ex(b->gpu, &slot->image, pl_avframe_params(
+                .frame  = slot->frame,
+                .tex    = slot->planes,
+            )))
+        {
+            fprintf(stderr, "Failed mapping AVFrame!\n");
+            b->failed = true;
+            av_frame_unref(slot->frame);
+            queue_push(&b->queues[DECODE], slot);
+            continue;
+        }
+
+        av_frame_unref(slot->frame); // references are preserved by `image`
+        pl_frame_copy_stream_props(&slot->image, b->stream);
+        stats->frames++;
+        queue_push(&b->queues[RENDER], slot);
+    }
+
+    stats->end = pl_clock_now();
+    queue_push(&b->queues[RENDER], NULL);
+    PL_THREAD_RETURN();
+}
+
+static PL_THREAD_VOID render_thread(void *arg)
+{
+    struct bench *b = arg;
+    struct stage_stats *stats = &b->stats[RENDER];
+    pl_renderer rr = pl_renderer_create(b->log, b->gpu);
+    const struct pl_render_params *params = cfg.hq ? &pl_render_high_quality_params
+                                                   : &pl_render_default_params;
+    struct slot *slot;
+
+    stats->start = pl_clock_now();
+    while ((slot = queue_pop(&b->queues[RENDER], stats))) {
+        struct pl_frame target = {
+            .num_planes = 1,
+            .planes[0]  = {
+                .texture            = slot->target,
+                .components         = 4,
+                .component_mapping  = {0, 1, 2, 3},
+            },
+            .repr  = pl_color_repr_rgb,
+            .color = pl_color_space_srgb,
+        };
+
+        bool ok = pl_render_image(rr, &slot->image, &target, params);
+        pl_unmap_avframe(b->gpu, &slot->image);
+        ok = ok && pl_tex_download(b->gpu, pl_tex_transfer_params(
+            .tex = slot->target,
+            .buf = slot->readback,
+        ));
+
+        if (!ok) {
+            fprintf(stderr, "Failed rendering frame!\n");
+            b->failed = true;
+            queue_push(&b->queues[DECODE], slot);
+            continue;
+        }
+
+        // Make sure the work actually starts executing in the background
+        pl_gpu_flush(b->gpu);
+        stats->frames++;
+        queue_push(&b->queues[DOWNLOAD], slot);
+    }
+
+    stats->end = pl_clock_now();
+    queue_push(&b->queues[DOWNLOAD], NULL);
+    pl_renderer_destroy(&rr);
+    PL_THREAD_RETURN();
+}
+
+static PL_THREAD_VOID download_thread(void *arg)
+{
+    struct bench *b = arg;
+    struct stage_stats *stats = &b->stats[DOWNLOAD];
+    struct slot *slot;
+
+    stats->start = pl_clock_now();
+    while ((slot = queue_pop(&b->queues[DOWNLOAD], stats))) {
+        while (pl_buf_poll(b->gpu, slot->readback, UINT64_MAX))
+            ; // wait for the GPU to finish rendering and downloading
+        memcpy(b->host, slot->readback->data, b->frame_size);
+
+        pl_clock_t now = pl_clock_now();
+        if (!stats->frames++)
+            b->first_done = now;
+        b->last_done = now;
+        queue_push(&b->queues[DECODE], slot);
+    }
+
+    stats->end = pl_clock_now();
+    PL_THREAD_RETURN();
+}
+
+static bool parse_int(const char *str, int min, int max, int *out)
+{
+    char *end;
+    long val = strtol(str, &end, 10);
+    if (end == str || *end || val < min || val > max)
+        return false;
+    *out = val;
+    return true;
+}
+
+static const char *parse_args(int argc, char *argv[])
+{
+    static const struct option long_options[] = {
+        {"verbose",             no_argument,        NULL, 'v'},
+        {"quiet",               no_argument,        NULL, 'q'},
+        {"in-flight",           required_argument,  NULL, 'n'},
+        {"frames",              required_argument,  NULL, 'f'},
+        {"width",               required_argument,  NULL, 'W'},
+        {"height",              required_argument,  NULL, 'H'},
+        {"format",              required_argument,  NULL, 'F'},
+        {"device",              required_argument,  NULL, 'd'},
+        {"high-quality",        no_argument,        NULL, 'Q'},
+        {"no-async-transfer",   no_argument,        NULL, 'T'},
+        {"no-async-compute",    no_argument,        NULL, 'C'},
+        {"no-direct",           no_argument,        NULL, 'D'},
+        {"help",                no_argument,        NULL, 'h'},
+        {0}
+    };
+
+    int option;
+    while ((option = getopt_long(argc, argv, "vqn:f:W:H:F:d:QTCDh", long_options, NULL)) != -1) {
+        switch (option) {
+            case 'v':
+                if (cfg.verbosity < PL_LOG_TRACE)
+                    cfg.verbosity++;
+                break;
+            case 'q':
+                if (cfg.verbosity > PL_LOG_NONE)
+                    cfg.verbosity--;
+                break;
+            case 'n':
+                if (!parse_int(optarg, 1, MAX_IN_FLIGHT, &cfg.in_flight)) {
+                    fprintf(stderr, "Invalid value for -n/--in-flight: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'f':
+                if (!parse_int(optarg, 0, INT32_MAX, &cfg.frames)) {
+                    fprintf(stderr, "Invalid value for -f/--frames: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'W':
+                if (!parse_int(optarg, 1, 16384, &cfg.width)) {
+                    fprintf(stderr, "Invalid value for -W/--width: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'H':
+                if (!parse_int(optarg, 1, 16384, &cfg.height)) {
+                    fprintf(stderr, "Invalid value for -H/--height: '%s'\n", optarg);
+                    goto error;
+                }
+                break;
+            case 'F': cfg.format = optarg; break;
+            case 'd': cfg.device = optarg; break;
+            case 'Q': cfg.hq = true; break;
+            case 'T': cfg.async_tx = false; break;
+            case 'C': cfg.async_comp = false; break;
+            case 'D': cfg.direct = false; break;
+            case 'h':
+            case '?':
+            default:
+                goto error;
+        }
+    }
+
+    if (argc - optind != 1) {
+        fprintf(stderr, "Missing input file!\n");
+        goto error;
+    }
+
+    return argv[optind];
+
+error:
+    fprintf(stderr, "Usage: %s [options] <filename>\n\n", argv[0]);
+    fprintf(stderr, "Decodes, uploads, renders and downloads every frame of a video\n"
+                    "file on separate threads, and reports the sustained throughput.\n\n");
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "  -v, --verbose            Increase verbosity\n");
+    fprintf(stderr, "  -q, --quiet              Decrease verbosity\n");
+    fprintf(stderr, "  -n, --in-flight N        Frames in flight (default: 4, max: %d)\n", MAX_IN_FLIGHT);
+    fprintf(stderr, "  -f, --frames N           Stop after N frames (default: whole file)\n");
+    fprintf(stderr, "  -W, --width N            Output width (default: source width)\n");
+    fprintf(stderr, "  -H, --height N           Output height (default: source height)\n");
+    fprintf(stderr, "  -F, --format NAME        Output texture format (default: rgba8)\n");
+    fprintf(stderr, "  -d, --device NAME        Vulkan device (default: auto)\n");
+    fprintf(stderr, "  -Q, --high-quality       Use the high quality rendering preset\n");
+    fprintf(stderr, "  -T, --no-async-transfer  Disable asynchronous transfer queues\n");
+    fprintf(stderr, "  -C, --no-async-compute   Disable asynchronous compute queues\n");
+    fprintf(stderr, "  -D, --no-direct          Decode into system memory instead of\n"
+                    "                           mapped GPU buffers\n");
+    return NULL;
+}
+
+static bool open_file(struct bench *b, const char *filename)
+{
+    if (avformat_open_input(&b->format, filename, NULL, NULL) != 0) {
+        fprintf(stderr, "libavformat: Failed opening file!\n");
+        return false;
+    }
+
+    if (avformat_find_stream_info(b->format, NULL) < 0) {
+        fprintf(stderr, "libavformat: Failed finding stream info!\n");
+        return false;
+    }
+
+    int idx = av_find_best_stream(b->format, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+    if (idx < 0) {
+        fprintf(stderr, "File contains no video streams?\n");
+        return false;
+    }
+
+    b->stream = b->format->streams[idx];
+    const AVCodec *codec = avcodec_find_decoder(b->stream->codecpar->codec_id);
+    if (!codec) {
+        fprintf(stderr, "libavcodec: Failed finding matching codec\n");
+        return false;
+    }
+
+    b->codec = avcodec_alloc_context3(codec);
+    if (!b->codec || avcodec_parameters_to_context(b->codec, b->stream->codecpar) < 0) {
+        fprintf(stderr, "libavcodec: Failed initializing codec context\n");
+        return false;
+    }
+
+    if (!pl_test_pixfmt(b->gpu, b->codec->pix_fmt)) {
+        fprintf(stderr, "Unsupported AVPixelFormat: %s\n",
+                av_get_pix_fmt_name(b->codec->pix_fmt));
+        return false;
+    }
+
+    b->codec->thread_count = FFMIN(av_cpu_count() + 1, 16);
+    if (cfg.direct && (b->pool = pl_avbuffer_pool_create(b->gpu))) {
+        b->codec->get_buffer2 = pl_get_buffer2_pooled;
+        b->codec->opaque = b->pool;
+    }
+
+    if (avcodec_open2(b->codec, codec, NULL) < 0) {
+        fprintf(stderr, "libavcodec: Failed opening codec\n");
+        return false;
+    }
+
+    printf("Input: %s, %dx%d %s (%s)\n", filename, b->codec->width, b->codec->height,
+           av_get_pix_fmt_name(b->codec->pix_fmt), codec->name);
+    return true;
+}
+
+static bool init_slots(struct bench *b)
+{
+    const int w = cfg.width ? cfg.width : b->codec->width;
+    const int h = cfg.height ? cfg.height : b->codec->height;
+    pl_fmt fmt = pl_find_named_fmt(b->gpu, cfg.format);
+    if (!fmt || !(fmt->caps & PL_FMT_CAP_RENDERABLE) ||
+        !(fmt->caps & PL_FMT_CAP_HOST_READABLE))
+    {
+        fprintf(stderr, "Output format '%s' is not renderable and readable!\n",
+                cfg.format);
+        return false;
+    }
+
+    b->frame_size = (size_t) w * h * fmt->texel_size;
+    b->host = malloc(b->frame_size);
+    if (!b->host)
+        return false;
+
+    for (int i = 0; i < cfg.in_flight; i++) {
+        struct slot *slot = &b->slots[i];
+        slot->frame = av_frame_alloc();
+        slot->target = pl_tex_create(b->gpu, pl_tex_params(
+            .w              = w,
+            .h              = h,
+            .format         = fmt,
+            .renderable     = true,
+            .host_readable  = true,
+        ));
+        slot->readback = pl_buf_create(b->gpu, pl_buf_params(
+            .size           = b->frame_size,
+            .host_readable  = true,
+            .host_mapped    = true,
+            .memory_type    = PL_BUF_MEM_HOST,
+        ));
+        if (!slot->frame || !slot->target || !slot->readback)
+            return false;
+        queue_push(&b->queues[DECODE], slot);
+    }
+
+    printf("Output: %dx%d %s, %d frames in flight\n", w, h, fmt->name, cfg.in_flight);
+    return true;
+}
+
+static void uninit_slots(struct bench *b)
+{
+    for (int i = 0; i < MAX_IN_FLIGHT; i++) {
+        struct slot *slot = &b->slots[i];
+        av_frame_free(&slot->frame);
+        for (int n = 0; n < 4; n++)
+            pl_tex_destroy(b->gpu, &slot->planes[n]);
+        pl_tex_destroy(b->gpu, &slot->target);
+        pl_buf_destroy(b->gpu, &slot->readback);
+    }
+    free(b->host);
+}
+
+static void report(const struct bench *b)
+{
+    const struct stage_stats *last = &b->stats[DOWNLOAD];
+    const double total = pl_clock_diff(last->end, b->stats[DECODE].start);
+    printf("%"PRIu64" frames in %.3f s\n", last->frames, total);
+    if (last->frames > 1) {
+        // Measured between completed frames, to exclude pipeline fill latency
+        const double steady = pl_clock_diff(b->last_done, b->first_done);
+        printf("sustained: %.2f fps (%.3f ms/frame)\n",
+               (last->frames - 1) / steady, 1e3 * steady / (last->frames - 1));
+    }
+
+    for (enum stage s = 0; s < NUM_STAGES; s++) {
+        const struct stage_stats *st = &b->stats[s];
+        const double wall = pl_clock_diff(st->end, st->start);
+        const double busy = wall - st->wait;
+        printf("  %-9s %3.0f%% busy, %.3f ms/frame\n", stage_names[s],
+               wall > 0.0 ? 100.0 * busy / wall : 0.0,
+               st->frames ? 1e3 * busy / st->frames : 0.0);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    const char *filename = parse_args(argc, argv);
+    if (!filename)
+        return 1;
+
+    struct bench b = {0};
+    int ret = 1;
+    for (enum stage s = 0; s < NUM_STAGES; s++)
+        queue_init(&b.queues[s]);
+
+    b.log = pl_log_create(PL_API_VER, pl_log_params(
+        .log_cb    = pl_log_color,
+        .log_level = cfg.verbosity,
+    ));
+
+    pl_vulkan vk = pl_vulkan_create(b.log, pl_vulkan_params(
+        .device_name    = cfg.device,
+        .async_transfer = cfg.async_tx,
+        .async_compute  = cfg.async_comp,
+    ));
+    if (!vk) {
+        fprintf(stderr, "Failed creating Vulkan device!\n");
+        goto done;
+    }
+
+    b.gpu = vk->gpu;
+    if (!open_file(&b, filename) || !init_slots(&b))
+        goto done;
+
+    if (pl_thread_create(&b.stats[DECODE].thread, decode_thread, &b) != 0 ||
+        pl_thread_create(&b.stats[UPLOAD].thread, upload_thread, &b) != 0 ||
+        pl_thread_create(&b.stats[RENDER].thread, render_thread, &b) != 0 ||
+        pl_thread_create(&b.stats[DOWNLOAD].thread, download_thread, &b) != 0)
+    {
+        fprintf(stderr, "Failed creating pipeline threads!\n");
+        abort(); // no sane way to tear down the threads already running
+    }
+
+    for (enum stage s = 0; s < NUM_STAGES; s++)
+        pl_thread_join(b.stats[s].thread);
+
+    if (!b.failed) {
+        report(&b);
+        ret = 0;
+    }
+
+done:
+    if (b.gpu) {
+        pl_gpu_finish(b.gpu);
+        uninit_slots(&b);
+    }
+    avcodec_free_context(&b.codec);
+    avformat_close_input(&b.format);
+    pl_avbuffer_pool_destroy(&b.pool);
+    for (enum stage s = 0; s < NUM_STAGES; s++)
+        queue_uninit(&b.queues[s]);
+    pl_vulkan_destroy(&vk);
+    pl_log_destroy(&b.log);
+    return ret;
+}
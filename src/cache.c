@@ -23,25 +23,107 @@
 #include "cache.h"
 #include "log.h"
 #include "pl_thread.h"
+#include "pl_thread_pool.h"
+
+#ifdef PL_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#if defined(PL_HAVE_UNIX) || defined(PL_HAVE_APPLE)
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#define HAVE_MMAP
+#endif
 
 const struct pl_cache_params pl_cache_default_params = {0};
 
-struct priv {
+// Objects are stored in a pool of nodes, linked together (by index) into an
+// intrusive LRU list, ordered from least to most recently inserted. Unused
+// nodes are linked into a separate free list.
+struct node {
+    pl_cache_obj obj;
+    uint64_t hash; // expected checksum if not yet verified, or 0
+    int prev, next; // -1 for none
+};
+
+// Independently locked subset of the cache, selected by key
+struct shard {
     pl_log log;
     pl_mutex lock;
-    PL_ARRAY(pl_cache_obj) objects;
+    PL_ARRAY(struct node) nodes;
+    int head, tail; // oldest/newest object
+    int free;       // head of free list
+    int num_objects;
     size_t total_size;
+    size_t max_total_size;
+
+    // Open-addressing (linear probing) hash table, mapping keys to node
+    // indices. Empty slots are -1. Size is always a power of two.
+    int *index;
+    int index_size;
+};
+
+#define MAX_SHARDS 64
+
+// Memory region referenced (zero-copy) by loaded objects
+struct mapping {
+    uint8_t *data;
+    size_t size;
+    bool mmapped;
+};
+
+struct priv {
+    pl_log log;
+    struct shard *shards;
+    int num_shards; // always a power of two
+
+    pl_mutex lock; // protects `mappings` and `journal`
+    PL_ARRAY(struct mapping) mappings;
+    struct journal *journal;
 };
 
+// Keys are not guaranteed to be well-distributed, so mix them first
+static inline uint64_t key_mix(uint64_t key)
+{
+    key ^= key >> 33;
+    key *= GOLDEN_RATIO_64;
+    return key;
+}
+
+static inline struct shard *get_shard(pl_cache cache, uint64_t key)
+{
+    struct priv *p = PL_PRIV(cache);
+    return &p->shards[key_mix(key) & (p->num_shards - 1)];
+}
+
+static void lock_all(struct priv *p)
+{
+    for (int i = 0; i < p->num_shards; i++)
+        pl_mutex_lock(&p->shards[i].lock);
+}
+
+static void unlock_all(struct priv *p)
+{
+    for (int i = p->num_shards - 1; i >= 0; i--)
+        pl_mutex_unlock(&p->shards[i].lock);
+}
+
 int pl_cache_objects(pl_cache cache)
 {
     if (!cache)
         return 0;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    int num = p->objects.num;
-    pl_mutex_unlock(&p->lock);
+    int num = 0;
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = &p->shards[i];
+        pl_mutex_lock(&s->lock);
+        num += s->num_objects;
+        pl_mutex_unlock(&s->lock);
+    }
     return num;
 }
 
@@ -51,9 +133,13 @@ size_t pl_cache_size(pl_cache cache)
         return 0;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    size_t size = p->total_size;
-    pl_mutex_unlock(&p->lock);
+    size_t size = 0;
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = &p->shards[i];
+        pl_mutex_lock(&s->lock);
+        size += s->total_size;
+        pl_mutex_unlock(&s->lock);
+    }
     return size;
 }
 
@@ -61,31 +147,165 @@ pl_cache pl_cache_create(const struct pl_cache_params *params)
 {
     struct pl_cache_t *cache = pl_zalloc_obj(NULL, cache, struct priv);
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_init(&p->lock);
     if (params) {
         cache->params = *params;
         p->log = params->log;
     }
 
     // Sanitize size limits
+    int num_shards = PL_CLAMP(cache->params.num_shards, 1, MAX_SHARDS);
+    if (!PL_ISPOT(num_shards))
+        num_shards = PL_ALIGN_POT(num_shards);
     size_t total_size  = PL_DEF(cache->params.max_total_size,  SIZE_MAX);
     size_t object_size = PL_DEF(cache->params.max_object_size, SIZE_MAX);
-    object_size = PL_MIN(total_size, object_size);
+    size_t shard_size  = total_size / num_shards;
+    object_size = PL_MIN(shard_size, object_size);
     cache->params.max_total_size  = total_size;
     cache->params.max_object_size = object_size;
+    cache->params.num_shards      = num_shards;
+
+    pl_mutex_init(&p->lock);
+    p->num_shards = num_shards;
+    p->shards = pl_calloc_ptr((void *) cache, num_shards, p->shards);
+    for (int i = 0; i < num_shards; i++) {
+        struct shard *s = &p->shards[i];
+        pl_mutex_init(&s->lock);
+        s->log = p->log;
+        s->head = s->tail = s->free = -1;
+        s->max_total_size = shard_size;
+    }
 
     return cache;
 }
 
-static void remove_obj(pl_cache cache, pl_cache_obj obj)
+static void unmap_file(struct mapping map);
+static void journal_append(struct priv *p, pl_cache_obj obj);
+static void journal_close(struct priv *p);
+
+static inline int index_slot(const struct shard *s, uint64_t key)
 {
-    struct priv *p = PL_PRIV(cache);
+    // Use the upper bits, since the lower bits select the shard
+    return (int) (key_mix(key) >> 32) & (s->index_size - 1);
+}
 
-    p->total_size -= obj.size;
+// Returns the index slot containing `key`, or the empty slot it would go into
+static int index_find(const struct shard *s, uint64_t key)
+{
+    const int mask = s->index_size - 1;
+    int slot = index_slot(s, key);
+    while (s->index[slot] >= 0 && s->nodes.elem[s->index[slot]].obj.key != key)
+        slot = (slot + 1) & mask;
+    return slot;
+}
+
+static void index_remove(struct shard *s, int slot)
+{
+    // Backward-shift deletion, to avoid the need for tombstones
+    const int mask = s->index_size - 1;
+    int hole = slot;
+    for (int i = (slot + 1) & mask; s->index[i] >= 0; i = (i + 1) & mask) {
+        int home = index_slot(s, s->nodes.elem[s->index[i]].obj.key);
+        // Move the entry into the hole if its home slot is not within
+        // the (cyclic) range (hole, i]
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            s->index[hole] = s->index[i];
+            hole = i;
+        }
+    }
+    s->index[hole] = -1;
+}
+
+static void index_grow(pl_cache cache, struct shard *s)
+{
+    int new_size = PL_MAX(s->index_size * 2, 64);
+    pl_free(s->index);
+    s->index = pl_alloc((void *) cache, new_size * sizeof(s->index[0]));
+    s->index_size = new_size;
+    memset(s->index, 0xFF, new_size * sizeof(s->index[0]));
+    for (int n = s->head; n >= 0; n = s->nodes.elem[n].next)
+        s->index[index_find(s, s->nodes.elem[n].obj.key)] = n;
+}
+
+static void lru_unlink(struct shard *s, int n)
+{
+    struct node *node = &s->nodes.elem[n];
+    if (node->prev >= 0) {
+        s->nodes.elem[node->prev].next = node->next;
+    } else {
+        s->head = node->next;
+    }
+    if (node->next >= 0) {
+        s->nodes.elem[node->next].prev = node->prev;
+    } else {
+        s->tail = node->prev;
+    }
+}
+
+// Unlinks a node from the cache entirely, returning its object
+static pl_cache_obj unlink_node(struct shard *s, int slot)
+{
+    int n = s->index[slot];
+    pl_cache_obj obj = s->nodes.elem[n].obj;
+    index_remove(s, slot);
+    lru_unlink(s, n);
+    s->nodes.elem[n] = (struct node) { .prev = -1, .next = s->free };
+    s->free = n;
+    s->num_objects--;
+    s->total_size -= obj.size;
+    return obj;
+}
+
+static void free_obj(pl_cache_obj obj)
+{
     if (obj.free)
         obj.free(obj.data);
 }
 
+static void insert_node(pl_cache cache, struct shard *s, pl_cache_obj obj,
+                        uint64_t hash)
+{
+    if (2 * (s->num_objects + 1) > s->index_size)
+        index_grow(cache, s);
+
+    int n = s->free;
+    if (n >= 0) {
+        s->free = s->nodes.elem[n].next;
+    } else {
+        n = s->nodes.num;
+        PL_ARRAY_APPEND((void *) cache, s->nodes, (struct node) {0});
+    }
+
+    s->nodes.elem[n] = (struct node) {
+        .obj  = obj,
+        .hash = hash,
+        .prev = s->tail,
+        .next = -1,
+    };
+
+    if (s->tail >= 0) {
+        s->nodes.elem[s->tail].next = n;
+    } else {
+        s->head = n;
+    }
+    s->tail = n;
+
+    s->index[index_find(s, obj.key)] = n;
+    s->num_objects++;
+    s->total_size += obj.size;
+}
+
+static void clear_objs(struct shard *s)
+{
+    for (int n = s->head; n >= 0; n = s->nodes.elem[n].next)
+        free_obj(s->nodes.elem[n].obj);
+    s->nodes.num = 0;
+    s->head = s->tail = s->free = -1;
+    s->num_objects = 0;
+    s->total_size = 0;
+    if (s->index)
+        memset(s->index, 0xFF, s->index_size * sizeof(s->index[0]));
+}
+
 void pl_cache_destroy(pl_cache *pcache)
 {
     pl_cache cache = *pcache;
@@ -93,10 +313,13 @@ void pl_cache_destroy(pl_cache *pcache)
          return;
 
     struct priv *p = PL_PRIV(cache);
-    for (int i = 0; i < p->objects.num; i++)
-        remove_obj(cache, p->objects.elem[i]);
-
-    pl_assert(p->total_size == 0);
+    for (int i = 0; i < p->num_shards; i++) {
+        clear_objs(&p->shards[i]);
+        pl_mutex_destroy(&p->shards[i].lock);
+    }
+    journal_close(p);
+    for (int i = 0; i < p->mappings.num; i++)
+        unmap_file(p->mappings.elem[i]);
     pl_mutex_destroy(&p->lock);
     pl_free((void *) cache);
     *pcache = NULL;
@@ -108,50 +331,47 @@ void pl_cache_reset(pl_cache cache)
         return;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    for (int i = 0; i < p->objects.num; i++)
-        remove_obj(cache, p->objects.elem[i]);
-    p->objects.num = 0;
-    pl_assert(p->total_size == 0);
-    pl_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = &p->shards[i];
+        pl_mutex_lock(&s->lock);
+        clear_objs(s);
+        pl_mutex_unlock(&s->lock);
+    }
 }
 
-static bool try_set(pl_cache cache, pl_cache_obj obj)
+// Must be called with `s->lock` held. `hash` is as in `struct node`
+static bool try_set(pl_cache cache, struct shard *s, pl_cache_obj obj,
+                    uint64_t hash)
 {
-    struct priv *p = PL_PRIV(cache);
-
     // Remove any existing entry with this key
-    for (int i = p->objects.num - 1; i >= 0; i--) {
-        pl_cache_obj prev = p->objects.elem[i];
-        if (prev.key == obj.key) {
-            PL_TRACE(p, "Removing out-of-date object 0x%"PRIx64, prev.key);
-            remove_obj(cache, prev);
-            PL_ARRAY_REMOVE_AT(p->objects, i);
-            break;
+    if (s->num_objects) {
+        int slot = index_find(s, obj.key);
+        if (s->index[slot] >= 0) {
+            PL_TRACE(s, "Removing out-of-date object 0x%"PRIx64, obj.key);
+            free_obj(unlink_node(s, slot));
         }
     }
 
     if (!obj.size) {
-        PL_TRACE(p, "Deleted object 0x%"PRIx64, obj.key);
+        PL_TRACE(s, "Deleted object 0x%"PRIx64, obj.key);
         return true;
     }
 
     if (obj.size > cache->params.max_object_size) {
-        PL_DEBUG(p, "Object 0x%"PRIx64" (size %zu) exceeds max size %zu, discarding",
+        PL_DEBUG(s, "Object 0x%"PRIx64" (size %zu) exceeds max size %zu, discarding",
                  obj.key, obj.size, cache->params.max_object_size);
         return false;
     }
 
-    // Make space by deleting old objects
-    while (p->total_size + obj.size > cache->params.max_total_size ||
-           p->objects.num == INT_MAX)
+    // Make space by deleting the least recently used objects
+    while (s->total_size + obj.size > s->max_total_size ||
+           s->num_objects == INT_MAX / 2)
     {
-        pl_assert(p->objects.num);
-        pl_cache_obj old = p->objects.elem[0];
-        PL_TRACE(p, "Removing object 0x%"PRIx64" (size %zu) to make room",
+        pl_assert(s->head >= 0);
+        pl_cache_obj old = s->nodes.elem[s->head].obj;
+        PL_TRACE(s, "Removing object 0x%"PRIx64" (size %zu) to make room",
                  old.key, old.size);
-        remove_obj(cache, old);
-        PL_ARRAY_REMOVE_AT(p->objects, 0);
+        free_obj(unlink_node(s, index_find(s, old.key)));
     }
 
     if (!obj.free) {
@@ -159,9 +379,8 @@ static bool try_set(pl_cache cache, pl_cache_obj obj)
         obj.free = pl_free;
     }
 
-    PL_TRACE(p, "Inserting new object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
-    PL_ARRAY_APPEND((void *) cache, p->objects, obj);
-    p->total_size += obj.size;
+    PL_TRACE(s, "Inserting new object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
+    insert_node(cache, s, obj, hash);
     return true;
 }
 
@@ -177,9 +396,12 @@ bool pl_cache_try_set(pl_cache cache, pl_cache_obj *pobj)
 
     pl_cache_obj obj = *pobj;
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    bool ok = try_set(cache, obj);
-    pl_mutex_unlock(&p->lock);
+    struct shard *s = get_shard(cache, obj.key);
+    pl_mutex_lock(&s->lock);
+    bool ok = try_set(cache, s, obj, 0);
+    if (ok && p->journal)
+        journal_append(p, obj); // under `s->lock` to preserve ordering
+    pl_mutex_unlock(&s->lock);
     if (ok) {
         *pobj = strip_obj(obj); // ownership transfers, clear ptr
     } else {
@@ -210,23 +432,29 @@ bool pl_cache_get(pl_cache cache, pl_cache_obj *out_obj)
     if (!cache)
         goto fail;
 
-    struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
+    struct shard *s = get_shard(cache, key);
+    pl_mutex_lock(&s->lock);
 
-    // Search backwards to prioritize recently added entries
-    for (int i = p->objects.num - 1; i >= 0; i--) {
-        pl_cache_obj obj = p->objects.elem[i];
-        if (obj.key == key) {
-            PL_ARRAY_REMOVE_AT(p->objects, i);
-            p->total_size -= obj.size;
-            pl_mutex_unlock(&p->lock);
+    if (s->num_objects) {
+        int slot = index_find(s, key);
+        if (s->index[slot] >= 0) {
+            const uint64_t hash = s->nodes.elem[s->index[slot]].hash;
+            pl_cache_obj obj = unlink_node(s, slot);
+            pl_mutex_unlock(&s->lock);
             pl_assert(obj.free);
+            if (hash && pl_mem_hash(obj.data, obj.size) != hash) {
+                PL_WARN(s, "Cache object 0x%"PRIx64" seems corrupt, checksum "
+                        "mismatch.. discarding", key);
+                free_obj(obj);
+                goto miss;
+            }
             *out_obj = obj;
             return true;
         }
     }
 
-    pl_mutex_unlock(&p->lock);
+    pl_mutex_unlock(&s->lock);
+miss:
     if (!cache->params.get)
         goto fail;
 
@@ -253,10 +481,13 @@ void pl_cache_iterate(pl_cache cache,
         return;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
-    for (int i = 0; i < p->objects.num; i++)
-        cb(priv, p->objects.elem[i]);
-    pl_mutex_unlock(&p->lock);
+    for (int i = 0; i < p->num_shards; i++) {
+        struct shard *s = &p->shards[i];
+        pl_mutex_lock(&s->lock);
+        for (int n = s->head; n >= 0; n = s->nodes.elem[n].next)
+            cb(priv, s->nodes.elem[n].obj);
+        pl_mutex_unlock(&s->lock);
+    }
 }
 
 // --- Saving/loading
@@ -265,6 +496,10 @@ void pl_cache_iterate(pl_cache cache,
 #define CACHE_VERSION 1
 #define PAD_ALIGN(x)  PL_ALIGN2(x, sizeof(uint32_t))
 
+// Caches containing compressed objects. Each entry is followed by the size of
+// the decompressed object, or 0 if the object is stored uncompressed.
+#define CACHE_VERSION_ZSTD 2
+
 struct __attribute__((__packed__)) cache_header {
     char     magic[8];
     uint32_t version;
@@ -279,6 +514,67 @@ struct __attribute__((__packed__)) cache_entry {
 
 pl_static_assert(sizeof(struct cache_header) % alignof(struct cache_entry) == 0);
 
+// Journals have no fixed number of entries, and are instead read until EOF.
+// Entries of size 0 (tombstones) delete previously written objects.
+#define JOURNAL_ENTRIES UINT32_MAX
+
+// Below this total size, spreading work over threads is not worth it
+#define PARALLEL_MIN_SIZE (1 << 20)
+
+// `raw_size` is only written for CACHE_VERSION_ZSTD, and may be NULL otherwise
+static void write_obj(void (*write)(void *priv, size_t size, const void *ptr),
+                      void *priv, pl_cache_obj obj, uint64_t hash,
+                      const uint64_t *raw_size)
+{
+    static const uint8_t padding[PAD_ALIGN(1)] = {0};
+    write(priv, sizeof(struct cache_entry), &(struct cache_entry) {
+        .key  = obj.key,
+        .size = obj.size,
+        .hash = hash,
+    });
+    if (raw_size)
+        write(priv, sizeof(*raw_size), raw_size);
+    write(priv, obj.size, obj.data);
+    write(priv, PAD_ALIGN(obj.size) - obj.size, padding);
+}
+
+struct save_entry {
+    pl_cache_obj obj;
+    uint64_t hash;  // of the stored data, or 0 if not yet known
+    void *packed;   // compressed data, or NULL to store `obj` as-is
+    size_t packed_size;
+};
+
+struct save_ctx {
+    struct save_entry *entries;
+    bool compress;
+};
+
+static void prepare_save(void *priv, int i)
+{
+    struct save_ctx *ctx = priv;
+    struct save_entry *e = &ctx->entries[i];
+
+#ifdef PL_HAVE_ZSTD
+    if (ctx->compress) {
+        size_t bound = ZSTD_compressBound(e->obj.size);
+        e->packed = pl_alloc(NULL, bound);
+        size_t size = ZSTD_compress(e->packed, bound, e->obj.data, e->obj.size,
+                                    ZSTD_CLEVEL_DEFAULT);
+        // Only store objects compressed if this saves a meaningful amount
+        if (!ZSTD_isError(size) && size < e->obj.size - e->obj.size / 8) {
+            e->packed_size = size;
+            e->hash = pl_mem_hash(e->packed, size);
+            return;
+        }
+        pl_free_ptr(&e->packed);
+    }
+#endif
+
+    if (!e->hash)
+        e->hash = pl_mem_hash(e->obj.data, e->obj.size);
+}
+
 int pl_cache_save_ex(pl_cache cache,
                      void (*write)(void *priv, size_t size, const void *ptr),
                      void *priv)
@@ -287,38 +583,202 @@ int pl_cache_save_ex(pl_cache cache,
         return 0;
 
     struct priv *p = PL_PRIV(cache);
-    pl_mutex_lock(&p->lock);
+    lock_all(p);
     pl_clock_t start = pl_clock_now();
 
-    const int num_objects = p->objects.num;
-    const size_t saved_bytes = p->total_size;
+    int num_objects = 0;
+    size_t saved_bytes = 0;
+    for (int i = 0; i < p->num_shards; i++) {
+        num_objects += p->shards[i].num_objects;
+        saved_bytes += p->shards[i].total_size;
+    }
+
+    struct save_ctx ctx = {
+        .entries = pl_calloc_ptr(NULL, num_objects, ctx.entries),
+#ifdef PL_HAVE_ZSTD
+        .compress = cache->params.compress,
+#endif
+    };
+
+    int num = 0;
+    for (int i = 0; i < p->num_shards; i++) {
+        const struct shard *s = &p->shards[i];
+        for (int n = s->head; n >= 0; n = s->nodes.elem[n].next) {
+            ctx.entries[num++] = (struct save_entry) {
+                .obj  = s->nodes.elem[n].obj,
+                .hash = s->nodes.elem[n].hash,
+            };
+        }
+    }
+    pl_assert(num == num_objects);
+
+    // Hash (and compress) all objects up-front, since this can be done in
+    // parallel. The objects stay valid while all shards are locked.
+    if (saved_bytes >= PARALLEL_MIN_SIZE) {
+        pl_parallel_for(num_objects, prepare_save, &ctx);
+    } else {
+        for (int i = 0; i < num_objects; i++)
+            prepare_save(&ctx, i);
+    }
+
     write(priv, sizeof(struct cache_header), &(struct cache_header) {
         .magic       = CACHE_MAGIC,
-        .version     = CACHE_VERSION,
+        .version     = ctx.compress ? CACHE_VERSION_ZSTD : CACHE_VERSION,
         .num_entries = num_objects,
     });
 
+    size_t packed_bytes = 0;
     for (int i = 0; i < num_objects; i++) {
-        pl_cache_obj obj = p->objects.elem[i];
-        PL_TRACE(p, "Saving object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
-        write(priv, sizeof(struct cache_entry), &(struct cache_entry) {
-            .key  = obj.key,
-            .size = obj.size,
-            .hash = pl_mem_hash(obj.data, obj.size),
-        });
-        static const uint8_t padding[PAD_ALIGN(1)] = {0};
-        write(priv, obj.size, obj.data);
-        write(priv, PAD_ALIGN(obj.size) - obj.size, padding);
+        const struct save_entry *e = &ctx.entries[i];
+        pl_cache_obj obj = e->obj;
+        uint64_t raw_size = 0;
+        if (e->packed) {
+            PL_TRACE(p, "Saving object 0x%"PRIx64" (size %zu, compressed %zu)",
+                     obj.key, obj.size, e->packed_size);
+            raw_size = obj.size;
+            obj.data = e->packed;
+            obj.size = e->packed_size;
+        } else {
+            PL_TRACE(p, "Saving object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
+        }
+        write_obj(write, priv, obj, e->hash, ctx.compress ? &raw_size : NULL);
+        packed_bytes += obj.size;
+        pl_free(e->packed);
     }
 
-    pl_mutex_unlock(&p->lock);
+    unlock_all(p);
+    pl_free(ctx.entries);
     pl_log_cpu_time(p->log, start, pl_clock_now(), "saving cache");
-    if (num_objects)
+    if (num_objects && ctx.compress) {
+        PL_DEBUG(p, "Saved %d objects, totalling %zu bytes (compressed to %zu)",
+                 num_objects, saved_bytes, packed_bytes);
+    } else if (num_objects) {
         PL_DEBUG(p, "Saved %d objects, totalling %zu bytes", num_objects, saved_bytes);
+    }
 
     return num_objects;
 }
 
+// Returns 1 if the header is valid, 0 if it should be skipped, or a negative
+// number on error
+static int check_header(struct priv *p, const struct cache_header *header)
+{
+    if (memcmp(header->magic, CACHE_MAGIC, sizeof(header->magic)) != 0) {
+        PL_ERR(p, "Failed loading cache: invalid magic bytes");
+        return -1;
+    }
+    bool version_ok = header->version == CACHE_VERSION;
+#ifdef PL_HAVE_ZSTD
+    version_ok |= header->version == CACHE_VERSION_ZSTD;
+#endif
+    if (!version_ok) {
+        PL_INFO(p, "Failed loading cache: wrong version... skipping");
+        return 0;
+    }
+    if (header->num_entries > INT_MAX && header->num_entries != JOURNAL_ENTRIES) {
+        PL_ERR(p, "Failed loading cache: %"PRIu32" entries overflows int",
+               header->num_entries);
+        return 0;
+    }
+
+    return 1;
+}
+
+struct load_entry {
+    pl_cache_obj obj; // zero-sized for deleted objects
+    uint64_t hash;    // expected checksum, reset to 0 once verified
+    uint64_t raw_size; // decompressed size, or 0 if stored uncompressed
+    bool ok;
+};
+
+struct load_ctx {
+    struct load_entry *entries;
+    bool lazy;
+};
+
+static void prepare_entry(void *priv, int i)
+{
+    struct load_ctx *ctx = priv;
+    struct load_entry *e = &ctx->entries[i];
+    e->ok = true;
+    if (!e->obj.size || (ctx->lazy && !e->raw_size))
+        return; // verified on first use, if at all
+
+    e->ok = pl_mem_hash(e->obj.data, e->obj.size) == e->hash;
+    e->hash = 0;
+
+#ifdef PL_HAVE_ZSTD
+    if (e->ok && e->raw_size) {
+        // The frame header is covered by the checksum, unlike `raw_size`
+        unsigned long long size = ZSTD_getFrameContentSize(e->obj.data, e->obj.size);
+        e->ok = size == e->raw_size && size <= SIZE_MAX;
+        void *buf = e->ok ? pl_alloc(NULL, size) : NULL;
+        if (buf) {
+            size = ZSTD_decompress(buf, size, e->obj.data, e->obj.size);
+            e->ok = !ZSTD_isError(size) && size == e->raw_size;
+        }
+
+        free_obj(e->obj);
+        e->obj = (pl_cache_obj) {
+            .key  = e->obj.key,
+            .data = buf,
+            .size = buf ? e->raw_size : 0,
+            .free = buf ? pl_free : NULL,
+        };
+    }
+#else
+    pl_assert(!e->raw_size);
+#endif
+}
+
+// Verifies and decompresses all loaded entries (unless deferred), and then
+// inserts them in order, up to the first corrupt entry. Takes over ownership
+// of all objects. Returns the number of objects inserted.
+static int insert_loaded(pl_cache cache, struct load_entry *entries, int num,
+                         size_t total_size, size_t *loaded_bytes)
+{
+    struct priv *p = PL_PRIV(cache);
+    struct load_ctx ctx = {
+        .entries = entries,
+        .lazy    = cache->params.lazy_verify,
+    };
+
+    if (total_size >= PARALLEL_MIN_SIZE) {
+        pl_parallel_for(num, prepare_entry, &ctx);
+    } else {
+        for (int i = 0; i < num; i++)
+            prepare_entry(&ctx, i);
+    }
+
+    int i, num_loaded = 0;
+    for (i = 0; i < num; i++) {
+        pl_cache_obj obj = entries[i].obj;
+        if (!entries[i].ok) {
+            PL_WARN(p, "Cache entry seems corrupt, checksum mismatch.. ignoring rest");
+            break;
+        }
+
+        PL_TRACE(p, "Loading object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
+        struct shard *s = get_shard(cache, obj.key);
+        pl_mutex_lock(&s->lock);
+        bool ok = try_set(cache, s, obj, entries[i].hash);
+        pl_mutex_unlock(&s->lock);
+        if (!obj.size)
+            continue;
+
+        if (ok) {
+            num_loaded++;
+            *loaded_bytes += obj.size;
+        } else {
+            free_obj(obj);
+        }
+    }
+
+    for (; i < num; i++)
+        free_obj(entries[i].obj);
+    return num_loaded;
+}
+
 int pl_cache_load_ex(pl_cache cache,
                      bool (*read)(void *priv, size_t size, void *ptr),
                      void *priv)
@@ -332,75 +792,73 @@ int pl_cache_load_ex(pl_cache cache,
         PL_ERR(p, "Failed loading cache: file seems empty or truncated");
         return -1;
     }
-    if (memcmp(header.magic, CACHE_MAGIC, sizeof(header.magic)) != 0) {
-        PL_ERR(p, "Failed loading cache: invalid magic bytes");
-        return -1;
-    }
-    if (header.version != CACHE_VERSION) {
-        PL_INFO(p, "Failed loading cache: wrong version... skipping");
-        return 0;
-    }
-    if (header.num_entries > INT_MAX) {
-        PL_ERR(p, "Failed loading cache: %"PRIu32" entries overflows int",
-               header.num_entries);
-        return 0;
-    }
 
-    int num_loaded = 0;
-    size_t loaded_bytes = 0;
-    pl_mutex_lock(&p->lock);
+    int ret = check_header(p, &header);
+    if (ret <= 0)
+        return ret;
+
+    PL_ARRAY(struct load_entry) entries = {0};
+    size_t total_size = 0, loaded_bytes = 0;
     pl_clock_t start = pl_clock_now();
 
-    for (int i = 0; i < header.num_entries; i++) {
+    // Read all entries first, so their checksums can be verified in parallel
+    const bool journal = header.num_entries == JOURNAL_ENTRIES;
+    const bool packed = header.version == CACHE_VERSION_ZSTD;
+    for (int i = 0; journal || i < header.num_entries; i++) {
         struct cache_entry entry;
         if (!read(priv, sizeof(entry), &entry)) {
+            if (journal)
+                break; // end of journal
             PL_WARN(p, "Cache seems truncated, missing objects.. ignoring rest");
-            goto error;
+            break;
+        }
+
+        uint64_t raw_size = 0;
+        if (packed && !read(priv, sizeof(raw_size), &raw_size)) {
+            PL_WARN(p, "Cache seems truncated, missing objects.. ignoring rest");
+            break;
         }
 
         if (entry.size > SIZE_MAX) {
             PL_WARN(p, "Cache object size %"PRIu64" overflows SIZE_MAX.. "
                     "suspect broken file, ignoring rest", entry.size);
-            goto error;
+            break;
+        }
+
+        if (!entry.size) {
+            PL_ARRAY_APPEND(NULL, entries, (struct load_entry) {
+                .obj.key = entry.key,
+            });
+            continue;
         }
 
         void *buf = pl_alloc(NULL, PAD_ALIGN(entry.size));
         if (!read(priv, PAD_ALIGN(entry.size), buf)) {
             PL_WARN(p, "Cache seems truncated, missing objects.. ignoring rest");
             pl_free(buf);
-            goto error;
-        }
-
-        uint64_t checksum = pl_mem_hash(buf, entry.size);
-        if (checksum != entry.hash) {
-            PL_WARN(p, "Cache entry seems corrupt, checksum mismatch.. ignoring rest");
-            pl_free(buf);
-            goto error;
+            break;
         }
 
-        pl_cache_obj obj = {
-            .key  = entry.key,
-            .size = entry.size,
-            .data = buf,
-            .free = pl_free,
-        };
-
-        PL_TRACE(p, "Loading object 0x%"PRIx64" (size %zu)", obj.key, obj.size);
-        if (try_set(cache, obj)) {
-            num_loaded++;
-            loaded_bytes += entry.size;
-        } else {
-            pl_free(buf);
-        }
+        PL_ARRAY_APPEND(NULL, entries, (struct load_entry) {
+            .obj = {
+                .key  = entry.key,
+                .size = entry.size,
+                .data = buf,
+                .free = pl_free,
+            },
+            .hash     = entry.hash,
+            .raw_size = raw_size,
+        });
+        total_size += entry.size;
     }
 
+    int num_loaded = insert_loaded(cache, entries.elem, entries.num, total_size,
+                                   &loaded_bytes);
+    pl_free(entries.elem);
+
     pl_log_cpu_time(p->log, start, pl_clock_now(), "loading cache");
     if (num_loaded)
         PL_DEBUG(p, "Loaded %d objects, totalling %zu bytes", num_loaded, loaded_bytes);
-
-    // fall through
-error:
-    pl_mutex_unlock(&p->lock);
     return num_loaded;
 }
 
@@ -445,3 +903,393 @@ int pl_cache_load(pl_cache cache, const uint8_t *data, size_t size)
         .size = size,
     });
 }
+
+// Zero-copy loading
+
+int pl_cache_load_static(pl_cache cache, const uint8_t *data, size_t size)
+{
+    if (!cache)
+        return 0;
+
+    struct priv *p = PL_PRIV(cache);
+    struct cache_header header;
+    if (size < sizeof(header)) {
+        PL_ERR(p, "Failed loading cache: file seems empty or truncated");
+        return -1;
+    }
+
+    memcpy(&header, data, sizeof(header));
+    int ret = check_header(p, &header);
+    if (ret <= 0)
+        return ret;
+
+    PL_ARRAY(struct load_entry) entries = {0};
+    size_t total_size = 0, loaded_bytes = 0;
+    size_t pos = sizeof(header);
+    pl_clock_t start = pl_clock_now();
+
+    // Scan the index first, so the checksums can be verified in parallel
+    const bool journal = header.num_entries == JOURNAL_ENTRIES;
+    const bool packed = header.version == CACHE_VERSION_ZSTD;
+    const size_t entry_size = sizeof(struct cache_entry) + packed * sizeof(uint64_t);
+    for (int i = 0; journal || i < header.num_entries; i++) {
+        struct cache_entry entry;
+        uint64_t raw_size = 0;
+        if (journal && pos == size)
+            break; // end of journal
+        if (size - pos < entry_size) {
+            PL_WARN(p, "Cache seems truncated, missing objects.. ignoring rest");
+            break;
+        }
+
+        memcpy(&entry, data + pos, sizeof(entry));
+        if (packed)
+            memcpy(&raw_size, data + pos + sizeof(entry), sizeof(raw_size));
+        pos += entry_size;
+        if (entry.size > size - pos || PAD_ALIGN(entry.size) > size - pos) {
+            PL_WARN(p, "Cache seems truncated, missing objects.. ignoring rest");
+            break;
+        }
+
+        PL_ARRAY_APPEND(NULL, entries, (struct load_entry) {
+            .obj = {
+                .key  = entry.key,
+                .size = entry.size,
+                .data = entry.size ? (void *) (data + pos) : NULL,
+                .free = entry.size ? noop : NULL,
+            },
+            .hash     = entry.hash,
+            .raw_size = raw_size,
+        });
+        total_size += entry.size;
+        pos += PAD_ALIGN(entry.size);
+    }
+
+    int num_loaded = insert_loaded(cache, entries.elem, entries.num, total_size,
+                                   &loaded_bytes);
+    pl_free(entries.elem);
+
+    pl_log_cpu_time(p->log, start, pl_clock_now(), "loading cache");
+    if (num_loaded)
+        PL_DEBUG(p, "Loaded %d objects, totalling %zu bytes (zero-copy)",
+                 num_loaded, loaded_bytes);
+    return num_loaded;
+}
+
+static bool map_file(struct priv *p, const char *path, struct mapping *out)
+{
+#ifdef HAVE_MMAP
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        PL_ERR(p, "Failed opening cache file '%s': %s", path, strerror(errno));
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0 || st.st_size > SIZE_MAX) {
+        PL_ERR(p, "Failed loading cache file '%s': file seems empty", path);
+        close(fd);
+        return false;
+    }
+
+    void *ptr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (ptr == MAP_FAILED) {
+        PL_ERR(p, "Failed mapping cache file '%s': %s", path, strerror(errno));
+        return false;
+    }
+
+    *out = (struct mapping) {
+        .data    = ptr,
+        .size    = st.st_size,
+        .mmapped = true,
+    };
+    return true;
+#else
+    // No mmap() support, fall back to reading the file into a single buffer
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        PL_ERR(p, "Failed opening cache file '%s'", path);
+        return false;
+    }
+
+    pl_str buf = {0};
+    uint8_t chunk[1 << 16];
+    size_t len;
+    while ((len = fread(chunk, 1, sizeof(chunk), file)) > 0)
+        pl_str_append(NULL, &buf, (pl_str) { chunk, len });
+    fclose(file);
+
+    *out = (struct mapping) {
+        .data = buf.buf,
+        .size = buf.len,
+    };
+    return true;
+#endif
+}
+
+static void unmap_file(struct mapping map)
+{
+#ifdef HAVE_MMAP
+    if (map.mmapped) {
+        munmap(map.data, map.size);
+        return;
+    }
+#endif
+    pl_free(map.data);
+}
+
+int pl_cache_load_mmap(pl_cache cache, const char *path)
+{
+    if (!cache)
+        return 0;
+
+    struct priv *p = PL_PRIV(cache);
+    struct mapping map;
+    if (!map_file(p, path, &map))
+        return -1;
+
+    int ret = pl_cache_load_static(cache, map.data, map.size);
+    if (ret <= 0) {
+        unmap_file(map);
+        return ret;
+    }
+
+    // Loaded objects reference the mapping, so keep it alive until destroyed
+    pl_mutex_lock(&p->lock);
+    PL_ARRAY_APPEND((void *) cache, p->mappings, map);
+    pl_mutex_unlock(&p->lock);
+    return ret;
+}
+
+// Append-only journal
+
+struct journal_entry {
+    uint64_t key;
+    uint64_t hash; // 0 for deleted objects
+    bool used;
+};
+
+struct journal {
+    FILE *file;
+    char *path;
+
+    // Open-addressing hash table of objects currently in the journal, used to
+    // avoid re-appending objects which were merely looked up and re-inserted
+    struct journal_entry *entries;
+    int num_entries;
+    int size;
+};
+
+static struct journal_entry *journal_find(struct journal *j, uint64_t key)
+{
+    const int mask = j->size - 1;
+    int slot = (int) (key_mix(key) >> 32) & mask;
+    while (j->entries[slot].used && j->entries[slot].key != key)
+        slot = (slot + 1) & mask;
+    return &j->entries[slot];
+}
+
+static void journal_add(struct journal *j, uint64_t key, uint64_t hash)
+{
+    if (2 * (j->num_entries + 1) > j->size) {
+        struct journal_entry *old = j->entries;
+        const int old_size = j->size;
+        j->size = PL_MAX(old_size * 2, 64);
+        j->entries = pl_calloc_ptr(j, j->size, j->entries);
+        j->num_entries = 0;
+        for (int i = 0; i < old_size; i++) {
+            if (old[i].used)
+                journal_add(j, old[i].key, old[i].hash);
+        }
+        pl_free(old);
+    }
+
+    struct journal_entry *e = journal_find(j, key);
+    if (!e->used) {
+        *e = (struct journal_entry) { .key = key, .used = true };
+        j->num_entries++;
+    }
+    e->hash = hash;
+}
+
+static uint64_t journal_hash(pl_cache_obj obj)
+{
+    if (!obj.size)
+        return 0;
+    uint64_t hash = pl_mem_hash(obj.data, obj.size);
+    return hash ? hash : 1; // avoid confusion with deleted objects
+}
+
+static void write_file(void *priv, size_t size, const void *ptr)
+{
+    struct journal *j = priv;
+    if (j->file && size && fwrite(ptr, 1, size, j->file) != size) {
+        fclose(j->file);
+        j->file = NULL;
+    }
+}
+
+static void journal_append(struct priv *p, pl_cache_obj obj)
+{
+    pl_mutex_lock(&p->lock);
+    struct journal *j = p->journal;
+    if (!j || !j->file)
+        goto done;
+
+    // Skip objects that are already present in identical form, and deletions
+    // of objects not present in the journal
+    uint64_t hash = journal_hash(obj);
+    const struct journal_entry *e = journal_find(j, obj.key);
+    if (e->used ? e->hash == hash : !hash)
+        goto done;
+
+    PL_TRACE(p, "Appending %s 0x%"PRIx64" (size %zu) to journal",
+             obj.size ? "object" : "tombstone", obj.key, obj.size);
+    journal_add(j, obj.key, hash);
+    write_obj(write_file, j, obj, hash, NULL);
+    if (!j->file || fflush(j->file) != 0)
+        PL_ERR(p, "Failed writing to cache journal '%s', disabling", j->path);
+
+    // fall through
+done:
+    pl_mutex_unlock(&p->lock);
+}
+
+// Must be called with all locks held
+static bool journal_compact(pl_cache cache, struct journal *j)
+{
+    struct priv *p = PL_PRIV(cache);
+    pl_clock_t start = pl_clock_now();
+    if (j->file)
+        fclose(j->file);
+
+    pl_free(j->entries);
+    j->size = 64;
+    j->num_entries = 0;
+    j->entries = pl_calloc_ptr(j, j->size, j->entries);
+
+    char *tmp_path = pl_asprintf(j, "%s.tmp", j->path);
+    j->file = fopen(tmp_path, "wb");
+    if (!j->file) {
+        PL_ERR(p, "Failed opening cache journal '%s' for writing", tmp_path);
+        goto error;
+    }
+
+    int num_objects = 0;
+    write_file(j, sizeof(struct cache_header), &(struct cache_header) {
+        .magic       = CACHE_MAGIC,
+        .version     = CACHE_VERSION,
+        .num_entries = JOURNAL_ENTRIES,
+    });
+
+    for (int i = 0; i < p->num_shards; i++) {
+        const struct shard *s = &p->shards[i];
+        for (int n = s->head; n >= 0; n = s->nodes.elem[n].next) {
+            pl_cache_obj obj = s->nodes.elem[n].obj;
+            uint64_t hash = journal_hash(obj);
+            journal_add(j, obj.key, hash);
+            write_obj(write_file, j, obj, hash, NULL);
+            num_objects++;
+        }
+    }
+
+    if (!j->file || fclose(j->file) != 0) {
+        j->file = NULL;
+        PL_ERR(p, "Failed writing cache journal '%s'", tmp_path);
+        goto error;
+    }
+
+#ifdef PL_HAVE_WIN32
+    remove(j->path); // rename() does not overwrite existing files
+#endif
+    if (rename(tmp_path, j->path) != 0) {
+        PL_ERR(p, "Failed renaming '%s' to '%s'", tmp_path, j->path);
+        j->file = NULL;
+        goto error;
+    }
+
+    j->file = fopen(j->path, "ab");
+    if (!j->file) {
+        PL_ERR(p, "Failed re-opening cache journal '%s'", j->path);
+        goto error;
+    }
+
+    pl_free(tmp_path);
+    pl_log_cpu_time(p->log, start, pl_clock_now(), "compacting cache journal");
+    PL_DEBUG(p, "Compacted cache journal '%s' to %d objects", j->path, num_objects);
+    return true;
+
+error:
+    remove(tmp_path);
+    pl_free(tmp_path);
+    return false;
+}
+
+static void journal_close(struct priv *p)
+{
+    struct journal *j = p->journal;
+    if (!j)
+        return;
+
+    if (j->file)
+        fclose(j->file);
+    pl_free(j);
+    p->journal = NULL;
+}
+
+bool pl_cache_journal_open(pl_cache cache, const char *path)
+{
+    if (!cache)
+        return false;
+
+    struct priv *p = PL_PRIV(cache);
+    FILE *file = fopen(path, "rb");
+    if (file) {
+        if (pl_cache_load_file(cache, file) < 0)
+            PL_WARN(p, "Cache journal '%s' seems invalid, discarding", path);
+        fclose(file);
+    }
+
+    lock_all(p);
+    pl_mutex_lock(&p->lock);
+    journal_close(p);
+    struct journal *j = pl_zalloc_ptr(NULL, j);
+    j->path = pl_strdup0(j, pl_str0(path));
+    bool ok = journal_compact(cache, j);
+    if (ok) {
+        p->journal = j;
+    } else {
+        journal_close(&(struct priv) { .journal = j });
+    }
+    pl_mutex_unlock(&p->lock);
+    unlock_all(p);
+    return ok;
+}
+
+bool pl_cache_journal_compact(pl_cache cache)
+{
+    if (!cache)
+        return false;
+
+    struct priv *p = PL_PRIV(cache);
+    lock_all(p);
+    pl_mutex_lock(&p->lock);
+    bool ok = p->journal && journal_compact(cache, p->journal);
+    pl_mutex_unlock(&p->lock);
+    unlock_all(p);
+    return ok;
+}
+
+void pl_cache_journal_close(pl_cache cache)
+{
+    if (!cache)
+        return;
+
+    struct priv *p = PL_PRIV(cache);
+    lock_all(p);
+    pl_mutex_lock(&p->lock);
+    journal_close(p);
+    pl_mutex_unlock(&p->lock);
+    unlock_all(p);
+}
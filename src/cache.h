@@ -62,11 +62,17 @@ static inline void pl_cache_obj_resize(void *alloc, pl_cache_obj *obj, size_t si
 enum {
     CACHE_KEY_SH_LUT    = UINT64_C(0x2206183d320352c6), // sh_lut cache
     CACHE_KEY_ICC_3DLUT = UINT64_C(0xff703a6dd8a996f6), // ICC 3dlut
+    CACHE_KEY_ICC_INFO  = UINT64_C(0x5d1e83b0c47a92e3), // ICC detection results
     CACHE_KEY_DITHER    = UINT64_C(0x6fed75eb6dce86cb), // dither matrix
     CACHE_KEY_H274      = UINT64_C(0x2fb9adca04b42c4d), // H.274 film grain DB
+    CACHE_KEY_FILTER    = UINT64_C(0x9a3c1b55e07d264f), // pl_filter weights
     CACHE_KEY_GAMUT_LUT = UINT64_C(0x6109e47f15d478b1), // gamut mapping 3DLUT
+    CACHE_KEY_CUBE_LUT  = UINT64_C(0x8d2e61c4b35f09a7), // parsed .cube LUT data
+    CACHE_KEY_WG_SIZE   = UINT64_C(0xc32e70bbbe3f31c5), // tuned compute group size
     CACHE_KEY_SPIRV     = UINT64_C(0x32352f6605ff60a7), // bare SPIR-V module
     CACHE_KEY_VK_PIPE   = UINT64_C(0x4bdab2817ad02ad4), // VkPipelineCache
+    CACHE_KEY_VK_FMTS   = UINT64_C(0x1c9f3e8a76d2b405), // vulkan format probing
     CACHE_KEY_GL_PROG   = UINT64_C(0x4274c309f4f0477b), // GL_ARB_get_program_binary
     CACHE_KEY_D3D_DXBC  = UINT64_C(0x807668516811d3bc), // DXBC bytecode
+    CACHE_KEY_D3D_HLSL  = UINT64_C(0xef4246f4528902d4), // SPIRV-Cross output
 };
@@ -0,0 +1,545 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <math.h>
+
+#include "common.h"
+#include "gamut_mapping.h"
+#include "pl_thread_pool.h"
+
+#include <libplacebo/colorspace.h>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Common constants for ARIB STD-B67 (HLG)
+static const float HLG_A = 0.17883277,
+                   HLG_B = 0.28466892,
+                   HLG_C = 0.55991073,
+                   HLG_REF = 1000.0 / PL_COLOR_SDR_WHITE;
+
+// Common constants for Panasonic V-Log
+static const float VLOG_B = 0.00873,
+                   VLOG_C = 0.241514,
+                   VLOG_D = 0.598206;
+
+// Common constants for Sony S-Log
+static const float SLOG_A = 0.432699,
+                   SLOG_B = 0.037584,
+                   SLOG_C = 0.616596 + 0.03,
+                   SLOG_P = 3.538813,
+                   SLOG_Q = 0.030001,
+                   SLOG_K2 = 155.0 / 219.0;
+
+// Target number of pixels per slice handed to the thread pool
+#define SLICE_PIXELS (1 << 16)
+
+struct convert_ctx {
+    const struct pl_color_cpu_params *params;
+
+    // Decoding matrix, including the normalization of integer inputs
+    float m[3][3], c[3];
+
+    // Linear light RGB->RGB matrix, applied after linearization
+    float lin[3][3];
+    bool lin_identity;
+
+    // HLG OOTF, which is applied per pixel in between the two matrices
+    bool ootf;
+    float ootf_peak, ootf_gamma, luma[3];
+
+    int slice_rows;
+    float lut[PQ_LUT_SIZE + 1];
+};
+
+// Same as `pl_shader_linearize`, excluding the HLG OOTF
+static float linearize(float x, enum pl_color_transfer trc,
+                       float csp_min, float csp_max)
+{
+    switch (trc) {
+    case PL_COLOR_TRC_SRGB:
+        x = x > 0.04045f ? powf((x + 0.055f) / 1.055f, 2.4f) : x / 12.92f;
+        goto scale_out;
+    case PL_COLOR_TRC_BT_1886: {
+        const float lb = powf(csp_min, 1/2.4f);
+        const float lw = powf(csp_max, 1/2.4f);
+        const float a = powf(lw - lb, 2.4f);
+        const float b = lb / (lw - lb);
+        return a * powf(x + b, 2.4f);
+    }
+    case PL_COLOR_TRC_GAMMA18:   x = powf(x, 1.8f); goto scale_out;
+    case PL_COLOR_TRC_GAMMA20:   x = powf(x, 2.0f); goto scale_out;
+    case PL_COLOR_TRC_UNKNOWN:
+    case PL_COLOR_TRC_GAMMA22:   x = powf(x, 2.2f); goto scale_out;
+    case PL_COLOR_TRC_GAMMA24:   x = powf(x, 2.4f); goto scale_out;
+    case PL_COLOR_TRC_GAMMA26:   x = powf(x, 2.6f); goto scale_out;
+    case PL_COLOR_TRC_GAMMA28:   x = powf(x, 2.8f); goto scale_out;
+    case PL_COLOR_TRC_PRO_PHOTO:
+        x = x > 0.03125f ? powf(x, 1.8f) : x / 16.0f;
+        goto scale_out;
+    case PL_COLOR_TRC_ST428:
+        x = 52.37f / 48.0f * powf(x, 2.6f);
+        goto scale_out;
+    case PL_COLOR_TRC_LINEAR:
+        return x;
+    case PL_COLOR_TRC_HLG: {
+        const float y = fmaxf(1.2f + 0.42f * log10f(csp_max / HLG_REF), 1);
+        const float b = sqrtf(3 * powf(csp_min / csp_max, 1 / y));
+        x = (1 - b) * x + b;
+        x = x > 0.5f ? expf((x - HLG_C) / HLG_A) + HLG_B : 4 * x * x;
+        return x / 12.0f;
+    }
+    case PL_COLOR_TRC_V_LOG:
+        return x >= 0.181f ? powf(10.0f, (x - VLOG_D) / VLOG_C) - VLOG_B
+                           : (x - 0.125f) / 5.6f;
+    case PL_COLOR_TRC_S_LOG1:
+        return powf(10.0f, (x - SLOG_C) / SLOG_A) - SLOG_B;
+    case PL_COLOR_TRC_S_LOG2:
+        return x >= SLOG_Q ? (powf(10.0f, (x - SLOG_C) / SLOG_A) - SLOG_B) / SLOG_K2
+                           : (x - SLOG_Q) / SLOG_P;
+    case PL_COLOR_TRC_PQ:
+    case PL_COLOR_TRC_COUNT:
+        break;
+    }
+
+    pl_unreachable();
+
+scale_out:
+    return (csp_max - csp_min) * x + csp_min;
+}
+
+static void fill_lut(float *lut, const struct pl_color_space *csp)
+{
+    if (csp->transfer == PL_COLOR_TRC_PQ) {
+        const float scale = 10000 / PL_COLOR_SDR_WHITE;
+        for (int i = 0; i <= PQ_LUT_SIZE; i++)
+            lut[i] = scale * pl_pq_eotf_lut[i];
+        return;
+    }
+
+    float csp_min, csp_max;
+    pl_color_space_nominal_luma_ex(pl_nominal_luma_params(
+        .color      = csp,
+        .metadata   = PL_HDR_METADATA_HDR10,
+        .scaling    = PL_HDR_NORM,
+        .out_min    = &csp_min,
+        .out_max    = &csp_max,
+    ));
+
+    for (int i = 0; i < PQ_LUT_SIZE; i++) {
+        const float x = (float) i / (PQ_LUT_SIZE - 1);
+        lut[i] = linearize(x, csp->transfer, csp_min, csp_max);
+    }
+    lut[PQ_LUT_SIZE] = lut[PQ_LUT_SIZE - 1];
+}
+
+static inline float lut_lookup(const float *lut, float x)
+{
+    float idxf  = fminf(fmaxf(x, 0.0f), 1.0f) * (PQ_LUT_SIZE - 1);
+    int ipart   = idxf;
+    float fpart = idxf - ipart;
+    return PL_MIX(lut[ipart], lut[ipart + 1], fpart);
+}
+
+static inline float load_px(enum pl_color_cpu_type type, const void *src, int x)
+{
+    switch (type) {
+    case PL_COLOR_CPU_FLOAT: return ((const float *) src)[x];
+    case PL_COLOR_CPU_U8:    return ((const uint8_t *) src)[x];
+    case PL_COLOR_CPU_U16:   return ((const uint16_t *) src)[x];
+    case PL_COLOR_CPU_TYPE_COUNT: break;
+    }
+
+    pl_unreachable();
+}
+
+// Minimal vector abstraction, so the kernel below only needs to be written
+// once. `VEC` is the number of lanes, or 0 if there is no SIMD support.
+#if defined(__AVX2__)
+
+#define VEC 8
+typedef __m256 vf;
+#define vf_set1 _mm256_set1_ps
+#define vf_add  _mm256_add_ps
+#define vf_mul  _mm256_mul_ps
+#define vf_store(ptr, v) _mm256_storeu_ps(ptr, v)
+
+static inline vf vf_load(enum pl_color_cpu_type type, const void *src, int x)
+{
+    switch (type) {
+    case PL_COLOR_CPU_FLOAT:
+        return _mm256_loadu_ps((const float *) src + x);
+    case PL_COLOR_CPU_U8: {
+        __m128i v = _mm_loadl_epi64((const __m128i *) ((const uint8_t *) src + x));
+        return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(v));
+    }
+    case PL_COLOR_CPU_U16: {
+        __m128i v = _mm_loadu_si128((const __m128i *) ((const uint16_t *) src + x));
+        return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(v));
+    }
+    case PL_COLOR_CPU_TYPE_COUNT: break;
+    }
+
+    pl_unreachable();
+}
+
+static inline vf vf_lut(const float *lut, vf x)
+{
+    // Note: max(x, 0) also flushes NaN to 0, since the second operand wins
+    x = _mm256_max_ps(x, _mm256_setzero_ps());
+    x = _mm256_min_ps(x, _mm256_set1_ps(1.0f));
+    x = _mm256_mul_ps(x, _mm256_set1_ps(PQ_LUT_SIZE - 1));
+    __m256i idx = _mm256_cvttps_epi32(x);
+    vf frac = _mm256_sub_ps(x, _mm256_cvtepi32_ps(idx));
+    vf lo = _mm256_i32gather_ps(lut, idx, 4);
+    vf hi = _mm256_i32gather_ps(lut + 1, idx, 4);
+    return _mm256_add_ps(lo, _mm256_mul_ps(frac, _mm256_sub_ps(hi, lo)));
+}
+
+#elif defined(__SSE2__)
+
+#define VEC 4
+typedef __m128 vf;
+#define vf_set1 _mm_set1_ps
+#define vf_add  _mm_add_ps
+#define vf_mul  _mm_mul_ps
+#define vf_store(ptr, v) _mm_storeu_ps(ptr, v)
+
+static inline vf vf_load(enum pl_color_cpu_type type, const void *src, int x)
+{
+    const __m128i zero = _mm_setzero_si128();
+    switch (type) {
+    case PL_COLOR_CPU_FLOAT:
+        return _mm_loadu_ps((const float *) src + x);
+    case PL_COLOR_CPU_U8: {
+        int32_t w;
+        memcpy(&w, (const uint8_t *) src + x, sizeof(w));
+        __m128i v = _mm_unpacklo_epi8(_mm_cvtsi32_si128(w), zero);
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    }
+    case PL_COLOR_CPU_U16: {
+        __m128i v = _mm_loadl_epi64((const __m128i *) ((const uint16_t *) src + x));
+        return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, zero));
+    }
+    case PL_COLOR_CPU_TYPE_COUNT: break;
+    }
+
+    pl_unreachable();
+}
+
+static inline vf vf_lut(const float *lut, vf x)
+{
+    x = _mm_max_ps(x, _mm_setzero_ps());
+    x = _mm_min_ps(x, _mm_set1_ps(1.0f));
+    x = _mm_mul_ps(x, _mm_set1_ps(PQ_LUT_SIZE - 1));
+    __m128i idx = _mm_cvttps_epi32(x);
+    vf frac = _mm_sub_ps(x, _mm_cvtepi32_ps(idx));
+
+    // No gather instructions before AVX2
+    int32_t i[4];
+    _mm_storeu_si128((__m128i *) i, idx);
+    vf lo = _mm_setr_ps(lut[i[0]], lut[i[1]], lut[i[2]], lut[i[3]]);
+    vf hi = _mm_setr_ps(lut[i[0] + 1], lut[i[1] + 1], lut[i[2] + 1], lut[i[3] + 1]);
+    return _mm_add_ps(lo, _mm_mul_ps(frac, _mm_sub_ps(hi, lo)));
+}
+
+#elif defined(__ARM_NEON)
+
+#define VEC 4
+typedef float32x4_t vf;
+#define vf_set1 vdupq_n_f32
+#define vf_add  vaddq_f32
+#define vf_mul  vmulq_f32
+#define vf_store(ptr, v) vst1q_f32(ptr, v)
+
+static inline vf vf_load(enum pl_color_cpu_type type, const void *src, int x)
+{
+    switch (type) {
+    case PL_COLOR_CPU_FLOAT:
+        return vld1q_f32((const float *) src + x);
+    case PL_COLOR_CPU_U8: {
+        uint32_t w;
+        memcpy(&w, (const uint8_t *) src + x, sizeof(w));
+        uint16x8_t v = vmovl_u8(vreinterpret_u8_u32(vdup_n_u32(w)));
+        return vcvtq_f32_u32(vmovl_u16(vget_low_u16(v)));
+    }
+    case PL_COLOR_CPU_U16:
+        return vcvtq_f32_u32(vmovl_u16(vld1_u16((const uint16_t *) src + x)));
+    case PL_COLOR_CPU_TYPE_COUNT: break;
+    }
+
+    pl_unreachable();
+}
+
+static inline vf vf_lut(const float *lut, vf x)
+{
+    // vmaxq_f32 propagates NaN, so flush it explicitly
+    x = vbslq_f32(vceqq_f32(x, x), x, vdupq_n_f32(0.0f));
+    x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(0.0f)), vdupq_n_f32(1.0f));
+    x = vmulq_f32(x, vdupq_n_f32(PQ_LUT_SIZE - 1));
+    int32x4_t idx = vcvtq_s32_f32(x);
+    vf frac = vsubq_f32(x, vcvtq_f32_s32(idx));
+
+    int32_t i[4];
+    vst1q_s32(i, idx);
+    const float lo_v[4] = { lut[i[0]], lut[i[1]], lut[i[2]], lut[i[3]] };
+    const float hi_v[4] = { lut[i[0] + 1], lut[i[1] + 1], lut[i[2] + 1], lut[i[3] + 1] };
+    vf lo = vld1q_f32(lo_v), hi = vld1q_f32(hi_v);
+    return vaddq_f32(lo, vmulq_f32(frac, vsubq_f32(hi, lo)));
+}
+
+#else
+#define VEC 0
+#endif
+
+static inline void convert_row(const struct convert_ctx *ctx,
+                               enum pl_color_cpu_type type,
+                               const void *const src[3], float *const dst[3],
+                               bool apply_lin)
+{
+    const int w = ctx->params->width;
+    int x = 0;
+
+#if VEC
+    const vf m[3][3] = {
+        { vf_set1(ctx->m[0][0]), vf_set1(ctx->m[0][1]), vf_set1(ctx->m[0][2]) },
+        { vf_set1(ctx->m[1][0]), vf_set1(ctx->m[1][1]), vf_set1(ctx->m[1][2]) },
+        { vf_set1(ctx->m[2][0]), vf_set1(ctx->m[2][1]), vf_set1(ctx->m[2][2]) },
+    };
+    const vf c[3] = { vf_set1(ctx->c[0]), vf_set1(ctx->c[1]), vf_set1(ctx->c[2]) };
+    const vf l[3][3] = {
+        { vf_set1(ctx->lin[0][0]), vf_set1(ctx->lin[0][1]), vf_set1(ctx->lin[0][2]) },
+        { vf_set1(ctx->lin[1][0]), vf_set1(ctx->lin[1][1]), vf_set1(ctx->lin[1][2]) },
+        { vf_set1(ctx->lin[2][0]), vf_set1(ctx->lin[2][1]), vf_set1(ctx->lin[2][2]) },
+    };
+
+    for (; x + VEC <= w; x += VEC) {
+        const vf in[3] = {
+            vf_load(type, src[0], x),
+            vf_load(type, src[1], x),
+            vf_load(type, src[2], x),
+        };
+
+        vf rgb[3];
+        for (int i = 0; i < 3; i++) {
+            vf v = vf_add(c[i], vf_mul(m[i][0], in[0]));
+            v = vf_add(v, vf_mul(m[i][1], in[1]));
+            v = vf_add(v, vf_mul(m[i][2], in[2]));
+            rgb[i] = vf_lut(ctx->lut, v);
+        }
+
+        for (int i = 0; i < 3; i++) {
+            vf v = rgb[i];
+            if (apply_lin) {
+                v = vf_mul(l[i][0], rgb[0]);
+                v = vf_add(v, vf_mul(l[i][1], rgb[1]));
+                v = vf_add(v, vf_mul(l[i][2], rgb[2]));
+            }
+            vf_store(dst[i] + x, v);
+        }
+    }
+#endif
+
+    for (; x < w; x++) {
+        const float in[3] = {
+            load_px(type, src[0], x),
+            load_px(type, src[1], x),
+            load_px(type, src[2], x),
+        };
+
+        float rgb[3];
+        for (int i = 0; i < 3; i++) {
+            rgb[i] = lut_lookup(ctx->lut, ctx->c[i] + ctx->m[i][0] * in[0] +
+                                                      ctx->m[i][1] * in[1] +
+                                                      ctx->m[i][2] * in[2]);
+        }
+
+        for (int i = 0; i < 3; i++) {
+            dst[i][x] = apply_lin ? ctx->lin[i][0] * rgb[0] +
+                                    ctx->lin[i][1] * rgb[1] +
+                                    ctx->lin[i][2] * rgb[2]
+                                  : rgb[i];
+        }
+    }
+}
+
+// Applies the HLG OOTF and the linear light matrix in-place. This depends on
+// the luminance of each pixel, so it can't be folded into the LUT.
+static void apply_ootf(const struct convert_ctx *ctx, float *const dst[3])
+{
+    for (int x = 0; x < ctx->params->width; x++) {
+        float rgb[3] = { dst[0][x], dst[1][x], dst[2][x] };
+        const float luma = ctx->luma[0] * rgb[0] +
+                           ctx->luma[1] * rgb[1] +
+                           ctx->luma[2] * rgb[2];
+        const float gain = ctx->ootf_peak * powf(fmaxf(luma, 0.0f), ctx->ootf_gamma - 1);
+        for (int i = 0; i < 3; i++)
+            rgb[i] *= gain;
+        for (int i = 0; i < 3; i++) {
+            dst[i][x] = ctx->lin[i][0] * rgb[0] +
+                        ctx->lin[i][1] * rgb[1] +
+                        ctx->lin[i][2] * rgb[2];
+        }
+    }
+}
+
+static inline void convert_rows(const struct convert_ctx *ctx,
+                                enum pl_color_cpu_type type, int y0, int y1)
+{
+    const struct pl_color_cpu_params *params = ctx->params;
+    const bool apply_lin = !ctx->ootf && !ctx->lin_identity;
+
+    for (int y = y0; y < y1; y++) {
+        const void *src[3];
+        float *dst[3];
+        for (int i = 0; i < 3; i++) {
+            src[i] = (const uint8_t *) params->src[i] + y * params->src_stride[i];
+            dst[i] = (float *) ((uint8_t *) params->dst[i] + y * params->dst_stride[i]);
+        }
+
+        convert_row(ctx, type, src, dst, apply_lin);
+        if (ctx->ootf)
+            apply_ootf(ctx, dst);
+    }
+}
+
+static void convert_slice(void *priv, int idx)
+{
+    const struct convert_ctx *ctx = priv;
+    const int y0 = idx * ctx->slice_rows;
+    const int y1 = PL_MIN(y0 + ctx->slice_rows, ctx->params->height);
+
+    // Dispatch on the type outside of the row loop, so each of these gets an
+    // inlined copy of the kernel with the loads resolved at compile time
+    switch (ctx->params->src_type) {
+    case PL_COLOR_CPU_FLOAT: convert_rows(ctx, PL_COLOR_CPU_FLOAT, y0, y1); return;
+    case PL_COLOR_CPU_U8:    convert_rows(ctx, PL_COLOR_CPU_U8,    y0, y1); return;
+    case PL_COLOR_CPU_U16:   convert_rows(ctx, PL_COLOR_CPU_U16,   y0, y1); return;
+    case PL_COLOR_CPU_TYPE_COUNT: break;
+    }
+
+    pl_unreachable();
+}
+
+bool pl_color_convert_cpu(const struct pl_color_cpu_params *params)
+{
+    pl_assert(params->width >= 0 && params->height >= 0);
+    pl_assert(params->src_type < PL_COLOR_CPU_TYPE_COUNT);
+    for (int i = 0; i < 3; i++)
+        pl_assert(params->src[i] && params->dst[i]);
+
+    switch (params->repr.sys) {
+    case PL_COLOR_SYSTEM_UNKNOWN:
+    case PL_COLOR_SYSTEM_RGB:
+    case PL_COLOR_SYSTEM_BT_601:
+    case PL_COLOR_SYSTEM_BT_709:
+    case PL_COLOR_SYSTEM_SMPTE_240M:
+    case PL_COLOR_SYSTEM_BT_2020_NC:
+    case PL_COLOR_SYSTEM_YCGCO:
+        break;
+    case PL_COLOR_SYSTEM_BT_2020_C:
+    case PL_COLOR_SYSTEM_BT_2100_PQ:
+    case PL_COLOR_SYSTEM_BT_2100_HLG:
+    case PL_COLOR_SYSTEM_DOLBYVISION:
+    case PL_COLOR_SYSTEM_XYZ:
+        return false;
+    case PL_COLOR_SYSTEM_COUNT:
+        pl_unreachable();
+    }
+
+    if (!params->width || !params->height)
+        return true;
+
+    struct convert_ctx ctx_buf = { .params = params }, *ctx = &ctx_buf;
+
+    // Integer inputs are normalized by folding the scale into the matrix
+    struct pl_color_repr repr = params->repr;
+    float scale = 1.0f;
+    switch (params->src_type) {
+    case PL_COLOR_CPU_FLOAT:
+        break;
+    case PL_COLOR_CPU_U8:
+        repr.bits.sample_depth = PL_DEF(repr.bits.sample_depth, 8);
+        scale = 1.0f / UINT8_MAX;
+        break;
+    case PL_COLOR_CPU_U16:
+        repr.bits.sample_depth = PL_DEF(repr.bits.sample_depth, 16);
+        scale = 1.0f / UINT16_MAX;
+        break;
+    case PL_COLOR_CPU_TYPE_COUNT:
+        pl_unreachable();
+    }
+
+    pl_transform3x3 tr = pl_color_repr_decode(&repr, params->adjust);
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++)
+            ctx->m[i][j] = tr.mat.m[i][j] * scale;
+        ctx->c[i] = tr.c[i];
+    }
+
+    struct pl_color_space csp = params->color;
+    pl_color_space_infer(&csp);
+    fill_lut(ctx->lut, &csp);
+
+    const struct pl_raw_primaries *src_prim = pl_raw_primaries_get(csp.primaries);
+    const struct pl_raw_primaries *dst_prim = src_prim;
+    if (params->dst_primaries)
+        dst_prim = pl_raw_primaries_get(params->dst_primaries);
+
+    pl_matrix3x3 lin = pl_matrix3x3_identity;
+    if (dst_prim != src_prim)
+        lin = pl_get_color_mapping_matrix(src_prim, dst_prim, params->intent);
+    if (params->cones) {
+        pl_matrix3x3 cone = pl_get_cone_matrix(params->cones, dst_prim);
+        pl_matrix3x3_rmul(&cone, &lin);
+    }
+
+    memcpy(ctx->lin, lin.m, sizeof(ctx->lin));
+    ctx->lin_identity = !memcmp(&lin, &pl_matrix3x3_identity, sizeof(lin));
+
+    if (csp.transfer == PL_COLOR_TRC_HLG) {
+        float csp_max;
+        pl_color_space_nominal_luma_ex(pl_nominal_luma_params(
+            .color      = &csp,
+            .metadata   = PL_HDR_METADATA_HDR10,
+            .scaling    = PL_HDR_NORM,
+            .out_max    = &csp_max,
+        ));
+
+        pl_matrix3x3 rgb2xyz = pl_get_rgb2xyz_matrix(src_prim);
+        ctx->ootf = true;
+        ctx->ootf_peak = csp_max;
+        ctx->ootf_gamma = fmaxf(1.2f + 0.42f * log10f(csp_max / HLG_REF), 1);
+        for (int i = 0; i < 3; i++)
+            ctx->luma[i] = rgb2xyz.m[1][i];
+    }
+
+    ctx->slice_rows = PL_MAX(1, SLICE_PIXELS / params->width);
+    const int num_slices = PL_DIV_UP(params->height, ctx->slice_rows);
+    if (num_slices > 1) {
+        pl_parallel_for(num_slices, convert_slice, ctx);
+    } else {
+        convert_slice(ctx, 0);
+    }
+
+    return true;
+}
@@ -48,6 +48,12 @@ struct d3d11_ctx {
 
     // pl_gpu_is_failed (We saw a device removed error!)
     bool is_failed;
+
+    // Use the performance SPIR-V optimization passes
+    bool spirv_opt_performance;
+
+    // Record passes into a deferred context
+    bool deferred_context;
 };
 
 // DDK value. Apparently some D3D functions can return this instead of the
@@ -351,6 +351,8 @@ pl_d3d11 pl_d3d11_create(pl_log log, const struct pl_d3d11_params *params)
     struct d3d11_ctx *ctx = PL_PRIV(d3d11);
     ctx->log = log;
     ctx->d3d11 = d3d11;
+    ctx->spirv_opt_performance = params->spirv_opt_performance;
+    ctx->deferred_context = params->deferred_context;
 
     if (params->device) {
         d3d11->device = params->device;
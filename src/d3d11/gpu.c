@@ -39,7 +39,7 @@ struct pl_timer_t {
     struct timer_query queries[16];
 };
 
-void pl_d3d11_timer_start(pl_gpu gpu, pl_timer timer)
+void pl_d3d11_timer_start(pl_gpu gpu, ID3D11DeviceContext *dctx, pl_timer timer)
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
     struct d3d11_ctx *ctx = p->ctx;
@@ -66,8 +66,8 @@ void pl_d3d11_timer_start(pl_gpu gpu, pl_timer timer)
     }
 
     // Query the start timestamp
-    ID3D11DeviceContext_Begin(p->imm, (ID3D11Asynchronous *) query->disjoint);
-    ID3D11DeviceContext_End(p->imm, (ID3D11Asynchronous *) query->ts_start);
+    ID3D11DeviceContext_Begin(dctx, (ID3D11Asynchronous *) query->disjoint);
+    ID3D11DeviceContext_End(dctx, (ID3D11Asynchronous *) query->ts_start);
     return;
 
 error:
@@ -76,10 +76,8 @@ error:
     SAFE_RELEASE(query->disjoint);
 }
 
-void pl_d3d11_timer_end(pl_gpu gpu, pl_timer timer)
+void pl_d3d11_timer_end(pl_gpu gpu, ID3D11DeviceContext *dctx, pl_timer timer)
 {
-    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
-
     if (!timer)
         return;
     struct timer_query *query = &timer->queries[timer->current];
@@ -90,8 +88,8 @@ void pl_d3d11_timer_end(pl_gpu gpu, pl_timer timer)
         return;
 
     // Query the end timestamp
-    ID3D11DeviceContext_End(p->imm, (ID3D11Asynchronous *) query->ts_end);
-    ID3D11DeviceContext_End(p->imm, (ID3D11Asynchronous *) query->disjoint);
+    ID3D11DeviceContext_End(dctx, (ID3D11Asynchronous *) query->ts_end);
+    ID3D11DeviceContext_End(dctx, (ID3D11Asynchronous *) query->disjoint);
 
     // Advance to the next set of queries, for the next call to timer_start
     timer->current++;
@@ -117,6 +115,9 @@ static uint64_t d3d11_timer_query(pl_gpu gpu, pl_timer timer)
     struct d3d11_ctx *ctx = p->ctx;
     HRESULT hr;
 
+    // The queries can't complete before they're executed
+    pl_d3d11_submit_deferred(gpu);
+
     for (; timer->pending > 0; timer->pending--) {
         int index = timer->current - timer->pending;
         if (index < 0)
@@ -201,11 +202,80 @@ static int d3d11_desc_namespace(pl_gpu gpu, enum pl_desc_type type)
     return 0;
 }
 
+void pl_d3d11_poll_callbacks(pl_gpu gpu)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    while (p->callbacks.num) {
+        struct d3d11_cb cb = p->callbacks.elem[0];
+        HRESULT hr = ID3D11DeviceContext_GetData(p->imm,
+            (ID3D11Asynchronous *) cb.query, NULL, 0,
+            D3D11_ASYNC_GETDATA_DONOTFLUSH);
+        if (hr == S_FALSE)
+            return;
+
+        // Also run the callback on errors (e.g. device removal), since the
+        // query would otherwise never complete
+        PL_ARRAY_REMOVE_AT(p->callbacks, 0);
+        SAFE_RELEASE(cb.query);
+        cb.callback(cb.priv);
+    }
+}
+
+static void d3d11_gpu_finish(pl_gpu gpu);
+
+void pl_d3d11_queue_callback(pl_gpu gpu, void (*callback)(void *priv), void *priv)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    struct d3d11_ctx *ctx = p->ctx;
+    ID3D11Query *query = NULL;
+
+    pl_d3d11_submit_deferred(gpu);
+    D3D(ID3D11Device_CreateQuery(p->dev,
+        &(D3D11_QUERY_DESC) { .Query = D3D11_QUERY_EVENT }, &query));
+    ID3D11DeviceContext_End(p->imm, (ID3D11Asynchronous *) query);
+
+    PL_ARRAY_APPEND(gpu, p->callbacks, (struct d3d11_cb) {
+        .query = query,
+        .callback = callback,
+        .priv = priv,
+    });
+    return;
+
+error:
+    // Without a query there is no way to tell when the GPU is done, so just
+    // block until it's idle
+    d3d11_gpu_finish(gpu);
+    callback(priv);
+}
+
+void pl_d3d11_submit_deferred(pl_gpu gpu)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    struct d3d11_ctx *ctx = p->ctx;
+    ID3D11CommandList *cmds = NULL;
+
+    if (!p->dc_pending)
+        return;
+
+    // Passes bind all of the state they need, so there's no need to restore
+    // the deferred context state after finishing the command list
+    p->dc_pending = false;
+    D3D(ID3D11DeviceContext_FinishCommandList(p->dc, FALSE, &cmds));
+    ID3D11DeviceContext_ExecuteCommandList(p->imm, cmds, FALSE);
+
+    pl_d3d11_flush_message_queue(ctx, "After executing command list");
+
+error:
+    SAFE_RELEASE(cmds);
+}
+
 static void d3d11_gpu_flush(pl_gpu gpu)
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
     struct d3d11_ctx *ctx = p->ctx;
+    pl_d3d11_submit_deferred(gpu);
     ID3D11DeviceContext_Flush(p->imm);
+    pl_d3d11_poll_callbacks(gpu);
 
     pl_d3d11_flush_message_queue(ctx, "After gpu flush");
 }
@@ -216,6 +286,7 @@ static void d3d11_gpu_finish(pl_gpu gpu)
     struct d3d11_ctx *ctx = p->ctx;
     HRESULT hr;
 
+    pl_d3d11_submit_deferred(gpu);
     if (p->finish_fence) {
         p->finish_value++;
         D3D(ID3D11Fence_SetEventOnCompletion(p->finish_fence, p->finish_value,
@@ -245,6 +316,7 @@ static void d3d11_gpu_finish(pl_gpu gpu)
         }
     }
 
+    pl_d3d11_poll_callbacks(gpu);
     pl_d3d11_flush_message_queue(ctx, "After gpu finish");
 
 error:
@@ -273,10 +345,18 @@ static void d3d11_gpu_destroy(pl_gpu gpu)
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
 
+    if (p->callbacks.num) {
+        d3d11_gpu_finish(gpu);
+        while (p->callbacks.num)
+            pl_d3d11_poll_callbacks(gpu);
+    }
+
     pl_buf_destroy(gpu, &p->finish_buf_src);
     pl_buf_destroy(gpu, &p->finish_buf_dst);
 
     // Release everything except the immediate context
+    SAFE_RELEASE(p->dc);
+    SAFE_RELEASE(p->dc1);
     SAFE_RELEASE(p->dev);
     SAFE_RELEASE(p->dev1);
     SAFE_RELEASE(p->dev5);
@@ -284,6 +364,7 @@ static void d3d11_gpu_destroy(pl_gpu gpu)
     SAFE_RELEASE(p->imm4);
     SAFE_RELEASE(p->vbuf.buf);
     SAFE_RELEASE(p->ibuf.buf);
+    SAFE_RELEASE(p->cbuf.buf);
     SAFE_RELEASE(p->rstate);
     SAFE_RELEASE(p->dsstate);
     for (int i = 0; i < PL_TEX_SAMPLE_MODE_COUNT; i++) {
@@ -408,9 +489,11 @@ pl_gpu pl_gpu_create_d3d11(struct d3d11_ctx *ctx)
         .spirv = pl_spirv_create(ctx->log, (struct pl_spirv_version) {
             .env_version = pl_spirv_version_to_vulkan(spirv_ver),
             .spv_version = spirv_ver,
-        }),
+        }, ctx->spirv_opt_performance),
         .vbuf.bind_flags = D3D11_BIND_VERTEX_BUFFER,
         .ibuf.bind_flags = D3D11_BIND_INDEX_BUFFER,
+        .cbuf.bind_flags = D3D11_BIND_CONSTANT_BUFFER,
+        .cbuf.align = CBUF_RING_ALIGN,
     };
     if (!p->spirv)
         goto error;
@@ -439,6 +522,49 @@ pl_gpu pl_gpu_create_d3d11(struct d3d11_ctx *ctx)
 
     PL_INFO(gpu, "Using Direct3D 11.%d runtime", p->minor);
 
+    if (ctx->deferred_context) {
+        hr = ID3D11Device_CreateDeferredContext(p->dev, 0, &p->dc);
+        if (SUCCEEDED(hr)) {
+            D3D11_FEATURE_DATA_THREADING threading = {0};
+            ID3D11Device_CheckFeatureSupport(p->dev, D3D11_FEATURE_THREADING,
+                                             &threading, sizeof(threading));
+            PL_INFO(gpu, "Recording passes on a deferred context (%s command "
+                    "lists)", threading.DriverCommandLists ? "driver" : "emulated");
+
+            // Other `pl_d3d11` instances may share the immediate context
+            ID3D11Multithread *mt = NULL;
+            hr = ID3D11DeviceContext_QueryInterface(p->imm, &IID_ID3D11Multithread,
+                                                    (void **) &mt);
+            if (SUCCEEDED(hr)) {
+                ID3D11Multithread_SetMultithreadProtected(mt, TRUE);
+                SAFE_RELEASE(mt);
+            }
+        } else {
+            PL_WARN(gpu, "Failed creating deferred context: %s, recording "
+                    "passes on the immediate context", pl_hresult_to_str(hr));
+        }
+    }
+
+    // Upload uniform buffers through a ring of dynamic constant buffers if
+    // they can be bound at an offset. Mapping a dynamic constant buffer with
+    // NO_OVERWRITE is only allowed if the driver says so.
+    if (p->imm1) {
+        D3D11_FEATURE_DATA_D3D11_OPTIONS opts = {0};
+        hr = ID3D11Device_CheckFeatureSupport(p->dev, D3D11_FEATURE_D3D11_OPTIONS,
+                                              &opts, sizeof(opts));
+        if (SUCCEEDED(hr) && opts.ConstantBufferOffsetting &&
+            opts.MapNoOverwriteOnDynamicConstantBuffer)
+        {
+            p->cbuf_ring = true;
+            if (p->dc) {
+                hr = ID3D11DeviceContext_QueryInterface(p->dc,
+                    &IID_ID3D11DeviceContext1, (void **) &p->dc1);
+                p->cbuf_ring = SUCCEEDED(hr);
+            }
+        }
+    }
+    PL_DEBUG(gpu, "Constant buffer ring: %s", p->cbuf_ring ? "yes" : "no");
+
     D3D(ID3D11Device_QueryInterface(p->dev, &IID_IDXGIDevice1, (void **) &dxgi_dev));
     D3D(IDXGIDevice1_GetParent(dxgi_dev, &IID_IDXGIAdapter1, (void **) &adapter));
 
@@ -466,6 +592,12 @@ pl_gpu pl_gpu_create_d3d11(struct d3d11_ctx *ctx)
         .align_tex_xfer_offset = 32,
         .align_tex_xfer_pitch = 1,
         .fragment_queues = 1,
+
+        // Emulated by recompiling only the final HLSL with macro definitions
+        .max_constants = SIZE_MAX,
+
+        // Implemented with event queries, see `pl_d3d11_queue_callback`
+        .callbacks = true,
     };
 
     p->fl = ID3D11Device_GetFeatureLevel(p->dev);
@@ -36,6 +36,9 @@ pl_gpu pl_gpu_create_d3d11(struct d3d11_ctx *ctx);
 // Size of one constant in a constant buffer
 #define CBUF_ELEM (sizeof(float[4]))
 
+// Required alignment of constant buffer offsets for *SetConstantBuffers1
+#define CBUF_RING_ALIGN (16 * CBUF_ELEM)
+
 struct d3d_stream_buf {
     UINT bind_flags;
     ID3D11Buffer *buf;
@@ -44,6 +47,12 @@ struct d3d_stream_buf {
     unsigned int align;
 };
 
+struct d3d11_cb {
+    ID3D11Query *query; // D3D11_QUERY_EVENT signalled when the GPU is done
+    void (*callback)(void *priv);
+    void *priv;
+};
+
 struct pl_gpu_d3d11 {
     struct pl_gpu_fns impl;
     struct d3d11_ctx *ctx;
@@ -54,6 +63,12 @@ struct pl_gpu_d3d11 {
     ID3D11DeviceContext1 *imm1;
     ID3D11DeviceContext4 *imm4;
 
+    // Deferred context for recording passes, or NULL if passes are recorded
+    // on the immediate context. See `pl_d3d11_params.deferred_context`.
+    ID3D11DeviceContext *dc;
+    ID3D11DeviceContext1 *dc1;
+    bool dc_pending; // `dc` contains commands not yet executed on `imm`
+
     // The Direct3D 11 minor version number
     int minor;
 
@@ -70,10 +85,19 @@ struct pl_gpu_d3d11 {
     int max_srvs;
     int max_uavs;
 
+    // Pending asynchronous callbacks, in submission order
+    PL_ARRAY(struct d3d11_cb) callbacks;
+
     // Streaming vertex and index buffers
     struct d3d_stream_buf vbuf;
     struct d3d_stream_buf ibuf;
 
+    // Streaming constant buffer, used to upload the uniform buffers of a pass
+    // with a single map and bind them with offsets. Only used if `cbuf_ring`
+    // is set, which requires D3D11.1 constant buffer offsetting.
+    struct d3d_stream_buf cbuf;
+    bool cbuf_ring;
+
     // Shared rasterizer state
     ID3D11RasterizerState *rstate;
 
@@ -94,8 +118,19 @@ struct pl_gpu_d3d11 {
 
 void pl_d3d11_setup_formats(struct pl_gpu_t *gpu);
 
-void pl_d3d11_timer_start(pl_gpu gpu, pl_timer timer);
-void pl_d3d11_timer_end(pl_gpu gpu, pl_timer timer);
+void pl_d3d11_timer_start(pl_gpu gpu, ID3D11DeviceContext *dctx, pl_timer timer);
+void pl_d3d11_timer_end(pl_gpu gpu, ID3D11DeviceContext *dctx, pl_timer timer);
+
+// Execute all commands recorded on the deferred context so far. Must be
+// called before any command is issued on the immediate context, to keep all
+// commands in submission order. No-op if nothing is pending.
+void pl_d3d11_submit_deferred(pl_gpu gpu);
+
+// Run `callback` once all previously issued commands have completed on the GPU
+void pl_d3d11_queue_callback(pl_gpu gpu, void (*callback)(void *priv), void *priv);
+
+// Run all callbacks whose commands have completed, without blocking
+void pl_d3d11_poll_callbacks(pl_gpu gpu);
 
 struct pl_buf_d3d11 {
     ID3D11Buffer *buf;
@@ -119,7 +154,7 @@ void pl_d3d11_buf_copy(pl_gpu gpu, pl_buf dst, size_t dst_offset, pl_buf src,
                        size_t src_offset, size_t size);
 
 // Ensure a buffer is up-to-date with its system memory mirror before it is used
-void pl_d3d11_buf_resolve(pl_gpu gpu, pl_buf buf);
+void pl_d3d11_buf_resolve(ID3D11DeviceContext *dctx, pl_buf buf);
 
 struct pl_tex_d3d11 {
     // res mirrors one of tex1d, tex2d or tex3d for convenience. It does not
@@ -139,6 +174,12 @@ struct pl_tex_d3d11 {
     ID3D11Texture2D *staging2d;
     ID3D11Texture3D *staging3d;
 
+    // Ring of staging textures for pl_tex_upload, created on demand
+    ID3D11Resource *upload_ring[3];
+    int num_upload_ring;
+    int upload_idx; // next (i.e. oldest) slot in `upload_ring`
+    int num_uploads;
+
     ID3D11ShaderResourceView *srv;
     ID3D11RenderTargetView *rtv;
     ID3D11UnorderedAccessView *uav;
@@ -199,8 +240,24 @@ struct pl_pass_d3d11 {
     // between all shader stages
     PL_ARRAY(int) uavs;
 
+    // Specialization constants are emulated by recompiling the HLSL of the
+    // main shader with different macro definitions
+    const char *main_hlsl;
+    size_t spec_size;
+    void *spec_data;   // currently active constant values, or NULL
+    uint64_t spec_sig; // signature of the unspecialized shader
+
+    // Offsets into `pl_gpu_d3d11.cbuf` of each uniform buffer descriptor and
+    // of the gl_NumWorkGroups data, if the last pl_pass_run used the ring
+    UINT *cbuf_offsets;
+    UINT num_wgs_offset;
+    bool cbuf_ring_used;
+    struct stream_buf_slice *cbuf_slices;
+
     // Pre-allocated resource arrays to use in pl_pass_run
     ID3D11Buffer **cbv_arr;
+    UINT *cbv_first_arr;
+    UINT *cbv_count_arr;
     ID3D11ShaderResourceView **srv_arr;
     ID3D11SamplerState **sampler_arr;
     ID3D11UnorderedAccessView **uav_arr;
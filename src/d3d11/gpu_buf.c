@@ -215,6 +215,7 @@ void pl_d3d11_buf_write(pl_gpu gpu, pl_buf buf, size_t offset, const void *data,
         memcpy(buf_p->data + offset, data, size);
         buf_p->dirty = true;
     } else {
+        pl_d3d11_submit_deferred(gpu);
         ID3D11DeviceContext_UpdateSubresource(p->imm,
             (ID3D11Resource *) buf_p->buf, 0, (&(D3D11_BOX) {
                 .left = offset,
@@ -227,15 +228,14 @@ void pl_d3d11_buf_write(pl_gpu gpu, pl_buf buf, size_t offset, const void *data,
     }
 }
 
-void pl_d3d11_buf_resolve(pl_gpu gpu, pl_buf buf)
+void pl_d3d11_buf_resolve(ID3D11DeviceContext *dctx, pl_buf buf)
 {
-    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
     struct pl_buf_d3d11 *buf_p = PL_PRIV(buf);
 
     if (!buf_p->data || !buf_p->dirty)
         return;
 
-    ID3D11DeviceContext_UpdateSubresource(p->imm, (ID3D11Resource *) buf_p->buf,
+    ID3D11DeviceContext_UpdateSubresource(dctx, (ID3D11Resource *) buf_p->buf,
         0, NULL, buf_p->data, 0, 0);
 }
 
@@ -252,6 +252,7 @@ bool pl_d3d11_buf_read(pl_gpu gpu, pl_buf buf, size_t offset, void *dest,
         return true;
     }
 
+    pl_d3d11_submit_deferred(gpu);
     ID3D11DeviceContext_CopyResource(p->imm, (ID3D11Resource *) buf_p->staging,
         (ID3D11Resource *) buf_p->buf);
 
@@ -294,6 +295,7 @@ void pl_d3d11_buf_copy(pl_gpu gpu, pl_buf dst, size_t dst_offset, pl_buf src,
             PL_ERR(gpu, "Failed to read from GPU during buffer copy");
         }
     } else {
+        pl_d3d11_submit_deferred(gpu);
         ID3D11DeviceContext_CopySubresourceRegion(p->imm,
             (ID3D11Resource *) dst_p->buf, 0, dst_offset, 0, 0,
             (ID3D11Resource *) src_p->buf, 0, (&(D3D11_BOX) {
@@ -19,6 +19,8 @@
 #include "formats.h"
 #include "glsl/spirv.h"
 #include "../cache.h"
+#include "../pl_memcpy.h"
+#include "../pl_thread_pool.h"
 
 struct stream_buf_slice {
     const void *data;
@@ -34,6 +36,7 @@ static bool stream_buf_upload(pl_gpu gpu, struct d3d_stream_buf *stream,
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
     struct d3d11_ctx *ctx = p->ctx;
+    ID3D11DeviceContext *dctx = PL_DEF(p->dc, p->imm);
     unsigned int align = PL_DEF(stream->align, sizeof(float));
 
     // Get total size, rounded up to the buffer's alignment
@@ -71,8 +74,11 @@ static bool stream_buf_upload(pl_gpu gpu, struct d3d_stream_buf *stream,
         stream->used = 0;
     }
 
-    bool discard = false;
-    size_t offset = stream->used;
+    // The first map of a resource in a command list must discard it, and
+    // there's no way of knowing whether this is the first map in the current
+    // command list, so always discard on deferred contexts
+    bool discard = p->dc != NULL;
+    size_t offset = discard ? 0 : stream->used;
     if (offset + size > stream->size) {
         // We reached the end of the buffer, so discard and wrap around
         discard = true;
@@ -81,7 +87,7 @@ static bool stream_buf_upload(pl_gpu gpu, struct d3d_stream_buf *stream,
 
     D3D11_MAPPED_SUBRESOURCE map = {0};
     UINT type = discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
-    D3D(ID3D11DeviceContext_Map(p->imm, (ID3D11Resource *) stream->buf, 0, type,
+    D3D(ID3D11DeviceContext_Map(dctx, (ID3D11Resource *) stream->buf, 0, type,
                                 0, &map));
 
     // Upload each slice
@@ -89,11 +95,12 @@ static bool stream_buf_upload(pl_gpu gpu, struct d3d_stream_buf *stream,
     stream->used = offset;
     for (int i = 0; i < num_slices; i++) {
         slices[i].offset = stream->used;
-        memcpy(cdata + slices[i].offset, slices[i].data, slices[i].size);
+        pl_memcpy_stream(cdata + slices[i].offset, slices[i].data,
+                         slices[i].size);
         stream->used += PL_ALIGN2(slices[i].size, align);
     }
 
-    ID3D11DeviceContext_Unmap(p->imm, (ID3D11Resource *) stream->buf, 0);
+    ID3D11DeviceContext_Unmap(dctx, (ID3D11Resource *) stream->buf, 0);
 
     return true;
 
@@ -336,29 +343,21 @@ static const char *shader_names[] = {
     [GLSL_SHADER_COMPUTE]  = "compute",
 };
 
-static ID3DBlob *shader_compile_glsl(pl_gpu gpu, pl_pass pass,
-                                     struct d3d_pass_stage *pass_s,
-                                     enum glsl_shader_stage stage,
-                                     const char *glsl)
+// Translates SPIR-V to HLSL. The returned string is allocated on `pass`.
+// Specialization constants are left as `SPIRV_CROSS_CONSTANT_ID_*` macros,
+// which get defined by `shader_compile_hlsl`.
+static const char *shader_translate_spirv(pl_gpu gpu, pl_pass pass,
+                                          struct d3d_pass_stage *pass_s,
+                                          enum glsl_shader_stage stage,
+                                          pl_str spirv)
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
     struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
-    void *tmp = pl_tmp(NULL);
     spvc_context sc = NULL;
     spvc_compiler sc_comp = NULL;
     const char *hlsl = NULL;
-    ID3DBlob *out = NULL;
-    ID3DBlob *errors = NULL;
-    HRESULT hr;
 
     pl_clock_t start = pl_clock_now();
-    pl_str spirv = pl_spirv_compile_glsl(p->spirv, tmp, gpu->glsl, stage, glsl);
-    if (!spirv.len)
-        goto error;
-
-    pl_clock_t after_glsl = pl_clock_now();
-    pl_log_cpu_time(gpu->log, start, after_glsl, "translating GLSL to SPIR-V");
-
     SC(spvc_context_create(&sc));
 
     spvc_parsed_ir sc_ir;
@@ -460,12 +459,66 @@ static ID3DBlob *shader_compile_glsl(pl_gpu gpu, pl_pass pass,
         }
     }
 
-    SC(spvc_compiler_compile(sc_comp, &hlsl));
+    const char *sc_hlsl = NULL;
+    SC(spvc_compiler_compile(sc_comp, &sc_hlsl));
+    hlsl = pl_strdup0(pass, pl_str0(sc_hlsl));
+
+    pl_log_cpu_time(gpu->log, start, pl_clock_now(), "translating SPIR-V to HLSL");
 
-    pl_clock_t after_spvc = pl_clock_now();
-    pl_log_cpu_time(gpu->log, after_glsl, after_spvc, "translating SPIR-V to HLSL");
+error:
+    if (sc)
+        spvc_context_destroy(sc);
+    return hlsl;
+}
+
+// Compiles HLSL to DXBC, specializing it with the given constant values. If
+// `constant_data` is NULL, the defaults from the shader text are used.
+static ID3DBlob *shader_compile_hlsl(pl_gpu gpu, pl_pass pass,
+                                     enum glsl_shader_stage stage,
+                                     const char *hlsl,
+                                     const void *constant_data)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    const struct pl_pass_params *params = &pass->params;
+    void *tmp = pl_tmp(NULL);
+    ID3DBlob *out = NULL;
+    ID3DBlob *errors = NULL;
+    HRESULT hr;
+
+    // Specialization constants only ever appear in the main shader
+    PL_ARRAY(D3D_SHADER_MACRO) macros = {0};
+    if (stage != GLSL_SHADER_VERTEX && constant_data) {
+        uintptr_t data_base = (uintptr_t) constant_data;
+        for (int i = 0; i < params->num_constants; i++) {
+            const struct pl_constant *con = &params->constants[i];
+            const void *data = (void *) (data_base + con->offset);
+            const char *def = NULL;
+            switch (con->type) {
+            case PL_VAR_SINT:
+                def = pl_asprintf(tmp, "%d", *(const int *) data);
+                break;
+            case PL_VAR_UINT:
+                def = pl_asprintf(tmp, "%uu", *(const unsigned *) data);
+                break;
+            case PL_VAR_FLOAT:
+                // 9 significant digits round-trip any float exactly
+                def = pl_asprintf(tmp, "%.9g", *(const float *) data);
+                break;
+            case PL_VAR_INVALID:
+            case PL_VAR_TYPE_COUNT:
+                pl_unreachable();
+            }
+
+            PL_ARRAY_APPEND(tmp, macros, (D3D_SHADER_MACRO) {
+                .Name = pl_asprintf(tmp, "SPIRV_CROSS_CONSTANT_ID_%d", con->id),
+                .Definition = def,
+            });
+        }
+    }
+    PL_ARRAY_APPEND(tmp, macros, (D3D_SHADER_MACRO) {0});
 
-    hr = p->D3DCompile(hlsl, strlen(hlsl), NULL, NULL, NULL, "main",
+    pl_clock_t start = pl_clock_now();
+    hr = p->D3DCompile(hlsl, strlen(hlsl), NULL, macros.elem, NULL, "main",
         get_shader_target(gpu, stage),
         D3DCOMPILE_SKIP_VALIDATION | D3DCOMPILE_OPTIMIZATION_LEVEL3, 0, &out,
         &errors);
@@ -477,17 +530,17 @@ static ID3DBlob *shader_compile_glsl(pl_gpu gpu, pl_pass pass,
         goto error;
     }
 
-    pl_log_cpu_time(gpu->log, after_spvc, pl_clock_now(), "translating HLSL to DXBC");
+    pl_log_cpu_time(gpu->log, start, pl_clock_now(), "translating HLSL to DXBC");
 
 error:;
-    if (hlsl) {
-        int level = out ? PL_LOG_DEBUG : PL_LOG_ERR;
-        PL_MSG(gpu, level, "%s shader HLSL source:", shader_names[stage]);
-        pl_msg_source(gpu->log, level, hlsl);
+    int level = out ? PL_LOG_DEBUG : PL_LOG_ERR;
+    PL_MSG(gpu, level, "%s shader HLSL source:", shader_names[stage]);
+    pl_msg_source(gpu->log, level, hlsl);
+    for (int i = 0; i < macros.num - 1; i++) {
+        PL_MSG(gpu, level, "  #define %s %s", macros.elem[i].Name,
+               macros.elem[i].Definition);
     }
 
-    if (sc)
-        spvc_context_destroy(sc);
     SAFE_RELEASE(errors);
     pl_free(tmp);
     return out;
@@ -506,8 +559,22 @@ struct d3d11_cache_header {
     size_t vert_bc_len;
     size_t frag_bc_len;
     size_t comp_bc_len;
+    size_t main_hlsl_len;
 };
 
+// Bumped whenever the layout of the cached data changes
+#define D3D11_CACHE_VERSION 2
+
+static size_t spec_data_size(const struct pl_pass_params *params)
+{
+    size_t size = 0;
+    for (int i = 0; i < params->num_constants; i++) {
+        const struct pl_constant *con = &params->constants[i];
+        size = PL_MAX(size, con->offset + pl_var_type_size(con->type));
+    }
+    return size;
+}
+
 static inline uint64_t pass_cache_signature(pl_gpu gpu, uint64_t *key,
                                             const struct pl_pass_params *params)
 {
@@ -519,11 +586,18 @@ static inline uint64_t pass_cache_signature(pl_gpu gpu, uint64_t *key,
     if (params->type == PL_PASS_RASTER)
         pl_hash_merge(&hash, pl_str0_hash(params->vertex_shader));
 
+    // Each set of specialization constant values compiles to distinct DXBC
+    if (params->constant_data) {
+        pl_hash_merge(&hash, pl_mem_hash(params->constant_data,
+                                         spec_data_size(params)));
+    }
+
     // store hash based on the shader bodys as the lookup key
     if (key)
         *key = hash;
 
     // and add the compiler version information into the verification signature
+    pl_hash_merge(&hash, D3D11_CACHE_VERSION);
     pl_hash_merge(&hash, p->spirv->signature);
 
     unsigned spvc_major, spvc_minor, spvc_patch;
@@ -548,7 +622,8 @@ static inline size_t cache_payload_size(struct d3d11_cache_header *header)
                        header->num_main_samplers + header->num_vertex_cbvs +
                        header->num_vertex_srvs + header->num_vertex_samplers +
                        header->num_uavs) * sizeof(int) + header->vert_bc_len +
-                       header->frag_bc_len + header->comp_bc_len;
+                       header->frag_bc_len + header->comp_bc_len +
+                       header->main_hlsl_len;
 
     return required;
 }
@@ -613,6 +688,11 @@ static bool d3d11_use_cached_program(pl_gpu gpu, struct pl_pass_t *pass,
     GET_SHADER(frag_bc);
     GET_SHADER(comp_bc);
 
+    if (header->main_hlsl_len) {
+        pl_str hlsl = pl_str_take(cache, header->main_hlsl_len);
+        pass_p->main_hlsl = pl_strdup0(pass, hlsl);
+    }
+
     return true;
 }
 
@@ -639,6 +719,7 @@ static void d3d11_update_program_cache(pl_gpu gpu, struct pl_pass_t *pass,
         .vert_bc_len = vs_str ? vs_str->len : 0,
         .frag_bc_len = ps_str ? ps_str->len : 0,
         .comp_bc_len = cs_str ? cs_str->len : 0,
+        .main_hlsl_len = pass_p->main_hlsl ? strlen(pass_p->main_hlsl) : 0,
     };
 
     size_t cache_size = sizeof(header) + cache_payload_size(&header);
@@ -665,10 +746,262 @@ static void d3d11_update_program_cache(pl_gpu gpu, struct pl_pass_t *pass,
     if (cs_str)
         pl_str_append(NULL, &cache, *cs_str);
 
+    if (pass_p->main_hlsl)
+        pl_str_append(NULL, &cache, pl_str0(pass_p->main_hlsl));
+
     pl_assert(cache_size == cache.len);
     pl_cache_str(gpu_cache, key, &cache);
 }
 
+// Intermediate caching of the SPIRV-Cross output, together with the register
+// allocation it results in. This is independent of the HLSL compiler, so it
+// can be re-used even if the DXBC itself has to be recompiled.
+struct d3d11_hlsl_header {
+    int num_cbvs;
+    int num_srvs;
+    int num_samplers;
+    int num_uavs;
+    int max_binding;
+    bool num_workgroups_used;
+};
+
+// `prev` is the hash of any preceding stages of the same pass, since those
+// affect the allocation of UAV registers
+static uint64_t hlsl_cache_key(pl_gpu gpu, enum glsl_shader_stage stage,
+                               const char *glsl, uint64_t prev)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    uint64_t key = CACHE_KEY_D3D_HLSL;
+    pl_hash_merge(&key, pl_str0_hash(glsl));
+    pl_hash_merge(&key, prev);
+    pl_hash_merge(&key, stage);
+    pl_hash_merge(&key, D3D11_CACHE_VERSION);
+    pl_hash_merge(&key, p->spirv->signature);
+
+    unsigned spvc_major, spvc_minor, spvc_patch;
+    spvc_get_version(&spvc_major, &spvc_minor, &spvc_patch);
+    pl_hash_merge(&key, spvc_major);
+    pl_hash_merge(&key, spvc_minor);
+    pl_hash_merge(&key, spvc_patch);
+
+    // Determines the shader model, as well as the register limits
+    pl_hash_merge(&key, p->fl);
+    return key;
+}
+
+static bool hlsl_cache_valid(const pl_cache_obj *obj)
+{
+    if (obj->size < sizeof(struct d3d11_hlsl_header))
+        return false;
+
+    const struct d3d11_hlsl_header *header = obj->data;
+    size_t arrays = header->num_cbvs + header->num_srvs +
+                    header->num_samplers + header->num_uavs;
+    return obj->size > sizeof(*header) + arrays * sizeof(int);
+}
+
+// Applies the register allocation from a cached object, and returns the HLSL
+static const char *hlsl_cache_load(pl_pass pass, struct d3d_pass_stage *pass_s,
+                                   const pl_cache_obj *obj)
+{
+    struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
+    const struct d3d11_hlsl_header *header = obj->data;
+    pl_str cache = pl_str_drop((pl_str) { obj->data, obj->size }, sizeof(*header));
+
+#define GET_ARRAY(arr, num_elems)                                    \
+    do {                                                             \
+        PL_ARRAY_MEMDUP(pass, arr, cache.buf, num_elems);            \
+        cache = pl_str_drop(cache, (num_elems) * sizeof(int));       \
+    } while (0)
+
+    pass_s->cbvs.num = pass_s->srvs.num = pass_s->samplers.num = 0;
+    pass_p->uavs.num = 0;
+    GET_ARRAY(pass_s->cbvs, header->num_cbvs);
+    GET_ARRAY(pass_s->srvs, header->num_srvs);
+    GET_ARRAY(pass_s->samplers, header->num_samplers);
+    GET_ARRAY(pass_p->uavs, header->num_uavs);
+#undef GET_ARRAY
+
+    pass_p->max_binding = PL_MAX(pass_p->max_binding, header->max_binding);
+    pass_p->num_workgroups_used |= header->num_workgroups_used;
+    return pl_strdup0(pass, cache);
+}
+
+static void hlsl_cache_store(pl_cache cache, pl_pass pass, uint64_t key,
+                             const struct d3d_pass_stage *pass_s,
+                             const char *hlsl)
+{
+    struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
+    const struct d3d11_hlsl_header header = {
+        .num_cbvs = pass_s->cbvs.num,
+        .num_srvs = pass_s->srvs.num,
+        .num_samplers = pass_s->samplers.num,
+        .num_uavs = pass_p->uavs.num,
+        .max_binding = pass_p->max_binding,
+        .num_workgroups_used = pass_p->num_workgroups_used,
+    };
+
+    pl_str data = {0};
+    pl_str_append(NULL, &data, (pl_str) { (uint8_t *) &header, sizeof(header) });
+#define WRITE_ARRAY(arr) pl_str_append(NULL, &data, \
+        (pl_str) { (uint8_t *) (arr).elem, (arr).num * sizeof(int) })
+    WRITE_ARRAY(pass_s->cbvs);
+    WRITE_ARRAY(pass_s->srvs);
+    WRITE_ARRAY(pass_s->samplers);
+    WRITE_ARRAY(pass_p->uavs);
+#undef WRITE_ARRAY
+    pl_str_append(NULL, &data, pl_str0(hlsl));
+    pl_cache_str(cache, key, &data);
+}
+
+struct d3d_stage_job {
+    enum glsl_shader_stage stage;
+    struct d3d_pass_stage *pass_s;
+    const char *glsl;
+    const void *constant_data;
+
+    // Output: the compiled DXBC, or NULL on failure
+    ID3DBlob *out;
+
+    // Internal state
+    const char *hlsl;
+    pl_cache_obj hlsl_obj;
+    pl_cache_obj spirv_obj;
+};
+
+struct d3d_stage_batch {
+    pl_gpu gpu;
+    pl_pass pass;
+    struct d3d_stage_job *jobs;
+};
+
+static void compile_hlsl_job(void *priv, int i)
+{
+    struct d3d_stage_batch *batch = priv;
+    struct d3d_stage_job *job = &batch->jobs[i];
+    job->out = shader_compile_hlsl(batch->gpu, batch->pass, job->stage,
+                                   job->hlsl, job->constant_data);
+}
+
+// Compiles all stages of a pass from GLSL to DXBC. Cached HLSL skips both the
+// GLSL front-end and SPIRV-Cross, and cached SPIR-V at least the former. Any
+// stages that do need compiling are compiled concurrently.
+static bool shader_compile_glsl(pl_gpu gpu, pl_pass pass,
+                                struct d3d_stage_job *jobs, int num_jobs)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
+    pl_cache cache = pl_gpu_cache(gpu);
+    struct pl_spirv_job spirv_jobs[2];
+    int spirv_idx[2], num_spirv = 0;
+    struct d3d_stage_batch batch = {
+        .gpu  = gpu,
+        .pass = pass,
+        .jobs = jobs,
+    };
+    bool ok = false;
+    pl_assert(num_jobs <= PL_ARRAY_SIZE(spirv_jobs));
+
+    uint64_t prev = 0;
+    for (int i = 0; i < num_jobs; i++) {
+        struct d3d_stage_job *job = &jobs[i];
+        job->hlsl_obj.key = hlsl_cache_key(gpu, job->stage, job->glsl, prev);
+        pl_hash_merge(&prev, pl_str0_hash(job->glsl));
+        if (cache && pl_cache_get(cache, &job->hlsl_obj)) {
+            if (hlsl_cache_valid(&job->hlsl_obj)) {
+                PL_DEBUG(gpu, "Re-using cached HLSL for %s shader",
+                         shader_names[job->stage]);
+                continue;
+            }
+            pl_cache_obj_free(&job->hlsl_obj);
+        }
+
+        job->spirv_obj.key = CACHE_KEY_SPIRV;
+        pl_hash_merge(&job->spirv_obj.key, p->spirv->signature);
+        pl_hash_merge(&job->spirv_obj.key, pl_str0_hash(job->glsl));
+        if (cache && pl_cache_get(cache, &job->spirv_obj)) {
+            PL_DEBUG(gpu, "Re-using cached SPIR-V for %s shader",
+                     shader_names[job->stage]);
+            continue;
+        }
+
+        spirv_jobs[num_spirv] = (struct pl_spirv_job) {
+            .stage  = job->stage,
+            .shader = job->glsl,
+        };
+        spirv_idx[num_spirv++] = i;
+    }
+
+    if (num_spirv) {
+        pl_clock_t start = pl_clock_now();
+        bool spirv_ok = pl_spirv_compile_glsl_batch(p->spirv, NULL, gpu->glsl,
+                                                    spirv_jobs, num_spirv);
+        pl_log_cpu_time(gpu->log, start, pl_clock_now(), "translating GLSL to SPIR-V");
+        for (int i = 0; i < num_spirv; i++) {
+            pl_cache_obj *obj = &jobs[spirv_idx[i]].spirv_obj;
+            obj->data = spirv_jobs[i].spirv.buf;
+            obj->size = spirv_jobs[i].spirv.len;
+            obj->free = pl_free;
+        }
+        if (!spirv_ok)
+            goto error;
+    }
+
+    // Register allocation depends on the preceding stages, so this has to
+    // happen in order
+    for (int i = 0; i < num_jobs; i++) {
+        struct d3d_stage_job *job = &jobs[i];
+        if (job->hlsl_obj.size) {
+            job->hlsl = hlsl_cache_load(pass, job->pass_s, &job->hlsl_obj);
+            continue;
+        }
+
+        pl_str spirv = { job->spirv_obj.data, job->spirv_obj.size };
+        job->hlsl = shader_translate_spirv(gpu, pass, job->pass_s, job->stage, spirv);
+        if (!job->hlsl)
+            goto error;
+        if (cache)
+            hlsl_cache_store(cache, pass, job->hlsl_obj.key, job->pass_s, job->hlsl);
+    }
+
+    if (num_jobs == 1) {
+        compile_hlsl_job(&batch, 0);
+    } else {
+        pl_parallel_for(num_jobs, compile_hlsl_job, &batch);
+    }
+
+    ok = true;
+    for (int i = 0; i < num_jobs; i++)
+        ok &= !!jobs[i].out;
+
+    // fall through
+error:
+    for (int i = 0; i < num_jobs; i++) {
+        struct d3d_stage_job *job = &jobs[i];
+        // Re-insert whatever we took out of (or newly created for) the cache
+        if (cache && job->hlsl_obj.size)
+            pl_cache_set(cache, &job->hlsl_obj);
+        if (cache && job->spirv_obj.size)
+            pl_cache_set(cache, &job->spirv_obj);
+        pl_cache_obj_free(&job->hlsl_obj);
+        pl_cache_obj_free(&job->spirv_obj);
+
+        // Hold on to the main shader's HLSL, to avoid having to re-translate
+        // it every time the pass is re-specialized
+        if (ok && job->stage != GLSL_SHADER_VERTEX && pass->params.num_constants) {
+            pass_p->main_hlsl = job->hlsl;
+        } else {
+            pl_free((char *) job->hlsl);
+        }
+        job->hlsl = NULL;
+
+        if (!ok)
+            SAFE_RELEASE(job->out);
+    }
+
+    return ok;
+}
+
 void pl_d3d11_pass_destroy(pl_gpu gpu, pl_pass pass)
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
@@ -707,21 +1040,29 @@ static bool pass_create_raster(pl_gpu gpu, struct pl_pass_t *pass,
 
     pl_assert((vs_str.len == 0) == (ps_str.len == 0));
     if (vs_str.len == 0) {
-        vs_blob = shader_compile_glsl(gpu, pass, &pass_p->vertex,
-                                      GLSL_SHADER_VERTEX, params->vertex_shader);
-        if (!vs_blob)
+        struct d3d_stage_job jobs[] = {
+            {
+                .stage  = GLSL_SHADER_VERTEX,
+                .pass_s = &pass_p->vertex,
+                .glsl   = params->vertex_shader,
+            }, {
+                .stage  = GLSL_SHADER_FRAGMENT,
+                .pass_s = &pass_p->main,
+                .glsl   = params->glsl_shader,
+                .constant_data = params->constant_data,
+            },
+        };
+
+        if (!shader_compile_glsl(gpu, pass, jobs, PL_ARRAY_SIZE(jobs)))
             goto error;
 
+        vs_blob = jobs[0].out;
         vs_str = (pl_str) {
             .buf = ID3D10Blob_GetBufferPointer(vs_blob),
             .len = ID3D10Blob_GetBufferSize(vs_blob),
         };
 
-        ps_blob = shader_compile_glsl(gpu, pass, &pass_p->main,
-                                      GLSL_SHADER_FRAGMENT, params->glsl_shader);
-        if (!ps_blob)
-            goto error;
-
+        ps_blob = jobs[1].out;
         ps_str = (pl_str) {
             .buf = ID3D10Blob_GetBufferPointer(ps_blob),
             .len = ID3D10Blob_GetBufferSize(ps_blob),
@@ -804,11 +1145,18 @@ static bool pass_create_compute(pl_gpu gpu, struct pl_pass_t *pass,
         PL_DEBUG(gpu, "Using cached DXBC shader");
 
     if (cs_str.len == 0) {
-        cs_blob = shader_compile_glsl(gpu, pass, &pass_p->main,
-                                      GLSL_SHADER_COMPUTE, params->glsl_shader);
-        if (!cs_blob)
+        struct d3d_stage_job job = {
+            .stage  = GLSL_SHADER_COMPUTE,
+            .pass_s = &pass_p->main,
+            .glsl   = params->glsl_shader,
+            .constant_data = params->constant_data,
+        };
+
+        if (!shader_compile_glsl(gpu, pass, &job, 1))
             goto error;
 
+        cs_blob = job.out;
+
         cs_str = (pl_str) {
             .buf = ID3D10Blob_GetBufferPointer(cs_blob),
             .len = ID3D10Blob_GetBufferSize(cs_blob),
@@ -857,10 +1205,26 @@ const struct pl_pass_t *pl_d3d11_pass_create(pl_gpu gpu,
             goto error;
     }
 
+    if (params->num_constants) {
+        pass_p->spec_size = spec_data_size(params);
+        if (params->constant_data)
+            pass_p->spec_data = pl_memdup(pass, params->constant_data, pass_p->spec_size);
+
+        // Signature of the unspecialized shader, used to cache variants
+        struct pl_pass_params spec_params = *params;
+        spec_params.constant_data = NULL;
+        pass_p->spec_sig = pass_cache_signature(gpu, NULL, &spec_params);
+    }
+
     // Pre-allocate resource arrays to use in pl_pass_run
-    pass_p->cbv_arr = pl_calloc(pass,
-        PL_MAX(pass_p->main.cbvs.num, pass_p->vertex.cbvs.num),
-        sizeof(*pass_p->cbv_arr));
+    int num_cbvs = PL_MAX(pass_p->main.cbvs.num, pass_p->vertex.cbvs.num);
+    pass_p->cbv_arr = pl_calloc(pass, num_cbvs, sizeof(*pass_p->cbv_arr));
+    pass_p->cbv_first_arr = pl_calloc(pass, num_cbvs, sizeof(*pass_p->cbv_first_arr));
+    pass_p->cbv_count_arr = pl_calloc(pass, num_cbvs, sizeof(*pass_p->cbv_count_arr));
+    pass_p->cbuf_offsets = pl_calloc(pass, params->num_descriptors,
+                                     sizeof(*pass_p->cbuf_offsets));
+    pass_p->cbuf_slices = pl_calloc(pass, params->num_descriptors + 1,
+                                    sizeof(*pass_p->cbuf_slices));
     pass_p->srv_arr = pl_calloc(pass,
         PL_MAX(pass_p->main.srvs.num, pass_p->vertex.srvs.num),
         sizeof(*pass_p->srv_arr));
@@ -919,11 +1283,74 @@ error:
     return NULL;
 }
 
+// Upload the contents of every uniform buffer used by the pass (and the
+// gl_NumWorkGroups data) to the constant buffer ring with a single map, which
+// is much cheaper than an UpdateSubresource per buffer. Returns false if the
+// ring can't be used for this pass, in which case the buffers are bound as-is.
+static bool upload_cbufs(pl_gpu gpu, const struct pl_pass_run_params *params)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    pl_pass pass = params->pass;
+    struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
+    if (!p->cbuf_ring)
+        return false;
+
+    // Only buffers with a system memory mirror can be uploaded this way
+    int num_slices = 0;
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        if (pass->params.descriptors[i].type != PL_DESC_BUF_UNIFORM)
+            continue;
+        struct pl_buf_d3d11 *buf_p = PL_PRIV(params->desc_bindings[i].object);
+        if (!buf_p->data)
+            return false;
+        num_slices++;
+    }
+
+    if (pass_p->num_workgroups_used)
+        num_slices++;
+    if (!num_slices)
+        return false;
+
+    struct stream_buf_slice *slices = pass_p->cbuf_slices;
+    int idx = 0;
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        if (pass->params.descriptors[i].type != PL_DESC_BUF_UNIFORM)
+            continue;
+        pl_buf buf = params->desc_bindings[i].object;
+        struct pl_buf_d3d11 *buf_p = PL_PRIV(buf);
+        slices[idx++] = (struct stream_buf_slice) {
+            .data = buf_p->data,
+            .size = PL_ALIGN2(buf->params.size, CBUF_ELEM),
+        };
+    }
+
+    if (pass_p->num_workgroups_used) {
+        slices[idx++] = (struct stream_buf_slice) {
+            .data = &pass_p->last_num_wgs,
+            .size = sizeof(pass_p->last_num_wgs),
+        };
+    }
+
+    if (!stream_buf_upload(gpu, &p->cbuf, slices, num_slices))
+        return false;
+
+    idx = 0;
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        if (pass->params.descriptors[i].type == PL_DESC_BUF_UNIFORM)
+            pass_p->cbuf_offsets[i] = slices[idx++].offset;
+    }
+    if (pass_p->num_workgroups_used)
+        pass_p->num_wgs_offset = slices[idx].offset;
+
+    return true;
+}
+
 // Shared logic between VS, PS and CS for filling the resource arrays that are
-// passed to ID3D11DeviceContext methods
+// passed to ID3D11DeviceContext methods. If `ring` is set, constant buffers
+// are bound from the constant buffer ring filled by `upload_cbufs`.
 static void fill_resources(pl_gpu gpu, pl_pass pass,
                            struct d3d_pass_stage *pass_s,
-                           const struct pl_pass_run_params *params,
+                           const struct pl_pass_run_params *params, bool ring,
                            ID3D11Buffer **cbvs, ID3D11ShaderResourceView **srvs,
                            ID3D11SamplerState **samplers)
 {
@@ -932,6 +1359,25 @@ static void fill_resources(pl_gpu gpu, pl_pass pass,
 
     for (int i = 0; i < pass_s->cbvs.num; i++) {
         int binding = pass_s->cbvs.elem[i];
+        if (ring && binding != HLSL_BINDING_NOT_USED) {
+            size_t size = sizeof(pass_p->last_num_wgs);
+            UINT offset = pass_p->num_wgs_offset;
+            if (binding >= 0) {
+                pl_buf buf = params->desc_bindings[binding].object;
+                size = buf->params.size;
+                offset = pass_p->cbuf_offsets[binding];
+            }
+
+            cbvs[i] = p->cbuf.buf;
+            pass_p->cbv_first_arr[i] = offset / CBUF_ELEM;
+            pass_p->cbv_count_arr[i] = PL_ALIGN2(size, CBUF_RING_ALIGN) / CBUF_ELEM;
+            continue;
+        }
+
+        // Unused slots must have a valid range in *SetConstantBuffers1
+        pass_p->cbv_first_arr[i] = 0;
+        pass_p->cbv_count_arr[i] = CBUF_RING_ALIGN / CBUF_ELEM;
+
         if (binding == HLSL_BINDING_NUM_WORKGROUPS) {
             cbvs[i] = pass_p->num_workgroups_buf;
             continue;
@@ -941,7 +1387,7 @@ static void fill_resources(pl_gpu gpu, pl_pass pass,
         }
 
         pl_buf buf = params->desc_bindings[binding].object;
-        pl_d3d11_buf_resolve(gpu, buf);
+        pl_d3d11_buf_resolve(PL_DEF(p->dc, p->imm), buf);
         struct pl_buf_d3d11 *buf_p = PL_PRIV(buf);
         cbvs[i] = buf_p->buf;
     }
@@ -1033,6 +1479,7 @@ static void fill_uavs(pl_pass pass, const struct pl_pass_run_params *params,
 static void pass_run_raster(pl_gpu gpu, const struct pl_pass_run_params *params)
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    ID3D11DeviceContext *dctx = PL_DEF(p->dc, p->imm);
     pl_pass pass = params->pass;
     struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
 
@@ -1076,11 +1523,11 @@ static void pass_run_raster(pl_gpu gpu, const struct pl_pass_run_params *params)
         }
 
         if (vertex_alloc) {
-            ID3D11DeviceContext_IASetVertexBuffers(p->imm, 0, 1, &p->vbuf.buf,
+            ID3D11DeviceContext_IASetVertexBuffers(dctx, 0, 1, &p->vbuf.buf,
                 &(UINT) { pass->params.vertex_stride }, &slices[0].offset);
         }
         if (share_vertex_index_buf && index_alloc) {
-            ID3D11DeviceContext_IASetIndexBuffer(p->imm, p->vbuf.buf,
+            ID3D11DeviceContext_IASetIndexBuffer(dctx, p->vbuf.buf,
                 index_fmts[params->index_fmt], slices[1].offset);
         }
     }
@@ -1096,51 +1543,58 @@ static void pass_run_raster(pl_gpu gpu, const struct pl_pass_run_params *params)
             return;
         }
 
-        ID3D11DeviceContext_IASetIndexBuffer(p->imm, p->ibuf.buf,
+        ID3D11DeviceContext_IASetIndexBuffer(dctx, p->ibuf.buf,
             index_fmts[params->index_fmt], slices[0].offset);
     }
 
     if (params->vertex_buf) {
         struct pl_buf_d3d11 *buf_p = PL_PRIV(params->vertex_buf);
-        ID3D11DeviceContext_IASetVertexBuffers(p->imm, 0, 1, &buf_p->buf,
+        ID3D11DeviceContext_IASetVertexBuffers(dctx, 0, 1, &buf_p->buf,
             &(UINT) { pass->params.vertex_stride },
             &(UINT) { params->buf_offset });
     }
 
     if (params->index_buf) {
         struct pl_buf_d3d11 *buf_p = PL_PRIV(params->index_buf);
-        ID3D11DeviceContext_IASetIndexBuffer(p->imm, buf_p->buf,
+        ID3D11DeviceContext_IASetIndexBuffer(dctx, buf_p->buf,
             index_fmts[params->index_fmt], params->index_offset);
     }
 
-    ID3D11DeviceContext_IASetInputLayout(p->imm, pass_p->layout);
+    ID3D11DeviceContext_IASetInputLayout(dctx, pass_p->layout);
 
     static const D3D_PRIMITIVE_TOPOLOGY prim_topology[] = {
         [PL_PRIM_TRIANGLE_LIST] = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST,
         [PL_PRIM_TRIANGLE_STRIP] = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP,
     };
-    ID3D11DeviceContext_IASetPrimitiveTopology(p->imm,
+    ID3D11DeviceContext_IASetPrimitiveTopology(dctx,
         prim_topology[pass->params.vertex_type]);
 
-    ID3D11DeviceContext_VSSetShader(p->imm, pass_p->vs, NULL, 0);
+    ID3D11DeviceContext_VSSetShader(dctx, pass_p->vs, NULL, 0);
 
     ID3D11Buffer **cbvs = pass_p->cbv_arr;
+    UINT *cbv_first = pass_p->cbv_first_arr, *cbv_count = pass_p->cbv_count_arr;
     ID3D11ShaderResourceView **srvs = pass_p->srv_arr;
     ID3D11SamplerState **samplers = pass_p->sampler_arr;
     ID3D11UnorderedAccessView **uavs = pass_p->uav_arr;
+    ID3D11DeviceContext1 *dctx1 = PL_DEF(p->dc1, p->imm1);
+    bool ring = upload_cbufs(gpu, params);
 
     // Set vertex shader resources. The device context is called conditionally
     // because the debug layer complains if these are called with 0 resources.
-    fill_resources(gpu, pass, &pass_p->vertex, params, cbvs, srvs, samplers);
-    if (pass_p->vertex.cbvs.num)
-        ID3D11DeviceContext_VSSetConstantBuffers(p->imm, 0, pass_p->vertex.cbvs.num, cbvs);
+    fill_resources(gpu, pass, &pass_p->vertex, params, ring, cbvs, srvs, samplers);
+    if (pass_p->vertex.cbvs.num && ring) {
+        ID3D11DeviceContext1_VSSetConstantBuffers1(dctx1, 0, pass_p->vertex.cbvs.num,
+                                                   cbvs, cbv_first, cbv_count);
+    } else if (pass_p->vertex.cbvs.num) {
+        ID3D11DeviceContext_VSSetConstantBuffers(dctx, 0, pass_p->vertex.cbvs.num, cbvs);
+    }
     if (pass_p->vertex.srvs.num)
-        ID3D11DeviceContext_VSSetShaderResources(p->imm, 0, pass_p->vertex.srvs.num, srvs);
+        ID3D11DeviceContext_VSSetShaderResources(dctx, 0, pass_p->vertex.srvs.num, srvs);
     if (pass_p->vertex.samplers.num)
-        ID3D11DeviceContext_VSSetSamplers(p->imm, 0, pass_p->vertex.samplers.num, samplers);
+        ID3D11DeviceContext_VSSetSamplers(dctx, 0, pass_p->vertex.samplers.num, samplers);
 
-    ID3D11DeviceContext_RSSetState(p->imm, p->rstate);
-    ID3D11DeviceContext_RSSetViewports(p->imm, 1, (&(D3D11_VIEWPORT) {
+    ID3D11DeviceContext_RSSetState(dctx, p->rstate);
+    ID3D11DeviceContext_RSSetViewports(dctx, 1, (&(D3D11_VIEWPORT) {
         .TopLeftX = params->viewport.x0,
         .TopLeftY = params->viewport.y0,
         .Width = pl_rect_w(params->viewport),
@@ -1148,38 +1602,42 @@ static void pass_run_raster(pl_gpu gpu, const struct pl_pass_run_params *params)
         .MinDepth = 0,
         .MaxDepth = 1,
     }));
-    ID3D11DeviceContext_RSSetScissorRects(p->imm, 1, (&(D3D11_RECT) {
+    ID3D11DeviceContext_RSSetScissorRects(dctx, 1, (&(D3D11_RECT) {
         .left = params->scissors.x0,
         .top = params->scissors.y0,
         .right = params->scissors.x1,
         .bottom = params->scissors.y1,
     }));
 
-    ID3D11DeviceContext_PSSetShader(p->imm, pass_p->ps, NULL, 0);
+    ID3D11DeviceContext_PSSetShader(dctx, pass_p->ps, NULL, 0);
 
     // Set pixel shader resources
-    fill_resources(gpu, pass, &pass_p->main, params, cbvs, srvs, samplers);
-    if (pass_p->main.cbvs.num)
-        ID3D11DeviceContext_PSSetConstantBuffers(p->imm, 0, pass_p->main.cbvs.num, cbvs);
+    fill_resources(gpu, pass, &pass_p->main, params, ring, cbvs, srvs, samplers);
+    if (pass_p->main.cbvs.num && ring) {
+        ID3D11DeviceContext1_PSSetConstantBuffers1(dctx1, 0, pass_p->main.cbvs.num,
+                                                   cbvs, cbv_first, cbv_count);
+    } else if (pass_p->main.cbvs.num) {
+        ID3D11DeviceContext_PSSetConstantBuffers(dctx, 0, pass_p->main.cbvs.num, cbvs);
+    }
     if (pass_p->main.srvs.num)
-        ID3D11DeviceContext_PSSetShaderResources(p->imm, 0, pass_p->main.srvs.num, srvs);
+        ID3D11DeviceContext_PSSetShaderResources(dctx, 0, pass_p->main.srvs.num, srvs);
     if (pass_p->main.samplers.num)
-        ID3D11DeviceContext_PSSetSamplers(p->imm, 0, pass_p->main.samplers.num, samplers);
+        ID3D11DeviceContext_PSSetSamplers(dctx, 0, pass_p->main.samplers.num, samplers);
 
-    ID3D11DeviceContext_OMSetBlendState(p->imm, pass_p->bstate, NULL,
+    ID3D11DeviceContext_OMSetBlendState(dctx, pass_p->bstate, NULL,
                                         D3D11_DEFAULT_SAMPLE_MASK);
-    ID3D11DeviceContext_OMSetDepthStencilState(p->imm, p->dsstate, 0);
+    ID3D11DeviceContext_OMSetDepthStencilState(dctx, p->dsstate, 0);
 
     fill_uavs(pass, params, uavs);
 
     struct pl_tex_d3d11 *target_p = PL_PRIV(params->target);
     ID3D11DeviceContext_OMSetRenderTargetsAndUnorderedAccessViews(
-        p->imm, 1, &target_p->rtv, NULL, 1, pass_p->uavs.num, uavs, NULL);
+        dctx, 1, &target_p->rtv, NULL, 1, pass_p->uavs.num, uavs, NULL);
 
     if (params->index_data || params->index_buf) {
-        ID3D11DeviceContext_DrawIndexed(p->imm, params->vertex_count, 0, 0);
+        ID3D11DeviceContext_DrawIndexed(dctx, params->vertex_count, 0, 0);
     } else {
-        ID3D11DeviceContext_Draw(p->imm, params->vertex_count, 0);
+        ID3D11DeviceContext_Draw(dctx, params->vertex_count, 0);
     }
 
     // Unbind everything. It's easier to do this than to actually track state,
@@ -1195,63 +1653,73 @@ static void pass_run_raster(pl_gpu gpu, const struct pl_pass_run_params *params)
     for (int i = 0; i < pass_p->uavs.num; i++)
         uavs[i] = NULL;
     if (pass_p->vertex.cbvs.num)
-        ID3D11DeviceContext_VSSetConstantBuffers(p->imm, 0, pass_p->vertex.cbvs.num, cbvs);
+        ID3D11DeviceContext_VSSetConstantBuffers(dctx, 0, pass_p->vertex.cbvs.num, cbvs);
     if (pass_p->vertex.srvs.num)
-        ID3D11DeviceContext_VSSetShaderResources(p->imm, 0, pass_p->vertex.srvs.num, srvs);
+        ID3D11DeviceContext_VSSetShaderResources(dctx, 0, pass_p->vertex.srvs.num, srvs);
     if (pass_p->vertex.samplers.num)
-        ID3D11DeviceContext_VSSetSamplers(p->imm, 0, pass_p->vertex.samplers.num, samplers);
+        ID3D11DeviceContext_VSSetSamplers(dctx, 0, pass_p->vertex.samplers.num, samplers);
     if (pass_p->main.cbvs.num)
-        ID3D11DeviceContext_PSSetConstantBuffers(p->imm, 0, pass_p->main.cbvs.num, cbvs);
+        ID3D11DeviceContext_PSSetConstantBuffers(dctx, 0, pass_p->main.cbvs.num, cbvs);
     if (pass_p->main.srvs.num)
-        ID3D11DeviceContext_PSSetShaderResources(p->imm, 0, pass_p->main.srvs.num, srvs);
+        ID3D11DeviceContext_PSSetShaderResources(dctx, 0, pass_p->main.srvs.num, srvs);
     if (pass_p->main.samplers.num)
-        ID3D11DeviceContext_PSSetSamplers(p->imm, 0, pass_p->main.samplers.num, samplers);
+        ID3D11DeviceContext_PSSetSamplers(dctx, 0, pass_p->main.samplers.num, samplers);
     ID3D11DeviceContext_OMSetRenderTargetsAndUnorderedAccessViews(
-        p->imm, 0, NULL, NULL, 1, pass_p->uavs.num, uavs, NULL);
+        dctx, 0, NULL, NULL, 1, pass_p->uavs.num, uavs, NULL);
 }
 
 static void pass_run_compute(pl_gpu gpu, const struct pl_pass_run_params *params)
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    ID3D11DeviceContext *dctx = PL_DEF(p->dc, p->imm);
     pl_pass pass = params->pass;
     struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
 
-    // Update gl_NumWorkGroups emulation buffer if necessary
+    // Update gl_NumWorkGroups emulation data. The buffer is only needed if
+    // the constant buffer ring can't be used, and is stale if it was used
+    // for the last run.
+    bool needs_update = pass_p->cbuf_ring_used;
     if (pass_p->num_workgroups_used) {
-        bool needs_update = false;
         for (int i = 0; i < 3; i++) {
             if (pass_p->last_num_wgs.num_wgs[i] != params->compute_groups[i])
                 needs_update = true;
             pass_p->last_num_wgs.num_wgs[i] = params->compute_groups[i];
         }
+    }
 
-        if (needs_update) {
-            ID3D11DeviceContext_UpdateSubresource(p->imm,
-                (ID3D11Resource *) pass_p->num_workgroups_buf, 0, NULL,
-                &pass_p->last_num_wgs, 0, 0);
-        }
+    bool ring = upload_cbufs(gpu, params);
+    if (pass_p->num_workgroups_used && needs_update && !ring) {
+        ID3D11DeviceContext_UpdateSubresource(dctx,
+            (ID3D11Resource *) pass_p->num_workgroups_buf, 0, NULL,
+            &pass_p->last_num_wgs, 0, 0);
     }
+    pass_p->cbuf_ring_used = ring;
 
-    ID3D11DeviceContext_CSSetShader(p->imm, pass_p->cs, NULL, 0);
+    ID3D11DeviceContext_CSSetShader(dctx, pass_p->cs, NULL, 0);
 
     ID3D11Buffer **cbvs = pass_p->cbv_arr;
     ID3D11ShaderResourceView **srvs = pass_p->srv_arr;
     ID3D11UnorderedAccessView **uavs = pass_p->uav_arr;
     ID3D11SamplerState **samplers = pass_p->sampler_arr;
 
-    fill_resources(gpu, pass, &pass_p->main, params, cbvs, srvs, samplers);
+    fill_resources(gpu, pass, &pass_p->main, params, ring, cbvs, srvs, samplers);
     fill_uavs(pass, params, uavs);
 
-    if (pass_p->main.cbvs.num)
-        ID3D11DeviceContext_CSSetConstantBuffers(p->imm, 0, pass_p->main.cbvs.num, cbvs);
+    if (pass_p->main.cbvs.num && ring) {
+        ID3D11DeviceContext1_CSSetConstantBuffers1(PL_DEF(p->dc1, p->imm1), 0,
+            pass_p->main.cbvs.num, cbvs, pass_p->cbv_first_arr,
+            pass_p->cbv_count_arr);
+    } else if (pass_p->main.cbvs.num) {
+        ID3D11DeviceContext_CSSetConstantBuffers(dctx, 0, pass_p->main.cbvs.num, cbvs);
+    }
     if (pass_p->main.srvs.num)
-        ID3D11DeviceContext_CSSetShaderResources(p->imm, 0, pass_p->main.srvs.num, srvs);
+        ID3D11DeviceContext_CSSetShaderResources(dctx, 0, pass_p->main.srvs.num, srvs);
     if (pass_p->main.samplers.num)
-        ID3D11DeviceContext_CSSetSamplers(p->imm, 0, pass_p->main.samplers.num, samplers);
+        ID3D11DeviceContext_CSSetSamplers(dctx, 0, pass_p->main.samplers.num, samplers);
     if (pass_p->uavs.num)
-        ID3D11DeviceContext_CSSetUnorderedAccessViews(p->imm, 0, pass_p->uavs.num, uavs, NULL);
+        ID3D11DeviceContext_CSSetUnorderedAccessViews(dctx, 0, pass_p->uavs.num, uavs, NULL);
 
-    ID3D11DeviceContext_Dispatch(p->imm, params->compute_groups[0],
+    ID3D11DeviceContext_Dispatch(dctx, params->compute_groups[0],
                                          params->compute_groups[1],
                                          params->compute_groups[2]);
 
@@ -1265,13 +1733,75 @@ static void pass_run_compute(pl_gpu gpu, const struct pl_pass_run_params *params
     for (int i = 0; i < pass_p->uavs.num; i++)
         uavs[i] = NULL;
     if (pass_p->main.cbvs.num)
-        ID3D11DeviceContext_CSSetConstantBuffers(p->imm, 0, pass_p->main.cbvs.num, cbvs);
+        ID3D11DeviceContext_CSSetConstantBuffers(dctx, 0, pass_p->main.cbvs.num, cbvs);
     if (pass_p->main.srvs.num)
-        ID3D11DeviceContext_CSSetShaderResources(p->imm, 0, pass_p->main.srvs.num, srvs);
+        ID3D11DeviceContext_CSSetShaderResources(dctx, 0, pass_p->main.srvs.num, srvs);
     if (pass_p->main.samplers.num)
-        ID3D11DeviceContext_CSSetSamplers(p->imm, 0, pass_p->main.samplers.num, samplers);
+        ID3D11DeviceContext_CSSetSamplers(dctx, 0, pass_p->main.samplers.num, samplers);
     if (pass_p->uavs.num)
-        ID3D11DeviceContext_CSSetUnorderedAccessViews(p->imm, 0, pass_p->uavs.num, uavs, NULL);
+        ID3D11DeviceContext_CSSetUnorderedAccessViews(dctx, 0, pass_p->uavs.num, uavs, NULL);
+}
+
+// Recompiles the main shader with new specialization constant values. Only
+// the HLSL to DXBC step needs to be redone, and previously seen variants are
+// loaded straight from the cache.
+static bool pass_respecialize(pl_gpu gpu, pl_pass pass, const void *constant_data)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    struct d3d11_ctx *ctx = p->ctx;
+    struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
+    const pl_cache gpu_cache = pl_gpu_cache(gpu);
+    bool is_compute = pass->params.type == PL_PASS_COMPUTE;
+    ID3D11PixelShader *ps = NULL;
+    ID3D11ComputeShader *cs = NULL;
+    ID3DBlob *blob = NULL;
+    bool success = false;
+
+    pl_cache_obj obj = { .key = pass_p->spec_sig };
+    pl_hash_merge(&obj.key, pl_mem_hash(constant_data, pass_p->spec_size));
+
+    pl_str bc = {0};
+    if (gpu_cache && pl_cache_get(gpu_cache, &obj)) {
+        PL_TRACE(gpu, "Using cached DXBC shader variant");
+        bc = (pl_str) { obj.data, obj.size };
+    } else {
+        if (!pass_p->main_hlsl) {
+            PL_ERR(gpu, "Missing HLSL source for shader re-specialization!");
+            goto error;
+        }
+
+        blob = shader_compile_hlsl(gpu, pass, is_compute ? GLSL_SHADER_COMPUTE
+                                                         : GLSL_SHADER_FRAGMENT,
+                                   pass_p->main_hlsl, constant_data);
+        if (!blob)
+            goto error;
+
+        bc = (pl_str) {
+            .buf = ID3D10Blob_GetBufferPointer(blob),
+            .len = ID3D10Blob_GetBufferSize(blob),
+        };
+    }
+
+    if (is_compute) {
+        D3D(ID3D11Device_CreateComputeShader(p->dev, bc.buf, bc.len, NULL, &cs));
+        SAFE_RELEASE(pass_p->cs);
+        pass_p->cs = cs;
+    } else {
+        D3D(ID3D11Device_CreatePixelShader(p->dev, bc.buf, bc.len, NULL, &ps));
+        SAFE_RELEASE(pass_p->ps);
+        pass_p->ps = ps;
+    }
+
+    if (blob && gpu_cache) {
+        pl_str data = pl_str_dup(NULL, bc);
+        pl_cache_str(gpu_cache, obj.key, &data);
+    }
+
+    success = true;
+error:
+    pl_cache_obj_free(&obj);
+    SAFE_RELEASE(blob);
+    return success;
 }
 
 void pl_d3d11_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
@@ -1279,8 +1809,22 @@ void pl_d3d11_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
     struct d3d11_ctx *ctx = p->ctx;
     pl_pass pass = params->pass;
+    struct pl_pass_d3d11 *pass_p = PL_PRIV(pass);
+
+    // Check if we need to re-specialize this pass. On failure, the previous
+    // variant is kept around, since there is no way to report errors here
+    if (pass_p->spec_size && params->constant_data) {
+        bool changed = !pass_p->spec_data || memcmp(pass_p->spec_data,
+                            params->constant_data, pass_p->spec_size) != 0;
+        if (changed && pass_respecialize(gpu, pass, params->constant_data)) {
+            if (!pass_p->spec_data)
+                pass_p->spec_data = pl_alloc((void *) pass, pass_p->spec_size);
+            memcpy(pass_p->spec_data, params->constant_data, pass_p->spec_size);
+        }
+    }
 
-    pl_d3d11_timer_start(gpu, params->timer);
+    ID3D11DeviceContext *dctx = PL_DEF(p->dc, p->imm);
+    pl_d3d11_timer_start(gpu, dctx, params->timer);
 
     if (pass->params.type == PL_PASS_COMPUTE) {
         pass_run_compute(gpu, params);
@@ -1288,6 +1832,8 @@ void pl_d3d11_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
         pass_run_raster(gpu, params);
     }
 
-    pl_d3d11_timer_end(gpu, params->timer);
+    pl_d3d11_timer_end(gpu, dctx, params->timer);
+    if (p->dc)
+        p->dc_pending = true;
     pl_d3d11_flush_message_queue(ctx, "After pass run");
 }
@@ -17,6 +17,7 @@
 
 #include "gpu.h"
 #include "formats.h"
+#include "../pl_memcpy.h"
 
 static inline UINT tex_subresource(pl_tex tex)
 {
@@ -155,6 +156,8 @@ void pl_d3d11_tex_destroy(pl_gpu gpu, pl_tex tex)
     SAFE_RELEASE(tex_p->uav);
     SAFE_RELEASE(tex_p->res);
     SAFE_RELEASE(tex_p->staging);
+    for (int i = 0; i < tex_p->num_upload_ring; i++)
+        SAFE_RELEASE(tex_p->upload_ring[i]);
 
     pl_d3d11_flush_message_queue(ctx, "After texture destroy");
 
@@ -515,6 +518,8 @@ void pl_d3d11_tex_invalidate(pl_gpu gpu, pl_tex tex)
     if (!p->imm1)
         return;
 
+    pl_d3d11_submit_deferred(gpu);
+
     // Prefer discarding a view to discarding the whole resource. The reason
     // for this is that a pl_tex can refer to a single member of a texture
     // array. Discarding the SRV, RTV or UAV should only discard that member.
@@ -540,6 +545,7 @@ void pl_d3d11_tex_clear_ex(pl_gpu gpu, pl_tex tex,
     struct d3d11_ctx *ctx = p->ctx;
     struct pl_tex_d3d11 *tex_p = PL_PRIV(tex);
 
+    pl_d3d11_submit_deferred(gpu);
     if (tex->params.format->type == PL_FMT_UINT) {
         if (tex_p->uav) {
             ID3D11DeviceContext_ClearUnorderedAccessViewUint(p->imm, tex_p->uav,
@@ -589,6 +595,7 @@ void pl_d3d11_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params)
         pl_rect3d rc = params->src_rc;
         pl_rect3d_normalize(&rc);
 
+        pl_d3d11_submit_deferred(gpu);
         ID3D11DeviceContext_CopySubresourceRegion(p->imm, dst_p->res,
             tex_subresource(params->dst), rc.x0, rc.y0, rc.z0, src_p->res,
             tex_subresource(params->src), &pl_rect3d_to_box(rc));
@@ -602,6 +609,141 @@ void pl_d3d11_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params)
     pl_d3d11_flush_message_queue(ctx, "After texture blit");
 }
 
+static ID3D11Resource *create_upload_staging(pl_gpu gpu, pl_tex tex)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    struct d3d11_ctx *ctx = p->ctx;
+    struct pl_tex_d3d11 *tex_p = PL_PRIV(tex);
+
+    // Staging textures must match the subresource being copied to, which
+    // might be part of a wrapped array or mipmapped texture
+    switch (pl_tex_params_dimension(tex->params)) {
+    case 1: {
+        D3D11_TEXTURE1D_DESC desc;
+        ID3D11Texture1D_GetDesc(tex_p->tex1d, &desc);
+        desc.Width = tex->params.w;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.BindFlags = 0;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags = 0;
+
+        ID3D11Texture1D *staging = NULL;
+        D3D(ID3D11Device_CreateTexture1D(p->dev, &desc, NULL, &staging));
+        return (ID3D11Resource *) staging;
+    }
+    case 2: {
+        D3D11_TEXTURE2D_DESC desc;
+        ID3D11Texture2D_GetDesc(tex_p->tex2d, &desc);
+        desc.Width = tex->params.w;
+        desc.Height = tex->params.h;
+        desc.MipLevels = 1;
+        desc.ArraySize = 1;
+        desc.SampleDesc.Count = 1;
+        desc.SampleDesc.Quality = 0;
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.BindFlags = 0;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags = 0;
+
+        ID3D11Texture2D *staging = NULL;
+        D3D(ID3D11Device_CreateTexture2D(p->dev, &desc, NULL, &staging));
+        return (ID3D11Resource *) staging;
+    }
+    case 3: {
+        D3D11_TEXTURE3D_DESC desc;
+        ID3D11Texture3D_GetDesc(tex_p->tex3d, &desc);
+        desc.Width = tex->params.w;
+        desc.Height = tex->params.h;
+        desc.Depth = tex->params.d;
+        desc.MipLevels = 1;
+        desc.Usage = D3D11_USAGE_STAGING;
+        desc.BindFlags = 0;
+        desc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+        desc.MiscFlags = 0;
+
+        ID3D11Texture3D *staging = NULL;
+        D3D(ID3D11Device_CreateTexture3D(p->dev, &desc, NULL, &staging));
+        return (ID3D11Resource *) staging;
+    }
+    default:
+        pl_unreachable();
+    }
+
+error:
+    return NULL;
+}
+
+// Upload via a ring of staging textures followed by CopySubresourceRegion.
+// Unlike UpdateSubresource, this doesn't need to go through driver-internal
+// memory, and only blocks if all staging textures are still in use by the GPU.
+static bool tex_upload_staging(pl_gpu gpu, const struct pl_tex_transfer_params *params)
+{
+    struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
+    struct d3d11_ctx *ctx = p->ctx;
+    pl_tex tex = params->tex;
+    struct pl_tex_d3d11 *tex_p = PL_PRIV(tex);
+    const int ring_size = PL_ARRAY_SIZE(tex_p->upload_ring);
+    D3D11_MAPPED_SUBRESOURCE map = {0};
+    ID3D11Resource *staging = NULL;
+    HRESULT hr;
+
+    // Staging textures can't be mapped with D3D11_MAP_WRITE_NO_OVERWRITE, so
+    // probe the existing ones in order, starting with the oldest
+    for (int i = 0; i < tex_p->num_upload_ring; i++) {
+        int idx = (tex_p->upload_idx + i) % tex_p->num_upload_ring;
+        hr = ID3D11DeviceContext_Map(p->imm, tex_p->upload_ring[idx], 0,
+                                     D3D11_MAP_WRITE, D3D11_MAP_FLAG_DO_NOT_WAIT,
+                                     &map);
+        if (hr == DXGI_ERROR_WAS_STILL_DRAWING)
+            continue;
+        D3D(hr);
+        staging = tex_p->upload_ring[idx];
+        tex_p->upload_idx = (idx + 1) % tex_p->num_upload_ring;
+        break;
+    }
+
+    if (!staging && tex_p->num_upload_ring < ring_size) {
+        // All busy, add a new staging texture to the ring
+        staging = create_upload_staging(gpu, tex);
+        if (!staging)
+            goto error;
+        D3D(ID3D11DeviceContext_Map(p->imm, staging, 0, D3D11_MAP_WRITE, 0, &map));
+        tex_p->upload_ring[tex_p->num_upload_ring++] = staging;
+        tex_p->upload_idx = 0;
+    } else if (!staging) {
+        // Ring is full, block on the oldest staging texture
+        PL_TRACE(gpu, "All upload staging textures busy! ...blocking (slow path)");
+        int idx = tex_p->upload_idx;
+        D3D(ID3D11DeviceContext_Map(p->imm, tex_p->upload_ring[idx], 0,
+                                    D3D11_MAP_WRITE, 0, &map));
+        staging = tex_p->upload_ring[idx];
+        tex_p->upload_idx = (idx + 1) % tex_p->num_upload_ring;
+    }
+
+    const pl_rect3d rc = params->rc;
+    const size_t texel_size = tex->params.format->texel_size;
+    const size_t line_size = pl_rect_w(rc) * texel_size;
+    const char *csrc = params->ptr;
+    char *cdst = map.pData;
+    for (int z = 0; z < pl_rect_d(rc); z++) {
+        pl_memcpy_2d(cdst + (rc.z0 + z) * map.DepthPitch + rc.y0 * map.RowPitch +
+                            rc.x0 * texel_size, map.RowPitch,
+                     csrc + z * params->depth_pitch, params->row_pitch,
+                     line_size, pl_rect_h(rc), true);
+    }
+
+    ID3D11DeviceContext_Unmap(p->imm, staging, 0);
+    ID3D11DeviceContext_CopySubresourceRegion(p->imm, tex_p->res,
+        tex_subresource(tex), rc.x0, rc.y0, rc.z0, staging, 0,
+        &pl_rect3d_to_box(rc));
+    return true;
+
+error:
+    return false;
+}
+
 bool pl_d3d11_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params)
 {
     struct pl_gpu_d3d11 *p = PL_PRIV(gpu);
@@ -612,7 +754,9 @@ bool pl_d3d11_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params
     struct pl_tex_transfer_params *slices = NULL;
     bool ret = false;
 
-    pl_d3d11_timer_start(gpu, params->timer);
+    pl_d3d11_poll_callbacks(gpu);
+    pl_d3d11_submit_deferred(gpu);
+    pl_d3d11_timer_start(gpu, p->imm, params->timer);
 
     if (fmt->emulated) {
 
@@ -641,6 +785,12 @@ bool pl_d3d11_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params
                 goto error;
         }
 
+    } else if (tex_p->num_uploads++ > 0 && tex_upload_staging(gpu, params)) {
+
+        // Textures which are only uploaded once (e.g. LUTs) don't warrant the
+        // extra memory of a staging texture, so the first upload always uses
+        // UpdateSubresource below
+
     } else {
 
         ID3D11DeviceContext_UpdateSubresource(p->imm, tex_p->res,
@@ -649,10 +799,17 @@ bool pl_d3d11_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params
 
     }
 
+    // The source data has already been copied at this point, but the
+    // callback is still deferred until the GPU has finished the transfer
+    if (params->callback)
+        pl_d3d11_queue_callback(gpu, params->callback, params->priv);
+
     ret = true;
 
 error:
-    pl_d3d11_timer_end(gpu, params->timer);
+    // Emulated formats are transferred by passes recorded on `dc`
+    pl_d3d11_submit_deferred(gpu);
+    pl_d3d11_timer_end(gpu, p->imm, params->timer);
     pl_d3d11_flush_message_queue(ctx, "After texture upload");
 
     pl_free(slices);
@@ -672,7 +829,9 @@ bool pl_d3d11_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *para
     if (!tex_p->staging)
         return false;
 
-    pl_d3d11_timer_start(gpu, params->timer);
+    pl_d3d11_poll_callbacks(gpu);
+    pl_d3d11_submit_deferred(gpu);
+    pl_d3d11_timer_start(gpu, p->imm, params->timer);
 
     if (fmt->emulated) {
 
@@ -734,10 +893,16 @@ bool pl_d3d11_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *para
         ID3D11DeviceContext_Unmap(p->imm, (ID3D11Resource*)tex_p->staging, 0);
     }
 
+    // Downloads are always synchronous, so this fires on the next poll
+    if (params->callback)
+        pl_d3d11_queue_callback(gpu, params->callback, params->priv);
+
     ret = true;
 
 error:
-    pl_d3d11_timer_end(gpu, params->timer);
+    // Emulated formats are transferred by passes recorded on `dc`
+    pl_d3d11_submit_deferred(gpu);
+    pl_d3d11_timer_end(gpu, p->imm, params->timer);
     pl_d3d11_flush_message_queue(ctx, "After texture download");
 
     pl_free(slices);
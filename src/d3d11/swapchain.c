@@ -94,6 +94,12 @@ struct priv {
 
     // Fallback to 8-bit RGB was triggered due to lack of compatiblity
     bool fallback_8bit_rgb;
+
+    // Frame latency waitable object, for swapchains created with
+    // DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT
+    HANDLE latency_waitable;
+    int max_latency;
+    bool waited; // whether the waitable object was waited on for this frame
 };
 
 static void d3d11_sw_destroy(pl_swapchain sw)
@@ -101,6 +107,8 @@ static void d3d11_sw_destroy(pl_swapchain sw)
     struct priv *p = PL_PRIV(sw);
 
     pl_tex_destroy(sw->gpu, &p->backbuffer);
+    if (p->latency_waitable)
+        CloseHandle(p->latency_waitable);
     SAFE_RELEASE(p->swapchain);
     pl_free((void *) sw);
 }
@@ -110,6 +118,10 @@ static int d3d11_sw_latency(pl_swapchain sw)
     struct priv *p = PL_PRIV(sw);
     struct d3d11_ctx *ctx = p->ctx;
 
+    // Waitable swapchains are exempt from the device-wide setting
+    if (p->latency_waitable)
+        return p->max_latency;
+
     UINT max_latency;
     IDXGIDevice1_GetMaximumFrameLatency(ctx->dxgi_dev, &max_latency);
     return max_latency;
@@ -208,6 +220,16 @@ static bool d3d11_sw_start_frame(pl_swapchain sw,
             return false;
     }
 
+    if (p->latency_waitable && !p->waited) {
+        // Block until the swapchain can accept a new frame. The waitable
+        // object is signalled once per Present, so only wait once per frame,
+        // even if this function fails and gets retried
+        DWORD res = WaitForSingleObjectEx(p->latency_waitable, 1000, TRUE);
+        if (res != WAIT_OBJECT_0)
+            PL_WARN(sw, "Timed out waiting for the frame latency waitable object");
+        p->waited = true;
+    }
+
     p->backbuffer = get_backbuffer(sw);
     if (!p->backbuffer)
         return false;
@@ -240,6 +262,9 @@ static bool d3d11_sw_submit_frame(pl_swapchain sw)
     struct priv *p = PL_PRIV(sw);
     struct d3d11_ctx *ctx = p->ctx;
 
+    // Rendering to the backbuffer may still be recorded on a deferred context
+    pl_d3d11_submit_deferred(sw->gpu);
+
     // Release the backbuffer. We shouldn't hold onto it unnecessarily, because
     // it prevents external code from resizing the swapchain, which we'd
     // otherwise support just fine.
@@ -254,6 +279,7 @@ static void d3d11_sw_swap_buffers(pl_swapchain sw)
     struct d3d11_ctx *ctx = p->ctx;
 
     // Present can fail with a device removed error
+    p->waited = false;
     D3D(IDXGISwapChain_Present(p->swapchain, 1, 0));
 
 error:
@@ -466,6 +492,12 @@ static HRESULT create_swapchain_1_2(struct d3d11_ctx *ctx,
         UINT max_latency;
         IDXGIDevice1_GetMaximumFrameLatency(ctx->dxgi_dev, &max_latency);
 
+        // Waitable swapchains are only supported by the flip model
+        if (params->waitable) {
+            desc.Flags |= DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+            max_latency = PL_DEF(params->max_frame_latency, 1);
+        }
+
         // Make sure we have at least enough buffers to allow `max_latency`
         // frames in-flight at once, plus one frame for the frontbuffer
         desc.BufferCount = max_latency + 1;
@@ -608,6 +640,31 @@ error:
     return swapchain;
 }
 
+static bool setup_latency_waitable(pl_swapchain sw, int max_latency)
+{
+    struct priv *p = PL_PRIV(sw);
+    struct d3d11_ctx *ctx = p->ctx;
+    IDXGISwapChain2 *swapchain2 = NULL;
+    bool success = false;
+
+    D3D(IDXGISwapChain_QueryInterface(p->swapchain, &IID_IDXGISwapChain2,
+                                      (void **) &swapchain2));
+    D3D(IDXGISwapChain2_SetMaximumFrameLatency(swapchain2, max_latency));
+
+    p->latency_waitable = IDXGISwapChain2_GetFrameLatencyWaitableObject(swapchain2);
+    if (!p->latency_waitable)
+        goto error;
+
+    p->max_latency = max_latency;
+    PL_INFO(sw, "Using frame latency waitable object, max latency: %d",
+            max_latency);
+
+    success = true;
+error:
+    SAFE_RELEASE(swapchain2);
+    return success;
+}
+
 pl_swapchain pl_d3d11_create_swapchain(pl_d3d11 d3d11,
     const struct pl_d3d11_swapchain_params *params)
 {
@@ -652,6 +709,16 @@ pl_swapchain pl_d3d11_create_swapchain(pl_d3d11 d3d11,
         PL_INFO(gpu, "Using bitblt-model presentation");
     }
 
+    // Only take over the waitable object for our own swapchains, since users
+    // wrapping a waitable swapchain are presumably waiting on it themselves
+    bool is_waitable = scd.Flags & DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT;
+    if (!params->swapchain && is_waitable &&
+        !setup_latency_waitable(sw, PL_DEF(params->max_frame_latency, 1)))
+    {
+        PL_WARN(gpu, "Failed setting up frame latency waitable object, "
+                "frame starts will not be delayed");
+    }
+
     p->csp_map.d3d11_fmt = scd.BufferDesc.Format;
 
     update_swapchain_color_config(sw, &pl_color_space_unknown, true);
@@ -16,17 +16,30 @@
  */
 
 #include "common.h"
+#include "cache.h"
 #include "log.h"
 #include "shaders.h"
 #include "dispatch.h"
 #include "gpu.h"
+#include "pl_clock.h"
 #include "pl_thread.h"
 
-// Maximum number of passes to keep around at once. If full, passes older than
-// MIN_AGE are evicted to make room. (Failing that, the passes array doubles)
+// Default maximum number of passes to keep around at once. If full, the least
+// recently used passes are evicted, as long as they are older than MIN_AGE.
 #define MAX_PASSES 100
 #define MIN_AGE 10
 
+// Maximum number of events recorded by `pl_dispatch_trace_begin`
+#define MAX_TRACE_EVENTS (1 << 20)
+
+// Number of uniform buffers each pass cycles through, one per frame in flight
+#define UBO_RING_SIZE 3
+
+// Workgroup size auto-tuning, see `pl_dispatch_autotune`
+#define TUNE_MAX_CANDS  8   // candidate group sizes per shader
+#define TUNE_SAMPLES    4   // timer results required per candidate
+#define TUNE_MAX_RUNS   128 // give up on shaders without timer results
+
 enum {
     TMP_PRELUDE,   // GLSL version, global definitions, etc.
     TMP_MAIN,      // main GLSL shader body
@@ -35,6 +48,48 @@ enum {
     TMP_COUNT,
 };
 
+// Feature flags determining the static part of the GLSL prelude
+enum {
+    PRELUDE_COMPUTE = 1 << 0,
+    PRELUDE_IMG     = 1 << 1,
+    PRELUDE_UBO     = 1 << 2,
+    PRELUDE_SSBO    = 1 << 3,
+    PRELUDE_TEXEL   = 1 << 4,
+    PRELUDE_EXT     = 1 << 5,
+    PRELUDE_NOFMT   = 1 << 6,
+    PRELUDE_GATHER  = 1 << 7,
+    PRELUDE_NOLOD   = 1 << 8,
+};
+
+struct prelude {
+    unsigned flags;
+    pl_str_builder builder;
+    uint64_t hash;
+};
+
+struct trace_event {
+    uint64_t signature;
+    pl_shader_info shader;
+    pl_clock_t cpu_start, cpu_end;
+    uint64_t gpu_time;  // or 0 if not (yet) available
+    bool timed;         // whether this run used the pass's internal timer
+    int w, h;           // target size, if any
+    int groups[3];      // compute dispatch size, if any
+    int group_size[2];
+};
+
+// Auto-tuning state for a single flexible compute shader, identified by the
+// signature of its pass excluding the group size
+struct tune_state {
+    uint64_t key;
+    int cands[TUNE_MAX_CANDS][2];
+    int num_cands;
+    int next; // next candidate to dispatch
+    int runs; // total number of tuning dispatches so far
+    bool done;
+    int best[2];
+};
+
 struct pl_dispatch_t {
     pl_mutex lock;
     pl_log log;
@@ -42,18 +97,39 @@ struct pl_dispatch_t {
     uint8_t current_ident;
     uint8_t current_index;
     bool dynamic_constants;
+    bool relaxed_precision;
+    bool async;
+    bool autotune;
+    PL_ARRAY(struct tune_state) tune;
+
+    // pass cache limits, see `pl_dispatch_set_cache_params`
     int max_passes;
+    size_t max_pass_mem;
 
     void (*info_callback)(void *, const struct pl_dispatch_info *);
     void *info_priv;
 
+    // for pl_dispatch_trace_*
+    bool tracing;
+    pl_clock_t trace_start;
+    PL_ARRAY(struct trace_event) trace;
+
     PL_ARRAY(pl_shader) shaders;                // to avoid re-allocations
     PL_ARRAY(struct pass *) passes;             // compiled passes
+    struct pass *lru_head, *lru_tail;           // most recently used first
+    size_t pass_mem;                            // sum of `pass->mem_size`
+
+    // Open-addressing (linear probing) hash table, mapping signatures to
+    // passes. Empty slots are NULL. Size is always a power of two.
+    struct pass **index;
+    int index_size;
 
     // temporary buffers to help avoid re_allocations during pass creation
     PL_ARRAY(const struct pl_buffer_var *) buf_tmp;
     pl_str_builder tmp[TMP_COUNT];
-    uint8_t *ubo_tmp;
+
+    // memoized static GLSL preludes, see `get_prelude`
+    PL_ARRAY(struct prelude) preludes;
 };
 
 enum pass_var_type {
@@ -68,22 +144,51 @@ struct pass_var {
     int index; // for pl_var_update
     enum pass_var_type type;
     struct pl_var_layout layout;
+    bool dynamic;       // skip `cached_data`, since it's expected to change
     void *cached_data;
 };
 
+// Background compilation of a `pl_pass`
+struct compile_job {
+    pl_gpu gpu;
+    uint64_t signature;
+    bool shared;
+    struct pl_pass_params params;
+    pl_thread thread;
+    pl_pass pass;
+    atomic_bool done;
+};
+
 struct pass {
     uint64_t signature;
     pl_pass pass;
+    bool shared; // `pass` is owned by `pl_gpu_shared_pass_acquire`
     int last_index;
 
+    // position in `dp->passes` and `dp->lru_*`
+    int idx;
+    struct pass *lru_prev, *lru_next;
+    size_t mem_size; // estimated driver memory, for `max_pass_mem`
+
+    // pending asynchronous compilation, or NULL
+    struct compile_job *job;
+
     // contains cached data and update metadata, same order as pl_shader
     struct pass_var *vars;
     int num_var_locs;
 
-    // for uniform buffer updates
+    // for uniform buffer updates. To avoid stalling on (or copying from) a
+    // buffer still in use by a previous frame, every pass cycles through a
+    // ring of buffers, advancing once per `pl_dispatch_reset_frame`. Updates
+    // are staged in `ubo_data` and uploaded in one go before each run.
     struct pl_shader_desc ubo_desc; // temporary
     int ubo_index;
-    pl_buf ubo;
+    pl_buf ubos[UBO_RING_SIZE];
+    int ubo_idx;        // index of the currently bound buffer
+    uint8_t ubo_frame;  // value of `current_index` when `ubo_idx` was chosen
+    uint8_t *ubo_data;  // host copy of the UBO contents
+    size_t ubo_size;
+    size_t ubo_dirty[2]; // range [start, end) where current buffer differs
 
     // Cached pl_pass_run_params. This will also contain mutable allocations
     // for the push constants, descriptor bindings (including the binding for
@@ -97,15 +202,66 @@ struct pass {
     uint64_t ts_sum;
     uint64_t samples[PL_ARRAY_SIZE(((struct pl_dispatch_info *) NULL)->samples)];
     int ts_idx;
+    int trace_idx; // first event in `trace` still waiting for a timer result
 };
 
+// Passes are shared with all other `pl_dispatch` objects on the same GPU,
+// except for those using global variables. Since these are part of the
+// program state, and only updated when changed, they can't be shared between
+// the independent variable caches of multiple `pass` objects.
+static pl_pass pass_create(pl_gpu gpu, uint64_t signature, bool shared,
+                           const struct pl_pass_params *params)
+{
+    if (shared)
+        return pl_gpu_shared_pass_acquire(gpu, signature, params);
+    return pl_pass_create(gpu, params);
+}
+
+static PL_THREAD_VOID compile_thread(void *arg)
+{
+    struct compile_job *job = arg;
+    job->pass = pass_create(job->gpu, job->signature, job->shared, &job->params);
+    atomic_store(&job->done, true);
+    PL_THREAD_RETURN();
+}
+
+// Collects the result of a finished background compilation. If `block` is
+// false, returns whether the pass is still compiling.
+static bool pass_pending(pl_dispatch dp, struct pass *pass, bool block)
+{
+    struct compile_job *job = pass->job;
+    if (!job) {
+        // Passes still being compiled by the driver itself are only skipped
+        // when asynchronous compilation was requested, and implicitly waited
+        // for by `pl_pass_run` otherwise
+        return !block && dp->async && pass->pass &&
+               pl_pass_pending(dp->gpu, pass->pass);
+    }
+    if (!block && !atomic_load(&job->done))
+        return true;
+
+    pl_thread_join(job->thread);
+    pass->pass = pass->run_params.pass = job->pass;
+    if (!pass->pass)
+        PL_ERR(dp, "Failed creating render pass for dispatch");
+    pl_free(job);
+    pass->job = NULL;
+    return false;
+}
+
 static void pass_destroy(pl_dispatch dp, struct pass *pass)
 {
     if (!pass)
         return;
 
-    pl_buf_destroy(dp->gpu, &pass->ubo);
-    pl_pass_destroy(dp->gpu, &pass->pass);
+    pass_pending(dp, pass, true);
+    for (int i = 0; i < UBO_RING_SIZE; i++)
+        pl_buf_destroy(dp->gpu, &pass->ubos[i]);
+    if (pass->shared) {
+        pl_gpu_shared_pass_release(dp->gpu, &pass->pass);
+    } else {
+        pl_pass_destroy(dp->gpu, &pass->pass);
+    }
     pl_timer_destroy(dp->gpu, &pass->timer);
     pl_free(pass);
 }
@@ -133,6 +289,8 @@ void pl_dispatch_destroy(pl_dispatch *ptr)
         pass_destroy(dp, dp->passes.elem[i]);
     for (int i = 0; i < dp->shaders.num; i++)
         pl_shader_free(&dp->shaders.elem[i]);
+    for (int i = 0; i < dp->trace.num; i++)
+        pl_shader_info_deref(&dp->trace.elem[i].shader);
 
     pl_mutex_destroy(&dp->lock);
     pl_free(dp);
@@ -148,6 +306,7 @@ pl_shader pl_dispatch_begin_ex(pl_dispatch dp, bool unique)
         .gpu = dp->gpu,
         .index = dp->current_index,
         .dynamic_constants = dp->dynamic_constants,
+        .relaxed_precision = dp->relaxed_precision,
     };
 
     pl_shader sh = NULL;
@@ -167,6 +326,55 @@ void pl_dispatch_mark_dynamic(pl_dispatch dp, bool dynamic)
     dp->dynamic_constants = dynamic;
 }
 
+void pl_dispatch_mark_relaxed(pl_dispatch dp, bool relaxed)
+{
+    dp->relaxed_precision = relaxed;
+}
+
+void pl_dispatch_async(pl_dispatch dp, bool async)
+{
+    pl_mutex_lock(&dp->lock);
+    dp->async = async;
+    pl_mutex_unlock(&dp->lock);
+}
+
+void pl_dispatch_autotune(pl_dispatch dp, bool enable)
+{
+    pl_mutex_lock(&dp->lock);
+    dp->autotune = enable;
+    pl_mutex_unlock(&dp->lock);
+}
+
+void pl_dispatch_set_cache_params(pl_dispatch dp,
+                                  const struct pl_dispatch_cache_params *params)
+{
+    pl_mutex_lock(&dp->lock);
+    dp->max_passes = PL_DEF(params->max_passes, MAX_PASSES);
+    dp->max_pass_mem = params->max_memory;
+    pl_mutex_unlock(&dp->lock);
+}
+
+bool pl_dispatch_is_async(pl_dispatch dp)
+{
+    pl_mutex_lock(&dp->lock);
+    bool async = dp->async;
+    pl_mutex_unlock(&dp->lock);
+    return async;
+}
+
+size_t pl_dispatch_mem_usage(pl_dispatch dp)
+{
+    size_t total = 0;
+    pl_mutex_lock(&dp->lock);
+    for (int i = 0; i < dp->passes.num; i++) {
+        const struct pass *pass = dp->passes.elem[i];
+        for (int n = 0; n < PL_ARRAY_SIZE(pass->ubos); n++)
+            total += pass->ubos[n] ? pass->ubos[n]->params.size : 0;
+    }
+    pl_mutex_unlock(&dp->lock);
+    return total;
+}
+
 void pl_dispatch_callback(pl_dispatch dp, void *priv,
                           void (*cb)(void *priv, const struct pl_dispatch_info *))
 {
@@ -174,6 +382,117 @@ void pl_dispatch_callback(pl_dispatch dp, void *priv,
     dp->info_priv = priv;
 }
 
+static void trace_clear(pl_dispatch dp)
+{
+    for (int i = 0; i < dp->trace.num; i++)
+        pl_shader_info_deref(&dp->trace.elem[i].shader);
+    dp->trace.num = 0;
+}
+
+void pl_dispatch_trace_begin(pl_dispatch dp)
+{
+    pl_mutex_lock(&dp->lock);
+    trace_clear(dp);
+    for (int i = 0; i < dp->passes.num; i++)
+        dp->passes.elem[i]->trace_idx = 0;
+    dp->trace_start = pl_clock_now();
+    dp->tracing = true;
+    pl_mutex_unlock(&dp->lock);
+}
+
+static void json_escape(void *alloc, pl_str *out, const char *str)
+{
+    for (; *str; str++) {
+        unsigned char c = *str;
+        if (c == '"' || c == '\\') {
+            pl_str_append_asprintf_c(alloc, out, "\\%c", c);
+        } else if (c < 0x20) {
+            static const char hex[] = "0123456789abcdef";
+            const char esc[] = { '\\', 'u', '0', '0', hex[c >> 4], hex[c & 0xF] };
+            pl_str_append_raw(alloc, out, esc, sizeof(esc));
+        } else {
+            pl_str_append_raw(alloc, out, &c, 1);
+        }
+    }
+}
+
+// Trace timestamps are in microseconds, printed with nanosecond precision
+static void json_time(void *alloc, pl_str *out, uint64_t ns)
+{
+    unsigned frac = ns % 1000;
+    const char digits[] = { '0' + frac / 100, '0' + frac / 10 % 10, '0' + frac % 10 };
+    pl_str_append_asprintf_c(alloc, out, "%llu.", (unsigned long long) (ns / 1000));
+    pl_str_append_raw(alloc, out, digits, sizeof(digits));
+}
+
+static void write_trace_event(void *alloc, pl_str *out, const struct trace_event *ev,
+                              const char *cat, int tid, uint64_t ts, uint64_t dur)
+{
+    pl_str_append_asprintf_c(alloc, out, ",\n{\"name\":\"");
+    json_escape(alloc, out, PL_DEF(ev->shader->description, "(unknown)"));
+    pl_str_append_asprintf_c(alloc, out, "\",\"cat\":\"%s\",\"ph\":\"X\","
+                             "\"pid\":1,\"tid\":%d,\"ts\":", cat, tid);
+    json_time(alloc, out, ts);
+    pl_str_append_asprintf_c(alloc, out, ",\"dur\":");
+    json_time(alloc, out, dur);
+    pl_str_append_asprintf_c(alloc, out, ",\"args\":{\"signature\":\"");
+    pl_str_append_asprintf(alloc, out, "0x%016"PRIx64, ev->signature);
+    pl_str_append_asprintf_c(alloc, out, "\",\"width\":%d,\"height\":%d",
+                             ev->w, ev->h);
+    if (ev->groups[0]) {
+        pl_str_append_asprintf_c(alloc, out,
+                                 ",\"groups\":[%d,%d,%d],\"group_size\":[%d,%d]",
+                                 ev->groups[0], ev->groups[1], ev->groups[2],
+                                 ev->group_size[0], ev->group_size[1]);
+    }
+    pl_str_append_asprintf_c(alloc, out, "}}");
+}
+
+void pl_dispatch_trace_end(pl_dispatch dp,
+                           void (*write)(void *priv, size_t size, const void *ptr),
+                           void *priv)
+{
+    pl_mutex_lock(&dp->lock);
+    dp->tracing = false;
+
+    void *tmp = pl_tmp(NULL);
+    pl_str out = {0};
+    pl_str_append_asprintf_c(tmp, &out,
+        "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,"
+        "\"args\":{\"name\":\"CPU submit\"}},\n"
+        "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,"
+        "\"args\":{\"name\":\"GPU execution\"}}");
+
+    // Timers only measure durations, so reconstruct the GPU timeline by
+    // assuming passes execute back-to-back, but never before being submitted
+    uint64_t gpu_end = 0;
+    for (int i = 0; i < dp->trace.num; i++) {
+        const struct trace_event *ev = &dp->trace.elem[i];
+        uint64_t start = pl_clock_diff(ev->cpu_start, dp->trace_start) * 1e9;
+        uint64_t end = pl_clock_diff(ev->cpu_end, dp->trace_start) * 1e9;
+        write_trace_event(tmp, &out, ev, "cpu", 1, start, PL_MAX(end, start) - start);
+
+        if (ev->gpu_time) {
+            uint64_t gpu_start = PL_MAX(start, gpu_end);
+            write_trace_event(tmp, &out, ev, "gpu", 2, gpu_start, ev->gpu_time);
+            gpu_end = gpu_start + ev->gpu_time;
+        }
+
+        if (out.len >= (1 << 16)) {
+            write(priv, out.len, out.buf);
+            out.len = 0;
+        }
+    }
+
+    pl_str_append_asprintf_c(tmp, &out, "\n]}\n");
+    write(priv, out.len, out.buf);
+    PL_DEBUG(dp, "Wrote dispatch trace with %d events", dp->trace.num);
+    trace_clear(dp);
+    pl_free(tmp);
+    pl_mutex_unlock(&dp->lock);
+}
+
 pl_shader pl_dispatch_begin(pl_dispatch dp)
 {
     return pl_dispatch_begin_ex(dp, false);
@@ -187,6 +506,7 @@ static bool add_pass_var(pl_dispatch dp, void *tmp, struct pass *pass,
     pl_gpu gpu = dp->gpu;
     if (pv->type)
         return true;
+    pv->dynamic = sv->dynamic;
 
     // Try not to use push constants for "large" values like matrices in the
     // first pass, since this is likely to exceed the VGPR/pushc size budgets
@@ -289,24 +609,27 @@ struct generate_params {
     ident_t out_mat;
     ident_t out_off;
     int vert_idx;
+
+    // filled in by `generate_prelude`
+    const struct prelude *prelude;
+    pl_str_builder pre;  // shader-specific declarations
+    pl_str_builder body; // shader body (excluding main)
 };
 
-static void generate_shaders(pl_dispatch dp,
-                             const struct generate_params *params,
-                             pl_str_builder *out_vert_builder,
-                             pl_str_builder *out_glsl_builder)
+// Returns the static part of the GLSL prelude for a given set of feature
+// flags, which only depends on those and the `pl_gpu`.
+static const struct prelude *get_prelude(pl_dispatch dp, unsigned flags)
 {
-    pl_gpu gpu = dp->gpu;
-    pl_shader sh = params->sh;
-    void *tmp = params->tmp;
-    struct pass *pass = params->pass;
-    struct pl_pass_params *pass_params = params->pass_params;
-    pl_str_builder shader_body = sh_finalize_internal(sh);
+    for (int i = 0; i < dp->preludes.num; i++) {
+        if (dp->preludes.elem[i].flags == flags)
+            return &dp->preludes.elem[i];
+    }
 
-    pl_str_builder pre = dp->tmp[TMP_PRELUDE];
+    pl_gpu gpu = dp->gpu;
+    pl_str_builder pre = pl_str_builder_alloc(dp);
     ADD(pre, "#version %d%s\n", gpu->glsl.version,
         (gpu->glsl.gles && gpu->glsl.version > 100) ? " es" : "");
-    if (pass_params->type == PL_PASS_COMPUTE)
+    if (flags & PRELUDE_COMPUTE)
         ADD(pre, "#extension GL_ARB_compute_shader : enable\n");
 
     // Enable this unconditionally if the GPU supports it, since we have no way
@@ -322,61 +645,24 @@ static void generate_shaders(pl_dispatch dp,
     }
 
     // Enable all extensions needed for different types of input
-    bool has_ssbo = false, has_ubo = false, has_img = false, has_texel = false,
-         has_ext = false, has_nofmt = false, has_gather = false;
-    for (int i = 0; i < sh->descs.num; i++) {
-        switch (sh->descs.elem[i].desc.type) {
-        case PL_DESC_BUF_UNIFORM: has_ubo = true; break;
-        case PL_DESC_BUF_STORAGE: has_ssbo = true; break;
-        case PL_DESC_BUF_TEXEL_UNIFORM: has_texel = true; break;
-        case PL_DESC_BUF_TEXEL_STORAGE: {
-            pl_buf buf = sh->descs.elem[i].binding.object;
-            has_nofmt |= !buf->params.format->glsl_format;
-            has_texel = true;
-            break;
-        }
-        case PL_DESC_STORAGE_IMG: {
-            pl_tex tex = sh->descs.elem[i].binding.object;
-            has_nofmt |= !tex->params.format->glsl_format;
-            has_img = true;
-            break;
-        }
-        case PL_DESC_SAMPLED_TEX: {
-            pl_tex tex = sh->descs.elem[i].binding.object;
-            has_gather |= tex->params.format->gatherable;
-            switch (tex->sampler_type) {
-            case PL_SAMPLER_NORMAL: break;
-            case PL_SAMPLER_RECT: break;
-            case PL_SAMPLER_EXTERNAL: has_ext = true; break;
-            case PL_SAMPLER_TYPE_COUNT: pl_unreachable();
-            }
-            break;
-        }
-
-        case PL_DESC_INVALID:
-        case PL_DESC_TYPE_COUNT:
-            pl_unreachable();
-        }
-    }
-
-    if (has_img)
+    if (flags & PRELUDE_IMG)
         ADD(pre, "#extension GL_ARB_shader_image_load_store : enable\n");
-    if (has_ubo)
+    if (flags & PRELUDE_UBO)
         ADD(pre, "#extension GL_ARB_uniform_buffer_object : enable\n");
-    if (has_ssbo)
+    if (flags & PRELUDE_SSBO)
         ADD(pre, "#extension GL_ARB_shader_storage_buffer_object : enable\n");
-    if (has_texel)
+    if (flags & PRELUDE_TEXEL)
         ADD(pre, "#extension GL_ARB_texture_buffer_object : enable\n");
-    if (has_ext) {
+    if (flags & PRELUDE_EXT) {
         if (gpu->glsl.version >= 300) {
             ADD(pre, "#extension GL_OES_EGL_image_external_essl3 : enable\n");
         } else {
             ADD(pre, "#extension GL_OES_EGL_image_external : enable\n");
         }
     }
-    if (has_nofmt)
+    if (flags & PRELUDE_NOFMT)
         ADD(pre, "#extension GL_EXT_shader_image_load_formatted : enable\n");
-    if (has_gather)
+    if (flags & PRELUDE_GATHER)
         ADD(pre, "#extension GL_ARB_texture_gather : enable\n");
 
     if (gpu->glsl.gles) {
@@ -400,18 +686,80 @@ static void generate_shaders(pl_dispatch dp,
 
     // textureLod() doesn't work on external/rect samplers, simply disable
     // LOD sampling in this case. We don't currently support mipmaps anyway.
+    if (flags & PRELUDE_NOLOD) {
+        ADD(pre, "#define textureLod(t, p, b) texture(t, p) \n"
+                 "#define textureLodOffset(t, p, b, o)    \\\n"
+                 "        textureOffset(t, p, o)            \n");
+    }
+
+    struct prelude prelude = {
+        .flags   = flags,
+        .builder = pre,
+        .hash    = pl_str_builder_hash(pre),
+    };
+
+    // Render it once up-front, so shaders can copy the text directly
+    pl_str_builder_exec(pre);
+    PL_ARRAY_APPEND(dp, dp->preludes, prelude);
+
+    return &dp->preludes.elem[dp->preludes.num - 1];
+}
+
+// Generates the shader-specific declarations and body, and hashes everything
+// that will end up in the shader text into the pass signature. This does not
+// yet assemble the actual shaders, see `generate_shaders`.
+static void generate_prelude(pl_dispatch dp, struct generate_params *params)
+{
+    pl_gpu gpu = dp->gpu;
+    pl_shader sh = params->sh;
+    void *tmp = params->tmp;
+    struct pass *pass = params->pass;
+    struct pl_pass_params *pass_params = params->pass_params;
+
+    unsigned flags = 0;
+    if (pass_params->type == PL_PASS_COMPUTE)
+        flags |= PRELUDE_COMPUTE;
     for (int i = 0; i < sh->descs.num; i++) {
-        if (pass_params->descriptors[i].type != PL_DESC_SAMPLED_TEX)
-            continue;
-        pl_tex tex = sh->descs.elem[i].binding.object;
-        if (tex->sampler_type != PL_SAMPLER_NORMAL) {
-            ADD(pre, "#define textureLod(t, p, b) texture(t, p) \n"
-                     "#define textureLodOffset(t, p, b, o)    \\\n"
-                     "        textureOffset(t, p, o)            \n");
+        switch (sh->descs.elem[i].desc.type) {
+        case PL_DESC_BUF_UNIFORM: flags |= PRELUDE_UBO; break;
+        case PL_DESC_BUF_STORAGE: flags |= PRELUDE_SSBO; break;
+        case PL_DESC_BUF_TEXEL_UNIFORM: flags |= PRELUDE_TEXEL; break;
+        case PL_DESC_BUF_TEXEL_STORAGE: {
+            pl_buf buf = sh->descs.elem[i].binding.object;
+            if (!buf->params.format->glsl_format)
+                flags |= PRELUDE_NOFMT;
+            flags |= PRELUDE_TEXEL;
+            break;
+        }
+        case PL_DESC_STORAGE_IMG: {
+            pl_tex tex = sh->descs.elem[i].binding.object;
+            if (!tex->params.format->glsl_format)
+                flags |= PRELUDE_NOFMT;
+            flags |= PRELUDE_IMG;
+            break;
+        }
+        case PL_DESC_SAMPLED_TEX: {
+            pl_tex tex = sh->descs.elem[i].binding.object;
+            if (tex->params.format->gatherable)
+                flags |= PRELUDE_GATHER;
+            switch (tex->sampler_type) {
+            case PL_SAMPLER_NORMAL: break;
+            case PL_SAMPLER_RECT: flags |= PRELUDE_NOLOD; break;
+            case PL_SAMPLER_EXTERNAL: flags |= PRELUDE_EXT | PRELUDE_NOLOD; break;
+            case PL_SAMPLER_TYPE_COUNT: pl_unreachable();
+            }
             break;
         }
+
+        case PL_DESC_INVALID:
+        case PL_DESC_TYPE_COUNT:
+            pl_unreachable();
+        }
     }
 
+    params->prelude = get_prelude(dp, flags);
+    pl_str_builder pre = params->pre = dp->tmp[TMP_PRELUDE];
+
     // Add all of the push constants as their own element
     if (pass_params->push_constants_size) {
         // We re-use add_buffer_vars to make sure variables are sorted, this
@@ -593,7 +941,48 @@ static void generate_shaders(pl_dispatch dp,
         add_var(pre, var);
     }
 
+    params->body = sh_finalize_internal(sh);
+    pl_hash_merge(&pass->signature, params->prelude->hash);
+    pl_hash_merge(&pass->signature, pl_str_builder_hash(pre));
+    pl_hash_merge(&pass->signature, pl_str_builder_hash(params->body));
+
+    // Hash the pass interface, which is generated by `generate_shaders`
+    switch (pass_params->type) {
+    case PL_PASS_RASTER:
+        pl_hash_merge(&pass->signature, params->vert_idx);
+        pl_hash_merge(&pass->signature, params->out_mat);
+        pl_hash_merge(&pass->signature, params->out_off);
+        for (int i = 0; i < sh->vas.num; i++) {
+            const struct pl_vertex_attrib *va = &pass_params->vertex_attribs[i];
+            pl_hash_merge(&pass->signature, va->location);
+            pl_hash_merge(&pass->signature, pl_str0_hash(va->fmt->glsl_type));
+            pl_hash_merge(&pass->signature, sh_ident_unpack(va->name));
+            pl_hash_merge(&pass->signature, sh_ident_unpack(sh->vas.elem[i].attr.name));
+        }
+        break;
+    case PL_PASS_COMPUTE:
+        break; // group size is hashed separately, see `finalize_pass`
+    case PL_PASS_INVALID:
+    case PL_PASS_TYPE_COUNT:
+        pl_unreachable();
+    }
+    pl_hash_merge(&pass->signature, sh->name);
+}
+
+// Assembles the final shaders from the components prepared by
+// `generate_prelude`. Only needed when the pass isn't already cached.
+static void generate_shaders(pl_dispatch dp,
+                             const struct generate_params *params,
+                             pl_str_builder *out_vert_builder,
+                             pl_str_builder *out_glsl_builder)
+{
+    pl_gpu gpu = dp->gpu;
+    pl_shader sh = params->sh;
+    struct pl_pass_params *pass_params = params->pass_params;
+    pl_str_builder pre = params->pre;
+
     pl_str_builder glsl = dp->tmp[TMP_MAIN];
+    ADD_CAT(glsl, params->prelude->builder);
     ADD_CAT(glsl, pre);
 
     switch(pass_params->type) {
@@ -606,6 +995,7 @@ static void generate_shaders(pl_dispatch dp,
         bool has_loc = gpu->glsl.version >= 430;
 
         // Set up a trivial vertex shader
+        ADD_CAT(vert_head, params->prelude->builder);
         ADD_CAT(vert_head, pre);
         ADD(vert_body, "void main() {\n");
         for (int i = 0; i < sh->vas.num; i++) {
@@ -649,7 +1039,6 @@ static void generate_shaders(pl_dispatch dp,
 
         ADD(vert_body, "}");
         ADD_CAT(vert_head, vert_body);
-        pl_hash_merge(&pass->signature, pl_str_builder_hash(vert_head));
         *out_vert_builder = vert_head;
 
         if (has_loc) {
@@ -669,7 +1058,7 @@ static void generate_shaders(pl_dispatch dp,
     }
 
     // Set up the main shader body
-    ADD_CAT(glsl, shader_body);
+    ADD_CAT(glsl, params->body);
     ADD(glsl, "void main() {\n");
 
     pl_assert(sh->input == PL_SHADER_SIG_NONE);
@@ -687,53 +1076,297 @@ static void generate_shaders(pl_dispatch dp,
     }
 
     ADD(glsl, "}");
-
-    pl_hash_merge(&pass->signature, pl_str_builder_hash(glsl));
     *out_glsl_builder = glsl;
 }
 
 #undef ADD
 #undef ADD_CAT
 
-#define pass_age(pass) (dp->current_index - (pass)->last_index)
+#define pass_age(pass) ((uint8_t) (dp->current_index - (pass)->last_index))
 
-static int cmp_pass_age(const void *ptra, const void *ptrb)
+static void lru_unlink(pl_dispatch dp, struct pass *pass)
 {
-    const struct pass *a = *(const struct pass **) ptra;
-    const struct pass *b = *(const struct pass **) ptrb;
-    return b->last_index - a->last_index;
+    if (pass->lru_prev) {
+        pass->lru_prev->lru_next = pass->lru_next;
+    } else {
+        dp->lru_head = pass->lru_next;
+    }
+
+    if (pass->lru_next) {
+        pass->lru_next->lru_prev = pass->lru_prev;
+    } else {
+        dp->lru_tail = pass->lru_prev;
+    }
+
+    pass->lru_prev = pass->lru_next = NULL;
 }
 
-static void garbage_collect_passes(pl_dispatch dp)
+static void lru_push(pl_dispatch dp, struct pass *pass)
 {
-    if (dp->passes.num <= dp->max_passes)
-        return;
+    pass->lru_prev = NULL;
+    pass->lru_next = dp->lru_head;
+    if (dp->lru_head)
+        dp->lru_head->lru_prev = pass;
+    dp->lru_head = pass;
+    if (!dp->lru_tail)
+        dp->lru_tail = pass;
+}
 
-    // Garbage collect oldest passes, starting at the middle
-    qsort(dp->passes.elem, dp->passes.num, sizeof(struct pass *), cmp_pass_age);
-    int idx = dp->passes.num / 2;
-    while (idx < dp->passes.num && pass_age(dp->passes.elem[idx]) < MIN_AGE)
-        idx++;
+// Marks a pass as used in the current frame
+static void pass_touch(pl_dispatch dp, struct pass *pass)
+{
+    pass->last_index = dp->current_index;
+    if (dp->lru_head != pass) {
+        lru_unlink(dp, pass);
+        lru_push(dp, pass);
+    }
+}
 
-    for (int i = idx; i < dp->passes.num; i++)
-        pass_destroy(dp, dp->passes.elem[i]);
+// Signatures are already hashes, so they can be used for the index directly
+static inline int index_slot(pl_dispatch dp, uint64_t signature)
+{
+    return (int) signature & (dp->index_size - 1);
+}
 
-    int num_evicted = dp->passes.num - idx;
-    dp->passes.num = idx;
+// Returns the index slot containing `signature`, or the empty slot it would
+// go into
+static int index_find(pl_dispatch dp, uint64_t signature)
+{
+    const int mask = dp->index_size - 1;
+    int slot = index_slot(dp, signature);
+    while (dp->index[slot] && dp->index[slot]->signature != signature)
+        slot = (slot + 1) & mask;
+    return slot;
+}
 
-    if (num_evicted) {
+static void index_remove(pl_dispatch dp, int slot)
+{
+    // Backward-shift deletion, to avoid the need for tombstones
+    const int mask = dp->index_size - 1;
+    int hole = slot;
+    for (int i = (slot + 1) & mask; dp->index[i]; i = (i + 1) & mask) {
+        int home = index_slot(dp, dp->index[i]->signature);
+        // Move the entry into the hole if its home slot is not within
+        // the (cyclic) range (hole, i]
+        if (((i - home) & mask) >= ((i - hole) & mask)) {
+            dp->index[hole] = dp->index[i];
+            hole = i;
+        }
+    }
+    dp->index[hole] = NULL;
+}
+
+static void index_grow(pl_dispatch dp)
+{
+    int new_size = PL_MAX(dp->index_size * 2, 64);
+    pl_free(dp->index);
+    dp->index = pl_calloc_ptr(dp, new_size, dp->index);
+    dp->index_size = new_size;
+    for (int i = 0; i < dp->passes.num; i++)
+        dp->index[index_find(dp, dp->passes.elem[i]->signature)] = dp->passes.elem[i];
+}
+
+static struct pass *pass_lookup(pl_dispatch dp, uint64_t signature)
+{
+    return dp->index_size ? dp->index[index_find(dp, signature)] : NULL;
+}
+
+static void pass_add(pl_dispatch dp, struct pass *pass)
+{
+    if (2 * (dp->passes.num + 1) > dp->index_size)
+        index_grow(dp);
+
+    pass->idx = dp->passes.num;
+    PL_ARRAY_APPEND(dp, dp->passes, pass);
+    dp->index[index_find(dp, pass->signature)] = pass;
+    lru_push(dp, pass);
+    dp->pass_mem += pass->mem_size;
+}
+
+static void pass_evict(pl_dispatch dp, struct pass *pass)
+{
+    struct pass *last = dp->passes.elem[--dp->passes.num];
+    dp->passes.elem[pass->idx] = last;
+    last->idx = pass->idx;
+    index_remove(dp, index_find(dp, pass->signature));
+    lru_unlink(dp, pass);
+    dp->pass_mem -= pass->mem_size;
+    pass_destroy(dp, pass);
+}
+
+static void garbage_collect_passes(pl_dispatch dp)
+{
+    // Under memory pressure, evict all sufficiently old passes regardless of
+    // whether the cache is full or not
+    struct pl_gpu_memory_budget budget;
+    bool pressure = pl_gpu_get_memory_budget(dp->gpu, &budget) && budget.pressure;
+
+    // Evict least recently used passes until we're back under the limits.
+    // Recently used passes are never evicted, so these limits are soft.
+    int num_evicted = 0;
+    while (dp->lru_tail && pass_age(dp->lru_tail) >= MIN_AGE) {
+        bool over_limit = dp->passes.num > dp->max_passes ||
+                          (dp->max_pass_mem && dp->pass_mem > dp->max_pass_mem);
+        if (!pressure && !over_limit)
+            break;
+        pass_evict(dp, dp->lru_tail);
+        num_evicted++;
+    }
+
+    if (num_evicted && pressure) {
+        PL_DEBUG(dp, "Evicted %d passes from dispatch cache due to memory "
+                 "pressure", num_evicted);
+    } else if (num_evicted) {
         PL_DEBUG(dp, "Evicted %d passes from dispatch cache, consider "
-                 "using more dynamic shaders", num_evicted);
-    } else {
-        dp->max_passes *= 2;
+                 "using more dynamic shaders%s", num_evicted,
+                 pl_gpu_cache(dp->gpu) ? "" : " or attaching a `pl_cache`");
+    }
+}
+
+static uint64_t group_size_signature(uint64_t key, const int size[2])
+{
+    pl_hash_merge(&key, size[0]);
+    pl_hash_merge(&key, size[1]);
+    return key;
+}
+
+static int pass_num_samples(const struct pass *pass)
+{
+    if (pass->samples[pass->ts_idx])
+        return PL_ARRAY_SIZE(pass->samples); // ring buffer wrapped around
+    return pass->ts_idx;
+}
+
+// Tuning results are only valid for the same shader on the same device
+static uint64_t tune_cache_key(pl_gpu gpu, uint64_t key)
+{
+    uint64_t hash = CACHE_KEY_WG_SIZE;
+    pl_hash_merge(&hash, key);
+    pl_hash_merge(&hash, pl_var_hash(gpu->uuid));
+    pl_hash_merge(&hash, gpu->glsl.subgroup_size);
+    pl_hash_merge(&hash, gpu->glsl.max_group_threads);
+    return hash;
+}
+
+static bool group_size_ok(pl_gpu gpu, pl_shader sh, const int size[2])
+{
+    const struct pl_glsl_version *glsl = &gpu->glsl;
+    return size[0] > 0 && size[1] > 0 &&
+           size[0] % sh_group_align(sh) == 0 &&
+           size[0] <= glsl->max_group_size[0] &&
+           size[1] <= glsl->max_group_size[1] &&
+           size[0] * size[1] <= glsl->max_group_threads;
+}
+
+static void tune_init(pl_dispatch dp, struct tune_state *st, pl_shader sh)
+{
+    const int *orig = sh->group_size;
+    static const int sizes[][2] = {
+        {8, 8}, {16, 8}, {16, 16}, {32, 8}, {32, 16}, {32, 32}, {64, 4},
+    };
+
+    pl_static_assert(PL_ARRAY_SIZE(sizes) < TUNE_MAX_CANDS);
+    memcpy(st->cands[st->num_cands++], orig, sizeof(st->cands[0]));
+    for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+        if (sizes[i][0] == orig[0] && sizes[i][1] == orig[1])
+            continue;
+        if (group_size_ok(dp->gpu, sh, sizes[i]))
+            memcpy(st->cands[st->num_cands++], sizes[i], sizeof(st->cands[0]));
+    }
+
+    if (st->num_cands == 1) {
+        memcpy(st->best, orig, sizeof(st->best));
+        st->done = true;
     }
 }
 
+// Picks the group size of a flexible compute shader, identified by `key`.
+// While tuning, this cycles through all candidate sizes, each of which ends
+// up as a separate pass with its own timer, until every candidate has enough
+// timer results to pick the fastest one. The winner is stored in the
+// `pl_cache`, so tuning only happens once per shader and device.
+static void tune_group_size(pl_dispatch dp, pl_shader sh, uint64_t key)
+{
+    struct tune_state *st = NULL;
+    for (int i = 0; i < dp->tune.num; i++) {
+        if (dp->tune.elem[i].key == key) {
+            st = &dp->tune.elem[i];
+            break;
+        }
+    }
+
+    if (!st) {
+        PL_ARRAY_APPEND(dp, dp->tune, (struct tune_state) { .key = key });
+        st = &dp->tune.elem[dp->tune.num - 1];
+
+        pl_cache cache = pl_gpu_cache(dp->gpu);
+        pl_cache_obj obj = { .key = tune_cache_key(dp->gpu, key) };
+        if (pl_cache_get(cache, &obj)) {
+            if (obj.size == sizeof(st->best)) {
+                memcpy(st->best, obj.data, sizeof(st->best));
+                st->done = group_size_ok(dp->gpu, sh, st->best);
+            }
+            pl_cache_set(cache, &obj);
+        }
+
+        if (!st->done)
+            tune_init(dp, st, sh);
+    }
+
+    if (!st->done) {
+        int num_samples[TUNE_MAX_CANDS];
+        int best = -1;
+        uint64_t best_avg = 0;
+        bool complete = true;
+        for (int i = 0; i < st->num_cands; i++) {
+            uint64_t sig = group_size_signature(key, st->cands[i]);
+            const struct pass *pass = pass_lookup(dp, sig);
+            num_samples[i] = pass ? pass_num_samples(pass) : 0;
+            complete &= num_samples[i] >= TUNE_SAMPLES;
+            if (!num_samples[i])
+                continue;
+            uint64_t avg = pass->ts_sum / num_samples[i];
+            if (best < 0 || avg < best_avg) {
+                best = i;
+                best_avg = avg;
+            }
+        }
+
+        if (!complete && st->runs < TUNE_MAX_RUNS) {
+            int idx;
+            do {
+                idx = st->next;
+                st->next = (st->next + 1) % st->num_cands;
+            } while (num_samples[idx] >= TUNE_SAMPLES);
+            memcpy(sh->group_size, st->cands[idx], sizeof(sh->group_size));
+            st->runs++;
+            return;
+        }
+
+        // Fall back to the requested size if nothing could be timed at all
+        best = PL_MAX(best, 0);
+        memcpy(st->best, st->cands[best], sizeof(st->best));
+        st->done = true;
+        if (complete) {
+            PL_DEBUG(dp, "Tuned group size of shader 0x%"PRIx64": %dx%d "
+                     "(%.3f ms)", key, st->best[0], st->best[1], best_avg / 1e6);
+            pl_cache_set(pl_gpu_cache(dp->gpu), &(pl_cache_obj) {
+                .key  = tune_cache_key(dp->gpu, key),
+                .data = st->best,
+                .size = sizeof(st->best),
+            });
+        }
+    }
+
+    memcpy(sh->group_size, st->best, sizeof(sh->group_size));
+}
+
+// `autotune` allows changing the group size of flexible compute shaders
 static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
                                   pl_tex target, int vert_idx,
                                   const struct pl_blend_params *blend, bool load,
                                   const struct pl_dispatch_vertex_params *vparams,
-                                  const pl_transform2x2 *proj)
+                                  const pl_transform2x2 *proj, bool autotune)
 {
     struct pass *pass = pl_alloc_ptr(dp, pass);
     *pass = (struct pass) {
@@ -773,7 +1406,7 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
 
         // Fill in the vertex attributes array
         params.num_vertex_attribs = sh->vas.num;
-        params.vertex_attribs = pl_calloc_ptr(tmp, sh->vas.num, params.vertex_attribs);
+        params.vertex_attribs = pl_arena_calloc_ptr(&sh->data, sh->vas.num, params.vertex_attribs);
 
         int va_loc = 0;
         for (int i = 0; i < sh->vas.num; i++) {
@@ -826,9 +1459,10 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
 
     // Place all of the compile-time constants
     uint8_t *constant_data = NULL;
+    size_t constant_size = 0;
     if (sh->consts.num) {
         params.num_constants = sh->consts.num;
-        params.constants = pl_alloc(tmp, sh->consts.num * sizeof(struct pl_constant));
+        params.constants = pl_arena_calloc_ptr(&sh->data, sh->consts.num, params.constants);
 
         // Compute offsets
         size_t total_size = 0;
@@ -843,6 +1477,7 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
         }
 
         // Write values into the constants buffer
+        constant_size = total_size;
         params.constant_data = constant_data = pl_alloc(pass, total_size);
         for (int i = 0; i < sh->consts.num; i++) {
             const struct pl_shader_const *sc = &sh->consts.elem[i];
@@ -878,7 +1513,7 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
     const int num_descs = sh->descs.num;
     int binding[PL_DESC_TYPE_COUNT] = {0};
     params.num_descriptors = num_descs;
-    params.descriptors = pl_calloc_ptr(tmp, num_descs, params.descriptors);
+    params.descriptors = pl_arena_calloc_ptr(&sh->data, num_descs, params.descriptors);
     for (int i = 0; i < num_descs; i++) {
         struct pl_desc *desc = &params.descriptors[i];
         *desc = sh->descs.elem[i].desc;
@@ -886,24 +1521,32 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
     }
 
     // Finalize the shader and look it up in the pass cache
-    pl_str_builder vert_builder = NULL, glsl_builder = NULL;
-    generate_shaders(dp, &gen_params, &vert_builder, &glsl_builder);
-    for (int i = 0; i < dp->passes.num; i++) {
-        struct pass *p = dp->passes.elem[i];
-        if (p->signature != pass->signature)
-            continue;
-
+    generate_prelude(dp, &gen_params);
+    if (params.type == PL_PASS_COMPUTE) {
+        params.subgroup_size = sh->subgroup_size;
+        params.full_subgroups = sh->full_subgroups;
+        pl_hash_merge(&pass->signature, (uint64_t) sh->subgroup_size << 1 |
+                                        sh->full_subgroups);
+        if (autotune && dp->autotune && sh->flexible_work_groups)
+            tune_group_size(dp, sh, pass->signature);
+        pass->signature = group_size_signature(pass->signature, sh->group_size);
+    }
+
+    struct pass *p = pass_lookup(dp, pass->signature);
+    if (p) {
         // Found existing shader, re-use directly
-        if (p->ubo)
-            sh->descs.elem[p->ubo_index].binding.object = p->ubo;
+        if (p->ubo_size)
+            sh->descs.elem[p->ubo_index].binding.object = p->ubos[p->ubo_idx];
         pl_free(p->run_params.constant_data);
         p->run_params.constant_data = pl_steal(p, constant_data);
-        p->last_index = dp->current_index;
+        pass_touch(dp, p);
         pl_free(pass);
         return p;
     }
 
-    // Need to compile new shader, execute templates now
+    // Need to compile new shader, assemble and execute templates now
+    pl_str_builder vert_builder = NULL, glsl_builder = NULL;
+    generate_shaders(dp, &gen_params, &vert_builder, &glsl_builder);
     if (vert_builder) {
         pl_str vert = pl_str_builder_exec(vert_builder);
         params.vertex_shader = (char *) vert.buf;
@@ -923,10 +1566,32 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
         FIX_IDENT(params.vertex_attribs[i].name);
 #undef FIX_IDENT
 
-    pass->pass = pl_pass_create(dp->gpu, &params);
-    if (!pass->pass) {
-        PL_ERR(dp, "Failed creating render pass for dispatch");
-        // Add it anyway
+    pass->shared = !params.num_variables;
+
+    // No need for a thread if the driver compiles in the background anyway
+    bool need_thread = !pl_gpu_compiles_async(dp->gpu);
+    if (dp->async && need_thread && dp->gpu->limits.thread_safe) {
+        struct compile_job *job = pl_zalloc_ptr(NULL, job);
+        job->gpu = dp->gpu;
+        job->signature = pass->signature;
+        job->shared = pass->shared;
+        job->params = pl_pass_params_copy(job, &params);
+        job->params.constant_data = pl_memdup(job, constant_data, constant_size);
+        atomic_init(&job->done, false);
+        if (pl_thread_create(&job->thread, compile_thread, job) == 0) {
+            PL_DEBUG(dp, "Compiling pass 0x%"PRIx64" asynchronously", pass->signature);
+            pass->job = job;
+        } else {
+            pl_free(job);
+        }
+    }
+
+    if (!pass->job) {
+        pass->pass = pass_create(dp->gpu, pass->signature, pass->shared, &params);
+        if (!pass->pass) {
+            PL_ERR(dp, "Failed creating render pass for dispatch");
+            // Add it anyway
+        }
     }
 
     struct pl_pass_run_params *rparams = &pass->run_params;
@@ -936,20 +1601,26 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
     rparams->desc_bindings = pl_calloc_ptr(pass, params.num_descriptors,
                                            rparams->desc_bindings);
 
-    if (ubo_size && pass->pass) {
-        // Create the UBO
-        pass->ubo = pl_buf_create(dp->gpu, pl_buf_params(
-            .size = ubo_size,
-            .uniform = true,
-            .host_writable = true,
-        ));
-
-        if (!pass->ubo) {
-            PL_ERR(dp, "Failed creating uniform buffer for dispatch");
-            goto error;
+    if (ubo_size && (pass->pass || pass->job)) {
+        // Create the UBOs
+        for (int i = 0; i < UBO_RING_SIZE; i++) {
+            pass->ubos[i] = pl_buf_create(dp->gpu, pl_buf_params(
+                .size = ubo_size,
+                .uniform = true,
+                .host_writable = true,
+            ));
+
+            if (!pass->ubos[i]) {
+                PL_ERR(dp, "Failed creating uniform buffer for dispatch");
+                goto error;
+            }
         }
 
-        sh->descs.elem[pass->ubo_index].binding.object = pass->ubo;
+        pass->ubo_size = ubo_size;
+        pass->ubo_data = pl_zalloc(pass, ubo_size);
+        pass->ubo_dirty[1] = ubo_size;
+        pass->ubo_frame = dp->current_index;
+        sh->descs.elem[pass->ubo_index].binding.object = pass->ubos[0];
     }
 
     if (params.type == PL_PASS_RASTER && !vparams) {
@@ -961,7 +1632,13 @@ static struct pass *finalize_pass(pl_dispatch dp, pl_shader sh,
 
     pass->timer = pl_timer_create(dp->gpu);
 
-    PL_ARRAY_APPEND(dp, dp->passes, pass);
+    // Rough estimate of the driver-side memory, dominated by the compiled
+    // program (which scales with the shader source) and uniform buffers
+    pass->mem_size = glsl.len + UBO_RING_SIZE * ubo_size;
+    if (params.vertex_shader)
+        pass->mem_size += strlen(params.vertex_shader);
+
+    pass_add(dp, pass);
     return pass;
 
 error:
@@ -975,12 +1652,15 @@ static void update_pass_var(pl_dispatch dp, struct pass *pass,
     struct pl_var_layout host_layout = pl_var_host_layout(0, &sv->var);
     pl_assert(host_layout.size);
 
-    // Use the cache to skip updates if possible
-    if (pv->cached_data && !memcmp(sv->data, pv->cached_data, host_layout.size))
-        return;
-    if (!pv->cached_data)
-        pv->cached_data = pl_alloc(pass, host_layout.size);
-    memcpy(pv->cached_data, sv->data, host_layout.size);
+    // Use the cache to skip updates if possible. Dynamic variables are
+    // expected to change on every run, so don't bother comparing those
+    if (!pv->dynamic) {
+        if (pv->cached_data && !memcmp(sv->data, pv->cached_data, host_layout.size))
+            return;
+        if (!pv->cached_data)
+            pv->cached_data = pl_alloc(pass, host_layout.size);
+        memcpy(pv->cached_data, sv->data, host_layout.size);
+    }
 
     struct pl_pass_run_params *rparams = &pass->run_params;
     switch (pv->type) {
@@ -994,30 +1674,13 @@ static void update_pass_var(pl_dispatch dp, struct pass *pass,
         PL_ARRAY_APPEND_RAW(pass, rparams->var_updates, rparams->num_var_updates, vu);
         break;
     }
-    case PASS_VAR_UBO: {
-        pl_assert(pass->ubo);
-        const size_t offset = pv->layout.offset;
-        if (host_layout.stride == pv->layout.stride) {
-            pl_assert(host_layout.size == pv->layout.size);
-            pl_buf_write(dp->gpu, pass->ubo, offset, sv->data, host_layout.size);
-        } else {
-            // Coalesce strided UBO write into a single pl_buf_write to avoid
-            // unnecessary synchronization overhead by assembling the correctly
-            // strided upload in RAM
-            pl_grow(dp, &dp->ubo_tmp, pv->layout.size);
-            uint8_t * const tmp = dp->ubo_tmp;
-            const uint8_t *src = sv->data;
-            const uint8_t *end = src + host_layout.size;
-            uint8_t *dst = tmp;
-            while (src < end) {
-                memcpy(dst, src, host_layout.stride);
-                src += host_layout.stride;
-                dst += pv->layout.stride;
-            }
-            pl_buf_write(dp->gpu, pass->ubo, offset, tmp, pv->layout.size);
-        }
+    case PASS_VAR_UBO:
+        pl_assert(pass->ubo_data);
+        memcpy_layout(pass->ubo_data, pv->layout, sv->data, host_layout);
+        pass->ubo_dirty[0] = PL_MIN(pass->ubo_dirty[0], pv->layout.offset);
+        pass->ubo_dirty[1] = PL_MAX(pass->ubo_dirty[1], pv->layout.offset +
+                                                        pv->layout.size);
         break;
-    }
     case PASS_VAR_PUSHC:
         pl_assert(rparams->push_constants);
         memcpy_layout(rparams->push_constants, pv->layout, sv->data, host_layout);
@@ -1025,6 +1688,35 @@ static void update_pass_var(pl_dispatch dp, struct pass *pass,
     };
 }
 
+// Uploads the staged UBO contents (if needed) and binds the current buffer.
+// Must be called after all `update_pass_var` calls for this run.
+static void update_pass_ubo(pl_dispatch dp, struct pass *pass)
+{
+    if (!pass->ubo_size)
+        return;
+
+    // Move on to the next buffer once per frame, since the GPU may still be
+    // reading from the one used by the previous frame
+    if (pass->ubo_frame != dp->current_index) {
+        pass->ubo_frame = dp->current_index;
+        pass->ubo_idx = (pass->ubo_idx + 1) % UBO_RING_SIZE;
+        // last written UBO_RING_SIZE frames ago
+        pass->ubo_dirty[0] = 0;
+        pass->ubo_dirty[1] = pass->ubo_size;
+    }
+
+    // Upload all changed variables in a single contiguous write
+    pl_buf ubo = pass->ubos[pass->ubo_idx];
+    const size_t start = pass->ubo_dirty[0], end = pass->ubo_dirty[1];
+    if (start < end) {
+        pl_buf_write(dp->gpu, ubo, start, pass->ubo_data + start, end - start);
+        pass->ubo_dirty[0] = pass->ubo_size;
+        pass->ubo_dirty[1] = 0;
+    }
+
+    pass->run_params.desc_bindings[pass->ubo_index].object = ubo;
+}
+
 static void compute_vertex_attribs(pl_dispatch dp, pl_shader sh,
                                    int width, int height, ident_t *out_scale)
 {
@@ -1126,13 +1818,65 @@ static void translate_compute_shader(pl_dispatch dp, pl_shader sh,
     sh->output = PL_SHADER_SIG_NONE;
 }
 
+static void trace_record(pl_dispatch dp, pl_shader sh, struct pass *pass,
+                         pl_clock_t start, pl_clock_t end)
+{
+    if (dp->trace.num == MAX_TRACE_EVENTS) {
+        PL_WARN(dp, "Dispatch trace exceeded %d events, stopping trace!",
+                MAX_TRACE_EVENTS);
+        dp->tracing = false;
+        return;
+    }
+
+    const struct pl_pass_run_params *rparams = &pass->run_params;
+    struct trace_event ev = {
+        .signature  = pass->signature,
+        .shader     = pl_shader_info_ref(&sh->info->info),
+        .cpu_start  = start,
+        .cpu_end    = end,
+        .timed      = rparams->timer && rparams->timer == pass->timer,
+    };
+
+    if (rparams->target) {
+        ev.w = rparams->target->params.w;
+        ev.h = rparams->target->params.h;
+    }
+
+    if (pass->pass->params.type == PL_PASS_COMPUTE) {
+        memcpy(ev.groups, rparams->compute_groups, sizeof(ev.groups));
+        ev.group_size[0] = sh->group_size[0];
+        ev.group_size[1] = sh->group_size[1];
+    }
+
+    PL_ARRAY_APPEND(dp, dp->trace, ev);
+}
+
+// Timer results arrive in submission order, so attribute each one to the
+// oldest event of this pass still lacking one
+static void trace_gpu_time(pl_dispatch dp, struct pass *pass, uint64_t ts)
+{
+    for (int i = pass->trace_idx; i < dp->trace.num; i++) {
+        struct trace_event *ev = &dp->trace.elem[i];
+        if (ev->signature != pass->signature || !ev->timed || ev->gpu_time)
+            continue;
+        ev->gpu_time = ts;
+        pass->trace_idx = i + 1;
+        return;
+    }
+}
+
 static void run_pass(pl_dispatch dp, pl_shader sh, struct pass *pass)
 {
     pl_shader_info shader = &sh->info->info;
+    pl_clock_t start = dp->tracing ? pl_clock_now() : 0;
     pl_pass_run(dp->gpu, &pass->run_params);
+    if (dp->tracing)
+        trace_record(dp, sh, pass, start, pl_clock_now());
 
     for (uint64_t ts; (ts = pl_timer_query(dp->gpu, pass->timer));) {
         PL_TRACE(dp, "Spent %.3f ms on shader: %s", ts / 1e6, shader->description);
+        if (dp->tracing)
+            trace_gpu_time(dp, pass, ts);
 
         uint64_t old = pass->samples[pass->ts_idx];
         pass->samples[pass->ts_idx] = ts;
@@ -1155,9 +1899,10 @@ static void run_pass(pl_dispatch dp, pl_shader sh, struct pass *pass)
     if (!dp->info_callback)
         return;
 
-    struct pl_dispatch_info info;
-    info.signature = pass->signature;
-    info.shader = shader;
+    struct pl_dispatch_info info = {
+        .signature = pass->signature,
+        .shader    = shader,
+    };
 
     // Test to see if the ring buffer already wrapped around once
     if (pass->samples[pass->ts_idx]) {
@@ -1179,6 +1924,22 @@ static void run_pass(pl_dispatch dp, pl_shader sh, struct pass *pass)
     dp->info_callback(dp->info_priv, &info);
 }
 
+// Report a dispatch that was skipped because its pass is still compiling
+static void skip_pass(pl_dispatch dp, pl_shader sh, struct pass *pass)
+{
+    PL_TRACE(dp, "Skipping dispatch of pass 0x%"PRIx64" (still compiling)",
+             pass->signature);
+    if (!dp->info_callback)
+        return;
+
+    struct pl_dispatch_info info = {
+        .signature = pass->signature,
+        .shader    = &sh->info->info,
+        .skipped   = true,
+    };
+    dp->info_callback(dp->info_priv, &info);
+}
+
 bool pl_dispatch_finish(pl_dispatch dp, const struct pl_dispatch_params *params)
 {
     pl_shader sh = *params->shader;
@@ -1280,7 +2041,14 @@ bool pl_dispatch_finish(pl_dispatch dp, const struct pl_dispatch_params *params)
     bool load = params->blend_params || !pl_rect2d_eq(rc_norm, full);
 
     struct pass *pass = finalize_pass(dp, sh, params->target, vert_idx,
-                                      params->blend_params, load, NULL, proj);
+                                      params->blend_params, load, NULL, proj,
+                                      !params->timer);
+
+    if (pass && pass_pending(dp, pass, false)) {
+        skip_pass(dp, sh, pass);
+        ret = true;
+        goto error;
+    }
 
     // Silently return on failed passes
     if (!pass || !pass->pass)
@@ -1296,6 +2064,7 @@ bool pl_dispatch_finish(pl_dispatch dp, const struct pl_dispatch_params *params)
     rparams->num_var_updates = 0;
     for (int i = 0; i < sh->vars.num; i++)
         update_pass_var(dp, pass, &sh->vars.elem[i], &pass->vars[i]);
+    update_pass_ubo(dp, pass);
 
     // Update the vertex data
     if (rparams->vertex_data) {
@@ -1332,6 +2101,11 @@ bool pl_dispatch_finish(pl_dispatch dp, const struct pl_dispatch_params *params)
         rparams->scissors = rc_norm;
     }
 
+    // Raster passes get this from `load_target`, but storage images are
+    // preserved by default, so explicitly discard fully overwritten targets
+    if (pl_shader_is_compute(sh) && !load)
+        pl_tex_invalidate(dp->gpu, params->target);
+
     // Dispatch the actual shader
     rparams->target = params->target;
     rparams->timer = PL_DEF(params->timer, pass->timer);
@@ -1389,7 +2163,17 @@ bool pl_dispatch_compute(pl_dispatch dp, const struct pl_dispatch_compute_params
                                &(ident_t){0});
     }
 
-    struct pass *pass = finalize_pass(dp, sh, NULL, -1, NULL, false, NULL, NULL);
+    // Explicit dispatch sizes are tied to the requested group size
+    const int *size = params->dispatch_size;
+    const bool autotune = !params->timer && !(size[0] && size[1] && size[2]);
+    struct pass *pass = finalize_pass(dp, sh, NULL, -1, NULL, false, NULL, NULL,
+                                      autotune);
+
+    if (pass && pass_pending(dp, pass, false)) {
+        skip_pass(dp, sh, pass);
+        ret = true;
+        goto error;
+    }
 
     // Silently return on failed passes
     if (!pass || !pass->pass)
@@ -1405,6 +2189,7 @@ bool pl_dispatch_compute(pl_dispatch dp, const struct pl_dispatch_compute_params
     rparams->num_var_updates = 0;
     for (int i = 0; i < sh->vars.num; i++)
         update_pass_var(dp, pass, &sh->vars.elem[i], &pass->vars[i]);
+    update_pass_ubo(dp, pass);
 
     // Update the dispatch size
     int groups = 1;
@@ -1526,7 +2311,14 @@ bool pl_dispatch_vertex(pl_dispatch dp, const struct pl_dispatch_vertex_params *
     }
 
     struct pass *pass = finalize_pass(dp, sh, params->target, pos_idx,
-                                      params->blend_params, true, params, &proj);
+                                      params->blend_params, true, params, &proj,
+                                      false);
+
+    if (pass && pass_pending(dp, pass, false)) {
+        skip_pass(dp, sh, pass);
+        ret = true;
+        goto error;
+    }
 
     // Silently return on failed passes
     if (!pass || !pass->pass)
@@ -1542,6 +2334,7 @@ bool pl_dispatch_vertex(pl_dispatch dp, const struct pl_dispatch_vertex_params *
     rparams->num_var_updates = 0;
     for (int i = 0; i < sh->vars.num; i++)
         update_pass_var(dp, pass, &sh->vars.elem[i], &pass->vars[i]);
+    update_pass_ubo(dp, pass);
 
     // Update the scissors
     rparams->scissors = params->scissors;
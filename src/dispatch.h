@@ -29,3 +29,13 @@ pl_shader pl_dispatch_begin_ex(pl_dispatch dp, bool unique);
 //
 // This is a private API because it's sort of clunky/stateful.
 void pl_dispatch_mark_dynamic(pl_dispatch dp, bool dynamic);
+
+// Set the `relaxed_precision` field for newly created `pl_shader` objects.
+void pl_dispatch_mark_relaxed(pl_dispatch dp, bool relaxed);
+
+// Returns the current value set by `pl_dispatch_async`.
+bool pl_dispatch_is_async(pl_dispatch dp);
+
+// Returns the amount of GPU memory (in bytes) held by the uniform buffers of
+// all currently cached passes.
+size_t pl_dispatch_mem_usage(pl_dispatch dp);
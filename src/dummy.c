@@ -16,9 +16,11 @@
  */
 
 #include <limits.h>
+#include <math.h>
 #include <string.h>
 
 #include "gpu.h"
+#include "pl_thread_pool.h"
 
 #include <libplacebo/dummy.h>
 
@@ -28,8 +30,118 @@ static const struct pl_gpu_fns pl_fns_dummy;
 struct priv {
     struct pl_gpu_fns impl;
     struct pl_gpu_dummy_params params;
+
+    // Capture stream state, only used if `params.capture` is set
+    pl_mutex cap_lock;
+    pl_str cap_buf;
+    uint32_t cap_next_id;
+};
+
+// Capture stream format: a header followed by a sequence of records, each
+// starting with an opcode. All values are in host byte order. Object IDs are
+// assigned sequentially on creation, starting from 1, with 0 meaning NULL.
+#define CAP_MAGIC   0x50434c50 // "PLCP"
+#define CAP_VERSION 1
+
+enum cap_op {
+    CAP_TEX_CREATE = 1,
+    CAP_TEX_DESTROY,
+    CAP_TEX_UPLOAD,
+    CAP_TEX_DOWNLOAD,
+    CAP_BUF_CREATE,
+    CAP_BUF_DESTROY,
+    CAP_BUF_WRITE,
+    CAP_BUF_READ,
+    CAP_BUF_COPY,
+    CAP_PASS_CREATE,
+    CAP_PASS_DESTROY,
+    CAP_PASS_RUN,
+    CAP_FLUSH,
+    CAP_FINISH,
+    CAP_TEX_CLEAR,
+    CAP_TEX_BLIT,
+};
+
+enum cap_flags {
+    CAP_SAMPLEABLE      = 1 << 0,
+    CAP_RENDERABLE      = 1 << 1,
+    CAP_STORABLE        = 1 << 2,
+    CAP_BLIT_SRC        = 1 << 3,
+    CAP_BLIT_DST        = 1 << 4,
+    CAP_HOST_WRITABLE   = 1 << 5,
+    CAP_HOST_READABLE   = 1 << 6,
+    CAP_UNIFORM         = 1 << 7,
+    CAP_DRAWABLE        = 1 << 8,
+    CAP_PLACEHOLDER     = 1 << 9,
 };
 
+#define CAP_FLAG(cond, flag) ((cond) ? (flag) : 0)
+
+static bool cap_begin(pl_gpu gpu, enum cap_op op)
+{
+    struct priv *p = PL_PRIV(gpu);
+    if (!p->params.capture)
+        return false;
+
+    pl_mutex_lock(&p->cap_lock);
+    p->cap_buf.len = 0;
+    pl_str_append_raw((void *) gpu, &p->cap_buf, &(uint32_t) { op }, sizeof(uint32_t));
+    return true;
+}
+
+static void cap_end(pl_gpu gpu)
+{
+    struct priv *p = PL_PRIV(gpu);
+    p->params.capture(p->params.capture_priv, p->cap_buf.buf, p->cap_buf.len);
+    pl_mutex_unlock(&p->cap_lock);
+}
+
+static void cap_u32(pl_gpu gpu, uint32_t val)
+{
+    struct priv *p = PL_PRIV(gpu);
+    pl_str_append_raw((void *) gpu, &p->cap_buf, &val, sizeof(val));
+}
+
+static void cap_u64(pl_gpu gpu, uint64_t val)
+{
+    struct priv *p = PL_PRIV(gpu);
+    pl_str_append_raw((void *) gpu, &p->cap_buf, &val, sizeof(val));
+}
+
+static void cap_blob(pl_gpu gpu, const void *data, size_t size)
+{
+    struct priv *p = PL_PRIV(gpu);
+    cap_u64(gpu, data ? size : 0);
+    if (data && size)
+        pl_str_append_raw((void *) gpu, &p->cap_buf, data, size);
+}
+
+static void cap_str(pl_gpu gpu, const char *str)
+{
+    cap_blob(gpu, str, str ? strlen(str) : 0);
+}
+
+static void cap_rect2d(pl_gpu gpu, pl_rect2d rc)
+{
+    const int32_t coords[] = { rc.x0, rc.y0, rc.x1, rc.y1 };
+    for (int i = 0; i < PL_ARRAY_SIZE(coords); i++)
+        cap_u32(gpu, coords[i]);
+}
+
+static void cap_rect3d(pl_gpu gpu, pl_rect3d rc)
+{
+    const int32_t coords[] = { rc.x0, rc.y0, rc.z0, rc.x1, rc.y1, rc.z1 };
+    for (int i = 0; i < PL_ARRAY_SIZE(coords); i++)
+        cap_u32(gpu, coords[i]);
+}
+
+// Must be called with `cap_lock` held
+static uint32_t cap_new_id(pl_gpu gpu)
+{
+    struct priv *p = PL_PRIV(gpu);
+    return ++p->cap_next_id;
+}
+
 pl_gpu pl_gpu_dummy_create(pl_log log, const struct pl_gpu_dummy_params *params)
 {
     params = PL_DEF(params, &pl_gpu_dummy_default_params);
@@ -48,6 +160,16 @@ pl_gpu pl_gpu_dummy_create(pl_log log, const struct pl_gpu_dummy_params *params)
     gpu->limits.align_tex_xfer_offset = 1;
     gpu->limits.align_vertex_stride = 1;
 
+    if (params->capture) {
+        // Writes through persistent mappings can't be observed, and hence
+        // can't be captured
+        gpu->limits.max_mapped_size = 0;
+        pl_mutex_init(&p->cap_lock);
+        p->cap_buf = (pl_str) {0};
+        const uint32_t header[2] = { CAP_MAGIC, CAP_VERSION };
+        params->capture(params->capture_priv, header, sizeof(header));
+    }
+
     // Set up the dummy formats, add one for each possible format type that we
     // can represent on the host
     PL_ARRAY(pl_fmt) formats = {0};
@@ -88,7 +210,8 @@ pl_gpu pl_gpu_dummy_create(pl_log log, const struct pl_gpu_dummy_params *params)
                     .texel_align = 1,
                     .caps = PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_LINEAR |
                             PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_BLENDABLE |
-                            PL_FMT_CAP_VERTEX | PL_FMT_CAP_HOST_READABLE,
+                            PL_FMT_CAP_BLITTABLE | PL_FMT_CAP_VERTEX |
+                            PL_FMT_CAP_HOST_READABLE,
                 };
 
                 for (int i = 0; i < comps; i++) {
@@ -121,6 +244,9 @@ pl_gpu pl_gpu_dummy_create(pl_log log, const struct pl_gpu_dummy_params *params)
 
 static void dumb_destroy(pl_gpu gpu)
 {
+    struct priv *p = PL_PRIV(gpu);
+    if (p->params.capture)
+        pl_mutex_destroy(&p->cap_lock);
     pl_free((void *) gpu);
 }
 
@@ -132,6 +258,7 @@ void pl_gpu_dummy_destroy(pl_gpu *gpu)
 
 struct buf_priv {
     uint8_t *data;
+    uint32_t id;
 };
 
 static pl_buf dumb_buf_create(pl_gpu gpu, const struct pl_buf_params *params)
@@ -153,12 +280,32 @@ static pl_buf dumb_buf_create(pl_gpu gpu, const struct pl_buf_params *params)
     if (params->host_mapped)
         buf->data = p->data;
 
+    if (cap_begin(gpu, CAP_BUF_CREATE)) {
+        p->id = cap_new_id(gpu);
+        cap_u32(gpu, p->id);
+        cap_u64(gpu, params->size);
+        cap_u32(gpu, params->memory_type);
+        cap_str(gpu, params->format ? params->format->name : NULL);
+        cap_u32(gpu, CAP_FLAG(params->host_writable, CAP_HOST_WRITABLE) |
+                     CAP_FLAG(params->host_readable, CAP_HOST_READABLE) |
+                     CAP_FLAG(params->uniform,       CAP_UNIFORM)       |
+                     CAP_FLAG(params->storable,      CAP_STORABLE)      |
+                     CAP_FLAG(params->drawable,      CAP_DRAWABLE));
+        cap_blob(gpu, params->initial_data, params->size);
+        cap_end(gpu);
+    }
+
     return buf;
 }
 
 static void dumb_buf_destroy(pl_gpu gpu, pl_buf buf)
 {
     struct buf_priv *p = PL_PRIV(buf);
+    if (cap_begin(gpu, CAP_BUF_DESTROY)) {
+        cap_u32(gpu, p->id);
+        cap_end(gpu);
+    }
+
     free(p->data);
     pl_free((void *) buf);
 }
@@ -174,6 +321,13 @@ static void dumb_buf_write(pl_gpu gpu, pl_buf buf, size_t buf_offset,
 {
     struct buf_priv *p = PL_PRIV(buf);
     memcpy(p->data + buf_offset, data, size);
+
+    if (cap_begin(gpu, CAP_BUF_WRITE)) {
+        cap_u32(gpu, p->id);
+        cap_u64(gpu, buf_offset);
+        cap_blob(gpu, data, size);
+        cap_end(gpu);
+    }
 }
 
 static bool dumb_buf_read(pl_gpu gpu, pl_buf buf, size_t buf_offset,
@@ -181,6 +335,14 @@ static bool dumb_buf_read(pl_gpu gpu, pl_buf buf, size_t buf_offset,
 {
     struct buf_priv *p = PL_PRIV(buf);
     memcpy(dest, p->data + buf_offset, size);
+
+    if (cap_begin(gpu, CAP_BUF_READ)) {
+        cap_u32(gpu, p->id);
+        cap_u64(gpu, buf_offset);
+        cap_u64(gpu, size);
+        cap_end(gpu);
+    }
+
     return true;
 }
 
@@ -190,12 +352,73 @@ static void dumb_buf_copy(pl_gpu gpu, pl_buf dst, size_t dst_offset,
     struct buf_priv *dstp = PL_PRIV(dst);
     struct buf_priv *srcp = PL_PRIV(src);
     memcpy(dstp->data + dst_offset, srcp->data + src_offset, size);
+
+    if (cap_begin(gpu, CAP_BUF_COPY)) {
+        cap_u32(gpu, dstp->id);
+        cap_u64(gpu, dst_offset);
+        cap_u32(gpu, srcp->id);
+        cap_u64(gpu, src_offset);
+        cap_u64(gpu, size);
+        cap_end(gpu);
+    }
 }
 
 struct tex_priv {
     void *data;
+    uint32_t id;
 };
 
+static size_t tex_size(pl_gpu gpu, pl_tex tex);
+
+static void cap_tex_create(pl_gpu gpu, pl_tex tex, const void *initial_data,
+                           enum cap_flags flags)
+{
+    if (!cap_begin(gpu, CAP_TEX_CREATE))
+        return;
+
+    struct tex_priv *p = PL_PRIV(tex);
+    const struct pl_tex_params *params = &tex->params;
+    p->id = cap_new_id(gpu);
+    cap_u32(gpu, p->id);
+    cap_u32(gpu, params->w);
+    cap_u32(gpu, params->h);
+    cap_u32(gpu, params->d);
+    cap_str(gpu, params->format->name);
+    cap_u32(gpu, flags | CAP_FLAG(params->sampleable,    CAP_SAMPLEABLE)    |
+                         CAP_FLAG(params->renderable,    CAP_RENDERABLE)    |
+                         CAP_FLAG(params->storable,      CAP_STORABLE)      |
+                         CAP_FLAG(params->blit_src,      CAP_BLIT_SRC)      |
+                         CAP_FLAG(params->blit_dst,      CAP_BLIT_DST)      |
+                         CAP_FLAG(params->host_writable, CAP_HOST_WRITABLE) |
+                         CAP_FLAG(params->host_readable, CAP_HOST_READABLE));
+    cap_blob(gpu, initial_data, initial_data ? tex_size(gpu, tex) : 0);
+    cap_end(gpu);
+}
+
+static void cap_tex_transfer(pl_gpu gpu, enum cap_op op,
+                             const struct pl_tex_transfer_params *params)
+{
+    if (!cap_begin(gpu, op))
+        return;
+
+    const struct tex_priv *p = PL_PRIV(params->tex);
+    cap_u32(gpu, p->id);
+    cap_rect3d(gpu, params->rc);
+    cap_u64(gpu, params->row_pitch);
+    cap_u64(gpu, params->depth_pitch);
+    if (params->buf) {
+        const struct buf_priv *bufp = PL_PRIV(params->buf);
+        cap_u32(gpu, bufp->id);
+        cap_u64(gpu, params->buf_offset);
+    } else {
+        cap_u32(gpu, 0);
+        cap_u64(gpu, 0);
+    }
+    if (op == CAP_TEX_UPLOAD && !params->buf)
+        cap_blob(gpu, params->ptr, pl_tex_transfer_size(params));
+    cap_end(gpu);
+}
+
 static size_t tex_size(pl_gpu gpu, pl_tex tex)
 {
     size_t size = tex->params.format->texel_size * tex->params.w;
@@ -206,7 +429,7 @@ static size_t tex_size(pl_gpu gpu, pl_tex tex)
 
 static pl_tex dumb_tex_create(pl_gpu gpu, const struct pl_tex_params *params)
 {
-    struct pl_tex_t *tex = pl_zalloc_obj(NULL, tex, void *);
+    struct pl_tex_t *tex = pl_zalloc_obj(NULL, tex, struct tex_priv);
     tex->params = *params;
     tex->params.initial_data = NULL;
 
@@ -221,6 +444,7 @@ static pl_tex dumb_tex_create(pl_gpu gpu, const struct pl_tex_params *params)
     if (params->initial_data)
         memcpy(p->data, params->initial_data, tex_size(gpu, tex));
 
+    cap_tex_create(gpu, tex, params->initial_data, 0);
     return tex;
 }
 
@@ -240,12 +464,18 @@ pl_tex pl_tex_dummy_create(pl_gpu gpu, const struct pl_tex_dummy_params *params)
         .user_data = params->user_data,
     };
 
+    cap_tex_create(gpu, tex, NULL, CAP_PLACEHOLDER);
     return tex;
 }
 
 static void dumb_tex_destroy(pl_gpu gpu, pl_tex tex)
 {
     struct tex_priv *p = PL_PRIV(tex);
+    if (cap_begin(gpu, CAP_TEX_DESTROY)) {
+        cap_u32(gpu, p->id);
+        cap_end(gpu);
+    }
+
     if (p->data)
         free(p->data);
     pl_free((void *) tex);
@@ -262,6 +492,7 @@ static bool dumb_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *par
     pl_tex tex = params->tex;
     struct tex_priv *p = PL_PRIV(tex);
     pl_assert(p->data);
+    cap_tex_transfer(gpu, CAP_TEX_UPLOAD, params);
 
     const uint8_t *src = params->ptr;
     uint8_t *dst = p->data;
@@ -273,13 +504,13 @@ static bool dumb_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *par
     size_t texel_size = tex->params.format->texel_size;
     size_t row_size = pl_rect_w(params->rc) * texel_size;
     for (int z = params->rc.z0; z < params->rc.z1; z++) {
-        size_t src_plane = z * params->depth_pitch;
+        size_t src_plane = (z - params->rc.z0) * params->depth_pitch;
         size_t dst_plane = z * tex->params.h * tex->params.w * texel_size;
         for (int y = params->rc.y0; y < params->rc.y1; y++) {
-            size_t src_row = src_plane + y * params->row_pitch;
+            size_t src_row = src_plane + (y - params->rc.y0) * params->row_pitch;
             size_t dst_row = dst_plane + y * tex->params.w * texel_size;
             size_t pos = params->rc.x0 * texel_size;
-            memcpy(&dst[dst_row + pos], &src[src_row + pos], row_size);
+            memcpy(&dst[dst_row + pos], &src[src_row], row_size);
         }
     }
 
@@ -291,6 +522,7 @@ static bool dumb_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *p
     pl_tex tex = params->tex;
     struct tex_priv *p = PL_PRIV(tex);
     pl_assert(p->data);
+    cap_tex_transfer(gpu, CAP_TEX_DOWNLOAD, params);
 
     const uint8_t *src = p->data;
     uint8_t *dst = params->ptr;
@@ -303,32 +535,1003 @@ static bool dumb_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *p
     size_t row_size = pl_rect_w(params->rc) * texel_size;
     for (int z = params->rc.z0; z < params->rc.z1; z++) {
         size_t src_plane = z * tex->params.h * tex->params.w * texel_size;
-        size_t dst_plane = z * params->depth_pitch;
+        size_t dst_plane = (z - params->rc.z0) * params->depth_pitch;
         for (int y = params->rc.y0; y < params->rc.y1; y++) {
             size_t src_row = src_plane + y * tex->params.w * texel_size;
-            size_t dst_row = dst_plane + y * params->row_pitch;
+            size_t dst_row = dst_plane + (y - params->rc.y0) * params->row_pitch;
             size_t pos = params->rc.x0 * texel_size;
-            memcpy(&dst[dst_row + pos], &src[src_row + pos], row_size);
+            memcpy(&dst[dst_row], &src[src_row + pos], row_size);
         }
     }
 
     return true;
 }
 
+// Texel (de)coding helpers, used to execute clears and blits on the CPU. All
+// dummy formats have one host-representable value per component, in order.
+static float half_to_float(uint16_t h)
+{
+    int exp = (h >> 10) & 0x1F, mant = h & 0x3FF;
+    float val;
+    if (exp == 0) {
+        val = ldexpf(mant, -24);
+    } else if (exp == 0x1F) {
+        val = mant ? NAN : INFINITY;
+    } else {
+        val = ldexpf(mant | 0x400, exp - 25);
+    }
+    return (h & 0x8000) ? -val : val;
+}
+
+static uint16_t float_to_half(float f)
+{
+    uint32_t x;
+    memcpy(&x, &f, sizeof(x));
+    uint16_t sign = (x >> 16) & 0x8000;
+    float a = fabsf(f);
+    if (isnan(a))
+        return sign | 0x7E00;
+    if (a >= 65520.0f)
+        return sign | 0x7C00;
+    if (a < 0x1p-14f) // subnormal, in units of 2^-24
+        return sign | (uint16_t) lrintf(a * 0x1p24f);
+
+    int exp;
+    float mant = frexpf(a, &exp); // a = mant * 2^exp, mant in [0.5, 1)
+    uint32_t bits = lrintf(mant * 2048.0f); // 11 significant bits
+    if (bits == 2048) {
+        bits = 1024;
+        exp++;
+    }
+    // Rounding may have overflowed into infinity, which is also correct
+    return sign | (uint16_t) (((exp + 14) << 10) + (bits - 1024));
+}
+
+static double read_comp(pl_fmt fmt, const uint8_t *ptr, int c)
+{
+    const int depth = fmt->component_depth[c];
+    ptr += c * depth / 8;
+
+    union { uint8_t u8; uint16_t u16; uint32_t u32; uint64_t u64;
+            int8_t i8; int16_t i16; int32_t i32; int64_t i64;
+            float f; double d; } v;
+    memcpy(&v, ptr, depth / 8);
+
+    const double umax = ldexp(1.0, depth) - 1, smax = ldexp(1.0, depth - 1) - 1;
+    switch (fmt->type) {
+    case PL_FMT_FLOAT:
+        switch (depth) {
+        case 16: return half_to_float(v.u16);
+        case 32: return v.f;
+        case 64: return v.d;
+        }
+        break;
+    case PL_FMT_UNORM:
+    case PL_FMT_UINT: {
+        double u = depth == 8 ? v.u8 : depth == 16 ? v.u16 :
+                   depth == 32 ? v.u32 : (double) v.u64;
+        return fmt->type == PL_FMT_UNORM ? u / umax : u;
+    }
+    case PL_FMT_SNORM:
+    case PL_FMT_SINT: {
+        double i = depth == 8 ? v.i8 : depth == 16 ? v.i16 :
+                   depth == 32 ? v.i32 : (double) v.i64;
+        return fmt->type == PL_FMT_SNORM ? PL_MAX(i / smax, -1.0) : i;
+    }
+    case PL_FMT_UNKNOWN:
+    case PL_FMT_TYPE_COUNT:
+        break;
+    }
+
+    pl_unreachable();
+}
+
+static void write_comp(pl_fmt fmt, uint8_t *ptr, int c, double val)
+{
+    const int depth = fmt->component_depth[c];
+    ptr += c * depth / 8;
+
+    union { uint8_t u8; uint16_t u16; uint32_t u32; uint64_t u64;
+            int8_t i8; int16_t i16; int32_t i32; int64_t i64;
+            float f; double d; } v;
+
+    const double umax = ldexp(1.0, depth) - 1, smax = ldexp(1.0, depth - 1) - 1;
+    switch (fmt->type) {
+    case PL_FMT_FLOAT:
+        switch (depth) {
+        case 16: v.u16 = float_to_half(val); break;
+        case 32: v.f = val; break;
+        case 64: v.d = val; break;
+        }
+        break;
+    case PL_FMT_UNORM:
+    case PL_FMT_UINT: {
+        if (fmt->type == PL_FMT_UNORM)
+            val = PL_CLAMP(val, 0.0, 1.0) * umax;
+        val = PL_CLAMP(round(val), 0.0, umax);
+        switch (depth) {
+        case 8:  v.u8  = val; break;
+        case 16: v.u16 = val; break;
+        case 32: v.u32 = val; break;
+        case 64: v.u64 = val >= 0x1p64 ? UINT64_MAX : (uint64_t) val; break;
+        }
+        break;
+    }
+    case PL_FMT_SNORM:
+    case PL_FMT_SINT: {
+        if (fmt->type == PL_FMT_SNORM)
+            val = PL_CLAMP(val, -1.0, 1.0) * smax;
+        val = PL_CLAMP(round(val), -smax - 1, smax);
+        switch (depth) {
+        case 8:  v.i8  = val; break;
+        case 16: v.i16 = val; break;
+        case 32: v.i32 = val; break;
+        case 64: v.i64 = val >= 0x1p63 ? INT64_MAX : (int64_t) val; break;
+        }
+        break;
+    }
+    case PL_FMT_UNKNOWN:
+    case PL_FMT_TYPE_COUNT:
+        pl_unreachable();
+    }
+
+    memcpy(ptr, &v, depth / 8);
+}
+
+// Rows of texels processed per parallel job
+#define CPU_JOB_TEXELS (1 << 16)
+
+static size_t tex_texel_offset(pl_tex tex, int x, int y, int z)
+{
+    const size_t w = tex->params.w, h = PL_DEF(tex->params.h, 1);
+    return ((z * h + y) * w + x) * tex->params.format->texel_size;
+}
+
+static void dumb_tex_clear_ex(pl_gpu gpu, pl_tex tex, const union pl_clear_color color)
+{
+    struct tex_priv *p = PL_PRIV(tex);
+    pl_assert(p->data);
+    if (cap_begin(gpu, CAP_TEX_CLEAR)) {
+        cap_u32(gpu, p->id);
+        for (int i = 0; i < 4; i++)
+            cap_u32(gpu, color.u[i]);
+        cap_end(gpu);
+    }
+
+    pl_fmt fmt = tex->params.format;
+    uint8_t texel[4 * sizeof(double)];
+    for (int c = 0; c < fmt->num_components; c++) {
+        switch (fmt->type) {
+        case PL_FMT_UINT: write_comp(fmt, texel, c, color.u[c]); break;
+        case PL_FMT_SINT: write_comp(fmt, texel, c, color.i[c]); break;
+        default:          write_comp(fmt, texel, c, color.f[c]); break;
+        }
+    }
+
+    uint8_t *data = p->data;
+    const size_t texels = tex_size(gpu, tex) / fmt->texel_size;
+    for (size_t i = 0; i < texels; i++)
+        memcpy(&data[i * fmt->texel_size], texel, fmt->texel_size);
+}
+
+struct blit_job {
+    const struct pl_tex_blit_params *params;
+    int rows, rows_per_job;
+    bool direct;
+};
+
+// Maps the center of destination texel `i` along one axis to a source texel
+// coordinate, respecting flipped rects
+static double blit_map(int i, int dst0, int dst1, int src0, int src1)
+{
+    double t = (i + 0.5 - dst0) / (dst1 - dst0);
+    return src0 + t * (src1 - src0);
+}
+
+struct blit_axis {
+    int idx[2];
+    double weight[2];
+};
+
+static struct blit_axis blit_axis(double pos, int src0, int src1, bool linear)
+{
+    const int lo = PL_MIN(src0, src1), hi = PL_MAX(src0, src1) - 1;
+    if (!linear) {
+        int i = PL_CLAMP((int) floor(pos), lo, hi);
+        return (struct blit_axis) { {i, i}, {1.0, 0.0} };
+    }
+
+    double fpos = pos - 0.5, base = floor(fpos), frac = fpos - base;
+    return (struct blit_axis) {
+        .idx    = { PL_CLAMP((int) base, lo, hi), PL_CLAMP((int) base + 1, lo, hi) },
+        .weight = { 1.0 - frac, frac },
+    };
+}
+
+static void blit_rows(void *priv, int job)
+{
+    const struct blit_job *j = priv;
+    const struct pl_tex_blit_params *params = j->params;
+    pl_tex src = params->src, dst = params->dst;
+    const uint8_t *src_data = ((struct tex_priv *) PL_PRIV(src))->data;
+    uint8_t *dst_data = ((struct tex_priv *) PL_PRIV(dst))->data;
+    pl_fmt src_fmt = src->params.format, dst_fmt = dst->params.format;
+    const pl_rect3d s = params->src_rc, d = params->dst_rc;
+    const bool linear = params->sample_mode == PL_TEX_SAMPLE_LINEAR;
+
+    pl_rect3d dn = d;
+    pl_rect3d_normalize(&dn);
+    const int dh = pl_rect_h(dn);
+    const int row1 = PL_MIN((job + 1) * j->rows_per_job, j->rows);
+    for (int row = job * j->rows_per_job; row < row1; row++) {
+        const int y = dn.y0 + row % dh, z = dn.z0 + row / dh;
+        const struct blit_axis ay = blit_axis(blit_map(y, d.y0, d.y1, s.y0, s.y1),
+                                              s.y0, s.y1, linear);
+        const struct blit_axis az = blit_axis(blit_map(z, d.z0, d.z1, s.z0, s.z1),
+                                              s.z0, s.z1, linear);
+
+        for (int x = dn.x0; x < dn.x1; x++) {
+            const struct blit_axis ax = blit_axis(blit_map(x, d.x0, d.x1, s.x0, s.x1),
+                                                  s.x0, s.x1, linear);
+            uint8_t *out = &dst_data[tex_texel_offset(dst, x, y, z)];
+            if (j->direct) {
+                const size_t off = tex_texel_offset(src, ax.idx[0], ay.idx[0], az.idx[0]);
+                memcpy(out, &src_data[off], dst_fmt->texel_size);
+                continue;
+            }
+
+            double sum[4] = {0};
+            for (int tap = 0; tap < 8; tap++) {
+                const int tx = tap & 1, ty = (tap >> 1) & 1, tz = tap >> 2;
+                const double w = ax.weight[tx] * ay.weight[ty] * az.weight[tz];
+                if (!w)
+                    continue;
+                const uint8_t *in = &src_data[tex_texel_offset(src, ax.idx[tx],
+                                                     ay.idx[ty], az.idx[tz])];
+                for (int c = 0; c < src_fmt->num_components; c++)
+                    sum[c] += w * read_comp(src_fmt, in, c);
+            }
+
+            for (int c = 0; c < dst_fmt->num_components; c++)
+                write_comp(dst_fmt, out, c, sum[c]);
+        }
+    }
+}
+
+static void dumb_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params)
+{
+    pl_tex src = params->src, dst = params->dst;
+    pl_assert(PL_PRIV(src) && ((struct tex_priv *) PL_PRIV(src))->data);
+    pl_assert(PL_PRIV(dst) && ((struct tex_priv *) PL_PRIV(dst))->data);
+    if (cap_begin(gpu, CAP_TEX_BLIT)) {
+        cap_u32(gpu, ((struct tex_priv *) PL_PRIV(src))->id);
+        cap_u32(gpu, ((struct tex_priv *) PL_PRIV(dst))->id);
+        cap_rect3d(gpu, params->src_rc);
+        cap_rect3d(gpu, params->dst_rc);
+        cap_u32(gpu, params->sample_mode);
+        cap_end(gpu);
+    }
+
+    pl_rect3d s = params->src_rc, d = params->dst_rc;
+    pl_rect3d_normalize(&d);
+    const int w = pl_rect_w(d), rows = pl_rect_h(d) * pl_rect_d(d);
+
+    // Unscaled blits between identical formats are plain texel copies,
+    // regardless of the filter
+    struct blit_job job = {
+        .params = params,
+        .rows = rows,
+        .rows_per_job = PL_MAX(CPU_JOB_TEXELS / w, 1),
+        .direct = src->params.format == dst->params.format &&
+                  abs(pl_rect_w(s)) == w && abs(pl_rect_h(s)) == pl_rect_h(d) &&
+                  abs(pl_rect_d(s)) == pl_rect_d(d),
+    };
+
+    // Blits within the same texture would race, so do those serially
+    const int jobs = PL_DIV_UP(rows, job.rows_per_job);
+    if (jobs > 1 && src != dst) {
+        pl_parallel_for(jobs, blit_rows, &job);
+    } else {
+        for (int i = 0; i < jobs; i++)
+            blit_rows(&job, i);
+    }
+}
+
 static int dumb_desc_namespace(pl_gpu gpu, enum pl_desc_type type)
 {
     return 0; // safest behavior: never alias bindings
 }
 
+struct pass_priv {
+    uint32_t id;
+};
+
+static size_t constant_data_size(const struct pl_pass_params *params)
+{
+    size_t size = 0;
+    for (int i = 0; i < params->num_constants; i++) {
+        const struct pl_constant *c = &params->constants[i];
+        size = PL_MAX(size, c->offset + pl_var_type_size(c->type));
+    }
+    return size;
+}
+
+static uint32_t desc_obj_id(enum pl_desc_type type, const void *obj)
+{
+    if (!obj)
+        return 0;
+
+    switch (type) {
+    case PL_DESC_SAMPLED_TEX:
+    case PL_DESC_STORAGE_IMG: {
+        const struct tex_priv *p = PL_PRIV((pl_tex) obj);
+        return p->id;
+    }
+    case PL_DESC_BUF_UNIFORM:
+    case PL_DESC_BUF_STORAGE:
+    case PL_DESC_BUF_TEXEL_UNIFORM:
+    case PL_DESC_BUF_TEXEL_STORAGE: {
+        const struct buf_priv *p = PL_PRIV((pl_buf) obj);
+        return p->id;
+    }
+    case PL_DESC_INVALID:
+    case PL_DESC_TYPE_COUNT:
+        break;
+    }
+
+    pl_unreachable();
+}
+
 static pl_pass dumb_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
 {
-    PL_ERR(gpu, "Creating render passes is not supported for dummy GPUs");
-    return NULL;
+    if (!cap_begin(gpu, CAP_PASS_CREATE)) {
+        PL_ERR(gpu, "Creating render passes is not supported for dummy GPUs");
+        return NULL;
+    }
+
+    // In capture mode, passes are accepted without compiling anything
+    struct pl_pass_t *pass = pl_zalloc_obj(NULL, pass, struct pass_priv);
+    pass->params = pl_pass_params_copy(pass, params);
+    struct pass_priv *p = PL_PRIV(pass);
+    p->id = cap_new_id(gpu);
+
+    cap_u32(gpu, p->id);
+    cap_u32(gpu, params->type);
+    cap_u32(gpu, params->num_variables);
+    for (int i = 0; i < params->num_variables; i++) {
+        const struct pl_var *var = &params->variables[i];
+        cap_str(gpu, var->name);
+        cap_u32(gpu, var->type);
+        cap_u32(gpu, var->dim_v);
+        cap_u32(gpu, var->dim_m);
+        cap_u32(gpu, var->dim_a);
+    }
+    cap_u32(gpu, params->num_descriptors);
+    for (int i = 0; i < params->num_descriptors; i++) {
+        const struct pl_desc *desc = &params->descriptors[i];
+        cap_str(gpu, desc->name);
+        cap_u32(gpu, desc->type);
+        cap_u32(gpu, desc->binding);
+        cap_u32(gpu, desc->access);
+    }
+    cap_u32(gpu, params->num_constants);
+    for (int i = 0; i < params->num_constants; i++) {
+        const struct pl_constant *c = &params->constants[i];
+        cap_u32(gpu, c->type);
+        cap_u32(gpu, c->id);
+        cap_u64(gpu, c->offset);
+    }
+    cap_blob(gpu, params->constant_data, constant_data_size(params));
+    cap_u64(gpu, params->push_constants_size);
+    cap_str(gpu, params->glsl_shader);
+    cap_u32(gpu, params->vertex_type);
+    cap_u32(gpu, params->num_vertex_attribs);
+    for (int i = 0; i < params->num_vertex_attribs; i++) {
+        const struct pl_vertex_attrib *va = &params->vertex_attribs[i];
+        cap_str(gpu, va->name);
+        cap_str(gpu, va->fmt->name);
+        cap_u64(gpu, va->offset);
+        cap_u32(gpu, va->location);
+    }
+    cap_u64(gpu, params->vertex_stride);
+    cap_str(gpu, params->vertex_shader);
+    cap_str(gpu, params->target_format ? params->target_format->name : NULL);
+    cap_u32(gpu, !!params->blend_params);
+    if (params->blend_params) {
+        cap_u32(gpu, params->blend_params->src_rgb);
+        cap_u32(gpu, params->blend_params->dst_rgb);
+        cap_u32(gpu, params->blend_params->src_alpha);
+        cap_u32(gpu, params->blend_params->dst_alpha);
+    }
+    cap_u32(gpu, params->load_target);
+    cap_end(gpu);
+
+    return pass;
+}
+
+static void dumb_pass_destroy(pl_gpu gpu, pl_pass pass)
+{
+    const struct pass_priv *p = PL_PRIV(pass);
+    if (cap_begin(gpu, CAP_PASS_DESTROY)) {
+        cap_u32(gpu, p->id);
+        cap_end(gpu);
+    }
+
+    pl_free((void *) pass);
+}
+
+static void dumb_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
+{
+    if (!cap_begin(gpu, CAP_PASS_RUN))
+        return;
+
+    pl_pass pass = params->pass;
+    const struct pass_priv *p = PL_PRIV(pass);
+    cap_u32(gpu, p->id);
+    cap_blob(gpu, params->constant_data, constant_data_size(&pass->params));
+    cap_u32(gpu, params->num_var_updates);
+    for (int i = 0; i < params->num_var_updates; i++) {
+        const struct pl_var_update *vu = &params->var_updates[i];
+        const struct pl_var *var = &pass->params.variables[vu->index];
+        cap_u32(gpu, vu->index);
+        cap_blob(gpu, vu->data, pl_var_host_layout(0, var).size);
+    }
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        const struct pl_desc_binding *db = &params->desc_bindings[i];
+        cap_u32(gpu, desc_obj_id(pass->params.descriptors[i].type, db->object));
+        cap_u32(gpu, db->address_mode);
+        cap_u32(gpu, db->sample_mode);
+    }
+    cap_blob(gpu, params->push_constants, pass->params.push_constants_size);
+
+    if (pass->params.type == PL_PASS_RASTER) {
+        const struct tex_priv *target = PL_PRIV(params->target);
+        const struct buf_priv *vbuf = params->vertex_buf ? PL_PRIV(params->vertex_buf) : NULL;
+        const struct buf_priv *ibuf = params->index_buf ? PL_PRIV(params->index_buf) : NULL;
+        cap_u32(gpu, target->id);
+        cap_rect2d(gpu, params->viewport);
+        cap_rect2d(gpu, params->scissors);
+        cap_u32(gpu, params->vertex_count);
+        cap_blob(gpu, params->vertex_data, pl_vertex_buf_size(params));
+        cap_u32(gpu, vbuf ? vbuf->id : 0);
+        cap_u64(gpu, params->buf_offset);
+        cap_u32(gpu, params->index_fmt);
+        cap_blob(gpu, params->index_data, params->index_data ? pl_index_buf_size(params) : 0);
+        cap_u32(gpu, ibuf ? ibuf->id : 0);
+        cap_u64(gpu, params->index_offset);
+    } else {
+        for (int i = 0; i < 3; i++)
+            cap_u32(gpu, params->compute_groups[i]);
+    }
+
+    cap_end(gpu);
+}
+
+static void dumb_gpu_flush(pl_gpu gpu)
+{
+    if (cap_begin(gpu, CAP_FLUSH))
+        cap_end(gpu);
 }
 
 static void dumb_gpu_finish(pl_gpu gpu)
 {
-    // no-op
+    if (cap_begin(gpu, CAP_FINISH))
+        cap_end(gpu);
+}
+
+struct replay {
+    pl_gpu gpu;
+    void *alloc;
+    void *tmp; // freed after every record
+    const uint8_t *pos, *end;
+    bool error;
+    bool last_loop;
+
+    // Indexed by object ID
+    PL_ARRAY(struct replay_obj {
+        enum cap_op type; // creation opcode
+        const void *obj;
+    }) objs;
+};
+
+static const void *rd_raw(struct replay *r, size_t size)
+{
+    if (r->error || size > r->end - r->pos) {
+        r->error = true;
+        return NULL;
+    }
+
+    const void *ptr = r->pos;
+    r->pos += size;
+    return ptr;
+}
+
+static uint32_t rd_u32(struct replay *r)
+{
+    uint32_t val = 0;
+    const void *ptr = rd_raw(r, sizeof(val));
+    if (ptr)
+        memcpy(&val, ptr, sizeof(val));
+    return val;
+}
+
+static uint64_t rd_u64(struct replay *r)
+{
+    uint64_t val = 0;
+    const void *ptr = rd_raw(r, sizeof(val));
+    if (ptr)
+        memcpy(&val, ptr, sizeof(val));
+    return val;
+}
+
+// Returns NULL for empty blobs
+static const void *rd_blob(struct replay *r, size_t *size)
+{
+    uint64_t len = rd_u64(r);
+    const void *ptr = rd_raw(r, len);
+    if (size)
+        *size = ptr ? len : 0;
+    return len ? ptr : NULL;
+}
+
+// Like rd_blob, but copies the data into suitably aligned memory, for
+// blobs that get accessed as typed values (e.g. specialization constants)
+static void *rd_blob_aligned(struct replay *r)
+{
+    size_t size;
+    const void *ptr = rd_blob(r, &size);
+    return ptr ? pl_memdup(r->tmp, ptr, size) : NULL;
+}
+
+static const char *rd_str(struct replay *r)
+{
+    size_t len;
+    const char *str = rd_blob(r, &len);
+    return str ? pl_strndup0(r->tmp, str, len) : NULL;
+}
+
+static pl_rect2d rd_rect2d(struct replay *r)
+{
+    pl_rect2d rc;
+    rc.x0 = (int32_t) rd_u32(r);
+    rc.y0 = (int32_t) rd_u32(r);
+    rc.x1 = (int32_t) rd_u32(r);
+    rc.y1 = (int32_t) rd_u32(r);
+    return rc;
+}
+
+static pl_rect3d rd_rect3d(struct replay *r)
+{
+    pl_rect3d rc;
+    rc.x0 = (int32_t) rd_u32(r);
+    rc.y0 = (int32_t) rd_u32(r);
+    rc.z0 = (int32_t) rd_u32(r);
+    rc.x1 = (int32_t) rd_u32(r);
+    rc.y1 = (int32_t) rd_u32(r);
+    rc.z1 = (int32_t) rd_u32(r);
+    return rc;
+}
+
+static pl_fmt rd_fmt(struct replay *r)
+{
+    const char *name = rd_str(r);
+    if (!name)
+        return NULL;
+
+    pl_fmt fmt = pl_find_named_fmt(r->gpu, name);
+    if (!fmt) {
+        PL_ERR(r->gpu, "Replay: format '%s' not available on this GPU!", name);
+        r->error = true;
+    }
+    return fmt;
+}
+
+static const void *rd_obj(struct replay *r, enum cap_op type)
+{
+    uint32_t id = rd_u32(r);
+    if (!id || r->error)
+        return NULL;
+    if (id >= r->objs.num || !r->objs.elem[id].obj || r->objs.elem[id].type != type) {
+        PL_ERR(r->gpu, "Replay: reference to invalid object %u!", (unsigned) id);
+        r->error = true;
+        return NULL;
+    }
+    return r->objs.elem[id].obj;
+}
+
+// Reads a new object ID. Returns false if the object already exists from a
+// previous iteration, in which case the creation should be skipped.
+static bool rd_new_id(struct replay *r, uint32_t *id)
+{
+    *id = rd_u32(r);
+    if (!*id || r->error) {
+        r->error = true;
+        return false;
+    }
+
+    while (r->objs.num <= *id)
+        PL_ARRAY_APPEND(r->alloc, r->objs, (struct replay_obj) {0});
+    return !r->objs.elem[*id].obj;
+}
+
+static void set_obj(struct replay *r, uint32_t id, enum cap_op type, const void *obj)
+{
+    r->objs.elem[id] = (struct replay_obj) { .type = type, .obj = obj };
+    r->error |= !obj;
+}
+
+static void replay_tex_create(struct replay *r)
+{
+    uint32_t id;
+    bool create = rd_new_id(r, &id);
+    struct pl_tex_params params = {
+        .w = rd_u32(r),
+        .h = rd_u32(r),
+        .d = rd_u32(r),
+        .format = rd_fmt(r),
+        .debug_tag = PL_DEBUG_TAG,
+    };
+    uint32_t flags = rd_u32(r);
+    params.initial_data = rd_blob(r, NULL);
+    if (r->error || !create)
+        return;
+
+    params.sampleable    = flags & CAP_SAMPLEABLE;
+    params.renderable    = flags & CAP_RENDERABLE;
+    params.storable      = flags & CAP_STORABLE;
+    params.blit_src      = flags & CAP_BLIT_SRC;
+    params.blit_dst      = flags & CAP_BLIT_DST;
+    params.host_writable = flags & CAP_HOST_WRITABLE;
+    params.host_readable = flags & CAP_HOST_READABLE;
+    if (flags & CAP_PLACEHOLDER) {
+        // Placeholders have undefined contents, but must be backed by
+        // something real to be sampled from
+        params.sampleable = true;
+    }
+
+    set_obj(r, id, CAP_TEX_CREATE, pl_tex_create(r->gpu, &params));
+}
+
+static void replay_buf_create(struct replay *r)
+{
+    uint32_t id;
+    bool create = rd_new_id(r, &id);
+    struct pl_buf_params params = {
+        .size = rd_u64(r),
+        .memory_type = rd_u32(r),
+        .format = rd_fmt(r),
+        .debug_tag = PL_DEBUG_TAG,
+    };
+    uint32_t flags = rd_u32(r);
+    params.initial_data = rd_blob(r, NULL);
+    if (r->error || !create)
+        return;
+
+    params.host_writable = flags & CAP_HOST_WRITABLE;
+    params.host_readable = flags & CAP_HOST_READABLE;
+    params.uniform       = flags & CAP_UNIFORM;
+    params.storable      = flags & CAP_STORABLE;
+    params.drawable      = flags & CAP_DRAWABLE;
+    set_obj(r, id, CAP_BUF_CREATE, pl_buf_create(r->gpu, &params));
+}
+
+static void destroy_obj(pl_gpu gpu, struct replay_obj *obj)
+{
+    switch (obj->type) {
+    case CAP_TEX_CREATE:  pl_tex_destroy(gpu, (pl_tex *) &obj->obj); break;
+    case CAP_BUF_CREATE:  pl_buf_destroy(gpu, (pl_buf *) &obj->obj); break;
+    case CAP_PASS_CREATE: pl_pass_destroy(gpu, (pl_pass *) &obj->obj); break;
+    default: pl_unreachable();
+    }
+}
+
+static void replay_destroy(struct replay *r, enum cap_op type)
+{
+    uint32_t id = rd_u32(r);
+    if (r->error || !r->last_loop)
+        return; // objects are kept alive until the last iteration
+    if (id >= r->objs.num || r->objs.elem[id].type != type || !r->objs.elem[id].obj) {
+        r->error = true;
+        return;
+    }
+
+    destroy_obj(r->gpu, &r->objs.elem[id]);
+}
+
+static void replay_tex_transfer(struct replay *r, enum cap_op op)
+{
+    struct pl_tex_transfer_params params = {
+        .tex = rd_obj(r, CAP_TEX_CREATE),
+        .rc = rd_rect3d(r),
+        .row_pitch = rd_u64(r),
+        .depth_pitch = rd_u64(r),
+        .buf = rd_obj(r, CAP_BUF_CREATE),
+        .buf_offset = rd_u64(r),
+    };
+
+    if (op == CAP_TEX_UPLOAD && !params.buf)
+        params.ptr = (void *) rd_blob(r, NULL);
+    if (r->error || !params.tex)
+        return;
+
+    if (op == CAP_TEX_UPLOAD) {
+        r->error |= !pl_tex_upload(r->gpu, &params);
+    } else {
+        if (!params.buf)
+            params.ptr = pl_alloc(r->tmp, pl_tex_transfer_size(&params));
+        r->error |= !pl_tex_download(r->gpu, &params);
+    }
+}
+
+static void replay_tex_clear(struct replay *r)
+{
+    pl_tex tex = rd_obj(r, CAP_TEX_CREATE);
+    union pl_clear_color color;
+    for (int i = 0; i < 4; i++)
+        color.u[i] = rd_u32(r);
+    if (!r->error && tex)
+        pl_tex_clear_ex(r->gpu, tex, color);
+}
+
+static void replay_tex_blit(struct replay *r)
+{
+    struct pl_tex_blit_params params = {
+        .src = rd_obj(r, CAP_TEX_CREATE),
+        .dst = rd_obj(r, CAP_TEX_CREATE),
+        .src_rc = rd_rect3d(r),
+        .dst_rc = rd_rect3d(r),
+        .sample_mode = rd_u32(r),
+    };
+
+    if (!r->error && params.src && params.dst)
+        pl_tex_blit(r->gpu, &params);
+}
+
+static void replay_buf_op(struct replay *r, enum cap_op op)
+{
+    pl_buf buf = rd_obj(r, CAP_BUF_CREATE);
+    size_t offset = rd_u64(r), size;
+    switch (op) {
+    case CAP_BUF_WRITE: {
+        const void *data = rd_blob(r, &size);
+        if (!r->error && buf && data)
+            pl_buf_write(r->gpu, buf, offset, data, size);
+        return;
+    }
+    case CAP_BUF_READ:
+        size = rd_u64(r);
+        if (!r->error && buf)
+            r->error |= !pl_buf_read(r->gpu, buf, offset, pl_alloc(r->tmp, size), size);
+        return;
+    case CAP_BUF_COPY: {
+        pl_buf src = rd_obj(r, CAP_BUF_CREATE);
+        size_t src_offset = rd_u64(r);
+        size = rd_u64(r);
+        if (!r->error && buf && src)
+            pl_buf_copy(r->gpu, buf, offset, src, src_offset, size);
+        return;
+    }
+    default: pl_unreachable();
+    }
+}
+
+static void replay_pass_create(struct replay *r)
+{
+    uint32_t id;
+    bool create = rd_new_id(r, &id);
+    struct pl_pass_params params = {
+        .type = rd_u32(r),
+        .num_variables = rd_u32(r),
+    };
+
+    if (r->error || params.num_variables > r->end - r->pos)
+        goto error;
+    params.variables = pl_calloc_ptr(r->tmp, params.num_variables, params.variables);
+    for (int i = 0; i < params.num_variables; i++) {
+        struct pl_var *var = &params.variables[i];
+        var->name  = rd_str(r);
+        var->type  = rd_u32(r);
+        var->dim_v = rd_u32(r);
+        var->dim_m = rd_u32(r);
+        var->dim_a = rd_u32(r);
+    }
+
+    params.num_descriptors = rd_u32(r);
+    if (r->error || params.num_descriptors > r->end - r->pos)
+        goto error;
+    params.descriptors = pl_calloc_ptr(r->tmp, params.num_descriptors, params.descriptors);
+    for (int i = 0; i < params.num_descriptors; i++) {
+        struct pl_desc *desc = &params.descriptors[i];
+        desc->name    = rd_str(r);
+        desc->type    = rd_u32(r);
+        desc->binding = rd_u32(r);
+        desc->access  = rd_u32(r);
+    }
+
+    params.num_constants = rd_u32(r);
+    if (r->error || params.num_constants > r->end - r->pos)
+        goto error;
+    params.constants = pl_calloc_ptr(r->tmp, params.num_constants, params.constants);
+    for (int i = 0; i < params.num_constants; i++) {
+        struct pl_constant *c = &params.constants[i];
+        c->type   = rd_u32(r);
+        c->id     = rd_u32(r);
+        c->offset = rd_u64(r);
+    }
+
+    params.constant_data = rd_blob_aligned(r);
+    params.push_constants_size = rd_u64(r);
+    params.glsl_shader = rd_str(r);
+    params.vertex_type = rd_u32(r);
+    params.num_vertex_attribs = rd_u32(r);
+    if (r->error || params.num_vertex_attribs > r->end - r->pos)
+        goto error;
+    params.vertex_attribs = pl_calloc_ptr(r->tmp, params.num_vertex_attribs,
+                                          params.vertex_attribs);
+    for (int i = 0; i < params.num_vertex_attribs; i++) {
+        struct pl_vertex_attrib *va = &params.vertex_attribs[i];
+        va->name     = rd_str(r);
+        va->fmt      = rd_fmt(r);
+        va->offset   = rd_u64(r);
+        va->location = rd_u32(r);
+    }
+
+    params.vertex_stride = rd_u64(r);
+    params.vertex_shader = rd_str(r);
+    params.target_format = rd_fmt(r);
+    struct pl_blend_params blend;
+    if (rd_u32(r)) {
+        blend.src_rgb   = rd_u32(r);
+        blend.dst_rgb   = rd_u32(r);
+        blend.src_alpha = rd_u32(r);
+        blend.dst_alpha = rd_u32(r);
+        params.blend_params = &blend;
+    }
+    params.load_target = rd_u32(r);
+    if (r->error || !create)
+        return;
+
+    set_obj(r, id, CAP_PASS_CREATE, pl_pass_create(r->gpu, &params));
+    return;
+
+error:
+    r->error = true;
+}
+
+static void replay_pass_run(struct replay *r)
+{
+    pl_pass pass = rd_obj(r, CAP_PASS_CREATE);
+    if (r->error || !pass) {
+        r->error = true;
+        return;
+    }
+
+    struct pl_pass_run_params params = {
+        .pass = pass,
+        .constant_data = rd_blob_aligned(r),
+        .num_var_updates = rd_u32(r),
+    };
+
+    if (r->error || params.num_var_updates > pass->params.num_variables) {
+        r->error = true;
+        return;
+    }
+
+    params.var_updates = pl_calloc_ptr(r->tmp, params.num_var_updates, params.var_updates);
+    for (int i = 0; i < params.num_var_updates; i++) {
+        struct pl_var_update *vu = &params.var_updates[i];
+        vu->index = rd_u32(r);
+        vu->data = rd_blob_aligned(r);
+        r->error |= vu->index >= pass->params.num_variables;
+    }
+
+    params.desc_bindings = pl_calloc_ptr(r->tmp, pass->params.num_descriptors,
+                                         params.desc_bindings);
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        struct pl_desc_binding *db = &params.desc_bindings[i];
+        switch (pass->params.descriptors[i].type) {
+        case PL_DESC_SAMPLED_TEX:
+        case PL_DESC_STORAGE_IMG:
+            db->object = rd_obj(r, CAP_TEX_CREATE);
+            break;
+        default:
+            db->object = rd_obj(r, CAP_BUF_CREATE);
+            break;
+        }
+        db->address_mode = rd_u32(r);
+        db->sample_mode  = rd_u32(r);
+    }
+
+    params.push_constants = rd_blob_aligned(r);
+    if (pass->params.type == PL_PASS_RASTER) {
+        params.target = rd_obj(r, CAP_TEX_CREATE);
+        params.viewport = rd_rect2d(r);
+        params.scissors = rd_rect2d(r);
+        params.vertex_count = rd_u32(r);
+        params.vertex_data = rd_blob(r, NULL);
+        params.vertex_buf = rd_obj(r, CAP_BUF_CREATE);
+        params.buf_offset = rd_u64(r);
+        params.index_fmt = rd_u32(r);
+        params.index_data = rd_blob(r, NULL);
+        params.index_buf = rd_obj(r, CAP_BUF_CREATE);
+        params.index_offset = rd_u64(r);
+    } else {
+        for (int i = 0; i < 3; i++)
+            params.compute_groups[i] = rd_u32(r);
+    }
+
+    if (!r->error)
+        pl_pass_run(r->gpu, &params);
+}
+
+bool pl_gpu_dummy_replay(pl_gpu gpu, const void *data, size_t size, int loops)
+{
+    struct replay r = {
+        .gpu = gpu,
+        .alloc = pl_tmp(NULL),
+    };
+    r.tmp = pl_tmp(r.alloc);
+
+    uint32_t header[2] = {0};
+    if (size >= sizeof(header))
+        memcpy(header, data, sizeof(header));
+    if (header[0] != CAP_MAGIC) {
+        PL_ERR(gpu, "Replay: not a libplacebo capture stream!");
+        r.error = true;
+    } else if (header[1] != CAP_VERSION) {
+        PL_ERR(gpu, "Replay: unsupported capture version %u!", (unsigned) header[1]);
+        r.error = true;
+    }
+
+    loops = PL_MAX(loops, 1);
+    for (int loop = 0; loop < loops && !r.error; loop++) {
+        r.pos = (const uint8_t *) data + sizeof(header);
+        r.end = (const uint8_t *) data + size;
+        r.last_loop = loop + 1 == loops;
+
+        while (r.pos < r.end && !r.error) {
+            enum cap_op op = rd_u32(&r);
+            switch (op) {
+            case CAP_TEX_CREATE:    replay_tex_create(&r); break;
+            case CAP_TEX_DESTROY:   replay_destroy(&r, CAP_TEX_CREATE); break;
+            case CAP_BUF_CREATE:    replay_buf_create(&r); break;
+            case CAP_BUF_DESTROY:   replay_destroy(&r, CAP_BUF_CREATE); break;
+            case CAP_PASS_CREATE:   replay_pass_create(&r); break;
+            case CAP_PASS_DESTROY:  replay_destroy(&r, CAP_PASS_CREATE); break;
+            case CAP_TEX_UPLOAD:
+            case CAP_TEX_DOWNLOAD:  replay_tex_transfer(&r, op); break;
+            case CAP_TEX_CLEAR:     replay_tex_clear(&r); break;
+            case CAP_TEX_BLIT:      replay_tex_blit(&r); break;
+            case CAP_BUF_WRITE:
+            case CAP_BUF_READ:
+            case CAP_BUF_COPY:      replay_buf_op(&r, op); break;
+            case CAP_PASS_RUN:      replay_pass_run(&r); break;
+            case CAP_FLUSH:         pl_gpu_flush(gpu); break;
+            case CAP_FINISH:        pl_gpu_finish(gpu); break;
+            default:
+                PL_ERR(gpu, "Replay: unknown opcode %u!", (unsigned) op);
+                r.error = true;
+                break;
+            }
+
+            pl_free_children(r.tmp);
+        }
+
+        if (r.error) {
+            PL_ERR(gpu, "Replay: failed at offset %zu!",
+                   (size_t) (r.pos - (const uint8_t *) data));
+        }
+    }
+
+    // Destroy in reverse order of creation, so that passes are destroyed
+    // before the objects they were last used with
+    for (int id = r.objs.num - 1; id >= 0; id--) {
+        if (r.objs.elem[id].obj)
+            destroy_obj(gpu, &r.objs.elem[id]);
+    }
+
+    pl_free(r.alloc);
+    return !r.error;
 }
 
 static const struct pl_gpu_fns pl_fns_dummy = {
@@ -340,9 +1543,14 @@ static const struct pl_gpu_fns pl_fns_dummy = {
     .buf_copy = dumb_buf_copy,
     .tex_create = dumb_tex_create,
     .tex_destroy = dumb_tex_destroy,
+    .tex_clear_ex = dumb_tex_clear_ex,
+    .tex_blit = dumb_tex_blit,
     .tex_upload = dumb_tex_upload,
     .tex_download = dumb_tex_download,
     .desc_namespace = dumb_desc_namespace,
     .pass_create = dumb_pass_create,
+    .pass_destroy = dumb_pass_destroy,
+    .pass_run = dumb_pass_run,
+    .gpu_flush = dumb_gpu_flush,
     .gpu_finish = dumb_gpu_finish,
 };
@@ -37,8 +37,10 @@
 #include <math.h>
 
 #include "common.h"
+#include "cache.h"
 #include "filters.h"
 #include "log.h"
+#include "pl_thread.h"
 
 #ifdef PL_HAVE_WIN32
 #define j1 _j1
@@ -179,30 +181,154 @@ static struct pl_filter_function *dupfilter(void *alloc,
     return f ? pl_memdup(alloc, (void *)f, sizeof(*f)) : NULL;
 }
 
-pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
+// Returns the name of the built-in filter function with the same weight
+// function, or NULL for custom filter functions
+static const char *builtin_name(const struct pl_filter_function *f)
+{
+    for (int i = 0; i < pl_num_filter_functions; i++) {
+        if (pl_filter_function_eq(f, pl_filter_functions[i]))
+            return pl_filter_functions[i]->name;
+    }
+
+    return NULL;
+}
+
+static uint64_t hash_function(const struct pl_filter_function *f,
+                              const float params[PL_FILTER_MAX_PARAMS])
+{
+    if (!f)
+        return 0;
+
+    const char *name = builtin_name(f);
+    if (!name)
+        return 0;
+
+    float vals[1 + PL_FILTER_MAX_PARAMS] = { f->radius };
+    for (int i = 0; i < PL_FILTER_MAX_PARAMS; i++)
+        vals[1 + i] = f->tunable[i] ? params[i] : f->params[i];
+
+    uint64_t hash = pl_str0_hash(name);
+    pl_hash_merge(&hash, pl_mem_hash(vals, sizeof(vals)));
+    return hash;
+}
+
+// Returns a key uniquely identifying the filter's weights across processes,
+// or 0 if the filter uses custom (non-built-in) filter functions
+static uint64_t filter_cache_key(const struct pl_filter_params *params)
+{
+    const struct pl_filter_config *c = &params->config;
+    uint64_t kernel = hash_function(c->kernel, c->params);
+    uint64_t window = hash_function(c->window, c->wparams);
+    if (!kernel || (c->window && !window))
+        return 0;
+
+    const float vals[] = { c->radius, c->clamp, c->blur, c->taper, params->cutoff };
+    const int ints[] = {
+        c->polar, params->lut_entries, params->max_row_size,
+        params->row_stride_align,
+    };
+
+    uint64_t key = CACHE_KEY_FILTER;
+    pl_hash_merge(&key, kernel);
+    pl_hash_merge(&key, window);
+    pl_hash_merge(&key, pl_mem_hash(vals, sizeof(vals)));
+    pl_hash_merge(&key, pl_mem_hash(ints, sizeof(ints)));
+    return key;
+}
+
+// Header of the serialized filter, followed by the weights
+struct cached_filter {
+    float radius;
+    float radius_zero;
+    int32_t row_size;
+    int32_t row_stride;
+    int32_t insufficient;
+};
+
+static size_t num_weights(const struct pl_filter_t *f)
+{
+    const struct pl_filter_params *params = &f->params;
+    return params->config.polar ? params->lut_entries
+                                : params->lut_entries * f->row_stride;
+}
+
+static bool load_filter(void *alloc, struct pl_filter_t *f, pl_cache cache,
+                        uint64_t key)
+{
+    pl_cache_obj obj = { .key = key };
+    if (!pl_cache_get(cache, &obj))
+        return false;
+
+    bool ok = false;
+    struct cached_filter hdr;
+    if (obj.size < sizeof(hdr))
+        goto done;
+
+    memcpy(&hdr, obj.data, sizeof(hdr));
+    f->radius       = hdr.radius;
+    f->radius_zero  = hdr.radius_zero;
+    f->row_size     = hdr.row_size;
+    f->row_stride   = hdr.row_stride;
+    f->insufficient = hdr.insufficient;
+    if (f->row_stride < 0 || obj.size != sizeof(hdr) + num_weights(f) * sizeof(float))
+        goto done;
+
+    f->weights = pl_memdup(alloc, (uint8_t *) obj.data + sizeof(hdr),
+                           obj.size - sizeof(hdr));
+    ok = true;
+
+done:
+    pl_cache_set(cache, &obj);
+    return ok;
+}
+
+static void save_filter(const struct pl_filter_t *f, pl_cache cache, uint64_t key)
+{
+    const size_t weights_size = num_weights(f) * sizeof(float);
+    pl_cache_obj obj = { .key = key };
+    pl_cache_obj_resize(NULL, &obj, sizeof(struct cached_filter) + weights_size);
+    memcpy(obj.data, &(struct cached_filter) {
+        .radius         = f->radius,
+        .radius_zero    = f->radius_zero,
+        .row_size       = f->row_size,
+        .row_stride     = f->row_stride,
+        .insufficient   = f->insufficient,
+    }, sizeof(struct cached_filter));
+    memcpy((uint8_t *) obj.data + sizeof(struct cached_filter), f->weights,
+           weights_size);
+    pl_cache_set(cache, &obj);
+}
+
+static bool generate_filter(void *alloc, struct pl_filter_t *f, pl_log log,
+                            const struct pl_filter_params *params, pl_cache cache)
 {
     pl_assert(params);
     if (params->lut_entries <= 0 || !params->config.kernel) {
         pl_fatal(log, "Invalid params: missing lut_entries or config.kernel");
-        return NULL;
+        return false;
     }
 
     if (params->config.kernel->opaque) {
         pl_err(log, "Trying to use opaque kernel '%s' in non-opaque context!",
                params->config.kernel->name);
-        return NULL;
+        return false;
     }
 
     if (params->config.window && params->config.window->opaque) {
         pl_err(log, "Trying to use opaque window '%s' in non-opaque context!",
                params->config.window->name);
-        return NULL;
+        return false;
     }
 
-    struct pl_filter_t *f = pl_zalloc_ptr(NULL, f);
     f->params = *params;
-    f->params.config.kernel = dupfilter(f, params->config.kernel);
-    f->params.config.window = dupfilter(f, params->config.window);
+    f->params.config.kernel = dupfilter(alloc, params->config.kernel);
+    f->params.config.window = dupfilter(alloc, params->config.window);
+
+    const uint64_t key = cache ? filter_cache_key(params) : 0;
+    if (key && load_filter(alloc, f, cache, key)) {
+        f->radius_cutoff = f->radius; // backwards compatibility
+        return true;
+    }
 
     // Compute main lobe and total filter size
     filter_cutoffs(&params->config, params->cutoff, &f->radius, &f->radius_zero);
@@ -211,7 +337,7 @@ pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
     float *weights;
     if (params->config.polar) {
         // Compute a 1D array indexed by radius
-        weights = pl_alloc(f, params->lut_entries * sizeof(float));
+        weights = pl_alloc(alloc, params->lut_entries * sizeof(float));
         for (int i = 0; i < params->lut_entries; i++) {
             double x = f->radius * i / (params->lut_entries - 1);
             weights[i] = pl_filter_sample(&params->config, x);
@@ -229,7 +355,7 @@ pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
         f->row_stride = PL_ALIGN(f->row_size, params->row_stride_align);
 
         // Compute a 2D array indexed by the subpixel position
-        weights = pl_calloc(f, params->lut_entries * f->row_stride, sizeof(float));
+        weights = pl_calloc(alloc, params->lut_entries * f->row_stride, sizeof(float));
         for (int i = 0; i < params->lut_entries; i++) {
             compute_row(f, i / (double)(params->lut_entries - 1),
                         weights + f->row_stride * i);
@@ -237,6 +363,19 @@ pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
     }
 
     f->weights = weights;
+    if (key)
+        save_filter(f, cache, key);
+    return true;
+}
+
+pl_filter pl_filter_generate(pl_log log, const struct pl_filter_params *params)
+{
+    struct pl_filter_t *f = pl_zalloc_ptr(NULL, f);
+    if (!generate_filter(f, f, log, params, NULL)) {
+        pl_free(f);
+        return NULL;
+    }
+
     return f;
 }
 
@@ -245,6 +384,81 @@ void pl_filter_free(pl_filter *filter)
     pl_free_ptr((void **) filter);
 }
 
+// Process-wide list of filters shared by `pl_filter_acquire`
+struct shared_filter {
+    struct pl_filter_t filter; // must be first
+    int refcount;
+};
+
+static pl_static_mutex shared_filters_lock = PL_STATIC_MUTEX_INITIALIZER;
+static PL_ARRAY(struct shared_filter *) shared_filters;
+
+static bool filter_params_eq(const struct pl_filter_params *a,
+                             const struct pl_filter_params *b)
+{
+    return pl_filter_config_eq(&a->config, &b->config) &&
+           a->lut_entries == b->lut_entries &&
+           a->cutoff == b->cutoff &&
+           a->max_row_size == b->max_row_size &&
+           a->row_stride_align == b->row_stride_align;
+}
+
+pl_filter pl_filter_acquire(pl_log log, const struct pl_filter_params *params,
+                            pl_cache cache)
+{
+    pl_static_mutex_lock(&shared_filters_lock);
+
+    struct shared_filter *sf = NULL;
+    for (int i = 0; i < shared_filters.num; i++) {
+        if (filter_params_eq(&shared_filters.elem[i]->filter.params, params)) {
+            sf = shared_filters.elem[i];
+            sf->refcount++;
+            goto done;
+        }
+    }
+
+    sf = pl_zalloc_ptr(NULL, sf);
+    pl_clock_t start = pl_clock_now();
+    if (!generate_filter(sf, &sf->filter, log, params, cache)) {
+        pl_free_ptr(&sf);
+        goto done;
+    }
+
+    pl_log_cpu_time(log, start, pl_clock_now(), "generating filter weights");
+    sf->refcount = 1;
+    PL_ARRAY_APPEND(NULL, shared_filters, sf);
+
+done:
+    pl_static_mutex_unlock(&shared_filters_lock);
+    return sf ? &sf->filter : NULL;
+}
+
+void pl_filter_release(pl_filter *filter)
+{
+    struct shared_filter *sf = (struct shared_filter *) *filter;
+    if (!sf)
+        return;
+
+    pl_static_mutex_lock(&shared_filters_lock);
+    if (--sf->refcount == 0) {
+        for (int i = 0; i < shared_filters.num; i++) {
+            if (shared_filters.elem[i] == sf) {
+                PL_ARRAY_REMOVE_AT(shared_filters, i);
+                break;
+            }
+        }
+
+        pl_free(sf);
+        if (!shared_filters.num) {
+            pl_free(shared_filters.elem);
+            shared_filters.elem = NULL;
+        }
+    }
+    pl_static_mutex_unlock(&shared_filters_lock);
+
+    *filter = NULL;
+}
+
 // Built-in filter functions
 
 static double box(const struct pl_filter_ctx *f, double x)
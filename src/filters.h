@@ -17,8 +17,17 @@
 
 #pragma once
 
+#include <libplacebo/cache.h>
 #include <libplacebo/filters.h>
 
+// Like `pl_filter_generate`, but returns a filter shared with all other users
+// of identical parameters in the process, and persists the computed weights in
+// `cache` (if provided). Thread-safe. Must be released with
+// `pl_filter_release` instead of `pl_filter_free`.
+pl_filter pl_filter_acquire(pl_log log, const struct pl_filter_params *params,
+                            pl_cache cache);
+void pl_filter_release(pl_filter *filter);
+
 static inline float pl_filter_radius_bound(const struct pl_filter_config *c)
 {
     const float r = c->radius && c->kernel->resizable ? c->radius : c->kernel->radius;
@@ -19,6 +19,13 @@
 
 #include "common.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define HAVE_TOKEN_SIMD 1
+#else
+#define HAVE_TOKEN_SIMD 0
+#endif
+
 void pl_str_append_asprintf_c(void *alloc, pl_str *str, const char *fmt, ...)
 {
     va_list ap;
@@ -209,6 +216,50 @@ bool pl_str_parse_double(pl_str str, double *out)
     return ccSeqParseDouble((char *) str.buf, str.len, out);
 }
 
+// Length of the token at the start of `str`, up to the first char that
+// ccSeqParse* would also treat as a delimiter
+static inline size_t token_len(pl_str str)
+{
+    size_t len = 0;
+#if HAVE_TOKEN_SIMD
+    const __m128i min = _mm_set1_epi8(' ' + 1);
+    while (len + 16 <= str.len) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (str.buf + len));
+        int delim = ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_max_epu8(v, min), v));
+        if (delim & 0xFFFF)
+            return len + __builtin_ctz(delim);
+        len += 16;
+    }
+#endif
+    while (len < str.len && str.buf[len] > ' ')
+        len++;
+    return len;
+}
+
+size_t pl_str_parse_floats(pl_str *str, float *out, size_t num)
+{
+    pl_str s = *str;
+    size_t n = 0;
+    while (n < num) {
+        while (s.len && pl_isspace(s.buf[0])) {
+            s.buf++;
+            s.len--;
+        }
+
+        size_t len = token_len(s);
+        double dbl;
+        if (!len || !ccSeqParseDouble((char *) s.buf, len, &dbl))
+            break;
+
+        out[n++] = (float) dbl;
+        s.buf += len;
+        s.len -= len;
+    }
+
+    *str = s;
+    return n;
+}
+
 bool pl_str_parse_int64(pl_str str, int64_t *out)
 {
     return ccSeqParseInt64((char *) str.buf, str.len, out);
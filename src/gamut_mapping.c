@@ -18,9 +18,8 @@
 #include <math.h>
 
 #include "common.h"
-#include "pl_thread.h"
-
-#include <libplacebo/gamut_mapping.h>
+#include "gamut_mapping.h"
+#include "pl_thread_pool.h"
 
 #define fclampf(x, lo, hi) fminf(fmaxf(x, lo), hi)
 static void fix_constants(struct pl_gamut_map_constants *c)
@@ -105,14 +104,32 @@ static inline struct IPT ich2ipt(struct ICh c)
     };
 }
 
+// Precomputed hue direction, for converting many colors sharing the same hue
+struct hue {
+    float cos, sin;
+};
+
+static inline struct hue get_hue(float h)
+{
+    return (struct hue) { cosf(h), sinf(h) };
+}
+
+static inline struct IPT ich2ipt_hue(float I, float C, struct hue hue)
+{
+    return (struct IPT) {
+        .I = I,
+        .P = C * hue.cos,
+        .T = C * hue.sin,
+    };
+}
+
 static const float PQ_M1 = 2610./4096 * 1./4,
                    PQ_M2 = 2523./4096 * 128,
                    PQ_C1 = 3424./4096,
                    PQ_C2 = 2413./4096 * 32,
                    PQ_C3 = 2392./4096 * 32;
 
-enum { PQ_LUT_SIZE = 1024 };
-static const float pq_eotf_lut[1024+1] = {
+const float pl_pq_eotf_lut[PQ_LUT_SIZE + 1] = {
     0.0000000e+00f, 4.0422718e-09f, 1.3111372e-08f, 2.6236826e-08f, 4.3151495e-08f, 6.3746885e-08f, 8.7982383e-08f, 1.1585362e-07f,
     1.4737819e-07f, 1.8258818e-07f, 2.2152586e-07f, 2.6424098e-07f, 3.1078907e-07f, 3.6123021e-07f, 4.1562821e-07f, 4.7405001e-07f,
     5.3656521e-07f, 6.0324583e-07f, 6.7416568e-07f, 7.4940095e-07f, 8.2902897e-07f, 9.1312924e-07f, 1.0017822e-06f, 1.0950702e-06f,
@@ -249,7 +266,7 @@ static inline float pq_eotf(float x)
     float idxf  = fminf(fmaxf(x, 0.0f), 1.0f) * (PQ_LUT_SIZE - 1);
     int ipart   = floorf(idxf);
     float fpart = idxf - ipart;
-    return PL_MIX(pq_eotf_lut[ipart], pq_eotf_lut[ipart + 1], fpart);
+    return PL_MIX(pl_pq_eotf_lut[ipart], pl_pq_eotf_lut[ipart + 1], fpart);
 }
 
 static inline float pq_oetf(float x)
@@ -265,12 +282,17 @@ struct gamut {
     pl_matrix3x3 rgb2lms;
     float min_luma, max_luma;   // pq
     float min_rgb,  max_rgb;    // 10k normalized
-    struct ICh *peak_cache;     // 1-item cache for computed peaks (per hue)
+    struct ICh *peak_cache;     // cache for computed peaks, indexed by hue
 };
 
+// Hues are bucketed into slots of 1e-3 radians (the tolerance for reusing a
+// computed peak), and the buckets are then direct-mapped into the cache
+enum { PEAK_CACHE_SIZE = 256 };
+static const float peak_cache_scale = 1e3f;
+
 struct cache {
-    struct ICh src_cache;
-    struct ICh dst_cache;
+    struct ICh src_cache[PEAK_CACHE_SIZE];
+    struct ICh dst_cache[PEAK_CACHE_SIZE];
 };
 
 static void get_gamuts(struct gamut *dst, struct gamut *src, struct cache *cache,
@@ -288,14 +310,14 @@ static void get_gamuts(struct gamut *dst, struct gamut *src, struct cache *cache
     if (dst) {
         *dst = base;
         dst->lms2rgb = dst->rgb2lms = pl_ipt_rgb2lms(&params->output_gamut);
-        dst->peak_cache = &cache->dst_cache;
+        dst->peak_cache = cache->dst_cache;
         pl_matrix3x3_invert(&dst->lms2rgb);
     }
 
     if (src) {
         *src = base;
         src->lms2rgb = src->rgb2lms = pl_ipt_rgb2lms(&params->input_gamut);
-        src->peak_cache = &cache->src_cache;
+        src->peak_cache = cache->src_cache;
         pl_matrix3x3_invert(&src->lms2rgb);
     }
 }
@@ -381,24 +403,22 @@ struct generate_args {
     int count;
 };
 
-static PL_THREAD_VOID generate(void *priv)
+static void generate(void *priv, int idx)
 {
-    const struct generate_args *args = priv;
+    const struct generate_args *args = (const struct generate_args *) priv + idx;
     const struct pl_gamut_map_params *params = args->params;
 
     float *in = args->out;
     const int end = args->start + args->count;
     for (int h = args->start; h < end; h++) {
+        const float hx = (float) h / (params->lut_size_h - 1);
+        const struct hue hue = get_hue(PL_MIX(-M_PI, M_PI, hx));
         for (int C = 0; C < params->lut_size_C; C++) {
+            const float Cx = (float) C / (params->lut_size_C - 1);
             for (int I = 0; I < params->lut_size_I; I++) {
                 float Ix = (float) I / (params->lut_size_I - 1);
-                float Cx = (float) C / (params->lut_size_C - 1);
-                float hx = (float) h / (params->lut_size_h - 1);
-                struct IPT ipt = ich2ipt((struct ICh) {
-                    .I = PL_MIX(params->min_luma, params->max_luma, Ix),
-                    .C = PL_MIX(0.0f, 0.5f, Cx),
-                    .h = PL_MIX(-M_PI, M_PI, hx),
-                });
+                struct IPT ipt = ich2ipt_hue(PL_MIX(params->min_luma, params->max_luma, Ix),
+                                             PL_MIX(0.0f, 0.5f, Cx), hue);
                 in[0] = ipt.I;
                 in[1] = ipt.P;
                 in[2] = ipt.T;
@@ -411,19 +431,18 @@ static PL_THREAD_VOID generate(void *priv)
     fix_constants(&fixed.constants);
     fixed.lut_size_h = args->count;
     FUN(params).map(args->out, &fixed);
-    PL_THREAD_RETURN();
 }
 
 void pl_gamut_map_generate(float *out, const struct pl_gamut_map_params *params)
 {
-    enum { MAX_WORKERS = 32 };
-    struct generate_args args[MAX_WORKERS];
+    enum { MAX_SLICES = 32 };
+    struct generate_args args[MAX_SLICES];
 
-    const int num_per_worker = PL_DIV_UP(params->lut_size_h, MAX_WORKERS);
-    const int num_workers = PL_DIV_UP(params->lut_size_h, num_per_worker);
-    for (int i = 0; i < num_workers; i++) {
-        const int start = i * num_per_worker;
-        const int count = PL_MIN(num_per_worker, params->lut_size_h - start);
+    const int num_per_slice = PL_DIV_UP(params->lut_size_h, MAX_SLICES);
+    const int num_slices = PL_DIV_UP(params->lut_size_h, num_per_slice);
+    for (int i = 0; i < num_slices; i++) {
+        const int start = i * num_per_slice;
+        const int count = PL_MIN(num_per_slice, params->lut_size_h - start);
         args[i] = (struct generate_args) {
             .params = params,
             .out    = out,
@@ -433,18 +452,7 @@ void pl_gamut_map_generate(float *out, const struct pl_gamut_map_params *params)
         out += count * params->lut_size_C * params->lut_size_I * params->lut_stride;
     }
 
-    pl_thread workers[MAX_WORKERS] = {0};
-    for (int i = 0; i < num_workers; i++) {
-        if (pl_thread_create(&workers[i], generate, &args[i]) != 0)
-            generate(&args[i]); // fallback
-    }
-
-    for (int i = 0; i < num_workers; i++) {
-        if (!workers[i])
-            continue;
-        if (pl_thread_join(workers[i]) != 0)
-            generate(&args[i]); // fallback
-    }
+    pl_parallel_for(num_slices, generate, args);
 }
 
 void pl_gamut_map_sample(float x[3], const struct pl_gamut_map_params *params)
@@ -499,9 +507,10 @@ desat_bounded(float I, float h, float Cmin, float Cmax, struct gamut gamut)
         return (struct ICh) { .I = gamut.max_luma, .C = 0, .h = h };
 
     const float maxDI = I * maxDelta;
+    const struct hue hue = get_hue(h);
     struct ICh res = { .I = I, .C = (Cmin + Cmax) / 2, .h = h };
     do {
-        if (ingamut(ich2ipt(res), gamut)) {
+        if (ingamut(ich2ipt_hue(res.I, res.C, hue), gamut)) {
             Cmin = res.C;
         } else {
             Cmax = res.C;
@@ -515,8 +524,10 @@ desat_bounded(float I, float h, float Cmin, float Cmax, struct gamut gamut)
 // Finds maximally saturated in-gamut color (for given hue)
 static inline struct ICh saturate(float hue, struct gamut gamut)
 {
-    if (gamut.peak_cache->I && fabsf(gamut.peak_cache->h - hue) < 1e-3)
-        return *gamut.peak_cache;
+    const int bucket = floorf((hue + M_PI) * peak_cache_scale);
+    struct ICh *cached = &gamut.peak_cache[bucket & (PEAK_CACHE_SIZE - 1)];
+    if (cached->I && fabsf(cached->h - hue) < 1e-3)
+        return *cached;
 
     static const float invphi = 0.6180339887498948f;
     static const float invphi2 = 0.38196601125010515f;
@@ -545,7 +556,7 @@ static inline struct ICh saturate(float hue, struct gamut gamut)
     }
 
     struct ICh peak = a.C > b.C ? a : b;
-    *gamut.peak_cache = peak;
+    *cached = peak;
     return peak;
 }
 
@@ -563,12 +574,13 @@ clip_gamma(struct IPT ipt, float gamma, struct gamut gamut)
         return ich2ipt(desat_bounded(ich.I, ich.h, 0.0f, ich.C, gamut));
 
     const float maxDI = fmaxf(ich.I * maxDelta, 1e-7f);
+    const struct hue hue = get_hue(ich.h);
     struct ICh peak = saturate(ich.h, gamut);
     gamma = scale_gamma(gamma, ich, peak, gamut);
     float lo = 0.0f, hi = 1.0f, x = 0.5f;
     do {
         struct ICh test = mix_exp(ich, x, gamma, peak.I);
-        if (ingamut(ich2ipt(test), gamut)) {
+        if (ingamut(ich2ipt_hue(test.I, test.C, hue), gamut)) {
             lo = x;
         } else {
             hi = x;
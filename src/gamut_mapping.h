@@ -0,0 +1,27 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <libplacebo/gamut_mapping.h>
+
+// Precomputed PQ EOTF, with entry `i` holding the linear light value (relative
+// to 10,000 cd/m²) of the PQ signal value `i / (PQ_LUT_SIZE - 1)`. Contains
+// one extra entry of padding, so linear interpolation between `i` and `i + 1`
+// never reads out of bounds.
+enum { PQ_LUT_SIZE = 1024 };
+extern const float pl_pq_eotf_lut[PQ_LUT_SIZE + 1];
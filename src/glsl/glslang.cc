@@ -60,12 +60,12 @@ void pl_glslang_uninit(void)
     pl_static_mutex_unlock(&pl_glslang_mutex);
 }
 
-struct pl_glslang_res *pl_glslang_compile(struct pl_glsl_version glsl_ver,
-                                          struct pl_spirv_version spirv_ver,
-                                          enum glsl_shader_stage stage,
-                                          const char *text)
+static struct pl_glslang_res *compile_shader(struct pl_glsl_version glsl_ver,
+                                             struct pl_spirv_version spirv_ver,
+                                             enum glsl_shader_stage stage,
+                                             const char *text,
+                                             bool opt_performance)
 {
-    assert(pl_glslang_refcount);
     struct pl_glslang_res *res = pl_zalloc_ptr(NULL, res);
 
     EShLanguage lang;
@@ -107,7 +107,7 @@ struct pl_glslang_res *pl_glslang_compile(struct pl_glsl_version glsl_ver,
     SpvOptions options;
     options.disableOptimizer = false;
     options.stripDebugInfo = true;
-    options.optimizeSize = true;
+    options.optimizeSize = !opt_performance;
     options.validate = true;
     std::vector<unsigned int> spirv;
     GlslangToSpv(*prog->getIntermediate(lang), spirv, &options);
@@ -119,3 +119,22 @@ struct pl_glslang_res *pl_glslang_compile(struct pl_glsl_version glsl_ver,
     delete prog;
     return res;
 }
+
+struct pl_glslang_res *pl_glslang_compile(struct pl_glsl_version glsl_ver,
+                                          struct pl_spirv_version spirv_ver,
+                                          enum glsl_shader_stage stage,
+                                          const char *text,
+                                          bool opt_performance)
+{
+    assert(pl_glslang_refcount);
+
+    // Compilations may happen concurrently from arbitrary threads, but older
+    // versions of glslang only set up their thread-local state for the thread
+    // calling InitializeProcess(). Since that is refcounted internally, just
+    // take an extra reference for the duration of every compilation.
+    InitializeProcess();
+    struct pl_glslang_res *res = compile_shader(glsl_ver, spirv_ver, stage, text,
+                                                opt_performance);
+    FinalizeProcess();
+    return res;
+}
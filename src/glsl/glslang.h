@@ -44,11 +44,15 @@ struct pl_glslang_res {
 };
 
 // Compile GLSL into a SPIRV stream, if possible. The resulting
-// pl_glslang_res can simply be freed with pl_free() when done.
+// pl_glslang_res can simply be freed with pl_free() when done. Safe to call
+// concurrently from multiple threads. `opt_performance` selects the
+// performance passes of the SPIR-V optimizer instead of the size passes, if
+// glslang was built with SPIRV-Tools.
 struct pl_glslang_res *pl_glslang_compile(struct pl_glsl_version glsl_ver,
                                           struct pl_spirv_version spirv_ver,
                                           enum glsl_shader_stage stage,
-                                          const char *shader);
+                                          const char *shader,
+                                          bool opt_performance);
 
 extern const TBuiltInResource DefaultTBuiltInResource;
 
@@ -16,6 +16,7 @@
  */
 
 #include "spirv.h"
+#include "pl_thread_pool.h"
 
 extern const struct spirv_compiler pl_spirv_shaderc;
 extern const struct spirv_compiler pl_spirv_glslang;
@@ -29,10 +30,11 @@ static const struct spirv_compiler *compilers[] = {
 #endif
 };
 
-pl_spirv pl_spirv_create(pl_log log, struct pl_spirv_version spirv_ver)
+pl_spirv pl_spirv_create(pl_log log, struct pl_spirv_version spirv_ver,
+                         bool opt_performance)
 {
     for (int i = 0; i < PL_ARRAY_SIZE(compilers); i++) {
-        pl_spirv spirv = compilers[i]->create(log, spirv_ver);
+        pl_spirv spirv = compilers[i]->create(log, spirv_ver, opt_performance);
         if (!spirv)
             continue;
 
@@ -62,3 +64,45 @@ pl_str pl_spirv_compile_glsl(pl_spirv spirv, void *alloc,
 {
     return spirv->impl->compile(spirv, alloc, glsl, stage, shader);
 }
+
+struct compile_batch {
+    pl_spirv spirv;
+    struct pl_glsl_version glsl;
+    struct pl_spirv_job *jobs;
+};
+
+static void compile_job(void *priv, int i)
+{
+    struct compile_batch *batch = priv;
+    struct pl_spirv_job *job = &batch->jobs[i];
+
+    // Compile into a detached allocation, since `alloc` may not be shared
+    // between threads
+    job->spirv = pl_spirv_compile_glsl(batch->spirv, NULL, batch->glsl,
+                                       job->stage, job->shader);
+}
+
+bool pl_spirv_compile_glsl_batch(pl_spirv spirv, void *alloc,
+                                 struct pl_glsl_version glsl,
+                                 struct pl_spirv_job *jobs, int num_jobs)
+{
+    struct compile_batch batch = {
+        .spirv = spirv,
+        .glsl  = glsl,
+        .jobs  = jobs,
+    };
+
+    if (num_jobs == 1) {
+        compile_job(&batch, 0); // skip the thread pool round trip
+    } else {
+        pl_parallel_for(num_jobs, compile_job, &batch);
+    }
+
+    bool ok = true;
+    for (int i = 0; i < num_jobs; i++) {
+        pl_steal(alloc, jobs[i].spirv.buf);
+        ok &= jobs[i].spirv.len > 0;
+    }
+
+    return ok;
+}
@@ -27,21 +27,44 @@ typedef const struct pl_spirv_t {
     // SPIR-V version specified at creation time.
     struct pl_spirv_version version;
 
+    // Whether the SPIR-V optimizer runs its performance pass pipeline, rather
+    // than the (smaller and faster to compile) size pipeline.
+    bool opt_performance;
+
     // For cache invalidation, should uniquely identify everything about this
     // spirv compiler and its configuration.
     uint64_t signature;
 } *pl_spirv;
 
 // Initialize a SPIR-V compiler instance, or returns NULL on failure.
-pl_spirv pl_spirv_create(pl_log log, struct pl_spirv_version spirv_ver);
+pl_spirv pl_spirv_create(pl_log log, struct pl_spirv_version spirv_ver,
+                         bool opt_performance);
 void pl_spirv_destroy(pl_spirv *spirv);
 
 // Compile GLSL to SPIR-V. Returns {0} on failure.
+//
+// Thread-safety: May be called concurrently on the same `pl_spirv`, as long
+// as the calls don't share the same `alloc`.
 pl_str pl_spirv_compile_glsl(pl_spirv spirv, void *alloc,
                              struct pl_glsl_version glsl_ver,
                              enum glsl_shader_stage stage,
                              const char *shader);
 
+struct pl_spirv_job {
+    enum glsl_shader_stage stage;
+    const char *shader;
+
+    // Output: the compiled SPIR-V, or {0} on failure
+    pl_str spirv;
+};
+
+// Compile several independent shaders at once, distributing them over the
+// shared thread pool. Results are allocated on `alloc`. Returns false if any
+// of the jobs failed to compile.
+bool pl_spirv_compile_glsl_batch(pl_spirv spirv, void *alloc,
+                                 struct pl_glsl_version glsl_ver,
+                                 struct pl_spirv_job *jobs, int num_jobs);
+
 struct spirv_compiler {
     const char *name;
     void (*destroy)(pl_spirv spirv);
@@ -47,7 +47,8 @@ static void glslang_destroy(pl_spirv spirv)
     pl_free((void *) spirv);
 }
 
-static pl_spirv glslang_create(pl_log log, struct pl_spirv_version spirv_ver)
+static pl_spirv glslang_create(pl_log log, struct pl_spirv_version spirv_ver,
+                               bool opt_performance)
 {
     if (!pl_glslang_init()) {
         pl_fatal(log, "Failed initializing glslang SPIR-V compiler!");
@@ -59,6 +60,7 @@ static pl_spirv glslang_create(pl_log log, struct pl_spirv_version spirv_ver)
         .signature = pl_str0_hash(pl_spirv_glslang.name),
         .impl      = &pl_spirv_glslang,
         .version   = spirv_ver,
+        .opt_performance = opt_performance,
         .log       = log,
     };
 
@@ -78,6 +80,7 @@ static pl_spirv glslang_create(pl_log log, struct pl_spirv_version spirv_ver)
     pl_hash_merge(&spirv->signature, (GLSLANG_VERSION_MAJOR & 0xFF) << 24 |
                                      (GLSLANG_VERSION_MINOR & 0xFF) << 16 |
                                      (GLSLANG_VERSION_PATCH & 0xFFFF));
+    pl_hash_merge(&spirv->signature, spirv->opt_performance);
     return spirv;
 }
 
@@ -88,7 +91,8 @@ static pl_str glslang_compile(pl_spirv spirv, void *alloc,
 {
     struct pl_glslang_res *res;
 
-    res = pl_glslang_compile(glsl_ver, spirv->version, stage, shader);
+    res = pl_glslang_compile(glsl_ver, spirv->version, stage, shader,
+                             spirv->opt_performance);
     if (!res || !res->success) {
         PL_ERR(spirv, "glslang failed: %s", res ? res->error_msg : "(null)");
         pl_free(res);
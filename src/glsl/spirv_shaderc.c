@@ -35,7 +35,8 @@ static void shaderc_destroy(pl_spirv spirv)
     pl_free((void *) spirv);
 }
 
-static pl_spirv shaderc_create(pl_log log, struct pl_spirv_version spirv_ver)
+static pl_spirv shaderc_create(pl_log log, struct pl_spirv_version spirv_ver,
+                               bool opt_performance)
 {
     struct pl_spirv_t *spirv = pl_alloc_obj(NULL, spirv, struct priv);
     *spirv = (struct pl_spirv_t) {
@@ -43,6 +44,8 @@ static pl_spirv shaderc_create(pl_log log, struct pl_spirv_version spirv_ver)
         .impl      = &pl_spirv_shaderc,
         .version   = spirv_ver,
         .log       = log,
+        // shaderc always uses its performance optimization level
+        .opt_performance = true,
     };
 
     struct priv *p = PL_PRIV(spirv);
@@ -111,6 +114,8 @@ static pl_str shaderc_compile(pl_spirv spirv, void *alloc,
     static const char * const file_name = "input";
     static const char * const entry_point = "main";
 
+    // `p->compiler` is only ever passed by const handle, which shaderc
+    // guarantees to be safe for concurrent use from multiple threads
     shaderc_compilation_result_t res;
     res = shaderc_compile_into_spv(p->compiler, shader, len, kinds[stage],
                                    file_name, entry_point, opts);
@@ -15,8 +15,11 @@
  * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <limits.h>
+
 #include "common.h"
 #include "gpu.h"
+#include "pl_memcpy.h"
 
 #define require(expr) pl_require(gpu, expr)
 
@@ -27,6 +30,21 @@ void pl_gpu_destroy(pl_gpu gpu)
 
     struct pl_gpu_fns *impl = PL_PRIV(gpu);
     pl_dispatch_destroy(&impl->dp);
+    for (int i = 0; i < impl->shared_tex.num; i++)
+        pl_tex_destroy(gpu, &impl->shared_tex.elem[i].tex);
+    pl_mutex_destroy(&impl->shared_lock);
+    for (int i = 0; i < impl->shared_pass.num; i++)
+        pl_pass_destroy(gpu, &impl->shared_pass.elem[i].pass);
+    pl_mutex_destroy(&impl->pass_lock);
+    pl_mutex_destroy(&impl->fmt_lock);
+    for (int t = 0; t < PL_GPU_RING_COUNT; t++) {
+        struct pl_gpu_ring *ring = &impl->rings[t];
+        for (int i = 0; i < ring->num_slabs; i++) {
+            pl_assert(!ring->slabs[i].users);
+            pl_buf_destroy(gpu, &ring->slabs[i].buf);
+        }
+    }
+    pl_mutex_destroy(&impl->ring_lock);
     impl->destroy(gpu);
 }
 
@@ -44,6 +62,286 @@ pl_cache pl_gpu_cache(pl_gpu gpu)
     return atomic_load(&impl->cache);
 }
 
+pl_tex pl_gpu_shared_tex_acquire(pl_gpu gpu, uint64_t key,
+                                 pl_tex (*create)(pl_gpu gpu, void *priv),
+                                 void *priv)
+{
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    pl_tex tex = NULL;
+
+    pl_mutex_lock(&impl->shared_lock);
+    for (int i = 0; i < impl->shared_tex.num; i++) {
+        if (impl->shared_tex.elem[i].key == key) {
+            impl->shared_tex.elem[i].refs++;
+            tex = impl->shared_tex.elem[i].tex;
+            goto done;
+        }
+    }
+
+    tex = create ? create(gpu, priv) : NULL;
+    if (tex) {
+        PL_ARRAY_APPEND((void *) gpu, impl->shared_tex, (struct pl_gpu_shared_tex) {
+            .key  = key,
+            .tex  = tex,
+            .refs = 1,
+        });
+    }
+
+done:
+    pl_mutex_unlock(&impl->shared_lock);
+    return tex;
+}
+
+pl_tex pl_gpu_shared_tex(pl_gpu gpu, uint64_t key,
+                         pl_tex (*create)(pl_gpu gpu, void *priv), void *priv)
+{
+    // The reference is never released, so this stays alive until
+    // `pl_gpu_destroy`
+    return pl_gpu_shared_tex_acquire(gpu, key, create, priv);
+}
+
+void pl_gpu_shared_tex_release(pl_gpu gpu, pl_tex *tex)
+{
+    if (!*tex)
+        return;
+
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    pl_mutex_lock(&impl->shared_lock);
+    for (int i = 0; i < impl->shared_tex.num; i++) {
+        struct pl_gpu_shared_tex *st = &impl->shared_tex.elem[i];
+        if (st->tex != *tex)
+            continue;
+        if (--st->refs == 0) {
+            pl_tex_destroy(gpu, &st->tex);
+            PL_ARRAY_REMOVE_AT(impl->shared_tex, i);
+        }
+        goto done;
+    }
+
+    pl_unreachable(); // not a shared texture
+
+done:
+    pl_mutex_unlock(&impl->shared_lock);
+    *tex = NULL;
+}
+
+// Returns a new reference to the shared pass identified by `key`, or NULL.
+// Must be called with `pass_lock` held.
+static pl_pass shared_pass_ref(struct pl_gpu_fns *impl, uint64_t key)
+{
+    for (int i = 0; i < impl->shared_pass.num; i++) {
+        struct pl_gpu_shared_pass *sp = &impl->shared_pass.elem[i];
+        if (sp->key == key) {
+            sp->refs++;
+            return sp->pass;
+        }
+    }
+
+    return NULL;
+}
+
+pl_pass pl_gpu_shared_pass_acquire(pl_gpu gpu, uint64_t key,
+                                   const struct pl_pass_params *params)
+{
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    pl_mutex_lock(&impl->pass_lock);
+    pl_pass pass = shared_pass_ref(impl, key);
+    pl_mutex_unlock(&impl->pass_lock);
+    if (pass)
+        return pass;
+
+    // Compile without holding the lock, to avoid serializing compilation of
+    // unrelated passes (e.g. from asynchronous dispatch compile threads)
+    pass = pl_pass_create(gpu, params);
+    if (!pass)
+        return NULL;
+
+    pl_mutex_lock(&impl->pass_lock);
+    pl_pass existing = shared_pass_ref(impl, key);
+    if (!existing) {
+        PL_ARRAY_APPEND((void *) gpu, impl->shared_pass, (struct pl_gpu_shared_pass) {
+            .key  = key,
+            .pass = pass,
+            .refs = 1,
+        });
+    }
+    pl_mutex_unlock(&impl->pass_lock);
+
+    if (existing) {
+        // Lost the race against another thread compiling the same pass
+        pl_pass_destroy(gpu, &pass);
+        pass = existing;
+    }
+
+    return pass;
+}
+
+void pl_gpu_shared_pass_release(pl_gpu gpu, pl_pass *pass)
+{
+    if (!*pass)
+        return;
+
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    pl_pass destroy = NULL;
+    pl_mutex_lock(&impl->pass_lock);
+    for (int i = 0; i < impl->shared_pass.num; i++) {
+        struct pl_gpu_shared_pass *sp = &impl->shared_pass.elem[i];
+        if (sp->pass != *pass)
+            continue;
+        if (--sp->refs == 0) {
+            destroy = sp->pass;
+            PL_ARRAY_REMOVE_AT(impl->shared_pass, i);
+        }
+        goto done;
+    }
+
+    pl_unreachable(); // not a shared pass
+
+done:
+    pl_mutex_unlock(&impl->pass_lock);
+    pl_pass_destroy(gpu, &destroy);
+    *pass = NULL;
+}
+
+#define RING_SLAB_MIN (1 << 20)     // 1 MiB
+#define RING_SLAB_MAX (16 << 20)    // 16 MiB
+
+static size_t ring_max_size(pl_gpu gpu)
+{
+    size_t max_size = PL_MIN(gpu->limits.max_mapped_size, gpu->limits.max_buf_size);
+    return PL_MIN(max_size, RING_SLAB_MAX);
+}
+
+static pl_buf ring_slab_create(pl_gpu gpu, enum pl_gpu_ring_type type, size_t size)
+{
+    size = PL_ALIGN_POT(PL_MAX(size, RING_SLAB_MIN));
+    size = PL_MIN(size, ring_max_size(gpu));
+
+    return pl_buf_create(gpu, pl_buf_params(
+        .size           = size,
+        .host_mapped    = true,
+        .host_readable  = type == PL_GPU_RING_DOWNLOAD,
+        .drawable       = type == PL_GPU_RING_UPLOAD &&
+                          size <= gpu->limits.max_vbo_size,
+        .debug_tag      = PL_DEBUG_TAG,
+    ));
+}
+
+// Waits up to `timeout` for `slab` to become idle, and resets it so that it
+// can hold at least `size` bytes. Polling may re-enter the ring, so this also
+// fails if the slab got used in the meantime.
+static bool ring_slab_reset(pl_gpu gpu, struct pl_gpu_ring_slab *slab,
+                            enum pl_gpu_ring_type type, size_t size,
+                            uint64_t timeout)
+{
+    if (slab->buf) {
+        const uint64_t gen = slab->gen;
+        while (!slab->users && pl_buf_poll(gpu, slab->buf, timeout)) {
+            if (!timeout)
+                return false;
+        }
+
+        if (slab->users || slab->gen != gen)
+            return false;
+    }
+
+    if (!slab->buf || slab->buf->params.size < size) {
+        pl_buf_destroy(gpu, &slab->buf);
+        slab->buf = ring_slab_create(gpu, type, size);
+        if (!slab->buf)
+            return false; // retried on the next reset
+    }
+
+    slab->used = 0;
+    return true;
+}
+
+bool pl_gpu_ring_alloc(pl_gpu gpu, enum pl_gpu_ring_type type, size_t size,
+                       size_t align, struct pl_gpu_ring_alloc *out)
+{
+    if (!size || size > ring_max_size(gpu))
+        return false;
+
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    struct pl_gpu_ring *ring = &impl->rings[type];
+    struct pl_gpu_ring_slab *slab;
+    size_t offset = 0;
+    bool ok = false;
+
+    pl_mutex_lock(&impl->ring_lock);
+
+    // Fast path: suballocate from the current slab
+    if (ring->num_slabs && ring->slabs[ring->idx].buf) {
+        slab = &ring->slabs[ring->idx];
+        offset = PL_ALIGN(slab->used, align);
+        if (offset + size <= slab->buf->params.size)
+            goto done;
+    }
+
+    // Otherwise, recycle the oldest idle slab
+    offset = 0;
+    for (int i = 1; i <= ring->num_slabs; i++) {
+        int idx = (ring->idx + i) % ring->num_slabs;
+        slab = &ring->slabs[idx];
+        if (ring_slab_reset(gpu, slab, type, size, 0)) {
+            ring->idx = idx;
+            goto done;
+        }
+    }
+
+    // All busy, add a new slab to the ring
+    if (ring->num_slabs < PL_GPU_RING_SLABS) {
+        pl_buf buf = ring_slab_create(gpu, type, size);
+        if (!buf)
+            goto error;
+        ring->idx = ring->num_slabs++;
+        slab = &ring->slabs[ring->idx];
+        *slab = (struct pl_gpu_ring_slab) { .buf = buf };
+        goto done;
+    }
+
+    // Ring is full, block on the oldest slab
+    PL_TRACE(gpu, "All transient buffers busy! ...blocking (slow path)");
+    int idx = (ring->idx + 1) % ring->num_slabs;
+    slab = &ring->slabs[idx];
+    if (!ring_slab_reset(gpu, slab, type, size, 10000000)) // 10 ms
+        goto error;
+    ring->idx = idx;
+    // fall through
+
+done:
+    slab->used = offset + size;
+    slab->gen++;
+    slab->users++;
+    *out = (struct pl_gpu_ring_alloc) {
+        .buf    = slab->buf,
+        .offset = offset,
+        .data   = slab->buf->data + offset,
+        .type   = type,
+        .slab   = slab - ring->slabs,
+    };
+    ok = true;
+    // fall through
+
+error:
+    pl_mutex_unlock(&impl->ring_lock);
+    return ok;
+}
+
+void pl_gpu_ring_done(pl_gpu gpu, struct pl_gpu_ring_alloc *alloc)
+{
+    if (!alloc->buf)
+        return;
+
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    pl_mutex_lock(&impl->ring_lock);
+    struct pl_gpu_ring_slab *slab = &impl->rings[alloc->type].slabs[alloc->slab];
+    pl_assert(slab->buf == alloc->buf && slab->users > 0);
+    slab->users--;
+    pl_mutex_unlock(&impl->ring_lock);
+    *alloc = (struct pl_gpu_ring_alloc) {0};
+}
+
 void pl_gpu_set_cache(pl_gpu gpu, pl_cache cache)
 {
     struct pl_gpu_fns *impl = PL_PRIV(gpu);
@@ -94,10 +392,17 @@ bool pl_fmt_has_modifier(pl_fmt fmt, uint64_t modifier)
 pl_fmt pl_find_fmt(pl_gpu gpu, enum pl_fmt_type type, int num_components,
                     int min_depth, int host_bits, enum pl_fmt_caps caps)
 {
-    for (int n = 0; n < gpu->num_formats; n++) {
-        pl_fmt fmt = gpu->formats[n];
-        if (fmt->type != type || fmt->num_components != num_components)
-            continue;
+    if (type <= PL_FMT_UNKNOWN || type >= PL_FMT_TYPE_COUNT ||
+        num_components < 1 || num_components > 4)
+        goto no_fmt;
+
+    const struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    const struct pl_fmt_bucket *bucket = &impl->fmt_index[type][num_components - 1];
+    if ((bucket->caps & caps) != caps)
+        goto no_fmt;
+
+    for (int n = 0; n < bucket->num_formats; n++) {
+        pl_fmt fmt = bucket->formats[n];
         if ((fmt->caps & caps) != caps)
             continue;
 
@@ -122,6 +427,7 @@ pl_fmt pl_find_fmt(pl_gpu gpu, enum pl_fmt_type type, int num_components,
 next_fmt: ; // equivalent to `continue`
     }
 
+no_fmt:
     // ran out of formats
     PL_TRACE(gpu, "No matching format found");
     return NULL;
@@ -271,7 +577,7 @@ void pl_tex_destroy(pl_gpu gpu, pl_tex *tex)
     *tex = NULL;
 }
 
-static bool pl_tex_params_superset(struct pl_tex_params a, struct pl_tex_params b)
+bool pl_tex_params_superset(struct pl_tex_params a, struct pl_tex_params b)
 {
     return a.w == b.w && a.h == b.h && a.d == b.d &&
            a.format          == b.format &&
@@ -311,6 +617,54 @@ bool pl_tex_recreate(pl_gpu gpu, pl_tex *tex, const struct pl_tex_params *params
     return !!*tex;
 }
 
+// Rounds a texture dimension up to its allocation bucket. Buckets are spaced
+// at a quarter of the next lower power of two, so the headroom never exceeds
+// 25% (plus a small minimum granularity)
+static int headroom_size(int size, int max_size)
+{
+    if (size <= 0)
+        return size;
+
+    const int step = PL_MAX((1 << PL_LOG2(size)) / 4, 16);
+    return PL_MIN(PL_ALIGN2(size, step), PL_MAX(max_size, size));
+}
+
+// Existing textures are kept while they are large enough, and at most one
+// bucket larger than needed, to avoid thrashing around bucket boundaries
+static bool headroom_fits(int have, int want, int max_size)
+{
+    if (want <= 0)
+        return have == want;
+
+    const int limit = headroom_size(headroom_size(want, max_size) + 1, max_size);
+    return have >= want && have <= limit;
+}
+
+bool pl_tex_recreate_headroom(pl_gpu gpu, pl_tex *tex,
+                              const struct pl_tex_params *params)
+{
+    const uint32_t max_dim = params->d ? gpu->limits.max_tex_3d_dim :
+                             params->h ? gpu->limits.max_tex_2d_dim :
+                                         gpu->limits.max_tex_1d_dim;
+    const int max_size = PL_MIN(max_dim, INT_MAX);
+
+    struct pl_tex_params fixed = *params;
+    if (*tex && headroom_fits((*tex)->params.w, params->w, max_size) &&
+                headroom_fits((*tex)->params.h, params->h, max_size) &&
+                headroom_fits((*tex)->params.d, params->d, max_size))
+    {
+        fixed.w = (*tex)->params.w;
+        fixed.h = (*tex)->params.h;
+        fixed.d = (*tex)->params.d;
+    } else {
+        fixed.w = headroom_size(params->w, max_size);
+        fixed.h = headroom_size(params->h, max_size);
+        fixed.d = headroom_size(params->d, max_size);
+    }
+
+    return pl_tex_recreate(gpu, tex, &fixed);
+}
+
 void pl_tex_clear_ex(pl_gpu gpu, pl_tex dst, const union pl_clear_color color)
 {
     require(dst->params.blit_dst);
@@ -371,7 +725,9 @@ static void infer_rc(pl_tex tex, pl_rect3d *rc)
         rc->z1 = tex->params.d;
 }
 
-void pl_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params)
+// Validates `params` and normalizes it into `fixed`. Returns false on error
+static bool fix_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params,
+                         struct pl_tex_blit_params *fixed)
 {
     pl_tex src = params->src, dst = params->dst;
     require(src && dst);
@@ -384,55 +740,122 @@ void pl_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params)
     require(dst->params.blit_dst);
     require(params->sample_mode != PL_TEX_SAMPLE_LINEAR || (src_fmt->caps & PL_FMT_CAP_LINEAR));
 
-    struct pl_tex_blit_params fixed = *params;
-    infer_rc(src, &fixed.src_rc);
-    infer_rc(dst, &fixed.dst_rc);
-    strip_coords(src, &fixed.src_rc);
-    strip_coords(dst, &fixed.dst_rc);
+    *fixed = *params;
+    infer_rc(src, &fixed->src_rc);
+    infer_rc(dst, &fixed->dst_rc);
+    strip_coords(src, &fixed->src_rc);
+    strip_coords(dst, &fixed->dst_rc);
 
-    require(fixed.src_rc.x0 >= 0 && fixed.src_rc.x0 < src->params.w);
-    require(fixed.src_rc.x1 > 0 && fixed.src_rc.x1 <= src->params.w);
-    require(fixed.dst_rc.x0 >= 0 && fixed.dst_rc.x0 < dst->params.w);
-    require(fixed.dst_rc.x1 > 0 && fixed.dst_rc.x1 <= dst->params.w);
+    require(fixed->src_rc.x0 >= 0 && fixed->src_rc.x0 < src->params.w);
+    require(fixed->src_rc.x1 > 0 && fixed->src_rc.x1 <= src->params.w);
+    require(fixed->dst_rc.x0 >= 0 && fixed->dst_rc.x0 < dst->params.w);
+    require(fixed->dst_rc.x1 > 0 && fixed->dst_rc.x1 <= dst->params.w);
 
     if (src->params.h) {
-        require(fixed.src_rc.y0 >= 0 && fixed.src_rc.y0 < src->params.h);
-        require(fixed.src_rc.y1 > 0 && fixed.src_rc.y1 <= src->params.h);
+        require(fixed->src_rc.y0 >= 0 && fixed->src_rc.y0 < src->params.h);
+        require(fixed->src_rc.y1 > 0 && fixed->src_rc.y1 <= src->params.h);
     }
 
     if (dst->params.h) {
-        require(fixed.dst_rc.y0 >= 0 && fixed.dst_rc.y0 < dst->params.h);
-        require(fixed.dst_rc.y1 > 0 && fixed.dst_rc.y1 <= dst->params.h);
+        require(fixed->dst_rc.y0 >= 0 && fixed->dst_rc.y0 < dst->params.h);
+        require(fixed->dst_rc.y1 > 0 && fixed->dst_rc.y1 <= dst->params.h);
     }
 
     if (src->params.d) {
-        require(fixed.src_rc.z0 >= 0 && fixed.src_rc.z0 < src->params.d);
-        require(fixed.src_rc.z1 > 0 && fixed.src_rc.z1 <= src->params.d);
+        require(fixed->src_rc.z0 >= 0 && fixed->src_rc.z0 < src->params.d);
+        require(fixed->src_rc.z1 > 0 && fixed->src_rc.z1 <= src->params.d);
     }
 
     if (dst->params.d) {
-        require(fixed.dst_rc.z0 >= 0 && fixed.dst_rc.z0 < dst->params.d);
-        require(fixed.dst_rc.z1 > 0 && fixed.dst_rc.z1 <= dst->params.d);
+        require(fixed->dst_rc.z0 >= 0 && fixed->dst_rc.z0 < dst->params.d);
+        require(fixed->dst_rc.z1 > 0 && fixed->dst_rc.z1 <= dst->params.d);
+    }
+
+    return true;
+
+error:
+    if (src && dst && (src->params.debug_tag || dst->params.debug_tag)) {
+        PL_ERR(gpu, "  for textures: src %s, dst %s",
+               PL_DEF(src->params.debug_tag, "(unknown)"),
+               PL_DEF(dst->params.debug_tag, "(unknown)"));
     }
+    return false;
+}
 
+static void tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *fixed)
+{
+    pl_tex dst = fixed->dst;
     pl_rect3d full = {0, 0, 0, dst->params.w, dst->params.h, dst->params.d};
     strip_coords(dst, &full);
 
-    pl_rect3d rcnorm = fixed.dst_rc;
+    pl_rect3d rcnorm = fixed->dst_rc;
     pl_rect3d_normalize(&rcnorm);
     if (pl_rect3d_eq(rcnorm, full))
         pl_tex_invalidate(gpu, dst);
 
     const struct pl_gpu_fns *impl = PL_PRIV(gpu);
-    impl->tex_blit(gpu, &fixed);
-    return;
+    impl->tex_blit(gpu, fixed);
+}
 
-error:
-    if (src->params.debug_tag || dst->params.debug_tag) {
-        PL_ERR(gpu, "  for textures: src %s, dst %s",
-               PL_DEF(src->params.debug_tag, "(unknown)"),
-               PL_DEF(dst->params.debug_tag, "(unknown)"));
+void pl_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params)
+{
+    struct pl_tex_blit_params fixed;
+    if (fix_tex_blit(gpu, params, &fixed))
+        tex_blit(gpu, &fixed);
+}
+
+// Whether `blit` can be merged into the same compute dispatch as `batch`
+static bool blit_mergeable(const struct pl_tex_blit_params *batch, int num,
+                           const struct pl_tex_blit_params *blit)
+{
+    if (blit->src != batch[0].src || blit->dst != batch[0].dst ||
+        blit->sample_mode != batch[0].sample_mode)
+        return false;
+
+    // Merged blits run concurrently, so their destinations must not overlap
+    pl_rect3d rc = blit->dst_rc;
+    pl_rect3d_normalize(&rc);
+    for (int i = 0; i < num; i++) {
+        pl_rect3d prev = batch[i].dst_rc;
+        pl_rect3d_normalize(&prev);
+        if (rc.x0 < prev.x1 && prev.x0 < rc.x1 &&
+            rc.y0 < prev.y1 && prev.y0 < rc.y1 &&
+            rc.z0 < prev.z1 && prev.z0 < rc.z1)
+            return false;
     }
+
+    return true;
+}
+
+static void flush_blits(pl_gpu gpu, const struct pl_tex_blit_params *batch, int num)
+{
+    if (num > 1 && pl_tex_blit_compute_batch(gpu, batch, num))
+        return;
+
+    for (int i = 0; i < num; i++)
+        tex_blit(gpu, &batch[i]);
+}
+
+void pl_tex_blit_batch(pl_gpu gpu, const struct pl_tex_blit_params *params,
+                       int num_blits)
+{
+    struct pl_tex_blit_params batch[PL_TEX_BLIT_BATCH_MAX];
+    int num = 0;
+
+    for (int i = 0; i < num_blits; i++) {
+        struct pl_tex_blit_params fixed;
+        if (!fix_tex_blit(gpu, &params[i], &fixed))
+            continue;
+
+        if (num == PL_ARRAY_SIZE(batch) || (num && !blit_mergeable(batch, num, &fixed))) {
+            flush_blits(gpu, batch, num);
+            num = 0;
+        }
+
+        batch[num++] = fixed;
+    }
+
+    flush_blits(gpu, batch, num);
 }
 
 static bool fix_tex_transfer(pl_gpu gpu, struct pl_tex_transfer_params *params)
@@ -924,13 +1347,9 @@ void memcpy_layout(void *dst_p, struct pl_var_layout dst_layout,
     }
 
     size_t stride = PL_MIN(src_layout.stride, dst_layout.stride);
-    uintptr_t end = src + src_layout.size;
-    while (src < end) {
-        pl_assert(dst < dst + dst_layout.size);
-        memcpy((void *) dst, (const void *) src, stride);
-        src += src_layout.stride;
-        dst += dst_layout.stride;
-    }
+    size_t rows = PL_DIV_UP(src_layout.size, src_layout.stride);
+    pl_memcpy_2d((void *) dst, dst_layout.stride, (const void *) src,
+                 src_layout.stride, stride, rows, false);
 }
 
 int pl_desc_namespace(pl_gpu gpu, enum pl_desc_type type)
@@ -1038,6 +1457,11 @@ pl_pass pl_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
         break;
     case PL_PASS_COMPUTE:
         require(gpu->glsl.compute);
+        require(!params->subgroup_size ||
+                (PL_ISPOT(params->subgroup_size) &&
+                 params->subgroup_size >= gpu->glsl.min_subgroup_size &&
+                 params->subgroup_size <= gpu->glsl.max_subgroup_size));
+        require(!params->full_subgroups || gpu->glsl.max_subgroup_size);
         break;
     case PL_PASS_INVALID:
     case PL_PASS_TYPE_COUNT:
@@ -1100,6 +1524,15 @@ void pl_pass_destroy(pl_gpu gpu, pl_pass *pass)
     *pass = NULL;
 }
 
+bool pl_pass_pending(pl_gpu gpu, pl_pass pass)
+{
+    const struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    if (!impl->pass_pending)
+        return false;
+
+    return impl->pass_pending(gpu, pass);
+}
+
 void pl_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
 {
     pl_pass pass = params->pass;
@@ -1273,6 +1706,16 @@ bool pl_gpu_is_failed(pl_gpu gpu)
     return impl->gpu_is_failed(gpu);
 }
 
+bool pl_gpu_get_memory_budget(pl_gpu gpu, struct pl_gpu_memory_budget *out)
+{
+    const struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    *out = (struct pl_gpu_memory_budget) {0};
+    if (!impl->gpu_get_memory_budget)
+        return false;
+
+    return impl->gpu_get_memory_budget(gpu, out);
+}
+
 pl_timer pl_timer_create(pl_gpu gpu)
 {
     const struct pl_gpu_fns *impl = PL_PRIV(gpu);
@@ -19,6 +19,7 @@
 
 #include "common.h"
 #include "log.h"
+#include "pl_thread.h"
 
 #include <libplacebo/gpu.h>
 #include <libplacebo/dispatch.h>
@@ -29,6 +30,15 @@
 #define DRM_FORMAT_MOD_INVALID  ((UINT64_C(1) << 56) - 1)
 #endif
 
+// Transient buffer rings, see `pl_gpu_ring_alloc`
+enum pl_gpu_ring_type {
+    PL_GPU_RING_UPLOAD,     // host-mapped, and drawable if possible
+    PL_GPU_RING_DOWNLOAD,   // host-mapped and host-readable
+    PL_GPU_RING_COUNT,
+};
+
+#define PL_GPU_RING_SLABS 4
+
 // This struct must be the first member of the gpu's priv struct. The `pl_gpu`
 // helpers will cast the priv struct to this struct!
 
@@ -44,6 +54,54 @@ struct pl_gpu_fns {
     // Internal cache, or NULL. Set by the user (via pl_gpu_set_cache).
     _Atomic(pl_cache) cache;
 
+    // Lazily created by `pl_gpu_shared_tex`, protected by `shared_lock`
+    pl_mutex shared_lock;
+    PL_ARRAY(struct pl_gpu_shared_tex {
+        uint64_t key;
+        pl_tex tex;
+        int refs;
+    }) shared_tex;
+
+    // Compiled passes shared between all `pl_dispatch` objects on this GPU,
+    // see `pl_gpu_shared_pass_acquire`. Protected by `pass_lock`.
+    pl_mutex pass_lock;
+    PL_ARRAY(struct pl_gpu_shared_pass {
+        uint64_t key;
+        pl_pass pass;
+        int refs;
+    }) shared_pass;
+
+    // Formats grouped by type and number of components, in the same order as
+    // `gpu->formats`. Built by `pl_gpu_finalize`, immutable afterwards.
+    struct pl_fmt_bucket {
+        pl_fmt *formats;
+        int num_formats;
+        enum pl_fmt_caps caps;  // union of all caps in this bucket
+    } fmt_index[PL_FMT_TYPE_COUNT][4];
+
+    // Memoized results of `pl_plane_find_fmt`, protected by `fmt_lock`
+    pl_mutex fmt_lock;
+    PL_ARRAY(struct pl_plane_fmt {
+        uint64_t key;
+        pl_fmt fmt;
+        int map[4];
+    }) plane_fmts;
+
+    // Lazily created by `pl_gpu_ring_alloc`, protected by `ring_lock`. This
+    // lock is recursive, because polling a slab may run transfer callbacks,
+    // which are in turn allowed to allocate from the ring again.
+    pl_mutex ring_lock;
+    struct pl_gpu_ring {
+        struct pl_gpu_ring_slab {
+            pl_buf buf;
+            size_t used;    // bytes allocated since the last reset
+            uint64_t gen;   // incremented on every allocation
+            int users;      // allocations not yet released
+        } slabs[PL_GPU_RING_SLABS];
+        int num_slabs;
+        int idx;            // slab currently being allocated from
+    } rings[PL_GPU_RING_COUNT];
+
     // Destructors: These also free the corresponding objects, but they
     // must not be called on NULL. (The NULL checks are done by the pl_*_destroy
     // wrappers)
@@ -69,11 +127,13 @@ struct pl_gpu_fns {
     GPU_PFN(desc_namespace);
     GPU_PFN(pass_create);
     GPU_PFN(pass_run);
+    bool (*pass_pending)(pl_gpu, pl_pass); // optional: if NULL, always ready
     GPU_PFN(timer_create); // optional
     GPU_PFN(timer_query); // optional
     GPU_PFN(gpu_flush); // optional
     GPU_PFN(gpu_finish);
     GPU_PFN(gpu_is_failed); // optional
+    GPU_PFN(gpu_get_memory_budget); // optional
 };
 #undef GPU_PFN
 
@@ -97,6 +157,73 @@ static inline bool pl_gpu_supports_interop(pl_gpu gpu)
 pl_dispatch pl_gpu_dispatch(pl_gpu gpu);
 pl_cache pl_gpu_cache(pl_gpu gpu);
 
+// Returns a read-only texture shared by all users of this `pl_gpu`, uniquely
+// identified by `key`, invoking `create` to create it on first use. This
+// avoids uploading redundant copies of static tables for every shader object.
+// Thread-safe. Returns NULL on failure (in which case creation is retried on
+// the next call). Textures returned by this function live as long as the GPU.
+pl_tex pl_gpu_shared_tex(pl_gpu gpu, uint64_t key,
+                         pl_tex (*create)(pl_gpu gpu, void *priv), void *priv);
+
+// Refcounted variant of `pl_gpu_shared_tex`, for textures which should not
+// outlive their users. Every successful call must be paired with a call to
+// `pl_gpu_shared_tex_release`, which destroys the texture once the last
+// reference is gone. `create` may be NULL, to only look up existing textures.
+pl_tex pl_gpu_shared_tex_acquire(pl_gpu gpu, uint64_t key,
+                                 pl_tex (*create)(pl_gpu gpu, void *priv),
+                                 void *priv);
+void pl_gpu_shared_tex_release(pl_gpu gpu, pl_tex *tex);
+
+// Returns a `pl_pass` shared by all users of this `pl_gpu`, uniquely identified
+// by `key`, creating it from `params` if no such pass exists yet. This allows
+// multiple `pl_dispatch` objects executing identical shaders to share a single
+// compiled pipeline. Thread-safe. Every successful call must be paired with a
+// call to `pl_gpu_shared_pass_release`, which destroys the pass once the last
+// reference is gone. Returns NULL on failure.
+//
+// Note: Compilation happens outside of the internal lock, so concurrent
+// callers may compile redundant passes, all but one of which are discarded.
+pl_pass pl_gpu_shared_pass_acquire(pl_gpu gpu, uint64_t key,
+                                   const struct pl_pass_params *params);
+void pl_gpu_shared_pass_release(pl_gpu gpu, pl_pass *pass);
+
+// Transient allocation from one of the GPU's buffer rings
+struct pl_gpu_ring_alloc {
+    pl_buf buf;
+    size_t offset;  // offset of the allocation within `buf`
+    uint8_t *data;  // mapped pointer to the allocation, `buf->data + offset`
+
+    // Internal bookkeeping
+    enum pl_gpu_ring_type type;
+    int slab;
+};
+
+// Suballocates `size` bytes, aligned to a multiple of `align`, from a small
+// per-GPU pool of persistently mapped buffers. This avoids creating and
+// destroying a buffer for every short-lived transfer or vertex upload. Slabs
+// are reused once `pl_buf_poll` reports them as idle. Returns false if the
+// request is too large or the GPU lacks host-mapped buffers, in which case
+// the caller should fall back to a dedicated buffer. Thread-safe.
+//
+// The caller must submit all operations using the allocation, and then
+// release it with `pl_gpu_ring_done`, before the GPU can recycle it.
+// Releasing does not wait for the GPU. Never needs to be released on failure.
+bool pl_gpu_ring_alloc(pl_gpu gpu, enum pl_gpu_ring_type type, size_t size,
+                       size_t align, struct pl_gpu_ring_alloc *out);
+void pl_gpu_ring_done(pl_gpu gpu, struct pl_gpu_ring_alloc *alloc);
+
+// Returns true if the driver is still compiling `pass` in the background.
+// This is only possible on backends which set `pl_gpu_fns.pass_pending`.
+// `pl_pass_run` implicitly blocks until compilation is complete.
+bool pl_pass_pending(pl_gpu gpu, pl_pass pass);
+
+// Returns whether `pl_pass_create` may return passes which are still pending
+static inline bool pl_gpu_compiles_async(pl_gpu gpu)
+{
+    const struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    return impl->pass_pending;
+}
+
 // GPU-internal helpers: these should not be used outside of GPU implementations
 
 // This performs several tasks. It sorts the format list, logs GPU metadata,
@@ -117,6 +244,11 @@ uint32_t pl_fmt_fourcc(pl_fmt fmt);
 // Compute the total size (in bytes) of a texture transfer operation
 size_t pl_tex_transfer_size(const struct pl_tex_transfer_params *par);
 
+// Approximate amount of memory (in bytes) backing a texture, for accounting
+// purposes. Ignores any driver-specific padding or alignment. Returns 0 for
+// NULL textures.
+size_t pl_tex_mem_size(pl_tex tex);
+
 // Split a tex transfer into slices. For emulated formats, `texel_fmt` gives
 // the format of the underlying texel buffer.
 //
@@ -126,6 +258,10 @@ int pl_tex_transfer_slices(pl_gpu gpu, pl_fmt texel_fmt,
                            const struct pl_tex_transfer_params *params,
                            struct pl_tex_transfer_params **out_slices);
 
+// Returns whether a texture created with `a` can be used in place of one
+// created with `b`, e.g. for `pl_tex_recreate`
+bool pl_tex_params_superset(struct pl_tex_params a, struct pl_tex_params b);
+
 // Helper that wraps pl_tex_upload/download using texture upload buffers to
 // ensure that params->buf is always set.
 bool pl_tex_upload_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params);
@@ -139,6 +275,14 @@ bool pl_tex_download_texel(pl_gpu gpu, const struct pl_tex_transfer_params *para
 // blit requires linear sampling. Returns false if these conditions are unmet.
 bool pl_tex_blit_compute(pl_gpu gpu, const struct pl_tex_blit_params *params);
 
+// Performs `num` (normalized) blits between the same pair of 2D textures in a
+// single compute dispatch. `src` must be sampleable, and `dst` storable. The
+// `dst_rc` of the blits must not overlap. Returns false if these conditions
+// are unmet.
+#define PL_TEX_BLIT_BATCH_MAX 64
+bool pl_tex_blit_compute_batch(pl_gpu gpu, const struct pl_tex_blit_params *blits,
+                               int num);
+
 // Helper to do a 2D blit with stretch and scale using a raster pass
 void pl_tex_blit_raster(pl_gpu gpu, const struct pl_tex_blit_params *params);
 
@@ -20,6 +20,8 @@
 #include "common.h"
 #include "shaders.h"
 #include "gpu.h"
+#include "pl_memcpy.h"
+#include "pl_thread_pool.h"
 
 // GPU-internal helpers
 
@@ -135,6 +137,33 @@ static void print_formats(pl_gpu gpu)
     }
 }
 
+static void index_formats(struct pl_gpu_t *gpu)
+{
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    pl_fmt *formats = pl_calloc_ptr(gpu, gpu->num_formats, formats);
+
+    for (int n = 0; n < gpu->num_formats; n++) {
+        pl_fmt fmt = gpu->formats[n];
+        impl->fmt_index[fmt->type][fmt->num_components - 1].num_formats++;
+    }
+
+    for (int t = 0; t < PL_FMT_TYPE_COUNT; t++) {
+        for (int c = 0; c < 4; c++) {
+            struct pl_fmt_bucket *bucket = &impl->fmt_index[t][c];
+            bucket->formats = formats;
+            formats += bucket->num_formats;
+            bucket->num_formats = 0;
+        }
+    }
+
+    for (int n = 0; n < gpu->num_formats; n++) {
+        pl_fmt fmt = gpu->formats[n];
+        struct pl_fmt_bucket *bucket = &impl->fmt_index[fmt->type][fmt->num_components - 1];
+        bucket->formats[bucket->num_formats++] = fmt;
+        bucket->caps |= fmt->caps;
+    }
+}
+
 pl_gpu pl_gpu_finalize(struct pl_gpu_t *gpu)
 {
     // Sort formats
@@ -152,7 +181,7 @@ pl_gpu pl_gpu_finalize(struct pl_gpu_t *gpu)
         pl_fmt fmt = gpu->formats[n];
         pl_assert(fmt->name);
         pl_assert(fmt->type);
-        pl_assert(fmt->num_components);
+        pl_assert(fmt->num_components && fmt->num_components <= 4);
         pl_assert(fmt->internal_size);
         pl_assert(fmt->opaque ? !fmt->texel_size : fmt->texel_size);
         pl_assert(!fmt->gatherable || (fmt->caps & PL_FMT_CAP_SAMPLEABLE));
@@ -202,6 +231,8 @@ pl_gpu pl_gpu_finalize(struct pl_gpu_t *gpu)
         LOG(PRIu32, max_group_size[2]);
     }
     LOG(PRIu32, subgroup_size);
+    LOG(PRIu32, min_subgroup_size);
+    LOG(PRIu32, max_subgroup_size);
     LOG(PRIi16, min_gather_offset);
     LOG(PRIi16, max_gather_offset);
 #undef LOG_STRUCT
@@ -264,10 +295,15 @@ pl_gpu pl_gpu_finalize(struct pl_gpu_t *gpu)
     }
 
     print_formats(gpu);
+    index_formats(gpu);
 
     // Finally, create a `pl_dispatch` object for internal operations
     struct pl_gpu_fns *impl = PL_PRIV(gpu);
     atomic_init(&impl->cache, NULL);
+    pl_mutex_init(&impl->shared_lock);
+    pl_mutex_init(&impl->pass_lock);
+    pl_mutex_init(&impl->fmt_lock);
+    pl_mutex_init_type(&impl->ring_lock, PL_MUTEX_RECURSIVE);
     impl->dp = pl_dispatch_create(gpu->log, gpu);
     return gpu;
 }
@@ -465,6 +501,15 @@ size_t pl_tex_transfer_size(const struct pl_tex_transfer_params *par)
     return (d - 1) * par->depth_pitch + (h - 1) * par->row_pitch + w * pixel_pitch;
 }
 
+size_t pl_tex_mem_size(pl_tex tex)
+{
+    if (!tex)
+        return 0;
+
+    return (size_t) tex->params.w * PL_DEF(tex->params.h, 1) *
+           PL_DEF(tex->params.d, 1) * tex->params.format->texel_size;
+}
+
 int pl_tex_transfer_slices(pl_gpu gpu, pl_fmt texel_fmt,
                            const struct pl_tex_transfer_params *params,
                            struct pl_tex_transfer_params **out_slices)
@@ -523,6 +568,108 @@ int pl_tex_transfer_slices(pl_gpu gpu, pl_fmt texel_fmt,
     return slices.num;
 }
 
+// Large synchronous uploads are split into horizontal bands of roughly
+// `UPLOAD_CHUNK_SIZE`, each staged through its own host-mapped buffer. The
+// memcpy into each band is spread across the thread pool, and every band is
+// flushed to the GPU before the next one is staged, so the host copy of band
+// N+1 overlaps with the GPU copy of band N.
+#define UPLOAD_CHUNKED_MIN  (16 << 20) // 16 MiB
+#define UPLOAD_CHUNK_SIZE   (8 << 20)
+#define UPLOAD_PIECE_SIZE   (1 << 20)
+
+struct upload_copy_ctx {
+    uint8_t *dst;
+    const uint8_t *src;
+    size_t size;
+};
+
+static void upload_copy_piece(void *priv, int i)
+{
+    const struct upload_copy_ctx *ctx = priv;
+    size_t offset = (size_t) i * UPLOAD_PIECE_SIZE;
+    pl_memcpy_stream(ctx->dst + offset, ctx->src + offset,
+                     PL_MIN(UPLOAD_PIECE_SIZE, ctx->size - offset));
+}
+
+// Returns the number of rows per band, or 0 if chunking is not applicable
+static int upload_chunk_rows(pl_gpu gpu, const struct pl_tex_transfer_params *params,
+                             size_t size)
+{
+    if (size < UPLOAD_CHUNKED_MIN || params->timer)
+        return 0;
+    if (pl_rect_d(params->rc) != 1 || pl_rect_h(params->rc) < 2)
+        return 0;
+
+    size_t max_chunk = PL_MIN(gpu->limits.max_mapped_size, gpu->limits.max_buf_size);
+    max_chunk = PL_MIN(max_chunk, UPLOAD_CHUNK_SIZE);
+    int rows = PL_MIN(max_chunk / params->row_pitch, pl_rect_h(params->rc));
+    return rows >= pl_rect_h(params->rc) ? 0 : rows;
+}
+
+// Alignment for transfer buffer offsets
+static size_t xfer_align(pl_gpu gpu, const struct pl_tex_transfer_params *params)
+{
+    size_t align = PL_MAX(gpu->limits.align_tex_xfer_offset, 4);
+    return pl_lcm(align, params->tex->params.format->texel_size);
+}
+
+static bool upload_chunked(pl_gpu gpu, const struct pl_tex_transfer_params *params,
+                           int chunk_rows)
+{
+    const uint8_t *src = params->ptr;
+    const int h = pl_rect_h(params->rc);
+    bool ok = true;
+
+    for (int y = 0; y < h && ok; y += chunk_rows) {
+        struct pl_tex_transfer_params chunk = *params;
+        chunk.ptr = NULL;
+        chunk.callback = NULL;
+        chunk.rc.y0 = params->rc.y0 + y;
+        chunk.rc.y1 = PL_MIN(chunk.rc.y0 + chunk_rows, params->rc.y1);
+
+        struct upload_copy_ctx ctx = {
+            .src = src + (size_t) y * params->row_pitch,
+            .size = pl_tex_transfer_size(&chunk),
+        };
+
+        struct pl_gpu_ring_alloc ring = {0};
+        if (pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, ctx.size,
+                              xfer_align(gpu, params), &ring))
+        {
+            chunk.buf = ring.buf;
+            chunk.buf_offset = ring.offset;
+            ctx.dst = ring.data;
+        } else {
+            chunk.buf = pl_buf_create(gpu, pl_buf_params(
+                .size = ctx.size,
+                .host_mapped = true,
+                .debug_tag = PL_DEBUG_TAG,
+            ));
+            if (!chunk.buf) {
+                ok = false;
+                break;
+            }
+            ctx.dst = chunk.buf->data;
+        }
+
+        pl_parallel_for(PL_DIV_UP(ctx.size, UPLOAD_PIECE_SIZE),
+                        upload_copy_piece, &ctx);
+
+        ok = pl_tex_upload(gpu, &chunk);
+        if (ring.buf) {
+            pl_gpu_ring_done(gpu, &ring);
+        } else {
+            pl_buf_destroy(gpu, &chunk.buf);
+        }
+        pl_gpu_flush(gpu);
+    }
+
+    // The host pointer is no longer referenced, even on failure
+    if (params->callback)
+        params->callback(params->priv);
+    return ok;
+}
+
 bool pl_tex_upload_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params)
 {
     if (params->buf)
@@ -560,6 +707,25 @@ bool pl_tex_upload_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     }
 
     if (!fixed.buf) {
+        int chunk_rows = upload_chunk_rows(gpu, params, bufparams.size);
+        if (chunk_rows)
+            return upload_chunked(gpu, params, chunk_rows);
+
+        struct pl_gpu_ring_alloc ring;
+        if (pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, bufparams.size,
+                              xfer_align(gpu, params), &ring))
+        {
+            pl_memcpy_stream(ring.data, params->ptr, bufparams.size);
+            if (params->callback)
+                params->callback(params->priv);
+            fixed.callback = NULL;
+            fixed.buf = ring.buf;
+            fixed.buf_offset = ring.offset;
+            bool ok = pl_tex_upload(gpu, &fixed);
+            pl_gpu_ring_done(gpu, &ring);
+            return ok;
+        }
+
         bufparams.import_handle = 0;
         bufparams.host_writable = true;
         fixed.buf = pl_buf_create(gpu, &bufparams);
@@ -627,6 +793,33 @@ bool pl_tex_download_pbo(pl_gpu gpu, const struct pl_tex_transfer_params *params
         pl_log_level_cap(gpu->log, PL_LOG_NONE);
     }
 
+    // Synchronous downloads can read back from the transient ring, since
+    // they wait for completion anyway. Asynchronous downloads keep using a
+    // dedicated buffer, to avoid their callbacks waiting on unrelated work
+    // sharing the same slab.
+    struct pl_gpu_ring_alloc ring;
+    if (!buf && !params->callback &&
+        pl_gpu_ring_alloc(gpu, PL_GPU_RING_DOWNLOAD, bufparams.size,
+                          xfer_align(gpu, params), &ring))
+    {
+        struct pl_tex_transfer_params fixed = *params;
+        fixed.ptr = NULL;
+        fixed.buf = ring.buf;
+        fixed.buf_offset = ring.offset;
+        bool ok = pl_tex_download(gpu, &fixed);
+        if (ok) {
+            while (pl_buf_poll(gpu, fixed.buf, 10000000)) // 10 ms
+                PL_TRACE(gpu, "pl_tex_download: synchronous/blocking (slow path)");
+            ok = pl_buf_read(gpu, fixed.buf, fixed.buf_offset, params->ptr,
+                             bufparams.size);
+        }
+
+        // Only release after reading back, to prevent the slab from being
+        // recycled underneath us
+        pl_gpu_ring_done(gpu, &ring);
+        return ok;
+    }
+
     if (!buf) {
         // Fallback when host pointer import is not supported
         bufparams.import_handle = 0;
@@ -1009,6 +1202,129 @@ bool pl_tex_blit_compute(pl_gpu gpu, const struct pl_tex_blit_params *params)
     ));
 }
 
+bool pl_tex_blit_compute_batch(pl_gpu gpu, const struct pl_tex_blit_params *blits,
+                               int num)
+{
+    pl_assert(num > 0 && num <= PL_TEX_BLIT_BATCH_MAX);
+    pl_tex src_tex = blits[0].src, dst_tex = blits[0].dst;
+    if (!dst_tex->params.storable || !src_tex->params.sampleable || src_tex == dst_tex)
+        return false;
+    if (pl_tex_params_dimension(src_tex->params) != 2 ||
+        pl_tex_params_dimension(dst_tex->params) != 2)
+        return false;
+
+    // Round up the array size, to limit the number of distinct shaders
+    int size = 1;
+    while (size < num)
+        size <<= 1;
+
+    int dst_rects[PL_TEX_BLIT_BATCH_MAX][4] = {0};
+    float src_rects[PL_TEX_BLIT_BATCH_MAX][4] = {0};
+    int max_w = 0, max_h = 0;
+    for (int i = 0; i < num; i++) {
+        pl_assert(blits[i].src == src_tex && blits[i].dst == dst_tex);
+
+        // Normalize `dst_rc`, moving all flipping to `src_rc` instead
+        pl_rect3d src_rc = blits[i].src_rc;
+        pl_rect3d dst_rc = blits[i].dst_rc;
+        if (pl_rect_w(dst_rc) < 0) {
+            PL_SWAP(src_rc.x0, src_rc.x1);
+            PL_SWAP(dst_rc.x0, dst_rc.x1);
+        }
+        if (pl_rect_h(dst_rc) < 0) {
+            PL_SWAP(src_rc.y0, src_rc.y1);
+            PL_SWAP(dst_rc.y0, dst_rc.y1);
+        }
+
+        memcpy(dst_rects[i], (int[4]) { dst_rc.x0, dst_rc.y0, dst_rc.x1, dst_rc.y1 },
+               sizeof(dst_rects[i]));
+        memcpy(src_rects[i], (float[4]) {
+            (float) src_rc.x0 / src_tex->params.w,
+            (float) src_rc.y0 / src_tex->params.h,
+            (float) src_rc.x1 / src_tex->params.w,
+            (float) src_rc.y1 / src_tex->params.h,
+        }, sizeof(src_rects[i]));
+
+        max_w = PL_MAX(max_w, pl_rect_w(dst_rc));
+        max_h = PL_MAX(max_h, pl_rect_h(dst_rc));
+    }
+
+    const int bs = 16;
+    pl_dispatch dp = pl_gpu_dispatch(gpu);
+    pl_shader sh = pl_dispatch_begin(dp);
+    if (!sh_try_compute(sh, bs, bs, false, 0)) {
+        pl_dispatch_abort(dp, &sh);
+        return false;
+    }
+
+    ident_t dst = sh_desc(sh, (struct pl_shader_desc) {
+        .binding.object = dst_tex,
+        .desc = {
+            .name   = "dst",
+            .type   = PL_DESC_STORAGE_IMG,
+            .access = PL_DESC_ACCESS_WRITEONLY,
+        },
+    });
+
+    ident_t src = sh_desc(sh, (struct pl_shader_desc) {
+        .desc = {
+            .name = "src",
+            .type = PL_DESC_SAMPLED_TEX,
+        },
+        .binding = {
+            .object = src_tex,
+            .address_mode = PL_TEX_ADDRESS_CLAMP,
+            .sample_mode = blits[0].sample_mode,
+        }
+    });
+
+    // Pass the rects as (dynamic) variables, so that the shader only depends
+    // on the textures and the number of blits
+    ident_t dst_rc = sh_var(sh, (struct pl_shader_var) {
+        .data = dst_rects,
+        .dynamic = true,
+        .var = {
+            .name = "dst_rects",
+            .type = PL_VAR_SINT,
+            .dim_v = 4,
+            .dim_m = 1,
+            .dim_a = size,
+        },
+    });
+
+    ident_t src_rc = sh_var(sh, (struct pl_shader_var) {
+        .data = src_rects,
+        .dynamic = true,
+        .var = {
+            .name = "src_rects",
+            .type = PL_VAR_FLOAT,
+            .dim_v = 4,
+            .dim_m = 1,
+            .dim_a = size,
+        },
+    });
+
+    GLSL("ivec3 id = ivec3(gl_GlobalInvocationID);      \n"
+         "ivec4 drc = "$"[id.z];                         \n"
+         "ivec2 dst_pos = drc.xy + id.xy;                \n"
+         "if (any(greaterThanEqual(dst_pos, drc.zw)))    \n"
+         "    return;                                    \n"
+         "vec4 srect = "$"[id.z];                        \n"
+         "vec2 fpos = (vec2(id.xy) + vec2(0.5)) / vec2(drc.zw - drc.xy); \n"
+         "vec2 src_pos = mix(srect.xy, srect.zw, fpos);  \n"
+         "imageStore("$", dst_pos, textureLod("$", src_pos, 0.0)); \n",
+         dst_rc, src_rc, dst, src);
+
+    return pl_dispatch_compute(dp, pl_dispatch_compute_params(
+        .shader = &sh,
+        .dispatch_size = {
+            PL_DIV_UP(max_w, bs),
+            PL_DIV_UP(max_h, bs),
+            num,
+        },
+    ));
+}
+
 void pl_tex_blit_raster(pl_gpu gpu, const struct pl_tex_blit_params *params)
 {
     enum pl_fmt_type src_type = params->src->params.format->type;
@@ -1148,47 +1464,72 @@ error:
     return false;
 }
 
+// Uploads `data` to a drawable buffer, suballocated from the transient ring
+// if possible. Either `*ring` or `*buf` must be released by the caller.
+static bool vbo_upload(pl_gpu gpu, const void *data, size_t size,
+                       struct pl_gpu_ring_alloc *ring, pl_buf *buf,
+                       pl_buf *out_buf, size_t *out_offset)
+{
+    if (pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, size, 16, ring)) {
+        if (ring->buf->params.drawable) {
+            pl_memcpy_stream(ring->data, data, size);
+            *out_buf = ring->buf;
+            *out_offset = ring->offset;
+            return true;
+        }
+        pl_gpu_ring_done(gpu, ring);
+    }
+
+    *buf = pl_buf_create(gpu, pl_buf_params(
+        .size = size,
+        .initial_data = data,
+        .drawable = true,
+    ));
+
+    *out_buf = *buf;
+    *out_offset = 0;
+    return *buf;
+}
+
 void pl_pass_run_vbo(pl_gpu gpu, const struct pl_pass_run_params *params)
 {
     if (!params->vertex_data && !params->index_data)
         return pl_pass_run(gpu, params);
 
     struct pl_pass_run_params newparams = *params;
+    struct pl_gpu_ring_alloc vert_ring = {0}, index_ring = {0};
     pl_buf vert = NULL, index = NULL;
 
     if (params->vertex_data) {
-        vert = pl_buf_create(gpu, pl_buf_params(
-            .size = pl_vertex_buf_size(params),
-            .initial_data = params->vertex_data,
-            .drawable = true,
-        ));
-
-        if (!vert) {
+        if (!vbo_upload(gpu, params->vertex_data, pl_vertex_buf_size(params),
+                        &vert_ring, &vert, &newparams.vertex_buf,
+                        &newparams.buf_offset))
+        {
             PL_ERR(gpu, "Failed allocating vertex buffer!");
-            return;
+            goto done;
         }
 
-        newparams.vertex_buf = vert;
         newparams.vertex_data = NULL;
     }
 
     if (params->index_data) {
-        index = pl_buf_create(gpu, pl_buf_params(
-            .size = pl_index_buf_size(params),
-            .initial_data = params->index_data,
-            .drawable = true,
-        ));
-
-        if (!index) {
+        if (!vbo_upload(gpu, params->index_data, pl_index_buf_size(params),
+                        &index_ring, &index, &newparams.index_buf,
+                        &newparams.index_offset))
+        {
             PL_ERR(gpu, "Failed allocating index buffer!");
-            return;
+            goto done;
         }
 
-        newparams.index_buf = index;
         newparams.index_data = NULL;
     }
 
     pl_pass_run(gpu, &newparams);
+    // fall through
+
+done:
+    pl_gpu_ring_done(gpu, &vert_ring);
+    pl_gpu_ring_done(gpu, &index_ring);
     pl_buf_destroy(gpu, &vert);
     pl_buf_destroy(gpu, &index);
 }
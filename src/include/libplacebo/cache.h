@@ -51,11 +51,24 @@ struct pl_cache_params {
 
     // Size limits. If 0, no limit is imposed.
     //
+    // When `max_total_size` is exceeded, the least recently used objects are
+    // evicted first. Since `pl_cache_get` removes objects from the cache, an
+    // object re-inserted after lookup counts as freshly used.
+    //
     // Note: libplacebo will never detect or invalidate stale cache entries, so
     // setting an upper size limit is strongly recommended
     size_t max_object_size;
     size_t max_total_size;
 
+    // If nonzero, split the cache into this many independently locked shards
+    // (rounded up to the nearest power of two, up to a maximum of 64), each
+    // responsible for a subset of keys. This reduces lock contention when
+    // many threads access the same `pl_cache` concurrently.
+    //
+    // Note: Each shard receives an equal share of `max_total_size`, and evicts
+    // objects independently. `max_object_size` is clamped to the shard size.
+    int num_shards;
+
     // Optional external callback to call after a cached object is modified
     // (including deletion and (re-)insertion). Note that this is not called on
     // objects which are merely pruned from the cache due to `max_total_size`,
@@ -77,6 +90,27 @@ struct pl_cache_params {
 
     // External context for insert/lookup.
     void *priv;
+
+    // If true, objects loaded by `pl_cache_load_ex` and friends are only
+    // checked against their stored checksum on their first `pl_cache_get`,
+    // rather than up-front. Corrupt objects are then discarded on lookup
+    // (treated as cache misses), instead of aborting the rest of the load.
+    //
+    // This is most useful in combination with `pl_cache_load_mmap`, since it
+    // avoids having to page in the entire file at startup.
+    bool lazy_verify;
+
+    // If true, `pl_cache_save_ex` and friends compress objects (with zstd),
+    // wherever this meaningfully reduces their size. This helps in particular
+    // for large LUTs. Compressed objects are decompressed again while loading
+    // (even by `pl_cache_load_static`, which then can't avoid a copy), so this
+    // does not affect the in-memory size of the cache.
+    //
+    // Note: Has no effect unless libplacebo was built with zstd support
+    // (`PL_HAVE_ZSTD`). Compressed caches can only be loaded by such builds,
+    // and are skipped by all others.
+    // Note: Journals (`pl_cache_journal_open`) are never compressed.
+    bool compress;
 };
 
 #define pl_cache_params(...) (&(struct pl_cache_params) { __VA_ARGS__ })
@@ -124,6 +158,8 @@ PL_API int pl_cache_save_ex(pl_cache cache,
 // a negative number on serious error (e.g. corrupt header)
 //
 // Note: This does not trigger the `update` callback.
+// Note: The checksums of large caches are verified on multiple threads, see
+// also `pl_cache_params.lazy_verify`.
 PL_API int pl_cache_load_ex(pl_cache cache,
                             bool (*read)(void *priv, size_t size, void *ptr),
                             void *priv);
@@ -139,6 +175,50 @@ PL_API size_t pl_cache_save(pl_cache cache, uint8_t *data, size_t size);
 // not avoid a copy.
 PL_API int pl_cache_load(pl_cache cache, const uint8_t *data, size_t size);
 
+// Zero-copy variant of `pl_cache_load`, which inserts objects pointing
+// directly into `data` instead of copying them. Objects are only copied if
+// they are subsequently modified and re-inserted by their user.
+//
+// Note: `data` must remain valid and unmodified for the lifetime of `cache`,
+// including any objects retrieved from it with `pl_cache_get`.
+PL_API int pl_cache_load_static(pl_cache cache, const uint8_t *data, size_t size);
+
+// Maps the file at `path` (previously written by `pl_cache_save_file`) into
+// memory and loads it using `pl_cache_load_static`. The mapping is retained
+// until `pl_cache_destroy`, so this is essentially free at startup, with
+// objects paged in on demand. Returns the number of objects loaded, or a
+// negative number on error (e.g. file not found).
+//
+// Note: The file should not be modified while it is mapped. Objects returned
+// by `pl_cache_get` may reference the mapping, and must not be used after
+// `pl_cache_destroy`.
+PL_API int pl_cache_load_mmap(pl_cache cache, const char *path);
+
+// --- Append-only journal
+
+// Attaches an append-only journal, stored at `path`, to the cache. Any
+// existing contents of `path` are first loaded into the cache, after which
+// the file is rewritten (compacted) to reflect the full current state of the
+// cache. From then on, every successful `pl_cache_try_set` is immediately
+// appended to the file, with deletions recorded as tombstones. This makes
+// the cost of persisting proportional to the amount of new data, and ensures
+// newly added objects survive a crash. Objects evicted due to size limits are
+// not recorded, and are subject to the same limits again when reloaded.
+//
+// Returns whether successful. Replaces any previously attached journal.
+//
+// Note: Journals can also be loaded using `pl_cache_load_file` etc., in which
+// case the number of loaded objects includes any later deleted by tombstones.
+PL_API bool pl_cache_journal_open(pl_cache cache, const char *path);
+
+// Rewrites the journal to contain only the current contents of the cache,
+// dropping out-of-date entries and tombstones. Returns whether successful.
+PL_API bool pl_cache_journal_compact(pl_cache cache);
+
+// Detaches and closes the journal, if any. This is done automatically by
+// `pl_cache_destroy`.
+PL_API void pl_cache_journal_close(pl_cache cache);
+
 // Writes/loads data to/from a FILE stream at the current position.
 #define pl_cache_save_file(c, file) pl_cache_save_ex(c, pl_write_file_cb, file)
 #define pl_cache_load_file(c, file) pl_cache_load_ex(c, pl_read_file_cb,  file)
@@ -680,6 +680,63 @@ PL_API pl_matrix3x3 pl_get_cone_matrix(const struct pl_cone_params *params,
 PL_API pl_transform3x3 pl_color_repr_decode(struct pl_color_repr *repr,
                                             const struct pl_color_adjustment *params);
 
+// Component type of the source planes for `pl_color_convert_cpu`.
+enum pl_color_cpu_type {
+    PL_COLOR_CPU_FLOAT = 0, // 32-bit float, normalized like a sampled texture
+    PL_COLOR_CPU_U8,        // 8-bit unsigned integer
+    PL_COLOR_CPU_U16,       // 16-bit unsigned integer, in host byte order
+    PL_COLOR_CPU_TYPE_COUNT,
+};
+
+struct pl_color_cpu_params {
+    // Source planes, one per channel, in the order expected by
+    // `pl_color_repr_decode` (e.g. Y, Cb, Cr). All planes must have the full
+    // image dimensions, i.e. subsampled chroma must be upscaled by the caller.
+    const void *src[3];
+    size_t src_stride[3]; // in bytes
+    enum pl_color_cpu_type src_type;
+
+    // Description of the source pixels. For integer types,
+    // `repr.bits.sample_depth` defaults to the size of the type, so e.g.
+    // 10-bit content in the low bits of 16-bit words would set
+    // `color_depth = 10` only. Unknown fields of `color` are inferred.
+    struct pl_color_repr repr;
+    struct pl_color_space color;
+    const struct pl_color_adjustment *adjust; // optional
+
+    // Destination planes, receiving linear light R, G, B as 32-bit floats,
+    // scaled relative to PL_COLOR_SDR_WHITE (like `pl_shader_linearize`). For
+    // PL_COLOR_CPU_FLOAT, these may alias the source planes.
+    float *dst[3];
+    size_t dst_stride[3]; // in bytes
+
+    int width, height;
+
+    // If set, the output is converted to these primaries using
+    // `pl_get_color_mapping_matrix` with the given intent. Defaults to the
+    // source primaries.
+    enum pl_color_primaries dst_primaries;
+    enum pl_rendering_intent intent;
+
+    // If set, applies `pl_get_cone_matrix` (in the output primaries) to
+    // simulate a color vision deficiency.
+    const struct pl_cone_params *cones;
+};
+
+#define pl_color_cpu_params(...) (&(struct pl_color_cpu_params) { __VA_ARGS__ })
+
+// Decodes and linearizes a planar image on the CPU, as a fallback for
+// applications without a GPU (e.g. for thumbnails or histogram analysis).
+// Rows are distributed over an internal thread pool, and processed using
+// SIMD where available. Blocks until the whole image has been converted.
+//
+// Transfer functions are evaluated through a 1024-entry LUT, so the results
+// differ from the exact curves by up to ~1e-5 of the nominal peak, and signal
+// values outside [0, 1] (e.g. super-whites) are clipped. Returns false for color
+// systems that require non-linear decoding (BT.2020-CL, ICtCp, XYZ and
+// Dolby Vision), which are not supported.
+PL_API bool pl_color_convert_cpu(const struct pl_color_cpu_params *params);
+
 // Common struct to describe an ICC profile
 struct pl_icc_profile {
     // Points to the in-memory representation of the ICC profile. This is
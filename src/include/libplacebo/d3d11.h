@@ -119,6 +119,23 @@ struct pl_d3d11_params {
     // swapchains (except for waitable swapchains.) See the documentation for
     // `pl_swapchain_latency` for more information.
     int max_frame_latency;
+
+    // If true, runs the performance-oriented SPIR-V optimization passes on
+    // all generated shaders before cross-compiling them to HLSL. See the
+    // identically named field in `pl_vulkan_params` for more information.
+    bool spirv_opt_performance;
+
+    // If true, `pl_pass_run` records all of its state setup, draws and
+    // dispatches into a deferred context owned by this `pl_gpu`, and the
+    // resulting command list is only executed on the device's immediate
+    // context when needed, e.g. before transfers or on `pl_gpu_flush`. This
+    // allows multiple `pl_d3d11` instances sharing the same `device`, each
+    // driven from its own thread, to encode their passes concurrently. The
+    // immediate context gets multithread protection enabled in this case.
+    //
+    // Note: API users accessing the immediate context directly must call
+    // `pl_gpu_flush` first, to ensure all recorded passes have been executed.
+    bool deferred_context;
 };
 
 // Default/recommended parameters. Should generally be safe and efficient.
@@ -188,6 +205,19 @@ struct pl_d3d11_swapchain_params {
     // may fail if an unsupported combination is requested.
     UINT flags;
 
+    // If set, libplacebo will create a flip-model swapchain with the
+    // DXGI_SWAP_CHAIN_FLAG_FRAME_LATENCY_WAITABLE_OBJECT flag (requires DXGI
+    // 1.3, Windows 8.1 and up). `pl_swapchain_start_frame` will then block
+    // until DXGI is ready to accept a new frame, so that rendering starts as
+    // late as possible. This reduces the input-to-photon latency compared to
+    // queueing frames up to `pl_d3d11_params.max_frame_latency` in advance.
+    bool waitable;
+
+    // The maximum number of frames queued for presentation on a waitable
+    // swapchain, as set by IDXGISwapChain2::SetMaximumFrameLatency. Defaults
+    // to 1 if unset. Ignored if `waitable` is false.
+    int max_frame_latency;
+
     // --- Swapchain usage behavior options
 
     // Disable using a 10-bit swapchain format for SDR output
@@ -62,6 +62,10 @@ struct pl_dispatch_info {
     uint64_t last;
     uint64_t peak;
     uint64_t average;
+
+    // If true, this shader was not actually executed, because its pass is
+    // still being compiled in the background. See `pl_dispatch_async`.
+    bool skipped;
 };
 
 // Helper function to make a copy of `pl_dispatch_info`, while overriding
@@ -81,6 +85,79 @@ PL_API void pl_dispatch_callback(pl_dispatch dp, void *priv,
                                  void (*cb)(void *priv,
                                  const struct pl_dispatch_info *));
 
+// Enable or disable asynchronous compilation of new passes. When enabled,
+// shaders requiring a new `pl_pass` to be created are compiled on a
+// background thread, and any dispatch of such a shader is skipped (while
+// still returning success, but leaving the target untouched) until the
+// compilation completes. Skipped dispatches are reported to the dispatch
+// callback with `pl_dispatch_info.skipped` set. This trades frame stalls on
+// shader cache misses for dropped/incomplete output in the meantime.
+//
+// Note: This has no effect unless `pl_gpu_limits.thread_safe` is set, or the
+// driver compiles shaders in the background by itself (e.g. OpenGL with
+// GL_KHR_parallel_shader_compile).
+PL_API void pl_dispatch_async(pl_dispatch dp, bool async);
+
+// Enable or disable auto-tuning of compute shader workgroup sizes. When
+// enabled, compute shaders that work with any group size (i.e. those that
+// don't rely on a particular size for their shared memory layout) are
+// dispatched using a number of different candidate sizes the first few times
+// they are used, and the fastest one (as measured by their GPU timers) is
+// used from then on. Results are stored in the `pl_gpu`'s `pl_cache`, keyed
+// by the shader and device, so the tuning only needs to happen once.
+//
+// Note: Dispatches with a user-provided `timer` or explicit `dispatch_size`
+// are never tuned. This has no effect on GPUs without timer support, other
+// than compiling a few redundant passes.
+PL_API void pl_dispatch_autotune(pl_dispatch dp, bool enable);
+
+struct pl_dispatch_cache_params {
+    // Maximum number of compiled passes to keep around. Defaults to 100.
+    int max_passes;
+
+    // Maximum (estimated) amount of driver memory, in bytes, to spend on
+    // compiled passes. Defaults to no limit.
+    size_t max_memory;
+};
+
+#define pl_dispatch_cache_params(...) (&(struct pl_dispatch_cache_params) { __VA_ARGS__ })
+
+// Configure the limits of the internal pass cache. Whenever either limit is
+// exceeded, `pl_dispatch_reset_frame` destroys the least recently used
+// passes. Passes used within the last few frames are never evicted, so these
+// limits may be exceeded temporarily.
+//
+// Note: Evicted passes need to be recompiled when next used. If a `pl_cache`
+// is attached to the `pl_gpu` (see `pl_gpu_set_cache`), their compiled
+// programs remain stored there, making this significantly cheaper.
+PL_API void pl_dispatch_set_cache_params(pl_dispatch dp,
+                                         const struct pl_dispatch_cache_params *params);
+
+// Starts recording a trace of all shader executions on this dispatch object,
+// discarding any previously recorded trace. Each executed pass records the
+// CPU time spent submitting it, and (once available) the GPU execution time
+// measured by its internal timer, as well as the shader description, output
+// size and compute dispatch dimensions.
+//
+// Note: This has some overhead of its own, and is intended for debugging or
+// profiling only. Recording stops automatically after 2^20 events.
+PL_API void pl_dispatch_trace_begin(pl_dispatch dp);
+
+// Stops recording, and writes out the recorded trace as a JSON document in the
+// Chrome "Trace Event Format", which can be loaded by e.g. Perfetto
+// (ui.perfetto.dev) or chrome://tracing. The data is passed to `write`, in
+// one or more chunks, e.g. `pl_write_file_cb` from <libplacebo/cache.h>.
+//
+// Note: GPU timers only measure durations, and results arrive with some
+// delay. The GPU timeline is therefore reconstructed by laying out passes
+// back-to-back, starting no earlier than their submission. Passes whose
+// results were not yet available (or which were dispatched with a
+// user-provided `timer`) only have a CPU event.
+PL_API void pl_dispatch_trace_end(pl_dispatch dp,
+                                  void (*write)(void *priv, size_t size,
+                                                const void *ptr),
+                                  void *priv);
+
 struct pl_dispatch_params {
     // The shader to execute. The pl_dispatch will take over ownership
     // of this shader, and return it back to the internal pool.
@@ -45,6 +45,23 @@ struct pl_gpu_dummy_params {
     // `glGet` queries etc.
     struct pl_glsl_version glsl;
     struct pl_gpu_limits limits;
+
+    // If set, the dummy GPU runs in capture mode: creating passes succeeds
+    // (without compiling anything), and every object creation/destruction,
+    // transfer, pass execution and flush performed on this GPU is serialized
+    // into a capture stream, which is handed to this callback in order, one
+    // chunk at a time. The concatenation of all chunks can be replayed onto
+    // a real GPU with `pl_gpu_dummy_replay`, e.g. to profile backend and
+    // driver overhead in isolation from the code generating the workload.
+    //
+    // For a faithful replay, `glsl` and `limits` should be copied from the
+    // GPU the stream is intended to be replayed on. Persistently mapped
+    // buffers are not available in capture mode (`limits.max_mapped_size` is
+    // forced to 0), since writes through them can't be observed. The stream
+    // uses host byte order, and is only guaranteed to be replayable by the
+    // same version of libplacebo.
+    void (*capture)(void *priv, const void *data, size_t size);
+    void *capture_priv;
 };
 
 #define PL_GPU_DUMMY_DEFAULTS                                           \
@@ -75,6 +92,7 @@ struct pl_gpu_dummy_params {
         .max_tex_1d_dim     = UINT32_MAX,                               \
         .max_tex_2d_dim     = UINT32_MAX,                               \
         .max_tex_3d_dim     = UINT32_MAX,                               \
+        .blittable_1d_3d    = true,                                     \
         .buf_transfer       = true,                                     \
         .align_tex_xfer_pitch = 1,                                      \
         .align_tex_xfer_offset = 1,                                     \
@@ -93,12 +111,27 @@ PL_API extern const struct pl_gpu_dummy_params pl_gpu_dummy_default_params;
 // Create a dummy GPU context based on the given parameters. This GPU will have
 // a format for each host-representable type (i.e. intN_t, floats and doubles),
 // in the canonical channel order RGBA. These formats will have every possible
-// capability activated, respectively.
+// capability activated, respectively. Texture clears and blits (including
+// scaling and conversion between formats) are executed on the CPU, but
+// shaders are never executed.
 //
 // If `params` is left as NULL, it defaults to `&pl_gpu_dummy_params`.
 PL_API pl_gpu pl_gpu_dummy_create(pl_log log, const struct pl_gpu_dummy_params *params);
 PL_API void pl_gpu_dummy_destroy(pl_gpu *gpu);
 
+// Replays a capture stream (see `pl_gpu_dummy_params.capture`) onto `gpu`,
+// which may be any kind of GPU, including another dummy GPU. The stream is
+// replayed `loops` times in total. Objects are only created on the first
+// iteration and kept alive until the last one, so that later iterations
+// measure the steady-state cost of transfers and pass executions. Downloads
+// are performed into scratch memory. All recreated objects are destroyed
+// before returning.
+//
+// Returns false if the stream is malformed, or if any object could not be
+// recreated on `gpu` (e.g. due to a missing format).
+PL_API bool pl_gpu_dummy_replay(pl_gpu gpu, const void *data, size_t size,
+                                int loops);
+
 // Back-doors into the `pl_tex` and `pl_buf` representations. These allow you
 // to access the raw data backing this object. Textures are always laid out in
 // a tightly packed manner.
@@ -82,6 +82,12 @@ struct pl_glsl_version {
     // - GL_KHR_shader_subgroup_shuffle
     uint32_t subgroup_size;
 
+    // If nonzero, compute passes may request a specific (power of two)
+    // subgroup size within this range, as well as fully populated subgroups.
+    // See `pl_pass_params.subgroup_size` and `pl_pass_params.full_subgroups`.
+    uint32_t min_subgroup_size;
+    uint32_t max_subgroup_size;
+
     // Miscellaneous shader limits
     int16_t min_gather_offset;  // minimum `textureGatherOffset` offset
     int16_t max_gather_offset;  // maximum `textureGatherOffset` offset
@@ -688,6 +694,13 @@ struct pl_tex_params {
     // Note: For `blit_src`, `blit_dst`, the texture must either be
     // 2-dimensional or `pl_gpu_limits.blittable_1d_3d` must be set.
 
+    // Hint that the contents of this texture never need to outlive the pass
+    // rendering to it, e.g. for scratch attachments. If the texture is only
+    // `renderable` (and not shared with external APIs), this allows the
+    // backend to back it by lazily allocated memory, which tiled GPUs can
+    // keep entirely in on-chip memory. Ignored otherwise.
+    bool transient;
+
     // At most one of `export_handle` and `import_handle` can be set for a
     // texture.
 
@@ -796,6 +809,19 @@ PL_API void pl_tex_destroy(pl_gpu gpu, pl_tex *tex);
 // up being recreated.
 PL_API bool pl_tex_recreate(pl_gpu gpu, pl_tex *tex, const struct pl_tex_params *params);
 
+// Like `pl_tex_recreate`, but allocates the texture with some headroom, by
+// rounding its dimensions up to a coarse size bucket (at most 25% larger).
+// The existing texture is kept as long as it is large enough to contain the
+// requested size, and not more than one bucket larger, so that e.g. window
+// resizes or streams switching between resolutions do not constantly
+// reallocate it. The resulting texture may thus be larger than requested.
+// Callers must limit all rendering and sampling to the requested sub-rect,
+// e.g. via `pl_frame.crop`, and keep in mind that filtered samples near its
+// edges may read from the (undefined) remainder of the texture.
+// (Since API v419)
+PL_API bool pl_tex_recreate_headroom(pl_gpu gpu, pl_tex *tex,
+                                     const struct pl_tex_params *params);
+
 // Invalidates the contents of a texture. After this, the contents are fully
 // undefined.
 PL_API void pl_tex_invalidate(pl_gpu gpu, pl_tex tex);
@@ -844,6 +870,15 @@ struct pl_tex_blit_params {
 // Copy a sub-rectangle from one texture to another.
 PL_API void pl_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params);
 
+// Perform multiple blits at once. This is equivalent to calling `pl_tex_blit`
+// on each element of `params` in order, except that runs of consecutive blits
+// between the same pair of 2D textures (with the same `sample_mode`) and with
+// non-overlapping `dst_rc` may be merged into a single compute dispatch, if
+// `src` is sampleable and `dst` is storable. This is much cheaper than many
+// individual blits, e.g. when packing lots of small images into an atlas.
+PL_API void pl_tex_blit_batch(pl_gpu gpu, const struct pl_tex_blit_params *params,
+                              int num_blits);
+
 // Structure describing a texture transfer operation.
 struct pl_tex_transfer_params {
     // Texture to transfer to/from. Depending on the type of the operation,
@@ -1234,6 +1269,19 @@ struct pl_pass_params {
     // Specifying `blend_params` requires `load_target` to be true.
     bool load_target;
 
+    // --- type==PL_PASS_COMPUTE only
+
+    // If nonzero, the compute shader is required to run with exactly this
+    // subgroup size, which overrides `glsl.subgroup_size`. Must be a power of
+    // two between `glsl.min_subgroup_size` and `glsl.max_subgroup_size`.
+    uint32_t subgroup_size;
+
+    // If true, all subgroups are required to be fully populated. The first
+    // dimension of the work group size must then be a multiple of
+    // `subgroup_size`, or of `glsl.max_subgroup_size` if left unset. Requires
+    // `glsl.max_subgroup_size`.
+    bool full_subgroups;
+
     // --- Deprecated / removed fields.
     PL_DEPRECATED_IN(v6.322) const uint8_t *cached_program; // Non-functional
     PL_DEPRECATED_IN(v6.322) size_t cached_program_len;
@@ -1399,6 +1447,32 @@ PL_API void pl_gpu_finish(pl_gpu gpu);
 // including all associated resources, via the appropriate mechanism.
 PL_API bool pl_gpu_is_failed(pl_gpu gpu);
 
+// Memory usage and budget of a single memory heap, in bytes.
+struct pl_gpu_heap_budget {
+    size_t size;        // total size of the heap
+    size_t usage;       // currently allocated from this heap (by this process)
+    size_t budget;      // estimated amount the process can allocate in total
+    bool device_local;  // heap is located in VRAM
+};
+
+#define PL_GPU_MAX_HEAPS 16
+
+struct pl_gpu_memory_budget {
+    struct pl_gpu_heap_budget heaps[PL_GPU_MAX_HEAPS];
+    int num_heaps;
+
+    // True if the usage of any device-local heap is close to its budget. In
+    // this case, libplacebo releases internally cached resources (e.g. unused
+    // slabs, intermediate FBOs and shaders) more eagerly, and users sharing
+    // the GPU should consider doing the same.
+    bool pressure;
+};
+
+// Queries the current memory budget of the GPU. Returns false (and zeroes
+// `out`) if this is not supported, e.g. because VK_EXT_memory_budget is
+// unavailable.
+PL_API bool pl_gpu_get_memory_budget(pl_gpu gpu, struct pl_gpu_memory_budget *out);
+
 PL_API_END
 
 #endif // LIBPLACEBO_GPU_H_
@@ -48,6 +48,18 @@ struct pl_log_params {
     // in increased CPU usage as it may enable extra debug paths based on the
     // configured log level.
     enum pl_log_level log_level;
+
+    // If true, `log_cb` is invoked from a dedicated background thread, rather
+    // than synchronously from the thread generating the message. Messages are
+    // formatted and queued without waiting on the callback, so a slow log
+    // callback does not stall the rest of libplacebo. This is mostly useful
+    // in combination with high log levels, e.g. PL_LOG_TRACE.
+    //
+    // Messages at PL_LOG_WARN or higher severity still block until they have
+    // been delivered. Less severe messages are dropped (with a warning) if
+    // the queue grows too large. `pl_log_update` and `pl_log_destroy` wait
+    // for all queued messages to be delivered first.
+    bool async;
 };
 
 #define pl_log_params(...) (&(struct pl_log_params) { __VA_ARGS__ })
@@ -90,6 +90,19 @@ struct pl_opengl_params {
     bool (*make_current)(void *priv);
     void (*release_current)(void *priv);
     void *priv;
+
+    // Optional callbacks to bind/release a secondary OpenGL context, which
+    // must share objects with the main context (e.g. created via EGL/WGL
+    // share lists). If specified, libplacebo spawns an internal worker thread
+    // which keeps this context bound for the lifetime of the `pl_gpu`, and
+    // offloads asynchronous texture uploads (`pl_tex_upload` from host
+    // memory with a `callback`) to it. Cross-context sync objects make the
+    // results visible to the main context. Requires GL 3.2 / GLES 3.0.
+    //
+    // The secondary context must not be made current on any other thread.
+    bool (*upload_make_current)(void *upload_priv);
+    void (*upload_release_current)(void *upload_priv);
+    void *upload_priv;
 };
 
 // Default/recommended parameters
@@ -145,6 +158,14 @@ struct pl_opengl_swapchain_params {
     // even 1 can reduce latency (at the cost of throughput).
     int max_swapchain_depth;
 
+    // Optional. Set this to a wrapper around the platform-specific function
+    // to set the swap interval, e.g. glXSwapIntervalEXT or wglSwapIntervalEXT.
+    // This will be called internally by `pl_swapchain_adaptive_vsync`, with
+    // the context current, and an interval of -1 to enable adaptive vsync
+    // (requiring GLX/WGL_EXT_swap_control_tear) or 1 to disable it again.
+    // Should return false if the requested interval is not supported.
+    bool (*swap_interval)(void *priv, int interval);
+
     // Arbitrary user pointer that gets passed to `swap_buffers` etc.
     void *priv;
 };
@@ -28,6 +28,7 @@
 #include <libplacebo/shaders/film_grain.h>
 #include <libplacebo/shaders/icc.h>
 #include <libplacebo/shaders/lut.h>
+#include <libplacebo/shaders/motion.h>
 #include <libplacebo/shaders/sampling.h>
 #include <libplacebo/shaders/custom.h>
 #include <libplacebo/swapchain.h>
@@ -52,6 +53,7 @@ enum pl_render_error {
     PL_RENDER_ERR_ERROR_DIFFUSION   = 1 << 9,
     PL_RENDER_ERR_HOOKS             = 1 << 10,
     PL_RENDER_ERR_CONTRAST_RECOVERY = 1 << 11,
+    PL_RENDER_ERR_MOTION            = 1 << 12,
 };
 
 // Struct describing current renderer state, including internal processing errors,
@@ -103,9 +105,30 @@ enum pl_render_stage {
     PL_RENDER_STAGE_COUNT,
 };
 
+// Coarse classification of the work performed by an individual pass. Since
+// the renderer fuses as many steps as possible into a single shader, a pass
+// may correspond to several of these at once.
+enum pl_render_op {
+    PL_RENDER_OP_READ,      // sampling / merging / deinterlacing source planes
+    PL_RENDER_OP_DEBAND,    // debanding (`deband_params`)
+    PL_RENDER_OP_GRAIN,     // AV1/H.274 film grain synthesis
+    PL_RENDER_OP_HOOK,      // user hooks / custom shaders (`hooks`)
+    PL_RENDER_OP_SCALE,     // plane scaling and the main scaler
+    PL_RENDER_OP_COLOR,     // color conversion, tone mapping, peak detection
+    PL_RENDER_OP_DITHER,    // dithering / error diffusion
+    PL_RENDER_OP_OUTPUT,    // final output to the target planes
+    PL_RENDER_OP_OVERLAY,   // overlay drawing
+    PL_RENDER_OP_MIX,       // frame mixing (only for pl_render_image_mix)
+    PL_RENDER_OP_COUNT,
+};
+
+// Returns a human-readable name for a `pl_render_op`, e.g. "scale".
+PL_API const char *pl_render_op_name(enum pl_render_op op);
+
 struct pl_render_info {
     const struct pl_dispatch_info *pass;    // information about the shader
     enum pl_render_stage stage;             // the associated render stage
+    unsigned ops;                           // bitmask of (1 << pl_render_op)
 
     // This specifies the chronological index of this pass within the frame and
     // stage (starting at `index == 0`).
@@ -114,6 +137,10 @@ struct pl_render_info {
     // For PL_RENDER_STAGE_BLEND, this specifies the number of frames
     // being blended (since that results in a different shader).
     int count;
+
+    // The format of the intermediate FBO this pass renders to, or NULL if
+    // the pass renders directly to the target (or does not render at all).
+    pl_fmt fbo_format;
 };
 
 // Represents the options used for rendering. These affect the quality of
@@ -157,6 +184,19 @@ struct pl_render_params {
     // `skip_caching_single_frame`)
     const struct pl_filter_config *frame_mixer;
 
+    // Enables motion-compensated frame interpolation (when using
+    // `pl_render_image_mix` with a `frame_mixer`). If set, the two frames
+    // straddling the current vsync are motion estimated against each other
+    // (by block matching on a luma pyramid), and warped along the resulting
+    // motion field before being blended according to their relative distance
+    // from the vsync. All other frames, and the `frame_mixer` weights, are
+    // ignored in this case. Regions without a reliable match fall back to
+    // plain blending. If NULL, motion compensation is disabled.
+    //
+    // Note: This requires a renderable 16-bit floating point RGBA format, and
+    // transparently falls back to plain frame mixing otherwise.
+    const struct pl_motion_params *motion_params;
+
     // Configures the settings used to deband source textures. Leaving this as
     // NULL disables debanding.
     //
@@ -274,6 +314,17 @@ struct pl_render_params {
     // Significantly speeds up downscaling with high downscaling ratios.
     bool skip_anti_aliasing;
 
+    // When downscaling by more than a factor of 2, first reduces the image to
+    // within 2x of the target size using a cascade of cheap 2x2 box filters,
+    // and only then applies the configured `downscaler`. This bounds the cost
+    // of downscaling regardless of the ratio (e.g. for thumbnails), at the
+    // cost of slightly softer results compared to a single wide filter.
+    //
+    // This also applies when downscaling without anti-aliasing (e.g. with
+    // `skip_anti_aliasing` or no `downscaler`), in which case the result is
+    // similar to trilinear sampling from a mipmap chain.
+    bool multistage_downscaling;
+
     // Normally, when the size of the `target` used with `pl_render_image_mix`
     // changes, or the render parameters are updated, the internal cache of
     // mixed frames must be discarded in order to re-render all required
@@ -283,6 +334,25 @@ struct pl_render_params {
     // resize, but should make it much more smooth.
     bool preserve_mixing_cache;
 
+    // Normally, frames that are no longer needed by `pl_render_image_mix` are
+    // evicted from the internal cache of mixed frames immediately. If this is
+    // nonzero, these frames are instead retained (in least recently used
+    // order) until the total size of the cache exceeds this many MiB, so that
+    // short seeks or A/B comparisons can reuse previously rendered frames by
+    // their signature, skipping the per-frame rendering pipeline. Retained
+    // frames are subject to the usual validity checks before reuse. 0
+    // disables the history.
+    int frame_cache_memory;
+
+    // Limits the number of frames sampled by a single frame mixing pass in
+    // `pl_render_image_mix`. If more frames than this contribute to the
+    // output, only the ones with the largest weights are kept (always
+    // including the nearest frame), and the weights renormalized. This
+    // bounds the bandwidth used by wide frame mixers, especially at high
+    // source/display frame rate ratios, at a small loss of accuracy. 0 means
+    // no limit beyond the internal maximum (currently 16).
+    int max_mix_frames;
+
     // --- Performance tuning / debugging options
     // These may affect performance or may make debugging problems easier,
     // but shouldn't have any effect on the quality.
@@ -293,11 +363,32 @@ struct pl_render_params {
     // it will still read from, if they happen to already be cached)
     bool skip_caching_single_frame;
 
+    // If enabled, `pl_render_image_mix` keeps a copy of its final output, and
+    // blits it to the target instead of re-running the frame mixing and
+    // output passes if the frame signatures, mixing weights, parameters and
+    // target configuration are unchanged from the previous call. This is
+    // useful when the display rate is much higher than the content rate
+    // (e.g. 24 Hz content on a 144 Hz display), at the cost of an extra blit
+    // per freshly rendered output. Only takes effect for single-plane,
+    // blittable targets without overlays, and is bypassed for temporal
+    // dithering, custom hooks, `blend_params` and `skip_target_clearing`.
+    bool reuse_mixed_output;
+
     // Disables linearization / sigmoidization before scaling. This might be
     // useful when tracking down unexpected image artifacts or excessing
     // ringing, but it shouldn't normally be necessary.
     bool disable_linear_scaling;
 
+    // If true, and the image and target color spaces are compatible (same
+    // primaries and transfer function, and the same luminance range after
+    // inferring HDR metadata), skip color conversion entirely and also scale
+    // the image in its native encoding rather than in linear light. This
+    // avoids evaluating e.g. the PQ EOTF and OETF for every pixel, at the
+    // cost of slightly different scaling results for SDR content. Custom
+    // hooks requesting linear light are still honored. Disabled whenever
+    // ICC profiles, LUTs or color blindness simulation are in use.
+    bool color_passthrough;
+
     // Forces the use of the "general" scaling algorithms even when using the
     // special-cased built-in presets like `pl_filter_bicubic`. Basically, this
     // disables the more efficient implementations in favor of the slower,
@@ -325,6 +416,45 @@ struct pl_render_params {
     // disabling linear scaling and sigmoidization.
     bool force_low_bit_depth_fbos;
 
+    // Automatically store intermediate passes in a reduced precision format
+    // (rgb10a2) whenever this is known not to affect the output, i.e. for
+    // SDR content rendered to an SDR target of at most 8 bits, with no linear
+    // light processing, debanding or film grain. Roughly halves the FBO
+    // bandwidth, which mainly benefits integrated GPUs. The chosen format is
+    // reported by `pl_render_info.fbo_format`.
+    bool auto_fbo_precision;
+
+    // Soft limit on the total amount of memory used by intermediate FBOs, in
+    // MiB. If exceeded, the renderer falls back to low bit depth FBOs (as if
+    // `force_low_bit_depth_fbos` was set) until `pl_renderer_flush_cache` is
+    // called. Independently of this limit, FBOs that have not been used for
+    // a number of consecutive frames are always released. 0 disables the
+    // limit.
+    int max_fbo_memory;
+
+    // Limit on the total amount of memory used by the renderer's texture
+    // caches (`frame_cache`, `hook_cache` and `overlays` in
+    // `pl_renderer_memory_usage`), in MiB. If exceeded at the end of a frame,
+    // these caches are released, as if by `pl_renderer_flush_cache` (but
+    // without resetting peak detection state). This allows enforcing
+    // per-renderer memory limits, at the cost of re-rendering cached frames.
+    // 0 disables the limit.
+    int max_cache_memory;
+
+    // If nonzero, `pl_render_image` splits the output into tiles of at most
+    // this many (target) pixels in each dimension, rendering each one
+    // separately (with enough source margin to avoid seams) and blitting it
+    // into the target. This bounds the size of all intermediate FBOs by the
+    // tile size, rather than by the image size, which helps when rendering
+    // huge images. Tiling is also enabled automatically for source crops that
+    // exceed `pl_gpu_limits.max_tex_2d_dim`.
+    //
+    // Note: Only supported for unrotated, unflipped single-plane targets with
+    // a blittable format, and without custom hooks or distortion. Peak
+    // detection is disabled while tiling, to keep tone mapping consistent
+    // across tiles.
+    int render_tile_size;
+
     // If this is true, all shaders will be generated as "dynamic" shaders,
     // with any compile-time constants being replaced by runtime-adjustable
     // values. This is generally a performance loss, but has the advantage of
@@ -335,6 +465,56 @@ struct pl_render_params {
     // user, but it should be set to false once those values are "dialed in".
     bool dynamic_constants;
 
+    // If true, allows shaders to evaluate numerically insensitive stages
+    // (debanding, dithering, scaler weights) at reduced precision, which can
+    // be significantly faster on mobile and integrated GPUs. Linearization
+    // and HDR peak detection always use full precision. See
+    // `pl_shader_params.relaxed_precision`.
+    bool relaxed_precision;
+
+    // If true, tunes the workgroup size of compute shaders that don't depend
+    // on a particular one based on GPU timer measurements, and remembers the
+    // result in the GPU's `pl_cache`. See `pl_dispatch_autotune`.
+    bool autotune_compute;
+
+    // If greater than 1, the feature map used for HDR contrast recovery (see
+    // `pl_color_map_params.contrast_recovery`) is extracted from a copy of
+    // the source that is bilinearly downscaled by this factor in each
+    // dimension, instead of at full resolution. This avoids a full-resolution
+    // pass and FBO, which mostly matters for very high resolution sources, at
+    // the cost of slightly less accurate detail recovery. The intermediate is
+    // never made smaller than the final (smoothed) feature map.
+    float feature_map_downscale;
+
+    // If true, consecutive overlays sharing the same `mode`, `repr`, `color`
+    // and texture format are drawn together in a single pass, instead of one
+    // pass per overlay. Overlays with different textures are only batched if
+    // they all have `pl_overlay.signature` set, in which case their parts are
+    // copied into a shared atlas texture that is cached across frames. This
+    // greatly reduces the number of draw calls for subtitles consisting of
+    // many small bitmaps. Signed overlays which need color conversion are
+    // additionally converted once, when copied into the atlas, rather than
+    // on every frame. Disabled by default.
+    bool overlay_atlas;
+
+    // If true, HDR peak detection (see `peak_detect_params`) is dispatched as
+    // a standalone compute pass on an intermediate copy of the source, rather
+    // than being fused into the main shader. On GPUs with a dedicated compute
+    // queue (e.g. Vulkan), this pass executes asynchronously, overlapping with
+    // the rest of the frame's rendering. Only takes effect if
+    // `pl_peak_detect_params.allow_delayed` is also enabled, since otherwise
+    // the remainder of the frame would have to wait for the result anyway.
+    // This costs an extra FBO, so it is only worthwhile for sources where
+    // the main pass is significantly expensive. Disabled by default.
+    bool async_compute;
+
+    // If nonzero, Dolby Vision reshaping is precomputed into LUTs (see
+    // `pl_shader_dovi_reshape_lut`) instead of being evaluated per pixel,
+    // using a 3D LUT with this many entries per dimension for MMR reshaping.
+    // This is much faster for MMR reshaping on high resolution content, at a
+    // small cost in accuracy. 0 disables this.
+    int dovi_lut_size;
+
     // This callback is invoked for every pass successfully executed in the
     // process of rendering a frame. Optional.
     //
@@ -342,6 +522,14 @@ struct pl_render_params {
     void (*info_callback)(void *priv, const struct pl_render_info *info);
     void *info_priv;
 
+    // If true, `info_callback` is not invoked from within the dispatch loop.
+    // Instead, the information about each pass is recorded, and delivered to
+    // `info_callback` (if set) in one batch once the outermost call to
+    // `pl_render_image` or `pl_render_image_mix` is about to return. This
+    // avoids perturbing the timing of the passes being measured. The same
+    // information can also be retrieved with `pl_renderer_get_info`.
+    bool defer_info_callback;
+
     // --- Deprecated/removed fields
     PL_DEPRECATED_IN(v6.254) bool allow_delayed_peak_detect; // moved to pl_peak_detect_params
     PL_DEPRECATED_IN(v6.327) const struct pl_icc_params *icc_params; // use pl_frame.icc
@@ -504,6 +692,13 @@ struct pl_overlay {
     // The number of parts for this overlay.
     const struct pl_overlay_part *parts;
     int num_parts;
+
+    // Optional unique signature identifying the contents of `tex`. Overlays
+    // with a signature set may be packed into a shared atlas texture when
+    // `pl_render_params.overlay_atlas` is enabled, which is reused for as long
+    // as the signatures (and part source rects) stay the same. Callers must
+    // change the signature whenever the texture contents change.
+    uint64_t signature;
 };
 
 // High-level description of a complete frame, including metadata and planes
@@ -518,6 +713,11 @@ struct pl_frame {
     // of these fields is ordered first in time. `prev` and `next` should point
     // to the previous/next frames in the file, or NULL if there are none.
     //
+    // The planes of `prev` and `next` are sampled directly by the deinterlacer,
+    // and never go through any other part of the rendering pipeline. When
+    // using `pl_queue`, all fields referencing a source frame share the same
+    // mapped textures, so each source frame is only uploaded once.
+    //
     // Note: Setting these fields on the render target has no meaning and will
     // be ignored.
     enum pl_field field;
@@ -624,6 +824,17 @@ struct pl_frame {
     // un-applying grain makes little sense.
     struct pl_film_grain_data film_grain;
 
+    // Optional unique signature identifying the contents of this frame,
+    // including any `overlays` attached to it. If set on the `image` passed
+    // to `pl_render_image`, the frame is pushed through the same redraw cache
+    // used by `pl_render_image_mix`, so that repeated draws of the same image
+    // (e.g. while paused, or when only the target's overlays change) skip
+    // sampling, scaling and color mapping, re-running only the final output
+    // stage. Callers must change the signature whenever the frame contents
+    // change. Ignored for the `target`, and by `pl_render_image_mix`, which
+    // uses `pl_frame_mix.signatures` instead.
+    uint64_t signature;
+
     // Ignored by libplacebo. May be useful for users.
     void *user_data;
 };
@@ -702,6 +913,99 @@ PL_API bool pl_render_image(pl_renderer rr, const struct pl_frame *image,
                             const struct pl_frame *target,
                             const struct pl_render_params *params);
 
+// Render a single image to multiple targets, e.g. several output resolutions
+// and color spaces of the same source. This is equivalent to calling
+// `pl_render_image` once per target, except that the image planes are only
+// read, merged and pre-processed (deinterlacing, debanding, film grain, color
+// adjustment and decoding) once, with the results shared among all targets.
+// Only the scaling and output stages are performed separately per target.
+//
+// `params` may be NULL, or point to an array of `num_targets` parameters
+// (individual entries of which may also be NULL). Parameters controlling the
+// shared pre-processing are taken from the first entry, and ignored for all
+// others. User hooks are run separately for every target, and only ever see
+// the shared (already decoded) image.
+//
+// Note: `image->signature` is ignored by this function.
+PL_API bool pl_render_image_multi(pl_renderer rr, const struct pl_frame *image,
+                                  const struct pl_frame *targets, int num_targets,
+                                  const struct pl_render_params *const params[]);
+
+// Render many (small) images into sub-rects of a single target, e.g. for
+// generating thumbnails. This is equivalent to calling `pl_render_image` for
+// each `images[i]` with `target.crop` set to `rects[i]`, except that the
+// target is only acquired and cleared once, and the intermediate FBOs are
+// held (and reused) for the entire batch. Images of the same size and format
+// also share all of their shaders. The target's own overlays are drawn once,
+// on top of all images.
+PL_API bool pl_render_image_batch(pl_renderer rr, const struct pl_frame *images,
+                                  const pl_rect2df *rects, int num_images,
+                                  const struct pl_frame *target,
+                                  const struct pl_render_params *params);
+
+// Variant of `pl_render_image_batch` meant for compositing many (possibly
+// overlapping) windows into a single target. The images are first rendered,
+// in order, into a shared linear light intermediate, which is then output to
+// the target in a single final pass. Expensive output-side processing, such
+// as ICC encoding, 3DLUTs and dithering, is therefore only done once per
+// target, rather than once per image.
+//
+// Images are decoded, scaled and tone mapped individually, according to
+// `params`, while `params->dither_params` and related fields only affect the
+// final pass. Image-side processing (e.g. debanding, custom hooks) is not
+// repeated for the final pass, nor are `distort_params`, `blend_params` and
+// `corner_rounding`, which apply to the individual images instead.
+//
+// Note: If only a single image is given, or `skip_target_clearing` is set,
+// or the GPU lacks a suitable 16-bit floating point RGBA format, this
+// transparently falls back to `pl_render_image_batch`.
+PL_API bool pl_render_image_composite(pl_renderer rr, const struct pl_frame *images,
+                                      const pl_rect2df *rects, int num_images,
+                                      const struct pl_frame *target,
+                                      const struct pl_render_params *params);
+
+// Describes one horizontal band of a split-frame rendering, as computed by
+// `pl_frames_split_band`.
+struct pl_render_band {
+    // The image to render for this band. This is a copy of the original
+    // image, cropped to the source region covering the band plus a margin
+    // large enough for the footprint of the scalers. The planes may be
+    // replaced by textures holding the same contents, e.g. on another GPU.
+    struct pl_frame image;
+
+    // Crop to use for the band-local target, which must be (at least)
+    // `width` x `height` pixels large, and is otherwise identical to the
+    // original target.
+    pl_rect2df target_crop;
+    int width, height;
+
+    // The valid region of the band-local target (i.e. excluding the margin),
+    // and the region of the original target it corresponds to. Both have the
+    // same size, and may be empty if there are more bands than output rows.
+    pl_rect2d src_rc;
+    pl_rect2d dst_rc;
+};
+
+// Helper for split-frame rendering, e.g. to spread the rendering of very
+// high resolution outputs across multiple `pl_renderer` / `pl_gpu` instances.
+// Computes band `index` out of `num_bands` (of near-equal height) of the
+// rendering of `image` onto `target`. Rendering each band into a band-local
+// target and copying (e.g. via `pl_tex_blit` or `pl_tex_transfer`) its
+// `src_rc` into `dst_rc` of the original target reproduces the output of
+// rendering the whole frame, minus the clearing of the area outside of
+// `target.crop`, which the user must take care of.
+//
+// Returns false if the frames can't be split, e.g. because they are rotated
+// or flipped. Note: As with `pl_render_params.render_tile_size`, frame-global
+// effects differ between bands unless disabled. In particular, peak
+// detection should be disabled (or its results shared between bands), and
+// custom hooks must not change the size of the image.
+PL_API bool pl_frames_split_band(const struct pl_frame *image,
+                                 const struct pl_frame *target,
+                                 const struct pl_render_params *params,
+                                 int index, int num_bands,
+                                 struct pl_render_band *out_band);
+
 // Flushes the internal state of this renderer. This is normally not needed,
 // even if the image parameters, colorspace or target configuration change,
 // since libplacebo will internally detect such circumstances and recreate
@@ -711,12 +1015,34 @@ PL_API bool pl_render_image(pl_renderer rr, const struct pl_frame *image,
 // dramatically (e.g. when switching to a different file).
 PL_API void pl_renderer_flush_cache(pl_renderer rr);
 
+// Approximate amount of GPU memory (in bytes) currently held by a renderer,
+// broken down by category. Sizes are computed from the texture and buffer
+// dimensions, ignoring any driver-specific padding. Resources shared between
+// renderers on the same `pl_gpu` (e.g. shared LUTs) are not included.
+struct pl_renderer_memory_usage {
+    size_t fbos;            // intermediate textures
+    size_t frame_cache;     // cached frames for `pl_render_image_mix`
+    size_t hook_cache;      // cached outputs of deterministic hooks
+    size_t overlays;        // overlay texture atlases
+    size_t shader_objects;  // LUTs, dither matrices, peak detection, ...
+    size_t dispatch;        // uniform buffers of cached shader passes
+    size_t total;           // sum of all of the above
+};
+
+PL_API void pl_renderer_get_memory_usage(pl_renderer rr,
+                                         struct pl_renderer_memory_usage *out);
+
 // Mirrors `pl_get_detected_hdr_metadata`, giving you the current internal peak
 // detection HDR metadata (when peak detection is active). Returns false if no
 // information is available (e.g. not HDR source, peak detection disabled).
 PL_API bool pl_renderer_get_hdr_metadata(pl_renderer rr,
                                          struct pl_hdr_metadata *metadata);
 
+// Mirrors `pl_get_detected_peak_frame`, returning the raw per-frame results
+// of the internal peak detection pass in submission order, without blocking.
+PL_API bool pl_renderer_get_peak_frame(pl_renderer rr,
+                                       struct pl_peak_detect_frame *out);
+
 // Represents a mixture of input frames, distributed temporally.
 //
 // NOTE: Frames must be sorted by timestamp, i.e. `timestamps` must be
@@ -823,6 +1149,68 @@ PL_API bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *image
 PL_API void pl_frames_infer_mix(pl_renderer rr, const struct pl_frame_mix *mix,
                                 struct pl_frame *target, struct pl_frame *out_ref);
 
+// Runs the same rendering pass graph as `pl_render_image` (and, if
+// `params->frame_mixer` is set, `pl_render_image_mix`) for the given `image`
+// and `target` templates, without modifying the contents of `target`. This
+// compiles all shaders and generates all LUTs that these calls would
+// require, populating the internal dispatch state and any attached
+// `pl_cache`, so that the first real frame does not stall on shader
+// compilation. Returns whether rendering succeeded.
+//
+// Both `image` and `target` must have valid textures attached to all planes;
+// the sizes, formats and color metadata should match what will be used for
+// real frames, since any mismatch will require different shaders. The target
+// textures are only used as templates - scratch copies are rendered to
+// instead. The contents of the image textures are irrelevant.
+//
+// Note: This resets HDR peak detection state, so it's best called before
+// playback starts (or after `pl_renderer_flush_cache`).
+PL_API bool pl_renderer_prewarm(pl_renderer rr, const struct pl_frame *image,
+                                const struct pl_frame *target,
+                                const struct pl_render_params *params);
+
+struct pl_render_op_stats {
+    uint64_t gpu_time;  // sum of `pl_dispatch_info.last`, in nanoseconds
+    int passes;         // number of dispatched passes
+    size_t fbo_bytes;   // total size of intermediate FBOs rendered to
+};
+
+struct pl_render_frame_stats {
+    // Totals for the entire frame. Each pass is counted exactly once here.
+    uint64_t gpu_time;
+    int passes;
+    size_t fbo_bytes;
+
+    // Number of (compute) passes dispatched separately, so they may overlap
+    // with other rendering. See `pl_render_params.async_compute`. Whether
+    // these actually execute concurrently depends on the GPU exposing a
+    // separate compute queue.
+    int async_passes;
+
+    // Breakdown per `pl_render_op`. Passes which combine several operations
+    // are counted towards each of them, so these may sum up to more than the
+    // frame totals.
+    struct pl_render_op_stats ops[PL_RENDER_OP_COUNT];
+};
+
+// Returns statistics about the most recently completed call to
+// `pl_render_image` or `pl_render_image_mix` (including all nested frame
+// redraws). Returns false if nothing has been rendered yet.
+//
+// Note: GPU timer queries complete asynchronously, so `gpu_time` reflects
+// the most recently available measurement for each pass, which typically
+// lags behind by a few frames. On GPUs without timer support, it is 0.
+PL_API bool pl_renderer_get_frame_stats(pl_renderer rr,
+                                        struct pl_render_frame_stats *out);
+
+// When `pl_render_params.defer_info_callback` is set, this returns the
+// information recorded for the passes of the most recently completed call to
+// `pl_render_image` or `pl_render_image_mix`, in execution order. Returns the
+// number of entries in `*out`, which remain valid until the next render call.
+// Returns 0 if the last frame was not rendered in deferred mode.
+PL_API int pl_renderer_get_info(pl_renderer rr,
+                                const struct pl_render_info **out);
+
 // Backwards compatibility with old filters API, may be deprecated.
 // Redundant with pl_filter_configs and masking `allowed` for
 // PL_FILTER_SCALING and PL_FILTER_FRAME_MIXING respectively.
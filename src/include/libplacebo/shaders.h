@@ -63,6 +63,14 @@ struct pl_shader_params {
     // dynamic variables. This is mainly useful to avoid recompilation for
     // shaders which expect to have their values change constantly.
     bool dynamic_constants;
+
+    // If this is true, intermediate values in stages where this is numerically
+    // safe (e.g. debanding, dithering, scaler weights) are declared with
+    // reduced (`mediump`) precision, allowing drivers to evaluate them using
+    // 16-bit floats. On Vulkan, this is translated into `RelaxedPrecision`
+    // decorations, which SPIR-V consumers such as SPIRV-Cross may in turn map
+    // to types like `min16float`. Has no effect on desktop GLSL < 130.
+    bool relaxed_precision;
 };
 
 #define pl_shader_params(...) (&(struct pl_shader_params) { __VA_ARGS__ })
@@ -132,6 +140,10 @@ typedef const struct pl_shader_info_t {
     // As a convenience, this contains a pretty-printed version of the
     // above list, with entries tallied and separated by commas
     const char *description;
+
+    // Total size (in bytes) of all LUTs used by this shader, including LUT
+    // textures, uniform arrays and embedded literals.
+    size_t lut_bytes;
 } *pl_shader_info;
 
 PL_API pl_shader_info pl_shader_info_ref(pl_shader_info info);
@@ -41,6 +41,22 @@ PL_API void pl_shader_set_alpha(pl_shader sh, struct pl_color_repr *repr,
 // automatically by `pl_shader_decode_color` for PL_COLOR_SYSTEM_DOLBYVISION.
 PL_API void pl_shader_dovi_reshape(pl_shader sh, const struct pl_dovi_metadata *data);
 
+// Equivalent to `pl_shader_dovi_reshape`, but precomputes the reshaping into a
+// LUT instead of evaluating it per pixel. Reshaping curves consisting purely
+// of polynomial pieces are baked into a 1D LUT, while MMR reshaping (which
+// depends on all three components) is baked into a 3D LUT with `lut_size`
+// entries per dimension, or a built-in default if this is 0. LUTs are cached
+// in the GPU's `pl_cache` by the reshaping metadata, so only new metadata
+// incurs the cost of regenerating them.
+//
+// `state` must be a pointer to a NULL-initialized shader state object that
+// will be used to encapsulate any required GPU state.
+//
+// Note: This is significantly faster for MMR reshaping, at the cost of some
+// precision, since interpolation smooths over the reshaping curves.
+PL_API void pl_shader_dovi_reshape_lut(pl_shader sh, const struct pl_dovi_metadata *data,
+                                       int lut_size, pl_shader_obj *state);
+
 // Decode the color into normalized RGB, given a specified color_repr. This
 // also takes care of additional pre- and post-conversions requires for the
 // "special" color systems (XYZ, BT.2020-C, etc.). If `params` is left as NULL,
@@ -141,11 +157,37 @@ struct pl_peak_detect_params {
     // Setting this to 0.0 (or a negative value) disables this functionality.
     float black_cutoff;
 
+    // Only measure a quarter of the image, by sampling one pixel out of every
+    // 2x2 block. This substantially reduces the cost of peak detection, at
+    // the cost of possibly missing very small highlights. Mainly useful for
+    // high resolution content on slower GPUs. Disabled by default.
+    bool downsample;
+
+    // If greater than 1, the full peak detection is only performed once every
+    // `detect_interval` frames. The frames in between only perform a cheap,
+    // downsampled measurement without histogram, which is used solely to
+    // detect scene changes (according to `scene_threshold_high`). When one is
+    // detected, the cheap result is adopted immediately and a full measurement
+    // is forced on the next frame. Otherwise, the previous (smoothed) result
+    // is reused as-is. Disabled by default.
+    int detect_interval;
+
     // Allows the peak detection result to be delayed by up to a single frame,
     // which can sometimes improve thoughput, at the cost of introducing the
     // possibility of 1-frame flickers on transitions. Disabled by default.
     bool allow_delayed;
 
+    // Keeps the peak detection results entirely on the GPU. The last work
+    // group of the detection shader performs the percentile and smoothing
+    // math itself, and writes the result into a persistent buffer which
+    // `pl_shader_color_map_ex` samples directly, without ever reading it
+    // back to the CPU. This requires the 3DLUT tone mapping path (and falls
+    // back to a blocking readback where that is unavailable), and always
+    // performs a full measurement, ignoring `detect_interval`. Detection and
+    // color mapping must be dispatched as separate shaders, and
+    // `allow_delayed` has no effect. (Since API v418)
+    bool gpu_resident;
+
     // --- Deprecated / removed fields
     PL_DEPRECATED_IN(v6.313) float minimum_peak;
 };
@@ -189,10 +231,59 @@ PL_API bool pl_shader_detect_peak(pl_shader sh, struct pl_color_space csp,
 // `metadata` are not written to. Returns whether or not any values were
 // written. If not, the values are left untouched, so this can be used to
 // safely update `pl_hdr_metadata` values in-place. This function may or may
-// not block, depending on the previous setting of `allow_delayed`.
+// not block, depending on the previous setting of `allow_delayed`. With
+// `gpu_resident`, this always blocks on the most recent result.
 PL_API bool pl_get_detected_hdr_metadata(const pl_shader_obj state,
                                          struct pl_hdr_metadata *metadata);
 
+#define PL_PEAK_HIST_BINS 64
+
+// Raw, unsmoothed results of a single `pl_shader_detect_peak` measurement.
+// Intended for e.g. generating dynamic HDR metadata while encoding.
+struct pl_peak_detect_frame {
+    // Sequence number of this measurement, counting calls to
+    // `pl_shader_detect_peak` since the state object was created or reset.
+    // Gaps mean that results were discarded before being retrieved.
+    uint64_t index;
+
+    // Whether this was a cheap measurement (see `detect_interval`). These
+    // never contain a histogram, and `max_pq_y` ignores `percentile`.
+    bool cheap;
+
+    // Whether the frame was detected as a scene change, according to
+    // `scene_threshold_high`. Always false if scene detection is disabled.
+    bool scene_change;
+
+    // Detected peak (according to `percentile`) and average brightness of
+    // the frame, in PQ. These are the inputs to the smoothed values returned
+    // by `pl_get_detected_hdr_metadata`.
+    float max_pq_y;
+    float avg_pq_y;
+
+    // Brightest sample and average brightness of the frame, in nits. Taking
+    // the maximum of these over all frames approximates MaxCLL and MaxFALL,
+    // except that they're derived from luminance rather than max(R,G,B), and
+    // the average is computed in PQ space.
+    float max_cll;
+    float max_fall;
+
+    // Luminance histogram of the measured samples. Bin `i` counts samples
+    // with PQ values in [(64 + i) / 128, (65 + i) / 128), except that bin 0
+    // also includes all darker samples (below roughly 90 nits). Only
+    // available if `percentile` is strictly between 0 and 100, and `cheap` is
+    // false. Otherwise, this is all zero.
+    uint32_t histogram[PL_PEAK_HIST_BINS];
+};
+
+// Retrieves the oldest per-frame measurement not yet returned by this
+// function, in submission order. This never blocks: results only become
+// available once the GPU has finished the corresponding dispatch, and
+// returns false if there are none (yet). Up to 16 results are retained,
+// beyond which the oldest are overwritten. Per-frame results are never
+// available with `gpu_resident`.
+PL_API bool pl_get_detected_peak_frame(const pl_shader_obj state,
+                                       struct pl_peak_detect_frame *out);
+
 // Resets the peak detection state in a given tone mapping state object. This
 // is not equal to `pl_shader_obj_destroy`, because it does not destroy any
 // state used by `pl_shader_tone_map`.
@@ -243,6 +334,23 @@ struct pl_color_map_params {
     // default size.
     bool lut3d_tricubic;
 
+    // If true, `lut3d_size` is treated as an upper bound, and the 3DLUT
+    // dimensions are reduced when the source and target gamuts are close to
+    // each other. Also allows storing the 3DLUT in a more compact (10-bit)
+    // texture format, where supported. Trades some accuracy for lower memory
+    // use and faster LUT generation.
+    bool lut3d_adaptive;
+
+    // If true, changes to the gamut mapping 3DLUT are generated on a
+    // background thread, while the previous 3DLUT keeps being used for the
+    // frames rendered in the meantime. Avoids stalling on (e.g.) display
+    // profile changes, at the cost of a few frames rendered with outdated
+    // gamut mapping. Only applies when the 3DLUT size is unchanged.
+    //
+    // Note: The `gamut_mapping` function must remain valid for as long as
+    // the shader object exists.
+    bool lut3d_async;
+
     // If true, allows the gamut mapping function to expand the gamut, in
     // cases where the target gamut exceeds that of the source. If false,
     // the source gamut will never be enlarged, even when using a gamut
@@ -284,7 +392,9 @@ struct pl_color_map_params {
     // --- Debugging options
 
     // Force the use of a full tone-mapping LUT even for functions that have
-    // faster pure GLSL replacements (e.g. clip, linear, saturation).
+    // faster pure GLSL replacements (e.g. clip, linear, saturation). Without
+    // this, closed-form functions (spline, bt2390, reinhard, mobius, hable)
+    // are evaluated analytically, so dynamic metadata only updates uniforms.
     bool force_tone_mapping_lut;
 
     // Visualize the tone-mapping LUT and gamut mapping 3DLUT, in IPT space.
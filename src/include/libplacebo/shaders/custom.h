@@ -177,6 +177,13 @@ struct pl_hook_params {
     pl_tex (*get_tex)(void *priv, int width, int height);
     void *priv;
 
+    // Optional helper function to hand a texture obtained from `get_tex` back
+    // to the renderer before the end of the frame, once the user no longer
+    // needs its contents. The renderer may then return it from subsequent
+    // calls to `get_tex`, so the user must not reference it any further. May
+    // be NULL, in which case textures are simply held until the next frame.
+    void (*release_tex)(void *priv, pl_tex tex);
+
     // Which stage triggered the hook to run.
     enum pl_hook_stage stage;
 
@@ -324,6 +331,16 @@ struct pl_hook {
     // All hooks with the same signature will be disabled, should they fail to
     // execute during run-time.
     uint64_t signature;
+
+    // If true, the output of this hook is a pure function of the input image
+    // contents, the other fields of `pl_hook_params` and the current values
+    // of `parameters`. This allows the renderer to reuse previous outputs
+    // when rendering the same frame repeatedly (e.g. while paused, or after
+    // changing unrelated parameters), skipping the `hook` call entirely.
+    // Only used by hooks taking and returning `PL_HOOK_SIG_TEX`, and only
+    // for frames with a `pl_frame.signature`. Hooks that keep state between
+    // stages or frames, or which draw on random numbers, must not set this.
+    bool deterministic;
 };
 
 // Compatibility layer with `mpv` user shaders. See the mpv man page for more
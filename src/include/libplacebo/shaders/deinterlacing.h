@@ -67,7 +67,8 @@ struct pl_deinterlace_source {
     // may be NULL, but `cur` is required. If present, they must all have the
     // exact same texture dimensions.
     //
-    // Note: `prev` and `next` are only required for PL_DEINTERLACE_YADIF.
+    // Note: `prev` and `next` are only required for PL_DEINTERLACE_YADIF and
+    // PL_DEINTERLACE_BWDIF.
     struct pl_field_pair prev, cur, next;
 
     // The parity of the current field to output. This field will be unmodified
@@ -102,13 +103,19 @@ enum pl_deinterlace_algorithm {
     // adapted slightly for the GPU.
     PL_DEINTERLACE_YADIF,
 
+    // "Bob Weaver deinterlacing filter". Motion-adaptive deinterlacer based
+    // on FFmpeg's bwdif filter, which combines yadif's temporal check with
+    // cubic / multi-tap interpolation for higher quality on fine detail. A bit
+    // slower than PL_DEINTERLACE_YADIF, and uses the same `prev`/`next` refs.
+    PL_DEINTERLACE_BWDIF,
+
     PL_DEINTERLACE_ALGORITHM_COUNT,
 };
 
 // Returns whether or not an algorithm requires `prev`/`next` refs to be set.
 static inline bool pl_deinterlace_needs_refs(enum pl_deinterlace_algorithm algo)
 {
-    return algo == PL_DEINTERLACE_YADIF;
+    return algo == PL_DEINTERLACE_YADIF || algo == PL_DEINTERLACE_BWDIF;
 }
 
 struct pl_deinterlace_params {
@@ -116,7 +123,8 @@ struct pl_deinterlace_params {
     // provides a good trade-off of quality and speed.
     enum pl_deinterlace_algorithm algo;
 
-    // Skip the spatial interlacing check. (PL_DEINTERLACE_YADIF only)
+    // Skip the spatial interlacing check. (PL_DEINTERLACE_YADIF and
+    // PL_DEINTERLACE_BWDIF only)
     bool skip_spatial_check;
 };
 
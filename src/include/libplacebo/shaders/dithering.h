@@ -64,7 +64,9 @@ struct pl_dither_params {
     int lut_size;
 
     // Enables temporal dithering. This reduces the persistence of dithering
-    // artifacts by perturbing the dithering matrix per frame.
+    // artifacts by perturbing the dithering matrix per frame. For
+    // `PL_DITHER_BLUE_NOISE`, this uses a precomputed spatio-temporal noise
+    // texture with a period of 16 frames, where 3D textures are supported.
     // Warning: This can cause nasty aliasing artifacts on some LCD screens.
     bool temporal;
 
@@ -116,8 +118,22 @@ struct pl_error_diffusion_params {
     // Error diffusion kernel to use. Optional. If unspecified, defaults to
     // `&pl_error_diffusion_sierra_lite`.
     const struct pl_error_diffusion_kernel *kernel;
+
+    // If set to a value smaller than the image height, the image is split
+    // into horizontal bands of (at most) this many rows, which are processed
+    // by independent work groups. This bounds the shared memory requirements
+    // independently of the image height, and allows processing multiple bands
+    // in parallel, at the cost of faint seams between the bands. Optional.
+    //
+    // Each band additionally re-processes the last `PL_EDF_BAND_OVERLAP` rows
+    // of the previous band, so the shared memory requirements become
+    // `pl_error_diffusion_shmem_req(kernel, band_height + PL_EDF_BAND_OVERLAP)`.
+    int band_height;
 };
 
+// Number of rows shared between adjacent bands, see `band_height`.
+#define PL_EDF_BAND_OVERLAP 16
+
 #define pl_error_diffusion_params(...) (&(struct pl_error_diffusion_params) { __VA_ARGS__ })
 
 // Computes the shared memory requirements for a given error diffusion kernel.
@@ -126,13 +142,20 @@ struct pl_error_diffusion_params {
 PL_API size_t pl_error_diffusion_shmem_req(const struct pl_error_diffusion_kernel *kernel,
                                            int height);
 
+// Returns the largest `band_height` whose shared memory requirements fit
+// within `max_shmem`, or 0 if banded error diffusion is not possible.
+PL_API int pl_error_diffusion_band_height(const struct pl_error_diffusion_kernel *kernel,
+                                          size_t max_shmem);
+
 // Apply an error diffusion dithering kernel. This is a much more expensive and
 // heavy dithering method, and is not generally recommended for realtime usage
 // where performance is critical.
 //
 // Requires compute shader support. Returns false if dithering fail e.g. as a
 // result of shader memory limits being exceeded. The resulting shader must be
-// dispatched with a work group count of exactly 1.
+// dispatched with a work group count of exactly {1, bands, 1}, where `bands`
+// is the number of bands, i.e. `ceil(height / band_height)` (or 1 if
+// `band_height` is unset).
 PL_API bool pl_shader_error_diffusion(pl_shader sh, const struct pl_error_diffusion_params *params);
 
 PL_API_END
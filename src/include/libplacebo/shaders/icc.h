@@ -62,6 +62,10 @@ struct pl_icc_params {
     // GPU-internal cache, to cache the generated 3DLUTs. Note that these can
     // get large, especially for large values of size_{r,g,b}, so the user may
     // wish to split this cache off from the main shader cache. (Optional)
+    //
+    // This cache is also used to store the results of profile analysis
+    // (detected primaries, gamma and contrast), which speeds up subsequent
+    // calls to `pl_icc_open` on the same profile.
     pl_cache cache;
 
     // Deprecated legacy caching API. Replaced by `cache`.
@@ -59,6 +59,11 @@ struct pl_custom_lut {
 // Parse a 3DLUT in .cube format. Returns NULL if the file fails parsing.
 PL_API struct pl_custom_lut *pl_lut_parse_cube(pl_log log, const char *str, size_t str_len);
 
+// Like `pl_lut_parse_cube`, but stores the parsed LUT data in `cache`, keyed
+// by the file contents, so that parsing the same LUT again is nearly free.
+PL_API struct pl_custom_lut *pl_lut_parse_cube_ex(pl_log log, pl_cache cache,
+                                                  const char *str, size_t str_len);
+
 // Frees a LUT created by `pl_lut_parse_*`.
 PL_API void pl_lut_free(struct pl_custom_lut **lut);
 
@@ -0,0 +1,95 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef LIBPLACEBO_SHADERS_MOTION_H_
+#define LIBPLACEBO_SHADERS_MOTION_H_
+
+// Block-matching motion estimation, for use with motion-compensated frame
+// interpolation. These shaders are designed to be used on a luma pyramid,
+// i.e. a series of successively 2x downscaled single-channel textures, with
+// the motion field being refined from the coarsest level to the finest.
+
+#include <libplacebo/shaders.h>
+
+PL_API_BEGIN
+
+struct pl_motion_params {
+    // Size (in texels of the finest pyramid level) of each block to match.
+    // Larger blocks are more robust against noise, but fail to capture small
+    // moving objects. Valid range 2-16, defaults to 8.
+    int block_size;
+
+    // Search radius (in texels) around the predicted motion vector, at each
+    // pyramid level. The total reachable displacement is roughly
+    // `search_radius * 2^levels`. Valid range 1-4, defaults to 2.
+    int search_radius;
+
+    // Number of pyramid levels to use. Valid range 1-8, defaults to 4.
+    int levels;
+
+    // Mean absolute (luma) error above which a motion vector is considered
+    // unreliable, and the affected region falls back to ordinary blending
+    // instead. Defaults to 0.05.
+    float max_error;
+};
+
+#define PL_MOTION_DEFAULTS      \
+    .block_size     = 8,        \
+    .search_radius  = 2,        \
+    .levels         = 4,        \
+    .max_error      = 0.05f,
+
+#define PL_MOTION_MAX_LEVELS 8
+
+#define pl_motion_params(...) (&(struct pl_motion_params) { PL_MOTION_DEFAULTS __VA_ARGS__ })
+PL_API extern const struct pl_motion_params pl_motion_default_params;
+
+// Downscales `src` by a factor of 2 in each dimension (rounding up), using a
+// 2x2 box filter, and outputs the result into `color.x`. If `luma` is true,
+// the source is assumed to be RGB and converted to (BT.709) luma first.
+// Otherwise, only the first component is used. Returns false on failure.
+PL_API bool pl_shader_motion_downscale(pl_shader sh, pl_tex src, bool luma);
+
+struct pl_motion_source {
+    // Single-channel (luma) textures of the two frames to match. Both must
+    // have the exact same dimensions. Required.
+    pl_tex prev, next;
+
+    // Motion field estimated on the next coarser pyramid level, as output by
+    // a previous call to `pl_shader_motion_estimate`. Optional. If present,
+    // the search is centered around this predictor.
+    pl_tex coarse;
+};
+
+#define pl_motion_source(...) (&(struct pl_motion_source) { __VA_ARGS__ })
+
+// Performs block matching between `prev` and `next`. The output has one
+// pixel per block, i.e. a size of `ceil(w / block_size) x ceil(h / block
+// size)`, and contains the displacement from `prev` to `next` in normalized
+// texture coordinates in `color.xy`, and the mean absolute error of the best
+// match in `color.z`. The output texture should therefore be at least 16-bit
+// floating point. If `params` is left as NULL, it defaults to
+// `&pl_motion_default_params`. Returns false on failure.
+//
+// Note: `block_size` and `search_radius` apply to the texel grid of `prev`,
+// so the same parameters can be used for every level of a pyramid.
+PL_API bool pl_shader_motion_estimate(pl_shader sh, const struct pl_motion_source *src,
+                                      const struct pl_motion_params *params);
+
+PL_API_END
+
+#endif // LIBPLACEBO_SHADERS_MOTION_H_
@@ -94,6 +94,13 @@ struct pl_deband_params {
     // disturbing colors close to this value. Set this to a value corresponding
     // to black in the relevant colorspace.
     float grain_neutral[3];
+
+    // If true, stop iterating as soon as an iteration rejects the average
+    // for all components, on the assumption that the pixel is real detail
+    // rather than banding. This skips most of the texture fetches on highly
+    // detailed content, at the cost of slightly reduced debanding strength
+    // around edges. Only has an effect for `iterations` > 1.
+    bool early_exit;
 };
 
 #define PL_DEBAND_DEFAULTS  \
@@ -175,6 +182,16 @@ struct pl_sample_filter_params {
     // ratios. Must be set to a valid pointer, and the target NULL-initialized.
     pl_shader_obj *lut;
 
+    // If set, every source texel is passed through this shader before being
+    // weighted, e.g. to sigmoidize the source on the fly rather than in a
+    // separate pass. Must have both input and output signature
+    // `PL_SHADER_SIG_COLOR`, and should be a per-component transform. It is
+    // applied to the raw texel values, before `pl_sample_src.scale`. On
+    // success, this shader is merged into the sampling shader and must be
+    // reset or freed by the caller before being used again. Only supported
+    // by `pl_shader_sample_polar`. (Since API v417)
+    pl_shader tap_shader;
+
     // Deprecated / removed fields
     PL_DEPRECATED_IN(v6.335) int lut_entries; // hard-coded as 256
     PL_DEPRECATED_IN(v6.335) float cutoff; // hard-coded as 1e-3
@@ -195,8 +212,16 @@ PL_API bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src
 // quality than polar sampling, but significantly faster, and therefore the
 // recommended default. Returns whether or not it was successful.
 //
-// `src` must represent a scaling operation that only scales in one direction,
-// i.e. either only X or only Y. The other direction must be left unscaled.
+// `src` should represent a scaling operation that only scales in one
+// direction, i.e. either only X or only Y, with the other direction left
+// unscaled. As an exception, if compute shaders are available (and
+// `params->no_compute` is unset), `src` may also scale in both directions, in
+// which case both passes are performed at once by a compute shader caching all
+// source texels in shared memory. Anti-ringing is not supported in this mode.
+// If this is not possible (e.g. due to insufficient shared memory), this
+// returns false *without* modifying `sh`, so the caller can fall back to
+// performing two separate passes. (This can be distinguished from a real
+// error using `pl_shader_is_failed`)
 //
 // Note: Due to internal limitations, this may currently only be used on 2D
 // textures - even though the basic principle would work for 1D and 3D textures
@@ -103,6 +103,11 @@ struct pl_swapchain_frame {
     // and alpha handling (where available).
     struct pl_color_repr color_repr;
     struct pl_color_space color_space;
+
+    // Monotonically increasing ID of this frame, starting at 1, which may be
+    // used with `pl_swapchain_wait_presented`. 0 if presentation feedback is
+    // not supported by this swapchain.
+    uint64_t id;
 };
 
 // Retrieve a new frame from the swapchain. Returns whether successful. It's
@@ -166,6 +171,55 @@ PL_API bool pl_swapchain_submit_frame(pl_swapchain sw);
 // `start_frame` blocked for should also be included).
 PL_API void pl_swapchain_swap_buffers(pl_swapchain sw);
 
+// Presentation feedback, as returned by `pl_swapchain_present_timing`.
+struct pl_swapchain_timing {
+    // ID of the most recently presented frame (see `pl_swapchain_frame.id`),
+    // or 0 if no frame is known to have been presented yet.
+    uint64_t frame_id;
+
+    // Number of frames submitted but not yet known to have been presented.
+    int queued;
+
+    // Time at which `frame_id` was presented, in nanoseconds, on the clock of
+    // the presentation engine (usually CLOCK_MONOTONIC). 0 if unknown.
+    uint64_t present_time;
+
+    // Duration of a single refresh cycle of the display, in nanoseconds. 0 if
+    // unknown.
+    uint64_t refresh_duration;
+};
+
+// Query presentation feedback for the frames submitted so far. Non-blocking.
+// Returns false if presentation feedback is not supported by this swapchain.
+PL_API bool pl_swapchain_present_timing(pl_swapchain sw,
+                                        struct pl_swapchain_timing *out);
+
+// Blocks until the frame with the given ID (see `pl_swapchain_frame.id`) has
+// been presented to the user, or until `timeout` (in nanoseconds) expires.
+// Frames which will never be presented, e.g. because they were replaced by
+// a newer frame or the swapchain was recreated, count as presented. Returns
+// false on timeout, or if presentation feedback is not supported.
+//
+// This allows users to explicitly bound the presentation latency, e.g. by
+// waiting for frame N-1 to be presented after submitting frame N, rather
+// than relying on `pl_swapchain_swap_buffers`, which only waits for frames
+// to finish rendering. Must only be called on already submitted frames.
+PL_API bool pl_swapchain_wait_presented(pl_swapchain sw, uint64_t frame_id,
+                                        uint64_t timeout);
+
+// Enable or disable adaptive vsync. When enabled, a frame that misses its
+// vsync deadline is presented immediately, tearing slightly, instead of
+// being held back until the next vsync - which would stall presentation for
+// a full refresh cycle and typically cause the following frame to be
+// dropped as well. Frames that arrive on time are still synchronized to
+// vsync. Disabled by default.
+//
+// Returns false if this is not supported by the swapchain, or if the
+// swapchain doesn't synchronize to vsync in the first place, in which case
+// presentation is left unchanged. The change may only take effect starting
+// with the next `pl_swapchain_start_frame`.
+PL_API bool pl_swapchain_adaptive_vsync(pl_swapchain sw, bool enable);
+
 PL_API_END
 
 #endif // LIBPLACEBO_SWAPCHAIN_H_
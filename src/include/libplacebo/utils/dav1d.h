@@ -99,6 +99,19 @@ PL_DAV1D_API bool pl_upload_dav1dpicture(pl_gpu gpu,
 // passed as the value of `cookie` is `pl_gpu.limits.thread_safe`. Otherwise,
 // the user must manually synchronize this to ensure it runs on the correct
 // thread.
+//
+// To decode directly into GPU-visible memory, install these as the picture
+// allocator and set `pl_dav1d_upload_params.gpu_allocated`:
+//
+//   settings.allocator = (Dav1dPicAllocator) {
+//       .cookie = (void *) gpu,
+//       .alloc_picture_callback = pl_allocate_dav1dpicture,
+//       .release_picture_callback = pl_release_dav1dpicture,
+//   };
+//
+// Uploads of such pictures are then plain buffer to texture copies, without
+// any CPU-side memcpy. Pictures for which the allocation fails with ENOTSUP
+// or ENOMEM should be retried with dav1d's default allocator.
 PL_DAV1D_API int pl_allocate_dav1dpicture(Dav1dPicture *picture, void *gpu);
 PL_DAV1D_API void pl_release_dav1dpicture(Dav1dPicture *picture, void *gpu);
 
@@ -502,11 +502,11 @@ PL_DAV1D_API bool pl_upload_dav1dpicture(pl_gpu gpu,
             data[p].priv = ref;
             data[p].callback = pl_dav1dpicture_unref;
         }
+    }
 
-        if (!pl_upload_plane(gpu, &out->planes[p], &tex[p], &data[p])) {
-            free(ref);
-            return false;
-        }
+    if (!pl_upload_planes(gpu, out->planes, tex, data, out->num_planes)) {
+        free(ref);
+        return false;
     }
 
     if (params->asynchronous) {
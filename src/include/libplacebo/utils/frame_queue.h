@@ -23,6 +23,23 @@
 
 PL_API_BEGIN
 
+// Rendering quality levels used by the adaptive quality controller. Each level
+// includes the degradations of all levels before it.
+enum pl_queue_quality {
+    PL_QUEUE_QUALITY_FULL = 0,          // render params are left untouched
+    PL_QUEUE_QUALITY_NO_MIXER,          // frame mixing disabled
+    PL_QUEUE_QUALITY_FAST_SCALING,      // built-in scaling instead of filters
+    PL_QUEUE_QUALITY_NO_PEAK_DETECT,    // HDR peak detection disabled
+    PL_QUEUE_QUALITY_COUNT,
+};
+
+struct pl_queue_quality_info {
+    enum pl_queue_quality level;        // new quality level
+    enum pl_queue_quality prev_level;   // previous quality level
+    float render_time;                  // smoothed render time per frame (s)
+    float budget;                       // vsync duration being targeted (s)
+};
+
 // An abstraction layer for automatically turning a conceptual stream of
 // (frame, pts) pairs, as emitted by a decoder or filter graph, into a
 // `pl_frame_mix` suitable for `pl_render_image_mix`.
@@ -132,6 +149,20 @@ PL_API void pl_queue_push(pl_queue queue, const struct pl_source_frame *frame);
 PL_API bool pl_queue_push_block(pl_queue queue, uint64_t timeout,
                                 const struct pl_source_frame *frame);
 
+// Asynchronous variant of `pl_queue_push`, intended for decoder threads that
+// should not wait for `pl_queue_update` to finish. The frame is placed into a
+// small internal ring buffer, and only inserted into the queue proper
+// (including the FPS estimation, and later mapping) by the next `pl_queue_*`
+// call on the consumer side. The queue lock is only taken when a consumer is
+// currently blocked waiting for new frames, in order to wake it up.
+//
+// Note: This may only be called from a single thread at a time. Frames
+// pushed this way are inserted before any frames subsequently pushed by
+// `pl_queue_push` or `pl_queue_push_block`. Returns false if the ring buffer
+// is full, in which case the frame was not pushed and the caller should try
+// again later (or fall back to `pl_queue_push_block`).
+PL_API bool pl_queue_push_async(pl_queue queue, const struct pl_source_frame *frame);
+
 struct pl_queue_params {
     // The PTS of the frame that will be rendered. This should be set to the
     // timestamp (in seconds) of the next vsync, relative to the initial frame.
@@ -170,6 +201,29 @@ struct pl_queue_params {
     // should instead be interpreted by the provided callback.
     uint64_t timeout;
 
+    // If nonzero, up to this many frames following `pts` will be mapped in
+    // advance by a background thread, so that `pl_queue_update` ideally only
+    // ever has to consume frames which are already resident on the GPU. This
+    // moves the cost of e.g. texture uploads off the rendering thread.
+    //
+    // Note: This means `pl_source_frame.map` may be called from a different
+    // thread than `pl_queue_update`. Requires `pl_gpu_limits.thread_safe`,
+    // and is ignored otherwise.
+    int lookahead;
+
+    // Variable refresh rate mode. If true, the queue no longer assumes a fixed
+    // vsync grid, and instead expects the display to present each source
+    // frame exactly once, at its own PTS. `pl_queue_update` then always
+    // returns (at most) a single frame, namely the last frame with a PTS not
+    // after `pts`, with `radius`, `vsync_duration` and
+    // `interpolation_threshold` being ignored. Since the resulting mix
+    // contains only one frame, no frame mixing is performed by the renderer.
+    //
+    // Use `pl_queue_vrr_timing` to find out when to present next, and (if
+    // supported) `pl_swapchain_present_timing` to measure how far the actual
+    // presentation times deviate from these targets.
+    bool vrr;
+
     // This callback will be used to pull new frames from the decoder. It may
     // block if needed. The user is responsible for setting appropriate time
     // limits and/or returning and interpreting QUEUE_MORE as sensible.
@@ -179,6 +233,11 @@ struct pl_queue_params {
     enum pl_queue_status (*get_frame)(struct pl_source_frame *out_frame,
                                       const struct pl_queue_params *params);
     void *priv;
+
+    // If present, this will be called (with `priv`) whenever the adaptive
+    // quality controller changes its level. See `pl_queue_adapt_params`.
+    // (Optional)
+    void (*quality_cb)(void *priv, const struct pl_queue_quality_info *info);
 };
 
 #define pl_queue_params(...) (&(struct pl_queue_params) { __VA_ARGS__ })
@@ -211,7 +270,49 @@ PL_API enum pl_queue_status pl_queue_update(pl_queue queue, struct pl_frame_mix
 PL_API float pl_queue_estimate_fps(pl_queue queue);
 PL_API float pl_queue_estimate_vps(pl_queue queue);
 
-// Returns the number of frames currently contained in a pl_queue.
+// Returns the target presentation time of the frame returned by the most
+// recent call to `pl_queue_update` in VRR mode (see `pl_queue_params.vrr`),
+// i.e. its PTS, in `frame_pts`, and the PTS of the frame following it in
+// `next_pts`. The latter is the time at which the caller should render and
+// present the next frame, or INFINITY if no such frame is known yet (e.g.
+// because it has not been decoded, or at EOF). Both are optional. Returns
+// false if no frame was returned in VRR mode since the last reset.
+PL_API bool pl_queue_vrr_timing(pl_queue queue, double *frame_pts, double *next_pts);
+
+// Additional consumers of the same frame queue, e.g. for rendering the same
+// stream to multiple outputs with different sizes or refresh rates. Each view
+// keeps its own PTS, vsync estimation and VRR state, and is advanced
+// independently of `pl_queue_update` and all other views, but all of them
+// share the same underlying frames. In particular, every frame is only mapped
+// once, no matter how many views end up using it. Frames are evicted only once
+// no view needs them any longer, so a view which is not regularly updated
+// pins all frames pushed after it was created.
+//
+// A new view starts out seeing all frames currently contained in the queue.
+// `pl_queue_reset` resets all views along with the queue itself. The FPS
+// estimate and adaptive quality controller remain tied to the queue, and the
+// latter only tracks `pl_queue_update`.
+//
+// Note: Views are implicitly destroyed along with the queue, and must not be
+// used afterwards. (Since API v420)
+typedef struct pl_queue_view_t *pl_queue_view;
+
+PL_API pl_queue_view pl_queue_view_create(pl_queue queue);
+PL_API void pl_queue_view_destroy(pl_queue_view *view);
+
+// Equivalent to `pl_queue_update`, `pl_queue_estimate_vps` and
+// `pl_queue_vrr_timing`, respectively, but using the state of this view.
+// A view may be updated from a different thread than other views of the same
+// queue, although calls will be serialized internally.
+PL_API enum pl_queue_status pl_queue_view_update(pl_queue_view view,
+                                                 struct pl_frame_mix *out_mix,
+                                                 const struct pl_queue_params *params);
+PL_API float pl_queue_view_estimate_vps(pl_queue_view view);
+PL_API bool pl_queue_view_vrr_timing(pl_queue_view view, double *frame_pts,
+                                     double *next_pts);
+
+// Returns the number of frames currently contained in a pl_queue, including
+// frames only retained for the sake of a view (see `pl_queue_view`).
 PL_API int pl_queue_num_frames(pl_queue queue);
 
 // Inspect the contents of the Nth queued frame. Returns false if `idx` is
@@ -225,6 +326,23 @@ PL_API int pl_queue_num_frames(pl_queue queue);
 // it is done being used by the user.
 PL_API bool pl_queue_peek(pl_queue queue, int idx, struct pl_source_frame *out);
 
+// Adaptive quality control. When enabled, `pl_queue` tracks the GPU time
+// spent rendering each frame (as measured by the dispatch timers) against the
+// vsync duration, and steps the rendering quality down while frames overrun
+// their budget, and back up once there is sufficient headroom again.
+//
+// To use it, set `pl_render_params.info_callback` to `pl_queue_render_info`
+// with `info_priv` pointing to the queue, and call `pl_queue_adapt_params`
+// once per frame on a copy of the render params, before computing the
+// mixer radius with `pl_frame_mix_radius` and calling `pl_queue_update`.
+// Returns the quality level that was applied to `params`.
+//
+// Note: Timer results are delayed by a few frames, and not supported on all
+// GPUs. Without timer results, the controller never changes the quality.
+PL_API void pl_queue_render_info(void *queue, const struct pl_render_info *info);
+PL_API enum pl_queue_quality pl_queue_adapt_params(pl_queue queue,
+                                                   struct pl_render_params *params);
+
 PL_API_END
 
 #endif // LIBPLACEBO_FRAME_QUEUE_H
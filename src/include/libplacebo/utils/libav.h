@@ -146,6 +146,25 @@ PL_LIBAV_API bool pl_test_pixfmt_caps(pl_gpu gpu, enum AVPixelFormat pixfmt,
 PL_LIBAV_API bool pl_frame_recreate_from_avframe(pl_gpu gpu, struct pl_frame *out_frame,
                                                  pl_tex tex[4], const AVFrame *frame);
 
+// Cache of texture wrappers for hardware decoded frames, which can be used
+// to avoid re-wrapping the same decoder surfaces on every call to
+// `pl_map_avframe_ex`. Currently only used for AV_PIX_FMT_VULKAN, where the
+// `pl_tex` wrapping each VkImage of the frame pool is kept alive and reused
+// for as long as frames keep coming from the same `hw_frames_ctx`. It also
+// keeps the most recent Dolby Vision RPU, so consecutive frames with the same
+// RPU share the same (refcounted) mapped `pl_dovi_metadata`.
+//
+// Note: The cache keeps a reference to the current `hw_frames_ctx`, and is
+// not thread-safe. All calls to `pl_map_avframe_ex` and `pl_unmap_avframe`
+// on frames using the same cache must be externally synchronized.
+typedef struct pl_avframe_cache_t *pl_avframe_cache;
+
+PL_LIBAV_API pl_avframe_cache pl_avframe_cache_create(pl_gpu gpu);
+
+// Destroys all cached wrappers. Must not be called while any frames mapped
+// using this cache are still mapped.
+PL_LIBAV_API void pl_avframe_cache_destroy(pl_avframe_cache *cache);
+
 struct pl_avframe_params {
     // The AVFrame to map. Required.
     const AVFrame *frame;
@@ -158,6 +177,17 @@ struct pl_avframe_params {
     // creation/destruction overhead.
     pl_tex *tex;
 
+    // If set, replacement textures for `tex` are taken from this pool, and
+    // incompatible textures are returned to it. (Optional)
+    pl_tex_pool pool;
+
+    // If set, hardware frame wrappers are taken from and returned to this
+    // cache, instead of being created and destroyed for every frame. This is
+    // also used to deduplicate Dolby Vision metadata, so that consecutive
+    // frames with identical RPUs share the same `pl_dovi_metadata`.
+    // (Optional)
+    pl_avframe_cache cache;
+
     // Also map Dolby Vision metadata (if supported). Note that this also
     // overrides the colorimetry metadata (forces BT.2020+PQ).
     bool map_dovi;
@@ -175,6 +205,14 @@ struct pl_avframe_params {
 //
 // Note: `out_frame->user_data` points to a privately managed opaque struct
 // and must not be touched by the user.
+//
+// Note: Mapping hardware frames does not submit any GPU work by itself. For
+// AV_PIX_FMT_VULKAN, the images are only wrapped here, and the semaphore
+// waits and layout transitions are deferred until the frame is acquired by
+// the renderer, where they get recorded into the same command buffer as the
+// first use of the frame. Pre-mapping several frames ahead of time (e.g.
+// from a `pl_queue` map callback) therefore needs no explicit batching, and
+// `cache` avoids re-wrapping the same images for every frame.
 PL_LIBAV_API bool pl_map_avframe_ex(pl_gpu gpu, struct pl_frame *out_frame,
                                     const struct pl_avframe_params *params);
 PL_LIBAV_API void pl_unmap_avframe(pl_gpu gpu, struct pl_frame *frame);
@@ -198,6 +236,49 @@ PL_LIBAV_API bool pl_download_avframe(pl_gpu gpu,
                                       const struct pl_frame *frame,
                                       AVFrame *out_frame);
 
+// Pipelined asynchronous readback of rendered frames into `AVFrame`s, e.g.
+// for feeding an encoder. Each pushed frame is downloaded into a host-mapped
+// `pl_buf`, and completed downloads are handed out as `AVFrame`s referencing
+// that buffer directly (zero-copy). Up to `depth` downloads are kept in flight
+// concurrently, so the GPU never has to wait for the consumer and vice versa.
+// Buffers are recycled once all references to the returned frames are freed.
+//
+// Requires `pl_gpu_limits.thread_safe` and `pl_gpu_limits.buf_transfer`, as
+// well as libavutil 56.67.100 or newer.
+typedef struct pl_download_queue_t *pl_download_queue;
+
+struct pl_download_queue_params {
+    // Pixel format and dimensions of the downloaded frames. Required.
+    enum AVPixelFormat format;
+    int width, height;
+
+    // Maximum number of downloads in flight. If 0, defaults to 3.
+    int depth;
+};
+
+#define pl_download_queue_params(...) (&(struct pl_download_queue_params) { __VA_ARGS__ })
+
+// Returns NULL if the format is unsupported, or the requirements are not met.
+PL_LIBAV_API pl_download_queue pl_download_queue_create(pl_gpu gpu,
+                                const struct pl_download_queue_params *params);
+
+// Pending downloads are discarded. Frames previously returned by
+// `pl_download_queue_pop` remain valid.
+PL_LIBAV_API void pl_download_queue_destroy(pl_download_queue *queue);
+
+// Starts downloading `frame`, whose planes must be host-readable textures
+// matching the queue's pixel format. Frame properties (timestamps etc.) are
+// copied from `props`, if set. Returns false if `depth` downloads are already
+// in flight (in which case the oldest must be popped first), or on error.
+PL_LIBAV_API bool pl_download_queue_push(pl_download_queue queue,
+                                         const struct pl_frame *frame,
+                                         const AVFrame *props);
+
+// Returns the oldest download as a new `AVFrame`, or NULL if none is ready.
+// If `block` is true, waits for the oldest download in flight (if any) to
+// complete instead. The result must be freed with `av_frame_free`.
+PL_LIBAV_API AVFrame *pl_download_queue_pop(pl_download_queue queue, bool block);
+
 // Helper functions to update the colorimetry data in an AVFrame based on
 // the values specified in the given color space / color repr / profile.
 //
@@ -235,6 +316,29 @@ PL_LIBAV_API int pl_plane_data_from_pixfmt(struct pl_plane_data data[4],
 // That is, it should have type `pl_gpu *`.
 PL_LIBAV_API int pl_get_buffer2(AVCodecContext *avctx, AVFrame *pic, int flags);
 
+// Pool of persistently mapped buffers for `pl_get_buffer2_pooled`. Buffers are
+// grouped into size classes and recycled across frames, instead of creating
+// and destroying a `pl_buf` for every decoded frame. Returns NULL if the GPU
+// does not support persistently mapped host buffers, or if libavutil is older
+// than 56.67.100.
+//
+// Note: A pool must only be used by a single AVCodecContext, since it relies
+// on libavcodec never calling `get_buffer2` concurrently.
+typedef struct pl_avbuffer_pool_t *pl_avbuffer_pool;
+
+PL_LIBAV_API pl_avbuffer_pool pl_avbuffer_pool_create(pl_gpu gpu);
+
+// Destroys the pool. Buffers still referenced by frames remain valid, and are
+// freed once the last reference is released. The `pl_gpu` must outlive them.
+PL_LIBAV_API void pl_avbuffer_pool_destroy(pl_avbuffer_pool *pool);
+
+// Like `pl_get_buffer2`, but recycles buffers from a `pl_avbuffer_pool`.
+//
+// Note: `avctx->opaque` must be the `pl_avbuffer_pool` itself, which is
+// allowed to be NULL (in which case this falls back to the default
+// allocator).
+PL_LIBAV_API int pl_get_buffer2_pooled(AVCodecContext *avctx, AVFrame *pic, int flags);
+
 // Mapping functions for the various libavutil enums. Note that these are not
 // quite 1:1, and even for values that exist in both, the semantics sometimes
 // differ. Some special cases (e.g. ICtCp, or XYZ) are handled differently in
@@ -870,28 +870,34 @@ PL_LIBAV_API void pl_map_dovi_metadata(struct pl_dovi_metadata *out,
     }
 }
 
+// Attaches already mapped Dolby Vision metadata to a frame
+static void pl_frame_set_avdovi_metadata(struct pl_frame *out_frame,
+                                         const struct pl_dovi_metadata *dovi,
+                                         const AVDOVIMetadata *metadata)
+{
+    const AVDOVIColorMetadata *color = av_dovi_get_color(metadata);
+    out_frame->repr.dovi = dovi;
+    out_frame->repr.sys = PL_COLOR_SYSTEM_DOLBYVISION;
+    out_frame->color.primaries = PL_COLOR_PRIM_BT_2020;
+    out_frame->color.transfer = PL_COLOR_TRC_PQ;
+    out_frame->color.hdr.min_luma =
+        pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, color->source_min_pq / 4095.0f);
+    out_frame->color.hdr.max_luma =
+        pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, color->source_max_pq / 4095.0f);
+}
+
 PL_LIBAV_API void pl_frame_map_avdovi_metadata(struct pl_frame *out_frame,
                                                struct pl_dovi_metadata *dovi,
                                                const AVDOVIMetadata *metadata)
 {
     const AVDOVIRpuDataHeader *header;
-    const AVDOVIColorMetadata *color;
     if (!dovi || !metadata)
         return;
 
     header = av_dovi_get_header(metadata);
-    color = av_dovi_get_color(metadata);
     if (header->disable_residual_flag) {
         pl_map_dovi_metadata(dovi, metadata);
-
-        out_frame->repr.dovi = dovi;
-        out_frame->repr.sys = PL_COLOR_SYSTEM_DOLBYVISION;
-        out_frame->color.primaries = PL_COLOR_PRIM_BT_2020;
-        out_frame->color.transfer = PL_COLOR_TRC_PQ;
-        out_frame->color.hdr.min_luma =
-            pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, color->source_min_pq / 4095.0f);
-        out_frame->color.hdr.max_luma =
-            pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, color->source_max_pq / 4095.0f);
+        pl_frame_set_avdovi_metadata(out_frame, dovi, metadata);
     }
 }
 #endif // PL_HAVE_LAV_DOLBY_VISION
@@ -935,15 +941,80 @@ struct pl_avalloc {
     uint32_t magic[2];
     pl_gpu gpu;
     pl_buf buf;
+    AVBufferRef *pool_ref; // pool entry backing this allocation, if pooled
 };
 
 // Attached to `pl_frame.user_data` for mapped AVFrames
 struct pl_avframe_priv {
     AVFrame *avframe;
     struct pl_dovi_metadata dovi; // backing storage for per-frame dovi metadata
+    AVBufferRef *dovi_ref; // shared dovi metadata from `cache`, or NULL
     pl_tex planar; // for planar vulkan textures
+    pl_avframe_cache cache;
+    int cache_idx[4]; // index into `cache->entries`, or -1 if not cached
 };
 
+#ifdef PL_HAVE_LAV_VULKAN
+struct pl_avframe_cache_entry {
+    VkImage image;
+    int w, h;
+    pl_tex tex;
+    bool in_use;
+};
+#endif
+
+struct pl_avframe_cache_t {
+    pl_gpu gpu;
+    AVBufferRef *hw_frames_ctx; // frame pool that all `entries` belong to
+#ifdef PL_HAVE_LAV_DOLBY_VISION
+    // Most recently mapped Dolby Vision RPU, shared by all subsequent frames
+    // carrying an identical `AVDOVIMetadata` payload
+    AVBufferRef *dovi_src; // AVDOVIMetadata side data
+    AVBufferRef *dovi;     // mapped `struct pl_dovi_metadata`
+#endif
+#ifdef PL_HAVE_LAV_VULKAN
+    struct pl_avframe_cache_entry *entries;
+    int num_entries;
+#endif
+};
+
+PL_LIBAV_API pl_avframe_cache pl_avframe_cache_create(pl_gpu gpu)
+{
+    pl_avframe_cache cache = calloc(1, sizeof(*cache));
+    if (cache)
+        cache->gpu = gpu;
+    return cache;
+}
+
+static void pl_avframe_cache_flush(pl_avframe_cache cache)
+{
+#ifdef PL_HAVE_LAV_VULKAN
+    for (int i = 0; i < cache->num_entries; i++) {
+        assert(!cache->entries[i].in_use);
+        pl_tex_destroy(cache->gpu, &cache->entries[i].tex);
+    }
+    cache->num_entries = 0;
+#endif
+    av_buffer_unref(&cache->hw_frames_ctx);
+}
+
+PL_LIBAV_API void pl_avframe_cache_destroy(pl_avframe_cache *cache)
+{
+    if (!*cache)
+        return;
+
+    pl_avframe_cache_flush(*cache);
+#ifdef PL_HAVE_LAV_VULKAN
+    free((*cache)->entries);
+#endif
+#ifdef PL_HAVE_LAV_DOLBY_VISION
+    av_buffer_unref(&(*cache)->dovi_src);
+    av_buffer_unref(&(*cache)->dovi);
+#endif
+    free(*cache);
+    *cache = NULL;
+}
+
 static void pl_fix_hwframe_sample_depth(struct pl_frame *out, const AVFrame *frame)
 {
     const AVHWFramesContext *hwfc = (AVHWFramesContext *) frame->hw_frames_ctx->data;
@@ -1092,6 +1163,64 @@ static void pl_release_avframe(pl_gpu gpu, struct pl_frame *frame)
 #endif
 }
 
+// Wraps plane `n` of a Vulkan frame, reusing a cached wrapper if possible
+static pl_tex pl_avframe_wrap_vulkan(pl_gpu gpu, struct pl_avframe_priv *priv,
+                                     const AVFrame *frame, int n,
+                                     const struct pl_vulkan_wrap_params *params)
+{
+    pl_avframe_cache cache = priv->cache;
+    struct pl_avframe_cache_entry *entries;
+    pl_tex tex;
+
+    if (!cache)
+        return pl_vulkan_wrap(gpu, params);
+
+    if (!cache->hw_frames_ctx || cache->hw_frames_ctx->data != frame->hw_frames_ctx->data) {
+        // Frame pool changed, so the previous wrappers are useless. Bypass
+        // the cache as long as any frames from the old pool remain mapped.
+        for (int i = 0; i < cache->num_entries; i++) {
+            if (cache->entries[i].in_use)
+                return pl_vulkan_wrap(gpu, params);
+        }
+
+        pl_avframe_cache_flush(cache);
+        cache->hw_frames_ctx = av_buffer_ref(frame->hw_frames_ctx);
+        if (!cache->hw_frames_ctx)
+            return pl_vulkan_wrap(gpu, params);
+    }
+
+    for (int i = 0; i < cache->num_entries; i++) {
+        struct pl_avframe_cache_entry *e = &cache->entries[i];
+        if (e->in_use || e->image != params->image)
+            continue;
+        if (e->w != params->width || e->h != params->height)
+            continue;
+
+        e->in_use = true;
+        priv->cache_idx[n] = i;
+        return e->tex;
+    }
+
+    tex = pl_vulkan_wrap(gpu, params);
+    if (!tex)
+        return NULL;
+
+    entries = realloc(cache->entries, (cache->num_entries + 1) * sizeof(*entries));
+    if (!entries)
+        return tex; // fall back to an uncached wrapper
+
+    cache->entries = entries;
+    entries[cache->num_entries] = (struct pl_avframe_cache_entry) {
+        .image  = params->image,
+        .w      = params->width,
+        .h      = params->height,
+        .tex    = tex,
+        .in_use = true,
+    };
+    priv->cache_idx[n] = cache->num_entries++;
+    return tex;
+}
+
 static bool pl_map_avframe_vulkan(pl_gpu gpu, struct pl_frame *out,
                                   const AVFrame *frame)
 {
@@ -1119,13 +1248,14 @@ static bool pl_map_avframe_vulkan(pl_gpu gpu, struct pl_frame *out,
         int num_subplanes;
         assert(vk_fmt[n]);
 
-        plane->texture = pl_vulkan_wrap(gpu, pl_vulkan_wrap_params(
-            .image  = vkf->img[n],
-            .width  = AV_CEIL_RSHIFT(frame->width, chroma ? desc->log2_chroma_w : 0),
-            .height = AV_CEIL_RSHIFT(frame->height, chroma ? desc->log2_chroma_h : 0),
-            .format = vk_fmt[n],
-            .usage  = vkfc->usage,
-        ));
+        plane->texture = pl_avframe_wrap_vulkan(gpu, priv, frame, n,
+            pl_vulkan_wrap_params(
+                .image  = vkf->img[n],
+                .width  = AV_CEIL_RSHIFT(frame->width, chroma ? desc->log2_chroma_w : 0),
+                .height = AV_CEIL_RSHIFT(frame->height, chroma ? desc->log2_chroma_h : 0),
+                .format = vk_fmt[n],
+                .usage  = vkfc->usage,
+            ));
         if (!plane->texture)
             return false;
 
@@ -1148,6 +1278,22 @@ static bool pl_map_avframe_vulkan(pl_gpu gpu, struct pl_frame *out,
 static void pl_unmap_avframe_vulkan(pl_gpu gpu, struct pl_frame *frame)
 {
     struct pl_avframe_priv *priv = frame->user_data;
+    for (int n = 0; priv->cache && n < 4; n++) {
+        if (priv->cache_idx[n] < 0)
+            continue;
+
+        // Return the wrapper to the cache instead of destroying it
+        priv->cache->entries[priv->cache_idx[n]].in_use = false;
+        priv->cache_idx[n] = -1;
+        if (priv->planar) {
+            priv->planar = NULL;
+            for (int i = 0; i < frame->num_planes; i++)
+                frame->planes[i].texture = NULL;
+        } else {
+            frame->planes[n].texture = NULL;
+        }
+    }
+
     if (priv->planar) {
         pl_tex_destroy(gpu, &priv->planar);
         for (int n = 0; n < frame->num_planes; n++)
@@ -1156,6 +1302,38 @@ static void pl_unmap_avframe_vulkan(pl_gpu gpu, struct pl_frame *frame)
 }
 #endif
 
+#ifdef PL_HAVE_LAV_DOLBY_VISION
+// Returns the `pl_dovi_metadata` shared by all frames mapped from `cache` with
+// the same RPU payload as `sd`, mapping it only if the RPU actually changed.
+// RPUs mostly repeat for entire scenes, so this avoids re-mapping and copying
+// the (large) reshaping metadata for every single frame. Returns NULL on
+// allocation failure.
+static const struct pl_dovi_metadata *pl_avframe_cache_dovi(pl_avframe_cache cache,
+                                                            struct pl_avframe_priv *priv,
+                                                            const AVFrameSideData *sd)
+{
+    const AVBufferRef *src = cache->dovi_src;
+    if (!cache->dovi || !src || src->size != sd->buf->size ||
+        memcmp(src->data, sd->buf->data, src->size))
+    {
+        AVBufferRef *dovi = av_buffer_allocz(sizeof(struct pl_dovi_metadata));
+        if (!dovi)
+            return NULL;
+
+        pl_map_dovi_metadata((struct pl_dovi_metadata *) dovi->data,
+                             (const AVDOVIMetadata *) sd->data);
+        av_buffer_unref(&cache->dovi);
+        av_buffer_unref(&cache->dovi_src);
+        cache->dovi = dovi;
+        cache->dovi_src = av_buffer_ref(sd->buf); // may fail, harmlessly
+    }
+
+    assert(!priv->dovi_ref);
+    priv->dovi_ref = av_buffer_ref(cache->dovi);
+    return priv->dovi_ref ? (const struct pl_dovi_metadata *) priv->dovi_ref->data : NULL;
+}
+#endif
+
 PL_LIBAV_API bool pl_map_avframe_ex(pl_gpu gpu, struct pl_frame *out,
                                     const struct pl_avframe_params *params)
 {
@@ -1171,6 +1349,10 @@ PL_LIBAV_API bool pl_map_avframe_ex(pl_gpu gpu, struct pl_frame *out,
 
     pl_frame_from_avframe(out, frame);
     priv->avframe = av_frame_clone(frame);
+    priv->cache = params->cache;
+    priv->dovi_ref = NULL;
+    for (int i = 0; i < 4; i++)
+        priv->cache_idx[i] = -1;
     out->user_data = priv;
 
 #ifdef PL_HAVE_LAV_DOLBY_VISION
@@ -1179,9 +1361,16 @@ PL_LIBAV_API bool pl_map_avframe_ex(pl_gpu gpu, struct pl_frame *out,
         if (sd) {
             const AVDOVIMetadata *metadata = (AVDOVIMetadata *) sd->data;
             const AVDOVIRpuDataHeader *header = av_dovi_get_header(metadata);
+            const struct pl_dovi_metadata *dovi;
             // Only automatically map DoVi RPUs that don't require an EL
-            if (header->disable_residual_flag)
-                pl_frame_map_avdovi_metadata(out, &priv->dovi, metadata);
+            if (header->disable_residual_flag) {
+                dovi = params->cache ? pl_avframe_cache_dovi(params->cache, priv, sd) : NULL;
+                if (dovi) {
+                    pl_frame_set_avdovi_metadata(out, dovi, metadata);
+                } else {
+                    pl_frame_map_avdovi_metadata(out, &priv->dovi, metadata);
+                }
+            }
         }
 
 #ifdef PL_HAVE_LIBDOVI
@@ -1249,6 +1438,7 @@ PL_LIBAV_API bool pl_map_avframe_ex(pl_gpu gpu, struct pl_frame *out,
             data[p].priv = av_frame_clone(frame);
         }
 
+        data[p].pool = params->pool;
         if (!pl_upload_plane(gpu, &out->planes[p], &tex[p], &data[p])) {
             av_frame_free((AVFrame **) &data[p].priv);
             goto error;
@@ -1293,6 +1483,7 @@ PL_LIBAV_API void pl_unmap_avframe(pl_gpu gpu, struct pl_frame *frame)
     }
 
     av_frame_free(&priv->avframe);
+    av_buffer_unref(&priv->dovi_ref);
     free(priv);
 
 done:
@@ -1356,7 +1547,173 @@ static inline void pl_avalloc_free(void *opaque, uint8_t *data)
     free(alloc);
 }
 
-PL_LIBAV_API int pl_get_buffer2(AVCodecContext *avctx, AVFrame *pic, int flags)
+#define PL_AVPOOL_CLASSES 8
+#define PL_AVPOOL_CLASS_ALIGN (1 << 16)
+
+struct pl_avbuffer_pool_class {
+    size_t size;
+    bool storable;
+    AVBufferPool *pool;
+    uint64_t last_used;
+};
+
+struct pl_avbuffer_pool_t {
+    pl_gpu gpu;
+    struct pl_avbuffer_pool_class classes[PL_AVPOOL_CLASSES];
+    uint64_t counter;
+};
+
+PL_LIBAV_API pl_avbuffer_pool pl_avbuffer_pool_create(pl_gpu gpu)
+{
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 67, 100)
+    pl_avbuffer_pool pool;
+    if (!gpu->limits.thread_safe || !gpu->limits.max_mapped_size ||
+        !gpu->limits.host_cached)
+    {
+        return NULL;
+    }
+
+    pool = calloc(1, sizeof(*pool));
+    if (pool)
+        pool->gpu = gpu;
+    return pool;
+#else
+    return NULL;
+#endif
+}
+
+PL_LIBAV_API void pl_avbuffer_pool_destroy(pl_avbuffer_pool *ppool)
+{
+    pl_avbuffer_pool pool = *ppool;
+    if (!pool)
+        return;
+
+    // Buffers still referenced by frames are freed along with them
+    for (int i = 0; i < PL_AVPOOL_CLASSES; i++)
+        av_buffer_pool_uninit(&pool->classes[i].pool);
+    free(pool);
+    *ppool = NULL;
+}
+
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 67, 100)
+static AVBufferRef *pl_avbuffer_pool_alloc(pl_gpu gpu, size_t size, bool storable)
+{
+    AVBufferRef *ref;
+    struct pl_avalloc *alloc = malloc(sizeof(*alloc));
+    if (!alloc)
+        return NULL;
+
+    *alloc = (struct pl_avalloc) {
+        .magic = { PL_MAGIC0, PL_MAGIC1 },
+        .gpu = gpu,
+        .buf = pl_buf_create(gpu, pl_buf_params(
+            .size = size,
+            .memory_type = PL_BUF_MEM_HOST,
+            .host_mapped = true,
+            .storable = storable,
+        )),
+    };
+
+    if (!alloc->buf) {
+        free(alloc);
+        return NULL;
+    }
+
+    ref = av_buffer_create(alloc->buf->data, size, pl_avalloc_free, alloc, 0);
+    if (!ref) {
+        pl_buf_destroy(gpu, &alloc->buf);
+        free(alloc);
+    }
+
+    return ref;
+}
+
+#if LIBAVUTIL_VERSION_MAJOR < 57
+static AVBufferRef *pl_avbuffer_pool_alloc_buf(void *opaque, int size)
+#else
+static AVBufferRef *pl_avbuffer_pool_alloc_buf(void *opaque, size_t size)
+#endif
+{
+    pl_avbuffer_pool pool = opaque;
+    return pl_avbuffer_pool_alloc(pool->gpu, size, false);
+}
+
+#if LIBAVUTIL_VERSION_MAJOR < 57
+static AVBufferRef *pl_avbuffer_pool_alloc_storable(void *opaque, int size)
+#else
+static AVBufferRef *pl_avbuffer_pool_alloc_storable(void *opaque, size_t size)
+#endif
+{
+    pl_avbuffer_pool pool = opaque;
+    return pl_avbuffer_pool_alloc(pool->gpu, size, true);
+}
+
+// Returns the pool entry backing a frame buffer once the frame is freed
+static void pl_avbuffer_pool_release(void *opaque, uint8_t *data)
+{
+    struct pl_avalloc *alloc = opaque;
+    AVBufferRef *ref = alloc->pool_ref;
+    assert(ref && ref->data == data);
+    alloc->pool_ref = NULL;
+    av_buffer_unref(&ref);
+}
+
+// Returns a new reference to a pooled buffer of at least `size` bytes, whose
+// opaque is the `pl_avalloc` describing it (so that it can be probed the same
+// way as the buffers allocated by `pl_get_buffer2`)
+static AVBufferRef *pl_avbuffer_pool_get(pl_avbuffer_pool pool, size_t size,
+                                         bool storable)
+{
+    struct pl_avbuffer_pool_class *cls = NULL, *lru = &pool->classes[0];
+    struct pl_avalloc *alloc;
+    AVBufferRef *ref, *pool_ref;
+
+    size = PL_ALIGN(size, PL_AVPOOL_CLASS_ALIGN);
+    for (int i = 0; i < PL_AVPOOL_CLASSES; i++) {
+        struct pl_avbuffer_pool_class *c = &pool->classes[i];
+        if (c->pool && c->size == size && c->storable == storable) {
+            cls = c;
+            break;
+        }
+        if (!c->pool || (lru->pool && c->last_used < lru->last_used))
+            lru = c;
+    }
+
+    if (!cls) {
+        // Evict the least recently used size class, e.g. after a resolution
+        // change. Its buffers are freed once no longer referenced.
+        cls = lru;
+        av_buffer_pool_uninit(&cls->pool);
+        cls->size = size;
+        cls->storable = storable;
+        cls->pool = av_buffer_pool_init2(size, pool, storable
+                                            ? pl_avbuffer_pool_alloc_storable
+                                            : pl_avbuffer_pool_alloc_buf, NULL);
+        if (!cls->pool)
+            return NULL;
+    }
+
+    cls->last_used = ++pool->counter;
+    pool_ref = av_buffer_pool_get(cls->pool);
+    if (!pool_ref)
+        return NULL;
+
+    alloc = av_buffer_pool_buffer_get_opaque(pool_ref);
+    assert(!alloc->pool_ref);
+    alloc->pool_ref = pool_ref;
+    ref = av_buffer_create(pool_ref->data, pool_ref->size,
+                           pl_avbuffer_pool_release, alloc, 0);
+    if (!ref) {
+        alloc->pool_ref = NULL;
+        av_buffer_unref(&pool_ref);
+    }
+
+    return ref;
+}
+#endif
+
+static int pl_get_buffer2_impl(AVCodecContext *avctx, AVFrame *pic, int flags,
+                               pl_gpu gpu, pl_avbuffer_pool pool)
 {
     int alignment[AV_NUM_DATA_POINTERS];
     int width = pic->width;
@@ -1364,8 +1721,6 @@ PL_LIBAV_API int pl_get_buffer2(AVCodecContext *avctx, AVFrame *pic, int flags)
     size_t planesize[4];
     int ret = 0;
 
-    pl_gpu *pgpu = avctx->opaque;
-    pl_gpu gpu = pgpu ? *pgpu : NULL;
     struct pl_plane_data data[4];
     struct pl_avalloc *alloc;
     const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(pic->format);
@@ -1419,6 +1774,21 @@ PL_LIBAV_API int pl_get_buffer2(AVCodecContext *avctx, AVFrame *pic, int flags)
             goto fallback;
         }
 
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 67, 100)
+        if (pool) {
+            pic->buf[p] = pl_avbuffer_pool_get(pool, buf_size,
+                                               desc->flags & AV_PIX_FMT_FLAG_BE);
+            if (!pic->buf[p]) {
+                av_frame_unref(pic);
+                return AVERROR(ENOMEM);
+            }
+
+            alloc = av_buffer_get_opaque(pic->buf[p]);
+            pic->data[p] = (uint8_t *) PL_ALIGN((uintptr_t) alloc->buf->data, alignment[p]);
+            continue;
+        }
+#endif
+
         alloc = malloc(sizeof(*alloc));
         if (!alloc) {
             av_frame_unref(pic);
@@ -1458,8 +1828,247 @@ fallback:
     return avcodec_default_get_buffer2(avctx, pic, flags);
 }
 
+PL_LIBAV_API int pl_get_buffer2(AVCodecContext *avctx, AVFrame *pic, int flags)
+{
+    pl_gpu *pgpu = avctx->opaque;
+    return pl_get_buffer2_impl(avctx, pic, flags, pgpu ? *pgpu : NULL, NULL);
+}
+
+PL_LIBAV_API int pl_get_buffer2_pooled(AVCodecContext *avctx, AVFrame *pic, int flags)
+{
+    pl_avbuffer_pool pool = avctx->opaque;
+    return pl_get_buffer2_impl(avctx, pic, flags, pool ? pool->gpu : NULL, pool);
+}
+
+struct pl_download_slot {
+    AVBufferRef *buf;
+    AVFrame *props;
+};
+
+struct pl_download_queue_t {
+    pl_gpu gpu;
+    AVBufferPool *pool;
+    struct pl_download_queue_params params;
+    int planes;
+    size_t size;
+    size_t offset[4];
+    int linesize[4];
+
+    // Downloads in flight, in submission order
+    struct pl_download_slot *slots;
+    int num_slots;
+};
+
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 67, 100)
+#if LIBAVUTIL_VERSION_MAJOR < 57
+static AVBufferRef *pl_download_queue_alloc(void *opaque, int size)
+#else
+static AVBufferRef *pl_download_queue_alloc(void *opaque, size_t size)
+#endif
+{
+    pl_download_queue queue = opaque;
+    AVBufferRef *ref;
+    struct pl_avalloc *alloc = malloc(sizeof(*alloc));
+    if (!alloc)
+        return NULL;
+
+    *alloc = (struct pl_avalloc) {
+        .magic = { PL_MAGIC0, PL_MAGIC1 },
+        .gpu = queue->gpu,
+        .buf = pl_buf_create(queue->gpu, pl_buf_params(
+            .size = size,
+            .memory_type = PL_BUF_MEM_HOST,
+            .host_mapped = true,
+        )),
+    };
+
+    if (!alloc->buf) {
+        free(alloc);
+        return NULL;
+    }
+
+    ref = av_buffer_create(alloc->buf->data, size, pl_avalloc_free, alloc, 0);
+    if (!ref) {
+        pl_buf_destroy(queue->gpu, &alloc->buf);
+        free(alloc);
+    }
+
+    return ref;
+}
+#endif
+
+PL_LIBAV_API pl_download_queue pl_download_queue_create(pl_gpu gpu,
+                                const struct pl_download_queue_params *params)
+{
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 67, 100)
+    struct pl_plane_data data[4];
+    size_t planesize[4];
+    size_t align, size = 0;
+    pl_download_queue queue;
+    int planes = pl_plane_data_from_pixfmt(data, NULL, params->format);
+    if (!planes || !gpu->limits.thread_safe || !gpu->limits.buf_transfer)
+        return NULL;
+
+    queue = calloc(1, sizeof(*queue));
+    if (!queue)
+        return NULL;
+
+    queue->gpu = gpu;
+    queue->params = *params;
+    queue->params.depth = params->depth ? params->depth : 3;
+    queue->planes = planes;
+    queue->slots = calloc(queue->params.depth, sizeof(*queue->slots));
+    if (!queue->slots)
+        goto error;
+
+    if (av_image_fill_linesizes(queue->linesize, params->format, params->width) < 0)
+        goto error;
+
+    for (int p = 0; p < planes; p++) {
+        align = PL_LCM(gpu->limits.align_tex_xfer_pitch, data[p].pixel_stride);
+        queue->linesize[p] = PL_ALIGN(queue->linesize[p], align);
+    }
+
+    if (av_image_fill_plane_sizes(planesize, params->format, params->height, (ptrdiff_t[4]) {
+            queue->linesize[0], queue->linesize[1], queue->linesize[2], queue->linesize[3],
+        }) < 0)
+    {
+        goto error;
+    }
+
+    for (int p = 0; p < planes; p++) {
+        align = PL_LCM(gpu->limits.align_tex_xfer_offset, data[p].pixel_stride);
+        size = PL_ALIGN(size, PL_MAX(align, 64));
+        queue->offset[p] = size;
+        size += planesize[p];
+    }
+
+    if (size > gpu->limits.max_mapped_size)
+        goto error;
+
+    queue->size = size;
+    queue->pool = av_buffer_pool_init2(size, queue, pl_download_queue_alloc, NULL);
+    if (!queue->pool)
+        goto error;
+
+    return queue;
+
+error:
+    free(queue->slots);
+    free(queue);
+#endif
+    return NULL;
+}
+
+PL_LIBAV_API void pl_download_queue_destroy(pl_download_queue *pqueue)
+{
+    pl_download_queue queue = *pqueue;
+    if (!queue)
+        return;
+
+    for (int i = 0; i < queue->num_slots; i++) {
+        av_buffer_unref(&queue->slots[i].buf);
+        av_frame_free(&queue->slots[i].props);
+    }
+
+    // Buffers still referenced by returned frames are freed along with them
+    av_buffer_pool_uninit(&queue->pool);
+    free(queue->slots);
+    free(queue);
+    *pqueue = NULL;
+}
+
+PL_LIBAV_API bool pl_download_queue_push(pl_download_queue queue,
+                                         const struct pl_frame *frame,
+                                         const AVFrame *props)
+{
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 67, 100)
+    struct pl_download_slot slot = {0};
+    const struct pl_avalloc *alloc;
+    if (queue->num_slots == queue->params.depth)
+        return false;
+    if (frame->num_planes != queue->planes)
+        return false;
+
+    slot.buf = av_buffer_pool_get(queue->pool);
+    if (!slot.buf)
+        return false;
+
+    alloc = av_buffer_pool_buffer_get_opaque(slot.buf);
+    for (int p = 0; p < frame->num_planes; p++) {
+        bool ok = pl_tex_download(queue->gpu, pl_tex_transfer_params(
+            .tex        = frame->planes[p].texture,
+            .row_pitch  = queue->linesize[p],
+            .buf        = alloc->buf,
+            .buf_offset = queue->offset[p],
+        ));
+
+        if (!ok)
+            goto error;
+    }
+
+    if (props) {
+        slot.props = av_frame_alloc();
+        if (!slot.props || av_frame_copy_props(slot.props, props) < 0)
+            goto error;
+    }
+
+    queue->slots[queue->num_slots++] = slot;
+    pl_gpu_flush(queue->gpu);
+    return true;
+
+error:
+    av_frame_free(&slot.props);
+    av_buffer_unref(&slot.buf);
+#endif
+    return false;
+}
+
+PL_LIBAV_API AVFrame *pl_download_queue_pop(pl_download_queue queue, bool block)
+{
+#if LIBAVUTIL_VERSION_INT >= AV_VERSION_INT(56, 67, 100)
+    struct pl_download_slot *slot = &queue->slots[0];
+    const struct pl_avalloc *alloc;
+    AVFrame *out;
+    if (!queue->num_slots)
+        return NULL;
+
+    alloc = av_buffer_pool_buffer_get_opaque(slot->buf);
+    if (pl_buf_poll(queue->gpu, alloc->buf, block ? UINT64_MAX : 0))
+        return NULL;
+
+    out = av_frame_alloc();
+    if (!out)
+        return NULL;
+    if (slot->props && av_frame_copy_props(out, slot->props) < 0) {
+        av_frame_free(&out);
+        return NULL;
+    }
+
+    out->format = queue->params.format;
+    out->width  = queue->params.width;
+    out->height = queue->params.height;
+    for (int p = 0; p < queue->planes; p++) {
+        out->data[p] = slot->buf->data + queue->offset[p];
+        out->linesize[p] = queue->linesize[p];
+    }
+
+    // Transfer ownership of the buffer to the frame
+    out->buf[0] = slot->buf;
+    av_frame_free(&slot->props);
+    memmove(&queue->slots[0], &queue->slots[1],
+            (queue->num_slots - 1) * sizeof(*queue->slots));
+    queue->num_slots--;
+    return out;
+#else
+    return NULL;
+#endif
+}
+
 #undef PL_MAGIC0
 #undef PL_MAGIC1
+#undef PL_AVPOOL_CLASSES
+#undef PL_AVPOOL_CLASS_ALIGN
 #undef PL_ALIGN
 #undef PL_MAX
 
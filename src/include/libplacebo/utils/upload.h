@@ -29,6 +29,34 @@ PL_API_BEGIN
 // memory to a texture. In particular, the texture will be suitable for use as
 // a `pl_plane`.
 
+// Bounded pool of recycled textures. This can be used to avoid creating and
+// destroying texture objects when uploading every frame into a fresh set of
+// textures, e.g. when decoding into a new slot per frame. Textures handed
+// back to the pool are preferably only reused once the GPU is done with them
+// (according to `pl_tex_poll`).
+//
+// Note: All `pl_tex_pool_*` functions are thread-safe.
+typedef struct pl_tex_pool_t *pl_tex_pool;
+
+// Create a texture pool retaining up to `max_textures` unused textures. If
+// this is 0, a sensible default is used instead.
+PL_API pl_tex_pool pl_tex_pool_create(pl_gpu gpu, int max_textures);
+
+// Destroys the pool, as well as all unused textures still held by it.
+// Textures taken from the pool are not affected.
+PL_API void pl_tex_pool_destroy(pl_tex_pool *pool);
+
+// Like `pl_tex_recreate`, except that an incompatible `*tex` is returned to
+// the pool instead of being destroyed, and replaced by a compatible texture
+// taken from the pool (or newly created, if none is available).
+PL_API bool pl_tex_pool_recreate(pl_tex_pool pool, pl_tex *tex,
+                                 const struct pl_tex_params *params);
+
+// Returns a texture to the pool, for reuse by future calls to
+// `pl_tex_pool_recreate`. Sets `*tex` to NULL. The texture may still be in
+// use by the GPU. If the pool is full, the oldest unused texture is destroyed.
+PL_API void pl_tex_pool_put(pl_tex_pool pool, pl_tex *tex);
+
 // Description of the host representation of an image plane
 struct pl_plane_data {
     enum pl_fmt_type type;  // meaning of the data (must not be UINT or SINT)
@@ -57,6 +85,11 @@ struct pl_plane_data {
     void (*callback)(void *priv);
     void *priv;
 
+    // If set, `pl_upload_plane` and `pl_recreate_plane` will take textures
+    // from (and return incompatible textures to) this pool, using
+    // `pl_tex_pool_recreate` instead of `pl_tex_recreate`. (Optional)
+    pl_tex_pool pool;
+
     // Note: When using this together with `pl_frame`, there is some amount of
     // overlap between `component_pad` and `pl_color_repr.bits`. Some key
     // differences between the two:
@@ -133,11 +166,33 @@ PL_API pl_fmt pl_plane_find_fmt(pl_gpu gpu, int out_map[4], const struct pl_plan
 // and maximize compatibility with the other `pl_renderer` requirements
 // (blittable, linear filterable, etc.).
 //
+// When uploading from `pixels` with a `callback` set, and the GPU supports
+// importing host pointers (`pl_gpu.import_caps.buf & PL_HANDLE_HOST_PTR`),
+// the pixel data is imported and read in-place, skipping the intermediate
+// memcpy. In this case, the memory must remain valid until `callback` fires.
+//
 // Note: `out_plane->shift_x/y` and `out_plane->flipped` are left
 // uninitialized, and should be set explicitly by the user.
 PL_API bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
                             pl_tex *tex, const struct pl_plane_data *data);
 
+// Upload several image planes at once, e.g. all planes of a YCbCr frame.
+// `out_planes` (optional), `tex` and `data` must each have `num_planes`
+// entries (at most 4). Semantically equivalent to calling `pl_upload_plane`
+// on each plane in turn, but when all planes come from host memory, their
+// data is copied into a single staging allocation and all texture transfers
+// are issued back-to-back, saving on per-plane staging buffers and transfer
+// submission overhead. Falls back to uploading each plane separately
+// otherwise (e.g. for `swapped` or buffer-backed planes). Returns whether
+// successful.
+//
+// On failure, the `callback` of every plane preceding the first failed plane
+// has fired (or will fire), as if `pl_upload_plane` had been called on each,
+// while those of the planes following it are never invoked.
+PL_API bool pl_upload_planes(pl_gpu gpu, struct pl_plane out_planes[],
+                             pl_tex tex[], const struct pl_plane_data data[],
+                             int num_planes);
+
 // Like `pl_upload_plane`, but only creates an uninitialized texture object
 // rather than actually performing an upload. This can be useful to, for
 // example, prepare textures to be used as the target of rendering.
@@ -148,6 +203,73 @@ PL_API bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
 PL_API bool pl_recreate_plane(pl_gpu gpu, struct pl_plane *out_plane,
                               pl_tex *tex, const struct pl_plane_data *data);
 
+// Description of a single sample inside a group of bit-packed pixels
+struct pl_packed_sample {
+    // Output plane this sample belongs to. This doubles as the component
+    // mapping of that plane, so e.g. 0/1/2 for Y/Cb/Cr.
+    int plane;
+
+    // Horizontal position of the sample within the group, in pixels of the
+    // output plane (i.e. taking any chroma subsampling into account).
+    int x;
+
+    // Position of the least significant bit of the sample, counted from the
+    // start of the group (in little-endian 32-bit words), and its size in
+    // bits. Samples may not straddle two 32-bit words.
+    int offset;
+    int bits;
+};
+
+#define PL_PACKED_MAX_SAMPLES 24
+
+// Layout of an image format which packs a fixed number of pixels into each
+// group of bytes, in ways that can't be described by `pl_plane_data` (since
+// the placement of each sample differs from pixel to pixel), e.g. v210.
+struct pl_packed_layout {
+    int group_pixels;   // number of full-resolution pixels in each group
+    int group_size;     // size of each group in bytes (multiple of 4)
+    int num_planes;     // number of output planes
+    int num_samples;
+    struct pl_packed_sample samples[PL_PACKED_MAX_SAMPLES];
+};
+
+// Some common packed layouts. These both produce separate Y, Cb and Cr
+// planes, with 4:2:2 chroma subsampling and 10-bit samples.
+PL_API extern const struct pl_packed_layout pl_packed_v210;
+PL_API extern const struct pl_packed_layout pl_packed_y210;
+
+// Description of the host representation of a bit-packed image
+struct pl_packed_data {
+    const struct pl_packed_layout *layout;
+    int width, height;      // dimensions of the image, in full-res pixels
+    size_t row_stride;      // offset in bytes between rows (required)
+
+    // Exactly one of these must be set, as with `pl_plane_data`.
+    const void *pixels;
+    pl_buf buf;             // must be `storable`
+    size_t buf_offset;      // must be a multiple of 4
+};
+
+// Uploads a bit-packed image, and unpacks it on the GPU (using a compute
+// shader) into one texture per output plane of `data->layout`. `out_planes`
+// and `tex` must have room for `data->layout->num_planes` entries. The
+// textures are (re)created as needed, like with `pl_upload_plane`. Returns
+// whether successful.
+//
+// Every output sample is normalized to its own bit depth, so the matching
+// `pl_bit_encoding` has both `sample_depth` and `color_depth` set to the
+// size of the samples (e.g. 10 for v210).
+//
+// Requires compute shaders and storage images for single-channel UNORM
+// formats. `pl_packed_upload_supported` can be used to check support.
+//
+// Note: `out_planes[i].shift_x/y` and `out_planes[i].flipped` are left
+// uninitialized, and should be set explicitly by the user.
+PL_API bool pl_upload_packed(pl_gpu gpu, struct pl_plane out_planes[],
+                             pl_tex tex[], const struct pl_packed_data *data);
+PL_API bool pl_packed_upload_supported(pl_gpu gpu,
+                                       const struct pl_packed_layout *layout);
+
 PL_API_END
 
 #endif // LIBPLACEBO_UPLOAD_H_
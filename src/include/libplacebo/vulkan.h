@@ -21,6 +21,7 @@
 #include <vulkan/vulkan.h>
 #include <libplacebo/gpu.h>
 #include <libplacebo/swapchain.h>
+#include <libplacebo/shaders/custom.h>
 
 PL_API_BEGIN
 
@@ -230,6 +231,13 @@ struct pl_vulkan_params {
     // queues for a given QF enabled, regardless of this setting.
     int queue_count;
 
+    // If true, new commands are submitted to whichever queue (of the relevant
+    // queue family) currently has the fewest pending commands, instead of
+    // simply rotating through the queues once per frame. This allows
+    // independent workloads, e.g. multiple renderers on different threads, to
+    // spread across hardware queues. Only relevant if `queue_count` > 1.
+    bool balance_queues;
+
     // Bitmask of extra queue families to enable. If set, then *all* queue
     // families matching *any* of these flags will be enabled at device
     // creation time. Setting this to VK_QUEUE_FLAG_BITS_MAX_ENUM effectively
@@ -254,6 +262,45 @@ struct pl_vulkan_params {
 
     // --- Misc/debugging options
 
+    // If true, sub-allocates memory slabs using a buddy allocator (with
+    // power-of-two block sizes down to 4 KB) instead of splitting each slab
+    // into (at most 64) equally sized pages. This allows differently sized
+    // allocations to share a slab, which can reduce memory overhead for
+    // workloads mixing small and large allocations. Disabled by default.
+    bool buddy_allocator;
+
+    // If true, spawns an internal thread which blocks on the oldest pending
+    // command and retires commands as soon as they complete. This makes
+    // resource cleanup and `pl_tex_transfer_params.callback` independent of
+    // the user calling into libplacebo, and turns non-blocking polls (e.g.
+    // `pl_buf_poll` with a timeout of 0) into cheap state checks. Note that
+    // transfer callbacks may then be invoked from this internal thread.
+    bool completion_thread;
+
+    // Optional cache used to persist the results of probing the device's
+    // texture format capabilities, which can take a noticeable amount of
+    // time on some drivers. Entries are keyed on the device, driver version
+    // and API version. Note: This is independent of the cache used for
+    // shaders and pipelines, which must still be set via `pl_gpu_set_cache`.
+    pl_cache cache;
+
+    // If true, probes the texture format capabilities on an internal thread,
+    // concurrently with the creation of the logical device, to reduce the
+    // total time spent in `pl_vulkan_create`. This is mostly useful on
+    // drivers with slow format queries and when `cache` is not (yet)
+    // populated. Note: Unlike synchronous probing, this does not suppress
+    // validation layer messages emitted by the format queries.
+    bool async_formats;
+
+    // If true, runs the performance-oriented SPIR-V optimization passes on
+    // all generated shaders, instead of the default size-oriented passes.
+    // This makes shader compilation noticeably slower, but can result in
+    // faster shaders on drivers with weak shader compilers. The optimized
+    // SPIR-V is cached (see `pl_gpu_set_cache`) separately from unoptimized
+    // SPIR-V, so this cost is only paid once per shader when a cache is used.
+    // Note: Has no effect if the SPIR-V compiler lacks optimizer support.
+    bool spirv_opt_performance;
+
     // Restrict specific features to e.g. work around driver bugs, or simply
     // for testing purposes
     int max_glsl_version;       // limit the maximum GLSL version
@@ -293,6 +340,18 @@ PL_API void pl_vulkan_destroy(pl_vulkan *vk);
 // the underlying `pl_vulkan`. Returns NULL for any other type of `gpu`.
 PL_API pl_vulkan pl_vulkan_get(pl_gpu gpu);
 
+// Creates an additional `pl_gpu` sharing the device, queues and memory
+// allocator of `vk`, but recording commands into its own set of command pools.
+// Since each `pl_gpu` serializes command recording internally, this allows
+// independent workloads (e.g. one renderer per thread) to record their
+// commands in parallel, contending only on queue submission.
+//
+// Objects created from this `pl_gpu` may not be used with any other `pl_gpu`,
+// except via the usual interop mechanisms (e.g. `pl_vulkan_hold_ex`). The
+// returned `pl_gpu` must be destroyed with `pl_gpu_destroy` before `vk`
+// itself is destroyed.
+PL_API pl_gpu pl_vulkan_gpu_create(pl_vulkan vk);
+
 struct pl_vulkan_device_params {
     // The instance to use. Required!
     //
@@ -422,6 +481,12 @@ struct pl_vulkan_import_params {
 
     // --- Misc/debugging options
 
+    // Optional cache for format probing results. See `pl_vulkan_params`.
+    pl_cache cache;
+
+    // Use the performance SPIR-V optimization passes. See `pl_vulkan_params`.
+    bool spirv_opt_performance;
+
     // Restrict specific features to e.g. work around driver bugs, or simply
     // for testing purposes. See `pl_vulkan_params` for a description of these.
     int max_glsl_version;
@@ -625,6 +690,76 @@ struct pl_vulkan_sem_params {
 PL_API VkSemaphore pl_vulkan_sem_create(pl_gpu gpu, const struct pl_vulkan_sem_params *params);
 PL_API void pl_vulkan_sem_destroy(pl_gpu gpu, VkSemaphore *semaphore);
 
+// Round trip of a hooked texture through an external API (e.g. CUDA or
+// OpenCL), see `pl_vulkan_interop_hook_params.process`.
+struct pl_vulkan_interop_frame {
+    // Exported textures holding the input image, and receiving the result,
+    // respectively. Their memory handles can be found in `shared_mem`. Both
+    // are held in VK_IMAGE_LAYOUT_GENERAL and transferred to
+    // VK_QUEUE_FAMILY_EXTERNAL for the duration of the round trip.
+    pl_tex in;
+    pl_tex out;
+
+    // True if `in` or `out` were (re)created since the previous call, in
+    // which case their memory must be (re)imported by the external API.
+    bool reimport;
+
+    // Exported timeline semaphores. The external API must wait until `sem`
+    // reaches `wait_value` and `out_sem` reaches `out_wait_value` before
+    // accessing the textures, and signal `sem` with `signal_value` after it
+    // has finished writing to `out`. These handles are constant for the
+    // lifetime of the hook and owned by it, so they must be duplicated if the
+    // importing API takes ownership of them (e.g. CUDA for fds).
+    union pl_handle sem;
+    union pl_handle out_sem;
+    uint64_t wait_value;
+    uint64_t out_wait_value;
+    uint64_t signal_value;
+
+    // The parameters the hook was invoked with, for reference.
+    const struct pl_hook_params *params;
+};
+
+struct pl_vulkan_interop_hook_params {
+    // Which stages to hook on. (Required)
+    enum pl_hook_stage stages;
+
+    // The handle type to export textures and semaphores with. Must be
+    // supported by both `pl_gpu.export_caps.tex` and `.sync`. (Required)
+    enum pl_handle_type handle_type;
+
+    // Format of the shared textures. Must be renderable and sampleable. If
+    // left as NULL, uses the format of the hooked texture.
+    pl_fmt format;
+
+    // Integer scale factor of the output relative to the input, e.g. for
+    // super-resolution. Only has an effect on resizable hook stages.
+    // Defaults to 1.
+    int scale;
+
+    // Called once per hook invocation to submit the external work. This
+    // should only enqueue the work (synchronized as described by
+    // `pl_vulkan_interop_frame`) rather than wait for it to complete.
+    // Returning false fails the hook, in which case the semaphore must not
+    // be signalled.
+    bool (*process)(void *priv, const struct pl_vulkan_interop_frame *frame);
+    void *priv;
+};
+
+#define pl_vulkan_interop_hook_params(...) (&(struct pl_vulkan_interop_hook_params) { __VA_ARGS__ })
+
+// Creates a `pl_hook` that exports the hooked texture (`PL_HOOK_SIG_TEX`) to
+// an external compute API and returns its result to the renderer, without
+// going through host memory. Returns NULL on failure, e.g. if the handle
+// type is not supported by `gpu`, which must be a Vulkan GPU.
+PL_API const struct pl_hook *
+pl_vulkan_interop_hook(pl_gpu gpu, const struct pl_vulkan_interop_hook_params *params);
+
+// Destroys a hook created by `pl_vulkan_interop_hook`. The hook must no
+// longer be in use by any renderer. Blocks until all submitted work,
+// including the external work, has completed.
+PL_API void pl_vulkan_interop_hook_destroy(const struct pl_hook **hook);
+
 PL_API_END
 
 #endif // LIBPLACEBO_VULKAN_H_
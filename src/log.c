@@ -21,11 +21,37 @@
 #include "common.h"
 #include "log.h"
 #include "pl_thread.h"
+#include "pl_thread_pool.h"
+
+// Upper bound on the amount of text queued by `pl_log_params.async`, beyond
+// which non-critical messages get dropped
+#define ASYNC_QUEUE_MAX (1 << 20)
+
+struct msg_record {
+    enum pl_log_level lev;
+    size_t offset; // into the text buffer
+};
+
+struct msg_queue {
+    PL_ARRAY(struct msg_record) records;
+    pl_str text;
+};
 
 struct priv {
     pl_mutex lock;
     enum pl_log_level log_level_cap;
     pl_str logbuffer;
+
+    // State for `pl_log_params.async`, all protected by `lock`
+    pl_thread thread;
+    pl_cond wakeup;  // signalled when messages get queued
+    pl_cond drained; // signalled after every delivered batch
+    bool have_thread;
+    bool quit;
+    bool delivering;
+    struct msg_queue queue, draining;
+    uint64_t queued, delivered;
+    size_t dropped;
 };
 
 pl_log pl_log_create(int api_ver, const struct pl_log_params *params)
@@ -35,12 +61,20 @@ pl_log pl_log_create(int api_ver, const struct pl_log_params *params)
     struct priv *p = PL_PRIV(log);
     log->params = *PL_DEF(params, &pl_log_default_params);
     pl_mutex_init(&p->lock);
+    pl_thread_pool_ref();
     pl_info(log, "Initialized libplacebo %s (API v%d)", PL_VERSION, PL_API_VER);
     return log;
 }
 
 const struct pl_log_params pl_log_default_params = {0};
 
+// Waits until all queued messages have been delivered. Called with `lock` held
+static void flush_async(struct priv *p)
+{
+    while (p->have_thread && (p->queue.records.num || p->delivering))
+        pl_cond_wait(&p->drained, &p->lock);
+}
+
 void pl_log_destroy(pl_log *plog)
 {
     pl_log log = *plog;
@@ -48,9 +82,20 @@ void pl_log_destroy(pl_log *plog)
         return;
 
     struct priv *p = PL_PRIV(log);
+    if (p->have_thread) {
+        pl_mutex_lock(&p->lock);
+        p->quit = true;
+        pl_cond_signal(&p->wakeup);
+        pl_mutex_unlock(&p->lock);
+        pl_thread_join(p->thread);
+        pl_cond_destroy(&p->wakeup);
+        pl_cond_destroy(&p->drained);
+    }
+
     pl_mutex_destroy(&p->lock);
     pl_free((void *) log);
     *plog = NULL;
+    pl_thread_pool_unref();
 }
 
 struct pl_log_params pl_log_update(pl_log ptr, const struct pl_log_params *params)
@@ -59,8 +104,10 @@ struct pl_log_params pl_log_update(pl_log ptr, const struct pl_log_params *param
     if (!log)
         return pl_log_default_params;
 
+    // Messages queued up to this point still go to the old callback
     struct priv *p = PL_PRIV(log);
     pl_mutex_lock(&p->lock);
+    flush_async(p);
     struct pl_log_params prev_params = log->params;
     log->params = *PL_DEF(params, &pl_log_default_params);
     pl_mutex_unlock(&p->lock);
@@ -133,6 +180,132 @@ void pl_log_color(void *stream, enum pl_log_level level, const char *msg)
         fflush(h);
 }
 
+static PL_THREAD_VOID async_thread(void *arg)
+{
+    pl_log log = arg;
+    struct priv *p = PL_PRIV(log);
+
+    pl_mutex_lock(&p->lock);
+    for (;;) {
+        while (!p->queue.records.num && !p->quit)
+            pl_cond_wait(&p->wakeup, &p->lock);
+        if (!p->queue.records.num)
+            break; // quit, with nothing left to deliver
+
+        // Swap out the queue, so producers can keep going while this thread
+        // is busy running the callback
+        struct msg_queue *q = &p->draining;
+        PL_SWAP(p->queue, *q);
+        p->queue.records.num = 0;
+        p->queue.text.len = 0;
+        size_t dropped = p->dropped;
+        p->dropped = 0;
+        struct pl_log_params params = log->params;
+        p->delivering = true;
+        pl_mutex_unlock(&p->lock);
+
+        for (int i = 0; i < q->records.num; i++) {
+            const struct msg_record *rec = &q->records.elem[i];
+            params.log_cb(params.log_priv, rec->lev,
+                          (const char *) q->text.buf + rec->offset);
+        }
+
+        if (dropped) {
+            char buf[64];
+            snprintf(buf, sizeof(buf), "Log queue overflowed, dropped %zu "
+                     "messages!", dropped);
+            params.log_cb(params.log_priv, PL_LOG_WARN, buf);
+        }
+
+        pl_mutex_lock(&p->lock);
+        p->delivered += q->records.num;
+        p->delivering = false;
+        pl_cond_broadcast(&p->drained);
+    }
+    pl_mutex_unlock(&p->lock);
+    PL_THREAD_RETURN();
+}
+
+static bool start_async(pl_log log)
+{
+    struct priv *p = PL_PRIV(log);
+    if (p->have_thread)
+        return true;
+
+    if (pl_cond_init(&p->wakeup) != 0)
+        return false;
+    if (pl_cond_init(&p->drained) != 0) {
+        pl_cond_destroy(&p->wakeup);
+        return false;
+    }
+    if (pl_thread_create(&p->thread, async_thread, (void *) log) != 0) {
+        pl_cond_destroy(&p->wakeup);
+        pl_cond_destroy(&p->drained);
+        return false;
+    }
+
+    p->have_thread = true;
+    return true;
+}
+
+// Formats the message without holding the lock, and hands it off to the
+// logging thread, see `pl_log_params.async`
+static void pl_msg_async(pl_log log, enum pl_log_level lev,
+                         const char *fmt, va_list va)
+{
+    char stackbuf[512];
+    pl_str msg = { (uint8_t *) stackbuf, 0 };
+    va_list copy;
+    va_copy(copy, va);
+    int len = vsnprintf(stackbuf, sizeof(stackbuf), fmt, copy);
+    va_end(copy);
+    if (len < 0)
+        return;
+    if (len < sizeof(stackbuf)) {
+        msg.len = len;
+    } else {
+        msg = (pl_str) {0};
+        pl_str_append_vasprintf(NULL, &msg, fmt, va);
+    }
+
+    struct priv *p = PL_PRIV(log);
+    pl_mutex_lock(&p->lock);
+    lev = PL_MAX(lev, p->log_level_cap);
+    if (!pl_msg_test(log, lev))
+        goto done;
+
+    if (!log->params.async || !start_async(log)) {
+        // Raced against `pl_log_update`, or no thread available
+        log->params.log_cb(log->params.log_priv, lev, (char *) msg.buf);
+        goto done;
+    }
+
+    // Messages at PL_LOG_WARN and above are never dropped, and wait until
+    // delivered, so they can't get lost e.g. before an abort()
+    const bool critical = lev <= PL_LOG_WARN;
+    if (!critical && p->queue.text.len + msg.len >= ASYNC_QUEUE_MAX) {
+        p->dropped++;
+        goto done;
+    }
+
+    PL_ARRAY_APPEND((void *) log, p->queue.records, (struct msg_record) {
+        .lev    = lev,
+        .offset = p->queue.text.len,
+    });
+    pl_str_append((void *) log, &p->queue.text, msg);
+    p->queue.text.len++; // include the terminating \0
+    const uint64_t id = ++p->queued;
+    pl_cond_signal(&p->wakeup);
+
+    while (critical && p->delivered < id)
+        pl_cond_wait(&p->drained, &p->lock);
+
+done:
+    pl_mutex_unlock(&p->lock);
+    if (msg.buf != (uint8_t *) stackbuf)
+        pl_free(msg.buf);
+}
+
 static void pl_msg_va(pl_log log, enum pl_log_level lev,
                       const char *fmt, va_list va)
 {
@@ -144,6 +317,12 @@ static void pl_msg_va(pl_log log, enum pl_log_level lev,
     if (!pl_msg_test(log, lev))
         return;
 
+    // Also tested without the lock, `pl_msg_async` re-tests it
+    if (log->params.async) {
+        pl_msg_async(log, lev, fmt, va);
+        return;
+    }
+
     // Re-test the log message level with held lock to avoid false positives,
     // which would be a considerably bigger deal than false negatives
     struct priv *p = PL_PRIV(log);
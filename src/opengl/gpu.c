@@ -38,7 +38,10 @@ static void gl_gpu_destroy(pl_gpu gpu)
     pl_gpu_finish(gpu);
     while (p->callbacks.num > 0)
         gl_poll_callbacks(gpu);
+    gl_upload_destroy(gpu);
 
+    gl_ring_destroy(gpu);
+    gl_tex_import_cache_flush(gpu);
     pl_free((void *) gpu);
 }
 
@@ -160,8 +163,13 @@ pl_gpu pl_gpu_create_gl(pl_log log, pl_opengl pl_gl, const struct pl_opengl_para
             geti(GL_MAX_COMPUTE_WORK_GROUP_SIZE, i, &glsl->max_group_size[i]);
     }
 
-    if (gl_test_ext(gpu, "GL_ARB_texture_gather", 40, 0)) {
-        get(GL_MAX_PROGRAM_TEXTURE_GATHER_COMPONENTS_ARB, &p->gather_comps);
+    if (gl_test_ext(gpu, "GL_ARB_texture_gather", 40, 31)) {
+        if (p->gles_ver) {
+            // GLES 3.1 can gather any single component of any format
+            p->gather_comps = 4;
+        } else {
+            get(GL_MAX_PROGRAM_TEXTURE_GATHER_COMPONENTS_ARB, &p->gather_comps);
+        }
         get(GL_MIN_PROGRAM_TEXTURE_GATHER_OFFSET_ARB, &glsl->min_gather_offset);
         get(GL_MAX_PROGRAM_TEXTURE_GATHER_OFFSET_ARB, &glsl->max_gather_offset);
     }
@@ -236,6 +244,15 @@ pl_gpu pl_gpu_create_gl(pl_log log, pl_opengl pl_gl, const struct pl_opengl_para
     p->has_queries = gl_test_ext(gpu, "GL_ARB_timer_query", 33, 0);
     p->has_storage = gl_test_ext(gpu, "GL_ARB_shader_image_load_store", 42, 0);
     p->has_readback = true;
+    p->has_ring = limits->max_mapped_size && limits->callbacks;
+
+    if (pl_opengl_has_ext(pl_gl, "GL_KHR_parallel_shader_compile")) {
+        // Let the driver pick the number of compiler threads
+        gl->MaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+        p->has_parallel_compile = gl_check_err(gpu, "glMaxShaderCompilerThreadsKHR");
+        if (p->has_parallel_compile)
+            p->impl.pass_pending = gl_pass_pending;
+    }
 
     if (p->has_readback && p->gles_ver) {
         GLuint fbo = 0, tex = 0;
@@ -282,6 +299,7 @@ pl_gpu pl_gpu_create_gl(pl_log log, pl_opengl pl_gl, const struct pl_opengl_para
     if (!formats_ok)
         goto error;
 
+    gl_upload_create(gpu, params);
     return pl_gpu_finalize(gpu);
 
 error:
@@ -505,6 +523,189 @@ void gl_buf_copy(pl_gpu gpu, pl_buf dst, size_t dst_offset,
     RELEASE_CURRENT();
 }
 
+#define RING_MIN_SIZE   (4 << 20)   // 4 MiB
+#define RING_MAX_SIZE   (256 << 20) // 256 MiB
+#define RING_ALIGN      64
+#define RING_TIMEOUT    1000000000  // 1 s
+
+static struct gl_ring_section *ring_find(struct pl_gl *p, uint64_t id)
+{
+    for (int i = p->ring_used.num - 1; i >= 0; i--) {
+        if (p->ring_used.elem[i].id == id)
+            return &p->ring_used.elem[i];
+    }
+
+    return NULL;
+}
+
+// Retire the oldest section, optionally blocking until it's done
+static bool ring_retire(pl_gpu gpu, bool wait)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    pl_assert(p->ring_used.num);
+    struct gl_ring_section *sec = &p->ring_used.elem[0];
+    if (!sec->sync)
+        return false; // not yet committed, can't block on this
+
+    GLenum res = gl->ClientWaitSync(sec->sync, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0,
+                                    wait ? RING_TIMEOUT : 0);
+    switch (res) {
+    case GL_ALREADY_SIGNALED:
+    case GL_CONDITION_SATISFIED:
+        break;
+    case GL_TIMEOUT_EXPIRED:
+        return false;
+    case GL_WAIT_FAILED:
+        gl_check_err(gpu, "ring_retire");
+        return false;
+    default:
+        pl_unreachable();
+    }
+
+    if (sec->pending) {
+        // Host read-back happens in the corresponding transfer callback
+        const uint64_t id = sec->id;
+        gl_poll_callbacks(gpu);
+        if (!p->ring_used.num || p->ring_used.elem[0].id != id)
+            return true; // retired by a nested call
+        sec = &p->ring_used.elem[0];
+        if (sec->pending)
+            return false;
+    }
+
+    gl->DeleteSync(sec->sync);
+    PL_ARRAY_REMOVE_AT(p->ring_used, 0);
+    return true;
+}
+
+// Try finding `size` free bytes after `ring_pos`, possibly wrapping around
+static bool ring_fit(struct pl_gl *p, size_t size, size_t *out_offset)
+{
+    const size_t cap = p->ring->params.size;
+    if (!p->ring_used.num) {
+        p->ring_pos = 0;
+        *out_offset = 0;
+        return size <= cap;
+    }
+
+    const size_t head = p->ring_used.elem[0].start, tail = p->ring_pos;
+    if (tail > head) {
+        if (tail + size <= cap) {
+            *out_offset = tail;
+            return true;
+        } else if (size <= head) {
+            *out_offset = 0;
+            return true;
+        }
+    } else if (tail < head && tail + size <= head) {
+        *out_offset = tail;
+        return true;
+    }
+
+    return false;
+}
+
+bool gl_ring_alloc(pl_gpu gpu, size_t size, bool pending, size_t *out_offset,
+                   uint64_t *out_id)
+{
+    struct pl_gl *p = PL_PRIV(gpu);
+    size = PL_ALIGN2(size, RING_ALIGN);
+    if (!p->has_ring || size > RING_MAX_SIZE / 4)
+        return false;
+
+    while (p->ring_used.num && ring_retire(gpu, false))
+        ; // retire all finished sections
+
+    if (!p->ring || p->ring->params.size < size) {
+        // (Re)create the ring large enough to hold several such transfers.
+        // Nothing can still be using the old one once it's fully drained.
+        while (p->ring_used.num) {
+            if (!ring_retire(gpu, true))
+                return false;
+        }
+
+        size_t ring_size = PL_MAX(RING_MIN_SIZE, 4 * size);
+        if (p->ring)
+            ring_size = PL_MAX(ring_size, 2 * p->ring->params.size);
+        ring_size = PL_MIN(ring_size, RING_MAX_SIZE);
+        if (p->ring)
+            gl_buf_destroy(gpu, p->ring);
+        p->ring = gl_buf_create(gpu, pl_buf_params(
+            .size           = ring_size,
+            .host_mapped    = true,
+            .memory_type    = PL_BUF_MEM_HOST,
+            .debug_tag      = PL_DEBUG_TAG,
+        ));
+
+        if (!p->ring) {
+            PL_WARN(gpu, "Failed creating staging ring, disabling..");
+            p->has_ring = false;
+            return false;
+        }
+
+        PL_DEBUG(gpu, "Created %zu KiB staging ring", ring_size >> 10);
+    }
+
+    size_t offset;
+    while (!ring_fit(p, size, &offset)) {
+        if (!ring_retire(gpu, true))
+            return false;
+    }
+
+    PL_ARRAY_APPEND(gpu, p->ring_used, (struct gl_ring_section) {
+        .id      = ++p->ring_id,
+        .start   = offset,
+        .pending = pending,
+    });
+
+    p->ring_pos = offset + size;
+    *out_offset = offset;
+    *out_id = p->ring_id;
+    return true;
+}
+
+void gl_ring_commit(pl_gpu gpu, uint64_t id)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_ring_section *sec = ring_find(p, id);
+    pl_assert(sec && !sec->sync);
+    sec->sync = gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void gl_ring_release(pl_gpu gpu, uint64_t id)
+{
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_ring_section *sec = ring_find(p, id);
+    if (sec)
+        sec->pending = false;
+}
+
+void gl_ring_destroy(pl_gpu gpu)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    if (!p->ring && !p->ring_used.num)
+        return;
+
+    if (!MAKE_CURRENT()) {
+        PL_ERR(gpu, "Failed uninitializing staging ring, leaking resources!");
+        return;
+    }
+
+    for (int i = 0; i < p->ring_used.num; i++) {
+        if (p->ring_used.elem[i].sync)
+            gl->DeleteSync(p->ring_used.elem[i].sync);
+    }
+    p->ring_used.num = 0;
+
+    if (p->ring)
+        gl_buf_destroy(gpu, p->ring);
+    p->ring = NULL;
+    RELEASE_CURRENT();
+}
+
 #define QUERY_OBJECT_NUM 8
 
 struct pl_timer_t {
@@ -606,6 +807,7 @@ static void gl_gpu_finish(pl_gpu gpu)
     if (!MAKE_CURRENT())
         return;
 
+    gl_upload_finish(gpu);
     gl->Finish();
     gl_check_err(gpu, "gl_gpu_finish");
     RELEASE_CURRENT();
@@ -25,6 +25,50 @@ pl_gpu pl_gpu_create_gl(pl_log log, pl_opengl gl, const struct pl_opengl_params
 
 // --- pl_gpu internal structs and functions
 
+// A sub-allocated region of `pl_gl.ring`, which stays busy until `sync` is
+// signalled and (for downloads) the host read-back has completed
+struct gl_ring_section {
+    uint64_t id;
+    size_t start;
+    GLsync sync;    // NULL until committed
+    bool pending;   // host read-back not yet performed
+};
+
+// A cached DMA-BUF import, which keeps the EGLImage (and the GL texture bound
+// to it) alive for reuse by later imports of the same underlying buffer
+struct gl_import {
+    uint64_t dev, ino; // identifies the DMA-BUF
+    uint64_t modifier;
+    size_t offset;
+    int stride, w, h, fourcc;
+    EGLImageKHR image;
+    GLuint texture;
+    bool in_use;
+    uint64_t age; // of last use, for LRU eviction
+};
+
+// An asynchronous texture upload, offloaded to the shared upload context
+struct gl_upload_job {
+    pl_tex tex;
+    struct pl_tex_transfer_params params;
+    GLsync ready; // signalled once the main context is done using `tex`
+};
+
+// Worker thread owning the shared upload context. All fields, as well as
+// `pl_tex_gl.uploads` and `pl_tex_gl.upload_sync`, are guarded by `lock`
+struct gl_upload_worker {
+    pl_gpu gpu;
+    pl_thread thread;
+    pl_mutex lock;
+    pl_cond wakeup; // signalled when jobs get queued, or on shutdown
+    pl_cond idle;   // signalled after every completed job
+    PL_ARRAY(struct gl_upload_job) queue;
+    PL_ARRAY(struct gl_cb) finished; // callbacks yet to be dispatched
+    bool started;
+    bool failed;
+    bool quit;
+};
+
 struct pl_gl {
     struct pl_gpu_fns impl;
     pl_opengl gl;
@@ -37,11 +81,22 @@ struct pl_gl {
 #ifdef PL_HAVE_UNIX
     // List of formats supported by EGL_EXT_image_dma_buf_import
     PL_ARRAY(EGLint) egl_formats;
+    PL_ARRAY(struct gl_import) imports;
+    uint64_t import_age;
 #endif
 
     // Sync objects and associated callbacks
     PL_ARRAY(struct gl_cb) callbacks;
 
+    // Persistently mapped staging ring for asynchronous texture transfers
+    bool has_ring;
+    pl_buf ring;
+    size_t ring_pos;
+    uint64_t ring_id;
+    PL_ARRAY(struct gl_ring_section) ring_used; // in allocation order
+
+    // Optional, for offloading uploads to `pl_opengl_params.upload_make_current`
+    struct gl_upload_worker *upload;
 
     // Incrementing counters to keep track of object uniqueness
     int buf_id;
@@ -58,6 +113,7 @@ struct pl_gl {
     bool has_readback;
     bool has_egl_storage;
     bool has_egl_import;
+    bool has_parallel_compile;
     int gather_comps;
 };
 
@@ -107,15 +163,31 @@ struct pl_tex_gl {
     // For imported/exported textures
     EGLImageKHR image;
     int fd;
+    bool cached_import; // `image` and `texture` are owned by `pl_gl.imports`
+
+    // For asynchronous uploads, see `gl_upload_worker`
+    int uploads;        // number of queued or in-progress jobs
+    GLsync upload_sync; // signalled once the last completed job is visible
 };
 
 pl_tex gl_tex_create(pl_gpu, const struct pl_tex_params *);
 void gl_tex_destroy(pl_gpu, pl_tex);
+void gl_tex_import_cache_flush(pl_gpu);
 void gl_tex_invalidate(pl_gpu, pl_tex);
 void gl_tex_clear_ex(pl_gpu, pl_tex, const union pl_clear_color);
 void gl_tex_blit(pl_gpu, const struct pl_tex_blit_params *);
 bool gl_tex_upload(pl_gpu, const struct pl_tex_transfer_params *);
 bool gl_tex_download(pl_gpu, const struct pl_tex_transfer_params *);
+bool gl_tex_poll(pl_gpu, pl_tex, uint64_t timeout);
+
+// Upload worker management. `gl_upload_wait` must be called (with the main
+// context current) before any use of `tex` on the main context, and is a
+// no-op unless an upload worker exists.
+void gl_upload_create(pl_gpu gpu, const struct pl_opengl_params *params);
+void gl_upload_destroy(pl_gpu gpu);
+void gl_upload_wait(pl_gpu gpu, pl_tex tex);
+void gl_upload_finish(pl_gpu gpu);
+void gl_upload_poll(pl_gpu gpu);
 
 struct pl_buf_gl {
     uint64_t id; // unique per buffer
@@ -134,8 +206,22 @@ void gl_buf_copy(pl_gpu, pl_buf dst, size_t dst_offset,
                  pl_buf src, size_t src_offset, size_t size);
 bool gl_buf_poll(pl_gpu, pl_buf, uint64_t timeout);
 
+// Reserve `size` bytes of the staging ring, returning the offset and an ID
+// to later pass to `gl_ring_commit`. May block on previous transfers. Returns
+// false if the ring is unavailable or the transfer is too large for it. If
+// `pending` is set, the section also stays busy until `gl_ring_release`.
+bool gl_ring_alloc(pl_gpu, size_t size, bool pending, size_t *out_offset,
+                   uint64_t *out_id);
+
+// Fence the section after all GL commands accessing it have been issued
+void gl_ring_commit(pl_gpu, uint64_t id);
+void gl_ring_release(pl_gpu, uint64_t id);
+void gl_ring_destroy(pl_gpu);
+
+
 struct pl_pass_gl;
 int gl_desc_namespace(pl_gpu, enum pl_desc_type type);
 pl_pass gl_pass_create(pl_gpu, const struct pl_pass_params *);
 void gl_pass_destroy(pl_gpu, pl_pass);
 void gl_pass_run(pl_gpu, const struct pl_pass_run_params *);
+bool gl_pass_pending(pl_gpu, pl_pass);
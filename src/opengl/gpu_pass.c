@@ -72,13 +72,26 @@ static enum pl_log_level gl_log_level(GLint status, GLint log_length)
     }
 }
 
-static bool gl_attach_shader(pl_gpu gpu, GLuint program, GLenum type, const char *src)
+// Issues compilation of a shader and attaches it to `program`, without waiting
+// for the result. Returns the shader object, or 0 on failure.
+static GLuint gl_attach_shader(pl_gpu gpu, GLuint program, GLenum type, const char *src)
 {
     const gl_funcs *gl = gl_funcs_get(gpu);
     GLuint shader = gl->CreateShader(type);
     gl->ShaderSource(shader, 1, &src, NULL);
     gl->CompileShader(shader);
+    gl->AttachShader(program, shader);
+    if (!gl_check_err(gpu, "gl_attach_shader")) {
+        gl->DeleteShader(shader);
+        return 0;
+    }
+
+    return shader;
+}
 
+static bool gl_check_shader(pl_gpu gpu, GLuint shader)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
     GLint status = 0;
     gl->GetShaderiv(shader, GL_COMPILE_STATUS, &status);
     GLint log_length = 0;
@@ -92,19 +105,14 @@ static bool gl_attach_shader(pl_gpu gpu, GLuint program, GLenum type, const char
         pl_free(logstr);
     }
 
-    if (!status || !gl_check_err(gpu, "gl_attach_shader"))
-        goto error;
-
-    gl->AttachShader(program, shader);
-    gl->DeleteShader(shader);
-    return true;
-
-error:
-    gl->DeleteShader(shader);
-    return false;
+    return status && gl_check_err(gpu, "gl_check_shader");
 }
 
-static GLuint gl_compile_program(pl_gpu gpu, const struct pl_pass_params *params)
+// Issues compilation and linking of the program. With
+// GL_KHR_parallel_shader_compile, this does not wait for the driver to finish,
+// and the result must be checked with `gl_check_program` before use.
+static GLuint gl_compile_program(pl_gpu gpu, const struct pl_pass_params *params,
+                                 GLuint shaders[2])
 {
     const gl_funcs *gl = gl_funcs_get(gpu);
     GLuint prog = gl->CreateProgram();
@@ -112,11 +120,14 @@ static GLuint gl_compile_program(pl_gpu gpu, const struct pl_pass_params *params
 
     switch (params->type) {
     case PL_PASS_COMPUTE:
-        ok &= gl_attach_shader(gpu, prog, GL_COMPUTE_SHADER, params->glsl_shader);
+        ok &= !!(shaders[0] = gl_attach_shader(gpu, prog, GL_COMPUTE_SHADER,
+                                               params->glsl_shader));
         break;
     case PL_PASS_RASTER:
-        ok &= gl_attach_shader(gpu, prog, GL_VERTEX_SHADER, params->vertex_shader);
-        ok &= gl_attach_shader(gpu, prog, GL_FRAGMENT_SHADER, params->glsl_shader);
+        ok &= !!(shaders[0] = gl_attach_shader(gpu, prog, GL_VERTEX_SHADER,
+                                               params->vertex_shader));
+        ok &= !!(shaders[1] = gl_attach_shader(gpu, prog, GL_FRAGMENT_SHADER,
+                                               params->glsl_shader));
         for (int i = 0; i < params->num_vertex_attribs; i++)
             gl->BindAttribLocation(prog, i, params->vertex_attribs[i].name);
         break;
@@ -129,6 +140,36 @@ static GLuint gl_compile_program(pl_gpu gpu, const struct pl_pass_params *params
         goto error;
 
     gl->LinkProgram(prog);
+    if (!gl_check_err(gpu, "gl_compile_program: link program"))
+        goto error;
+
+    return prog;
+
+error:
+    for (int i = 0; i < 2; i++) {
+        gl->DeleteShader(shaders[i]);
+        shaders[i] = 0;
+    }
+    gl->DeleteProgram(prog);
+    PL_ERR(gpu, "Failed compiling/linking GLSL program");
+    return 0;
+}
+
+// Waits for the compilation and linking issued by `gl_compile_program`, logs
+// the results and releases the shader objects
+static bool gl_check_program(pl_gpu gpu, GLuint prog, GLuint shaders[2])
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    bool ok = true;
+    for (int i = 0; i < 2; i++) {
+        if (!shaders[i])
+            continue;
+        ok &= gl_check_shader(gpu, shaders[i]);
+        gl->DetachShader(prog, shaders[i]);
+        gl->DeleteShader(shaders[i]);
+        shaders[i] = 0;
+    }
+
     GLint status = 0;
     gl->GetProgramiv(prog, GL_LINK_STATUS, &status);
     GLint log_length = 0;
@@ -142,20 +183,19 @@ static GLuint gl_compile_program(pl_gpu gpu, const struct pl_pass_params *params
         pl_free(logstr);
     }
 
-    if (!gl_check_err(gpu, "gl_compile_program: link program"))
-        goto error;
-
-    return prog;
-
-error:
-    gl->DeleteProgram(prog);
-    PL_ERR(gpu, "Failed compiling/linking GLSL program");
-    return 0;
+    ok &= status && gl_check_err(gpu, "gl_check_program");
+    if (!ok)
+        PL_ERR(gpu, "Failed compiling/linking GLSL program");
+    return ok;
 }
 
 // For pl_pass.priv
 struct pl_pass_gl {
     GLuint program;
+    GLuint shaders[2];  // shader objects, while the program is still linking
+    bool linking;       // program needs to be checked with `gl_pass_link`
+    bool failed;        // program failed linking
+    uint64_t cache_key; // for updating the program cache after linking
     GLuint vao;         // the VAO object
     uint64_t vao_id;    // buf_gl.id of VAO
     size_t vao_offset;  // VBO offset of VAO
@@ -177,6 +217,8 @@ void gl_pass_destroy(pl_gpu gpu, pl_pass pass)
         gl->DeleteVertexArrays(1, &pass_gl->vao);
     gl->DeleteBuffers(1, &pass_gl->index_buffer);
     gl->DeleteBuffers(1, &pass_gl->buffer);
+    for (int i = 0; i < 2; i++)
+        gl->DeleteShader(pass_gl->shaders[i]);
     gl->DeleteProgram(pass_gl->program);
 
     gl_check_err(gpu, "gl_pass_destroy");
@@ -215,42 +257,29 @@ static void gl_update_va(pl_gpu gpu, pl_pass pass, size_t vbo_offset)
     }
 }
 
-pl_pass gl_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
+// Finishes setting up the program after linking is complete. Must be called
+// with the context current. Returns false if the program is unusable.
+static bool gl_pass_link(pl_gpu gpu, pl_pass pass)
 {
     const gl_funcs *gl = gl_funcs_get(gpu);
-    if (!MAKE_CURRENT())
-        return NULL;
-
-    struct pl_gl *p = PL_PRIV(gpu);
-    struct pl_pass_t *pass = pl_zalloc_obj(NULL, pass, struct pl_pass_gl);
     struct pl_pass_gl *pass_gl = PL_PRIV(pass);
-    pl_cache cache = pl_gpu_cache(gpu);
-    pass->params = pl_pass_params_copy(pass, params);
-
-    pl_cache_obj obj = { .key = CACHE_KEY_GL_PROG };
-    if (cache) {
-        pl_hash_merge(&obj.key, pl_str0_hash(params->glsl_shader));
-        if (params->type == PL_PASS_RASTER)
-            pl_hash_merge(&obj.key, pl_str0_hash(params->vertex_shader));
-    }
-
-    // Load/Compile program
-    if ((pass_gl->program = load_cached_program(gpu, cache, &obj))) {
-        PL_DEBUG(gpu, "Using cached GL program");
-    } else {
-        pl_clock_t start = pl_clock_now();
-        pass_gl->program = gl_compile_program(gpu, params);
-        pl_log_cpu_time(gpu->log, start, pl_clock_now(), "compiling shader");
-    }
+    const struct pl_pass_params *params = &pass->params;
+    if (!pass_gl->linking)
+        return !pass_gl->failed;
 
-    if (!pass_gl->program)
+    pass_gl->linking = false;
+    if (!gl_check_program(gpu, pass_gl->program, pass_gl->shaders))
         goto error;
 
     // Update program cache if possible
-    if (cache && gl_test_ext(gpu, "GL_ARB_get_program_binary", 41, 30)) {
+    pl_cache cache = pl_gpu_cache(gpu);
+    if (cache && pass_gl->cache_key &&
+        gl_test_ext(gpu, "GL_ARB_get_program_binary", 41, 30))
+    {
         GLint buf_size = 0;
         gl->GetProgramiv(pass_gl->program, GL_PROGRAM_BINARY_LENGTH, &buf_size);
         if (buf_size > 0) {
+            pl_cache_obj obj = { .key = pass_gl->cache_key };
             buf_size += sizeof(struct gl_cache_header);
             pl_cache_obj_resize(NULL, &obj, buf_size);
             struct gl_cache_header *header = obj.data;
@@ -258,32 +287,20 @@ pl_pass gl_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
             GLsizei binary_size = 0;
             gl->GetProgramBinary(pass_gl->program, buf_size, &binary_size,
                                  &header->format, buffer);
-            bool ok = gl_check_err(gpu, "gl_pass_create: get program binary");
+            bool ok = gl_check_err(gpu, "gl_pass_link: get program binary");
             if (ok) {
                 obj.size = sizeof(*header) + binary_size;
                 pl_assert(obj.size <= buf_size);
                 pl_cache_set(cache, &obj);
             }
+            pl_cache_obj_free(&obj);
         }
     }
 
     gl->UseProgram(pass_gl->program);
-    pass_gl->var_locs = pl_calloc(pass, params->num_variables, sizeof(GLint));
-
     for (int i = 0; i < params->num_variables; i++) {
         pass_gl->var_locs[i] = gl->GetUniformLocation(pass_gl->program,
                                                       params->variables[i].name);
-
-        // Due to OpenGL API restrictions, we need to ensure that this is a
-        // variable type we can actually *update*. Fortunately, this is easily
-        // checked by virtue of the fact that all legal combinations of
-        // parameters will have a valid GLSL type name
-        if (!pl_var_glsl_type_name(params->variables[i])) {
-            gl->UseProgram(0);
-            PL_ERR(gpu, "Input variable '%s' does not match any known type!",
-                   params->variables[i].name);
-            goto error;
-        }
     }
 
     for (int i = 0; i < params->num_descriptors; i++) {
@@ -320,6 +337,86 @@ pl_pass gl_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
     }
 
     gl->UseProgram(0);
+    if (!gl_check_err(gpu, "gl_pass_link"))
+        goto error;
+
+    return true;
+
+error:
+    pass_gl->failed = true;
+    return false;
+}
+
+bool gl_pass_pending(pl_gpu gpu, pl_pass pass)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_pass_gl *pass_gl = PL_PRIV(pass);
+    if (!pass_gl->linking || !MAKE_CURRENT())
+        return false;
+
+    GLint done = GL_TRUE;
+    gl->GetProgramiv(pass_gl->program, GL_COMPLETION_STATUS_KHR, &done);
+    gl_check_err(gpu, "gl_pass_pending");
+    RELEASE_CURRENT();
+    return !done;
+}
+
+pl_pass gl_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    if (!MAKE_CURRENT())
+        return NULL;
+
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct pl_pass_t *pass = pl_zalloc_obj(NULL, pass, struct pl_pass_gl);
+    struct pl_pass_gl *pass_gl = PL_PRIV(pass);
+    pl_cache cache = pl_gpu_cache(gpu);
+    pass->params = pl_pass_params_copy(pass, params);
+    pass_gl->var_locs = pl_calloc(pass, params->num_variables, sizeof(GLint));
+
+    pl_cache_obj obj = { .key = CACHE_KEY_GL_PROG };
+    if (cache) {
+        pl_hash_merge(&obj.key, pl_str0_hash(params->glsl_shader));
+        if (params->type == PL_PASS_RASTER)
+            pl_hash_merge(&obj.key, pl_str0_hash(params->vertex_shader));
+    }
+
+    // Due to OpenGL API restrictions, we need to ensure that all variables
+    // are of a type we can actually *update*. Fortunately, this is easily
+    // checked by virtue of the fact that all legal combinations of parameters
+    // will have a valid GLSL type name
+    for (int i = 0; i < params->num_variables; i++) {
+        if (!pl_var_glsl_type_name(params->variables[i])) {
+            PL_ERR(gpu, "Input variable '%s' does not match any known type!",
+                   params->variables[i].name);
+            goto error;
+        }
+    }
+
+    // Load/Compile program
+    pass_gl->program = load_cached_program(gpu, cache, &obj);
+    pl_cache_obj_free(&obj);
+    pass_gl->linking = true;
+    if (pass_gl->program) {
+        PL_DEBUG(gpu, "Using cached GL program");
+        if (!gl_pass_link(gpu, pass))
+            goto error;
+    } else {
+        pl_clock_t start = pl_clock_now();
+        pass_gl->program = gl_compile_program(gpu, params, pass_gl->shaders);
+        pass_gl->cache_key = cache ? obj.key : 0;
+        if (!pass_gl->program)
+            goto error;
+
+        // With parallel compilation, defer waiting for the result until the
+        // pass is actually needed, so compilation of other passes can overlap
+        if (!p->has_parallel_compile) {
+            bool ok = gl_pass_link(gpu, pass);
+            pl_log_cpu_time(gpu->log, start, pl_clock_now(), "compiling shader");
+            if (!ok)
+                goto error;
+        }
+    }
 
     // Initialize the VAO and single vertex buffer
     gl->GenBuffers(1, &pass_gl->buffer);
@@ -335,13 +432,11 @@ pl_pass gl_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
     if (!gl_check_err(gpu, "gl_pass_create"))
         goto error;
 
-    pl_cache_obj_free(&obj);
     RELEASE_CURRENT();
     return pass;
 
 error:
     PL_ERR(gpu, "Failed creating pass");
-    pl_cache_obj_free(&obj);
     gl_pass_destroy(gpu, pass);
     RELEASE_CURRENT();
     return NULL;
@@ -449,6 +544,7 @@ static void update_desc(pl_gpu gpu, pl_pass pass, int index,
     case PL_DESC_SAMPLED_TEX: {
         pl_tex tex = db->object;
         struct pl_tex_gl *tex_gl = PL_PRIV(tex);
+        gl_upload_wait(gpu, tex);
         gl->ActiveTexture(GL_TEXTURE0 + desc->binding);
         gl->BindTexture(tex_gl->target, tex_gl->texture);
 
@@ -466,6 +562,7 @@ static void update_desc(pl_gpu gpu, pl_pass pass, int index,
     case PL_DESC_STORAGE_IMG: {
         pl_tex tex = db->object;
         struct pl_tex_gl *tex_gl = PL_PRIV(tex);
+        gl_upload_wait(gpu, tex);
         gl->BindImageTexture(desc->binding, tex_gl->texture, 0, GL_FALSE, 0,
                              access[desc->access], tex_gl->iformat);
         return;
@@ -551,6 +648,13 @@ void gl_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     struct pl_pass_gl *pass_gl = PL_PRIV(pass);
     struct pl_gl *p = PL_PRIV(gpu);
 
+    // Blocks if the program is still being compiled in the background
+    if (!gl_pass_link(gpu, pass)) {
+        PL_ERR(gpu, "Trying to run pass with failed GLSL program, skipping!");
+        RELEASE_CURRENT();
+        return;
+    }
+
     gl->UseProgram(pass_gl->program);
 
     for (int i = 0; i < params->num_var_updates; i++)
@@ -567,6 +671,7 @@ void gl_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     switch (pass->params.type) {
     case PL_PASS_RASTER: {
         struct pl_tex_gl *target_gl = PL_PRIV(params->target);
+        gl_upload_wait(gpu, params->target);
         gl->BindFramebuffer(GL_DRAW_FRAMEBUFFER, target_gl->fbo);
         if (!pass->params.load_target && p->has_invalidate_fb) {
             GLenum fb = target_gl->fbo ? GL_COLOR_ATTACHMENT0 : GL_COLOR;
@@ -18,10 +18,74 @@
 #include "gpu.h"
 #include "formats.h"
 #include "utils.h"
+#include "../pl_memcpy.h"
 
 #ifdef PL_HAVE_UNIX
 #include <unistd.h>
 #include <errno.h>
+#include <sys/stat.h>
+#endif
+
+// Maximum number of idle DMA-BUF imports kept around for reuse. This should
+// comfortably exceed the number of (planes of) surfaces in a decoder pool.
+#define GL_IMPORT_CACHE_SIZE 64
+
+#ifdef PL_HAVE_UNIX
+
+static void import_release(pl_gpu gpu, EGLImageKHR image)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    int num_idle = 0, oldest = -1;
+    for (int i = 0; i < p->imports.num; i++) {
+        struct gl_import *imp = &p->imports.elem[i];
+        if (imp->image == image) {
+            imp->in_use = false;
+            imp->age = ++p->import_age;
+        }
+        if (imp->in_use)
+            continue;
+        num_idle++;
+        if (oldest < 0 || imp->age < p->imports.elem[oldest].age)
+            oldest = i;
+    }
+
+    if (num_idle > GL_IMPORT_CACHE_SIZE) {
+        struct gl_import *imp = &p->imports.elem[oldest];
+        eglDestroyImageKHR(p->egl_dpy, imp->image);
+        gl->DeleteTextures(1, &imp->texture);
+        PL_ARRAY_REMOVE_AT(p->imports, oldest);
+    }
+}
+
+void gl_tex_import_cache_flush(pl_gpu gpu)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    if (!p->imports.num)
+        return;
+
+    if (!MAKE_CURRENT()) {
+        PL_ERR(gpu, "Failed uninitializing imported textures, leaking resources!");
+        return;
+    }
+
+    for (int i = 0; i < p->imports.num; i++) {
+        struct gl_import *imp = &p->imports.elem[i];
+        pl_assert(!imp->in_use);
+        eglDestroyImageKHR(p->egl_dpy, imp->image);
+        gl->DeleteTextures(1, &imp->texture);
+    }
+
+    p->imports.num = 0;
+    gl_check_err(gpu, "gl_tex_import_cache_flush");
+    RELEASE_CURRENT();
+}
+
+#else // !PL_HAVE_UNIX
+
+void gl_tex_import_cache_flush(pl_gpu gpu) {}
+
 #endif
 
 void gl_tex_destroy(pl_gpu gpu, pl_tex tex)
@@ -32,9 +96,17 @@ void gl_tex_destroy(pl_gpu gpu, pl_tex tex)
         return;
     }
 
+    gl_upload_wait(gpu, tex);
     struct pl_tex_gl *tex_gl = PL_PRIV(tex);
     if (tex_gl->fbo && !tex_gl->wrapped_fb)
         gl->DeleteFramebuffers(1, &tex_gl->fbo);
+#ifdef PL_HAVE_UNIX
+    if (tex_gl->cached_import) {
+        import_release(gpu, tex_gl->image);
+        tex_gl->image = NULL;
+        tex_gl->wrapped_tex = true;
+    }
+#endif
     if (tex_gl->image) {
         struct pl_gl *p = PL_PRIV(gpu);
         eglDestroyImageKHR(p->egl_dpy, tex_gl->image);
@@ -112,15 +184,60 @@ static bool gl_tex_import(pl_gpu gpu,
     ADD_ATTRIB(EGL_WIDTH,  params->w);
     ADD_ATTRIB(EGL_HEIGHT, params->h);
 
+#ifdef PL_HAVE_UNIX
+    struct gl_import key = {0};
+    bool can_cache = false;
+#endif
+
     switch (handle_type) {
 
 #ifdef PL_HAVE_UNIX
-    case PL_HANDLE_DMA_BUF:
+    case PL_HANDLE_DMA_BUF: {
         if (shared_mem->handle.fd == -1) {
             PL_ERR(gpu, "%s: invalid fd", __func__);
             goto error;
         }
 
+        // Decoders typically cycle through a fixed pool of surfaces, so try
+        // reusing a previous import of the same buffer instead of creating a
+        // new EGLImage every frame. The cached EGLImage keeps the DMA-BUF
+        // alive, so its inode can't be recycled while the entry exists.
+        struct stat st;
+        if (fstat(shared_mem->handle.fd, &st) == 0) {
+            can_cache = true;
+            key = (struct gl_import) {
+                .dev      = st.st_dev,
+                .ino      = st.st_ino,
+                .modifier = shared_mem->drm_format_mod,
+                .offset   = shared_mem->offset,
+                .stride   = PL_DEF(shared_mem->stride_w, params->w),
+                .w        = params->w,
+                .h        = params->h,
+                .fourcc   = params->format->fourcc,
+            };
+        }
+
+        for (int i = 0; can_cache && i < p->imports.num; i++) {
+            struct gl_import *imp = &p->imports.elem[i];
+            if (imp->in_use || imp->dev != key.dev || imp->ino != key.ino ||
+                imp->modifier != key.modifier || imp->offset != key.offset ||
+                imp->stride != key.stride || imp->w != key.w ||
+                imp->h != key.h || imp->fourcc != key.fourcc)
+            {
+                continue;
+            }
+
+            imp->in_use = true;
+            gl->DeleteTextures(1, &tex_gl->texture);
+            tex_gl->texture = imp->texture;
+            tex_gl->image = imp->image;
+            tex_gl->cached_import = true;
+            gl->BindTexture(tex_gl->target, tex_gl->texture);
+            bool ok = gl_check_err(gpu, "gl_tex_import");
+            RELEASE_CURRENT();
+            return ok;
+        }
+
         tex_gl->fd = dup(shared_mem->handle.fd);
         if (tex_gl->fd == -1) {
             PL_ERR(gpu, "%s: cannot duplicate fd %d for importing: %s",
@@ -144,6 +261,7 @@ static bool gl_tex_import(pl_gpu gpu,
                                           attribs);
 
         break;
+    }
 #else // !PL_HAVE_UNIX
     case PL_HANDLE_DMA_BUF:
         pl_unreachable();
@@ -171,6 +289,16 @@ static bool gl_tex_import(pl_gpu gpu,
     if (!egl_check_err(gpu, "EGLImageTargetTexture2DOES"))
         goto error;
 
+#ifdef PL_HAVE_UNIX
+    if (can_cache) {
+        key.image = tex_gl->image;
+        key.texture = tex_gl->texture;
+        key.in_use = true;
+        PL_ARRAY_APPEND(gpu, p->imports, key);
+        tex_gl->cached_import = true;
+    }
+#endif
+
     RELEASE_CURRENT();
     return true;
 
@@ -764,6 +892,13 @@ unsigned int pl_opengl_unwrap(pl_gpu gpu, pl_tex tex,
     if (out_fbo)
         *out_fbo = tex_gl->fbo;
 
+    // The user may access the texture from the main context at any time
+    struct pl_gl *p = PL_PRIV(gpu);
+    if (p->upload && MAKE_CURRENT()) {
+        gl_upload_wait(gpu, tex);
+        RELEASE_CURRENT();
+    }
+
     return tex_gl->texture;
 }
 
@@ -775,6 +910,7 @@ void gl_tex_invalidate(pl_gpu gpu, pl_tex tex)
     if (!MAKE_CURRENT())
         return;
 
+    gl_upload_wait(gpu, tex);
     if (tex_gl->texture && p->has_invalidate_tex)
         gl->InvalidateTexImage(tex_gl->texture, 0);
 
@@ -797,6 +933,7 @@ void gl_tex_clear_ex(pl_gpu gpu, pl_tex tex, const union pl_clear_color color)
 
     struct pl_tex_gl *tex_gl = PL_PRIV(tex);
     pl_assert(tex_gl->fbo || tex_gl->wrapped_fb);
+    gl_upload_wait(gpu, tex);
 
     switch (tex->params.format->type) {
     case PL_FMT_UNKNOWN:
@@ -836,6 +973,8 @@ void gl_tex_blit(pl_gpu gpu, const struct pl_tex_blit_params *params)
 
     pl_assert(src_gl->fbo || src_gl->wrapped_fb);
     pl_assert(dst_gl->fbo || dst_gl->wrapped_fb);
+    gl_upload_wait(gpu, params->src);
+    gl_upload_wait(gpu, params->dst);
     gl->BindFramebuffer(GL_READ_FRAMEBUFFER, src_gl->fbo);
     gl->BindFramebuffer(GL_DRAW_FRAMEBUFFER, dst_gl->fbo);
 
@@ -866,34 +1005,15 @@ static int get_alignment(size_t pitch)
     return 1;
 }
 
-bool gl_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params)
+// Performs the actual transfer on whatever context is current. `src` is
+// either a host pointer or an offset into the bound GL_PIXEL_UNPACK_BUFFER
+static void upload_direct(const gl_funcs *gl,
+                          const struct pl_tex_transfer_params *params,
+                          uintptr_t src)
 {
-    const gl_funcs *gl = gl_funcs_get(gpu);
-    struct pl_gl *p = PL_PRIV(gpu);
     pl_tex tex = params->tex;
     pl_fmt fmt = tex->params.format;
-    pl_buf buf = params->buf;
     struct pl_tex_gl *tex_gl = PL_PRIV(tex);
-    struct pl_buf_gl *buf_gl = buf ? PL_PRIV(buf) : NULL;
-
-    // If the user requests asynchronous uploads, it's more efficient to do
-    // them via a PBO - this allows us to skip blocking the caller, especially
-    // when the host pointer can be imported directly.
-    if (params->callback && !buf) {
-        size_t buf_size = pl_tex_transfer_size(params);
-        const size_t min_size = 32*1024; // 32 KiB
-        if (buf_size >= min_size && buf_size <= gpu->limits.max_buf_size)
-            return pl_tex_upload_pbo(gpu, params);
-    }
-
-    if (!MAKE_CURRENT())
-        return false;
-
-    uintptr_t src = (uintptr_t) params->ptr;
-    if (buf) {
-        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, buf_gl->buffer);
-        src = buf_gl->offset + params->buf_offset;
-    }
 
     bool misaligned = params->row_pitch % fmt->texel_size;
     int stride_w = params->row_pitch / fmt->texel_size;
@@ -915,7 +1035,6 @@ bool gl_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params)
         gl->PixelStorei(GL_UNPACK_IMAGE_HEIGHT, stride_h);
 
     gl->BindTexture(tex_gl->target, tex_gl->texture);
-    gl_timer_begin(gpu, params->timer);
 
     switch (dims) {
     case 1:
@@ -944,11 +1063,73 @@ bool gl_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params)
         break;
     }
 
-    gl_timer_end(gpu, params->timer);
     gl->BindTexture(tex_gl->target, 0);
     gl->PixelStorei(GL_UNPACK_ALIGNMENT, 4);
     gl->PixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     gl->PixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+}
+
+static bool upload_submit(pl_gpu gpu, const struct pl_tex_transfer_params *params);
+
+bool gl_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    pl_buf buf = params->buf;
+    struct pl_buf_gl *buf_gl = buf ? PL_PRIV(buf) : NULL;
+
+    // If the user requests asynchronous uploads, it's more efficient to do
+    // them via a PBO - this allows us to skip blocking the caller, especially
+    // when the host pointer can be imported directly. Prefer sub-allocating
+    // from the persistently mapped staging ring, which avoids creating a new
+    // buffer object for every transfer. If we have a shared upload context,
+    // hand the transfer off to its worker thread instead.
+    if (params->callback && !buf) {
+        size_t buf_size = pl_tex_transfer_size(params);
+        const size_t min_size = 32*1024; // 32 KiB
+        if (buf_size >= min_size && p->upload && !params->timer)
+            return upload_submit(gpu, params);
+
+        if (buf_size >= min_size && buf_size <= gpu->limits.max_buf_size) {
+            if (!MAKE_CURRENT())
+                return false;
+
+            size_t offset;
+            uint64_t id;
+            if (!gl_ring_alloc(gpu, buf_size, false, &offset, &id)) {
+                RELEASE_CURRENT();
+                return pl_tex_upload_pbo(gpu, params);
+            }
+
+            pl_memcpy_stream(p->ring->data + offset, params->ptr, buf_size);
+            params->callback(params->priv);
+
+            struct pl_tex_transfer_params fixed = *params;
+            fixed.ptr = NULL;
+            fixed.buf = p->ring;
+            fixed.buf_offset = offset;
+            fixed.callback = NULL;
+            bool ok = gl_tex_upload(gpu, &fixed);
+            gl_ring_commit(gpu, id);
+            RELEASE_CURRENT();
+            return ok;
+        }
+    }
+
+    if (!MAKE_CURRENT())
+        return false;
+
+    gl_upload_wait(gpu, params->tex);
+
+    uintptr_t src = (uintptr_t) params->ptr;
+    if (buf) {
+        gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, buf_gl->buffer);
+        src = buf_gl->offset + params->buf_offset;
+    }
+
+    gl_timer_begin(gpu, params->timer);
+    upload_direct(gl, params, src);
+    gl_timer_end(gpu, params->timer);
 
     if (buf) {
         gl->BindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
@@ -974,6 +1155,28 @@ bool gl_tex_upload(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     return ok;
 }
 
+struct ring_download_ctx {
+    pl_gpu gpu;
+    uint64_t id;
+    size_t offset;
+    size_t size;
+    void *ptr;
+    void (*callback)(void *priv);
+    void *priv;
+};
+
+static void ring_download_cb(void *priv)
+{
+    struct ring_download_ctx *ctx = priv;
+    struct pl_gl *p = PL_PRIV(ctx->gpu);
+    gl_buf_read(ctx->gpu, p->ring, ctx->offset, ctx->ptr, ctx->size);
+    gl_ring_release(ctx->gpu, ctx->id);
+
+    // Run the original callback
+    ctx->callback(ctx->priv);
+    pl_free(ctx);
+}
+
 bool gl_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *params)
 {
     const gl_funcs *gl = gl_funcs_get(gpu);
@@ -988,13 +1191,43 @@ bool gl_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     if (params->callback && !buf) {
         size_t buf_size = pl_tex_transfer_size(params);
         const size_t min_size = 32*1024; // 32 KiB
-        if (buf_size >= min_size && buf_size <= gpu->limits.max_buf_size)
-            return pl_tex_download_pbo(gpu, params);
+        if (buf_size >= min_size && buf_size <= gpu->limits.max_buf_size) {
+            if (!MAKE_CURRENT())
+                return false;
+
+            size_t offset;
+            uint64_t id;
+            if (!gl_ring_alloc(gpu, buf_size, true, &offset, &id)) {
+                RELEASE_CURRENT();
+                return pl_tex_download_pbo(gpu, params);
+            }
+
+            struct pl_tex_transfer_params fixed = *params;
+            fixed.ptr = NULL;
+            fixed.buf = p->ring;
+            fixed.buf_offset = offset;
+            fixed.callback = ring_download_cb;
+            fixed.priv = pl_alloc_struct(NULL, struct ring_download_ctx, {
+                .gpu = gpu,
+                .id = id,
+                .offset = offset,
+                .size = buf_size,
+                .ptr = params->ptr,
+                .callback = params->callback,
+                .priv = params->priv,
+            });
+
+            ok = gl_tex_download(gpu, &fixed);
+            gl_ring_commit(gpu, id);
+            RELEASE_CURRENT();
+            return ok;
+        }
     }
 
     if (!MAKE_CURRENT())
         return false;
 
+    gl_upload_wait(gpu, tex);
     uintptr_t dst = (uintptr_t) params->ptr;
     if (buf) {
         gl->BindBuffer(GL_PIXEL_PACK_BUFFER, buf_gl->buffer);
@@ -1076,3 +1309,243 @@ bool gl_tex_download(pl_gpu gpu, const struct pl_tex_transfer_params *params)
     RELEASE_CURRENT();
     return ok;
 }
+
+static PL_THREAD_VOID upload_thread(void *arg)
+{
+    struct gl_upload_worker *w = arg;
+    pl_gpu gpu = w->gpu;
+    struct pl_gl *p = PL_PRIV(gpu);
+    const struct gl_ctx *glctx = PL_PRIV(p->gl);
+    const struct pl_opengl_params *params = &glctx->params;
+    const gl_funcs *gl = gl_funcs_get(gpu);
+
+    bool ok = params->upload_make_current(params->upload_priv);
+    pl_mutex_lock(&w->lock);
+    w->started = true;
+    w->failed = !ok;
+    pl_cond_broadcast(&w->idle);
+    if (!ok) {
+        pl_mutex_unlock(&w->lock);
+        PL_THREAD_RETURN();
+    }
+
+    while (!w->quit || w->queue.num) {
+        if (!w->queue.num) {
+            pl_cond_wait(&w->wakeup, &w->lock);
+            continue;
+        }
+
+        // Leave the job in the queue until it's done, so that an empty queue
+        // means the worker is idle
+        struct gl_upload_job job = w->queue.elem[0];
+        pl_mutex_unlock(&w->lock);
+
+        gl->WaitSync(job.ready, 0, GL_TIMEOUT_IGNORED);
+        gl->DeleteSync(job.ready);
+        upload_direct(gl, &job.params, (uintptr_t) job.params.ptr);
+
+        // The host memory has been consumed once TexSubImage returns, but the
+        // fence must be flushed before the main context can wait on it
+        GLsync sync = gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        gl->Flush();
+
+        bool failed = false;
+        GLenum err;
+        while ((err = gl->GetError()) != GL_NO_ERROR) {
+            PL_ERR(gpu, "GL error in upload context: %s (0x%x)",
+                   gl_err_str(err), (unsigned) err);
+            failed = true;
+        }
+
+        pl_mutex_lock(&w->lock);
+        struct pl_tex_gl *tex_gl = PL_PRIV(job.tex);
+        if (tex_gl->upload_sync)
+            gl->DeleteSync(tex_gl->upload_sync);
+        tex_gl->upload_sync = sync;
+        tex_gl->uploads--;
+        PL_ARRAY_REMOVE_AT(w->queue, 0);
+        PL_ARRAY_APPEND(w, w->finished, (struct gl_cb) {
+            .callback = job.params.callback,
+            .priv = job.params.priv,
+        });
+        w->failed |= failed;
+        pl_cond_broadcast(&w->idle);
+    }
+
+    pl_mutex_unlock(&w->lock);
+    if (params->upload_release_current)
+        params->upload_release_current(params->upload_priv);
+    PL_THREAD_RETURN();
+}
+
+void gl_upload_create(pl_gpu gpu, const struct pl_opengl_params *params)
+{
+    struct pl_gl *p = PL_PRIV(gpu);
+    if (!params->upload_make_current)
+        return;
+
+    if (!gpu->limits.callbacks) {
+        PL_WARN(gpu, "Shared upload context requires GL_ARB_sync, ignoring!");
+        return;
+    }
+
+    struct gl_upload_worker *w = pl_zalloc_ptr(gpu, w);
+    w->gpu = gpu;
+    pl_mutex_init(&w->lock);
+    if (pl_cond_init(&w->wakeup) != 0)
+        goto error_wakeup;
+    if (pl_cond_init(&w->idle) != 0)
+        goto error_idle;
+    if (pl_thread_create(&w->thread, upload_thread, w) != 0)
+        goto error_thread;
+
+    pl_mutex_lock(&w->lock);
+    while (!w->started)
+        pl_cond_wait(&w->idle, &w->lock);
+    bool ok = !w->failed;
+    pl_mutex_unlock(&w->lock);
+
+    if (!ok) {
+        PL_WARN(gpu, "Failed making shared upload context current, falling "
+                "back to uploads on the main context!");
+        pl_thread_join(w->thread);
+        goto error_thread;
+    }
+
+    PL_INFO(gpu, "Offloading asynchronous texture uploads to shared context");
+    p->impl.tex_poll = gl_tex_poll;
+    p->upload = w;
+    return;
+
+error_thread:
+    pl_cond_destroy(&w->idle);
+error_idle:
+    pl_cond_destroy(&w->wakeup);
+error_wakeup:
+    pl_mutex_destroy(&w->lock);
+    pl_free(w);
+}
+
+void gl_upload_destroy(pl_gpu gpu)
+{
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_upload_worker *w = p->upload;
+    if (!w)
+        return;
+
+    pl_mutex_lock(&w->lock);
+    w->quit = true;
+    pl_cond_signal(&w->wakeup);
+    pl_mutex_unlock(&w->lock);
+    pl_thread_join(w->thread);
+
+    gl_upload_poll(gpu);
+    pl_cond_destroy(&w->wakeup);
+    pl_cond_destroy(&w->idle);
+    pl_mutex_destroy(&w->lock);
+    pl_free_ptr((void **) &p->upload);
+}
+
+static bool upload_submit(pl_gpu gpu, const struct pl_tex_transfer_params *params)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_upload_worker *w = p->upload;
+    struct pl_tex_gl *tex_gl = PL_PRIV(params->tex);
+    if (!MAKE_CURRENT())
+        return false;
+
+    // Order the upload after all previously submitted use of the texture
+    GLsync ready = gl->FenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    gl->Flush();
+    if (!gl_check_err(gpu, "gl_tex_upload")) {
+        gl->DeleteSync(ready);
+        RELEASE_CURRENT();
+        return false;
+    }
+
+    pl_mutex_lock(&w->lock);
+    PL_ARRAY_APPEND(w, w->queue, (struct gl_upload_job) {
+        .tex = params->tex,
+        .params = *params,
+        .ready = ready,
+    });
+    tex_gl->uploads++;
+    pl_cond_signal(&w->wakeup);
+    pl_mutex_unlock(&w->lock);
+
+    // Dispatch the callbacks of previously completed uploads
+    gl_upload_poll(gpu);
+    RELEASE_CURRENT();
+    return true;
+}
+
+void gl_upload_wait(pl_gpu gpu, pl_tex tex)
+{
+    const gl_funcs *gl = gl_funcs_get(gpu);
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_upload_worker *w = p->upload;
+    if (!w)
+        return;
+
+    struct pl_tex_gl *tex_gl = PL_PRIV(tex);
+    pl_mutex_lock(&w->lock);
+    while (tex_gl->uploads)
+        pl_cond_wait(&w->idle, &w->lock);
+    if (tex_gl->upload_sync) {
+        // Server-side wait, doesn't block the calling thread
+        gl->WaitSync(tex_gl->upload_sync, 0, GL_TIMEOUT_IGNORED);
+        gl->DeleteSync(tex_gl->upload_sync);
+        tex_gl->upload_sync = NULL;
+    }
+    pl_mutex_unlock(&w->lock);
+}
+
+void gl_upload_finish(pl_gpu gpu)
+{
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_upload_worker *w = p->upload;
+    if (!w)
+        return;
+
+    pl_mutex_lock(&w->lock);
+    while (w->queue.num)
+        pl_cond_wait(&w->idle, &w->lock);
+    pl_mutex_unlock(&w->lock);
+    gl_upload_poll(gpu);
+}
+
+void gl_upload_poll(pl_gpu gpu)
+{
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_upload_worker *w = p->upload;
+    if (!w)
+        return;
+
+    pl_mutex_lock(&w->lock);
+    while (w->finished.num) {
+        struct gl_cb cb = w->finished.elem[0];
+        PL_ARRAY_REMOVE_AT(w->finished, 0);
+        pl_mutex_unlock(&w->lock);
+        cb.callback(cb.priv); // may recursively submit more uploads
+        pl_mutex_lock(&w->lock);
+    }
+    p->failed |= w->failed;
+    pl_mutex_unlock(&w->lock);
+}
+
+bool gl_tex_poll(pl_gpu gpu, pl_tex tex, uint64_t timeout)
+{
+    struct pl_gl *p = PL_PRIV(gpu);
+    struct gl_upload_worker *w = p->upload;
+    struct pl_tex_gl *tex_gl = PL_PRIV(tex);
+    if (!w)
+        return false;
+
+    pl_mutex_lock(&w->lock);
+    if (tex_gl->uploads && timeout)
+        pl_cond_timedwait(&w->idle, &w->lock, timeout);
+    bool busy = tex_gl->uploads > 0;
+    pl_mutex_unlock(&w->lock);
+    return busy;
+}
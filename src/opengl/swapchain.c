@@ -268,11 +268,33 @@ static void gl_sw_swap_buffers(pl_swapchain sw)
     pl_mutex_unlock(&p->lock);
 }
 
+static bool gl_sw_adaptive_vsync(pl_swapchain sw, bool enable)
+{
+    struct priv *p = PL_PRIV(sw);
+    if (!p->params.swap_interval)
+        return false;
+
+    pl_mutex_lock(&p->lock);
+    if (!gl_make_current(p->gl)) {
+        pl_mutex_unlock(&p->lock);
+        return false;
+    }
+
+    bool ok = p->params.swap_interval(p->params.priv, enable ? -1 : 1);
+    if (!ok && enable)
+        PL_DEBUG(sw, "Adaptive vsync (swap interval -1) not supported");
+
+    gl_release_current(p->gl);
+    pl_mutex_unlock(&p->lock);
+    return ok;
+}
+
 static const struct pl_sw_fns opengl_swapchain = {
-    .destroy      = gl_sw_destroy,
-    .latency      = gl_sw_latency,
-    .resize       = gl_sw_resize,
-    .start_frame  = gl_sw_start_frame,
-    .submit_frame = gl_sw_submit_frame,
-    .swap_buffers = gl_sw_swap_buffers,
+    .destroy        = gl_sw_destroy,
+    .latency        = gl_sw_latency,
+    .resize         = gl_sw_resize,
+    .start_frame    = gl_sw_start_frame,
+    .submit_frame   = gl_sw_submit_frame,
+    .swap_buffers   = gl_sw_swap_buffers,
+    .adaptive_vsync = gl_sw_adaptive_vsync,
 };
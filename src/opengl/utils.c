@@ -41,6 +41,7 @@ void gl_poll_callbacks(pl_gpu gpu)
 {
     const gl_funcs *gl = gl_funcs_get(gpu);
     struct pl_gl *p = PL_PRIV(gpu);
+    gl_upload_poll(gpu);
     while (p->callbacks.num) {
         struct gl_cb cb = p->callbacks.elem[0];
         GLenum res = gl->ClientWaitSync(cb.sync, 0, 0);
@@ -18,7 +18,9 @@
 #include <math.h>
 
 #include "common.h"
+#include "hash.h"
 #include "log.h"
+#include "pl_thread.h"
 
 #include <libplacebo/options.h>
 
@@ -321,23 +323,21 @@ const char *pl_options_save(pl_options opts)
     return p->saved.len ? (char *) p->saved.buf : "";
 }
 
+static pl_opt lookup_option(pl_str key);
+
 static bool option_set_raw(pl_options opts, pl_str k, pl_str v)
 {
     struct priv *p = PL_PRIV(opts);
     k = pl_str_strip(k);
     v = pl_str_strip(v);
 
-    pl_opt opt;
-    for (opt = pl_option_list; opt->key; opt++) {
-        if (pl_str_equals0(k, opt->key))
-            goto found;
+    pl_opt opt = lookup_option(k);
+    if (!opt) {
+        PL_ERR(p, "Unrecognized option '%.*s', in '%.*s=%.*s'",
+               PL_STR_FMT(k), PL_STR_FMT(k), PL_STR_FMT(v));
+        return false;
     }
 
-    PL_ERR(p, "Unrecognized option '%.*s', in '%.*s=%.*s'",
-           PL_STR_FMT(k), PL_STR_FMT(k), PL_STR_FMT(v));
-    return false;
-
-found:
     PL_TRACE(p, "Parsing option '%s' = '%.*s'", opt->key, PL_STR_FMT(v));
     if (opt->deprecated)
         PL_WARN(p, "Option '%s' is deprecated", opt->key);
@@ -930,6 +930,7 @@ const struct pl_opt_t pl_option_list[] = {
     OPT_FLOAT("deband_grain_neutral_r", "Debanding grain neutral R", deband_params.grain_neutral[0]),
     OPT_FLOAT("deband_grain_neutral_g", "Debanding grain neutral G", deband_params.grain_neutral[1]),
     OPT_FLOAT("deband_grain_neutral_b", "Debanding grain neutral B", deband_params.grain_neutral[2]),
+    OPT_BOOL("deband_early_exit", "Skip debanding iterations on detail", deband_params.early_exit),
 
     // Sigmodization
     OPT_ENABLE_PARAMS("sigmoid", "Enable sigmoidization", sigmoid_params),
@@ -962,7 +963,10 @@ const struct pl_opt_t pl_option_list[] = {
     OPT_FLOAT("minimum_peak", "Minimum detected peak", peak_detect_params.minimum_peak, .max = 100.0, .deprecated = true),
     OPT_FLOAT("peak_percentile", "Peak detection percentile", peak_detect_params.percentile, .max = 100.0),
     OPT_FLOAT("black_cutoff", "Peak detection black cutoff", peak_detect_params.black_cutoff, .max = 100.0),
+    OPT_BOOL("peak_downsample", "Downsample peak detection input", peak_detect_params.downsample),
+    OPT_INT("peak_detect_interval", "Peak detection interval", peak_detect_params.detect_interval, .max = 1000),
     OPT_BOOL("allow_delayed_peak", "Allow delayed peak detection", peak_detect_params.allow_delayed),
+    OPT_BOOL("peak_gpu_resident", "Keep peak detection results on the GPU", peak_detect_params.gpu_resident),
 
     // Color mapping
     OPT_ENABLE_PARAMS("color_map", "Enable color mapping", color_map_params),
@@ -980,6 +984,8 @@ const struct pl_opt_t pl_option_list[] = {
     OPT_INT("lut3d_size_C", "Gamut 3DLUT size C", color_map_params.lut3d_size[1], .max = 1024),
     OPT_INT("lut3d_size_h", "Gamut 3DLUT size h", color_map_params.lut3d_size[2], .max = 1024),
     OPT_BOOL("lut3d_tricubic", "Gamut 3DLUT tricubic interpolation", color_map_params.lut3d_tricubic),
+    OPT_BOOL("lut3d_adaptive", "Gamut 3DLUT adaptive size", color_map_params.lut3d_adaptive),
+    OPT_BOOL("lut3d_async", "Gamut 3DLUT background generation", color_map_params.lut3d_async),
     OPT_BOOL("gamut_expansion", "Gamut expansion", color_map_params.gamut_expansion),
     OPT_NAMED("tone_mapping", "Tone mapping function", color_map_params.tone_mapping_function,
               pl_tone_map_functions),
@@ -1088,7 +1094,8 @@ const struct pl_opt_t pl_option_list[] = {
     OPT_ENUM("deinterlace_algo", "Deinterlacing algorithm", deinterlace_params.algo, LIST(
              {"weave", PL_DEINTERLACE_WEAVE},
              {"bob",   PL_DEINTERLACE_BOB},
-             {"yadif", PL_DEINTERLACE_YADIF})),
+             {"yadif", PL_DEINTERLACE_YADIF},
+             {"bwdif", PL_DEINTERLACE_BWDIF})),
     OPT_BOOL("deinterlace_skip_spatial", "Skip spatial interlacing check", deinterlace_params.skip_spatial_check),
 
     // Distortion
@@ -1138,11 +1145,16 @@ const struct pl_opt_t pl_option_list[] = {
 
     // Performance / quality trade-offs and debugging options
     OPT_BOOL("skip_anti_aliasing", "Skip anti-aliasing", params.skip_anti_aliasing),
+    OPT_BOOL("multistage_downscaling", "Multi-stage downscaling", params.multistage_downscaling),
     OPT_INT("lut_entries", "Scaler LUT entries", params.lut_entries, .max = 256, .deprecated = true),
     OPT_FLOAT("polar_cutoff", "Polar LUT cutoff", params.polar_cutoff, .max = 1.0, .deprecated = true),
     OPT_BOOL("preserve_mixing_cache", "Preserve mixing cache", params.preserve_mixing_cache),
+    OPT_INT("frame_cache_memory", "Frame cache history (MiB)", params.frame_cache_memory, .max = 1 << 20),
+    OPT_INT("max_mix_frames", "Maximum frames per mixing pass", params.max_mix_frames, .max = 16),
     OPT_BOOL("skip_caching_single_frame", "Skip caching single frame", params.skip_caching_single_frame),
+    OPT_BOOL("reuse_mixed_output", "Reuse mixed output", params.reuse_mixed_output),
     OPT_BOOL("disable_linear_scaling", "Disable linear scaling", params.disable_linear_scaling),
+    OPT_BOOL("color_passthrough", "Skip color conversion when compatible", params.color_passthrough),
     OPT_BOOL("disable_builtin_scalers", "Disable built-in scalers", params.disable_builtin_scalers),
     OPT_BOOL("correct_subpixel_offset", "Correct subpixel offsets", params.correct_subpixel_offsets),
     OPT_BOOL("ignore_icc_profiles", "Ignore ICC profiles", params.ignore_icc_profiles, .deprecated = true),
@@ -1150,18 +1162,69 @@ const struct pl_opt_t pl_option_list[] = {
     OPT_BOOL("disable_dither_gamma_correction", "Disable gamma-correct dithering", params.disable_dither_gamma_correction),
     OPT_BOOL("disable_fbos", "Disable FBOs", params.disable_fbos),
     OPT_BOOL("force_low_bit_depth_fbos", "Force 8-bit FBOs", params.force_low_bit_depth_fbos),
+    OPT_BOOL("auto_fbo_precision", "Reduce FBO precision when safe", params.auto_fbo_precision),
+    OPT_INT("max_fbo_memory", "Max FBO memory (MiB)", params.max_fbo_memory, .max = 1 << 20),
+    OPT_INT("max_cache_memory", "Max cache memory (MiB)", params.max_cache_memory, .max = 1 << 20),
+    OPT_INT("render_tile_size", "Render tile size", params.render_tile_size, .max = 1 << 16),
     OPT_BOOL("dynamic_constants", "Dynamic constants", params.dynamic_constants),
+    OPT_BOOL("relaxed_precision", "Relaxed precision", params.relaxed_precision),
+    OPT_BOOL("autotune_compute", "Auto-tune compute group sizes", params.autotune_compute),
+    OPT_FLOAT("feature_map_downscale", "Feature map downscaling factor", params.feature_map_downscale, .max = 16.0),
+    OPT_BOOL("overlay_atlas", "Batch overlays using a shared atlas", params.overlay_atlas),
+    OPT_BOOL("async_compute", "Asynchronous peak detection", params.async_compute),
+    OPT_INT("dovi_lut_size", "Dolby Vision reshaping 3DLUT size", params.dovi_lut_size, .max = 128),
     {0},
 };
 
 const int pl_option_count = PL_ARRAY_SIZE(pl_option_list) - 1;
 
-pl_opt pl_find_option(const char *key)
+// Open-addressed hash table over `pl_option_list`, built on first use, since
+// options are looked up by name for every key of every `pl_options_load`
+#define OPT_HASH_SIZE 512
+
+static struct opt_slot {
+    uint32_t hash;
+    uint16_t idx; // index + 1 into `pl_option_list`, or 0 if empty
+} opt_hash[OPT_HASH_SIZE];
+
+static pl_static_mutex opt_hash_lock = PL_STATIC_MUTEX_INITIALIZER;
+static atomic_bool opt_hash_ready;
+
+static void build_opt_hash(void)
 {
+    pl_static_assert(2 * (PL_ARRAY_SIZE(pl_option_list) - 1) <= OPT_HASH_SIZE);
     for (int i = 0; i < pl_option_count; i++) {
-        if (!strcmp(key, pl_option_list[i].key))
-            return &pl_option_list[i];
+        const uint64_t hash = pl_str0_hash(pl_option_list[i].key);
+        size_t n = hash & (OPT_HASH_SIZE - 1);
+        while (opt_hash[n].idx)
+            n = (n + 1) & (OPT_HASH_SIZE - 1);
+        opt_hash[n] = (struct opt_slot) { .hash = hash, .idx = i + 1 };
     }
+}
 
-    return NULL;
+static pl_opt lookup_option(pl_str key)
+{
+    if (!atomic_load_explicit(&opt_hash_ready, memory_order_acquire)) {
+        pl_static_mutex_lock(&opt_hash_lock);
+        if (!atomic_load_explicit(&opt_hash_ready, memory_order_relaxed)) {
+            build_opt_hash();
+            atomic_store_explicit(&opt_hash_ready, true, memory_order_release);
+        }
+        pl_static_mutex_unlock(&opt_hash_lock);
+    }
+
+    const uint64_t hash = pl_str_hash(key);
+    for (size_t n = hash & (OPT_HASH_SIZE - 1);; n = (n + 1) & (OPT_HASH_SIZE - 1)) {
+        const struct opt_slot *slot = &opt_hash[n];
+        if (!slot->idx)
+            return NULL;
+        pl_opt opt = &pl_option_list[slot->idx - 1];
+        if (slot->hash == (uint32_t) hash && pl_str_equals0(key, opt->key))
+            return opt;
+    }
+}
+
+pl_opt pl_find_option(const char *key)
+{
+    return lookup_option(pl_str0(key));
 }
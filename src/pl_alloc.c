@@ -38,6 +38,33 @@ struct ext {
     struct header *children[];
 };
 
+#ifndef NDEBUG
+static atomic_uint_fast64_t stats_count;
+static atomic_uint_fast64_t stats_bytes;
+
+static inline void count_alloc(size_t size)
+{
+    atomic_fetch_add_explicit(&stats_count, 1, memory_order_relaxed);
+    atomic_fetch_add_explicit(&stats_bytes, size, memory_order_relaxed);
+}
+#else
+static inline void count_alloc(size_t size) {}
+#endif
+
+bool pl_alloc_get_stats(struct pl_alloc_stats *stats)
+{
+#ifndef NDEBUG
+    *stats = (struct pl_alloc_stats) {
+        .count = atomic_load_explicit(&stats_count, memory_order_relaxed),
+        .bytes = atomic_load_explicit(&stats_bytes, memory_order_relaxed),
+    };
+    return true;
+#else
+    *stats = (struct pl_alloc_stats) {0};
+    return false;
+#endif
+}
+
 #define PTR_OFFSET offsetof(struct header, data)
 #define MAX_ALLOC (SIZE_MAX - PTR_OFFSET)
 #define MINIMUM_CHILDREN 4
@@ -123,6 +150,7 @@ void *pl_alloc(void *parent, size_t size)
     struct header *h = malloc(PTR_OFFSET + size);
     if (!h)
         return oom();
+    count_alloc(size);
 
 #ifndef NDEBUG
     h->magic = MAGIC;
@@ -142,6 +170,7 @@ void *pl_zalloc(void *parent, size_t size)
     struct header *h = calloc(1, PTR_OFFSET + size);
     if (!h)
         return oom();
+    count_alloc(size);
 
 #ifndef NDEBUG
     h->magic = MAGIC;
@@ -169,6 +198,7 @@ void *pl_realloc(void *parent, void *ptr, size_t size)
     if (!h)
         return oom();
 
+    count_alloc(size);
     h->size = size;
 
     if (h != old_h) {
@@ -285,6 +315,94 @@ char *pl_strndup0(void *parent, const char *str, size_t size)
     return new;
 }
 
+void *pl_arena_alloc(pl_arena *arena, size_t size, size_t align)
+{
+    const size_t offset = PL_ALIGN2(arena->len, align);
+    const size_t req_size = offset + size;
+    if (req_size <= pl_get_size(arena->buf)) {
+        arena->len = req_size;
+        return arena->buf + offset;
+    }
+
+    // We can't realloc this buffer because existing allocations would be left
+    // dangling, so just retire it until the next reset and allocate a new,
+    // larger buffer in its place
+    if (arena->buf) {
+        if (!arena->retired)
+            arena->retired = pl_tmp(arena->parent);
+        pl_steal(arena->retired, arena->buf);
+    }
+
+    const size_t new_size = PL_MAX(req_size << 1, 256);
+    arena->buf = pl_alloc(arena->parent, new_size);
+    arena->len = size;
+    return arena->buf;
+}
+
+void *pl_arena_zalloc(pl_arena *arena, size_t size, size_t align)
+{
+    void *ptr = pl_arena_alloc(arena, size, align);
+    memset(ptr, 0, size);
+    return ptr;
+}
+
+void *pl_arena_memdup(pl_arena *arena, const void *ptr, size_t size, size_t align)
+{
+    if (!size)
+        return NULL;
+
+    void *new = pl_arena_alloc(arena, size, align);
+    assert(ptr);
+    memcpy(new, ptr, size);
+    return new;
+}
+
+void pl_arena_reset(pl_arena *arena)
+{
+    pl_free_children(arena->retired);
+    arena->len = 0;
+}
+
+void pl_arena_steal(pl_arena *dst, pl_arena *src)
+{
+    if (!src->buf)
+        return;
+
+    if (!dst->retired)
+        dst->retired = pl_tmp(dst->parent);
+    pl_steal(dst->retired, src->buf);
+    if (src->retired)
+        pl_steal(dst->retired, src->retired);
+
+    src->buf = NULL;
+    src->len = 0;
+    src->retired = NULL;
+}
+
+char *pl_arena_asprintf(pl_arena *arena, const char *fmt, ...)
+{
+    char *str;
+    va_list ap;
+    va_start(ap, fmt);
+    str = pl_arena_vasprintf(arena, fmt, ap);
+    va_end(ap);
+    return str;
+}
+
+char *pl_arena_vasprintf(pl_arena *arena, const char *fmt, va_list ap)
+{
+    va_list copy;
+    va_copy(copy, ap);
+    int size = vsnprintf(NULL, 0, fmt, copy);
+    va_end(copy);
+    if (size < 0)
+        return NULL;
+
+    char *str = pl_arena_alloc(arena, size + 1, 1);
+    vsnprintf(str, size + 1, fmt, ap);
+    return str;
+}
+
 char *pl_asprintf(void *parent, const char *fmt, ...)
 {
     char *str;
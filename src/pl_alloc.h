@@ -19,6 +19,7 @@
 
 #include <stdalign.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -36,6 +37,16 @@ static inline void *pl_calloc(void *parent, size_t count, size_t size)
 
 #define pl_tmp(parent) pl_alloc(parent, 0)
 
+// Running totals of all (re)allocations made through the above functions,
+// for benchmarking purposes. These are only tracked in debug builds (without
+// NDEBUG); otherwise this returns false and zeroes `stats`.
+struct pl_alloc_stats {
+    uint64_t count; // number of (re)allocations
+    uint64_t bytes; // sum of requested sizes
+};
+
+bool pl_alloc_get_stats(struct pl_alloc_stats *stats);
+
 // Variants of the above which resolve to sizeof(*ptr)
 #define pl_alloc_ptr(parent, ptr) \
     (__typeof__(ptr)) pl_alloc(parent, sizeof(*(ptr)))
@@ -79,6 +90,31 @@ char *pl_strndup0(void *parent, const char *str, size_t size);
 #define pl_memdup_ptr(parent, ptr) \
     (__typeof__(ptr)) pl_memdup(parent, ptr, sizeof(*(ptr)))
 
+// Bump-pointer arena for many small, short-lived allocations that are all
+// released together. Allocations can't be freed or resized individually, and
+// remain valid until the next `pl_arena_reset`, which is O(1) once the arena
+// has grown to its steady-state size. All memory is owned by `parent`.
+typedef struct pl_arena {
+    void *parent;
+    uint8_t *buf;
+    size_t len;
+    void *retired; // exhausted buffers, freed on the next reset
+} pl_arena;
+
+#define pl_arena_init(owner) ((pl_arena) { .parent = (owner) })
+
+void *pl_arena_alloc(pl_arena *arena, size_t size, size_t align);
+void *pl_arena_zalloc(pl_arena *arena, size_t size, size_t align);
+void *pl_arena_memdup(pl_arena *arena, const void *ptr, size_t size, size_t align);
+void pl_arena_reset(pl_arena *arena);
+
+// Transfer all memory held by `src` to `dst`. Existing allocations from `src`
+// remain valid until `dst` is reset, while `src` starts over from scratch.
+void pl_arena_steal(pl_arena *dst, pl_arena *src);
+
+#define pl_arena_calloc_ptr(arena, num, ptr) \
+    (__typeof__(ptr)) pl_arena_zalloc(arena, (num) * sizeof(*(ptr)), alignof(__typeof__(*(ptr))))
+
 // Helper functions for allocating public/private pairs, done by allocating
 // `priv` at the address of `pub` + sizeof(pub), rounded up to the maximum
 // alignment requirements.
@@ -0,0 +1,201 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "common.h"
+#include "pl_memcpy.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define HAVE_STREAM 1
+#else
+#define HAVE_STREAM 0
+#endif
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// Below this size, the alignment handling and fence outweigh any benefit
+#define STREAM_MIN 256
+
+#if HAVE_STREAM
+// Non-temporal copy without the trailing fence
+static inline void stream_copy(uint8_t *dst, const uint8_t *src, size_t size)
+{
+    if (size < STREAM_MIN) {
+        memcpy(dst, src, size);
+        return;
+    }
+
+    // Streaming stores require an aligned destination
+    size_t head = (16 - ((uintptr_t) dst & 15)) & 15;
+    memcpy(dst, src, head);
+    dst += head;
+    src += head;
+    size -= head;
+
+    size_t body = size & ~(size_t) 63;
+    for (size_t i = 0; i < body; i += 64) {
+        __m128i a = _mm_loadu_si128((const __m128i *) (src + i));
+        __m128i b = _mm_loadu_si128((const __m128i *) (src + i + 16));
+        __m128i c = _mm_loadu_si128((const __m128i *) (src + i + 32));
+        __m128i d = _mm_loadu_si128((const __m128i *) (src + i + 48));
+        _mm_stream_si128((__m128i *) (dst + i),      a);
+        _mm_stream_si128((__m128i *) (dst + i + 16), b);
+        _mm_stream_si128((__m128i *) (dst + i + 32), c);
+        _mm_stream_si128((__m128i *) (dst + i + 48), d);
+    }
+
+    memcpy(dst + body, src + body, size - body);
+}
+#endif
+
+void pl_memcpy_stream(void *dst, const void *src, size_t size)
+{
+#if HAVE_STREAM
+    stream_copy(dst, src, size);
+    _mm_sfence();
+#else
+    memcpy(dst, src, size);
+#endif
+}
+
+// Generates a row loop with a constant copy size, which the compiler can
+// inline into plain loads and stores
+#define COPY_ROWS(size)                                 \
+    do {                                                \
+        for (size_t y = 0; y < rows; y++) {             \
+            memcpy(d, s, size);                         \
+            d += dst_pitch;                             \
+            s += src_pitch;                             \
+        }                                               \
+    } while (0)
+
+void pl_memcpy_2d(void *dst, size_t dst_pitch, const void *src, size_t src_pitch,
+                  size_t row_size, size_t rows, bool stream)
+{
+    if (!rows || !row_size)
+        return;
+
+    // Tightly packed on both sides, copy everything at once
+    if (rows == 1 || (row_size == dst_pitch && row_size == src_pitch)) {
+        size_t size = (rows - 1) * dst_pitch + row_size;
+        if (stream) {
+            pl_memcpy_stream(dst, src, size);
+        } else {
+            memcpy(dst, src, size);
+        }
+        return;
+    }
+
+    uint8_t *d = dst;
+    const uint8_t *s = src;
+
+#if HAVE_STREAM
+    if (stream && row_size >= STREAM_MIN) {
+        for (size_t y = 0; y < rows; y++) {
+            stream_copy(d, s, row_size);
+            d += dst_pitch;
+            s += src_pitch;
+        }
+        _mm_sfence();
+        return;
+    }
+#endif
+
+    switch (row_size) {
+    case 4:  COPY_ROWS(4);  return;
+    case 8:  COPY_ROWS(8);  return;
+    case 12: COPY_ROWS(12); return;
+    case 16: COPY_ROWS(16); return;
+    default: COPY_ROWS(row_size); return;
+    }
+}
+
+static inline void swap_scalar(uint8_t *dst, const uint8_t *src, size_t size,
+                               int wordsize)
+{
+    size_t i = 0;
+    switch (wordsize) {
+    case 2:
+        for (; i + 2 <= size; i += 2) {
+            uint16_t w;
+            memcpy(&w, src + i, 2);
+            w = (w << 8) | (w >> 8);
+            memcpy(dst + i, &w, 2);
+        }
+        break;
+    case 4:
+        for (; i + 4 <= size; i += 4) {
+            uint32_t w;
+            memcpy(&w, src + i, 4);
+            w = (w << 24) | ((w << 8) & 0xFF0000u) |
+                ((w >> 8) & 0xFF00u) | (w >> 24);
+            memcpy(dst + i, &w, 4);
+        }
+        break;
+    }
+
+    memcpy(dst + i, src + i, size - i);
+}
+
+void pl_memcpy_swap(void *dst_ptr, const void *src_ptr, size_t size, int wordsize)
+{
+    pl_assert(wordsize == 1 || wordsize == 2 || wordsize == 4);
+    if (wordsize == 1) {
+        memcpy(dst_ptr, src_ptr, size);
+        return;
+    }
+
+    uint8_t *dst = dst_ptr;
+    const uint8_t *src = src_ptr;
+    size_t body = size & ~(size_t) 15;
+
+    // Every 16-byte block contains a whole number of words, so the vector
+    // loops only ever need to handle the block-aligned body
+#if defined(__SSSE3__)
+    const __m128i mask = wordsize == 2
+        ? _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14)
+        : _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+    for (size_t i = 0; i < body; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        _mm_storeu_si128((__m128i *) (dst + i), _mm_shuffle_epi8(v, mask));
+    }
+#elif defined(__SSE2__)
+    for (size_t i = 0; i < body; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *) (src + i));
+        if (wordsize == 4) {
+            v = _mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+            v = _mm_shufflehi_epi16(v, _MM_SHUFFLE(2, 3, 0, 1));
+        }
+        v = _mm_or_si128(_mm_slli_epi16(v, 8), _mm_srli_epi16(v, 8));
+        _mm_storeu_si128((__m128i *) (dst + i), v);
+    }
+#elif defined(__ARM_NEON)
+    for (size_t i = 0; i < body; i += 16) {
+        uint8x16_t v = vld1q_u8(src + i);
+        vst1q_u8(dst + i, wordsize == 2 ? vrev16q_u8(v) : vrev32q_u8(v));
+    }
+#else
+    body = 0;
+#endif
+
+    swap_scalar(dst + body, src + body, size - body, wordsize);
+}
@@ -0,0 +1,40 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Copies `size` bytes into memory that is expected to be write-combined or
+// otherwise uncached, e.g. mapped staging buffers. Where supported, this uses
+// non-temporal stores that bypass the cache, rather than polluting it with
+// data that will never be read back by the CPU. All stores are globally
+// visible by the time this function returns. Must not overlap.
+void pl_memcpy_stream(void *dst, const void *src, size_t size);
+
+// Copies `rows` rows of `row_size` bytes each between two buffers with
+// (possibly) different row pitches. Bytes between rows are left untouched.
+// If `stream` is true, the destination is written as per `pl_memcpy_stream`.
+void pl_memcpy_2d(void *dst, size_t dst_pitch, const void *src, size_t src_pitch,
+                  size_t row_size, size_t rows, bool stream);
+
+// Copies `size` bytes while reversing the byte order of every `wordsize`-byte
+// word, with `wordsize` being one of 1, 2 or 4. Any trailing bytes that do not
+// form a complete word are copied unmodified. Must not overlap.
+void pl_memcpy_swap(void *dst, const void *src, size_t size, int wordsize);
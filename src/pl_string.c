@@ -18,6 +18,13 @@
 #include "common.h"
 #include "hash.h"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#define HAVE_HEX_SIMD 1
+#else
+#define HAVE_HEX_SIMD 0
+#endif
+
 static void grow_str(void *alloc, pl_str *str, size_t len)
 {
     // Like pl_grow, but with some extra headroom
@@ -113,21 +120,6 @@ size_t pl_strcspn(pl_str str, const char *reject)
     return str.len;
 }
 
-static inline bool pl_isspace(char c)
-{
-    switch (c) {
-    case ' ':
-    case '\n':
-    case '\r':
-    case '\t':
-    case '\v':
-    case '\f':
-        return true;
-    default:
-        return false;
-    }
-}
-
 pl_str pl_str_strip(pl_str str)
 {
     while (str.len && pl_isspace(str.buf[0])) {
@@ -223,15 +215,56 @@ static bool get_hexdigit(pl_str *str, int *digit)
     return true;
 }
 
+#if HAVE_HEX_SIMD
+// Decodes a run of 16 hex digits into 8 bytes, or returns false (without
+// writing anything) if any of them is not a hex digit
+static inline bool decode_hex16(uint8_t *dst, const uint8_t *src)
+{
+    const __m128i v = _mm_loadu_si128((const __m128i *) src);
+
+    // Bytes >= 0x80 wrap around to negative values here, so signed compares
+    // reject them along with every other non-digit
+    const __m128i d = _mm_sub_epi8(v, _mm_set1_epi8('0'));
+    const __m128i l = _mm_sub_epi8(_mm_or_si128(v, _mm_set1_epi8(0x20)),
+                                   _mm_set1_epi8('a'));
+    const __m128i is_d = _mm_and_si128(_mm_cmpgt_epi8(d, _mm_set1_epi8(-1)),
+                                       _mm_cmplt_epi8(d, _mm_set1_epi8(10)));
+    const __m128i is_l = _mm_and_si128(_mm_cmpgt_epi8(l, _mm_set1_epi8(-1)),
+                                       _mm_cmplt_epi8(l, _mm_set1_epi8(6)));
+    if (_mm_movemask_epi8(_mm_or_si128(is_d, is_l)) != 0xFFFF)
+        return false;
+
+    const __m128i nib = _mm_or_si128(
+        _mm_and_si128(is_d, d),
+        _mm_and_si128(is_l, _mm_add_epi8(l, _mm_set1_epi8(10))));
+
+    // Each 16-bit lane holds (lo << 8) | hi, combine to (hi << 4) | lo
+    const __m128i hi = _mm_slli_epi16(_mm_and_si128(nib, _mm_set1_epi16(0xFF)), 4);
+    const __m128i out = _mm_or_si128(hi, _mm_srli_epi16(nib, 8));
+    _mm_storel_epi64((__m128i *) dst, _mm_packus_epi16(out, out));
+    return true;
+}
+#endif
+
 bool pl_str_decode_hex(void *alloc, pl_str hex, pl_str *out)
 {
     if (!out)
         return false;
 
     uint8_t *buf = pl_alloc(alloc, hex.len / 2);
-    int len = 0;
+    size_t len = 0;
 
     while (hex.len) {
+#if HAVE_HEX_SIMD
+        // Fast path for runs of digits without any interleaved whitespace,
+        // which is what the bulk of any large payload consists of
+        while (hex.len >= 16 && decode_hex16(buf + len, hex.buf)) {
+            hex.buf += 16;
+            hex.len -= 16;
+            len += 8;
+        }
+#endif
+
         int a, b;
         if (!get_hexdigit(&hex, &a) || !get_hexdigit(&hex, &b))
             goto error; // invalid char
@@ -255,6 +288,7 @@ struct pl_str_builder_t {
     PL_ARRAY(pl_str_template) templates;
     pl_str args;
     pl_str output;
+    bool output_valid; // `output` is up-to-date with the templates
 };
 
 pl_str_builder pl_str_builder_alloc(void *alloc)
@@ -288,6 +322,9 @@ uint64_t pl_str_builder_hash(const pl_str_builder b)
 
 pl_str pl_str_builder_exec(pl_str_builder b)
 {
+    if (b->output_valid)
+        return b->output;
+
     pl_str args = b->args;
 
     b->output.len = 0;
@@ -300,6 +337,7 @@ pl_str pl_str_builder_exec(pl_str_builder b)
     // Terminate with an extra \0 byte for convenience
     grow_str(b, &b->output, b->output.len + 1);
     b->output.buf[b->output.len] = '\0';
+    b->output_valid = true;
     return b->output;
 }
 
@@ -308,11 +346,19 @@ void pl_str_builder_append(pl_str_builder b, pl_str_template tmpl,
 {
     PL_ARRAY_APPEND(b, b->templates, tmpl);
     pl_str_append_raw(b, &b->args, args, size);
+    b->output_valid = false;
 }
 
 void pl_str_builder_concat(pl_str_builder b, const pl_str_builder append)
 {
+    // Re-use the already rendered output instead of replaying all templates
+    if (append->output_valid) {
+        pl_str_builder_str(b, append->output);
+        return;
+    }
+
     PL_ARRAY_CONCAT(b, b->templates, append->templates);
+    b->output_valid = false;
     pl_str_append_raw(b, &b->args, append->args.buf, append->args.len);
 }
 
@@ -65,6 +65,10 @@ char *pl_asprintf(void *parent, const char *fmt, ...)
     PL_PRINTF(2, 3);
 char *pl_vasprintf(void *parent, const char *fmt, va_list ap)
     PL_PRINTF(2, 0);
+char *pl_arena_asprintf(pl_arena *arena, const char *fmt, ...)
+    PL_PRINTF(2, 3);
+char *pl_arena_vasprintf(pl_arena *arena, const char *fmt, va_list ap)
+    PL_PRINTF(2, 0);
 void pl_str_append_asprintf(void *alloc, pl_str *str, const char *fmt, ...)
     PL_PRINTF(3, 4);
 void pl_str_append_vasprintf(void *alloc, pl_str *str, const char *fmt, va_list va)
@@ -121,6 +125,13 @@ static inline bool pl_str_parse_float(pl_str str, float *out)
     return ret;
 }
 
+// Parses up to `num` whitespace-separated floats from the start of `*str`,
+// stopping at the first token that is not a valid number. Returns the number
+// of values written to `out`, and advances `*str` past them (i.e. to the
+// offending token, if any). Faster than tokenizing and calling
+// `pl_str_parse_float` per value.
+size_t pl_str_parse_floats(pl_str *str, float *out, size_t num);
+
 static inline bool pl_str_parse_int(pl_str str, int *out)
 {
     int64_t i64;
@@ -147,6 +158,22 @@ int ccSeqParseInt64( char *seq, int seqlength, int64_t *retint );
 int ccSeqParseUint64( char *seq, int seqlength, uint64_t *retint );
 int ccSeqParseDouble( char *seq, int seqlength, double *retdouble );
 
+// Locale-invariant isspace()
+static inline bool pl_isspace(char c)
+{
+    switch (c) {
+    case ' ':
+    case '\n':
+    case '\r':
+    case '\t':
+    case '\v':
+    case '\f':
+        return true;
+    default:
+        return false;
+    }
+}
+
 // Variants of string.h functions
 int pl_strchr(pl_str str, int c);
 size_t pl_strspn(pl_str str, const char *accept);
@@ -303,14 +330,17 @@ uint64_t pl_str_builder_hash(const pl_str_builder builder);
 // is guaranteed to be \0-terminated, as a minor convenience.
 //
 // Calling any other `pl_str_builder_*` function on this builder causes the
-// contents of the returned string to become undefined.
+// contents of the returned string to become undefined. Executing a builder
+// again without modifying it in between returns the same output for free.
 pl_str pl_str_builder_exec(pl_str_builder builder);
 
 // Append a template and its arguments to a string builder
 void pl_str_builder_append(pl_str_builder builder, pl_str_template tmpl,
                            const void *args, size_t args_size);
 
-// Append an entire other `pl_str_builder` onto `builder`
+// Append an entire other `pl_str_builder` onto `builder`. If `append` was
+// executed and not modified since, its rendered output is copied as a single
+// string instead of replaying all of its templates.
 void pl_str_builder_concat(pl_str_builder builder, const pl_str_builder append);
 
 // Append a constant string. This will only record &str into the buffer, which
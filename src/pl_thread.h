@@ -37,6 +37,9 @@ int pl_mutex_destroy(pl_mutex *mutex);
 int pl_mutex_lock(pl_mutex *mutex);
 int pl_mutex_unlock(pl_mutex *mutex);
 
+// Returns 0 if the mutex was acquired, nonzero if it's held by another thread
+int pl_mutex_trylock(pl_mutex *mutex);
+
 typedef void pl_cond;
 int pl_cond_init(pl_cond *cond);
 int pl_cond_destroy(pl_cond *cond);
@@ -58,6 +61,9 @@ typedef void pl_thread;
 int pl_thread_create(pl_thread *thread, PL_THREAD_VOID (*fun)(void *), void *arg);
 int pl_thread_join(pl_thread thread);
 
+// Releases the thread handle, letting it clean up on its own when it exits
+int pl_thread_detach(pl_thread thread);
+
 // Returns true if slept the full time, false otherwise
 bool pl_thread_sleep(double t);
 
@@ -0,0 +1,254 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#include "common.h"
+#include "pl_thread.h"
+#include "pl_thread_pool.h"
+
+#ifdef PL_HAVE_UNIX
+#include <unistd.h>
+#endif
+
+enum {
+    MAX_WORKERS = 32,
+};
+
+// Time after which idle workers exit, in nanoseconds
+static const uint64_t idle_timeout = UINT64_C(5000000000);
+
+struct job {
+    struct job *next_job;
+    void (*fun)(void *priv, int i);
+    void *priv;
+    int num;
+    int next;     // next index to claim
+    int finished; // number of completed calls
+};
+
+struct thread {
+    pl_thread thread;
+    bool joinable; // thread was spawned and not yet joined
+    bool exited;   // thread has left `worker` and can be joined
+    bool reaping;  // thread is being joined by `pl_thread_pool_unref`
+};
+
+static struct {
+    pl_mutex lock;
+    pl_cond wakeup; // signalled when new jobs are queued
+    pl_cond done;   // signalled whenever a job completes
+    struct job *queue;
+    struct thread threads[MAX_WORKERS];
+    int max_workers;
+    int num_workers;
+    int num_idle;
+    int refcount;
+    int quit;       // idle workers should exit immediately, if nonzero
+    bool init;
+} pool;
+
+static pl_static_mutex pool_init_lock = PL_STATIC_MUTEX_INITIALIZER;
+
+static int num_cpus(void)
+{
+#if defined(PL_HAVE_UNIX) && defined(_SC_NPROCESSORS_ONLN)
+    long num = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num > 0)
+        return num;
+#elif defined(PL_HAVE_WIN32)
+    SYSTEM_INFO sysInfo;
+    GetSystemInfo(&sysInfo);
+    if (sysInfo.dwNumberOfProcessors > 0)
+        return sysInfo.dwNumberOfProcessors;
+#endif
+
+    return MAX_WORKERS;
+}
+
+static void pool_init(void)
+{
+    pl_static_mutex_lock(&pool_init_lock);
+    if (!pool.init) {
+        pl_mutex_init(&pool.lock);
+        pl_cond_init(&pool.wakeup);
+        pl_cond_init(&pool.done);
+        // The calling thread always participates, so leave one CPU for it
+        pool.max_workers = PL_CLAMP(num_cpus() - 1, 0, MAX_WORKERS);
+        pool.init = true;
+    }
+    pl_static_mutex_unlock(&pool_init_lock);
+}
+
+static void dequeue(struct job *job)
+{
+    for (struct job **link = &pool.queue; *link; link = &(*link)->next_job) {
+        if (*link == job) {
+            *link = job->next_job;
+            return;
+        }
+    }
+}
+
+// Claims and runs a single call from `job`. Must be called with the pool
+// lock held, which is temporarily released while `job->fun` executes.
+static void run_one(struct job *job)
+{
+    pl_assert(job->next < job->num);
+    int i = job->next++;
+    if (job->next == job->num)
+        dequeue(job);
+
+    pl_mutex_unlock(&pool.lock);
+    job->fun(job->priv, i);
+    pl_mutex_lock(&pool.lock);
+
+    if (++job->finished == job->num)
+        pl_cond_broadcast(&pool.done);
+}
+
+static PL_THREAD_VOID worker(void *arg)
+{
+    struct thread *self = arg;
+    pl_mutex_lock(&pool.lock);
+    for (;;) {
+        if (pool.queue) {
+            run_one(pool.queue);
+            continue;
+        }
+
+        if (pool.quit)
+            break;
+
+        pool.num_idle++;
+        int ret = pl_cond_timedwait(&pool.wakeup, &pool.lock, idle_timeout);
+        pool.num_idle--;
+        if (ret == ETIMEDOUT && !pool.queue)
+            break;
+    }
+
+    self->exited = true;
+    pool.num_workers--;
+    pl_mutex_unlock(&pool.lock);
+    PL_THREAD_RETURN();
+}
+
+// Returns a free slot for spawning a new worker, joining an exited worker if
+// needed. Must be called with the pool lock held.
+static struct thread *get_slot(void)
+{
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        struct thread *t = &pool.threads[i];
+        if (!t->joinable)
+            return t;
+        if (t->exited && !t->reaping) {
+            // The thread has already released the lock for good, so this
+            // only reaps it and never blocks for long
+            pl_thread_join(t->thread);
+            t->joinable = false;
+            return t;
+        }
+    }
+
+    return NULL;
+}
+
+void pl_thread_pool_ref(void)
+{
+    pool_init();
+    pl_mutex_lock(&pool.lock);
+    pool.refcount++;
+    pl_mutex_unlock(&pool.lock);
+}
+
+void pl_thread_pool_unref(void)
+{
+    pl_mutex_lock(&pool.lock);
+    pl_assert(pool.refcount > 0);
+    if (--pool.refcount > 0) {
+        pl_mutex_unlock(&pool.lock);
+        return;
+    }
+
+    // Stop all workers. Busy workers finish the remaining queued jobs first,
+    // since those are still being waited on by their callers
+    pool.quit++;
+    pl_cond_broadcast(&pool.wakeup);
+    bool reap[MAX_WORKERS] = {0};
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        struct thread *t = &pool.threads[i];
+        if (t->joinable && !t->reaping)
+            reap[i] = t->reaping = true;
+    }
+    pl_mutex_unlock(&pool.lock);
+
+    // Slots being reaped are never handed out again until they are joined, so
+    // it's safe to access them without the lock here
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        if (reap[i])
+            pl_thread_join(pool.threads[i].thread);
+    }
+
+    pl_mutex_lock(&pool.lock);
+    for (int i = 0; i < MAX_WORKERS; i++) {
+        if (reap[i])
+            pool.threads[i].joinable = pool.threads[i].reaping = false;
+    }
+    pool.quit--;
+    pl_mutex_unlock(&pool.lock);
+}
+
+void pl_parallel_for(int num, void (*fun)(void *priv, int i), void *priv)
+{
+    if (num <= 1) {
+        if (num == 1)
+            fun(priv, 0);
+        return;
+    }
+
+    pool_init();
+    struct job job = {
+        .fun  = fun,
+        .priv = priv,
+        .num  = num,
+    };
+
+    pl_mutex_lock(&pool.lock);
+    struct job **tail = &pool.queue;
+    while (*tail)
+        tail = &(*tail)->next_job;
+    *tail = &job;
+
+    // Spawn enough workers to (ideally) handle all remaining calls in parallel
+    int wanted = PL_MIN(num - 1, pool.max_workers) - pool.num_idle;
+    while (wanted-- > 0 && pool.num_workers < pool.max_workers) {
+        struct thread *t = get_slot();
+        if (!t)
+            break;
+        t->exited = false;
+        if (pl_thread_create(&t->thread, worker, t) != 0)
+            break; // not fatal, run the calls on fewer threads
+        t->joinable = true;
+        pool.num_workers++;
+    }
+    pl_cond_broadcast(&pool.wakeup);
+
+    while (job.next < job.num)
+        run_one(&job);
+    while (job.finished < job.num)
+        pl_cond_wait(&pool.done, &pool.lock);
+    pl_mutex_unlock(&pool.lock);
+}
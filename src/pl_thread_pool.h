@@ -0,0 +1,40 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+
+#pragma once
+
+// Calls `fun(priv, i)` for every `i` in [0, num), distributing the calls over
+// a lazily created, process-wide pool of worker threads, and blocks until all
+// of them have completed. The calling thread also executes calls itself, so
+// this always makes forward progress, even if no worker threads could be
+// spawned. Calls may happen in any order and on any thread.
+//
+// Safe to call from any thread, including concurrently and from within `fun`
+// itself.
+void pl_parallel_for(int num, void (*fun)(void *priv, int i), void *priv);
+
+// Worker threads are joinable and owned by the pool. Idle workers exit after
+// a few seconds on their own, but are only reaped (joined) when their slot is
+// needed again, or when the last reference to the pool is released, at which
+// point all workers are stopped and joined before returning. Every `pl_log`
+// holds a reference, so destroying the last `pl_log` stops all workers.
+//
+// Note: `pl_thread_pool_unref` blocks until any jobs that are still running
+// on the pool have completed, and must not be called from within `fun`.
+void pl_thread_pool_ref(void);
+void pl_thread_pool_unref(void);
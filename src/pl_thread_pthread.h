@@ -65,6 +65,7 @@ static inline int pl_mutex_init_type_internal(pl_mutex *mutex, enum pl_mutex_typ
 #define pl_mutex_destroy    pthread_mutex_destroy
 #define pl_mutex_lock       pthread_mutex_lock
 #define pl_mutex_unlock     pthread_mutex_unlock
+#define pl_mutex_trylock    pthread_mutex_trylock
 
 static inline int pl_cond_init(pl_cond *cond)
 {
@@ -123,6 +124,7 @@ static inline int pl_cond_timedwait(pl_cond *cond, pl_mutex *mutex, uint64_t tim
 
 #define pl_thread_create(t, f, a) pthread_create(t, NULL, f, a)
 #define pl_thread_join(t)         pthread_join(t, NULL)
+#define pl_thread_detach(t)       pthread_detach(t)
 
 static inline bool pl_thread_sleep(double t)
 {
@@ -54,6 +54,11 @@ static inline int pl_mutex_unlock(pl_mutex *mutex)
     return 0;
 }
 
+static inline int pl_mutex_trylock(pl_mutex *mutex)
+{
+    return TryEnterCriticalSection(mutex) ? 0 : EBUSY;
+}
+
 static inline int pl_cond_init(pl_cond *cond)
 {
     InitializeConditionVariable(cond);
@@ -140,6 +145,11 @@ static inline int pl_thread_join(pl_thread thread)
     return 0;
 }
 
+static inline int pl_thread_detach(pl_thread thread)
+{
+    return CloseHandle(thread) ? 0 : EINVAL;
+}
+
 static inline bool pl_thread_sleep(double t)
 {
     // Time is expected in 100 nanosecond intervals.
@@ -22,6 +22,7 @@
 #include "hash.h"
 #include "shaders.h"
 #include "dispatch.h"
+#include "gpu.h"
 
 #include <libplacebo/renderer.h>
 
@@ -33,7 +34,27 @@ struct cached_frame {
     pl_rect2df crop;
     pl_tex tex;
     int comps;
+    uint64_t id; // unique per (re)render, for `struct motion_state`
     bool evict; // for garbage collection
+    int age;    // number of mixing calls this frame went unused, for LRU
+};
+
+struct fbo {
+    pl_tex tex;
+    int idle; // number of consecutive passes this FBO went unused
+};
+
+// Output of a deterministic hook invocation, see `pl_hook.deterministic`
+struct cached_hook {
+    uint64_t slot; // identifies the hook invocation within a pass
+    uint64_t key;  // hash of everything the output depends on
+    pl_tex tex;
+    pl_rect2df rect;
+    struct pl_color_repr repr;
+    struct pl_color_space color;
+    int comps;
+    bool used; // since the last garbage collection
+    int idle;  // number of consecutive passes with hooks this went unused
 };
 
 struct sampler {
@@ -47,11 +68,32 @@ struct osd_vertex {
     float color[4];
 };
 
+// Shared texture containing the parts of several overlays, see
+// `pl_render_params.overlay_atlas`
+struct osd_atlas {
+    pl_tex tex;
+    uint64_t signature;
+    PL_ARRAY(pl_rect2d) rects; // placement of each part, excluding padding
+    bool converted; // contents are in the target colors, premultiplied
+    bool used; // used during the current frame
+    int idle;  // number of consecutive frames this atlas went unused
+};
+
 struct icc_state {
     pl_icc_object icc;
     uint64_t error; // set to profile signature on failure
 };
 
+// Luma pyramids of the last two interpolated frames, and the motion field
+// between them, see `pl_render_params.motion_params`
+struct motion_state {
+    uint64_t ids[2]; // `cached_frame.id` each pyramid was generated from
+    int levels;      // number of valid levels in each pyramid
+    pl_tex luma[2][PL_MOTION_MAX_LEVELS];
+    pl_tex vecs[PL_MOTION_MAX_LEVELS];
+    uint64_t vecs_key; // hash of the frame pair and params for `vecs`
+};
+
 struct pl_renderer_t {
     pl_gpu gpu;
     pl_dispatch dp;
@@ -69,7 +111,8 @@ struct pl_renderer_t {
     pl_shader_obj grain_state[4];
     pl_shader_obj lut_state[3];
     pl_shader_obj icc_state[2];
-    PL_ARRAY(pl_tex) fbos;
+    pl_shader_obj dovi_state;
+    PL_ARRAY(struct fbo) fbos;
     struct sampler sampler_main;
     struct sampler sampler_contrast;
     struct sampler samplers_src[4];
@@ -79,10 +122,55 @@ struct pl_renderer_t {
     PL_ARRAY(struct osd_vertex) osd_vertices;
     PL_ARRAY(uint16_t) osd_indices;
     struct pl_vertex_attrib osd_attribs[3];
+    PL_ARRAY(struct osd_atlas) osd_atlases;
 
     // Frame cache (for frame mixing / interpolation)
     PL_ARRAY(struct cached_frame) frames;
     PL_ARRAY(pl_tex) frame_fbos;
+    uint64_t frame_id;
+
+    // State for motion-compensated frame interpolation
+    struct motion_state motion;
+
+    // Outputs of deterministic hooks, reused for repeated frames
+    PL_ARRAY(struct cached_hook) hook_cache;
+    bool ran_hooks; // since the last garbage collection
+
+    // Snapshot of everything `render_params_info` depends on, and the
+    // resulting info, to skip re-hashing params that did not change
+    pl_str params_snapshot;
+    pl_str params_prev;
+    uint64_t params_hash;
+    bool params_trivial;
+
+    // Copy of the last mixed output, see `pl_render_params.reuse_mixed_output`
+    pl_tex mix_out;
+    uint64_t mix_out_hash;
+
+    // Intermediate target for tiled rendering
+    pl_tex tile_tex;
+
+    // Shared source image for multi-target rendering
+    pl_tex shared_tex;
+
+    // Linear light intermediate for `pl_render_image_composite`
+    pl_tex composite_tex;
+
+    // FBO memory budgeting, see `pl_render_params.max_fbo_memory`
+    int active_passes;
+    bool fbo_over_budget;
+
+    // Cache memory budgeting, see `pl_render_params.max_cache_memory`
+    bool cache_over_budget;
+
+    // Per-frame statistics, see `pl_renderer_get_frame_stats`
+    struct pl_render_frame_stats cur_stats;
+    struct pl_render_frame_stats frame_stats;
+    bool have_stats;
+
+    // Deferred pass information, see `pl_render_params.defer_info_callback`
+    PL_ARRAY(struct pl_render_info) cur_info, frame_info;
+    PL_ARRAY(struct pl_dispatch_info) cur_dinfo, frame_dinfo;
 
     // For debugging / logging purposes
     int prev_dither;
@@ -138,6 +226,23 @@ static void sampler_destroy(pl_renderer rr, struct sampler *sampler)
     pl_shader_obj_destroy(&sampler->downscaler_state);
 }
 
+static size_t sampler_mem_usage(const struct sampler *sampler)
+{
+    return sh_obj_mem_usage(sampler->upscaler_state) +
+           sh_obj_mem_usage(sampler->downscaler_state);
+}
+
+static void motion_destroy(pl_renderer rr, struct motion_state *m)
+{
+    for (int i = 0; i < PL_MOTION_MAX_LEVELS; i++) {
+        pl_tex_destroy(rr->gpu, &m->luma[0][i]);
+        pl_tex_destroy(rr->gpu, &m->luma[1][i]);
+        pl_tex_destroy(rr->gpu, &m->vecs[i]);
+    }
+
+    *m = (struct motion_state) {0};
+}
+
 void pl_renderer_destroy(pl_renderer *p_rr)
 {
     pl_renderer rr = *p_rr;
@@ -146,15 +251,25 @@ void pl_renderer_destroy(pl_renderer *p_rr)
 
     // Free all intermediate FBOs
     for (int i = 0; i < rr->fbos.num; i++)
-        pl_tex_destroy(rr->gpu, &rr->fbos.elem[i]);
+        pl_tex_destroy(rr->gpu, &rr->fbos.elem[i].tex);
     for (int i = 0; i < rr->frames.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frames.elem[i].tex);
     for (int i = 0; i < rr->frame_fbos.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frame_fbos.elem[i]);
+    for (int i = 0; i < rr->hook_cache.num; i++)
+        pl_tex_destroy(rr->gpu, &rr->hook_cache.elem[i].tex);
+    pl_tex_destroy(rr->gpu, &rr->mix_out);
+    pl_tex_destroy(rr->gpu, &rr->tile_tex);
+    pl_tex_destroy(rr->gpu, &rr->shared_tex);
+    pl_tex_destroy(rr->gpu, &rr->composite_tex);
+    for (int i = 0; i < rr->osd_atlases.num; i++)
+        pl_tex_destroy(rr->gpu, &rr->osd_atlases.elem[i].tex);
+    motion_destroy(rr, &rr->motion);
 
     // Free all shader resource objects
     pl_shader_obj_destroy(&rr->tone_map_state);
     pl_shader_obj_destroy(&rr->dither_state);
+    pl_shader_obj_destroy(&rr->dovi_state);
     for (int i = 0; i < PL_ARRAY_SIZE(rr->lut_state); i++)
         pl_shader_obj_destroy(&rr->lut_state[i]);
     for (int i = 0; i < PL_ARRAY_SIZE(rr->grain_state); i++)
@@ -174,6 +289,12 @@ void pl_renderer_destroy(pl_renderer *p_rr)
     for (int i = 0; i < PL_ARRAY_SIZE(rr->icc_fallback); i++)
         pl_icc_close(&rr->icc_fallback[i].icc);
 
+    // Free deferred pass information
+    for (int i = 0; i < rr->cur_dinfo.num; i++)
+        pl_shader_info_deref(&rr->cur_dinfo.elem[i].shader);
+    for (int i = 0; i < rr->frame_dinfo.num; i++)
+        pl_shader_info_deref(&rr->frame_dinfo.elem[i].shader);
+
     pl_dispatch_destroy(&rr->dp);
     pl_free_ptr(p_rr);
 }
@@ -188,15 +309,113 @@ void pl_renderer_load(pl_renderer rr, const uint8_t *cache)
     pl_cache_load(pl_gpu_cache(rr->gpu), cache, SIZE_MAX);
 }
 
-void pl_renderer_flush_cache(pl_renderer rr)
+// Releases all cached textures, but none of the persistent shader state
+static void flush_textures(pl_renderer rr)
 {
     for (int i = 0; i < rr->frames.num; i++)
         pl_tex_destroy(rr->gpu, &rr->frames.elem[i].tex);
     rr->frames.num = 0;
+    for (int i = 0; i < rr->frame_fbos.num; i++)
+        pl_tex_destroy(rr->gpu, &rr->frame_fbos.elem[i]);
+    rr->frame_fbos.num = 0;
+    for (int i = 0; i < rr->hook_cache.num; i++)
+        pl_tex_destroy(rr->gpu, &rr->hook_cache.elem[i].tex);
+    rr->hook_cache.num = 0;
+    pl_tex_destroy(rr->gpu, &rr->mix_out);
+    rr->mix_out_hash = 0;
+    motion_destroy(rr, &rr->motion);
+    pl_tex_destroy(rr->gpu, &rr->tile_tex);
+    pl_tex_destroy(rr->gpu, &rr->shared_tex);
+    pl_tex_destroy(rr->gpu, &rr->composite_tex);
+    for (int i = 0; i < rr->osd_atlases.num; i++) {
+        pl_tex_destroy(rr->gpu, &rr->osd_atlases.elem[i].tex);
+        pl_free(rr->osd_atlases.elem[i].rects.elem);
+    }
+    rr->osd_atlases.num = 0;
+}
 
+void pl_renderer_flush_cache(pl_renderer rr)
+{
+    flush_textures(rr);
+    rr->fbo_over_budget = false;
+    rr->cache_over_budget = false;
     pl_reset_detected_peak(rr->tone_map_state);
 }
 
+void pl_renderer_get_memory_usage(pl_renderer rr,
+                                  struct pl_renderer_memory_usage *out)
+{
+    struct pl_renderer_memory_usage usage = {0};
+    for (int i = 0; i < rr->fbos.num; i++)
+        usage.fbos += pl_tex_mem_size(rr->fbos.elem[i].tex);
+    usage.fbos += pl_tex_mem_size(rr->tile_tex);
+    usage.fbos += pl_tex_mem_size(rr->shared_tex);
+    usage.fbos += pl_tex_mem_size(rr->composite_tex);
+
+    for (int i = 0; i < rr->frames.num; i++)
+        usage.frame_cache += pl_tex_mem_size(rr->frames.elem[i].tex);
+    for (int i = 0; i < rr->frame_fbos.num; i++)
+        usage.frame_cache += pl_tex_mem_size(rr->frame_fbos.elem[i]);
+    usage.frame_cache += pl_tex_mem_size(rr->mix_out);
+    for (int i = 0; i < PL_MOTION_MAX_LEVELS; i++) {
+        usage.frame_cache += pl_tex_mem_size(rr->motion.luma[0][i]);
+        usage.frame_cache += pl_tex_mem_size(rr->motion.luma[1][i]);
+        usage.frame_cache += pl_tex_mem_size(rr->motion.vecs[i]);
+    }
+
+    for (int i = 0; i < rr->hook_cache.num; i++)
+        usage.hook_cache += pl_tex_mem_size(rr->hook_cache.elem[i].tex);
+    for (int i = 0; i < rr->osd_atlases.num; i++)
+        usage.overlays += pl_tex_mem_size(rr->osd_atlases.elem[i].tex);
+
+    usage.shader_objects += sampler_mem_usage(&rr->sampler_main);
+    usage.shader_objects += sampler_mem_usage(&rr->sampler_contrast);
+    for (int i = 0; i < PL_ARRAY_SIZE(rr->samplers_src); i++)
+        usage.shader_objects += sampler_mem_usage(&rr->samplers_src[i]);
+    for (int i = 0; i < PL_ARRAY_SIZE(rr->samplers_dst); i++)
+        usage.shader_objects += sampler_mem_usage(&rr->samplers_dst[i]);
+    usage.shader_objects += sh_obj_mem_usage(rr->tone_map_state);
+    usage.shader_objects += sh_obj_mem_usage(rr->dither_state);
+    usage.shader_objects += sh_obj_mem_usage(rr->dovi_state);
+    for (int i = 0; i < PL_ARRAY_SIZE(rr->grain_state); i++)
+        usage.shader_objects += sh_obj_mem_usage(rr->grain_state[i]);
+    for (int i = 0; i < PL_ARRAY_SIZE(rr->lut_state); i++)
+        usage.shader_objects += sh_obj_mem_usage(rr->lut_state[i]);
+    for (int i = 0; i < PL_ARRAY_SIZE(rr->icc_state); i++)
+        usage.shader_objects += sh_obj_mem_usage(rr->icc_state[i]);
+
+    usage.dispatch = pl_dispatch_mem_usage(rr->dp);
+    usage.total = usage.fbos + usage.frame_cache + usage.hook_cache +
+                  usage.overlays + usage.shader_objects + usage.dispatch;
+    *out = usage;
+}
+
+// Enforces `pl_render_params.max_cache_memory`. Must only be called once no
+// other pass is using any of the cached textures.
+static void gc_cache_memory(pl_renderer rr, const struct pl_render_params *params)
+{
+    if (params->max_cache_memory <= 0)
+        return;
+
+    struct pl_renderer_memory_usage usage;
+    pl_renderer_get_memory_usage(rr, &usage);
+    const size_t cached = usage.frame_cache + usage.hook_cache + usage.overlays;
+    if (cached <= ((size_t) params->max_cache_memory << 20))
+        return;
+
+    if (!rr->cache_over_budget) {
+        PL_WARN(rr, "Renderer caches (%zu MiB) exceed the configured memory "
+                "budget (%d MiB), flushing them", cached >> 20,
+                params->max_cache_memory);
+        rr->cache_over_budget = true;
+    } else {
+        PL_DEBUG(rr, "Flushing renderer caches (%zu MiB) exceeding the memory "
+                 "budget", cached >> 20);
+    }
+
+    flush_textures(rr);
+}
+
 const struct pl_render_params pl_render_fast_params = { PL_RENDER_DEFAULTS };
 const struct pl_render_params pl_render_default_params = {
     PL_RENDER_DEFAULTS
@@ -257,6 +476,9 @@ struct img {
     // If true, created shaders will be set to unique
     bool unique;
 
+    // Bitmask of PL_RENDER_OP_* contained in `sh`
+    unsigned ops;
+
     // Information about what to log/disable/fallback to if the shader fails
     const char *err_msg;
     enum pl_render_error err_enum;
@@ -335,6 +557,7 @@ struct pass_state {
     pl_renderer rr;
     const struct pl_render_params *params;
     struct pl_render_info info; // for info callback
+    size_t fbo_bytes; // size of the current dispatch target, if an FBO
 
     // Represents the "current" image which we're in the process of rendering.
     // This is initially set by pass_read_image, and all of the subsequent
@@ -366,8 +589,16 @@ struct pass_state {
 
     // Metadata for `rr->fbos`
     pl_fmt fbofmt[5];
+    pl_fmt lowfmt; // reduced precision format, for `auto_fbo_precision`
     bool *fbos_used;
+
+    // State for `rr->hook_cache`
+    uint64_t hook_chain; // hash of all cacheable hook invocations so far
+    uint64_t params_hash; // lazily computed `render_params_info` hash
+    int hook_calls; // number of cacheable hook invocations so far
+    bool hook_nocache; // image was modified by a non-cacheable hook
     bool need_peak_fbo; // need indirection for peak detection
+    bool shared_img; // result of `pass_read_image` is shared by many targets
 
     // Map of acquired frames
     struct {
@@ -404,7 +635,8 @@ static void find_fbo_format(struct pass_state *pass)
 
     pl_fmt fmt = NULL;
     for (int i = 0; i < PL_ARRAY_SIZE(configs); i++) {
-        if (params->force_low_bit_depth_fbos && configs[i].depth > 8)
+        bool low_bits = params->force_low_bit_depth_fbos || rr->fbo_over_budget;
+        if (low_bits && configs[i].depth > 8)
             continue;
 
         fmt = pl_find_fmt(rr->gpu, configs[i].type, 4, configs[i].depth, 0,
@@ -421,6 +653,17 @@ static void find_fbo_format(struct pass_state *pass)
                                         configs[i].depth, 0, fmt->caps);
             pass->fbofmt[c] = PL_DEF(pass->fbofmt[c], pass->fbofmt[c+1]);
         }
+
+        // rgb10a2 halves the bandwidth of 16-bit intermediates, while still
+        // leaving two bits of headroom over 8-bit SDR outputs. rg11b10f is
+        // deliberately not considered, since its 6/5-bit mantissas are worse
+        // than 8-bit unorm for gamma-encoded signals
+        if (params->auto_fbo_precision && fmt->component_depth[0] > 10) {
+            pl_fmt low = pl_find_named_fmt(rr->gpu, "rgb10a2");
+            const enum pl_fmt_caps caps = PL_FMT_CAP_RENDERABLE | configs[i].caps;
+            if (low && (low->caps & caps) == caps)
+                pass->lowfmt = low;
+        }
         return;
     }
 
@@ -432,6 +675,32 @@ static void info_callback(void *priv, const struct pl_dispatch_info *dinfo)
 {
     struct pass_state *pass = priv;
     const struct pl_render_params *params = pass->params;
+    struct pl_render_frame_stats *stats = &pass->rr->cur_stats;
+    if (!dinfo->skipped) {
+        stats->gpu_time += dinfo->last;
+        stats->passes++;
+        stats->fbo_bytes += pass->fbo_bytes;
+        for (int i = 0; i < PL_RENDER_OP_COUNT; i++) {
+            if (!(pass->info.ops & (1u << i)))
+                continue;
+            stats->ops[i].gpu_time += dinfo->last;
+            stats->ops[i].passes++;
+            stats->ops[i].fbo_bytes += pass->fbo_bytes;
+        }
+    }
+
+    if (params->defer_info_callback) {
+        // Only record the pass here, `pass->info.pass` is fixed up once the
+        // frame is complete (see `deliver_info`)
+        pl_renderer rr = pass->rr;
+        struct pl_dispatch_info copy = {0};
+        pl_dispatch_info_move(&copy, dinfo);
+        PL_ARRAY_APPEND(rr, rr->cur_dinfo, copy);
+        PL_ARRAY_APPEND(rr, rr->cur_info, pass->info);
+        pass->info.index++;
+        return;
+    }
+
     if (!params->info_callback)
         return;
 
@@ -440,6 +709,26 @@ static void info_callback(void *priv, const struct pl_dispatch_info *dinfo)
     pass->info.index++;
 }
 
+// Publishes the pass information recorded for the current frame, and
+// delivers it to the user's `info_callback` in one batch
+static void deliver_info(pl_renderer rr, const struct pl_render_params *params)
+{
+    for (int i = 0; i < rr->frame_dinfo.num; i++)
+        pl_shader_info_deref(&rr->frame_dinfo.elem[i].shader);
+    rr->frame_dinfo.num = rr->frame_info.num = 0;
+
+    PL_SWAP(rr->frame_info, rr->cur_info);
+    PL_SWAP(rr->frame_dinfo, rr->cur_dinfo);
+    for (int i = 0; i < rr->frame_info.num; i++)
+        rr->frame_info.elem[i].pass = &rr->frame_dinfo.elem[i];
+
+    if (!params->defer_info_callback || !params->info_callback)
+        return;
+
+    for (int i = 0; i < rr->frame_info.num; i++)
+        params->info_callback(params->info_priv, &rr->frame_info.elem[i]);
+}
+
 static pl_tex get_fbo(struct pass_state *pass, int w, int h, pl_fmt fmt,
                       int comps, pl_debug_tag debug_tag)
 {
@@ -465,13 +754,13 @@ static pl_tex get_fbo(struct pass_state *pass, int w, int h, pl_fmt fmt,
 
     // Find the best-fitting texture out of rr->fbos
     for (int i = 0; i < rr->fbos.num; i++) {
-        if (pass->fbos_used[i])
+        pl_tex tex = rr->fbos.elem[i].tex;
+        if (pass->fbos_used[i] || !tex)
             continue;
 
         // Orthogonal distance, with penalty for format mismatches
-        int diff = abs(rr->fbos.elem[i]->params.w - w) +
-                   abs(rr->fbos.elem[i]->params.h - h) +
-                   ((rr->fbos.elem[i]->params.format != fmt) ? 1000 : 0);
+        int diff = abs(tex->params.w - w) + abs(tex->params.h - h) +
+                   ((tex->params.format != fmt) ? 1000 : 0);
 
         if (best_idx < 0 || diff < best_diff) {
             best_idx = i;
@@ -482,16 +771,107 @@ static pl_tex get_fbo(struct pass_state *pass, int w, int h, pl_fmt fmt,
     // No texture found at all, add a new one
     if (best_idx < 0) {
         best_idx = rr->fbos.num;
-        PL_ARRAY_APPEND(rr, rr->fbos, NULL);
+        PL_ARRAY_APPEND(rr, rr->fbos, (struct fbo) {0});
         pl_grow(pass->tmp, &pass->fbos_used, rr->fbos.num * sizeof(bool));
         pass->fbos_used[best_idx] = false;
     }
 
-    if (!pl_tex_recreate(rr->gpu, &rr->fbos.elem[best_idx], &params))
-        return NULL;
+    struct fbo *fbo = &rr->fbos.elem[best_idx];
+    if (!pl_tex_recreate(rr->gpu, &fbo->tex, &params))
+        return NULL; // the empty slot gets cleaned up by `gc_fbos`
 
     pass->fbos_used[best_idx] = true;
-    return rr->fbos.elem[best_idx];
+    return fbo->tex;
+}
+
+// Number of consecutive passes after which unused FBOs are released
+#define FBO_MAX_IDLE 16
+
+#define OP(x) (1u << PL_RENDER_OP_##x)
+
+// Sets the operations and FBO attributed to the next dispatched pass
+static void set_ops(struct pass_state *pass, unsigned ops, pl_tex fbo)
+{
+    pass->info.ops = ops;
+    pass->info.fbo_format = fbo ? fbo->params.format : NULL;
+    pass->fbo_bytes = pl_tex_mem_size(fbo);
+}
+
+// Releases FBOs that have not been used recently, and enforces the memory
+// budget. Must only be called once no other pass is using `rr->fbos`.
+static void gc_fbos(struct pass_state *pass)
+{
+    const struct pl_render_params *params = pass->params;
+    pl_renderer rr = pass->rr;
+    size_t total_size = 0;
+
+    // Release idle FBOs immediately if the GPU is running low on memory
+    struct pl_gpu_memory_budget budget;
+    bool pressure = pl_gpu_get_memory_budget(rr->gpu, &budget) && budget.pressure;
+
+    for (int i = 0; i < rr->fbos.num; ) {
+        struct fbo *fbo = &rr->fbos.elem[i];
+        bool used = i < pl_get_size(pass->fbos_used) / sizeof(bool) &&
+                    pass->fbos_used[i];
+        fbo->idle = used ? 0 : fbo->idle + 1;
+        if (!fbo->tex || fbo->idle > (pressure ? 0 : FBO_MAX_IDLE)) {
+            pl_tex_destroy(rr->gpu, &fbo->tex);
+            PL_ARRAY_REMOVE_AT(rr->fbos, i);
+            continue;
+        }
+
+        total_size += pl_tex_mem_size(fbo->tex);
+        i++;
+    }
+
+    if (params->max_fbo_memory <= 0 || rr->fbo_over_budget)
+        return;
+
+    if (total_size > ((size_t) params->max_fbo_memory << 20)) {
+        PL_WARN(rr, "Intermediate FBOs (%zu MiB) exceed the configured memory "
+                "budget (%d MiB), falling back to low bit depth FBOs",
+                total_size >> 20, params->max_fbo_memory);
+        rr->fbo_over_budget = true;
+    }
+}
+
+// Returns true if `img` can be safely stored in `pass->lowfmt`, i.e. without
+// any visible loss of precision in the final output
+static bool img_low_precision_ok(const struct pass_state *pass,
+                                 const struct img *img)
+{
+    const struct pl_render_params *params = pass->params;
+    const pl_renderer rr = pass->rr;
+    if (!pass->lowfmt || !pass->fbofmt[4] || img->comps != 3)
+        return false; // 2-bit alpha is useless, and 1-2 comps gain nothing
+    if (img->sh && pl_shader_is_compute(img->sh) &&
+        !(pass->lowfmt->caps & PL_FMT_CAP_STORABLE))
+        return false;
+
+    // Linear light (and sigmoidized) signals need more than 10 bits, and HDR
+    // or out-of-gamut values would be clipped by the unorm encoding
+    if (pl_color_space_is_hdr(&img->color) ||
+        img->color.transfer == PL_COLOR_TRC_LINEAR)
+        return false;
+
+    const struct pl_frame *image = &pass->image, *target = &pass->target;
+    struct pl_color_space src = image->color, dst = target->color;
+    pl_color_space_infer_map(&src, &dst);
+    if (pl_color_space_is_hdr(&src) || pl_color_space_is_hdr(&dst))
+        return false;
+    if (src.primaries != dst.primaries || params->lut || image->icc || target->icc)
+        return false;
+
+    // Debanding and film grain both generate sub-LSB detail that would be
+    // destroyed by requantization
+    if (params->deband_params && !(rr->errors & PL_RENDER_ERR_DEBANDING))
+        return false;
+    if (image->film_grain.type != PL_FILM_GRAIN_NONE &&
+        !(rr->errors & PL_RENDER_ERR_FILM_GRAIN))
+        return false;
+
+    // Ensure two bits of headroom over the output precision
+    return PL_DEF(target->repr.bits.color_depth, 8) <= 8;
 }
 
 // Forcibly convert an img to `tex`, dispatching where necessary
@@ -503,6 +883,9 @@ static pl_tex _img_tex(struct pass_state *pass, struct img *img, pl_debug_tag ta
     }
 
     pl_renderer rr = pass->rr;
+    if (!img->fmt && img_low_precision_ok(pass, img))
+        img->fmt = pass->lowfmt;
+
     pl_tex tex = get_fbo(pass, img->w, img->h, img->fmt, img->comps, tag);
     img->fmt = NULL;
 
@@ -511,14 +894,17 @@ static pl_tex _img_tex(struct pass_state *pass, struct img *img, pl_debug_tag ta
         memset(pass->fbofmt, 0, sizeof(pass->fbofmt));
         pl_dispatch_abort(rr->dp, &img->sh);
         rr->errors |= PL_RENDER_ERR_FBO;
+        img->ops = 0;
         return img->err_tex;
     }
 
     pl_assert(img->sh);
+    set_ops(pass, img->ops, tex);
     bool ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
         .shader = &img->sh,
         .target = tex,
     ));
+    img->ops = 0;
 
     const char *err_msg = img->err_msg;
     enum pl_render_error err_enum = img->err_enum;
@@ -674,9 +1060,12 @@ static struct sampler_info sample_src_info(struct pass_state *pass,
     return info;
 }
 
+// If `tap_sh` is set, it is applied to each source texel, see
+// `pl_sample_filter_params.tap_shader`. Only supported for polar samplers.
 static void dispatch_sampler(struct pass_state *pass, pl_shader sh,
                              struct sampler *sampler, enum sampler_usage usage,
-                             pl_tex target_tex, const struct pl_sample_src *src)
+                             pl_tex target_tex, const struct pl_sample_src *src,
+                             pl_shader tap_sh)
 {
     const struct pl_render_params *params = pass->params;
     if (!sampler)
@@ -735,9 +1124,20 @@ static void dispatch_sampler(struct pass_state *pass, pl_shader sh,
     bool ok;
     if (info.config->polar) {
         // Polar samplers are always a single function call
+        fparams.tap_shader = tap_sh;
         ok = pl_shader_sample_polar(sh, src, &fparams);
     } else if (info.dir_sep[0] && info.dir_sep[1]) {
-        // Scaling is needed in both directions
+        // Scaling is needed in both directions. If the ratios allow it, try
+        // doing both passes at once in a compute shader first, which saves
+        // the intermediate FBO round trip
+        float rx = src->new_w / fabsf(pl_rect_w(src->rect)),
+              ry = src->new_h / fabsf(pl_rect_h(src->rect));
+        if (fabsf(rx - 1.0f) >= 1e-6f && fabsf(ry - 1.0f) >= 1e-6f) {
+            ok = pl_shader_sample_ortho2(sh, src, &fparams);
+            if (ok || pl_shader_is_failed(sh))
+                goto done;
+        }
+
         struct pl_sample_src src1 = *src, src2 = *src;
         src1.new_w = src->tex->params.w;
         src1.rect.x0 = 0;
@@ -779,6 +1179,11 @@ done:
 fallback:
     // If all else fails, fall back to auto sampling
     pl_shader_sample_direct(sh, src);
+    if (tap_sh && !pl_shader_is_failed(tap_sh)) {
+        ident_t tap = sh_subpass(sh, tap_sh);
+        if (tap)
+            GLSL("color = "$"(color); \n", tap);
+    }
 }
 
 static void swizzle_color(pl_shader sh, int comps, const int comp_map[4],
@@ -800,6 +1205,356 @@ static void swizzle_color(pl_shader sh, int comps, const int comp_map[4],
         GLSL("color.a = "$".a; \n", orig);
 }
 
+// Maximum number of overlay parts per pass, limited by the 16-bit indices
+#define OSD_MAX_PARTS (UINT16_MAX / 4)
+
+// Padding around each part in the overlay atlas, to avoid bleeding between
+// neighbouring parts when sampling with linear filtering
+#define OSD_ATLAS_PAD 1
+
+// Number of consecutive frames after which unused atlases are released
+#define OSD_ATLAS_MAX_IDLE 16
+
+static void gc_osd_atlases(pl_renderer rr)
+{
+    for (int i = 0; i < rr->osd_atlases.num; ) {
+        struct osd_atlas *atlas = &rr->osd_atlases.elem[i];
+        atlas->idle = atlas->used ? 0 : atlas->idle + 1;
+        atlas->used = false;
+        if (!atlas->tex || atlas->idle > OSD_ATLAS_MAX_IDLE) {
+            pl_tex_destroy(rr->gpu, &atlas->tex);
+            pl_free(atlas->rects.elem);
+            PL_ARRAY_REMOVE_AT(rr->osd_atlases, i);
+            continue;
+        }
+
+        i++;
+    }
+}
+
+static bool overlays_compatible(const struct pl_overlay *a,
+                                const struct pl_overlay *b)
+{
+    return a->mode == b->mode &&
+           a->tex->params.format == b->tex->params.format &&
+           pl_color_repr_equal(&a->repr, &b->repr) &&
+           pl_color_space_equal(&a->color, &b->color);
+}
+
+// Returns the number of consecutive overlays that can be drawn as part of a
+// single pass. `use_atlas` is set if they do not all share the same texture.
+static int overlay_batch(const struct pl_overlay *overlays, int num,
+                         bool allow_atlas, bool *use_atlas)
+{
+    int num_parts = overlays[0].num_parts;
+    bool all_signed = overlays[0].signature;
+    *use_atlas = false;
+
+    int n = 1;
+    for (; n < num; n++) {
+        const struct pl_overlay *ol = &overlays[n];
+        if (!overlays_compatible(&overlays[0], ol))
+            break;
+        if (num_parts + ol->num_parts > OSD_MAX_PARTS)
+            break;
+
+        bool same_tex = !*use_atlas && ol->tex == overlays[0].tex;
+        if (!same_tex && !(allow_atlas && all_signed && ol->signature))
+            break;
+
+        all_signed &= !!ol->signature;
+        *use_atlas = !same_tex;
+        num_parts += ol->num_parts;
+    }
+
+    return n;
+}
+
+static inline pl_rect2d part_bounds(const struct pl_overlay_part *part)
+{
+    return (pl_rect2d) {
+        .x0 = floorf(PL_MIN(part->src.x0, part->src.x1)),
+        .y0 = floorf(PL_MIN(part->src.y0, part->src.y1)),
+        .x1 = ceilf(PL_MAX(part->src.x0, part->src.x1)),
+        .y1 = ceilf(PL_MAX(part->src.y0, part->src.y1)),
+    };
+}
+
+static void emit_quad_indices(pl_renderer rr, int idx_base)
+{
+    PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 0);
+    PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
+    PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 2);
+    PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 2);
+    PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
+    PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 3);
+}
+
+struct atlas_item {
+    int idx;
+    int w, h;
+};
+
+static int cmp_atlas_item(const void *pa, const void *pb)
+{
+    const struct atlas_item *a = pa, *b = pb;
+    if (a->h != b->h)
+        return b->h - a->h;
+    return a->idx - b->idx;
+}
+
+// Whether the overlay colors can be blended onto a target with the given
+// color space and representation as-is, save for the alpha mode
+static bool osd_color_trivial(const struct pass_state *pass,
+                              const struct pl_overlay *ol,
+                              struct pl_color_space csp,
+                              struct pl_color_repr repr)
+{
+    struct pl_color_repr osd_repr = ol->repr;
+    if (pass->target.icc || !pl_color_space_equal(&ol->color, &csp))
+        return false;
+    if (pl_color_system_is_ycbcr_like(osd_repr.sys) ||
+        pl_color_system_is_ycbcr_like(repr.sys) ||
+        osd_repr.sys == PL_COLOR_SYSTEM_XYZ || repr.sys == PL_COLOR_SYSTEM_XYZ)
+        return false;
+
+    return pl_color_levels_guess(&osd_repr) == pl_color_levels_guess(&repr) &&
+           pl_color_repr_normalize(&osd_repr) == pl_color_repr_normalize(&repr);
+}
+
+// Converts `color` from the colors of the overlay to `csp`, without encoding
+static void osd_convert_color(struct pass_state *pass, pl_shader sh,
+                              const struct pl_overlay *ol,
+                              struct pl_color_space csp)
+{
+    static const struct pl_color_map_params osd_params = {
+        PL_COLOR_MAP_DEFAULTS
+        .tone_mapping_function = &pl_tone_map_linear,
+        .gamut_mapping         = &pl_gamut_map_saturation,
+    };
+
+    pl_renderer rr = pass->rr;
+    const struct pl_frame *target = &pass->target;
+    struct pl_color_repr osd_repr = ol->repr;
+    pl_shader_decode_color(sh, &osd_repr, NULL);
+    if (target->icc)
+        csp.transfer = PL_COLOR_TRC_LINEAR;
+    pl_shader_color_map_ex(sh, &osd_params, pl_color_map_args(ol->color, csp));
+    if (target->icc)
+        pl_icc_encode(sh, target->icc, &rr->icc_state[ICC_TARGET]);
+}
+
+// Copies the parts of all overlays into a shared atlas texture, or reuses an
+// existing atlas with the same contents. If `csp` and `repr` are set, the
+// parts are also converted to these colors (premultiplied), so that the
+// conversion does not need to be redone for as long as the atlas is reused.
+// Returns NULL on failure.
+static const struct osd_atlas *get_osd_atlas(struct pass_state *pass,
+                                             const struct pl_overlay *overlays,
+                                             int num,
+                                             const struct pl_color_space *csp,
+                                             const struct pl_color_repr *repr)
+{
+    pl_renderer rr = pass->rr;
+    pl_gpu gpu = rr->gpu;
+    pl_fmt fmt = overlays[0].tex->params.format;
+    if (csp) {
+        // Use a high depth format to avoid quantizing the converted colors
+        pl_fmt conv_fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 4, 16, 16,
+                                      PL_FMT_CAP_SAMPLEABLE |
+                                      PL_FMT_CAP_RENDERABLE |
+                                      PL_FMT_CAP_LINEAR);
+        fmt = PL_DEF(conv_fmt, fmt);
+    }
+    if (!(fmt->caps & PL_FMT_CAP_RENDERABLE))
+        return NULL;
+
+    int num_parts = 0;
+    uint64_t sig = (uintptr_t) fmt;
+    if (csp) {
+        pl_hash_merge(&sig, pl_var_hash(*csp));
+        pl_hash_merge(&sig, pl_var_hash(*repr));
+        pl_hash_merge(&sig, pass->target.icc ? pass->target.icc->signature : 0);
+    }
+    for (int n = 0; n < num; n++) {
+        const struct pl_overlay *ol = &overlays[n];
+        pl_hash_merge(&sig, ol->signature);
+        for (int i = 0; i < ol->num_parts; i++)
+            pl_hash_merge(&sig, pl_mem_hash(&ol->parts[i].src, sizeof(pl_rect2df)));
+        num_parts += ol->num_parts;
+    }
+
+    struct osd_atlas *atlas = NULL;
+    for (int i = 0; i < rr->osd_atlases.num; i++) {
+        struct osd_atlas *cur = &rr->osd_atlases.elem[i];
+        if (cur->signature == sig && cur->tex) {
+            cur->used = true;
+            return cur;
+        }
+
+        // Recycle atlases which went unused for at least a full frame, to
+        // allow double buffering of frequently changing overlays
+        if (!atlas && !cur->used && cur->idle > 0)
+            atlas = cur;
+    }
+
+    // Shelf-pack all parts, sorted by decreasing height
+    struct atlas_item *items = pl_calloc_ptr(pass->tmp, num_parts, items);
+    size_t area = 0;
+    int max_w = 0, idx = 0;
+    for (int n = 0; n < num; n++) {
+        for (int i = 0; i < overlays[n].num_parts; i++, idx++) {
+            pl_rect2d rc = part_bounds(&overlays[n].parts[i]);
+            items[idx] = (struct atlas_item) {
+                .idx = idx,
+                .w = pl_rect_w(rc) + 2 * OSD_ATLAS_PAD,
+                .h = pl_rect_h(rc) + 2 * OSD_ATLAS_PAD,
+            };
+            area += (size_t) items[idx].w * items[idx].h;
+            max_w = PL_MAX(max_w, items[idx].w);
+        }
+    }
+
+    qsort(items, num_parts, sizeof(*items), cmp_atlas_item);
+
+    const int max_dim = gpu->limits.max_tex_2d_dim;
+    const int atlas_w = PL_MIN(PL_ALIGN2(PL_MAX(max_w, (int) ceil(sqrt(area))), 64), max_dim);
+    if (max_w > atlas_w)
+        return NULL;
+
+    pl_rect2d *rects = pl_calloc_ptr(pass->tmp, num_parts, rects);
+    int x = 0, y = 0, shelf_h = 0;
+    for (int i = 0; i < num_parts; i++) {
+        const struct atlas_item *item = &items[i];
+        if (x + item->w > atlas_w) {
+            y += shelf_h;
+            x = shelf_h = 0;
+        }
+
+        rects[item->idx] = (pl_rect2d) {
+            .x0 = x + OSD_ATLAS_PAD,
+            .y0 = y + OSD_ATLAS_PAD,
+            .x1 = x + item->w - OSD_ATLAS_PAD,
+            .y1 = y + item->h - OSD_ATLAS_PAD,
+        };
+
+        x += item->w;
+        shelf_h = PL_MAX(shelf_h, item->h);
+    }
+
+    const int atlas_h = y + shelf_h;
+    if (atlas_h > max_dim) {
+        PL_DEBUG(rr, "Overlay atlas (%dx%d) exceeds the maximum texture "
+                 "size, drawing overlays individually", atlas_w, atlas_h);
+        return NULL;
+    }
+
+    if (!atlas) {
+        PL_ARRAY_APPEND(rr, rr->osd_atlases, (struct osd_atlas) {0});
+        atlas = &rr->osd_atlases.elem[rr->osd_atlases.num - 1];
+    }
+
+    atlas->signature = 0;
+    atlas->converted = csp != NULL;
+    atlas->used = true;
+    atlas->idle = 0;
+    bool ok = pl_tex_recreate(gpu, &atlas->tex, pl_tex_params(
+        .w          = PL_MAX(atlas->tex ? atlas->tex->params.w : 0, atlas_w),
+        .h          = PL_MAX(atlas->tex ? atlas->tex->params.h : 0, atlas_h),
+        .format     = fmt,
+        .sampleable = true,
+        .renderable = true,
+        .debug_tag  = PL_DEBUG_TAG,
+    ));
+
+    if (!ok) {
+        PL_ERR(rr, "Failed creating overlay atlas texture!");
+        return NULL;
+    }
+
+    PL_ARRAY_MEMDUP(rr, atlas->rects, rects, num_parts);
+
+    // Copy the parts of each overlay texture into the atlas
+    idx = 0;
+    for (int n = 0; n < num; n++) {
+        const struct pl_overlay *ol = &overlays[n];
+        rr->osd_vertices.num = 0;
+        rr->osd_indices.num = 0;
+        for (int i = 0; i < ol->num_parts; i++, idx++) {
+            // Also copy the padding, replicating edge texels as needed
+            const int pad = OSD_ATLAS_PAD;
+            pl_rect2d src = part_bounds(&ol->parts[i]);
+            pl_rect2d dst = rects[idx];
+            src = (pl_rect2d) { src.x0 - pad, src.y0 - pad, src.x1 + pad, src.y1 + pad };
+            dst = (pl_rect2d) { dst.x0 - pad, dst.y0 - pad, dst.x1 + pad, dst.y1 + pad };
+
+            int idx_base = rr->osd_vertices.num;
+            for (int c = 0; c < 4; c++) {
+                const bool right = c & 1, bottom = c & 2;
+                PL_ARRAY_APPEND(rr, rr->osd_vertices, (struct osd_vertex) {
+                    .pos = {
+                        right  ? dst.x1 : dst.x0,
+                        bottom ? dst.y1 : dst.y0,
+                    },
+                    .coord = {
+                        (float) (right  ? src.x1 : src.x0) / ol->tex->params.w,
+                        (float) (bottom ? src.y1 : src.y0) / ol->tex->params.h,
+                    },
+                });
+            }
+            emit_quad_indices(rr, idx_base);
+        }
+
+        if (!rr->osd_indices.num)
+            continue;
+
+        pl_shader sh = pl_dispatch_begin(rr->dp);
+        ident_t tex = sh_desc(sh, (struct pl_shader_desc) {
+            .desc = {
+                .name = "osd_tex",
+                .type = PL_DESC_SAMPLED_TEX,
+            },
+            .binding = {
+                .object = ol->tex,
+                .sample_mode = PL_TEX_SAMPLE_NEAREST,
+            },
+        });
+
+        sh_describe(sh, "overlay atlas");
+        GLSL("vec4 color = textureLod("$", coord, 0.0); \n", tex);
+        sh->output = PL_SHADER_SIG_COLOR;
+        if (csp) {
+            struct pl_color_repr atlas_repr = *repr;
+            atlas_repr.alpha = PL_ALPHA_PREMULTIPLIED;
+            osd_convert_color(pass, sh, ol, *csp);
+            pl_shader_encode_color(sh, &atlas_repr);
+        }
+
+        set_ops(pass, OP(OVERLAY), NULL);
+        ok = pl_dispatch_vertex(rr->dp, pl_dispatch_vertex_params(
+            .shader = &sh,
+            .target = atlas->tex,
+            .vertex_stride = sizeof(struct osd_vertex),
+            .num_vertex_attribs = 2,
+            .vertex_attribs = rr->osd_attribs,
+            .vertex_position_idx = 0,
+            .vertex_coords = PL_COORDS_ABSOLUTE,
+            .vertex_type = PL_PRIM_TRIANGLE_LIST,
+            .vertex_count = rr->osd_indices.num,
+            .vertex_data = rr->osd_vertices.elem,
+            .index_data = rr->osd_indices.elem,
+        ));
+
+        if (!ok) {
+            PL_ERR(rr, "Failed copying overlay parts into atlas!");
+            return NULL;
+        }
+    }
+
+    atlas->signature = sig;
+    return atlas;
+}
+
 // `scale` adapts from `pass->dst_rect` to the plane being rendered to
 static void draw_overlays(struct pass_state *pass, pl_tex fbo,
                           int comps, const int comp_map[4],
@@ -844,83 +1599,118 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
     pl_rect2df_rotate(&dst_crop, -pass->rotation);
     pl_rect2df_normalize(&dst_crop);
 
-    for (int n = 0; n < num; n++) {
-        struct pl_overlay ol = overlays[n];
-        if (!ol.num_parts)
-            continue;
-
-        if (!ol.coords) {
-            ol.coords = overlays == target->overlays
-                            ? PL_OVERLAY_COORDS_DST_FRAME
-                            : PL_OVERLAY_COORDS_SRC_FRAME;
-        }
-
-        pl_transform2x2 tf = pl_transform2x2_identity;
-        switch (ol.coords) {
-            case PL_OVERLAY_COORDS_SRC_CROP:
-                if (!image)
-                    continue;
-                tf.c[0] = image->crop.x0;
-                tf.c[1] = image->crop.y0;
-                // fall through
-            case PL_OVERLAY_COORDS_SRC_FRAME:
-                if (!image)
-                    continue;
-                pl_transform2x2_rmul(&src_to_dst, &tf);
-                break;
-            case PL_OVERLAY_COORDS_DST_CROP:
-                tf.c[0] = dst_crop.x0;
-                tf.c[1] = dst_crop.y0;
-                break;
-            case PL_OVERLAY_COORDS_DST_FRAME:
-                break;
-            case PL_OVERLAY_COORDS_AUTO:
-            case PL_OVERLAY_COORDS_COUNT:
-                pl_unreachable();
+    for (int n = 0; n < num; ) {
+        // Determine the overlays to draw as part of this pass
+        const struct pl_overlay *first = &overlays[n];
+        const bool trivial = osd_color_trivial(pass, first, color, repr);
+        const struct osd_atlas *atlas = NULL;
+        int batch = 1;
+        if (pass->params->overlay_atlas && first->num_parts) {
+            // Signed overlays needing color conversion get converted once,
+            // into an atlas, even if they could be drawn directly
+            bool use_atlas;
+            bool convert = !trivial && first->signature &&
+                           first->mode == PL_OVERLAY_NORMAL;
+            batch = overlay_batch(first, num - n, true, &use_atlas);
+            if (convert)
+                atlas = get_osd_atlas(pass, first, batch, &color, &repr);
+            if (!atlas && use_atlas)
+                atlas = get_osd_atlas(pass, first, batch, NULL, NULL);
+            if (!atlas && use_atlas)
+                batch = overlay_batch(first, num - n, false, &use_atlas);
         }
 
-        if (output_shift)
-            pl_transform2x2_rmul(output_shift, &tf);
-
-        // Construct vertex/index buffers
+        const pl_tex osd_tex = atlas ? atlas->tex : first->tex;
         rr->osd_vertices.num = 0;
         rr->osd_indices.num = 0;
-        for (int i = 0; i < ol.num_parts; i++) {
-            const struct pl_overlay_part *part = &ol.parts[i];
 
-#define EMIT_VERT(x, y)                                                         \
-            do {                                                                \
-                float pos[2] = { part->dst.x, part->dst.y };                    \
-                pl_transform2x2_apply(&tf, pos);                                \
-                PL_ARRAY_APPEND(rr, rr->osd_vertices, (struct osd_vertex) {     \
-                    .pos = {                                                    \
-                        2.0 * (pos[0] / fbo->params.w) - 1.0,                   \
-                        2.0 * (pos[1] / fbo->params.h) - 1.0,                   \
-                    },                                                          \
-                    .coord = {                                                  \
-                        part->src.x / ol.tex->params.w,                         \
-                        part->src.y / ol.tex->params.h,                         \
-                    },                                                          \
-                    .color = {                                                  \
-                        part->color[0], part->color[1],                         \
-                        part->color[2], part->color[3],                         \
-                    },                                                          \
-                });                                                             \
-            } while (0)
+        for (int part_idx = 0; batch > 0; batch--, n++) {
+            struct pl_overlay ol = overlays[n];
+            const int part_base = part_idx;
+            part_idx += ol.num_parts;
+            if (!ol.num_parts)
+                continue;
 
-            int idx_base = rr->osd_vertices.num;
-            EMIT_VERT(x0, y0); // idx 0: top left
-            EMIT_VERT(x1, y0); // idx 1: top right
-            EMIT_VERT(x0, y1); // idx 2: bottom left
-            EMIT_VERT(x1, y1); // idx 3: bottom right
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 0);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 2);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 2);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 1);
-            PL_ARRAY_APPEND(rr, rr->osd_indices, idx_base + 3);
+            if (!ol.coords) {
+                ol.coords = overlays == target->overlays
+                                ? PL_OVERLAY_COORDS_DST_FRAME
+                                : PL_OVERLAY_COORDS_SRC_FRAME;
+            }
+
+            pl_transform2x2 tf = pl_transform2x2_identity;
+            switch (ol.coords) {
+                case PL_OVERLAY_COORDS_SRC_CROP:
+                    if (!image)
+                        continue;
+                    tf.c[0] = image->crop.x0;
+                    tf.c[1] = image->crop.y0;
+                    // fall through
+                case PL_OVERLAY_COORDS_SRC_FRAME:
+                    if (!image)
+                        continue;
+                    pl_transform2x2_rmul(&src_to_dst, &tf);
+                    break;
+                case PL_OVERLAY_COORDS_DST_CROP:
+                    tf.c[0] = dst_crop.x0;
+                    tf.c[1] = dst_crop.y0;
+                    break;
+                case PL_OVERLAY_COORDS_DST_FRAME:
+                    break;
+                case PL_OVERLAY_COORDS_AUTO:
+                case PL_OVERLAY_COORDS_COUNT:
+                    pl_unreachable();
+            }
+
+            if (output_shift)
+                pl_transform2x2_rmul(output_shift, &tf);
+
+            // Construct vertex/index buffers
+            for (int i = 0; i < ol.num_parts; i++) {
+                const struct pl_overlay_part *part = &ol.parts[i];
+                pl_rect2df src = part->src;
+                if (atlas) {
+                    // Translate to the location of this part in the atlas
+                    const pl_rect2d bounds = part_bounds(part);
+                    const pl_rect2d *rc = &atlas->rects.elem[part_base + i];
+                    const float ox = rc->x0 - bounds.x0, oy = rc->y0 - bounds.y0;
+                    src = (pl_rect2df) {
+                        src.x0 + ox, src.y0 + oy,
+                        src.x1 + ox, src.y1 + oy,
+                    };
+                }
+
+#define EMIT_VERT(x, y)                                                         \
+                do {                                                            \
+                    float pos[2] = { part->dst.x, part->dst.y };                \
+                    pl_transform2x2_apply(&tf, pos);                            \
+                    PL_ARRAY_APPEND(rr, rr->osd_vertices, (struct osd_vertex) { \
+                        .pos = {                                                \
+                            2.0 * (pos[0] / fbo->params.w) - 1.0,               \
+                            2.0 * (pos[1] / fbo->params.h) - 1.0,               \
+                        },                                                      \
+                        .coord = {                                              \
+                            src.x / osd_tex->params.w,                          \
+                            src.y / osd_tex->params.h,                          \
+                        },                                                      \
+                        .color = {                                              \
+                            part->color[0], part->color[1],                     \
+                            part->color[2], part->color[3],                     \
+                        },                                                      \
+                    });                                                         \
+                } while (0)
+
+                int idx_base = rr->osd_vertices.num;
+                EMIT_VERT(x0, y0); // idx 0: top left
+                EMIT_VERT(x1, y0); // idx 1: top right
+                EMIT_VERT(x0, y1); // idx 2: bottom left
+                EMIT_VERT(x1, y1); // idx 3: bottom right
+                emit_quad_indices(rr, idx_base);
+            }
         }
 
+        if (!rr->osd_indices.num)
+            continue;
+
         // Draw parts
         pl_shader sh = pl_dispatch_begin(rr->dp);
         ident_t tex = sh_desc(sh, (struct pl_shader_desc) {
@@ -929,8 +1719,8 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
                 .type = PL_DESC_SAMPLED_TEX,
             },
             .binding = {
-                .object = ol.tex,
-                .sample_mode = (ol.tex->params.format->caps & PL_FMT_CAP_LINEAR)
+                .object = osd_tex,
+                .sample_mode = (osd_tex->params.format->caps & PL_FMT_CAP_LINEAR)
                     ? PL_TEX_SAMPLE_LINEAR
                     : PL_TEX_SAMPLE_NEAREST,
             },
@@ -939,7 +1729,7 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
         sh_describe(sh, "overlay");
         GLSL("// overlay \n");
 
-        switch (ol.mode) {
+        switch (first->mode) {
         case PL_OVERLAY_NORMAL:
             GLSL("vec4 color = textureLod("$", coord, 0.0); \n", tex);
             break;
@@ -950,23 +1740,36 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
             pl_unreachable();
         };
 
-        static const struct pl_color_map_params osd_params = {
-            PL_COLOR_MAP_DEFAULTS
-            .tone_mapping_function = &pl_tone_map_linear,
-            .gamut_mapping         = &pl_gamut_map_saturation,
-        };
-
+        // Premultiplied colors can be blended as-is, regardless of the
+        // target alpha mode, so only convert them if blending is disabled
+        const bool blend = !(rr->errors & PL_RENDER_ERR_BLENDING);
+        const enum pl_alpha_mode alpha = repr.alpha == PL_ALPHA_PREMULTIPLIED
+                                       ? PL_ALPHA_PREMULTIPLIED
+                                       : PL_ALPHA_INDEPENDENT;
+        bool premul = alpha == PL_ALPHA_PREMULTIPLIED;
         sh->output = PL_SHADER_SIG_COLOR;
-        pl_shader_decode_color(sh, &ol.repr, NULL);
-        if (target->icc)
-            color.transfer = PL_COLOR_TRC_LINEAR;
-        pl_shader_color_map_ex(sh, &osd_params, pl_color_map_args(ol.color, color));
-        if (target->icc)
-            pl_icc_encode(sh, target->icc, &rr->icc_state[ICC_TARGET]);
+        if (atlas && atlas->converted) {
+            struct pl_color_repr osd_repr = { .alpha = PL_ALPHA_PREMULTIPLIED };
+            if (blend) {
+                premul = true;
+            } else {
+                pl_shader_set_alpha(sh, &osd_repr, alpha);
+            }
+        } else if (trivial) {
+            struct pl_color_repr osd_repr = first->repr;
+            if (osd_repr.alpha != PL_ALPHA_PREMULTIPLIED)
+                osd_repr.alpha = PL_ALPHA_INDEPENDENT;
+            if (blend && osd_repr.alpha == PL_ALPHA_PREMULTIPLIED) {
+                premul = true;
+            } else {
+                pl_shader_set_alpha(sh, &osd_repr, alpha);
+            }
+        } else {
+            osd_convert_color(pass, sh, first, color);
+            pl_shader_encode_color(sh, &repr);
+        }
 
-        bool premul = repr.alpha == PL_ALPHA_PREMULTIPLIED;
-        pl_shader_encode_color(sh, &repr);
-        if (ol.mode == PL_OVERLAY_MONOCHROME) {
+        if (first->mode == PL_OVERLAY_MONOCHROME) {
             GLSL("color.%s *= textureLod("$", coord, 0.0).r; \n",
                  premul ? "rgba" : "a", tex);
         }
@@ -980,13 +1783,14 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
             .dst_alpha = PL_BLEND_ONE_MINUS_SRC_ALPHA,
         };
 
+        set_ops(pass, OP(OVERLAY), NULL);
         bool ok = pl_dispatch_vertex(rr->dp, pl_dispatch_vertex_params(
             .shader = &sh,
             .target = fbo,
             .blend_params = (rr->errors & PL_RENDER_ERR_BLENDING)
                             ? NULL : &blend_params,
             .vertex_stride = sizeof(struct osd_vertex),
-            .num_vertex_attribs = ol.mode == PL_OVERLAY_NORMAL ? 2 : 3,
+            .num_vertex_attribs = first->mode == PL_OVERLAY_NORMAL ? 2 : 3,
             .vertex_attribs = rr->osd_attribs,
             .vertex_position_idx = 0,
             .vertex_coords = PL_COORDS_NORMALIZED,
@@ -1004,6 +1808,124 @@ static void draw_overlays(struct pass_state *pass, pl_tex fbo,
     }
 }
 
+struct params_info {
+    uint64_t hash;
+    bool trivial;
+};
+
+static struct params_info render_params_info(pl_renderer rr,
+                                             const struct pl_render_params *params);
+
+// Number of consecutive passes with hooks after which cached outputs of
+// deterministic hooks are released
+#define HOOK_CACHE_MAX_IDLE 4
+
+static uint64_t hook_cache_key(struct pass_state *pass, const struct pl_hook *hook,
+                               enum pl_hook_stage stage, const struct img *img)
+{
+    const struct pl_render_params *params = pass->params;
+    uint64_t key = pass->image.signature;
+    pl_hash_merge(&key, pass->hook_chain);
+    pl_hash_merge(&key, hook->signature);
+    pl_hash_merge(&key, stage);
+    for (int i = 0; i < hook->num_parameters; i++) {
+        const struct pl_hook_par *par = &hook->parameters[i];
+        switch (par->type) {
+        case PL_VAR_SINT:  pl_hash_merge(&key, pl_var_hash(par->data->i)); break;
+        case PL_VAR_UINT:  pl_hash_merge(&key, pl_var_hash(par->data->u)); break;
+        case PL_VAR_FLOAT: pl_hash_merge(&key, pl_var_hash(par->data->f)); break;
+        case PL_VAR_INVALID:
+        case PL_VAR_TYPE_COUNT:
+            pl_unreachable();
+        }
+    }
+
+    // Everything passed along in `pl_hook_params`
+    pl_hash_merge(&key, pl_var_hash(img->w));
+    pl_hash_merge(&key, pl_var_hash(img->h));
+    pl_hash_merge(&key, pl_var_hash(img->comps));
+    pl_hash_merge(&key, pl_var_hash(img->rect));
+    pl_hash_merge(&key, pl_var_hash(img->repr));
+    pl_hash_merge(&key, pl_var_hash(img->color));
+    pl_hash_merge(&key, (uintptr_t) (img->tex ? img->tex->params.format : img->fmt));
+    pl_hash_merge(&key, pl_var_hash(pass->image.repr));
+    pl_hash_merge(&key, pl_var_hash(pass->image.color));
+    pl_hash_merge(&key, pl_var_hash(pass->ref_rect));
+    pl_hash_merge(&key, pl_var_hash(pass->dst_rect));
+
+    // Processing applied to the image before this stage. Input planes are
+    // only affected by deinterlacing, debanding and film grain, whereas any
+    // later stage depends on practically all rendering parameters.
+    if (stage & (PL_HOOK_RGB_INPUT | PL_HOOK_LUMA_INPUT | PL_HOOK_CHROMA_INPUT |
+                 PL_HOOK_ALPHA_INPUT | PL_HOOK_XYZ_INPUT))
+    {
+        if (params->deband_params)
+            pl_hash_merge(&key, pl_var_hash(*params->deband_params));
+        if (params->deinterlace_params)
+            pl_hash_merge(&key, pl_var_hash(*params->deinterlace_params));
+        pl_hash_merge(&key, pass->rr->errors & PL_RENDER_ERR_FILM_GRAIN);
+    } else {
+        if (!pass->params_hash)
+            pass->params_hash = PL_DEF(render_params_info(pass->rr, params).hash, 1);
+        pl_hash_merge(&key, pass->params_hash);
+        pl_hash_merge(&key, pl_var_hash(pass->target.repr));
+        pl_hash_merge(&key, pl_var_hash(pass->target.color));
+    }
+
+    return PL_DEF(key, 1);
+}
+
+// Takes ownership of a hook's output texture, returning the texture it
+// replaces in the cache to the FBO pool instead
+static bool hook_cache_store(struct pass_state *pass, struct cached_hook *entry,
+                             const struct pl_hook_res *res)
+{
+    pl_renderer rr = pass->rr;
+    for (int i = 0; i < rr->fbos.num; i++) {
+        struct fbo *fbo = &rr->fbos.elem[i];
+        if (fbo->tex != res->tex)
+            continue;
+
+        // The slot stays marked as used for this pass, so the returned
+        // texture only becomes available again from the next pass onwards
+        fbo->tex = entry->tex;
+        entry->tex = res->tex;
+        entry->rect = res->rect;
+        entry->repr = res->repr;
+        entry->color = res->color;
+        entry->comps = res->components;
+        return true;
+    }
+
+    return false; // not allocated via `get_tex`
+}
+
+// Must only be called once no pass is using `rr->hook_cache`
+static void gc_hook_cache(pl_renderer rr)
+{
+    if (!rr->hook_cache.num)
+        return;
+
+    struct pl_gpu_memory_budget budget;
+    bool pressure = pl_gpu_get_memory_budget(rr->gpu, &budget) && budget.pressure;
+    if (!rr->ran_hooks && !pressure)
+        return; // e.g. outputs of a paused frame redrawn from the frame cache
+
+    for (int i = 0; i < rr->hook_cache.num; ) {
+        struct cached_hook *entry = &rr->hook_cache.elem[i];
+        entry->idle = entry->used ? 0 : entry->idle + rr->ran_hooks;
+        entry->used = false;
+        if (!entry->tex || entry->idle > (pressure ? 0 : HOOK_CACHE_MAX_IDLE)) {
+            pl_tex_destroy(rr->gpu, &entry->tex);
+            PL_ARRAY_REMOVE_AT(rr->hook_cache, i);
+            continue;
+        }
+        i++;
+    }
+
+    rr->ran_hooks = false;
+}
+
 static pl_tex get_hook_tex(void *priv, int width, int height)
 {
     struct pass_state *pass = priv;
@@ -1011,6 +1933,19 @@ static pl_tex get_hook_tex(void *priv, int width, int height)
     return get_fbo(pass, width, height, NULL, 4, PL_DEBUG_TAG);
 }
 
+static void release_hook_tex(void *priv, pl_tex tex)
+{
+    struct pass_state *pass = priv;
+    pl_renderer rr = pass->rr;
+
+    for (int i = 0; i < rr->fbos.num; i++) {
+        if (rr->fbos.elem[i].tex == tex) {
+            pass->fbos_used[i] = false;
+            return;
+        }
+    }
+}
+
 // Returns if any hook was applied (even if there were errors)
 static bool pass_hook(struct pass_state *pass, struct img *img,
                       enum pl_hook_stage stage)
@@ -1042,6 +1977,7 @@ static bool pass_hook(struct pass_state *pass, struct img *img,
             .gpu = rr->gpu,
             .dispatch = rr->dp,
             .get_tex = get_hook_tex,
+            .release_tex = release_hook_tex,
             .priv = pass,
             .stage = stage,
             .rect = img->rect,
@@ -1057,6 +1993,52 @@ static bool pass_hook(struct pass_state *pass, struct img *img,
         // TODO: Add some sort of `test` API function to the hooks that allows
         // us to skip having to touch the `img` state at all for no-ops
 
+        rr->ran_hooks = true;
+        bool cacheable = hook->deterministic && hook->input == PL_HOOK_SIG_TEX &&
+                         pass->image.signature && !pass->hook_nocache;
+        int cache_idx = -1;
+        uint64_t cache_key = 0;
+        if (cacheable) {
+            cache_key = hook_cache_key(pass, hook, stage, img);
+            uint64_t slot = hook->signature;
+            pl_hash_merge(&slot, stage);
+            pl_hash_merge(&slot, pass->hook_calls++);
+            for (int i = 0; i < rr->hook_cache.num; i++) {
+                if (rr->hook_cache.elem[i].slot == slot) {
+                    cache_idx = i;
+                    break;
+                }
+            }
+
+            if (cache_idx < 0) {
+                cache_idx = rr->hook_cache.num;
+                PL_ARRAY_APPEND(rr, rr->hook_cache, (struct cached_hook) {
+                    .slot = slot,
+                });
+            }
+
+            struct cached_hook *entry = &rr->hook_cache.elem[cache_idx];
+            entry->used = true;
+            pl_hash_merge(&pass->hook_chain, cache_key);
+            if (entry->tex && entry->key == cache_key) {
+                PL_TRACE(rr, "Reusing cached output of hook %d (0x%"PRIx64")",
+                         n, hook->signature);
+                pl_dispatch_abort(rr->dp, &img->sh);
+                *img = (struct img) {
+                    .tex    = entry->tex,
+                    .repr   = entry->repr,
+                    .color  = entry->color,
+                    .comps  = entry->comps,
+                    .rect   = entry->rect,
+                    .w      = entry->tex->params.w,
+                    .h      = entry->tex->params.h,
+                    .unique = img->unique,
+                };
+                ret = true;
+                continue;
+            }
+        }
+
         switch (hook->input) {
         case PL_HOOK_SIG_NONE:
             break;
@@ -1078,12 +2060,26 @@ static bool pass_hook(struct pass_state *pass, struct img *img,
             pl_unreachable();
         }
 
+        // Attribute any passes dispatched by the hook itself to it
+        unsigned ops = img->ops | OP(HOOK);
+        set_ops(pass, OP(HOOK), NULL);
         struct pl_hook_res res = hook->hook(hook->priv, &hparams);
         if (res.failed) {
             PL_ERR(rr, "Failed executing hook, disabling");
             goto hook_error;
         }
 
+        if (cacheable) {
+            struct cached_hook *entry = &rr->hook_cache.elem[cache_idx];
+            bool stored = res.output == PL_HOOK_SIG_TEX &&
+                          hook_cache_store(pass, entry, &res);
+            entry->key = stored ? cache_key : 0;
+            if (!stored)
+                pl_tex_destroy(rr->gpu, &entry->tex);
+        } else if (res.output != PL_HOOK_SIG_NONE) {
+            pass->hook_nocache = true;
+        }
+
         bool resizable = pl_hook_stage_resizable(stage);
         switch (res.output) {
         case PL_HOOK_SIG_NONE:
@@ -1132,6 +2128,7 @@ static bool pass_hook(struct pass_state *pass, struct img *img,
                 .w        = res.sh->output_w,
                 .h        = res.sh->output_h,
                 .unique   = img->unique,
+                .ops      = ops,
                 .err_enum = PL_RENDER_ERR_HOOKS,
                 .err_msg  = "Failed applying user hook",
                 .err_tex  = hparams.tex, // if any
@@ -1200,7 +2197,16 @@ static void hdr_update_peak(struct pass_state *pass)
     if (params->lut && params->lut_type == PL_LUT_CONVERSION)
         goto cleanup; // LUT handles tone mapping
 
-    if (!pass->fbofmt[4] && !params->peak_detect_params->allow_delayed) {
+    const struct pl_peak_detect_params *ppars = params->peak_detect_params;
+    if (!pass->fbofmt[4] && ppars->gpu_resident) {
+        PL_WARN(rr, "Disabling peak detection because "
+                "`pl_peak_detect_params.gpu_resident` requires a separate "
+                "pass, but FBOs are unavailable.");
+        rr->errors |= PL_RENDER_ERR_PEAK_DETECT;
+        goto cleanup;
+    }
+
+    if (!pass->fbofmt[4] && !ppars->allow_delayed) {
         PL_WARN(rr, "Disabling peak detection because "
                 "`pl_peak_detect_params.allow_delayed` is false, but lack of "
                 "FBOs forces the result to be delayed.");
@@ -1208,15 +2214,48 @@ static void hdr_update_peak(struct pass_state *pass)
         goto cleanup;
     }
 
+    // The GPU-resident results are consumed on the main queue, so keep the
+    // detection there as well
+    if (params->async_compute && ppars->allow_delayed && !ppars->gpu_resident &&
+        pass->fbofmt[4])
+    {
+        // Dispatch separately, so the main pass does not need to wait on it
+        pl_tex tex = img_tex(pass, &pass->img);
+        if (!tex)
+            goto cleanup;
+
+        pl_shader sh = pl_dispatch_begin(rr->dp);
+        pl_shader_sample_direct(sh, pl_sample_src( .tex = tex ));
+        if (pl_shader_detect_peak(sh, pass->img.color, &rr->tone_map_state, ppars)) {
+            set_ops(pass, OP(COLOR), NULL);
+            bool ok = pl_dispatch_compute(rr->dp, pl_dispatch_compute_params(
+                .shader = &sh,
+                .width  = tex->params.w,
+                .height = tex->params.h,
+            ));
+            if (ok) {
+                rr->cur_stats.async_passes++;
+                return;
+            }
+        } else {
+            pl_dispatch_abort(rr->dp, &sh);
+        }
+
+        PL_WARN(rr, "Failed dispatching HDR peak detection shader.. disabling");
+        rr->errors |= PL_RENDER_ERR_PEAK_DETECT;
+        goto cleanup;
+    }
+
     bool ok = pl_shader_detect_peak(img_sh(pass, &pass->img), pass->img.color,
-                                    &rr->tone_map_state, params->peak_detect_params);
+                                    &rr->tone_map_state, ppars);
     if (!ok) {
         PL_WARN(rr, "Failed creating HDR peak detection shader.. disabling");
         rr->errors |= PL_RENDER_ERR_PEAK_DETECT;
         goto cleanup;
     }
 
-    pass->need_peak_fbo = !params->peak_detect_params->allow_delayed;
+    pass->img.ops |= OP(COLOR);
+    pass->need_peak_fbo = !ppars->allow_delayed || ppars->gpu_resident;
     return;
 
 cleanup:
@@ -1231,6 +2270,11 @@ bool pl_renderer_get_hdr_metadata(pl_renderer rr,
     return pl_get_detected_hdr_metadata(rr->tone_map_state, metadata);
 }
 
+bool pl_renderer_get_peak_frame(pl_renderer rr, struct pl_peak_detect_frame *out)
+{
+    return pl_get_detected_peak_frame(rr->tone_map_state, out);
+}
+
 struct plane_state {
     enum plane_type type;
     struct pl_plane plane;
@@ -1327,6 +2371,7 @@ static bool plane_deband(struct pass_state *pass, struct img *img, float neutral
     img->tex = NULL;
     img->sh = pl_dispatch_begin_ex(rr->dp, true);
     pl_shader_deband(img->sh, &src, &dparams);
+    img->ops = OP(DEBAND);
     img->err_msg = "Failed applying debanding... disabling!";
     img->err_enum = PL_RENDER_ERR_DEBANDING;
     img->err_tex = src.tex;
@@ -1403,6 +2448,7 @@ static bool plane_film_grain(struct pass_state *pass, int plane_idx,
     }
 
     img->tex = NULL;
+    img->ops = OP(GRAIN);
     img->err_msg = "Failed applying film grain.. disabling!";
     img->err_enum = PL_RENDER_ERR_FILM_GRAIN;
     img->err_tex = grain_params.tex;
@@ -1527,6 +2573,113 @@ static bool want_merge(struct pass_state *pass,
     return false;
 }
 
+static enum sampler_usage fused_usage(const struct plane_state *st,
+                                      const struct plane_state *ref)
+{
+    return st->img.w == ref->img.w && st->img.h == ref->img.h
+                ? SAMPLER_MAIN : SAMPLER_PLANE;
+}
+
+// Returns true if `pl_render_params.color_passthrough` applies, i.e. the
+// image can be output in its native encoding without any color management
+static bool color_passthrough(const struct pass_state *pass)
+{
+    const struct pl_render_params *params = pass->params;
+    const struct pl_frame *image = &pass->image, *target = &pass->target;
+    if (!params->color_passthrough || params->lut || params->cone_params)
+        return false;
+    if (image->icc || target->icc || target->lut)
+        return false;
+
+    const struct pl_color_map_params *cpars = params->color_map_params;
+    cpars = PL_DEF(cpars, &pl_color_map_default_params);
+    if (cpars->inverse_tone_mapping || cpars->visualize_lut || cpars->show_clipping)
+        return false;
+
+    struct pl_color_space src = image->color, dst = target->color;
+    pl_color_space_infer_map(&src, &dst);
+    if (src.primaries != dst.primaries || src.transfer != dst.transfer)
+        return false;
+
+    // Only the resulting luminance range matters, mirroring the rounding
+    // done by `pl_shader_color_map_ex`
+    float src_min, src_max, dst_min, dst_max;
+    pl_color_space_nominal_luma_ex(pl_nominal_luma_params(
+        .color      = &src,
+        .metadata   = cpars->metadata,
+        .scaling    = PL_HDR_PQ,
+        .out_min    = &src_min,
+        .out_max    = &src_max,
+    ));
+
+    pl_color_space_nominal_luma_ex(pl_nominal_luma_params(
+        .color      = &dst,
+        .metadata   = PL_HDR_METADATA_HDR10,
+        .scaling    = PL_HDR_PQ,
+        .out_min    = &dst_min,
+        .out_max    = &dst_max,
+    ));
+
+    return fabsf(src_min - dst_min) < 1e-6 && fabsf(src_max - dst_max) < 1e-6;
+}
+
+// Returns true if all planes can be sampled directly at the output
+// resolution, fusing plane scaling and main scaling into a single pass with
+// no intermediate FBOs. This is only possible for the simple case of SDR
+// content without any user hooks or pre-scaling processing, and single-pass
+// builtin scalers. Debanding and film grain are compatible, since they are
+// applied to each plane at its native (subsampled) resolution beforehand.
+static bool want_fused(struct pass_state *pass, const struct plane_state *planes)
+{
+    const struct pl_render_params *params = pass->params;
+    const struct pl_frame *image = &pass->image;
+    const struct plane_state *ref = &planes[pass->src_ref];
+    pl_fmt fbofmt = pass->fbofmt[4];
+    if (!fbofmt || params->num_hooks || pass->shared_img)
+        return false;
+    if (image->field != PL_FIELD_NONE && params->deinterlace_params)
+        return false;
+    if (pl_color_space_is_hdr(&image->color))
+        return false; // peak detection, contrast recovery
+    if (image->color.transfer == PL_COLOR_TRC_LINEAR)
+        return false; // needs delinearization before scaling
+
+    const float crop_w = pl_rect_w(image->crop), crop_h = pl_rect_h(image->crop);
+    for (int i = 0; i < image->num_planes; i++) {
+        const struct plane_state *st = &planes[i];
+        if (!st->type)
+            continue;
+
+        struct pl_sample_src src = {
+            .tex   = st->img.tex,
+            .new_w = abs(pl_rect_w(pass->dst_rect)),
+            .new_h = abs(pl_rect_h(pass->dst_rect)),
+            .rect = {
+                .x1 = crop_w * st->img.w / ref->img.w,
+                .y1 = crop_h * st->img.h / ref->img.h,
+            },
+        };
+
+        struct sampler_info info = sample_src_info(pass, &src, fused_usage(st, ref));
+        if (info.type == SAMPLER_COMPLEX)
+            return false;
+        if (st != ref)
+            continue;
+
+        // Mirror the linearization / sigmoidization logic of pass_scale_main
+        bool use_linear = info.dir == SAMPLER_DOWN ||
+                          (info.dir == SAMPLER_UP && params->sigmoid_params);
+        if (params->disable_linear_scaling || fbofmt->component_depth[0] < 16)
+            use_linear = false;
+        if (color_passthrough(pass))
+            use_linear = false;
+        if (use_linear)
+            return false;
+    }
+
+    return true;
+}
+
 // This scales and merges all of the source images, and initializes pass->img.
 static bool pass_read_image(struct pass_state *pass)
 {
@@ -1569,6 +2722,7 @@ static bool pass_read_image(struct pass_state *pass)
             img->tex = NULL;
             img->sh = pl_dispatch_begin_ex(pass->rr->dp, true);
             pl_shader_deinterlace(img->sh, &src, params->deinterlace_params);
+            img->ops = OP(READ);
             img->err_msg = "Failed deinterlacing plane.. disabling!";
             img->err_enum = PL_RENDER_ERR_DEINTERLACING;
             img->err_tex = planes[i].plane.texture;
@@ -1577,9 +2731,12 @@ static bool pass_read_image(struct pass_state *pass)
 
     // Original ref texture, even after preprocessing
     pl_tex ref_tex = ref->plane.texture;
+    const bool fused = want_fused(pass, planes);
+    if (fused)
+        PL_TRACE(rr, "Fusing plane scaling and main scaling");
 
     // Merge all compatible planes into 'combined' shaders
-    for (int i = 0; i < image->num_planes; i++) {
+    for (int i = 0; !fused && i < image->num_planes; i++) {
         struct plane_state *sti = &planes[i];
         if (!sti->type)
             continue;
@@ -1636,6 +2793,7 @@ static bool pass_read_image(struct pass_state *pass)
             GLSL("} \n");
 
             sti->img.fmt = fmt;
+            sti->img.ops |= stj->img.ops | OP(READ);
             pl_dispatch_abort(rr->dp, &stj->img.sh);
             *stj = (struct plane_state) {0};
             did_merge = true;
@@ -1724,6 +2882,7 @@ static bool pass_read_image(struct pass_state *pass)
 
     pl_shader sh = pl_dispatch_begin_ex(rr->dp, true);
     sh_require(sh, PL_SHADER_SIG_NONE, 0, 0);
+    unsigned ops = OP(READ);
 
     // Initialize the color to black
     GLSL("vec4 color = vec4("$", vec2("$"), 1.0);   \n"
@@ -1750,6 +2909,9 @@ static bool pass_read_image(struct pass_state *pass)
           stretch_x = pl_rect_w(ref_rounded) / pl_rect_w(ref->img.rect),
           stretch_y = pl_rect_h(ref_rounded) / pl_rect_h(ref->img.rect);
 
+    const int out_w = abs(pl_rect_w(pass->dst_rect)),
+              out_h = abs(pl_rect_h(pass->dst_rect));
+
     for (int i = 0; i < image->num_planes; i++) {
         struct plane_state *st = &planes[i];
         const struct pl_plane *plane = &st->plane;
@@ -1775,6 +2937,13 @@ static bool pass_read_image(struct pass_state *pass)
             },
         };
 
+        if (fused) {
+            // Sample the exact plane crop directly at the output resolution
+            src.rect = st->img.rect;
+            src.new_w = out_w;
+            src.new_h = out_h;
+        }
+
         if (plane->flipped) {
             src.rect.y0 = st->plane_h - src.rect.y0;
             src.rect.y1 = st->plane_h - src.rect.y1;
@@ -1794,11 +2963,18 @@ static bool pass_read_image(struct pass_state *pass)
         {
             // Image rects are already equal, no indirect scaling needed
         } else {
+            enum sampler_usage usage = SAMPLER_PLANE;
+            struct sampler *sampler = &rr->samplers_src[i];
+            if (fused && fused_usage(st, ref) == SAMPLER_MAIN) {
+                usage = SAMPLER_MAIN;
+                sampler = &rr->sampler_main;
+            }
+
             src.tex = img_tex(pass, &st->img);
             st->img.tex = NULL;
             st->img.sh = pl_dispatch_begin_ex(rr->dp, true);
-            dispatch_sampler(pass, st->img.sh, &rr->samplers_src[i],
-                             SAMPLER_PLANE, NULL, &src);
+            dispatch_sampler(pass, st->img.sh, sampler, usage, NULL, &src, NULL);
+            st->img.ops = OP(SCALE);
             st->img.err_enum |= PL_RENDER_ERR_SAMPLING;
             st->img.rect.x0 = st->img.rect.y0 = 0.0f;
             st->img.w = st->img.rect.x1 = src.new_w;
@@ -1806,6 +2982,7 @@ static bool pass_read_image(struct pass_state *pass)
         }
 
         pass_hook(pass, &st->img, plane_scaled_hook_stages[st->type]);
+        ops |= st->img.ops;
         ident_t sub = sh_subpass(sh, img_sh(pass, &st->img));
         if (!sub) {
             if (!img_tex(pass, &st->img)) {
@@ -1832,6 +3009,7 @@ static bool pass_read_image(struct pass_state *pass)
 
     pass->img = (struct img) {
         .sh     = sh,
+        .ops    = ops,
         .w      = pl_rect_w(ref_rounded),
         .h      = pl_rect_h(ref_rounded),
         .repr   = ref->img.repr,
@@ -1845,6 +3023,14 @@ static bool pass_read_image(struct pass_state *pass)
         },
     };
 
+    if (fused) {
+        // Already sampled at the final output size, so `pass_scale_main`
+        // becomes a no-op
+        pass->img.w = out_w;
+        pass->img.h = out_h;
+        pass->img.rect = (pl_rect2df) { .x1 = out_w, .y1 = out_h };
+    }
+
     // Update the reference rect to our adjusted image coordinates
     pass->ref_rect = pass->img.rect;
 
@@ -1872,7 +3058,26 @@ static bool pass_read_image(struct pass_state *pass)
     if (needs_conversion) {
         if (pass->img.repr.sys == PL_COLOR_SYSTEM_XYZ)
             pass->img.color.transfer = PL_COLOR_TRC_LINEAR;
+
+        // Apply the reshaping via LUT ahead of time, and then hand the rest
+        // of the metadata (with reshaping stripped) to the regular decoding
+        const struct pl_dovi_metadata *dovi = pass->img.repr.dovi;
+        struct pl_dovi_metadata dovi_tmp;
+        if (pass->img.repr.sys == PL_COLOR_SYSTEM_DOLBYVISION && dovi &&
+            params->dovi_lut_size > 0)
+        {
+            float scale = pl_color_repr_normalize(&pass->img.repr);
+            GLSL("color.rgb *= vec3("$"); \n", SH_FLOAT(scale));
+            pl_shader_dovi_reshape_lut(sh, dovi, params->dovi_lut_size,
+                                       &rr->dovi_state);
+            dovi_tmp = *dovi;
+            for (int c = 0; c < 3; c++)
+                dovi_tmp.comp[c].num_pivots = 0;
+            pass->img.repr.dovi = &dovi_tmp;
+        }
+
         pl_shader_decode_color(sh, &pass->img.repr, params->color_adjustment);
+        pass->img.repr.dovi = dovi;
     }
 
     if (lut_type == PL_LUT_NORMALIZED)
@@ -1894,6 +3099,71 @@ static bool pass_read_image(struct pass_state *pass)
     return true;
 }
 
+// Reduces `src` to within 2x of the target size using a cascade of 2x2 box
+// filters (i.e. bilinear sampling at 0.5x), such that the cost of the main
+// downscaler no longer grows with the downscaling ratio. Leaves `src` as-is
+// on failure.
+static void pass_prereduce(struct pass_state *pass, struct pl_sample_src *src)
+{
+    pl_renderer rr = pass->rr;
+    pl_fmt fmt = pass->fbofmt[src->components];
+    if (!fmt || !(fmt->caps & PL_FMT_CAP_LINEAR))
+        return;
+
+    for (;;) {
+        const float w = fabsf(pl_rect_w(src->rect)), h = fabsf(pl_rect_h(src->rect));
+        const bool reduce_x = w > 2 * src->new_w, reduce_y = h > 2 * src->new_h;
+        if (!reduce_x && !reduce_y)
+            return;
+
+        // Dimensions which are not reduced are copied 1:1, retaining the crop
+        struct pl_sample_src step = {
+            .tex        = src->tex,
+            .components = src->components,
+            .rect       = src->rect,
+            .new_w      = src->tex->params.w,
+            .new_h      = src->tex->params.h,
+        };
+
+        pl_rect2df rect = src->rect;
+        if (reduce_x) {
+            step.new_w = ceilf(w / 2);
+            rect.x0 = 0;
+            rect.x1 = step.new_w;
+        } else {
+            step.rect.x0 = 0;
+            step.rect.x1 = step.new_w;
+        }
+
+        if (reduce_y) {
+            step.new_h = ceilf(h / 2);
+            rect.y0 = 0;
+            rect.y1 = step.new_h;
+        } else {
+            step.rect.y0 = 0;
+            step.rect.y1 = step.new_h;
+        }
+
+        pl_tex fbo = get_fbo(pass, step.new_w, step.new_h, fmt, src->components,
+                             PL_DEBUG_TAG);
+        if (!fbo)
+            return;
+
+        pl_shader sh = pl_dispatch_begin(rr->dp);
+        pl_shader_sample_bilinear(sh, &step);
+        set_ops(pass, OP(SCALE), fbo);
+        bool ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        ));
+        if (!ok)
+            return;
+
+        src->tex = fbo;
+        src->rect = rect;
+    }
+}
+
 static bool pass_scale_main(struct pass_state *pass)
 {
     const struct pl_render_params *params = pass->params;
@@ -1930,6 +3200,10 @@ static bool pass_scale_main(struct pass_state *pass)
     bool use_sigmoid = info.dir == SAMPLER_UP && params->sigmoid_params;
     bool use_linear  = info.dir == SAMPLER_DOWN;
 
+    // Scale in the native encoding if no color conversion is needed anyway
+    if (color_passthrough(pass))
+        use_sigmoid = use_linear = false;
+
     // Opportunistically update peak here if it would save performance
     if (info.dir == SAMPLER_UP)
         hdr_update_peak(pass);
@@ -1955,7 +3229,14 @@ static bool pass_scale_main(struct pass_state *pass)
         goto done;
     }
 
-    if (info.type == SAMPLER_DIRECT && !need_fbo) {
+    // Heavy downscaling can be pre-reduced, see `pass_prereduce`. For direct
+    // sampling, this gives the equivalent of trilinear (mipmapped) sampling.
+    const float src_w = fabsf(pl_rect_w(src.rect)), src_h = fabsf(pl_rect_h(src.rect));
+    bool prereduce = params->multistage_downscaling && info.dir == SAMPLER_DOWN &&
+                     (src_w > 2 * src.new_w || src_h > 2 * src.new_h);
+    prereduce &= info.type == SAMPLER_COMPLEX || info.type == SAMPLER_DIRECT;
+
+    if (info.type == SAMPLER_DIRECT && !need_fbo && !prereduce) {
         img->w = src.new_w;
         img->h = src.new_h;
         img->rect = new_rect;
@@ -1972,20 +3253,35 @@ static bool pass_scale_main(struct pass_state *pass)
     if (pl_color_space_is_hdr(&img->color))
         use_sigmoid = use_linear = false;
 
-    if (!use_linear && img->color.transfer == PL_COLOR_TRC_LINEAR) {
+    // If the source is already a texture, linearizing and sigmoidizing it
+    // would cost an extra FBO round trip, so have the (polar) scaler apply
+    // both to every fetched texel instead
+    pl_shader tap_sh = NULL;
+    if (use_sigmoid && img->tex && !need_fbo && !prereduce &&
+        info.type == SAMPLER_COMPLEX && info.config->polar &&
+        !(rr->errors & PL_RENDER_ERR_SAMPLING))
+    {
+        tap_sh = pl_dispatch_begin_ex(rr->dp, true);
+        pl_shader_linearize(tap_sh, &img->color);
+        pl_shader_sigmoidize(tap_sh, params->sigmoid_params);
+        img->color.transfer = PL_COLOR_TRC_LINEAR;
+    }
+
+    if (!use_linear && !tap_sh && img->color.transfer == PL_COLOR_TRC_LINEAR) {
         img->color.transfer = image->color.transfer;
         if (image->color.transfer == PL_COLOR_TRC_LINEAR)
             img->color.transfer = PL_COLOR_TRC_GAMMA22; // arbitrary fallback
         pl_shader_delinearize(img_sh(pass, img), &img->color);
     }
 
-    if (use_linear || use_sigmoid) {
+    if ((use_linear || use_sigmoid) && !tap_sh) {
         pl_shader_linearize(img_sh(pass, img), &img->color);
         img->color.transfer = PL_COLOR_TRC_LINEAR;
+        img->ops |= OP(SCALE);
         pass_hook(pass, img, PL_HOOK_LINEAR);
     }
 
-    if (use_sigmoid) {
+    if (use_sigmoid && !tap_sh) {
         pl_shader_sigmoidize(img_sh(pass, img), params->sigmoid_params);
         pass_hook(pass, img, PL_HOOK_SIGMOID);
     }
@@ -1997,10 +3293,16 @@ static bool pass_scale_main(struct pass_state *pass)
         return false;
     pass->need_peak_fbo = false;
 
+    if (prereduce)
+        pass_prereduce(pass, &src);
+
     pl_shader sh = pl_dispatch_begin_ex(rr->dp, true);
-    dispatch_sampler(pass, sh, &rr->sampler_main, SAMPLER_MAIN, NULL, &src);
+    dispatch_sampler(pass, sh, &rr->sampler_main, SAMPLER_MAIN, NULL, &src, tap_sh);
+    if (tap_sh)
+        pl_dispatch_abort(rr->dp, &tap_sh);
     img->tex  = NULL;
     img->sh   = sh;
+    img->ops  = OP(SCALE);
     img->w    = src.new_w;
     img->h    = src.new_h;
     img->rect = new_rect;
@@ -2043,14 +3345,41 @@ static pl_tex get_feature_map(struct pass_state *pass)
     const float ratio = cparams->contrast_smoothness;
     const int cr_w = ceilf(abs(pl_rect_w(pass->dst_rect)) / ratio);
     const int cr_h = ceilf(abs(pl_rect_h(pass->dst_rect)) / ratio);
-    pl_tex inter_tex = get_fbo(pass, img->w, img->h, NULL, 1, PL_DEBUG_TAG);
+
+    // Optionally extract the features at reduced resolution, but never
+    // reduce the cropped region below the size of the final feature map
+    int inter_w = img->w, inter_h = img->h;
+    pl_rect2df inter_rect = img->rect;
+    if (params->feature_map_downscale > 1) {
+        const float inv = 1.0f / params->feature_map_downscale;
+        const float sx = PL_MIN(PL_MAX(inv, cr_w / fabsf(pl_rect_w(img->rect))), 1.0f);
+        const float sy = PL_MIN(PL_MAX(inv, cr_h / fabsf(pl_rect_h(img->rect))), 1.0f);
+        inter_w = PL_MIN((int) ceilf(img->w * sx), img->w);
+        inter_h = PL_MIN((int) ceilf(img->h * sy), img->h);
+        const float rx = (float) inter_w / img->w, ry = (float) inter_h / img->h;
+        inter_rect.x0 *= rx;
+        inter_rect.x1 *= rx;
+        inter_rect.y0 *= ry;
+        inter_rect.y1 *= ry;
+    }
+
+    pl_tex inter_tex = get_fbo(pass, inter_w, inter_h, NULL, 1, PL_DEBUG_TAG);
     pl_tex out_tex   = get_fbo(pass, cr_w, cr_h, NULL, 1, PL_DEBUG_TAG);
     if (!inter_tex || !out_tex)
         goto error;
 
     pl_shader sh = pl_dispatch_begin(rr->dp);
-    pl_shader_sample_direct(sh, pl_sample_src( .tex = img->tex ));
+    if (inter_w == img->w && inter_h == img->h) {
+        pl_shader_sample_direct(sh, pl_sample_src( .tex = img->tex ));
+    } else {
+        pl_shader_sample_bilinear(sh, pl_sample_src(
+            .tex   = img->tex,
+            .new_w = inter_w,
+            .new_h = inter_h,
+        ));
+    }
     pl_shader_extract_features(sh, img->color);
+    set_ops(pass, OP(COLOR), inter_tex);
     bool ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
         .shader = &sh,
         .target = inter_tex,
@@ -2060,7 +3389,7 @@ static pl_tex get_feature_map(struct pass_state *pass)
 
     const struct pl_sample_src src = {
         .tex          = inter_tex,
-        .rect         = img->rect,
+        .rect         = inter_rect,
         .address_mode = PL_TEX_ADDRESS_MIRROR,
         .components   = 1,
         .new_w        = cr_w,
@@ -2068,7 +3397,8 @@ static pl_tex get_feature_map(struct pass_state *pass)
     };
 
     sh = pl_dispatch_begin(rr->dp);
-    dispatch_sampler(pass, sh, &rr->sampler_contrast, SAMPLER_CONTRAST, out_tex, &src);
+    dispatch_sampler(pass, sh, &rr->sampler_contrast, SAMPLER_CONTRAST, out_tex, &src, NULL);
+    set_ops(pass, OP(COLOR), out_tex);
     ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
         .shader = &sh,
         .target = out_tex,
@@ -2094,9 +3424,10 @@ static void pass_convert_colors(struct pass_state *pass)
 
     struct img *img = &pass->img;
     pl_shader sh = img_sh(pass, img);
+    img->ops |= OP(COLOR);
 
     bool prelinearized = false;
-    bool need_conversion = true;
+    bool need_conversion = !color_passthrough(pass);
     assert(image->color.primaries == img->color.primaries);
     if (img->color.transfer == PL_COLOR_TRC_LINEAR) {
         if (img->repr.alpha == PL_ALPHA_PREMULTIPLIED) {
@@ -2188,6 +3519,7 @@ static void pass_convert_colors(struct pass_state *pass)
         // generate HDR feature map if required
         pl_tex feature_map = get_feature_map(pass);
         sh = img_sh(pass, img); // `get_feature_map` dispatches previous shader
+        img->ops |= OP(COLOR);
 
         // current -> target
         pl_shader_color_map_ex(sh, params->color_map_params, pl_color_map_args(
@@ -2211,18 +3543,26 @@ static void pass_convert_colors(struct pass_state *pass)
 
 // Returns true if error diffusion was successfully performed
 static bool pass_error_diffusion(struct pass_state *pass, pl_shader *sh,
-                                 int new_depth, int comps, int out_w, int out_h)
+                                 unsigned *ops, int new_depth, int comps,
+                                 int out_w, int out_h)
 {
     const struct pl_render_params *params = pass->params;
     pl_renderer rr = pass->rr;
     if (!params->error_diffusion || (rr->errors & PL_RENDER_ERR_ERROR_DIFFUSION))
         return false;
 
+    // Split the image into bands if it's too tall to process in one go
+    const size_t max_shmem = rr->gpu->glsl.max_shmem_size;
     size_t shmem_req = pl_error_diffusion_shmem_req(params->error_diffusion, out_h);
-    if (shmem_req > rr->gpu->glsl.max_shmem_size) {
-        PL_TRACE(rr, "Disabling error diffusion due to shmem requirements (%zu) "
-                 "exceeding capabilities (%zu)", shmem_req, rr->gpu->glsl.max_shmem_size);
-        return false;
+    int band_height = 0, bands = 1;
+    if (shmem_req > max_shmem) {
+        band_height = pl_error_diffusion_band_height(params->error_diffusion, max_shmem);
+        if (!band_height) {
+            PL_TRACE(rr, "Disabling error diffusion due to shmem requirements (%zu) "
+                     "exceeding capabilities (%zu)", shmem_req, max_shmem);
+            return false;
+        }
+        bands = PL_DIV_UP(out_h, band_height);
     }
 
     pl_fmt fmt = pass->fbofmt[comps];
@@ -2235,6 +3575,7 @@ static bool pass_error_diffusion(struct pass_state *pass, pl_shader *sh,
     struct pl_error_diffusion_params edpars = {
         .new_depth = new_depth,
         .kernel = params->error_diffusion,
+        .band_height = band_height,
     };
 
     // Create temporary framebuffers
@@ -2250,15 +3591,17 @@ static bool pass_error_diffusion(struct pass_state *pass, pl_shader *sh,
     }
 
     // Everything was okay, run the shaders
+    set_ops(pass, *ops, edpars.input_tex);
     bool ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
         .shader = sh,
         .target = edpars.input_tex,
     ));
 
     if (ok) {
+        set_ops(pass, OP(DITHER), edpars.output_tex);
         ok = pl_dispatch_compute(rr->dp, pl_dispatch_compute_params(
             .shader = &dsh,
-            .dispatch_size = {1, 1, 1},
+            .dispatch_size = {1, bands, 1},
         ));
     }
 
@@ -2266,6 +3609,7 @@ static bool pass_error_diffusion(struct pass_state *pass, pl_shader *sh,
     pl_shader_sample_direct(*sh, pl_sample_src(
         .tex = ok ? edpars.output_tex : edpars.input_tex,
     ));
+    *ops = OP(OUTPUT);
     return ok;
 
 error:
@@ -2290,6 +3634,7 @@ static bool pass_output_target(struct pass_state *pass)
 
     struct img *img = &pass->img;
     pl_shader sh = img_sh(pass, img);
+    img->ops |= OP(OUTPUT);
 
     if (params->corner_rounding > 0.0f) {
         const float out_w2 = fabsf(pl_rect_w(target->crop)) / 2.0f;
@@ -2374,6 +3719,7 @@ static bool pass_output_target(struct pass_state *pass)
         img->h = abs(pl_rect_h(dst_rect));
         img->tex = NULL;
         img->sh = sh = pl_dispatch_begin(rr->dp);
+        img->ops = OP(OUTPUT);
         pl_shader_distort(sh, tex, img->w, img->h, &dpars);
     }
 
@@ -2441,6 +3787,7 @@ static bool pass_output_target(struct pass_state *pass)
 
     for (int p = 0; p < target->num_planes; p++) {
         const struct pl_plane *plane = &target->planes[p];
+        unsigned ops;
         float rx = (float) plane->texture->params.w / ref->texture->params.w,
               ry = (float) plane->texture->params.h / ref->texture->params.h;
 
@@ -2504,14 +3851,19 @@ static bool pass_output_target(struct pass_state *pass)
 
             sh = pl_dispatch_begin(rr->dp);
             dispatch_sampler(pass, sh, &rr->samplers_dst[p], SAMPLER_PLANE,
-                             plane->texture, &src);
+                             plane->texture, &src, NULL);
+            ops = OP(OUTPUT);
 
         } else {
 
             // Single plane, so we can directly re-use the img shader unless
             // it's incompatible with the FBO capabilities
+            const struct pl_tex_params *tpars = &plane->texture->params;
+            bool can_comp = tpars->storable;
+            if (can_comp && params->blend_params)
+                can_comp = tpars->format->caps & PL_FMT_CAP_READWRITE;
             bool is_comp = pl_shader_is_compute(img_sh(pass, img));
-            if (is_comp && !plane->texture->params.storable) {
+            if (is_comp && !can_comp) {
                 if (!img_tex(pass, img)) {
                     PL_ERR(rr, "Rendering requires compute shaders, but output "
                            "is not storable, and FBOs are unavailable. This "
@@ -2521,7 +3873,9 @@ static bool pass_output_target(struct pass_state *pass)
             }
 
             sh = img_sh(pass, img);
+            ops = img->ops;
             img->sh = NULL;
+            img->ops = 0;
 
         }
 
@@ -2529,7 +3883,7 @@ static bool pass_output_target(struct pass_state *pass)
         // little sense to do so (and probably just adds errors)
         int depth = target->repr.bits.color_depth, applied_dither = 0;
         if (depth && (depth < 16 || params->force_dither)) {
-            if (pass_error_diffusion(pass, &sh, depth, plane->components,
+            if (pass_error_diffusion(pass, &sh, &ops, depth, plane->components,
                                      rx1 - rx0, ry1 - ry0))
             {
                 applied_dither = depth;
@@ -2538,6 +3892,7 @@ static bool pass_output_target(struct pass_state *pass)
                 if (!params->disable_dither_gamma_correction)
                     dparams.transfer = target->color.transfer;
                 pl_shader_dither(sh, depth, &rr->dither_state, &dparams);
+                ops |= OP(DITHER);
                 applied_dither = depth;
             }
         }
@@ -2575,6 +3930,7 @@ static bool pass_output_target(struct pass_state *pass)
             tscale.c[1] += plane->texture->params.h;
         }
 
+        set_ops(pass, ops, NULL);
         bool ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
             .shader = &sh,
             .target = plane->texture,
@@ -2854,6 +4210,16 @@ static void release_frame(struct pass_state *pass, struct pl_frame *frame,
 static void pass_uninit(struct pass_state *pass)
 {
     pl_renderer rr = pass->rr;
+    if (pass->tmp && !--rr->active_passes) {
+        gc_fbos(pass);
+        gc_hook_cache(rr);
+        gc_osd_atlases(rr);
+        gc_cache_memory(rr, pass->params);
+        rr->frame_stats = rr->cur_stats;
+        rr->have_stats = true;
+        deliver_info(rr, pass->params);
+    }
+
     pl_dispatch_abort(rr->dp, &pass->img.sh);
     release_frame(pass, &pass->next, &pass->acquired.next);
     release_frame(pass, &pass->prev, &pass->acquired.prev);
@@ -2999,6 +4365,8 @@ static bool pass_init(struct pass_state *pass, bool acquire_image)
     pass_fix_frames(pass);
 
     pass->tmp = pl_tmp(NULL);
+    if (!pass->rr->active_passes++)
+        pass->rr->cur_stats = (struct pl_render_frame_stats) {0};
     return true;
 
 error:
@@ -3078,50 +4446,636 @@ static bool draw_empty_overlays(pl_renderer rr,
     return true;
 }
 
-bool pl_render_image(pl_renderer rr, const struct pl_frame *pimage,
-                     const struct pl_frame *ptarget,
-                     const struct pl_render_params *params)
-{
-    params = PL_DEF(params, &pl_render_default_params);
-    pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
-    if (!pimage)
-        return draw_empty_overlays(rr, ptarget, params);
-
-    struct pass_state pass = {
-        .rr = rr,
-        .params = params,
-        .image = *pimage,
-        .target = *ptarget,
-        .info.stage = PL_RENDER_STAGE_FRAME,
-    };
+static bool render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
+                             const struct pl_frame *ptarget,
+                             const struct pl_render_params *params,
+                             bool force_cache);
 
-    if (!pass_init(&pass, true))
-        return false;
+// Returns the tile size (in target pixels) to use for rendering this pass, or
+// 0 if tiled rendering is not needed or not possible
+static int tile_size(const struct pass_state *pass)
+{
+    const struct pl_render_params *params = pass->params;
+    const struct pl_frame *image = &pass->image, *target = &pass->target;
+    pl_gpu gpu = pass->rr->gpu;
+    const pl_rect2df src = pass->ref_rect;
+    const pl_rect2d dst = pass->dst_rect;
+    const int max_dim = gpu->limits.max_tex_2d_dim;
+
+    int size = params->render_tile_size;
+    float src_max = PL_MAX(pl_rect_w(src), pl_rect_h(src));
+    if (!size && src_max > max_dim) {
+        // Keep the source footprint of each tile well within the limits
+        float scale = PL_MIN(pl_rect_w(dst), pl_rect_h(dst)) / src_max;
+        size = PL_MAX(floorf(max_dim / 2 * scale), 64);
+    }
 
-    // No-op (empty crop)
-    if (!pl_rect_w(pass.dst_rect) || !pl_rect_h(pass.dst_rect)) {
-        pass_uninit(&pass);
-        return draw_empty_overlays(rr, ptarget, params);
+    if (!size || (pl_rect_w(dst) <= size && pl_rect_h(dst) <= size))
+        return 0;
+
+    const struct pl_plane *plane = &target->planes[0];
+    const struct pl_tex_params *tpars = &plane->texture->params;
+    bool ok = pass->fbofmt[4] && target->num_planes == 1 && !plane->flipped;
+    ok &= tpars->blit_dst && pl_tex_params_dimension(*tpars) == 2;
+    ok &= (tpars->format->caps & PL_FMT_CAP_RENDERABLE) &&
+          (tpars->format->caps & PL_FMT_CAP_BLITTABLE);
+    ok &= !image->rotation && !target->rotation && image->field == PL_FIELD_NONE;
+    ok &= dst.x0 < dst.x1 && dst.y0 < dst.y1;
+    ok &= !params->num_hooks && !params->distort_params;
+    ok &= !params->corner_rounding;
+    if (!ok) {
+        PL_DEBUG(pass->rr, "Tiled rendering not possible for this target, "
+                 "rendering as a whole");
+        return 0;
     }
 
-    pass_begin_frame(&pass);
-    if (!pass_read_image(&pass))
-        goto error;
-    if (!pass_scale_main(&pass))
-        goto error;
-    pass_convert_colors(&pass);
-    if (!pass_output_target(&pass))
-        goto error;
+    return size;
+}
 
-    pass_uninit(&pass);
-    return true;
+static bool render_image(pl_renderer rr, const struct pl_frame *pimage,
+                         const struct pl_frame *ptarget,
+                         const struct pl_render_params *params);
 
-error:
-    PL_ERR(rr, "Failed rendering image!");
+// Each tile is rendered with a margin large enough to cover the scaler
+// footprint, so that the tile edges sampled by the main scaler are identical
+// to the untiled result
+static int tile_margin(const struct pl_render_params *params,
+                       float scale_x, float scale_y)
+{
+    float radius = 1.0;
+    if (params->upscaler)
+        radius = PL_MAX(radius, pl_filter_radius_bound(params->upscaler));
+    if (params->downscaler)
+        radius = PL_MAX(radius, pl_filter_radius_bound(params->downscaler));
+    const float upscale = 1.0 / PL_MIN(scale_x, scale_y);
+    return ceilf(radius * PL_MAX(upscale, 1.0)) + 2;
+}
+
+// Render the pass in tiles of (at most) `size` x `size` target pixels, each
+// rendered separately into `rr->tile_tex` and blitted into the target
+static bool render_tiled(struct pass_state *pass, const struct pl_frame *pimage,
+                         const struct pl_frame *ptarget, int size)
+{
+    pl_renderer rr = pass->rr;
+    pl_gpu gpu = rr->gpu;
+    const struct pl_render_params *params = pass->params;
+    const pl_rect2df src = pass->ref_rect;
+    const pl_rect2d dst = pass->dst_rect;
+    const float scale_x = pl_rect_w(src) / pl_rect_w(dst),
+                scale_y = pl_rect_h(src) / pl_rect_h(dst);
+
+    const int margin = tile_margin(params, scale_x, scale_y);
+    size = PL_MIN(size, gpu->limits.max_tex_2d_dim - 2 * margin);
+    if (size <= 0)
+        return false;
+
+    pl_fmt fmt = pass->target.planes[0].texture->params.format;
+    bool ok = pl_tex_recreate(gpu, &rr->tile_tex, pl_tex_params(
+        .w          = size + 2 * margin,
+        .h          = size + 2 * margin,
+        .format     = fmt,
+        .renderable = true,
+        .blit_src   = true,
+        .storable   = fmt->caps & PL_FMT_CAP_STORABLE,
+    ));
+
+    if (!ok) {
+        PL_ERR(rr, "Failed creating tile texture!");
+        return false;
+    }
+
+    PL_DEBUG(rr, "Rendering %dx%d image in tiles of %dx%d (margin %d)",
+             pl_rect_w(dst), pl_rect_h(dst), size, size, margin);
+
+    if (!params->skip_target_clearing)
+        pl_frame_clear_rgba(gpu, ptarget, CLEAR_COL(params));
+
+    struct pl_render_params tile_params = *params;
+    tile_params.render_tile_size = 0;
+    tile_params.peak_detect_params = NULL;  // keep tone mapping consistent
+    tile_params.skip_target_clearing = false;
+
+    // The outer pass already holds both frames acquired
+    struct pl_frame tile_target = *ptarget;
+    tile_target.planes[0].texture = rr->tile_tex;
+    tile_target.num_overlays = 0;
+    tile_target.acquire = NULL;
+    tile_target.release = NULL;
+
+    for (int y = dst.y0; y < dst.y1; y += size) {
+        for (int x = dst.x0; x < dst.x1; x += size) {
+            const pl_rect2d tile = {
+                x, y, PL_MIN(x + size, dst.x1), PL_MIN(y + size, dst.y1),
+            };
+
+            const pl_rect2d rc = {
+                PL_MAX(tile.x0 - margin, dst.x0),
+                PL_MAX(tile.y0 - margin, dst.y0),
+                PL_MIN(tile.x1 + margin, dst.x1),
+                PL_MIN(tile.y1 + margin, dst.y1),
+            };
+
+            struct pl_frame image = *pimage;
+            image.acquire = NULL;
+            image.release = NULL;
+            image.crop = (pl_rect2df) {
+                .x0 = src.x0 + (rc.x0 - dst.x0) * scale_x,
+                .y0 = src.y0 + (rc.y0 - dst.y0) * scale_y,
+                .x1 = src.x0 + (rc.x1 - dst.x0) * scale_x,
+                .y1 = src.y0 + (rc.y1 - dst.y0) * scale_y,
+            };
+
+            tile_target.crop = (pl_rect2df) { 0, 0, pl_rect_w(rc), pl_rect_h(rc) };
+            if (!render_image(rr, &image, &tile_target, &tile_params))
+                return false;
+
+            pl_tex_blit(gpu, pl_tex_blit_params(
+                .src    = rr->tile_tex,
+                .dst    = ptarget->planes[0].texture,
+                .src_rc = {
+                    tile.x0 - rc.x0, tile.y0 - rc.y0, 0,
+                    tile.x1 - rc.x0, tile.y1 - rc.y0, 1,
+                },
+                .dst_rc = { tile.x0, tile.y0, 0, tile.x1, tile.y1, 1 },
+            ));
+        }
+    }
+
+    // Draw the target overlays only once, on top of the complete image
+    if (ptarget->num_overlays) {
+        struct pl_frame target = *ptarget;
+        target.acquire = NULL;
+        target.release = NULL;
+        tile_params = *params;
+        tile_params.skip_target_clearing = true;
+        return draw_empty_overlays(rr, &target, &tile_params);
+    }
+
+    return true;
+}
+
+static bool render_image(pl_renderer rr, const struct pl_frame *pimage,
+                         const struct pl_frame *ptarget,
+                         const struct pl_render_params *params)
+{
+    pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
+    pl_dispatch_mark_relaxed(rr->dp, params->relaxed_precision);
+    pl_dispatch_autotune(rr->dp, params->autotune_compute);
+    if (!pimage)
+        return draw_empty_overlays(rr, ptarget, params);
+
+    struct pass_state pass = {
+        .rr = rr,
+        .params = params,
+        .image = *pimage,
+        .target = *ptarget,
+        .info.stage = PL_RENDER_STAGE_FRAME,
+    };
+
+    if (!pass_init(&pass, true))
+        return false;
+
+    // No-op (empty crop)
+    if (!pl_rect_w(pass.dst_rect) || !pl_rect_h(pass.dst_rect)) {
+        pass_uninit(&pass);
+        return draw_empty_overlays(rr, ptarget, params);
+    }
+
+    int tiles = tile_size(&pass);
+    if (tiles) {
+        bool ok = render_tiled(&pass, pimage, ptarget, tiles);
+        pass_uninit(&pass);
+        if (!ok)
+            PL_ERR(rr, "Failed rendering image in tiles!");
+        return ok;
+    }
+
+    pass_begin_frame(&pass);
+    if (!pass_read_image(&pass))
+        goto error;
+    if (!pass_scale_main(&pass))
+        goto error;
+    pass_convert_colors(&pass);
+    if (!pass_output_target(&pass))
+        goto error;
+
+    pass_uninit(&pass);
+    return true;
+
+error:
+    PL_ERR(rr, "Failed rendering image!");
     pass_uninit(&pass);
     return false;
 }
 
+bool pl_render_image(pl_renderer rr, const struct pl_frame *pimage,
+                     const struct pl_frame *ptarget,
+                     const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    if (pimage && pimage->signature && !(rr->errors & PL_RENDER_ERR_FRAME_MIXING)) {
+        // Route signed images through the redraw cache
+        return render_image_mix(rr, &(struct pl_frame_mix) {
+            .num_frames     = 1,
+            .frames         = &pimage,
+            .signatures     = &pimage->signature,
+            .timestamps     = (float[]) { 0.0 },
+            .vsync_duration = 1.0,
+        }, ptarget, params, true);
+    }
+
+    return render_image(rr, pimage, ptarget, params);
+}
+
+bool pl_render_image_batch(pl_renderer rr, const struct pl_frame *images,
+                           const pl_rect2df *rects, int num_images,
+                           const struct pl_frame *ptarget,
+                           const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+
+    // Hold the target acquired (and defer FBO garbage collection) for the
+    // duration of the entire batch
+    struct pass_state pass = {
+        .rr = rr,
+        .params = params,
+        .src_ref = -1,
+        .target = *ptarget,
+        .info.stage = PL_RENDER_STAGE_BLEND,
+    };
+
+    if (!pass_init(&pass, false))
+        return false;
+
+    struct pl_frame target = pass.target;
+    target.acquire = NULL;
+    target.release = NULL;
+    if (!params->skip_target_clearing)
+        pl_frame_clear_rgba(rr->gpu, &target, CLEAR_COL(params));
+
+    struct pl_render_params batch_params = *params;
+    batch_params.skip_target_clearing = true;
+    bool ok = true;
+
+    // Render all images first, so their overlays and the target overlays
+    // are drawn on top
+    struct pl_frame sub_target = target;
+    sub_target.num_overlays = 0;
+    for (int i = 0; i < num_images; i++) {
+        sub_target.crop = rects[i];
+        ok &= pl_render_image(rr, &images[i], &sub_target, &batch_params);
+    }
+
+    if (target.num_overlays)
+        ok &= draw_empty_overlays(rr, &target, &batch_params);
+
+    pass_uninit(&pass);
+    return ok;
+}
+
+bool pl_render_image_composite(pl_renderer rr, const struct pl_frame *images,
+                               const pl_rect2df *rects, int num_images,
+                               const struct pl_frame *ptarget,
+                               const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    if (num_images <= 1 || params->skip_target_clearing)
+        goto fallback;
+
+    struct pass_state pass = {
+        .rr = rr,
+        .params = params,
+        .src_ref = -1,
+        .target = *ptarget,
+        .info.stage = PL_RENDER_STAGE_BLEND,
+    };
+
+    if (!pass_init(&pass, false))
+        return false;
+
+    const enum pl_fmt_caps caps = PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_SAMPLEABLE |
+                                  PL_FMT_CAP_BLITTABLE;
+    pl_fmt fmt = pl_find_fmt(rr->gpu, PL_FMT_FLOAT, 4, 16, 0, caps);
+    if (!fmt || !pass.fbofmt[4]) {
+        pass_uninit(&pass);
+        goto fallback;
+    }
+
+    struct pl_frame target = pass.target;
+    target.acquire = NULL;
+    target.release = NULL;
+    // The intermediate is only ever accessed through explicit crops, so
+    // allocate it with headroom to avoid reallocating it on every resize
+    pl_tex ref = target.planes[pass.dst_ref].texture;
+    const int w = ref->params.w, h = ref->params.h;
+    bool ok = pl_tex_recreate_headroom(rr->gpu, &rr->composite_tex, pl_tex_params(
+        .w          = w,
+        .h          = h,
+        .format     = fmt,
+        .sampleable = true,
+        .renderable = true,
+        .blit_dst   = true,
+        .debug_tag  = PL_DEBUG_TAG,
+    ));
+
+    if (!ok) {
+        PL_ERR(rr, "Failed creating composite texture!");
+        pass_uninit(&pass);
+        goto fallback;
+    }
+
+    // Composite in linear light, using the target's primaries. ICC profiles
+    // may describe gamuts exceeding the nominal primaries, so use a gamut
+    // wide enough to hold any realistic display in that case
+    struct pl_color_space csp = target.color;
+    csp.transfer = PL_COLOR_TRC_LINEAR;
+    if (target.icc || target.profile.data)
+        csp.primaries = PL_COLOR_PRIM_BT_2020;
+
+    const pl_rect2df full = { 0, 0, w, h };
+    struct pl_frame composite = {
+        .num_planes = 1,
+        .planes = {{
+            .texture            = rr->composite_tex,
+            .components         = 4,
+            .component_mapping  = {0, 1, 2, 3},
+        }},
+        .repr = {
+            .sys    = PL_COLOR_SYSTEM_RGB,
+            .levels = PL_COLOR_LEVELS_FULL,
+            .alpha  = PL_ALPHA_PREMULTIPLIED,
+        },
+        .color      = csp,
+        .rotation   = target.rotation,
+    };
+
+    pl_tex_clear(rr->gpu, rr->composite_tex, (float[4]) {0});
+
+    // Render all images into the intermediate, without any of the output
+    // encoding, which is only performed once for the complete target below
+    struct pl_render_params window_params = *params;
+    window_params.skip_target_clearing = true;
+    window_params.dither_params = NULL;
+    window_params.error_diffusion = NULL;
+    window_params.force_dither = false;
+    for (int i = 0; i < num_images; i++) {
+        composite.crop = rects[i];
+        pl_rect2df *rc = &composite.crop;
+        if ((!rc->x0 && !rc->x1) || (!rc->y0 && !rc->y1))
+            *rc = full; // default to the target size, not the texture size
+        ok &= pl_render_image(rr, &images[i], &composite, &window_params);
+    }
+
+    // Only the output stage remains, performed as a trivial unscaled render
+    // of the intermediate onto the target, which also draws the target's own
+    // overlays on top
+    struct pl_render_params out_params = *params;
+    out_params.upscaler = out_params.downscaler = NULL;
+    out_params.plane_upscaler = out_params.plane_downscaler = NULL;
+    out_params.deband_params = NULL;
+    out_params.sigmoid_params = NULL;
+    out_params.deinterlace_params = NULL;
+    out_params.color_adjustment = NULL;
+    out_params.peak_detect_params = NULL;
+    out_params.cone_params = NULL;
+    out_params.distort_params = NULL;
+    out_params.blend_params = NULL;
+    out_params.corner_rounding = 0.0f;
+    out_params.lut = NULL;
+    out_params.hooks = NULL;
+    out_params.num_hooks = 0;
+
+    composite.crop = full;
+    target.crop = full;
+    ok &= pl_render_image(rr, &composite, &target, &out_params);
+
+    pass_uninit(&pass);
+    return ok;
+
+fallback:
+    return pl_render_image_batch(rr, images, rects, num_images, ptarget, params);
+}
+
+bool pl_frames_split_band(const struct pl_frame *image,
+                          const struct pl_frame *target,
+                          const struct pl_render_params *params,
+                          int index, int num_bands,
+                          struct pl_render_band *out)
+{
+    pl_assert(index >= 0 && index < num_bands);
+    params = PL_DEF(params, &pl_render_default_params);
+    if (image->rotation || target->rotation)
+        return false;
+
+    pl_tex src_ref = image->planes[frame_ref(image)].texture;
+    pl_tex dst_ref = target->planes[frame_ref(target)].texture;
+    pl_rect2df src = image->crop, dst = target->crop;
+    if ((!src.x0 && !src.x1) || (!src.y0 && !src.y1))
+        src = (pl_rect2df) { 0, 0, src_ref->params.w, src_ref->params.h };
+    if ((!dst.x0 && !dst.x1) || (!dst.y0 && !dst.y1))
+        dst = (pl_rect2df) { 0, 0, dst_ref->params.w, dst_ref->params.h };
+    if (src.x0 > src.x1 || src.y0 > src.y1 || dst.x0 > dst.x1 || dst.y0 > dst.y1)
+        return false;
+
+    // Round the output rect in the same way as `fix_refs_and_rects`
+    const pl_rect2d rdst = {
+        .x0 = roundf(PL_CLAMP(dst.x0, 0.0, dst_ref->params.w)),
+        .y0 = roundf(PL_CLAMP(dst.y0, 0.0, dst_ref->params.h)),
+        .x1 = roundf(PL_CLAMP(dst.x1, 0.0, dst_ref->params.w)),
+        .y1 = roundf(PL_CLAMP(dst.y1, 0.0, dst_ref->params.h)),
+    };
+
+    if (rdst.x0 >= rdst.x1 || rdst.y0 >= rdst.y1)
+        return false;
+
+    const float scale_x = pl_rect_w(src) / pl_rect_w(dst),
+                scale_y = pl_rect_h(src) / pl_rect_h(dst);
+    const int margin = tile_margin(params, scale_x, scale_y);
+    const int h = pl_rect_h(rdst);
+    const pl_rect2d band = {
+        rdst.x0, rdst.y0 + (int64_t) h * index / num_bands,
+        rdst.x1, rdst.y0 + (int64_t) h * (index + 1) / num_bands,
+    };
+
+    const pl_rect2d rc = {
+        rdst.x0, PL_MAX(band.y0 - margin, rdst.y0),
+        rdst.x1, PL_MIN(band.y1 + margin, rdst.y1),
+    };
+
+    *out = (struct pl_render_band) {
+        .image          = *image,
+        .target_crop    = { 0, 0, pl_rect_w(rc), pl_rect_h(rc) },
+        .width          = pl_rect_w(rc),
+        .height         = pl_rect_h(rc),
+        .src_rc         = { 0, band.y0 - rc.y0, pl_rect_w(rc), band.y1 - rc.y0 },
+        .dst_rc         = band,
+    };
+
+    out->image.crop = (pl_rect2df) {
+        .x0 = src.x0 + (rc.x0 - dst.x0) * scale_x,
+        .y0 = src.y0 + (rc.y0 - dst.y0) * scale_y,
+        .x1 = src.x0 + (rc.x1 - dst.x0) * scale_x,
+        .y1 = src.y0 + (rc.y1 - dst.y0) * scale_y,
+    };
+
+    return true;
+}
+
+static inline const struct pl_render_params *
+multi_params(const struct pl_render_params *const params[], int idx)
+{
+    return PL_DEF(params ? params[idx] : NULL, &pl_render_default_params);
+}
+
+bool pl_render_image_multi(pl_renderer rr, const struct pl_frame *pimage,
+                           const struct pl_frame *targets, int num_targets,
+                           const struct pl_render_params *const params[])
+{
+    if (num_targets <= 0)
+        return true;
+
+    bool ok = true;
+    if (!pimage || num_targets == 1)
+        goto fallback;
+
+    // User hooks are only run by the per-target passes
+    struct pl_render_params params0 = *multi_params(params, 0);
+    params0.hooks = NULL;
+    params0.num_hooks = 0;
+
+    pl_dispatch_mark_dynamic(rr->dp, params0.dynamic_constants);
+    pl_dispatch_mark_relaxed(rr->dp, params0.relaxed_precision);
+    pl_dispatch_autotune(rr->dp, params0.autotune_compute);
+    struct pass_state pass = {
+        .rr = rr,
+        .params = &params0,
+        .image = *pimage,
+        .target = targets[0],
+        .info.stage = PL_RENDER_STAGE_FRAME,
+        .shared_img = true,
+    };
+
+    if (!pass_init(&pass, true))
+        return false;
+
+    if (!pass.fbofmt[4] || !pl_rect_w(pass.dst_rect) || !pl_rect_h(pass.dst_rect)) {
+        pass_uninit(&pass);
+        goto fallback;
+    }
+
+    // Read, merge and pre-process the image planes only once, and
+    // materialize the result into a dedicated texture, since the FBOs used by
+    // this pass may be reused by the per-target passes below
+    pass_begin_frame(&pass);
+    if (!pass_read_image(&pass))
+        goto error;
+
+    struct img *img = &pass.img;
+    pl_fmt fmt = pass.fbofmt[img->comps];
+    ok = pl_tex_recreate(rr->gpu, &rr->shared_tex, pl_tex_params(
+        .w          = img->w,
+        .h          = img->h,
+        .format     = fmt,
+        .sampleable = true,
+        .renderable = true,
+        .debug_tag  = PL_DEBUG_TAG,
+    ));
+
+    if (!ok) {
+        PL_ERR(rr, "Failed creating shared image texture!");
+        goto error;
+    }
+
+    img_sh(&pass, img);
+    set_ops(&pass, img->ops, rr->shared_tex);
+    ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
+        .shader = &img->sh,
+        .target = rr->shared_tex,
+    ));
+    if (!ok)
+        goto error;
+
+    // Remap image overlays to the coordinates of the shared image
+    const pl_rect2df crop = pass.image.crop;
+    const float sx = pl_rect_w(img->rect) / pl_rect_w(crop),
+                sy = pl_rect_h(img->rect) / pl_rect_h(crop);
+    struct pl_overlay *overlays = pl_calloc_ptr(pass.tmp, pass.image.num_overlays, overlays);
+    for (int i = 0; i < pass.image.num_overlays; i++) {
+        struct pl_overlay *ol = &overlays[i];
+        *ol = pass.image.overlays[i];
+        float ox = 0.0f, oy = 0.0f;
+        switch (ol->coords) {
+        case PL_OVERLAY_COORDS_AUTO:
+        case PL_OVERLAY_COORDS_SRC_FRAME:
+            ol->coords = PL_OVERLAY_COORDS_SRC_FRAME;
+            ox = img->rect.x0 - sx * crop.x0;
+            oy = img->rect.y0 - sy * crop.y0;
+            break;
+        case PL_OVERLAY_COORDS_SRC_CROP:
+            break;
+        case PL_OVERLAY_COORDS_DST_FRAME:
+        case PL_OVERLAY_COORDS_DST_CROP:
+            continue;
+        case PL_OVERLAY_COORDS_COUNT:
+            pl_unreachable();
+        }
+
+        struct pl_overlay_part *parts = pl_calloc_ptr(pass.tmp, ol->num_parts, parts);
+        for (int n = 0; n < ol->num_parts; n++) {
+            parts[n] = ol->parts[n];
+            parts[n].dst = (pl_rect2df) {
+                .x0 = ox + sx * parts[n].dst.x0,
+                .y0 = oy + sy * parts[n].dst.y0,
+                .x1 = ox + sx * parts[n].dst.x1,
+                .y1 = oy + sy * parts[n].dst.y1,
+            };
+        }
+        ol->parts = parts;
+    }
+
+    const struct pl_frame shared = {
+        .num_planes = 1,
+        .planes = {{
+            .texture            = rr->shared_tex,
+            .components         = img->comps,
+            .component_mapping  = {0, 1, 2, 3},
+        }},
+        .repr = {
+            .sys    = PL_COLOR_SYSTEM_RGB,
+            .levels = PL_COLOR_LEVELS_FULL,
+            .alpha  = img->repr.alpha,
+        },
+        .color      = img->color,
+        .crop       = img->rect,
+        .rotation   = pass.image.rotation,
+        .overlays   = overlays,
+        .num_overlays = pass.image.num_overlays,
+    };
+
+    // Branch off into the per-target passes. Pre-processing already applied
+    // to the shared image must not be applied a second time.
+    for (int i = 0; i < num_targets; i++) {
+        struct pl_render_params tparams = *multi_params(params, i);
+        tparams.deband_params = NULL;
+        tparams.deinterlace_params = NULL;
+        tparams.color_adjustment = NULL;
+        ok &= render_image(rr, &shared, &targets[i], &tparams);
+    }
+
+    pass_uninit(&pass);
+    return ok;
+
+error:
+    PL_ERR(rr, "Failed rendering shared image!");
+    pass_uninit(&pass);
+    return false;
+
+fallback:
+    for (int i = 0; i < num_targets; i++)
+        ok &= pl_render_image(rr, pimage, &targets[i], multi_params(params, i));
+    return ok;
+}
+
 const struct pl_frame *pl_frame_mix_current(const struct pl_frame_mix *mix)
 {
     const struct pl_frame *cur = NULL;
@@ -3155,71 +5109,77 @@ const struct pl_frame *pl_frame_mix_nearest(const struct pl_frame_mix *mix)
     return best;
 }
 
-struct params_info {
-    uint64_t hash;
-    bool trivial;
-};
-
-static struct params_info render_params_info(const struct pl_render_params *params_orig)
+// Serializes all parameters relevant to the rendering of a single frame, and
+// hashes them. Since params rarely change between frames, the serialized
+// form is compared against that of the previous call first, which is much
+// cheaper than hashing it again.
+static struct params_info render_params_info(pl_renderer rr,
+                                             const struct pl_render_params *params_orig)
 {
     struct pl_render_params params = *params_orig;
-    struct params_info info = {
-        .trivial = true,
-        .hash = 0,
-    };
+    pl_str *buf = &rr->params_snapshot;
+    buf->len = 0;
+    bool trivial = true;
 
-#define HASH_PTR(ptr, def, ptr_trivial)                                         \
+#define APPEND(ptr) pl_str_append_raw(rr, buf, ptr, sizeof(*(ptr)))
+
+#define APPEND_PTR(ptr, def, ptr_trivial)                                       \
     do {                                                                        \
+        const bool present = ptr || (def) != NULL;                              \
+        APPEND(&present);                                                       \
         if (ptr) {                                                              \
-            pl_hash_merge(&info.hash, pl_mem_hash(ptr, sizeof(*ptr)));          \
-            info.trivial &= (ptr_trivial);                                      \
+            APPEND(ptr);                                                        \
+            trivial &= (ptr_trivial);                                           \
             ptr = NULL;                                                         \
         } else if ((def) != NULL) {                                             \
-            pl_hash_merge(&info.hash, pl_mem_hash(def, sizeof(*ptr)));          \
+            pl_str_append_raw(rr, buf, def, sizeof(*ptr));                      \
         }                                                                       \
     } while (0)
 
-#define HASH_FILTER(scaler)                                                     \
+#define APPEND_FILTER(scaler)                                                   \
     do {                                                                        \
+        bool has_filter = false;                                                \
         if ((scaler == &pl_filter_bilinear || scaler == &pl_filter_nearest) &&  \
             params.skip_anti_aliasing)                                          \
         {                                                                       \
             /* treat as NULL */                                                 \
         } else if (scaler) {                                                    \
             struct pl_filter_config filter = *scaler;                           \
-            HASH_PTR(filter.kernel, NULL, false);                               \
-            HASH_PTR(filter.window, NULL, false);                               \
-            pl_hash_merge(&info.hash, pl_var_hash(filter));                     \
+            APPEND_PTR(filter.kernel, NULL, false);                             \
+            APPEND_PTR(filter.window, NULL, false);                             \
+            APPEND(&filter);                                                    \
+            has_filter = true;                                                  \
             scaler = NULL;                                                      \
         }                                                                       \
+        APPEND(&has_filter);                                                    \
     } while (0)
 
-    HASH_FILTER(params.upscaler);
-    HASH_FILTER(params.downscaler);
+    APPEND_FILTER(params.upscaler);
+    APPEND_FILTER(params.downscaler);
 
-    HASH_PTR(params.deband_params, NULL, false);
-    HASH_PTR(params.sigmoid_params, NULL, false);
-    HASH_PTR(params.deinterlace_params, NULL, false);
-    HASH_PTR(params.cone_params, NULL, true);
-    HASH_PTR(params.icc_params, &pl_icc_default_params, true);
-    HASH_PTR(params.color_adjustment, &pl_color_adjustment_neutral, true);
-    HASH_PTR(params.color_map_params, &pl_color_map_default_params, true);
-    HASH_PTR(params.peak_detect_params, NULL, false);
+    APPEND_PTR(params.deband_params, NULL, false);
+    APPEND_PTR(params.sigmoid_params, NULL, false);
+    APPEND_PTR(params.deinterlace_params, NULL, false);
+    APPEND_PTR(params.cone_params, NULL, true);
+    APPEND_PTR(params.icc_params, &pl_icc_default_params, true);
+    APPEND_PTR(params.color_adjustment, &pl_color_adjustment_neutral, true);
+    APPEND_PTR(params.color_map_params, &pl_color_map_default_params, true);
+    APPEND_PTR(params.peak_detect_params, NULL, false);
 
-    // Hash all hooks
+    // Include all hooks
     for (int i = 0; i < params.num_hooks; i++) {
         const struct pl_hook *hook = params.hooks[i];
         if (hook->stages == PL_HOOK_OUTPUT)
             continue; // ignore hooks only relevant to pass_output_target
-        pl_hash_merge(&info.hash, pl_var_hash(*hook));
-        info.trivial = false;
+        APPEND(hook);
+        trivial = false;
     }
     params.hooks = NULL;
 
-    // Hash the LUT by only looking at the signature
+    // Include the LUT by only looking at the signature
     if (params.lut) {
-        pl_hash_merge(&info.hash, params.lut->signature);
-        info.trivial = false;
+        APPEND(&params.lut->signature);
+        trivial = false;
         params.lut = NULL;
     }
 
@@ -3227,8 +5187,13 @@ static struct params_info render_params_info(const struct pl_render_params *para
 
     // Clear out fields only relevant to pl_render_image_mix
     CLEAR(params.frame_mixer);
+    CLEAR(params.motion_params);
     CLEAR(params.preserve_mixing_cache);
+    CLEAR(params.frame_cache_memory);
+    CLEAR(params.max_cache_memory);
+    CLEAR(params.max_mix_frames);
     CLEAR(params.skip_caching_single_frame);
+    CLEAR(params.reuse_mixed_output);
     memset(params.background_color, 0, sizeof(params.background_color));
     CLEAR(params.background_transparency);
     CLEAR(params.skip_target_clearing);
@@ -3246,25 +5211,233 @@ static struct params_info render_params_info(const struct pl_render_params *para
 
     // Clear out other irrelevant fields
     CLEAR(params.dynamic_constants);
+    CLEAR(params.render_tile_size);
+    CLEAR(params.overlay_atlas);
+    CLEAR(params.async_compute);
+    CLEAR(params.autotune_compute);
     CLEAR(params.info_callback);
     CLEAR(params.info_priv);
+    CLEAR(params.defer_info_callback);
 
-    pl_hash_merge(&info.hash, pl_var_hash(params));
-    return info;
+    APPEND(&params);
+
+    if (!pl_str_equals(*buf, rr->params_prev)) {
+        rr->params_hash = pl_str_hash(*buf);
+        rr->params_trivial = trivial;
+        PL_SWAP(rr->params_snapshot, rr->params_prev);
+    }
+
+    return (struct params_info) {
+        .hash = rr->params_hash,
+        .trivial = rr->params_trivial,
+    };
 }
 
-#define MAX_MIX_FRAMES 16
+// Hash everything that affects the output of the frame mixing and output
+// passes, for `reuse_mixed_output`. Returns 0 if the output can't be reused.
+static uint64_t mix_output_hash(const struct pl_frame *target,
+                                const struct pl_render_params *params,
+                                uint64_t params_hash,
+                                const struct cached_frame *frames,
+                                const float *weights, int num_frames)
+{
+    if (!params->reuse_mixed_output || params->num_hooks)
+        return 0;
+    if (params->dither_params && params->dither_params->temporal)
+        return 0;
+    if (target->num_planes != 1 || target->num_overlays)
+        return 0;
+
+    // The output depends on the previous target contents in these cases, so
+    // blitting over the entire target is not equivalent
+    if (params->skip_target_clearing || params->blend_params)
+        return 0;
+
+    const struct pl_plane *plane = &target->planes[0];
+    const struct pl_tex_params *tpars = &plane->texture->params;
+    if (!tpars->blit_src || !tpars->blit_dst || pl_tex_params_dimension(*tpars) != 2)
+        return 0;
+
+    // Output-only params, which are excluded from `params_hash`
+    uint64_t hash = params_hash;
+    if (params->distort_params)
+        pl_hash_merge(&hash, pl_var_hash(*params->distort_params));
+    if (params->dither_params)
+        pl_hash_merge(&hash, pl_var_hash(*params->dither_params));
+    pl_hash_merge(&hash, (uintptr_t) params->error_diffusion);
+    pl_hash_merge(&hash, pl_var_hash(params->force_dither));
+    pl_hash_merge(&hash, pl_var_hash(params->corner_rounding));
+    pl_hash_merge(&hash, pl_var_hash(params->background_color));
+    pl_hash_merge(&hash, pl_var_hash(params->background_transparency));
+    pl_hash_merge(&hash, pl_var_hash(params->blend_against_tiles));
+    pl_hash_merge(&hash, pl_var_hash(params->tile_colors));
+    pl_hash_merge(&hash, pl_var_hash(params->tile_size));
+    if (params->motion_params)
+        pl_hash_merge(&hash, pl_var_hash(*params->motion_params));
+
+    // Target configuration
+    pl_hash_merge(&hash, (uintptr_t) tpars->format);
+    pl_hash_merge(&hash, pl_var_hash(tpars->w));
+    pl_hash_merge(&hash, pl_var_hash(tpars->h));
+    pl_hash_merge(&hash, pl_var_hash(plane->components));
+    pl_hash_merge(&hash, pl_var_hash(plane->component_mapping));
+    pl_hash_merge(&hash, pl_var_hash(plane->flipped));
+    pl_hash_merge(&hash, pl_var_hash(plane->shift_x));
+    pl_hash_merge(&hash, pl_var_hash(plane->shift_y));
+    pl_hash_merge(&hash, pl_var_hash(target->repr));
+    pl_hash_merge(&hash, pl_var_hash(target->color));
+    pl_hash_merge(&hash, target->profile.signature);
+    pl_hash_merge(&hash, target->icc ? target->icc->signature : 0);
+    pl_hash_merge(&hash, target->lut ? target->lut->signature : 0);
+    pl_hash_merge(&hash, pl_var_hash(target->lut_type));
+    pl_hash_merge(&hash, pl_var_hash(target->crop));
+    pl_hash_merge(&hash, pl_var_hash(target->rotation));
+
+    // Mixed frames, and their contributions
+    for (int i = 0; i < num_frames; i++) {
+        pl_hash_merge(&hash, frames[i].signature);
+        pl_hash_merge(&hash, pl_var_hash(frames[i].crop));
+        pl_hash_merge(&hash, pl_var_hash(weights[i]));
+    }
 
-bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
-                         const struct pl_frame *ptarget,
-                         const struct pl_render_params *params)
+    return PL_DEF(hash, 1);
+}
+
+// Estimates the motion field between two cached frames, reusing the luma
+// pyramids and motion field of previous calls where possible. Returns the
+// finest level of the motion field, or NULL if motion compensation fails or
+// is unsupported, in which case frame mixing proceeds without it.
+static pl_tex pass_estimate_motion(struct pass_state *pass,
+                                   const struct cached_frame *a,
+                                   const struct cached_frame *b)
 {
-    if (!images->num_frames)
-        return pl_render_image(rr, NULL, ptarget, params);
+    const struct pl_render_params *params = pass->params;
+    const struct pl_motion_params *mpars = params->motion_params;
+    pl_renderer rr = pass->rr;
+    struct motion_state *m = &rr->motion;
+    if (rr->errors & PL_RENDER_ERR_MOTION)
+        return NULL;
 
-    params = PL_DEF(params, &pl_render_default_params);
-    struct params_info par_info = render_params_info(params);
+    const enum pl_fmt_caps caps = PL_FMT_CAP_RENDERABLE | PL_FMT_CAP_SAMPLEABLE;
+    pl_fmt luma_fmt = pass->fbofmt[1];
+    pl_fmt vec_fmt = pl_find_fmt(rr->gpu, PL_FMT_FLOAT, 4, 16, 0, caps);
+    if (!luma_fmt || !vec_fmt) {
+        PL_WARN(rr, "No suitable formats for motion estimation.. disabling!");
+        rr->errors |= PL_RENDER_ERR_MOTION;
+        return NULL;
+    }
+
+    const int levels = PL_CLAMP(PL_DEF(mpars->levels, 4), 1, PL_MOTION_MAX_LEVELS);
+    const int block_size = PL_CLAMP(PL_DEF(mpars->block_size, 8), 2, 16);
+    if (levels != m->levels) {
+        m->ids[0] = m->ids[1] = 0;
+        m->vecs_key = 0;
+        m->levels = levels;
+    }
+
+    // When stepping through a video, the second frame of the previous pair
+    // becomes the first frame of the current one, so reuse its pyramid
+    if (m->ids[1] == a->id && m->ids[0] != a->id) {
+        for (int i = 0; i < PL_MOTION_MAX_LEVELS; i++)
+            PL_SWAP(m->luma[0][i], m->luma[1][i]);
+        PL_SWAP(m->ids[0], m->ids[1]);
+    }
+
+    const struct cached_frame *frames[2] = { a, b };
+    for (int n = 0; n < 2; n++) {
+        if (m->ids[n] == frames[n]->id)
+            continue;
+
+        m->ids[n] = 0;
+        pl_tex src = frames[n]->tex;
+        for (int i = 0; i < levels; i++) {
+            bool ok = pl_tex_recreate(rr->gpu, &m->luma[n][i], pl_tex_params(
+                .w = PL_DIV_UP(src->params.w, 2),
+                .h = PL_DIV_UP(src->params.h, 2),
+                .format = luma_fmt,
+                .sampleable = true,
+                .renderable = true,
+            ));
+            if (!ok)
+                goto error;
+
+            pl_shader sh = pl_dispatch_begin(rr->dp);
+            if (!pl_shader_motion_downscale(sh, src, i == 0)) {
+                pl_dispatch_abort(rr->dp, &sh);
+                goto error;
+            }
+
+            ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
+                .shader = &sh,
+                .target = m->luma[n][i],
+            ));
+            if (!ok)
+                goto error;
+            src = m->luma[n][i];
+        }
+        m->ids[n] = frames[n]->id;
+    }
+
+    uint64_t key = a->id;
+    pl_hash_merge(&key, b->id);
+    pl_hash_merge(&key, pl_var_hash(*mpars));
+    if (key == m->vecs_key)
+        return m->vecs[0];
+
+    // Refine the motion field from the coarsest level to the finest
+    m->vecs_key = 0;
+    for (int i = levels - 1; i >= 0; i--) {
+        pl_tex prev = m->luma[0][i];
+        bool ok = pl_tex_recreate(rr->gpu, &m->vecs[i], pl_tex_params(
+            .w = PL_DIV_UP(prev->params.w, block_size),
+            .h = PL_DIV_UP(prev->params.h, block_size),
+            .format = vec_fmt,
+            .sampleable = true,
+            .renderable = true,
+        ));
+        if (!ok)
+            goto error;
+
+        pl_shader sh = pl_dispatch_begin(rr->dp);
+        ok = pl_shader_motion_estimate(sh, pl_motion_source(
+            .prev   = prev,
+            .next   = m->luma[1][i],
+            .coarse = i + 1 < levels ? m->vecs[i + 1] : NULL,
+        ), mpars);
+        if (!ok) {
+            pl_dispatch_abort(rr->dp, &sh);
+            goto error;
+        }
+
+        ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = m->vecs[i],
+        ));
+        if (!ok)
+            goto error;
+    }
+
+    m->vecs_key = key;
+    return m->vecs[0];
+
+error:
+    PL_ERR(rr, "Failed estimating motion for frame interpolation.. disabling!");
+    rr->errors |= PL_RENDER_ERR_MOTION;
+    motion_destroy(rr, m);
+    return NULL;
+}
+
+#define MAX_MIX_FRAMES 16
+
+static bool render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
+                             const struct pl_frame *ptarget,
+                             const struct pl_render_params *params,
+                             bool force_cache)
+{
+    struct params_info par_info = render_params_info(rr, params);
     pl_dispatch_mark_dynamic(rr->dp, params->dynamic_constants);
+    pl_dispatch_mark_relaxed(rr->dp, params->relaxed_precision);
+    pl_dispatch_autotune(rr->dp, params->autotune_compute);
 
     require(images->num_frames >= 1);
     require(images->vsync_duration > 0.0);
@@ -3295,6 +5468,7 @@ bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
 
     int fidx = 0;
     struct cached_frame frames[MAX_MIX_FRAMES];
+    int frame_idx[MAX_MIX_FRAMES];
     float weights[MAX_MIX_FRAMES];
     float wsum = 0.0;
 
@@ -3318,9 +5492,31 @@ bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
         }
     }
 
-    // Traverse the input frames and determine/prepare the ones we need
+    // For motion compensation, pick the pair of frames straddling the vsync,
+    // and interpolate linearly between them
     bool single_frame = !params->frame_mixer || images->num_frames == 1;
+    int memc_idx = -1;
+    float memc_t = 0.0;
+    if (!single_frame && params->motion_params && !(rr->errors & PL_RENDER_ERR_MOTION)) {
+        for (int i = 0; i < images->num_frames - 1; i++) {
+            const float ts = images->timestamps[i], next = images->timestamps[i + 1];
+            if (ts <= 0.0 && next > 0.0) {
+                memc_idx = i;
+                memc_t = -ts / (next - ts);
+                break;
+            }
+        }
+    }
+
+    // Traverse the input frames and determine the ones we need, keeping at
+    // most `max_frames` of them with the largest contributions
+    const int max_frames = params->max_mix_frames > 0
+                            ? PL_MIN(params->max_mix_frames, MAX_MIX_FRAMES)
+                            : MAX_MIX_FRAMES;
+    struct { int idx; float weight; } mixed[MAX_MIX_FRAMES];
+    int num_mixed;
 retry:
+    num_mixed = 0;
     for (int i = 0; i < images->num_frames; i++) {
         uint64_t sig = images->signatures[i];
         float rts = images->timestamps[i];
@@ -3335,7 +5531,20 @@ retry:
         }
 
         float weight;
-        if (single_frame) {
+        if (memc_idx >= 0 && !single_frame) {
+
+            // Only the two frames being interpolated between contribute
+            if (i == memc_idx) {
+                weight = 1.0 - memc_t;
+            } else if (i == memc_idx + 1) {
+                weight = memc_t;
+            } else {
+                PL_TRACE(rr, "  -> Skipping: not adjacent to vsync");
+                continue;
+            }
+            PL_TRACE(rr, "  -> Interpolation offset %f = weight %f", memc_t, weight);
+
+        } else if (single_frame) {
 
             // Only render the refimg, ignore others
             if (img == refimg) {
@@ -3383,19 +5592,16 @@ retry:
 
         }
 
-        struct cached_frame *f = NULL;
         for (int j = 0; j < rr->frames.num; j++) {
-            if (rr->frames.elem[j].signature == sig) {
-                f = &rr->frames.elem[j];
-                f->evict = false;
-                break;
-            }
+            if (rr->frames.elem[j].signature == sig)
+                rr->frames.elem[j].evict = false;
         }
 
         // Skip frames with negligible contributions. Do this after the loop
         // above to make sure these frames don't get evicted just yet, and
         // also exclude the reference image from this optimization to ensure
-        // that we always have at least one frame.
+        // that we always have at least one frame. The same applies to frames
+        // dropped due to `max_frames`.
         const float cutoff = 1e-3;
         if (fabsf(weight) <= cutoff && img != refimg) {
             PL_TRACE(rr, "   -> Skipping: weight (%f) below threshold (%f)",
@@ -3403,7 +5609,54 @@ retry:
             continue;
         }
 
-        bool skip_cache = single_frame && (params->skip_caching_single_frame || par_info.trivial);
+        if (num_mixed == max_frames) {
+            // Replace the least significant frame, if this one beats it. The
+            // reference image always wins, and is never replaced.
+            int worst = -1;
+            for (int j = 0; j < num_mixed; j++) {
+                const int idx = mixed[j].idx;
+                if (images->frames[idx] == refimg)
+                    continue;
+                if (worst < 0 || fabsf(mixed[j].weight) < fabsf(mixed[worst].weight))
+                    worst = j;
+            }
+
+            if (worst < 0 || (img != refimg &&
+                              fabsf(weight) <= fabsf(mixed[worst].weight)))
+            {
+                PL_TRACE(rr, "   -> Skipping: exceeds mixer frame limit (%d)",
+                         max_frames);
+                continue;
+            }
+
+            PL_TRACE(rr, "   -> Replacing frame with weight %f (frame limit %d)",
+                     mixed[worst].weight, max_frames);
+            // Preserve the order of frames, for deterministic shaders
+            memmove(&mixed[worst], &mixed[worst + 1],
+                    (num_mixed - worst - 1) * sizeof(mixed[0]));
+            num_mixed--;
+        }
+
+        mixed[num_mixed].idx = i;
+        mixed[num_mixed].weight = weight;
+        num_mixed++;
+    }
+
+    for (int n = 0; n < num_mixed; n++) {
+        const int i = mixed[n].idx;
+        const uint64_t sig = images->signatures[i];
+        const struct pl_frame *img = images->frames[i];
+        const float weight = mixed[n].weight;
+        struct cached_frame *f = NULL;
+        for (int j = 0; j < rr->frames.num; j++) {
+            if (rr->frames.elem[j].signature == sig) {
+                f = &rr->frames.elem[j];
+                break;
+            }
+        }
+
+        bool skip_cache = single_frame && !force_cache &&
+                          (params->skip_caching_single_frame || par_info.trivial);
         if (!f && skip_cache) {
             PL_TRACE(rr, "Single frame not found in cache, bypassing");
             goto fallback;
@@ -3491,6 +5744,7 @@ retry:
             pl_assert(inter_pass.img.w == out_w &&
                       inter_pass.img.h == out_h);
 
+            set_ops(&inter_pass, inter_pass.img.ops, f->tex);
             ok = pl_dispatch_finish(rr->dp, pl_dispatch_params(
                 .shader = &inter_pass.img.sh,
                 .target = f->tex,
@@ -3526,6 +5780,7 @@ retry:
             f->color = inter_pass.img.color;
             f->comps = inter_pass.img.comps;
             f->profile = target->profile;
+            f->id = ++rr->frame_id;
             // fall through
 
 inter_pass_error:
@@ -3537,22 +5792,39 @@ inter_pass_error:
 
         pl_assert(fidx < MAX_MIX_FRAMES);
         frames[fidx] = *f;
+        frame_idx[fidx] = i;
         weights[fidx] = weight;
         wsum += weight;
         fidx++;
     }
 
-    // Evict the frames we *don't* need
-    for (int i = 0; i < rr->frames.num; ) {
-        if (rr->frames.elem[i].evict) {
-            PL_TRACE(rr, "Evicting frame with signature %llx from cache",
-                     (unsigned long long) rr->frames.elem[i].signature);
-            PL_ARRAY_APPEND(rr, rr->frame_fbos, rr->frames.elem[i].tex);
-            PL_ARRAY_REMOVE_AT(rr->frames, i);
-            continue;
-        } else {
-            i++;
+    // Evict the frames we *don't* need, least recently used first, while
+    // retaining as many as the frame cache history budget allows
+    const size_t budget = (size_t) PL_MAX(params->frame_cache_memory, 0) << 20;
+    size_t cache_size = 0;
+    for (int i = 0; i < rr->frames.num; i++) {
+        struct cached_frame *f = &rr->frames.elem[i];
+        f->age = f->evict ? f->age + 1 : 0;
+        cache_size += pl_tex_mem_size(f->tex);
+    }
+
+    for (;;) {
+        int lru = -1;
+        for (int i = 0; i < rr->frames.num; i++) {
+            const struct cached_frame *f = &rr->frames.elem[i];
+            if (f->evict && (lru < 0 || f->age > rr->frames.elem[lru].age))
+                lru = i;
         }
+
+        if (lru < 0 || (budget && cache_size <= budget))
+            break;
+
+        struct cached_frame *f = &rr->frames.elem[lru];
+        PL_TRACE(rr, "Evicting frame with signature %llx from cache",
+                 (unsigned long long) f->signature);
+        cache_size -= pl_tex_mem_size(f->tex);
+        PL_ARRAY_APPEND(rr, rr->frame_fbos, f->tex);
+        PL_ARRAY_REMOVE_AT(rr->frames, lru);
     }
 
     // If we got back no frames, retry with ZOH semantics
@@ -3562,13 +5834,40 @@ inter_pass_error:
         goto retry;
     }
 
+    // Skip re-rendering identical output, blitting the previous result instead
+    pl_tex out_tex = target->planes[0].texture;
+    for (int i = 0; i < fidx; i++)
+        weights[i] /= wsum;
+    wsum = 1.0;
+    uint64_t out_hash = mix_output_hash(target, params, par_info.hash, frames,
+                                        weights, fidx);
+    if (out_hash && out_hash == rr->mix_out_hash) {
+        PL_TRACE(rr, "Mixed output unchanged, reusing previous output");
+        pl_tex_blit(rr->gpu, pl_tex_blit_params(
+            .src = rr->mix_out,
+            .dst = out_tex,
+        ));
+        pass_uninit(&pass);
+        return true;
+    }
+    rr->mix_out_hash = 0;
+
     // Sample and mix the output color
     pass_begin_frame(&pass);
     pass.info.count = fidx;
     pl_assert(fidx > 0);
 
+    // Motion compensation only applies if both interpolated frames survived
+    pl_tex vecs = NULL;
+    if (memc_idx >= 0 && fidx == 2 && frame_idx[0] == memc_idx &&
+        frame_idx[1] == memc_idx + 1)
+    {
+        vecs = pass_estimate_motion(&pass, &frames[0], &frames[1]);
+    }
+
     pl_shader sh = pl_dispatch_begin(rr->dp);
-    sh_describef(sh, "frame mixing (%d frame%s)", fidx, fidx > 1 ? "s" : "");
+    sh_describef(sh, "frame mixing (%d frame%s%s)", fidx, fidx > 1 ? "s" : "",
+                 vecs ? ", motion compensated" : "");
     sh->output = PL_SHADER_SIG_COLOR;
     sh->output_w = out_w;
     sh->output_h = out_h;
@@ -3578,6 +5877,19 @@ inter_pass_error:
          "{                             \n"
          "vec4 mix_color = vec4(0.0);   \n");
 
+    if (vecs) {
+        // Fade out the displacement for poorly matching blocks, so that
+        // occlusions and scene changes degrade into ordinary blending
+        const float max_error = PL_DEF(params->motion_params->max_error, 0.05f);
+        enum pl_tex_sample_mode mode = (vecs->params.format->caps & PL_FMT_CAP_LINEAR)
+                                        ? PL_TEX_SAMPLE_LINEAR : PL_TEX_SAMPLE_NEAREST;
+        ident_t pos, tex = sh_bind(sh, vecs, PL_TEX_ADDRESS_CLAMP, mode,
+                                   "motion", NULL, &pos, NULL);
+        GLSL("vec3 mc_vec = textureLod("$", "$", 0.0).xyz;         \n"
+             "mc_vec.xy *= 1.0 - smoothstep("$", "$", mc_vec.z);   \n",
+             tex, pos, SH_FLOAT(0.5f * max_error), SH_FLOAT(max_error));
+    }
+
     int comps = 0;
     for (int i = 0; i < fidx; i++) {
         const struct pl_tex_params *tpars = &frames[i].tex->params;
@@ -3593,7 +5905,14 @@ inter_pass_error:
         ident_t pos, tex = sh_bind(sh, frames[i].tex, PL_TEX_ADDRESS_CLAMP,
                                    sample_mode, "frame", NULL, &pos, NULL);
 
-        GLSL("color = textureLod("$", "$", 0.0); \n", tex, pos);
+        if (vecs) {
+            // Content moves by `mc_vec` from the first to the second frame
+            const float offset = i ? 1.0f - memc_t : -memc_t;
+            GLSL("color = textureLod("$", "$" + vec2("$") * mc_vec.xy, 0.0); \n",
+                 tex, pos, SH_FLOAT_DYN(offset));
+        } else {
+            GLSL("color = textureLod("$", "$", 0.0); \n", tex, pos);
+        }
 
         // Note: This ignores differences in ICC profile, which we decide to
         // just simply not care about. Doing that properly would require
@@ -3619,6 +5938,7 @@ inter_pass_error:
     // Dispatch this to the destination
     pass.img = (struct img) {
         .sh = sh,
+        .ops = OP(MIX),
         .w = out_w,
         .h = out_h,
         .comps = comps,
@@ -3633,6 +5953,24 @@ inter_pass_error:
     if (!pass_output_target(&pass))
         goto fallback;
 
+    if (out_hash) {
+        bool ok = pl_tex_recreate(rr->gpu, &rr->mix_out, pl_tex_params(
+            .w          = out_tex->params.w,
+            .h          = out_tex->params.h,
+            .format     = out_tex->params.format,
+            .blit_src   = true,
+            .blit_dst   = true,
+        ));
+
+        if (ok) {
+            pl_tex_blit(rr->gpu, pl_tex_blit_params(
+                .src = out_tex,
+                .dst = rr->mix_out,
+            ));
+            rr->mix_out_hash = out_hash;
+        }
+    }
+
     pass_uninit(&pass);
     return true;
 
@@ -3643,12 +5981,125 @@ fail:
 
 fallback:
     pass_uninit(&pass);
-    return pl_render_image(rr, refimg, ptarget, params);
+    return render_image(rr, refimg, ptarget, params);
 
 error: // for parameter validation failures
     return false;
 }
 
+bool pl_render_image_mix(pl_renderer rr, const struct pl_frame_mix *images,
+                         const struct pl_frame *ptarget,
+                         const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    if (!images->num_frames)
+        return render_image(rr, NULL, ptarget, params);
+
+    return render_image_mix(rr, images, ptarget, params, false);
+}
+
+// Arbitrary signatures used for the prewarm frame mix, chosen to be unlikely
+// to collide with real frames
+static const uint64_t prewarm_sigs[] = {
+    0x70726577617231ULL, 0x70726577617232ULL,
+};
+
+// Drop the frames added to the mixing cache by `pl_renderer_prewarm`
+static void prewarm_drop_frames(pl_renderer rr)
+{
+    for (int i = 0; i < rr->frames.num; ) {
+        uint64_t sig = rr->frames.elem[i].signature;
+        if (sig == prewarm_sigs[0] || sig == prewarm_sigs[1]) {
+            PL_ARRAY_APPEND(rr, rr->frame_fbos, rr->frames.elem[i].tex);
+            PL_ARRAY_REMOVE_AT(rr->frames, i);
+        } else {
+            i++;
+        }
+    }
+}
+
+bool pl_renderer_prewarm(pl_renderer rr, const struct pl_frame *image,
+                         const struct pl_frame *target,
+                         const struct pl_render_params *params)
+{
+    params = PL_DEF(params, &pl_render_default_params);
+    pl_gpu gpu = rr->gpu;
+    bool was_async = pl_dispatch_is_async(rr->dp);
+    bool ok = false;
+
+    // Render into scratch copies of the target planes, so the contents of
+    // the user's target remain untouched
+    pl_tex scratch[PL_MAX_PLANES] = {0};
+    struct pl_frame dummy = *target;
+    for (int i = 0; i < target->num_planes; i++) {
+        pl_tex tex = target->planes[i].texture;
+        if (!tex) {
+            PL_ERR(rr, "Prewarm target plane %d has no texture!", i);
+            goto error;
+        }
+
+        scratch[i] = pl_tex_create(gpu, pl_tex_params(
+            .w          = tex->params.w,
+            .h          = tex->params.h,
+            .d          = tex->params.d,
+            .format     = tex->params.format,
+            .sampleable = tex->params.sampleable,
+            .renderable = tex->params.renderable,
+            .storable   = tex->params.storable,
+            .blit_src   = tex->params.blit_src,
+            .blit_dst   = tex->params.blit_dst,
+        ));
+
+        if (!scratch[i]) {
+            PL_ERR(rr, "Failed creating scratch texture for prewarming!");
+            goto error;
+        }
+
+        dummy.planes[i].texture = scratch[i];
+    }
+
+    // If the driver compiles passes in the background, first issue all of
+    // them without waiting on any (skipping their execution), so they get
+    // compiled in parallel. The second round then renders for real.
+    int rounds = pl_gpu_compiles_async(gpu) && !was_async ? 2 : 1;
+
+    pl_clock_t start = pl_clock_now();
+    for (int n = 0; n < rounds; n++) {
+        pl_dispatch_async(rr->dp, was_async || n + 1 < rounds);
+        prewarm_drop_frames(rr);
+        if (!pl_render_image(rr, image, &dummy, params))
+            goto error;
+
+        if (params->frame_mixer) {
+            // Two frames straddling the vsync, so both end up with nonzero weight
+            const struct pl_frame_mix mix = {
+                .num_frames     = 2,
+                .frames         = (const struct pl_frame *[]) { image, image },
+                .signatures     = prewarm_sigs,
+                .timestamps     = (float[]) { -0.25f, 0.75f },
+                .vsync_duration = 1.0f,
+            };
+
+            if (!pl_render_image_mix(rr, &mix, &dummy, params))
+                goto error;
+        }
+    }
+
+    pl_log_cpu_time(rr->log, start, pl_clock_now(), "prewarming renderer");
+    ok = true;
+    // fall through
+
+error:
+    // Drop the frames we added to the mixing cache, and any peak detection
+    // state derived from the template image
+    pl_dispatch_async(rr->dp, was_async);
+    prewarm_drop_frames(rr);
+    pl_reset_detected_peak(rr->tone_map_state);
+    for (int i = 0; i < PL_ARRAY_SIZE(scratch); i++)
+        pl_tex_destroy(gpu, &scratch[i]);
+    return ok;
+}
+
 void pl_frames_infer_mix(pl_renderer rr, const struct pl_frame_mix *mix,
                          struct pl_frame *target, struct pl_frame *out_ref)
 {
@@ -3762,6 +6213,41 @@ void pl_frame_clear_rgba(pl_gpu gpu, const struct pl_frame *frame,
     }
 }
 
+const char *pl_render_op_name(enum pl_render_op op)
+{
+    switch (op) {
+    case PL_RENDER_OP_READ:     return "read";
+    case PL_RENDER_OP_DEBAND:   return "deband";
+    case PL_RENDER_OP_GRAIN:    return "grain";
+    case PL_RENDER_OP_HOOK:     return "hook";
+    case PL_RENDER_OP_SCALE:    return "scale";
+    case PL_RENDER_OP_COLOR:    return "color";
+    case PL_RENDER_OP_DITHER:   return "dither";
+    case PL_RENDER_OP_OUTPUT:   return "output";
+    case PL_RENDER_OP_OVERLAY:  return "overlay";
+    case PL_RENDER_OP_MIX:      return "mix";
+    case PL_RENDER_OP_COUNT:    break;
+    }
+
+    pl_unreachable();
+}
+
+int pl_renderer_get_info(pl_renderer rr, const struct pl_render_info **out)
+{
+    *out = rr->frame_info.elem;
+    return rr->frame_info.num;
+}
+
+bool pl_renderer_get_frame_stats(pl_renderer rr,
+                                 struct pl_render_frame_stats *out)
+{
+    if (!rr->have_stats)
+        return false;
+
+    *out = rr->frame_stats;
+    return true;
+}
+
 struct pl_render_errors pl_renderer_get_errors(pl_renderer rr)
 {
     return (struct pl_render_errors) {
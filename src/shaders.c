@@ -47,6 +47,7 @@ static struct sh_info *sh_info_alloc(void *alloc)
 {
     struct sh_info *info = pl_zalloc_ptr(alloc, info);
     info->tmp = pl_tmp(info);
+    info->arena = pl_arena_init(info);
     pl_rc_init(&info->rc);
     return info;
 }
@@ -59,6 +60,7 @@ static struct sh_info *sh_info_recycle(struct sh_info *info)
 
     memset(&info->info, 0, sizeof(info->info)); // reset public fields
     pl_free_children(info->tmp);
+    pl_arena_reset(&info->arena);
     pl_rc_ref(&info->rc);
     info->desc.len = 0;
     info->steps.num = 0;
@@ -104,6 +106,7 @@ pl_shader pl_shader_alloc(pl_log log, const struct pl_shader_params *params)
         .log        = log,
         .tmp        = pl_tmp(sh),
         .info       = sh_info_alloc(NULL),
+        .data       = pl_arena_init(sh),
         .mutable    = true,
     };
 
@@ -119,6 +122,7 @@ static void sh_obj_deref(pl_shader_obj obj);
 void sh_deref(pl_shader sh)
 {
     pl_free_children(sh->tmp);
+    pl_arena_reset(&sh->data);
 
     for (int i = 0; i < sh->obj.num; i++)
         sh_obj_deref(sh->obj.elem[i]);
@@ -144,7 +148,7 @@ void pl_shader_reset(pl_shader sh, const struct pl_shader_params *params)
         .log            = sh->log,
         .tmp            = sh->tmp,
         .info           = sh_info_recycle(sh->info),
-        .data.buf       = sh->data.buf,
+        .data           = sh->data,
         .mutable        = true,
 
         // Preserve array allocations
@@ -164,35 +168,14 @@ void pl_shader_reset(pl_shader sh, const struct pl_shader_params *params)
     init_shader(sh, params);
 }
 
-static void *sh_alloc(pl_shader sh, size_t size, size_t align)
+static inline void *sh_alloc(pl_shader sh, size_t size, size_t align)
 {
-    const size_t offset = PL_ALIGN2(sh->data.len, align);
-    const size_t req_size = offset + size;
-    if (req_size <= pl_get_size(sh->data.buf)) {
-        sh->data.len = offset + size;
-        return sh->data.buf + offset;
-    }
-
-    // We can't realloc this buffer because various pointers will be left
-    // dangling, so just reparent it onto `sh->tmp` (so it will be cleaned
-    // up when the shader is next reset) and allocate a new, larger buffer
-    // in its place
-    const size_t new_size = PL_MAX(req_size << 1, 256);
-    pl_steal(sh->tmp, sh->data.buf);
-    sh->data.buf = pl_alloc(sh, new_size);
-    sh->data.len = size;
-    return sh->data.buf;
+    return pl_arena_alloc(&sh->data, size, align);
 }
 
-static void *sh_memdup(pl_shader sh, const void *data, size_t size, size_t align)
+static inline void *sh_memdup(pl_shader sh, const void *data, size_t size, size_t align)
 {
-    if (!size)
-        return NULL;
-
-    void *dst = sh_alloc(sh, size, align);
-    assert(data);
-    memcpy(dst, data, size);
-    return dst;
+    return pl_arena_memdup(&sh->data, data, size, align);
 }
 
 bool pl_shader_is_failed(const pl_shader sh)
@@ -249,6 +232,16 @@ bool sh_try_compute(pl_shader sh, int bw, int bh, bool flex, size_t mem)
         }
     }
 
+    // Fully populated subgroups constrain the resulting group width
+    const int align = sh_group_align(sh);
+    if (align > 1 && sh->flexible_work_groups &&
+        (flex ? PL_MAX(*sh_bw, bw) : bw) % align)
+    {
+        PL_TRACE(sh, "Disabling compute shader due to group width %d not "
+                 "being a multiple of the subgroup size %d", bw, align);
+        return false;
+    }
+
     sh->shmem += mem;
 
     // If the current shader is either not a compute shader, or we have no
@@ -284,6 +277,52 @@ bool sh_try_compute(pl_shader sh, int bw, int bh, bool flex, size_t mem)
     return true;
 }
 
+bool sh_try_subgroups(pl_shader sh, uint32_t size, bool full)
+{
+    if (!size && !full)
+        return true;
+
+    struct pl_glsl_version glsl = sh_glsl(sh);
+    if (sh->type != SH_COMPUTE || !glsl.max_subgroup_size) {
+        PL_TRACE(sh, "Subgroup size control requires a compute shader and "
+                 "`glsl.max_subgroup_size`");
+        return false;
+    }
+
+    if (size && (!PL_ISPOT(size) || size < glsl.min_subgroup_size ||
+                 size > glsl.max_subgroup_size))
+    {
+        PL_TRACE(sh, "Unsupported subgroup size %"PRIu32, size);
+        return false;
+    }
+
+    if (size && sh->subgroup_size && size != sh->subgroup_size) {
+        PL_TRACE(sh, "Incompatible subgroup sizes %"PRIu32" and %"PRIu32,
+                 sh->subgroup_size, size);
+        return false;
+    }
+
+    const uint32_t new_size = PL_DEF(size, sh->subgroup_size);
+    const bool new_full = full || sh->full_subgroups;
+    const uint32_t align = new_full ? PL_DEF(new_size, glsl.max_subgroup_size) : 1;
+    if (sh->group_size[0] % align) {
+        PL_TRACE(sh, "Group width %d is not a multiple of the subgroup size "
+                 "%"PRIu32, sh->group_size[0], align);
+        return false;
+    }
+
+    sh->subgroup_size = new_size;
+    sh->full_subgroups = new_full;
+    return true;
+}
+
+int sh_group_align(const pl_shader sh)
+{
+    if (!sh->full_subgroups)
+        return 1;
+    return PL_DEF(sh->subgroup_size, sh_glsl(sh).max_subgroup_size);
+}
+
 bool pl_shader_is_compute(const pl_shader sh)
 {
     return sh->type == SH_COMPUTE;
@@ -620,7 +659,7 @@ void sh_describef(pl_shader sh, const char *fmt, ...)
 {
     va_list ap;
     va_start(ap, fmt);
-    sh_describe(sh, pl_vasprintf(sh->info->tmp, fmt, ap));
+    sh_describe(sh, pl_arena_vasprintf(&sh->info->arena, fmt, ap));
     va_end(ap);
 }
 
@@ -677,6 +716,12 @@ ident_t sh_subpass(pl_shader sh, pl_shader sub)
                      "exceeded shared memory resource capabilities");
             return NULL_IDENT;
         }
+
+        if (!sh_try_subgroups(sh, sub->subgroup_size, sub->full_subgroups)) {
+            PL_TRACE(sh, "Can't merge shaders: incompatible subgroup "
+                     "requirements");
+            return NULL_IDENT;
+        }
     }
 
     sh->output_w = res_w;
@@ -714,10 +759,8 @@ ident_t sh_subpass(pl_shader sh, pl_shader sub)
 #undef ARRAY_STEAL
 
     // Steal the scratch buffer (if it holds data)
-    if (sub->data.len) {
-        pl_steal(sh->tmp, sub->data.buf);
-        sub->data = (pl_str) {0};
-    }
+    if (sub->data.len)
+        pl_arena_steal(&sh->data, &sub->data);
 
     // Steal all temporary allocations and mark the child as unusable
     pl_steal(sh->tmp, sub->tmp);
@@ -727,8 +770,10 @@ ident_t sh_subpass(pl_shader sh, pl_shader sub)
     // Steal the shader steps array (and allocations)
     pl_assert(pl_rc_count(&sub->info->rc) == 1);
     PL_ARRAY_CONCAT(sh->info, sh->info->steps, sub->info->steps);
+    sh->info->info.lut_bytes += sub->info->info.lut_bytes;
     pl_steal(sh->info->tmp, sub->info->tmp);
     sub->info->tmp = pl_tmp(sub->info);
+    pl_arena_steal(&sh->info->arena, &sub->info->arena);
     sub->info->steps.num = 0; // sanity
 
     return sub->name;
@@ -921,6 +966,11 @@ void pl_shader_obj_destroy(pl_shader_obj *ptr)
     *ptr = NULL;
 }
 
+size_t sh_obj_mem_usage(pl_shader_obj obj)
+{
+    return obj && obj->mem_usage ? obj->mem_usage(obj->priv) : 0;
+}
+
 void *sh_require_obj(pl_shader sh, pl_shader_obj *ptr,
                      enum pl_shader_obj_type type, size_t priv_size,
                      void (*uninit)(pl_gpu gpu, void *priv))
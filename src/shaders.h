@@ -35,7 +35,7 @@ typedef unsigned short ident_t;
 #define NULL_IDENT  0u
 
 #define sh_mkident(id, name) ((ident_t) id)
-#define sh_ident_tostr(id)   pl_asprintf(sh->tmp, $, id)
+#define sh_ident_tostr(id)   pl_arena_asprintf(&sh->data, $, id)
 
 enum {
     IDENT_BITS     = 8 * sizeof(ident_t),
@@ -77,6 +77,7 @@ struct sh_info {
 
     // internal fields
     void *tmp;
+    pl_arena arena; // for step descriptions
     pl_rc_t rc;
     pl_str desc;
     PL_ARRAY(const char *) steps;
@@ -86,7 +87,7 @@ struct pl_shader_t {
     pl_log log;
     void *tmp; // temporary allocations (freed on pl_shader_reset)
     struct sh_info *info;
-    pl_str data; // pooled/recycled scratch buffer for small allocations
+    pl_arena data; // small allocations (rewound on pl_shader_reset)
     PL_ARRAY(pl_shader_obj) obj;
     bool failed;
     bool mutable;
@@ -100,6 +101,8 @@ struct pl_shader_t {
     bool flexible_work_groups;
     int group_size[2];
     size_t shmem;
+    uint32_t subgroup_size; // required subgroup size, or 0
+    bool full_subgroups;
     enum pl_sampler_type sampler_type;
     char sampler_prefix;
     unsigned short prefix; // pre-processed version of res.params.id
@@ -143,6 +146,20 @@ struct pl_glsl_version sh_glsl(const pl_shader sh);
 // Attempt enabling compute shaders for this pass, if possible
 bool sh_try_compute(pl_shader sh, int bw, int bh, bool flex, size_t mem);
 
+// Attempt requiring a specific subgroup size (or 0 for any) and/or fully
+// populated subgroups for this compute shader. Must be called after
+// `sh_try_compute`. Returns false if unsupported or incompatible with the
+// current requirements and group size, in which case nothing is changed.
+//
+// Note: Without an explicit size, the actual subgroup size of a compute
+// shader may differ from `glsl.subgroup_size`. Code relying on the two being
+// equal must request it.
+bool sh_try_subgroups(pl_shader sh, uint32_t size, bool full);
+
+// Returns the multiple the work group width is constrained to by
+// `sh_try_subgroups`, or 1 if unconstrained.
+int sh_group_align(const pl_shader sh);
+
 // Attempt merging a secondary shader into the current shader. Returns NULL if
 // merging fails (e.g. incompatible signatures); otherwise returns an identifier
 // corresponding to the generated subpass function.
@@ -260,8 +277,16 @@ struct pl_shader_obj_t {
     pl_gpu gpu;
     void (*uninit)(pl_gpu gpu, void *priv);
     void *priv;
+
+    // Optional, returns the amount of GPU memory (in bytes) held by `priv`,
+    // including any nested shader objects
+    size_t (*mem_usage)(const void *priv);
 };
 
+// Returns the GPU memory held by a shader object, or 0 for NULL objects and
+// objects that do not implement `mem_usage`
+size_t sh_obj_mem_usage(pl_shader_obj obj);
+
 // Returns (*ptr)->priv, or NULL on failure
 void *sh_require_obj(pl_shader sh, pl_shader_obj *ptr,
                      enum pl_shader_obj_type type, size_t priv_size,
@@ -322,6 +347,10 @@ struct sh_lut_params {
 
     // Alternate way of triggering shader invalidations. If the signature
     // does not match the LUT's signature, it will be regenerated.
+    //
+    // Note: Static (non-`dynamic`) texture LUTs with the same signature,
+    // dimensions and format share a single texture per `pl_gpu`, so a nonzero
+    // signature must uniquely identify the LUT contents.
     uint64_t signature;
 
     // If set to true, shader objects will be preserved and updated in-place
@@ -340,6 +369,17 @@ struct sh_lut_params {
     void (*fill)(void *data, const struct sh_lut_params *params);
     void *priv;
 
+    // If true, and a previously generated LUT with the same dimensions and
+    // type exists, `fill` is instead called on a background thread. The
+    // previous LUT keeps being used until the new contents are ready, at
+    // which point they are swapped in by a later call. Requires `signature`.
+    //
+    // Note: If `priv_size` is set, `fill` receives a private copy of the
+    // first `priv_size` bytes of `priv` instead. Otherwise, `priv` must stay
+    // valid for the lifetime of the LUT object.
+    bool async;
+    size_t priv_size;
+
     // Debug tag to track LUT source
     pl_debug_tag debug_tag;
 };
@@ -385,3 +425,14 @@ static inline const char *sh_swizzle(uint8_t mask)
     pl_assert(mask <= PL_ARRAY_SIZE(swizzles));
     return swizzles[mask];
 }
+
+// Precision qualifier (including trailing space) for intermediate values that
+// may safely be computed at reduced precision, or "" if this is not enabled
+static inline const char *sh_mediump(const pl_shader sh)
+{
+    if (!SH_PARAMS(sh).relaxed_precision)
+        return "";
+
+    const struct pl_glsl_version glsl = sh_glsl(sh);
+    return (glsl.gles || glsl.version >= 130) ? "mediump " : "";
+}
@@ -19,6 +19,7 @@
 
 #include "cache.h"
 #include "shaders.h"
+#include "tone_mapping.h"
 
 #include <libplacebo/shaders/colorspace.h>
 
@@ -287,6 +288,139 @@ void pl_shader_dovi_reshape(pl_shader sh, const struct pl_dovi_metadata *data)
 #endif
 }
 
+#ifdef PL_HAVE_DOVI
+// CPU equivalent of the per-pixel reshaping performed above, for component `c`
+static float reshape_comp(const struct pl_reshape_data *comp, const float sig[3],
+                          int c)
+{
+    if (!comp->num_pivots)
+        return sig[c];
+
+    float s = sig[c];
+    int i = 0;
+    while (i < comp->num_pivots - 2 && s >= comp->pivots[i + 1])
+        i++;
+
+    switch (comp->method[i]) {
+    case 0: // polynomial
+        s = (comp->poly_coeffs[i][2] * s + comp->poly_coeffs[i][1]) * s +
+            comp->poly_coeffs[i][0];
+        break;
+
+    case 1: {
+        const float sigX[4] = {
+            sig[0] * sig[1], sig[0] * sig[2], sig[1] * sig[2],
+            sig[0] * sig[1] * sig[2],
+        };
+
+        float p[3] = { sig[0], sig[1], sig[2] };
+        float pX[4] = { sigX[0], sigX[1], sigX[2], sigX[3] };
+        s = comp->mmr_constant[i];
+        for (int j = 0; j < comp->mmr_order[i]; j++) {
+            const float *w = comp->mmr_coeffs[i][j];
+            s += w[0] * p[0] + w[1] * p[1] + w[2] * p[2];
+            s += w[3] * pX[0] + w[4] * pX[1] + w[5] * pX[2] + w[6] * pX[3];
+            for (int k = 0; k < 3; k++)
+                p[k] *= sig[k];
+            for (int k = 0; k < 4; k++)
+                pX[k] *= sigX[k];
+        }
+        break;
+    }
+
+    default:
+        pl_unreachable();
+    }
+
+    return PL_CLAMP(s, comp->pivots[0], comp->pivots[comp->num_pivots - 1]);
+}
+
+static void fill_reshape_lut(void *data, const struct sh_lut_params *params)
+{
+    const struct pl_dovi_metadata *dovi = params->priv;
+    const int w = params->width, h = PL_DEF(params->height, 1),
+              d = PL_DEF(params->depth, 1);
+    float *out = data;
+
+    for (int z = 0; z < d; z++) {
+        for (int y = 0; y < h; y++) {
+            for (int x = 0; x < w; x++) {
+                const float fx = x / (w - 1.0f);
+                const float sig[3] = {
+                    fx,
+                    h > 1 ? y / (h - 1.0f) : fx,
+                    d > 1 ? z / (d - 1.0f) : fx,
+                };
+                for (int c = 0; c < 3; c++)
+                    *out++ = reshape_comp(&dovi->comp[c], sig, c);
+                *out++ = 0.0f; // unused
+            }
+        }
+    }
+}
+#endif
+
+#define DOVI_LUT_1D_SIZE 1024
+#define DOVI_LUT_3D_SIZE 33
+
+void pl_shader_dovi_reshape_lut(pl_shader sh, const struct pl_dovi_metadata *data,
+                                int lut_size, pl_shader_obj *state)
+{
+#ifdef PL_HAVE_DOVI
+    if (!sh_require(sh, PL_SHADER_SIG_COLOR, 0, 0) || !data)
+        return;
+
+    // MMR reshaping mixes all three components, so it can only be represented
+    // as a 3D LUT. Otherwise, each component can be reshaped independently.
+    bool has_mmr = false;
+    for (int c = 0; c < 3; c++) {
+        const struct pl_reshape_data *comp = &data->comp[c];
+        for (int i = 0; i < comp->num_pivots - 1; i++)
+            has_mmr |= comp->method[i] == 1;
+    }
+
+    lut_size = has_mmr ? PL_DEF(lut_size, DOVI_LUT_3D_SIZE) : DOVI_LUT_1D_SIZE;
+    uint64_t sig = pl_mem_hash(data->comp, sizeof(data->comp));
+    pl_hash_merge(&sig, lut_size);
+    pl_hash_merge(&sig, has_mmr);
+
+    ident_t lut = sh_lut(sh, sh_lut_params(
+        .object     = state,
+        .var_type   = PL_VAR_FLOAT,
+        .lut_type   = has_mmr ? SH_LUT_TEXTURE : SH_LUT_AUTO,
+        .method     = SH_LUT_LINEAR,
+        .width      = lut_size,
+        .height     = has_mmr ? lut_size : 0,
+        .depth      = has_mmr ? lut_size : 0,
+        .comps      = 4,
+        .signature  = sig,
+        .cache      = SH_CACHE(sh),
+        .fill       = fill_reshape_lut,
+        .priv       = (void *) data,
+    ));
+    if (!lut) {
+        SH_FAIL(sh, "Failed generating reshaping LUT!");
+        return;
+    }
+
+    sh_describe(sh, "reshaping (LUT)");
+    GLSL("// pl_shader_reshape_lut                 \n"
+         "{                                        \n"
+         "vec3 sig = clamp(color.rgb, 0.0, 1.0);   \n");
+    if (has_mmr) {
+        GLSL("color.rgb = "$"(sig).rgb; \n", lut);
+    } else {
+        GLSL("color.r = "$"(sig.r).r; \n"
+             "color.g = "$"(sig.g).g; \n"
+             "color.b = "$"(sig.b).b; \n",
+             lut, lut, lut);
+    }
+    GLSL("} \n");
+#else
+    SH_FAIL(sh, "libplacebo was compiled without support for dolbyvision reshaping");
+#endif
+}
+
 void pl_shader_decode_color(pl_shader sh, struct pl_color_repr *repr,
                             const struct pl_color_adjustment *params)
 {
@@ -943,7 +1077,10 @@ static bool peak_detect_params_eq(const struct pl_peak_detect_params *a,
     return a->smoothing_period     == b->smoothing_period     &&
            a->scene_threshold_low  == b->scene_threshold_low  &&
            a->scene_threshold_high == b->scene_threshold_high &&
-           a->percentile           == b->percentile;
+           a->percentile           == b->percentile           &&
+           a->downsample           == b->downsample           &&
+           a->detect_interval      == b->detect_interval      &&
+           a->gpu_resident         == b->gpu_resident;
     // don't compare `allow_delayed` because it doesn't change measurement
 }
 
@@ -969,10 +1106,19 @@ enum {
 
     // Convert from histogram bin to (starting) PQ value
 #define HIST_PQ(bin) (((bin) + HIST_BIAS) << (PQ_BITS - HIST_BITS))
+
+    // Number of persistent peak detection buffers to cycle through. This
+    // bounds how many frames the readback may lag behind when using
+    // `allow_delayed`, before blocking on the oldest result.
+    PEAK_BUFS   = 4,
+
+    // Number of raw per-frame results retained for `pl_get_detected_peak_frame`
+    PEAK_FRAMES = 16,
 };
 
 
 pl_static_assert(PQ_BITS >= HIST_BITS);
+pl_static_assert(HIST_BINS == PL_PEAK_HIST_BINS);
 
 struct peak_buf_data {
     unsigned frame_wg_count[SLICES]; // number of work groups processed
@@ -1006,6 +1152,37 @@ static const struct pl_buffer_var peak_buf_vars[] = {
 #undef VAR
 };
 
+// Smoothed peak detection results, kept on the GPU for `gpu_resident`
+struct peak_state_data {
+    float avg_pq;       // current (smoothed) values, or 0 if no data
+    float max_pq;
+    unsigned wg_done;   // number of work groups finished in this frame
+};
+
+static const struct pl_buffer_var peak_state_vars[] = {
+#define VAR(field, vtype) {                                                     \
+    .var = {                                                                    \
+        .name = "peak_" #field,                                                 \
+        .type = vtype,                                                          \
+        .dim_v = 1,                                                             \
+        .dim_m = 1,                                                             \
+        .dim_a = 1,                                                             \
+    },                                                                          \
+    .layout = {                                                                 \
+        .offset = offsetof(struct peak_state_data, field),                      \
+        .size   = sizeof(((struct peak_state_data *) NULL)->field),             \
+        .stride = sizeof(((struct peak_state_data *) NULL)->field),             \
+    },                                                                          \
+}
+    VAR(avg_pq,  PL_VAR_FLOAT),
+    VAR(max_pq,  PL_VAR_FLOAT),
+    VAR(wg_done, PL_VAR_UINT),
+#undef VAR
+};
+
+// Only the smoothed values are needed for reading the results
+#define PEAK_STATE_VARS_READ 2
+
 struct sh_color_map_obj {
     // Tone map state
     struct {
@@ -1021,15 +1198,29 @@ struct sh_color_map_obj {
     // Peak detection state
     struct {
         struct pl_peak_detect_params params;    // currently active parameters
-        pl_buf buf;                             // pending peak detection buffer
+        struct {
+            pl_buf buf;                         // persistent peak detection SSBO
+            bool cheap;                         // holds a cheap measurement
+            uint64_t index;                     // sequence number of measurement
+        } bufs[PEAK_BUFS];
+        int idx;                                // index of the oldest pending buf
+        int pending;                            // number of pending bufs
         pl_buf readback;                        // readback buffer (fallback)
+        pl_buf gpu_buf;                         // accumulators for `gpu_resident`
+        pl_buf state;                           // results for `gpu_resident`
+        int frames_left;                        // until the next full measurement
         float avg_pq;                           // current (smoothed) values
         float max_pq;
+        uint64_t counter;                       // next sequence number
+        struct pl_peak_detect_frame frames[PEAK_FRAMES]; // raw results
+        int frames_idx;                         // index of the oldest result
+        int num_frames;
     } peak;
 };
 
 // Excluding size, since this is checked by sh_lut
-static uint64_t gamut_map_signature(const struct pl_gamut_map_params *par)
+static uint64_t gamut_map_signature(const struct pl_gamut_map_params *par,
+                                    pl_fmt fmt)
 {
     uint64_t sig = CACHE_KEY_GAMUT_LUT;
     pl_hash_merge(&sig, pl_str0_hash(par->function->name));
@@ -1038,19 +1229,58 @@ static uint64_t gamut_map_signature(const struct pl_gamut_map_params *par)
     pl_hash_merge(&sig, pl_var_hash(par->min_luma));
     pl_hash_merge(&sig, pl_var_hash(par->max_luma));
     pl_hash_merge(&sig, pl_var_hash(par->constants));
+    pl_hash_merge(&sig, par->lut_size_I);
+    pl_hash_merge(&sig, par->lut_size_C);
+    pl_hash_merge(&sig, par->lut_size_h);
+    pl_hash_merge(&sig, fmt->texel_size);
     return sig;
 }
 
+static float primaries_dist(const struct pl_raw_primaries *a,
+                            const struct pl_raw_primaries *b)
+{
+    return fmaxf(fmaxf(hypotf(a->red.x   - b->red.x,   a->red.y   - b->red.y),
+                       hypotf(a->green.x - b->green.x, a->green.y - b->green.y)),
+                 hypotf(a->blue.x - b->blue.x, a->blue.y - b->blue.y));
+}
+
+// Shrinks the gamut mapping 3DLUT based on how far apart the source and
+// target gamuts are, relative to the distance between BT.2020 and BT.709
+static void gamut_lut_adapt(struct pl_gamut_map_params *gamut)
+{
+    const float ref = primaries_dist(pl_raw_primaries_get(PL_COLOR_PRIM_BT_2020),
+                                     pl_raw_primaries_get(PL_COLOR_PRIM_BT_709));
+    float scale = primaries_dist(&gamut->input_gamut, &gamut->output_gamut) / ref;
+    scale = PL_CLAMP(scale, 0.25f, 1.0f);
+    gamut->lut_size_C = PL_MAX(lrintf(gamut->lut_size_C * scale), 2);
+    gamut->lut_size_h = PL_MAX(lrintf(gamut->lut_size_h * scale), 2);
+}
+
 static void sh_color_map_uninit(pl_gpu gpu, void *ptr)
 {
     struct sh_color_map_obj *obj = ptr;
     pl_shader_obj_destroy(&obj->tone.lut);
     pl_shader_obj_destroy(&obj->gamut.lut);
-    pl_buf_destroy(gpu, &obj->peak.buf);
+    for (int i = 0; i < PEAK_BUFS; i++)
+        pl_buf_destroy(gpu, &obj->peak.bufs[i].buf);
     pl_buf_destroy(gpu, &obj->peak.readback);
+    pl_buf_destroy(gpu, &obj->peak.gpu_buf);
+    pl_buf_destroy(gpu, &obj->peak.state);
     memset(obj, 0, sizeof(*obj));
 }
 
+static size_t sh_color_map_mem_usage(const void *ptr)
+{
+    const struct sh_color_map_obj *obj = ptr;
+    size_t total = sh_obj_mem_usage(obj->tone.lut) + sh_obj_mem_usage(obj->gamut.lut);
+    for (int i = 0; i < PEAK_BUFS; i++)
+        total += obj->peak.bufs[i].buf ? obj->peak.bufs[i].buf->params.size : 0;
+    total += obj->peak.readback ? obj->peak.readback->params.size : 0;
+    total += obj->peak.gpu_buf ? obj->peak.gpu_buf->params.size : 0;
+    total += obj->peak.state ? obj->peak.state->params.size : 0;
+    return total;
+}
+
 static inline float iir_coeff(float rate)
 {
     if (!rate)
@@ -1058,12 +1288,17 @@ static inline float iir_coeff(float rate)
     return 1.0f - expf(-1.0f / rate);
 }
 
-static float measure_peak(const struct peak_buf_data *data, float percentile)
+static float measure_max(const struct peak_buf_data *data)
 {
     unsigned frame_max_pq = data->frame_max_pq[0];
     for (int k = 1; k < SLICES; k++)
         frame_max_pq = PL_MAX(frame_max_pq, data->frame_max_pq[k]);
-    const float frame_max = (float) frame_max_pq / PQ_MAX;
+    return (float) frame_max_pq / PQ_MAX;
+}
+
+static float measure_peak(const struct peak_buf_data *data, float percentile)
+{
+    const float frame_max = measure_max(data);
     if (percentile <= 0 || percentile >= 100)
         return frame_max;
     unsigned total_pixels = 0;
@@ -1109,57 +1344,71 @@ static float measure_peak(const struct peak_buf_data *data, float percentile)
     pl_unreachable();
 }
 
-// if `force` is true, ensures the buffer is read, even if `allow_delayed`
-static void update_peak_buf(pl_gpu gpu, struct sh_color_map_obj *obj, bool force)
+static void push_peak_frame(struct sh_color_map_obj *obj,
+                            const struct pl_peak_detect_frame *frame)
 {
-    const struct pl_peak_detect_params *params = &obj->peak.params;
-    if (!obj->peak.buf)
-        return;
-
-    if (!force && params->allow_delayed && pl_buf_poll(gpu, obj->peak.buf, 0))
-        return; // buffer not ready yet
-
-    bool ok;
-    struct peak_buf_data data = {0};
-    if (obj->peak.readback) {
-        pl_buf_copy(gpu, obj->peak.readback, 0, obj->peak.buf, 0, sizeof(data));
-        ok = pl_buf_read(gpu, obj->peak.readback, 0, &data, sizeof(data));
+    const int idx = (obj->peak.frames_idx + obj->peak.num_frames) % PEAK_FRAMES;
+    if (obj->peak.num_frames == PEAK_FRAMES) {
+        // Discard the oldest result
+        obj->peak.frames_idx = (obj->peak.frames_idx + 1) % PEAK_FRAMES;
     } else {
-        ok = pl_buf_read(gpu, obj->peak.buf, 0, &data, sizeof(data));
-    }
-    if (ok && data.frame_wg_count[0] > 0) {
-        // Peak detection completed successfully
-        pl_buf_destroy(gpu, &obj->peak.buf);
-    } else {
-        // No data read? Possibly this peak obj has not been executed yet
-        if (!ok) {
-            PL_ERR(gpu, "Failed reading peak detection buffer!");
-        } else if (params->allow_delayed) {
-            PL_TRACE(gpu, "Peak detection buffer not yet ready, ignoring..");
-        } else {
-            PL_WARN(gpu, "Peak detection usage error: attempted detecting peak "
-                    "and using detected peak in the same shader program, "
-                    "but `params->allow_delayed` is false! Ignoring, but "
-                    "expect incorrect output.");
-        }
-        if (force || !ok)
-            pl_buf_destroy(gpu, &obj->peak.buf);
-        return;
+        obj->peak.num_frames++;
     }
+    obj->peak.frames[idx] = *frame;
+}
 
+static void update_peak_data(pl_gpu gpu, struct sh_color_map_obj *obj,
+                             const struct peak_buf_data *data, bool cheap,
+                             uint64_t index)
+{
+    const struct pl_peak_detect_params *params = &obj->peak.params;
     uint64_t frame_sum_pq = 0u, frame_wg_count = 0u, frame_wg_active = 0u;
     for (int k = 0; k < SLICES; k++) {
-        frame_sum_pq    += data.frame_sum_pq[k];
-        frame_wg_count  += data.frame_wg_count[k];
-        frame_wg_active += data.frame_wg_active[k];
+        frame_sum_pq    += data->frame_sum_pq[k];
+        frame_wg_count  += data->frame_wg_count[k];
+        frame_wg_active += data->frame_wg_active[k];
     }
-    float avg_pq, max_pq;
+    float avg_pq, max_pq, frame_max;
     if (frame_wg_active) {
         avg_pq = (float) frame_sum_pq / (frame_wg_active * PQ_MAX);
-        max_pq = measure_peak(&data, params->percentile);
+        max_pq = measure_peak(data, cheap ? 100 : params->percentile);
+        frame_max = measure_max(data);
     } else {
         // Solid black frame
-        avg_pq = max_pq = PL_COLOR_HDR_BLACK;
+        avg_pq = max_pq = frame_max = PL_COLOR_HDR_BLACK;
+    }
+
+    struct pl_peak_detect_frame frame = {
+        .index      = index,
+        .cheap      = cheap,
+        .max_pq_y   = max_pq,
+        .avg_pq_y   = avg_pq,
+        .max_cll    = pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, frame_max),
+        .max_fall   = pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, avg_pq),
+    };
+
+    for (int k = 0; k < SLICES; k++) {
+        for (int i = 0; i < HIST_BINS; i++)
+            frame.histogram[i] += data->frame_hist[k][i];
+    }
+
+    const float log10_pq = 1e-2f; // experimentally determined approximate
+    if (cheap) {
+        // Cheap measurements are only used to detect scene changes, in which
+        // case we adopt them directly and force a full measurement next
+        const float thresh = params->scene_threshold_high * log10_pq;
+        if (obj->peak.avg_pq && thresh > 0 &&
+            (fabsf(avg_pq - obj->peak.avg_pq) > thresh ||
+             fabsf(max_pq - obj->peak.max_pq) > thresh))
+        {
+            PL_TRACE(gpu, "Scene change detected, forcing full peak detection");
+            obj->peak.avg_pq = avg_pq;
+            obj->peak.max_pq = max_pq;
+            obj->peak.frames_left = 0;
+            frame.scene_change = true;
+        }
+        push_peak_frame(obj, &frame);
+        return;
     }
 
     if (!obj->peak.avg_pq) {
@@ -1182,7 +1431,6 @@ static void update_peak_buf(pl_gpu gpu, struct sh_color_map_obj *obj, bool force
 
     // Scene change hysteresis
     if (params->scene_threshold_low > 0 && params->scene_threshold_high > 0) {
-        const float log10_pq = 1e-2f; // experimentally determined approximate
         const float thresh_low = params->scene_threshold_low * log10_pq;
         const float thresh_high = params->scene_threshold_high * log10_pq;
         const float bias = (float) frame_wg_active / frame_wg_count;
@@ -1190,9 +1438,118 @@ static void update_peak_buf(pl_gpu gpu, struct sh_color_map_obj *obj, bool force
         const float mix_coeff = pl_smoothstep(thresh_low, thresh_high, delta);
         obj->peak.avg_pq = PL_MIX(obj->peak.avg_pq, avg_pq, mix_coeff);
         obj->peak.max_pq = PL_MIX(obj->peak.max_pq, max_pq, mix_coeff);
+        frame.scene_change = delta > thresh_high;
+    }
+
+    push_peak_frame(obj, &frame);
+}
+
+static void pop_peak_buf(struct sh_color_map_obj *obj)
+{
+    obj->peak.idx = (obj->peak.idx + 1) % PEAK_BUFS;
+    obj->peak.pending--;
+}
+
+// Reads back pending peak detection buffers in submission order. Buffers
+// beyond the newest `keep` are always read, even if `allow_delayed`. If
+// `poll` is true, this stops at the first unfinished buffer regardless of
+// `allow_delayed`.
+static void update_peak_buf(pl_gpu gpu, struct sh_color_map_obj *obj, int keep,
+                            bool poll)
+{
+    const struct pl_peak_detect_params *params = &obj->peak.params;
+    const bool delayed = params->allow_delayed || poll;
+    while (obj->peak.pending > 0) {
+        const bool force = obj->peak.pending > keep;
+        pl_buf buf = obj->peak.bufs[obj->peak.idx].buf;
+        if (!force && delayed && pl_buf_poll(gpu, buf, 0))
+            return; // buffer not ready yet
+
+        bool ok;
+        struct peak_buf_data data = {0};
+        if (obj->peak.readback) {
+            pl_buf_copy(gpu, obj->peak.readback, 0, buf, 0, sizeof(data));
+            ok = pl_buf_read(gpu, obj->peak.readback, 0, &data, sizeof(data));
+        } else {
+            ok = pl_buf_read(gpu, buf, 0, &data, sizeof(data));
+        }
+
+        if (!ok || !data.frame_wg_count[0]) {
+            // No data read? Possibly this peak obj has not been executed yet
+            if (!ok) {
+                PL_ERR(gpu, "Failed reading peak detection buffer!");
+            } else if (delayed) {
+                PL_TRACE(gpu, "Peak detection buffer not yet ready, ignoring..");
+            } else {
+                PL_WARN(gpu, "Peak detection usage error: attempted detecting peak "
+                        "and using detected peak in the same shader program, "
+                        "but `params->allow_delayed` is false! Ignoring, but "
+                        "expect incorrect output.");
+            }
+            if (!force && ok)
+                return;
+            pop_peak_buf(obj);
+            continue;
+        }
+
+        // Peak detection completed successfully
+        bool cheap = obj->peak.bufs[obj->peak.idx].cheap;
+        uint64_t index = obj->peak.bufs[obj->peak.idx].index;
+        pop_peak_buf(obj);
+        update_peak_data(gpu, obj, &data, cheap, index);
     }
 }
 
+// Creates or clears the persistent buffers used by `gpu_resident`. Once
+// initialized, the detection shader resets the accumulators by itself.
+static bool init_gpu_peak(pl_gpu gpu, struct sh_color_map_obj *obj)
+{
+    static const struct peak_buf_data zero = {0};
+    static const struct peak_state_data zero_state = {0};
+    if (obj->peak.params.gpu_resident)
+        return true;
+
+    if (obj->peak.gpu_buf) {
+        pl_buf_write(gpu, obj->peak.gpu_buf, 0, &zero, sizeof(zero));
+    } else {
+        obj->peak.gpu_buf = pl_buf_create(gpu, pl_buf_params(
+            .size           = sizeof(zero),
+            .memory_type    = PL_BUF_MEM_DEVICE,
+            .host_writable  = true,
+            .storable       = true,
+            .initial_data   = &zero,
+        ));
+    }
+
+    if (obj->peak.state) {
+        pl_buf_write(gpu, obj->peak.state, 0, &zero_state, sizeof(zero_state));
+    } else {
+        obj->peak.state = pl_buf_create(gpu, pl_buf_params(
+            .size           = sizeof(zero_state),
+            .memory_type    = PL_BUF_MEM_DEVICE,
+            .host_writable  = true,
+            .host_readable  = true,
+            .storable       = true,
+            .initial_data   = &zero_state,
+        ));
+    }
+
+    if (!obj->peak.state) {
+        // Only needed for `pl_get_detected_hdr_metadata`, so retry without
+        PL_WARN(gpu, "Failed creating host-readable peak detection state, "
+                "detected metadata will be unavailable to the CPU");
+        obj->peak.state = pl_buf_create(gpu, pl_buf_params(
+            .size           = sizeof(zero_state),
+            .memory_type    = PL_BUF_MEM_DEVICE,
+            .host_writable  = true,
+            .storable       = true,
+            .initial_data   = &zero_state,
+        ));
+    }
+
+    return obj->peak.gpu_buf && obj->peak.state;
+}
+
 bool pl_shader_detect_peak(pl_shader sh, struct pl_color_space csp,
                            pl_shader_obj *state,
                            const struct pl_peak_detect_params *params)
@@ -1209,8 +1566,35 @@ bool pl_shader_detect_peak(pl_shader sh, struct pl_color_space csp,
         return false;
     }
 
-    const bool use_histogram = params->percentile > 0 && params->percentile < 100;
-    size_t shmem_req = 3 * sizeof(uint32_t);
+    struct sh_color_map_obj *obj;
+    obj = SH_OBJ(sh, state, PL_SHADER_OBJ_COLOR_MAP, struct sh_color_map_obj,
+                 sh_color_map_uninit);
+    if (!obj)
+        return false;
+    (*state)->mem_usage = sh_color_map_mem_usage;
+
+    if (peak_detect_params_eq(&obj->peak.params, params)) {
+        // Make sure there is a free buffer for this frame
+        update_peak_buf(gpu, obj, params->allow_delayed ? PEAK_BUFS - 1 : 0, false);
+    } else {
+        pl_reset_detected_peak(*state);
+    }
+
+    // In between full measurements, only measure a cheap approximation
+    bool cheap = false;
+    if (params->detect_interval > 1 && !params->gpu_resident) {
+        if (obj->peak.frames_left > 0 && obj->peak.avg_pq) {
+            obj->peak.frames_left--;
+            cheap = true;
+        } else {
+            obj->peak.frames_left = params->detect_interval - 1;
+        }
+    }
+
+    const bool use_histogram = !cheap && params->percentile > 0 &&
+                               params->percentile < 100;
+    const bool downsample = cheap || params->downsample;
+    size_t shmem_req = (params->gpu_resident ? 4 : 3) * sizeof(uint32_t);
     if (use_histogram)
         shmem_req += sizeof(uint32_t[HIST_BINS]);
 
@@ -1221,39 +1605,47 @@ bool pl_shader_detect_peak(pl_shader sh, struct pl_color_space csp,
         return false;
     }
 
-    struct sh_color_map_obj *obj;
-    obj = SH_OBJ(sh, state, PL_SHADER_OBJ_COLOR_MAP, struct sh_color_map_obj,
-                 sh_color_map_uninit);
-    if (!obj)
-        return false;
-
-    if (peak_detect_params_eq(&obj->peak.params, params)) {
-        update_peak_buf(gpu, obj, true); // prevent over-writing previous frame
-    } else {
-        pl_reset_detected_peak(*state);
+    pl_buf peak_buf;
+    if (params->gpu_resident) {
+        if (!init_gpu_peak(gpu, obj)) {
+            SH_FAIL(sh, "Failed creating peak detection SSBO!");
+            return false;
+        }
+        obj->peak.params = *params;
+        peak_buf = obj->peak.gpu_buf;
+        goto done_bufs;
     }
 
-    pl_assert(!obj->peak.buf);
+    pl_assert(obj->peak.pending < PEAK_BUFS);
+    const int slot = (obj->peak.idx + obj->peak.pending) % PEAK_BUFS;
+    pl_buf *buf = &obj->peak.bufs[slot].buf;
     static const struct peak_buf_data zero = {0};
+    if (*buf) {
+        // Re-use the existing buffer, clearing it on the GPU
+        pl_buf_write(gpu, *buf, 0, &zero, sizeof(zero));
+        goto done_ssbo;
+    }
 
 retry_ssbo:
     if (obj->peak.readback) {
-        obj->peak.buf = pl_buf_create(gpu, pl_buf_params(
+        *buf = pl_buf_create(gpu, pl_buf_params(
             .size           = sizeof(struct peak_buf_data),
+            .host_writable  = true,
             .storable       = true,
             .initial_data   = &zero,
         ));
     } else {
-        obj->peak.buf = pl_buf_create(gpu, pl_buf_params(
+        *buf = pl_buf_create(gpu, pl_buf_params(
             .size           = sizeof(struct peak_buf_data),
             .memory_type    = PL_BUF_MEM_DEVICE,
+            .host_writable  = true,
             .host_readable  = true,
             .storable       = true,
             .initial_data   = &zero,
         ));
     }
 
-    if (!obj->peak.buf && !obj->peak.readback) {
+    if (!*buf && !obj->peak.readback) {
         PL_WARN(sh, "Failed creating host-readable peak detection SSBO, "
                 "retrying with fallback buffer");
         obj->peak.readback = pl_buf_create(gpu, pl_buf_params(
@@ -1264,24 +1656,44 @@ retry_ssbo:
             goto retry_ssbo;
     }
 
-    if (!obj->peak.buf) {
+    if (!*buf) {
         SH_FAIL(sh, "Failed creating peak detection SSBO!");
         return false;
     }
 
+done_ssbo:
     obj->peak.params = *params;
+    obj->peak.bufs[slot].cheap = cheap;
+    obj->peak.bufs[slot].index = obj->peak.counter++;
+    obj->peak.pending++;
+    peak_buf = *buf;
 
+done_bufs:
     sh_desc(sh, (struct pl_shader_desc) {
         .desc = {
             .name   = "PeakBuf",
             .type   = PL_DESC_BUF_STORAGE,
             .access = PL_DESC_ACCESS_READWRITE,
         },
-        .binding.object  = obj->peak.buf,
+        .binding.object  = peak_buf,
         .buffer_vars     = (struct pl_buffer_var *) peak_buf_vars,
         .num_buffer_vars = PL_ARRAY_SIZE(peak_buf_vars),
     });
 
+    const bool gpu_resident = params->gpu_resident;
+    if (gpu_resident) {
+        sh_desc(sh, (struct pl_shader_desc) {
+            .desc = {
+                .name   = "PeakState",
+                .type   = PL_DESC_BUF_STORAGE,
+                .access = PL_DESC_ACCESS_READWRITE,
+            },
+            .binding.object  = obj->peak.state,
+            .buffer_vars     = (struct pl_buffer_var *) peak_state_vars,
+            .num_buffer_vars = PL_ARRAY_SIZE(peak_state_vars),
+        });
+    }
+
     // For performance, we want to do as few atomic operations on global
     // memory as possible, so use an atomic in shmem for the work group.
     ident_t wg_sum   = sh_fresh(sh, "wg_sum"),
@@ -1294,6 +1706,12 @@ retry_ssbo:
         GLSLH("shared uint "$"[%u]; \n", wg_hist, HIST_BINS);
     }
 
+    ident_t wg_last = NULL_IDENT;
+    if (gpu_resident) {
+        wg_last = sh_fresh(sh, "wg_last");
+        GLSLH("shared bool "$"; \n", wg_last);
+    }
+
     sh_describe(sh, "peak detection");
 #pragma GLSL /* pl_shader_detect_peak */                                        \
     {                                                                           \
@@ -1308,13 +1726,21 @@ retry_ssbo:
         for (uint i = local_idx; i < ${const uint: HIST_BINS}; i += wg_size)    \
             $wg_hist[i] = 0u;                                                   \
     @}                                                                          \
-    barrier();
+    barrier();                                                                  \
+    @if (downsample) {                                                          \
+        /* Only measure the top left pixel of every 2x2 quad */                 \
+        const uint wg_samples = wg_size >> 2;                                   \
+        uvec2 quad_pos = gl_LocalInvocationID.xy & uvec2(1u);                   \
+        if (quad_pos == uvec2(0u)) {                                            \
+    @} else {                                                                   \
+        const uint wg_samples = wg_size;                                        \
+    @}
 
     // Decode color into linear light representation
     pl_color_space_infer(&csp);
     pl_shader_linearize(sh, &csp);
 
-    bool has_subgroups = sh_glsl(sh).subgroup_size > 0;
+    const bool has_subgroups = sh_glsl(sh).subgroup_size > 0;
     const float cutoff = fmaxf(params->black_cutoff, 0.0f) * 1e-2f;
 #pragma GLSL /* Measure luminance as N-bit PQ */                                \
     float luma = dot(${sh_luma_coeffs(sh, &csp)}, color.rgb);                   \
@@ -1333,12 +1759,16 @@ retry_ssbo:
         bin -= ${const int: HIST_BIAS};                                         \
         bin = clamp(bin, 0, ${const int: HIST_BINS - 1});                       \
         @if (has_subgroups) {                                                   \
-            /* Optimize for the very common case of identical histogram bins */ \
-            if (subgroupAllEqual(bin)) {                                        \
-                if (subgroupElect())                                            \
-                    atomicAdd($wg_hist[bin], gl_SubgroupSize);                  \
-            } else {                                                            \
-                atomicAdd($wg_hist[bin], 1u);                                   \
+            /* Merge all invocations sharing a bin into a single atomic */      \
+            /* This loops once per distinct bin, which is usually very few */   \
+            bool done = false;                                                  \
+            while (!done) {                                                     \
+                if (bin == subgroupBroadcastFirst(bin)) {                       \
+                    uint count = subgroupBallotBitCount(subgroupBallot(true));  \
+                    if (subgroupElect())                                        \
+                        atomicAdd($wg_hist[bin], count);                        \
+                    done = true;                                                \
+                }                                                               \
             }                                                                   \
         @} else {                                                               \
             atomicAdd($wg_hist[bin], 1u);                                       \
@@ -1364,6 +1794,8 @@ retry_ssbo:
                 atomicAdd($wg_black, 1u);                                       \
         @}                                                                      \
     @}                                                                          \
+    @if (downsample)                                                            \
+        }                                                                       \
     barrier();                                                                  \
                                                                                 \
     @if (use_histogram) {                                                       \
@@ -1378,13 +1810,121 @@ retry_ssbo:
                                                                                 \
     /* Have one thread per work group update the global atomics */              \
     if (gl_LocalInvocationIndex == 0u) {                                        \
-        uint num = wg_size - $wg_black;                                         \
+        uint num = wg_samples - $wg_black;                                      \
         atomicAdd(frame_wg_count[slice], 1u);                                   \
         atomicAdd(frame_wg_active[slice], min(num, 1u));                        \
         if (num > 0u) {                                                         \
             atomicAdd(frame_sum_pq[slice], $wg_sum / num);                      \
             atomicMax(frame_max_pq[slice], $wg_max);                            \
         }                                                                       \
+    }
+
+    if (!gpu_resident) {
+        GLSL("color = color_orig; \n"
+             "}                   \n");
+        return true;
+    }
+
+    // Mirrors `measure_peak` and `update_peak_data`, see there for details
+    const float log10_pq = 1e-2f;
+    const float thresh_low = params->scene_threshold_low * log10_pq;
+    const float thresh_high = params->scene_threshold_high * log10_pq;
+    const bool hysteresis = thresh_low > 0 && thresh_high > 0;
+#pragma GLSL /* Reduce the results in the last work group to finish */          \
+    memoryBarrierBuffer();                                                      \
+    barrier();                                                                  \
+    if (gl_LocalInvocationIndex == 0u) {                                        \
+        uint num_wgs = gl_NumWorkGroups.x * gl_NumWorkGroups.y;                 \
+        $wg_last = atomicAdd(peak_wg_done, 1u) == num_wgs - 1u;                 \
+    }                                                                           \
+    barrier();                                                                  \
+    if ($wg_last) {                                                             \
+        memoryBarrierBuffer();                                                  \
+        /* Gather the slices, resetting them for the next frame */              \
+        @if (use_histogram) {                                                   \
+            for (uint i = local_idx; i < ${const uint: HIST_BINS}; i += wg_size) {\
+                uint count = 0u;                                                \
+                for (uint k = 0u; k < ${const uint: SLICES}; k++) {             \
+                    uint idx = k * ${const uint: HIST_BINS} + i;                \
+                    count += atomicExchange(frame_hist[idx], 0u);               \
+                }                                                               \
+                $wg_hist[i] = count;                                            \
+            }                                                                   \
+            barrier();                                                          \
+        @}                                                                      \
+        if (gl_LocalInvocationIndex == 0u) {                                    \
+            uint wg_count = 0u, wg_active = 0u, sum_pq = 0u, max_pq = 0u;       \
+            for (uint k = 0u; k < ${const uint: SLICES}; k++) {                 \
+                wg_count  += atomicExchange(frame_wg_count[k], 0u);             \
+                wg_active += atomicExchange(frame_wg_active[k], 0u);            \
+                sum_pq    += atomicExchange(frame_sum_pq[k], 0u);               \
+                max_pq = max(max_pq, atomicExchange(frame_max_pq[k], 0u));      \
+            }                                                                   \
+                                                                                \
+            float avg = ${const float: PL_COLOR_HDR_BLACK};                     \
+            float peak = avg;                                                   \
+            if (wg_active > 0u) {                                               \
+                avg = float(sum_pq) / (float(wg_active) * ${const float: PQ_MAX});\
+                peak = float(max_pq) / ${const float: PQ_MAX};                  \
+            @if (use_histogram) {                                               \
+                uint total = 0u;                                                \
+                for (uint i = 0u; i < ${const uint: HIST_BINS}; i++)            \
+                    total += $wg_hist[i];                                       \
+                uint target = uint(ceil(${float: params->percentile / 100.0f} * \
+                                        float(total)));                         \
+                uint sum = 0u;                                                  \
+                for (uint i = 0u; target < total && i < ${const uint: HIST_BINS}; i++) {\
+                    uint next = sum + $wg_hist[i];                              \
+                    if (next < target) {                                        \
+                        sum = next;                                             \
+                        continue;                                               \
+                    }                                                           \
+                    uint bin_pq = (i + ${const uint: HIST_BIAS}) <<             \
+                                  ${const uint: PQ_BITS - HIST_BITS};           \
+                    uint bin_size = ${const uint: HIST_PQ(1) - HIST_PQ(0)};     \
+                    float pq_low = float(bin_pq) / ${const float: PQ_MAX};      \
+                    float pq_high = float(bin_pq + bin_size) / ${const float: PQ_MAX};\
+                    if (next + 1u > total)                                      \
+                        pq_high = peak;                                         \
+                    float ratio = float(target - sum) / float(next + 1u - sum); \
+                    peak = mix(pq_low, pq_high, ratio);                         \
+                    break;                                                      \
+                }                                                               \
+            @}                                                                  \
+            }                                                                   \
+                                                                                \
+            float cur_avg = peak_avg_pq, cur_max = peak_max_pq;                 \
+            if (cur_avg == 0.0) {                                               \
+                cur_avg = avg;                                                  \
+                cur_max = peak;                                                 \
+            } else {                                                            \
+                if (abs(avg - cur_avg) * ${const float: PQ_MAX} < 1.0)          \
+                    avg = cur_avg;                                              \
+                if (abs(peak - cur_max) * ${const float: PQ_MAX} < 1.0)         \
+                    peak = cur_max;                                             \
+            }                                                                   \
+                                                                                \
+            cur_avg += ${float: iir_coeff(params->smoothing_period)} * (avg - cur_avg);\
+            cur_max += ${float: iir_coeff(params->smoothing_period)} * (peak - cur_max);\
+            @if (hysteresis) {                                                  \
+                float bias = float(wg_active) / float(wg_count);                \
+                float delta = bias * abs(avg - cur_avg);                        \
+                @if (thresh_high != thresh_low) {                               \
+                    float mix_coeff = (delta - ${float: thresh_low}) /          \
+                                      ${float: thresh_high - thresh_low};       \
+                    mix_coeff = clamp(mix_coeff, 0.0, 1.0);                     \
+                    mix_coeff = mix_coeff * mix_coeff * (3.0 - 2.0 * mix_coeff);\
+                @} else {                                                       \
+                    float mix_coeff = step(${float: thresh_low}, delta);        \
+                @}                                                              \
+                cur_avg = mix(cur_avg, avg, mix_coeff);                         \
+                cur_max = mix(cur_max, peak, mix_coeff);                        \
+            @}                                                                  \
+                                                                                \
+            peak_avg_pq = cur_avg;                                              \
+            peak_max_pq = cur_max;                                              \
+            peak_wg_done = 0u;                                                  \
+        }                                                                       \
     }                                                                           \
     color = color_orig;                                                         \
     }
@@ -1399,7 +1939,18 @@ bool pl_get_detected_hdr_metadata(const pl_shader_obj state,
         return false;
 
     struct sh_color_map_obj *obj = state->priv;
-    update_peak_buf(state->gpu, obj, false);
+    if (obj->peak.params.gpu_resident) {
+        struct peak_state_data data;
+        pl_buf buf = obj->peak.state;
+        if (!buf->params.host_readable || !pl_buf_read(state->gpu, buf, 0,
+                                                       &data, sizeof(data)))
+            return false;
+        obj->peak.avg_pq = data.avg_pq;
+        obj->peak.max_pq = data.max_pq;
+    } else {
+        update_peak_buf(state->gpu, obj, PEAK_BUFS, false);
+    }
+
     if (!obj->peak.avg_pq)
         return false;
 
@@ -1408,6 +1959,23 @@ bool pl_get_detected_hdr_metadata(const pl_shader_obj state,
     return true;
 }
 
+bool pl_get_detected_peak_frame(const pl_shader_obj state,
+                                struct pl_peak_detect_frame *out)
+{
+    if (!state || state->type != PL_SHADER_OBJ_COLOR_MAP)
+        return false;
+
+    struct sh_color_map_obj *obj = state->priv;
+    update_peak_buf(state->gpu, obj, PEAK_BUFS, true);
+    if (!obj->peak.num_frames)
+        return false;
+
+    *out = obj->peak.frames[obj->peak.frames_idx];
+    obj->peak.frames_idx = (obj->peak.frames_idx + 1) % PEAK_FRAMES;
+    obj->peak.num_frames--;
+    return true;
+}
+
 void pl_reset_detected_peak(pl_shader_obj state)
 {
     if (!state || state->type != PL_SHADER_OBJ_COLOR_MAP)
@@ -1415,9 +1983,16 @@ void pl_reset_detected_peak(pl_shader_obj state)
 
     struct sh_color_map_obj *obj = state->priv;
     pl_buf readback = obj->peak.readback;
-    pl_buf_destroy(state->gpu, &obj->peak.buf);
+    pl_buf gpu_buf = obj->peak.gpu_buf, gpu_state = obj->peak.state;
+    pl_buf bufs[PEAK_BUFS];
+    for (int i = 0; i < PEAK_BUFS; i++)
+        bufs[i] = obj->peak.bufs[i].buf;
     memset(&obj->peak, 0, sizeof(obj->peak));
     obj->peak.readback = readback;
+    obj->peak.gpu_buf = gpu_buf;
+    obj->peak.state = gpu_state;
+    for (int i = 0; i < PEAK_BUFS; i++)
+        obj->peak.bufs[i].buf = bufs[i];
 }
 
 void pl_shader_extract_features(pl_shader sh, struct pl_color_space csp)
@@ -1620,12 +2195,251 @@ static void visualize_gamut_map(pl_shader sh, pl_rect2df rc,
          lut);
 }
 
+// Emits a closed-form version of the tone-mapping curve, operating on PQ
+// values like the LUT would. Returns NULL_IDENT if not available.
+static ident_t tone_map_analytic(pl_shader sh, const struct pl_tone_map_params *tone)
+{
+    struct pl_tone_map_curve c;
+    if (!pl_tone_map_curve(&c, tone))
+        return NULL_IDENT;
+
+    const struct pl_tone_map_function *fun = c.function;
+    pl_assert(fun->scaling == PL_HDR_PQ || fun->scaling == PL_HDR_NORM);
+    const bool norm = fun->scaling == PL_HDR_NORM;
+    const float *k = c.k;
+
+    ident_t func = sh_fresh(sh, "tone_curve");
+    GLSLH("float "$"(float x) {                 \n"
+          "    x = clamp(x, "$", "$");          \n",
+          func, SH_FLOAT(tone->input_min), SH_FLOAT_DYN(tone->input_max));
+
+    if (norm) {
+        GLSLH("    x = pow(x, 1.0/%f);                          \n"
+              "    x = max(x - %f, 0.0) / (%f - %f * x);        \n"
+              "    x = pow(x, 1.0/%f) * %f;                     \n",
+              PQ_M2, PQ_C1, PQ_C2, PQ_C3, PQ_M1, 10000 / PL_COLOR_SDR_WHITE);
+    }
+
+    if (fun == &pl_tone_map_spline) {
+        GLSLH("    x -= "$";                                            \n"
+              "    x = x > 0.0 ? (("$" * x + "$") * x + "$") * x        \n"
+              "                : ("$" * x + "$") * x;                   \n"
+              "    x += "$";                                            \n",
+              SH_FLOAT_DYN(k[0]),
+              SH_FLOAT_DYN(k[4]), SH_FLOAT_DYN(k[5]), SH_FLOAT_DYN(k[6]),
+              SH_FLOAT_DYN(k[2]), SH_FLOAT_DYN(k[3]),
+              SH_FLOAT_DYN(k[1]));
+    } else if (fun == &pl_tone_map_bt2390) {
+        const float range = c.input_max - c.input_min;
+        ident_t minLum = SH_FLOAT_DYN(k[0]), maxLum = SH_FLOAT_DYN(k[1]),
+                ks = SH_FLOAT_DYN(k[2]);
+        GLSLH("    x = "$" * x + "$";                                   \n"
+              // Piece-wise hermite spline
+              "    if ("$" < 1.0 && x >= "$") {                         \n"
+              "        float tb = (x - "$") / (1.0 - "$");              \n"
+              "        float tb2 = tb * tb;                             \n"
+              "        float tb3 = tb2 * tb;                            \n"
+              "        x = (2.0 * tb3 - 3.0 * tb2 + 1.0) * "$" +        \n"
+              "            (tb3 - 2.0 * tb2 + tb) * (1.0 - "$") +       \n"
+              "            (-2.0 * tb3 + 3.0 * tb2) * "$";              \n"
+              "    }                                                    \n"
+              // Black point adaptation
+              "    if (x < 1.0) {                                       \n"
+              "        x += "$" * pow(1.0 - x, "$");                    \n"
+              "        x = "$" * (x - "$") + "$";                       \n"
+              "    }                                                    \n"
+              "    x = "$" * x + "$";                                   \n",
+              SH_FLOAT_DYN(1.0f / range), SH_FLOAT_DYN(-c.input_min / range),
+              ks, ks, ks, ks, ks, ks, maxLum,
+              minLum, SH_FLOAT_DYN(k[3]),
+              SH_FLOAT_DYN(k[4]), minLum, minLum,
+              SH_FLOAT_DYN(range), SH_FLOAT(c.input_min));
+    } else if (fun == &pl_tone_map_reinhard || fun == &pl_tone_map_mobius) {
+        const float range = c.output_max - c.output_min;
+        GLSLH("    x = "$" * (x - "$");  \n",
+              SH_FLOAT_DYN(1.0f / range), SH_FLOAT(c.input_min));
+        if (fun == &pl_tone_map_reinhard) {
+            GLSLH("    x = "$" * x / (x + "$"); \n",
+                  SH_FLOAT_DYN(k[1]), SH_FLOAT_DYN(k[0]));
+        } else {
+            GLSLH("    x = x <= "$" ? x : "$" * (x + "$") / (x + "$"); \n",
+                  SH_FLOAT(k[0]), SH_FLOAT_DYN(k[3]),
+                  SH_FLOAT_DYN(k[1]), SH_FLOAT_DYN(k[2]));
+        }
+        GLSLH("    x = "$" * x + "$";  \n",
+              SH_FLOAT_DYN(range), SH_FLOAT(c.output_min));
+    } else if (fun == &pl_tone_map_hable) {
+        const float lb_in = powf(c.input_min, 1/2.4f), lw_in = powf(c.input_max, 1/2.4f);
+        const float lb_out = powf(c.output_min, 1/2.4f), lw_out = powf(c.output_max, 1/2.4f);
+        const float A = 0.15, B = 0.50, C = 0.10, D = 0.20, E = 0.02, F = 0.30;
+        GLSLH("    x = (pow(x, 1.0/2.4) - "$") * "$";               \n"
+              "    x = pow("$" * x, 2.4);                           \n"
+              "    x = (x * (%f * x + %f) + %f) /                   \n"
+              "        (x * (%f * x + %f) + %f) - %f;               \n"
+              "    x = pow(max("$" * x, 0.0), 1.0/2.4);             \n"
+              "    x = pow("$" * x + "$", 2.4);                     \n",
+              SH_FLOAT(lb_in), SH_FLOAT_DYN(1.0f / (lw_in - lb_in)),
+              SH_FLOAT_DYN(powf(k[0], 1/2.4f)),
+              A, C*B, D*E, A, B, D*F, E/F,
+              SH_FLOAT_DYN(k[1]),
+              SH_FLOAT_DYN(lw_out - lb_out), SH_FLOAT(lb_out));
+    } else {
+        pl_unreachable();
+    }
+
+    if (norm) {
+        GLSLH("    x = max(x, 0.0) * %f;                        \n"
+              "    x = pow(x, %f);                              \n"
+              "    x = (%f + %f * x) / (1.0 + %f * x);          \n"
+              "    x = pow(x, %f);                              \n",
+              PL_COLOR_SDR_WHITE / 10000, PQ_M1, PQ_C1, PQ_C2, PQ_C3, PQ_M2);
+    }
+
+    GLSLH("    return clamp(x, "$", "$");   \n"
+          "}                                \n",
+          SH_FLOAT(tone->output_min), SH_FLOAT_DYN(tone->output_max));
+    return func;
+}
+
 static void fill_tone_lut(void *data, const struct sh_lut_params *params)
 {
     const struct pl_tone_map_params *lut_params = params->priv;
     pl_tone_map_generate(data, lut_params);
 }
 
+// Parametric tone-mapping LUT, indexed by (input, peak, average). This is
+// used for dynamic metadata, so that per-frame changes in the detected peak
+// and average only move the sampling position instead of requiring the LUT
+// to be regenerated.
+#define TONE_LUT_PEAKS 32
+#define TONE_LUT_AVGS  16
+
+struct tone_lut_3d {
+    struct pl_tone_map_params params; // with all dynamic values cleared
+    float peak_min, peak_max;
+    float avg_min, avg_max; // relative to the input range
+};
+
+static struct tone_lut_3d tone_lut_3d_params(const struct pl_tone_map_params *tone)
+{
+    struct tone_lut_3d lut = {
+        .params = *tone,
+        // Lower bound on `input_max`, see `pl_tone_map_params_infer`
+        .peak_min = fminf(tone->output_max, pl_hdr_rescale(PL_HDR_NITS,
+                          PL_HDR_PQ, PL_COLOR_SDR_WHITE)),
+        .peak_max = 1.0f,
+        // The source knee is clamped to this range anyway
+        .avg_min = tone->constants.knee_minimum,
+        .avg_max = tone->constants.knee_maximum,
+    };
+
+    pl_assert(tone->input_scaling == PL_HDR_PQ);
+    lut.params.input_max = lut.params.input_avg = 0.0f;
+    lut.params.hdr.max_pq_y = lut.params.hdr.avg_pq_y = 0.0f;
+    return lut;
+}
+
+static bool tone_lut_3d_supported(pl_shader sh, int lut_size)
+{
+    pl_gpu gpu = SH_GPU(sh);
+    return gpu && sh_glsl(sh).version > 100 &&
+           gpu->limits.max_tex_3d_dim >= lut_size &&
+           pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 16, 32,
+                       PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_LINEAR);
+}
+
+// Whether the color mapping shader can consume `gpu_resident` peak detection
+// results directly, instead of reading them back to the CPU
+static bool use_gpu_peak(pl_shader sh, const struct sh_color_map_obj *obj,
+                         const struct pl_color_map_params *params, int lut_size)
+{
+    if (!obj->peak.params.gpu_resident || !obj->peak.state)
+        return false;
+    if (params->metadata && params->metadata != PL_HDR_METADATA_CIE_Y)
+        return false; // detected metadata will be unused anyway
+    if (!sh_glsl(sh).compute || !tone_lut_3d_supported(sh, lut_size))
+        return false;
+
+    for (int i = 0; i < sh->descs.num; i++) {
+        if (sh->descs.elem[i].binding.object == obj->peak.state)
+            return false; // detected in the same shader, results not ready
+    }
+
+    return true;
+}
+
+// Computes the 3DLUT coordinates from the `gpu_resident` peak detection
+// results on the GPU, mirroring `pl_color_space_nominal_luma_ex` and
+// `pl_tone_map_params_infer`. Returns a vec4 holding the input scale and
+// offset, followed by the peak and average coordinates. Until the first
+// result is available, this assumes the nominal range and default knee.
+static ident_t gpu_peak_lut_pos(pl_shader sh, const struct sh_color_map_obj *obj,
+                                const struct pl_tone_map_params *tone,
+                                const struct tone_lut_3d *lut)
+{
+    sh_desc(sh, (struct pl_shader_desc) {
+        .desc = {
+            .name   = "PeakState",
+            .type   = PL_DESC_BUF_STORAGE,
+            .access = PL_DESC_ACCESS_READONLY,
+        },
+        .binding.object  = obj->peak.state,
+        .buffer_vars     = (struct pl_buffer_var *) peak_state_vars,
+        .num_buffer_vars = PEAK_STATE_VARS_READ,
+    });
+
+    const float knee = tone->constants.knee_default;
+    ident_t pos = sh_fresh(sh, "tone_pos");
+    GLSL("vec4 "$";                                     \n"
+         "{                                             \n"
+         "float peak = "$";                             \n"
+         "float avg = "$";                              \n"
+         "if (peak_avg_pq > 0.0) {                      \n"
+         "    peak = clamp(peak_max_pq, "$", 1.0);      \n"
+         "    avg = clamp(peak_avg_pq, "$", peak);      \n"
+         "    peak = max(peak, "$");                    \n"
+         "}                                             \n"
+         "float range = peak - "$";                     \n"
+         ""$".xy = vec2(1.0, -"$") / range;             \n"
+         ""$".z = (peak - "$") * "$";                   \n"
+         ""$".w = ((avg - "$") / range - "$") * "$";    \n"
+         ""$".zw = clamp("$".zw, 0.0, 1.0);             \n"
+         "}                                             \n",
+         pos,
+         SH_FLOAT(tone->input_max),
+         SH_FLOAT(PL_MIX(tone->input_min, tone->input_max, knee)),
+         SH_FLOAT(pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, PL_COLOR_HDR_BLACK)),
+         SH_FLOAT(tone->input_min),
+         SH_FLOAT(lut->peak_min),
+         SH_FLOAT(tone->input_min),
+         pos, SH_FLOAT(tone->input_min),
+         pos, SH_FLOAT(lut->peak_min),
+         SH_FLOAT(1.0f / (lut->peak_max - lut->peak_min)),
+         pos, SH_FLOAT(tone->input_min), SH_FLOAT(lut->avg_min),
+         SH_FLOAT(1.0f / (lut->avg_max - lut->avg_min)),
+         pos, pos);
+
+    return pos;
+}
+
+static void fill_tone_lut_3d(void *data, const struct sh_lut_params *params)
+{
+    const struct tone_lut_3d *lut = params->priv;
+    float *out = data;
+    for (int z = 0; z < params->depth; z++) {
+        const float avg = PL_MIX(lut->avg_min, lut->avg_max,
+                                 z / (params->depth - 1.0f));
+        for (int y = 0; y < params->height; y++) {
+            struct pl_tone_map_params row = lut->params;
+            row.input_max = PL_MIX(lut->peak_min, lut->peak_max,
+                                   y / (params->height - 1.0f));
+            row.input_avg = PL_MIX(row.input_min, row.input_max, avg);
+            pl_tone_map_generate(out, &row);
+            out += params->width;
+        }
+    }
+}
+
 static void fill_gamut_lut(void *data, const struct sh_lut_params *params)
 {
     const struct pl_gamut_map_params *lut_params = params->priv;
@@ -1633,11 +2447,28 @@ static void fill_gamut_lut(void *data, const struct sh_lut_params *params)
     void *tmp = pl_alloc(NULL, lut_size * sizeof(float) * lut_params->lut_stride);
     pl_gamut_map_generate(tmp, lut_params);
 
-    // Convert to 16-bit unsigned integer for GPU texture
     const float *in = tmp;
-    uint16_t *out = data;
     pl_assert(lut_params->lut_stride == 3);
     pl_assert(params->comps == 4);
+
+    if (params->fmt->texel_size == 4) {
+        // Pack into rgb10a2, with the same chroma offset as the 16-bit path
+        const float offset = 32768.0f / UINT16_MAX;
+        uint32_t *out = data;
+        for (int i = 0; i < lut_size; i++) {
+            uint32_t I = PL_CLAMP(lrintf(in[0] * 1023), 0, 1023);
+            uint32_t P = PL_CLAMP(lrintf((in[1] + offset) * 1023), 0, 1023);
+            uint32_t T = PL_CLAMP(lrintf((in[2] + offset) * 1023), 0, 1023);
+            out[i] = I | P << 10 | T << 20 | 3u << 30;
+            in += 3;
+        }
+
+        pl_free(tmp);
+        return;
+    }
+
+    // Convert to 16-bit unsigned integer for GPU texture
+    uint16_t *out = data;
     for (int i = 0; i < lut_size; i++) {
         out[0] = roundf(in[0] * UINT16_MAX);
         out[1] = roundf(in[1] * UINT16_MAX + (UINT16_MAX >> 1));
@@ -1663,16 +2494,22 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
         return;
     }
 
+    params = PL_DEF(params, &pl_color_map_default_params);
+    const int lut_size = PL_DEF(params->lut_size, pl_color_map_default_params.lut_size);
+
     struct sh_color_map_obj *obj = NULL;
+    bool gpu_peak = false;
     if (args->state) {
-        pl_get_detected_hdr_metadata(*args->state, &src.hdr);
         obj = SH_OBJ(sh, args->state, PL_SHADER_OBJ_COLOR_MAP, struct sh_color_map_obj,
                      sh_color_map_uninit);
         if (!obj)
             return;
+        (*args->state)->mem_usage = sh_color_map_mem_usage;
+        gpu_peak = use_gpu_peak(sh, obj, params, lut_size);
+        if (!gpu_peak)
+            pl_get_detected_hdr_metadata(*args->state, &src.hdr);
     }
 
-    params = PL_DEF(params, &pl_color_map_default_params);
     GLSL("// pl_shader_color_map \n"
          "{                      \n");
 
@@ -1682,13 +2519,15 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
         .param          = params->tone_mapping_param,
         .input_scaling  = PL_HDR_PQ,
         .output_scaling = PL_HDR_PQ,
-        .lut_size       = PL_DEF(params->lut_size, pl_color_map_default_params.lut_size),
+        .lut_size       = lut_size,
         .hdr            = src.hdr,
     };
 
+    // With `gpu_resident` peak detection, the actual values are only known to
+    // the GPU, so use the nominal range of the transfer as an upper bound
     pl_color_space_nominal_luma_ex(pl_nominal_luma_params(
         .color      = &src,
-        .metadata   = params->metadata,
+        .metadata   = gpu_peak ? PL_HDR_METADATA_NONE : params->metadata,
         .scaling    = tone.input_scaling,
         .out_min    = &tone.input_min,
         .out_max    = &tone.input_max,
@@ -1796,6 +2635,13 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
     if (!gamut_fmt) {
         gamut.function = &pl_gamut_map_saturation;
         can_fast = true;
+    } else if (params->lut3d_adaptive) {
+        // Prefer the more compact 10-bit format, where it can be filtered
+        const enum pl_fmt_caps caps = PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_LINEAR;
+        pl_fmt packed = pl_find_named_fmt(SH_GPU(sh), "rgb10a2");
+        if (packed && packed->texel_size == 4 && (packed->caps & caps) == caps)
+            gamut_fmt = packed;
+        gamut_lut_adapt(&gamut);
     }
 
     bool need_tone_map = !pl_tone_map_params_noop(&tone);
@@ -1857,17 +2703,23 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
 
     if (need_tone_map) {
         const struct pl_tone_map_function *fun = tone.function;
+        struct tone_lut_3d tone_lut = tone_lut_3d_params(&tone);
+        const bool use_lut_3d = (tone.input_avg > 0 || gpu_peak) && // dynamic metadata
+            tone_lut.peak_max > tone_lut.peak_min + 1e-3 &&
+            tone_lut_3d_supported(sh, tone.lut_size);
+        const bool fast = can_fast && !(gpu_peak && use_lut_3d);
+        ident_t curve;
         sh_describef(sh, "%s tone map (%.0f -> %.0f)", fun->name,
                      pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, tone.input_max),
                      pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, tone.output_max));
 
-        if (fun == &pl_tone_map_clip && can_fast) {
+        if (fun == &pl_tone_map_clip && fast) {
 
             GLSL("#define tone_map(x) clamp((x), "$", "$") \n",
                  SH_FLOAT(tone.input_min),
                  SH_FLOAT_DYN(tone.input_max));
 
-        } else if (fun == &pl_tone_map_linear && can_fast) {
+        } else if (fun == &pl_tone_map_linear && fast) {
 
             const float gain = tone.constants.exposure;
             const float scale = tone.input_max - tone.input_min;
@@ -1888,8 +2740,59 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
 
             GLSL("#define tone_map(x) ("$"(x)) \n", linfun);
 
+        } else if (fast && (curve = tone_map_analytic(sh, &tone))) {
+
+            // Closed-form curve, with all metadata-dependent coefficients
+            // passed as dynamic variables instead of regenerating a LUT
+            GLSL("#define tone_map(x) ("$"(x)) \n", curve);
+
+        } else if (use_lut_3d) {
+
+            // Bake the curve over the full range of possible peak and average
+            // values, so continuously varying metadata only moves the LUT
+            // coordinates instead of triggering CPU work every frame
+            pl_assert(obj);
+            ident_t lut = sh_lut(sh, sh_lut_params(
+                .object     = &obj->tone.lut,
+                .var_type   = PL_VAR_FLOAT,
+                .lut_type   = SH_LUT_TEXTURE,
+                .method     = SH_LUT_LINEAR,
+                .width      = tone.lut_size,
+                .height     = TONE_LUT_PEAKS,
+                .depth      = TONE_LUT_AVGS,
+                .comps      = 1,
+                .update     = !pl_tone_map_params_equal(&tone_lut.params, &obj->tone.params),
+                .fill       = fill_tone_lut_3d,
+                .priv       = &tone_lut,
+            ));
+            obj->tone.params = tone_lut.params;
+            if (!lut) {
+                SH_FAIL(sh, "Failed generating tone-mapping LUT!");
+                return;
+            }
+
+            if (gpu_peak) {
+                ident_t pos = gpu_peak_lut_pos(sh, obj, &tone, &tone_lut);
+                GLSL("#define tone_map(x) ("$"(vec3("$".x * (x) + "$".y, "$".zw))) \n",
+                     lut, pos, pos, pos);
+            } else {
+                const float lut_range = tone.input_max - tone.input_min;
+                const float peak = (tone.input_max - tone_lut.peak_min) /
+                                   (tone_lut.peak_max - tone_lut.peak_min);
+                const float avg = ((tone.input_avg - tone.input_min) / lut_range -
+                                   tone_lut.avg_min) / (tone_lut.avg_max - tone_lut.avg_min);
+                GLSL("#define tone_map(x) ("$"(vec3("$" * (x) + "$", "$", "$"))) \n",
+                     lut, SH_FLOAT_DYN(1.0f / lut_range),
+                     SH_FLOAT_DYN(-tone.input_min / lut_range),
+                     SH_FLOAT_DYN(PL_CLAMP(peak, 0.0f, 1.0f)),
+                     SH_FLOAT_DYN(PL_CLAMP(avg, 0.0f, 1.0f)));
+            }
+
         } else {
 
+            // Note: This LUT is cheap enough to generate (well under 0.1 ms
+            // for all built-in functions) that regenerating it on the CPU for
+            // every change in dynamic metadata is not a bottleneck
             pl_assert(obj);
             ident_t lut = sh_lut(sh, sh_lut_params(
                 .object     = &obj->tone.lut,
@@ -1976,6 +2879,9 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
         const struct pl_gamut_map_function *fun = gamut.function;
         sh_describef(sh, "gamut map (%s)", fun->name);
 
+        // Note: This LUT only depends on the gamuts and the target luminance
+        // range, not on any (dynamic) source metadata, so it does not need to
+        // be regenerated on scene changes
         pl_assert(obj);
         ident_t lut = sh_lut(sh, sh_lut_params(
             .object     = &obj->gamut.lut,
@@ -1987,10 +2893,12 @@ void pl_shader_color_map_ex(pl_shader sh, const struct pl_color_map_params *para
             .height     = gamut.lut_size_C,
             .depth      = gamut.lut_size_h,
             .comps      = 4,
-            .signature  = gamut_map_signature(&gamut),
+            .signature  = gamut_map_signature(&gamut, gamut_fmt),
             .cache      = SH_CACHE(sh),
             .fill       = fill_gamut_lut,
             .priv       = &gamut,
+            .priv_size  = sizeof(gamut),
+            .async      = params->lut3d_async,
         ));
         if (!lut) {
             SH_FAIL(sh, "Failed generating gamut-mapping LUT!");
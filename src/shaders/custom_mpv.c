@@ -20,6 +20,7 @@
 
 #include "gpu.h"
 #include "shaders.h"
+#include "pl_thread_pool.h"
 
 #include <libplacebo/shaders/colorspace.h>
 #include <libplacebo/shaders/custom.h>
@@ -49,6 +50,14 @@ enum shexp_tag {
     SHEXP_OP2, // Pop two elements and push the result of a dyadic operation
     SHEXP_OP1, // Pop one element and push the result of a monadic operation
     SHEXP_VAR, // Arbitrary variable (e.g. shader parameters)
+    SHEXP_PARAM, // Value of a shader parameter, resolved from SHEXP_VAR
+};
+
+// Special texture slots, resolved from their names at parse time
+enum {
+    SHEXP_SLOT_HOOKED           = -1,
+    SHEXP_SLOT_NATIVE_CROPPED   = -2,
+    SHEXP_SLOT_OUTPUT           = -3,
 };
 
 struct shexp {
@@ -58,6 +67,10 @@ struct shexp {
         pl_str varname;
         enum shexp_op op;
     } val;
+
+    // Index into `hook_priv.tex_slots` (SHEXP_TEX_*, or one of the special
+    // SHEXP_SLOT_* values) or into `hook_priv.hook_params` (SHEXP_PARAM)
+    int slot;
 };
 
 struct custom_shader_hook {
@@ -137,6 +150,24 @@ static bool parse_rpn_shexpr(pl_str line, struct shexp out[MAX_SHEXP_SIZE])
     return true;
 }
 
+// Returns false if the result is not a finite number
+static bool shexp_op2(enum shexp_op op, float op1, float op2, float *res)
+{
+    switch (op) {
+    case SHEXP_OP_ADD: *res = op1 + op2; break;
+    case SHEXP_OP_SUB: *res = op1 - op2; break;
+    case SHEXP_OP_MUL: *res = op1 * op2; break;
+    case SHEXP_OP_DIV: *res = op1 / op2; break;
+    case SHEXP_OP_MOD: *res = fmodf(op1, op2); break;
+    case SHEXP_OP_GT:  *res = op1 > op2; break;
+    case SHEXP_OP_LT:  *res = op1 < op2; break;
+    case SHEXP_OP_EQ:  *res = fabsf(op1 - op2) <= 1e-6 * fmaxf(op1, op2); break;
+    case SHEXP_OP_NOT: pl_unreachable();
+    }
+
+    return isfinite(*res);
+}
+
 static inline pl_str split_magic(pl_str *body)
 {
     pl_str ret = pl_str_split_str0(*body, "//!", body);
@@ -302,8 +333,18 @@ static bool parse_hook(pl_log log, pl_str *body, struct custom_shader_hook *out)
     return true;
 }
 
+// Embedded TEXTURE/BUFFER data, decoded and uploaded only once the whole
+// file has been parsed, so that large payloads can be decoded in parallel
+struct payload {
+    int desc_idx;
+    struct pl_tex_params params; // only for textures
+    pl_str hex;
+    pl_str data;
+    bool ok;
+};
+
 static bool parse_tex(pl_gpu gpu, void *alloc, pl_str *body,
-                      struct pl_shader_desc *out)
+                      struct pl_shader_desc *out, struct payload *payload)
 {
     *out = (struct pl_shader_desc) {
         .desc = {
@@ -464,32 +505,34 @@ static bool parse_tex(pl_gpu gpu, void *alloc, pl_str *body,
         return false;
     }
 
-    // Decode the rest of the section (up to the next //! marker) as raw hex
-    // data for the texture
-    pl_str tex, hexdata = split_magic(body);
-    if (!pl_str_decode_hex(NULL, pl_str_strip(hexdata), &tex)) {
-        PL_ERR(gpu, "Error while parsing TEXTURE body: must be a valid "
-                    "hexadecimal sequence!");
-        return false;
-    }
+    // The rest of the section (up to the next //! marker) is the raw hex
+    // data for the texture, see `upload_payloads`
+    *payload = (struct payload) {
+        .params = params,
+        .hex = pl_str_strip(split_magic(body)),
+    };
 
+    return true;
+}
+
+static bool create_tex(pl_gpu gpu, struct pl_shader_desc *sd,
+                       struct payload *payload)
+{
+    struct pl_tex_params params = payload->params;
+    pl_str tex = payload->data;
     int texels = params.w * PL_DEF(params.h, 1) * PL_DEF(params.d, 1);
     size_t expected_len = texels * params.format->texel_size;
     if (tex.len == 0 && params.storable) {
         // In this case, it's okay that the texture has no initial data
-        pl_free_ptr(&tex.buf);
     } else if (tex.len != expected_len) {
-        PL_ERR(gpu, "Shader TEXTURE size mismatch: got %zu bytes, expected %zu!",
-               tex.len, expected_len);
-        pl_free(tex.buf);
+        PL_ERR(gpu, "Shader TEXTURE '%s' size mismatch: got %zu bytes, "
+               "expected %zu!", sd->desc.name, tex.len, expected_len);
         return false;
     }
 
-    params.initial_data = tex.buf;
-    out->binding.object = pl_tex_create(gpu, &params);
-    pl_free(tex.buf);
-
-    if (!out->binding.object) {
+    params.initial_data = tex.len ? tex.buf : NULL;
+    sd->binding.object = pl_tex_create(gpu, &params);
+    if (!sd->binding.object) {
         PL_ERR(gpu, "Failed creating custom texture!");
         return false;
     }
@@ -498,7 +541,7 @@ static bool parse_tex(pl_gpu gpu, void *alloc, pl_str *body,
 }
 
 static bool parse_buf(pl_gpu gpu, void *alloc, pl_str *body,
-                      struct pl_shader_desc *out)
+                      struct pl_shader_desc *out, struct payload *payload)
 {
     *out = (struct pl_shader_desc) {
         .desc = {
@@ -581,40 +624,91 @@ static bool parse_buf(pl_gpu gpu, void *alloc, pl_str *body,
         }
     }
 
-    // Decode the rest of the section (up to the next //! marker) as raw hex
-    // data for the buffer
-    pl_str data, hexdata = split_magic(body);
-    if (!pl_str_decode_hex(tmp, pl_str_strip(hexdata), &data)) {
-        PL_ERR(gpu, "Error while parsing BUFFER body: must be a valid "
-                    "hexadecimal sequence!");
-        return false;
-    }
+    // The rest of the section (up to the next //! marker) is the raw hex
+    // data for the buffer, see `upload_payloads`
+    *payload = (struct payload) {
+        .hex = pl_str_strip(split_magic(body)),
+    };
+
+    pl_free(tmp);
+    return true;
+}
 
-    size_t buf_size = sh_buf_desc_size(out);
-    if (data.len == 0 && out->desc.type == PL_DESC_BUF_STORAGE) {
+static bool create_buf(pl_gpu gpu, struct pl_shader_desc *sd,
+                       struct payload *payload)
+{
+    pl_str data = payload->data;
+    size_t buf_size = sh_buf_desc_size(sd);
+    if (data.len == 0 && sd->desc.type == PL_DESC_BUF_STORAGE) {
         // In this case, it's okay that the buffer has no initial data
     } else if (data.len != buf_size) {
-        PL_ERR(gpu, "Shader BUFFER size mismatch: got %zu bytes, expected %zu!",
-               data.len, buf_size);
+        PL_ERR(gpu, "Shader BUFFER '%s' size mismatch: got %zu bytes, "
+               "expected %zu!", sd->desc.name, data.len, buf_size);
         return false;
     }
 
-    out->binding.object = pl_buf_create(gpu, pl_buf_params(
+    sd->binding.object = pl_buf_create(gpu, pl_buf_params(
         .size = buf_size,
-        .uniform = out->desc.type == PL_DESC_BUF_UNIFORM,
-        .storable = out->desc.type == PL_DESC_BUF_STORAGE,
+        .uniform = sd->desc.type == PL_DESC_BUF_UNIFORM,
+        .storable = sd->desc.type == PL_DESC_BUF_STORAGE,
         .initial_data = data.len ? data.buf : NULL,
     ));
 
-    if (!out->binding.object) {
+    if (!sd->binding.object) {
         PL_ERR(gpu, "Failed creating custom buffer!");
         return false;
     }
 
-    pl_free(tmp);
     return true;
 }
 
+// Below this total payload size, the decoding is not worth farming out
+#define PARALLEL_DECODE_MIN (1 << 16)
+
+static void decode_payload(void *priv, int i)
+{
+    struct payload *payload = &((struct payload *) priv)[i];
+    payload->ok = pl_str_decode_hex(NULL, payload->hex, &payload->data);
+}
+
+static bool upload_payloads(pl_gpu gpu, struct pl_shader_desc *descs,
+                            struct payload *payloads, int num)
+{
+    size_t total = 0;
+    for (int i = 0; i < num; i++)
+        total += payloads[i].hex.len;
+
+    if (total >= PARALLEL_DECODE_MIN) {
+        pl_parallel_for(num, decode_payload, payloads);
+    } else {
+        for (int i = 0; i < num; i++)
+            decode_payload(payloads, i);
+    }
+
+    // Object creation stays serial, since `pl_gpu` is not necessarily
+    // thread-safe, and to keep the error reporting deterministic
+    bool ok = true;
+    for (int i = 0; i < num && ok; i++) {
+        struct pl_shader_desc *sd = &descs[payloads[i].desc_idx];
+        bool is_tex = sd->desc.type == PL_DESC_SAMPLED_TEX ||
+                      sd->desc.type == PL_DESC_STORAGE_IMG;
+        if (!payloads[i].ok) {
+            PL_ERR(gpu, "Error while parsing %s '%s' body: must be a valid "
+                   "hexadecimal sequence!", is_tex ? "TEXTURE" : "BUFFER",
+                   sd->desc.name);
+            ok = false;
+        } else if (is_tex) {
+            ok = create_tex(gpu, sd, &payloads[i]);
+        } else {
+            ok = create_buf(gpu, sd, &payloads[i]);
+        }
+    }
+
+    for (int i = 0; i < num; i++)
+        pl_free(payloads[i].data.buf);
+    return ok;
+}
+
 static bool parse_var(pl_log log, pl_str str, enum pl_var_type type, pl_var_data *out)
 {
     if (!str.len)
@@ -630,7 +724,7 @@ static bool parse_var(pl_log log, pl_str str, enum pl_var_type type, pl_var_data
         ok = pl_str_parse_uint(pl_str_split_char(buf, ' ', &buf), &out->u);
         break;
     case PL_VAR_FLOAT:
-        ok = pl_str_parse_float(pl_str_split_char(buf, ' ', &buf), &out->f);
+        ok = pl_str_parse_floats(&buf, &out->f, 1) == 1;
         break;
     case PL_VAR_INVALID:
     case PL_VAR_TYPE_COUNT:
@@ -904,11 +998,15 @@ static pl_str pl_stage_to_mp(enum pl_hook_stage stage)
 struct hook_pass {
     enum pl_hook_stage exec_stages;
     struct custom_shader_hook hook;
+
+    // Saved textures which are no longer read after this pass
+    PL_ARRAY(pl_str) release_tex;
 };
 
 struct pass_tex {
     pl_str name;
     pl_tex tex;
+    bool owned; // allocated by the current hook invocation
 
     // Metadata
     pl_rect2df rect;
@@ -917,6 +1015,11 @@ struct pass_tex {
     int comps;
 };
 
+struct tex_slot {
+    pl_str name;
+    int idx; // index into `pass_textures`, or -1 if not (yet) saved
+};
+
 struct hook_priv {
     pl_log log;
     pl_gpu gpu;
@@ -933,6 +1036,10 @@ struct hook_priv {
     PL_ARRAY(struct pass_tex) pass_textures;
     pl_shader trc_helper;
 
+    // Texture names referenced by RPN expressions, interned at parse time so
+    // that evaluating them does not require any string comparisons
+    PL_ARRAY(struct tex_slot) tex_slots;
+
     // State for PRNG/frame count
     int frame_count;
     uint64_t prng_state[4];
@@ -942,6 +1049,8 @@ static void hook_reset(void *priv)
 {
     struct hook_priv *p = priv;
     p->pass_textures.num = 0;
+    for (int i = 0; i < p->tex_slots.num; i++)
+        p->tex_slots.elem[i].idx = -1;
 }
 
 // Context during execution of a hook
@@ -951,75 +1060,52 @@ struct hook_ctx {
     struct pass_tex hooked;
 };
 
-static bool lookup_tex(struct hook_ctx *ctx, pl_str var, float size[2])
+static bool lookup_tex(struct hook_ctx *ctx, int slot, float size[2])
 {
     struct hook_priv *p = ctx->priv;
     const struct pl_hook_params *params = ctx->params;
 
-    if (pl_str_equals0(var, "HOOKED")) {
+    switch (slot) {
+    case SHEXP_SLOT_HOOKED:
         pl_assert(ctx->hooked.tex);
         size[0] = ctx->hooked.tex->params.w;
         size[1] = ctx->hooked.tex->params.h;
         return true;
-    }
 
-    if (pl_str_equals0(var, "NATIVE_CROPPED")) {
+    case SHEXP_SLOT_NATIVE_CROPPED:
         size[0] = fabs(pl_rect_w(params->src_rect));
         size[1] = fabs(pl_rect_h(params->src_rect));
         return true;
-    }
 
-    if (pl_str_equals0(var, "OUTPUT")) {
+    case SHEXP_SLOT_OUTPUT:
         size[0] = abs(pl_rect_w(params->dst_rect));
         size[1] = abs(pl_rect_h(params->dst_rect));
         return true;
     }
 
-    if (pl_str_equals0(var, "MAIN"))
-        var = pl_str0("MAINPRESUB");
-
-    for (int i = 0; i < p->pass_textures.num; i++) {
-        if (pl_str_equals(var, p->pass_textures.elem[i].name)) {
-            pl_tex tex = p->pass_textures.elem[i].tex;
-            size[0] = tex->params.w;
-            size[1] = tex->params.h;
-            return true;
-        }
-    }
+    pl_assert(slot >= 0 && slot < p->tex_slots.num);
+    int idx = p->tex_slots.elem[slot].idx;
+    if (idx < 0)
+        return false;
 
-    return false;
+    pl_tex tex = p->pass_textures.elem[idx].tex;
+    size[0] = tex->params.w;
+    size[1] = tex->params.h;
+    return true;
 }
 
-static bool lookup_var(struct hook_ctx *ctx, pl_str var, float *val)
+static float param_value(const struct pl_hook_par *hp)
 {
-    struct hook_priv *p = ctx->priv;
-    for (int i = 0; i < p->hook_params.num; i++) {
-        const struct pl_hook_par *hp = &p->hook_params.elem[i];
-        if (pl_str_equals0(var, hp->name)) {
-            switch (hp->type) {
-            case PL_VAR_SINT:  *val = hp->data->i; return true;
-            case PL_VAR_UINT:  *val = hp->data->u; return true;
-            case PL_VAR_FLOAT: *val = hp->data->f; return true;
-            case PL_VAR_INVALID:
-            case PL_VAR_TYPE_COUNT:
-                break;
-            }
-
-            pl_unreachable();
-        }
-
-        if (hp->names) {
-            for (int j = hp->minimum.i; j <= hp->maximum.i; j++) {
-                if (pl_str_equals0(var, hp->names[j])) {
-                    *val = j;
-                    return true;
-                }
-            }
-        }
+    switch (hp->type) {
+    case PL_VAR_SINT:  return hp->data->i;
+    case PL_VAR_UINT:  return hp->data->u;
+    case PL_VAR_FLOAT: return hp->data->f;
+    case PL_VAR_INVALID:
+    case PL_VAR_TYPE_COUNT:
+        break;
     }
 
-    PL_WARN(p, "Variable '%.*s' not found in RPN expression!", PL_STR_FMT(var));
-    return false;
+    pl_unreachable();
 }
 
 // Returns whether successful. 'result' is left untouched on failure
@@ -1065,19 +1151,7 @@ static bool eval_shexpr(struct hook_ctx *ctx,
             float op2 = stack[--idx];
             float op1 = stack[--idx];
             float res = 0.0;
-            switch (expr[i].val.op) {
-            case SHEXP_OP_ADD: res = op1 + op2; break;
-            case SHEXP_OP_SUB: res = op1 - op2; break;
-            case SHEXP_OP_MUL: res = op1 * op2; break;
-            case SHEXP_OP_DIV: res = op1 / op2; break;
-            case SHEXP_OP_MOD: res = fmodf(op1, op2); break;
-            case SHEXP_OP_GT:  res = op1 > op2; break;
-            case SHEXP_OP_LT:  res = op1 < op2; break;
-            case SHEXP_OP_EQ:  res = fabsf(op1 - op2) <= 1e-6 * fmaxf(op1, op2); break;
-            case SHEXP_OP_NOT: pl_unreachable();
-            }
-
-            if (!isfinite(res)) {
+            if (!shexp_op2(expr[i].val.op, op1, op2, &res)) {
                 PL_WARN(p, "Illegal operation in RPN expression!");
                 return false;
             }
@@ -1090,7 +1164,7 @@ static bool eval_shexpr(struct hook_ctx *ctx,
             pl_str name = expr[i].val.varname;
             float size[2];
 
-            if (!lookup_tex(ctx, name, size)) {
+            if (!lookup_tex(ctx, expr[i].slot, size)) {
                 PL_WARN(p, "Variable '%.*s' not found in RPN expression!",
                         PL_STR_FMT(name));
                 return false;
@@ -1100,14 +1174,15 @@ static bool eval_shexpr(struct hook_ctx *ctx,
             continue;
         }
 
-        case SHEXP_VAR: {
-            pl_str name = expr[i].val.varname;
-            float val;
-            if (!lookup_var(ctx, name, &val))
-                return false;
-            stack[idx++] = val;
+        case SHEXP_PARAM:
+            stack[idx++] = param_value(&p->hook_params.elem[expr[i].slot]);
             continue;
-        }
+
+        case SHEXP_VAR:
+            // Only reached for names that failed to resolve at parse time
+            PL_WARN(p, "Variable '%.*s' not found in RPN expression!",
+                    PL_STR_FMT(expr[i].val.varname));
+            return false;
         }
     }
 
@@ -1215,21 +1290,62 @@ static bool bind_pass_tex(pl_shader sh, pl_str name,
     return true;
 }
 
-static void save_pass_tex(struct hook_priv *p, struct pass_tex ptex)
+static void save_pass_tex(struct hook_priv *p, const struct pl_hook_params *params,
+                          struct pass_tex ptex)
 {
 
     for (int i = 0; i < p->pass_textures.num; i++) {
-        if (!pl_str_equals(p->pass_textures.elem[i].name, ptex.name))
+        struct pass_tex *old = &p->pass_textures.elem[i];
+        if (!pl_str_equals(old->name, ptex.name))
             continue;
 
-        p->pass_textures.elem[i] = ptex;
+        // Nothing else can reference a texture we allocated during this
+        // invocation once its name is overwritten, so return it right away
+        if (old->owned && old->tex != ptex.tex && params->release_tex)
+            params->release_tex(params->priv, old->tex);
+
+        *old = ptex;
         return;
     }
 
     // No texture with this name yet, append new one
+    for (int i = 0; i < p->tex_slots.num; i++) {
+        if (pl_str_equals(p->tex_slots.elem[i].name, ptex.name))
+            p->tex_slots.elem[i].idx = p->pass_textures.num;
+    }
+
     PL_ARRAY_APPEND(p->alloc, p->pass_textures, ptex);
 }
 
+static void release_pass_tex(struct hook_priv *p, const struct pl_hook_params *params,
+                             pl_str name)
+{
+    if (!params->release_tex)
+        return;
+
+    for (int i = 0; i < p->pass_textures.num; i++) {
+        const struct pass_tex *ptex = &p->pass_textures.elem[i];
+        if (!pl_str_equals(ptex->name, name))
+            continue;
+        if (!ptex->owned)
+            return;
+
+        PL_TRACE(p, "Releasing texture '%.*s'", PL_STR_FMT(name));
+        params->release_tex(params->priv, ptex->tex);
+        PL_ARRAY_REMOVE_AT(p->pass_textures, i);
+
+        for (int j = 0; j < p->tex_slots.num; j++) {
+            struct tex_slot *slot = &p->tex_slots.elem[j];
+            if (slot->idx == i) {
+                slot->idx = -1;
+            } else if (slot->idx > i) {
+                slot->idx--;
+            }
+        }
+        return;
+    }
+}
+
 static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *params)
 {
     struct hook_priv *p = priv;
@@ -1250,11 +1366,16 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
         },
     };
 
+    // Textures allocated by previous invocations may have been returned to
+    // the renderer as the result of a stage, and are no longer ours to release
+    for (int i = 0; i < p->pass_textures.num; i++)
+        p->pass_textures.elem[i].owned = false;
+
     // Save the input texture if needed
     if (p->save_stages & params->stage) {
         PL_TRACE(p, "Saving input texture '%.*s' for binding",
                  PL_STR_FMT(ctx.hooked.name));
-        save_pass_tex(p, ctx.hooked);
+        save_pass_tex(p, params, ctx.hooked);
     }
 
     for (int n = 0; n < p->hook_passes.num; n++) {
@@ -1273,7 +1394,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
 
         if (!run) {
             PL_TRACE(p, "Skipping hook due to condition");
-            continue;
+            goto next_pass;
         }
 
         // Generate a new shader object
@@ -1554,6 +1675,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
         struct pass_tex ptex = {
             .name  = hook->save_tex.len ? hook->save_tex : stage,
             .tex   = fbo,
+            .owned = true,
             .repr  = ctx.hooked.repr,
             .color = ctx.hooked.color,
             .comps = PL_DEF(hook->comps, ctx.hooked.comps),
@@ -1566,7 +1688,7 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
         PL_TRACE(p, "Saving output texture '%.*s' from hook execution on '%.*s'",
                  PL_STR_FMT(ptex.name), PL_STR_FMT(stage));
 
-        save_pass_tex(p, ptex);
+        save_pass_tex(p, params, ptex);
 
         // Update the result object, unless we saved to a different name
         if (pl_str_equals(ptex.name, stage)) {
@@ -1581,7 +1703,9 @@ static struct pl_hook_res hook_hook(void *priv, const struct pl_hook_params *par
             };
         }
 
-next_pass: ;
+next_pass:
+        for (int i = 0; i < pass->release_tex.num; i++)
+            release_pass_tex(p, params, pass->release_tex.elem[i]);
     }
 
     return res;
@@ -1591,6 +1715,525 @@ error:
     return (struct pl_hook_res) { .failed = true };
 }
 
+static bool shexpr_reads(const struct shexp expr[MAX_SHEXP_SIZE], pl_str name)
+{
+    for (int i = 0; i < MAX_SHEXP_SIZE && expr[i].tag != SHEXP_END; i++) {
+        if (expr[i].tag != SHEXP_TEX_W && expr[i].tag != SHEXP_TEX_H)
+            continue;
+        if (pl_str_equals(expr[i].val.varname, name))
+            return true;
+    }
+
+    return false;
+}
+
+static bool pass_reads(const struct custom_shader_hook *h, pl_str name)
+{
+    for (int i = 0; i < PL_ARRAY_SIZE(h->bind_tex); i++) {
+        if (pl_str_equals(h->bind_tex[i], name))
+            return true;
+    }
+
+    return shexpr_reads(h->width, name) || shexpr_reads(h->height, name) ||
+           shexpr_reads(h->cond, name);
+}
+
+// Determines, for the texture saved under `name` by pass `first`, after which
+// pass it can be released. This is only done for textures that are used
+// exclusively by passes hooking the same single stage, and that are always
+// written before being read, so their lifetime cannot extend beyond a single
+// invocation of the hook.
+static void analyze_tex_lifetime(struct hook_priv *p, int first, pl_str name)
+{
+    const struct hook_pass *writer = &p->hook_passes.elem[first];
+    enum pl_hook_stage stage = writer->exec_stages;
+    if (!stage || (stage & (stage - 1)))
+        return;
+    if (pass_reads(&writer->hook, name))
+        return; // may read the contents from a previous invocation
+
+    int last = first;
+    for (int i = 0; i < p->hook_passes.num; i++) {
+        const struct hook_pass *pass = &p->hook_passes.elem[i];
+        bool access = pass_reads(&pass->hook, name) ||
+                      pl_str_equals(pass->hook.save_tex, name);
+        if (!access)
+            continue;
+        if (i < first || pass->exec_stages != stage)
+            return;
+        last = i;
+    }
+
+    struct hook_pass *pass = &p->hook_passes.elem[last];
+    PL_ARRAY_APPEND(p->alloc, pass->release_tex, name);
+}
+
+static inline bool is_ident(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '_';
+}
+
+// Finds the next occurrence of `word` in `str` as a whole identifier
+static int find_word(pl_str str, pl_str word)
+{
+    size_t base = 0;
+    while (base < str.len) {
+        int pos = pl_str_find(pl_str_drop(str, base), word);
+        if (pos < 0)
+            return -1;
+
+        size_t start = base + pos, end = start + word.len;
+        if ((!start || !is_ident(str.buf[start - 1])) &&
+            (end == str.len || !is_ident(str.buf[end])))
+        {
+            return start;
+        }
+
+        base = start + 1;
+    }
+
+    return -1;
+}
+
+static pl_str strip_comments(void *alloc, pl_str body)
+{
+    pl_str out = {0};
+    while (body.len) {
+        if (pl_str_startswith0(body, "//")) {
+            int nl = pl_strchr(body, '\n');
+            body = nl < 0 ? (pl_str) {0} : pl_str_drop(body, nl);
+        } else if (pl_str_startswith0(body, "/*")) {
+            int end = pl_str_find(body, pl_str0("*/"));
+            body = end < 0 ? (pl_str) {0} : pl_str_drop(body, end + 2);
+            pl_str_append(alloc, &out, pl_str0(" "));
+        } else {
+            pl_str_append_raw(alloc, &out, body.buf, 1);
+            body = pl_str_drop(body, 1);
+        }
+    }
+
+    return out;
+}
+
+// Checks whether a (comment-free) pass body consists of nothing but
+// parameterless `vec4` functions, the last of which is `hook`, and if so,
+// returns the offset of that last function's name. Such bodies define no
+// other global names, and can be inlined into another pass by renaming it.
+static int simple_hook_name(pl_str body)
+{
+    if (pl_strchr(body, '#') >= 0)
+        return -1;
+    if (find_word(body, pl_str0("frame")) >= 0 ||
+        find_word(body, pl_str0("random")) >= 0)
+        return -1; // differ between passes
+
+    int name = -1;
+    pl_str rest = pl_str_strip(body);
+    while (rest.len) {
+        if (!pl_str_eatstart0(&rest, "vec4"))
+            return -1;
+        rest = pl_str_strip(rest);
+        int len = 0;
+        while (len < rest.len && is_ident(rest.buf[len]))
+            len++;
+        if (!len)
+            return -1;
+        bool is_hook = pl_str_equals0(pl_str_take(rest, len), "hook");
+        name = rest.buf - body.buf;
+        rest = pl_str_strip(pl_str_drop(rest, len));
+        if (!pl_str_eatstart0(&rest, "("))
+            return -1;
+        rest = pl_str_strip(rest);
+        if (!pl_str_eatstart0(&rest, ")"))
+            return -1;
+        rest = pl_str_strip(rest);
+        if (!pl_str_startswith0(rest, "{"))
+            return -1;
+
+        int depth = 0, pos = 0;
+        do {
+            if (pos == rest.len)
+                return -1;
+            if (rest.buf[pos] == '{')
+                depth++;
+            if (rest.buf[pos] == '}')
+                depth--;
+            pos++;
+        } while (depth);
+
+        rest = pl_str_strip(pl_str_drop(rest, pos));
+        if (is_hook != !rest.len)
+            return -1;
+    }
+
+    return name;
+}
+
+// Rewrites all references to the texture `name` in `body` into calls to
+// `func`. Fails unless every reference samples the texture at exactly the
+// current output position.
+static bool rewrite_pointwise(void *alloc, pl_str body, pl_str name,
+                              pl_str func, pl_str *out)
+{
+    const char *patterns[] = {
+        "%.*s_tex(%.*s_pos)",
+        "%.*s_texOff(0)",
+        "%.*s_texOff(0.0)",
+        "%.*s_texOff(vec2(0))",
+        "%.*s_texOff(vec2(0.0))",
+    };
+
+    *out = (pl_str) {0};
+    size_t pos = 0;
+    while (true) {
+        int found = pl_str_find(pl_str_drop(body, pos), name);
+        if (found < 0)
+            break;
+
+        // Skip identifiers that merely contain or start with `name`
+        size_t start = pos + found, end = start + name.len;
+        if ((start && is_ident(body.buf[start - 1])) ||
+            (end < body.len && is_ident(body.buf[end]) && body.buf[end] != '_'))
+        {
+            pos = start + 1;
+            continue;
+        }
+
+        pl_str_append(alloc, out, pl_str_take(body, start));
+        body = pl_str_drop(body, start);
+        pos = 0;
+
+        for (int i = 0; i < PL_ARRAY_SIZE(patterns); i++) {
+            pl_str pattern = {0};
+            pl_str_append_asprintf(alloc, &pattern, patterns[i],
+                                   PL_STR_FMT(name), PL_STR_FMT(name));
+            if (pl_str_eatstart(&body, pattern)) {
+                pl_str_append_asprintf(alloc, out, "%.*s()", PL_STR_FMT(func));
+                goto next;
+            }
+        }
+
+        return false;
+next: ;
+    }
+
+    pl_str_append(alloc, out, body);
+    return true;
+}
+
+static bool shexpr_equal(const struct shexp a[MAX_SHEXP_SIZE],
+                         const struct shexp b[MAX_SHEXP_SIZE])
+{
+    for (int i = 0; i < MAX_SHEXP_SIZE; i++) {
+        if (a[i].tag != b[i].tag)
+            return false;
+
+        switch (a[i].tag) {
+        case SHEXP_END:
+            return true;
+        case SHEXP_CONST:
+            if (a[i].val.cval != b[i].val.cval)
+                return false;
+            continue;
+        case SHEXP_OP1:
+        case SHEXP_OP2:
+            if (a[i].val.op != b[i].val.op)
+                return false;
+            continue;
+        case SHEXP_TEX_W:
+        case SHEXP_TEX_H:
+        case SHEXP_PARAM:
+            if (a[i].slot != b[i].slot)
+                return false;
+            continue;
+        case SHEXP_VAR:
+            if (!pl_str_equals(a[i].val.varname, b[i].val.varname))
+                return false;
+            continue;
+        }
+    }
+
+    return true;
+}
+
+static int shexpr_len(const struct shexp expr[MAX_SHEXP_SIZE])
+{
+    int len = 0;
+    while (len < MAX_SHEXP_SIZE && expr[len].tag != SHEXP_END)
+        len++;
+    return len;
+}
+
+static bool shexpr_is_true(const struct shexp expr[MAX_SHEXP_SIZE])
+{
+    return expr[0].tag == SHEXP_CONST && expr[0].val.cval &&
+           expr[1].tag == SHEXP_END;
+}
+
+// Concatenates two conditions into `a && b`, i.e. `a ! ! b ! ! *`
+static bool shexpr_and(struct shexp out[MAX_SHEXP_SIZE],
+                       const struct shexp a[MAX_SHEXP_SIZE],
+                       const struct shexp b[MAX_SHEXP_SIZE])
+{
+    if (shexpr_is_true(a)) {
+        memcpy(out, b, MAX_SHEXP_SIZE * sizeof(b[0]));
+        return true;
+    } else if (shexpr_is_true(b)) {
+        memcpy(out, a, MAX_SHEXP_SIZE * sizeof(a[0]));
+        return true;
+    }
+
+    int len_a = shexpr_len(a), len_b = shexpr_len(b);
+    if (len_a + len_b + 5 > MAX_SHEXP_SIZE)
+        return false;
+
+    const struct shexp not = { SHEXP_OP1, { .op = SHEXP_OP_NOT }};
+    struct shexp tmp[MAX_SHEXP_SIZE] = {0};
+    int num = 0;
+    for (int i = 0; i < len_a; i++)
+        tmp[num++] = a[i];
+    tmp[num++] = not;
+    tmp[num++] = not;
+    for (int i = 0; i < len_b; i++)
+        tmp[num++] = b[i];
+    tmp[num++] = not;
+    tmp[num++] = not;
+    tmp[num++] = (struct shexp) { SHEXP_OP2, { .op = SHEXP_OP_MUL }};
+    memcpy(out, tmp, sizeof(tmp));
+    return true;
+}
+
+// Attempts to merge pass `idx` into the following pass, which must be the
+// only reader of its output. This is possible if both are fragment shaders
+// of the same size, and the consumer only ever samples the intermediate
+// texture at its own output position, in which case the producer's `hook`
+// can be inlined as a function instead of being rendered to a texture.
+static bool fuse_passes(struct hook_priv *p, int idx)
+{
+    struct hook_pass *a = &p->hook_passes.elem[idx], *b = a + 1;
+    const struct custom_shader_hook *ha = &a->hook, *hb = &b->hook;
+    pl_str name = ha->save_tex;
+    if (!name.len || ha->is_compute || hb->is_compute)
+        return false;
+    if (a->exec_stages != b->exec_stages)
+        return false;
+    if (!shexpr_equal(ha->width, hb->width) || !shexpr_equal(ha->height, hb->height))
+        return false;
+    if (pass_reads(ha, name) || shexpr_reads(hb->width, name) ||
+        shexpr_reads(hb->height, name) || shexpr_reads(hb->cond, name))
+        return false;
+
+    // The lifetime analysis establishes that `b` is the last reader
+    bool last_reader = false;
+    for (int i = 0; i < b->release_tex.num; i++)
+        last_reader |= pl_str_equals(b->release_tex.elem[i], name);
+    if (!last_reader)
+        return false;
+
+    // Merge the bound textures
+    struct custom_shader_hook h = *hb;
+    int num_binds = 0;
+    memset(h.bind_tex, 0, sizeof(h.bind_tex));
+    for (int n = 0; n < 2; n++) {
+        const struct custom_shader_hook *src = n ? ha : hb;
+        for (int i = 0; i < PL_ARRAY_SIZE(src->bind_tex) && src->bind_tex[i].len; i++) {
+            pl_str bind = src->bind_tex[i];
+            bool dupe = pl_str_equals(bind, name);
+            for (int j = 0; j < num_binds; j++)
+                dupe |= pl_str_equals(bind, h.bind_tex[j]);
+            if (dupe)
+                continue;
+            if (num_binds == PL_ARRAY_SIZE(h.bind_tex))
+                return false;
+            h.bind_tex[num_binds++] = bind;
+        }
+    }
+
+    // Reject combinations that bind one texture under two different names
+    bool hooked = false, is_main = false, mainpresub = false;
+    enum pl_hook_stage stages = 0;
+    for (int i = 0; i < num_binds; i++) {
+        hooked |= pl_str_equals0(h.bind_tex[i], "HOOKED");
+        is_main |= pl_str_equals0(h.bind_tex[i], "MAIN");
+        mainpresub |= pl_str_equals0(h.bind_tex[i], "MAINPRESUB");
+        stages |= mp_stage_to_pl(h.bind_tex[i]);
+    }
+    if ((hooked && (stages & a->exec_stages)) || (is_main && mainpresub))
+        return false;
+
+    if (!shexpr_and(h.cond, ha->cond, hb->cond))
+        return false;
+
+    // Inline the producer as a renamed function
+    void *tmp = pl_tmp(NULL);
+    pl_str body_a = strip_comments(tmp, ha->pass_body);
+    int fn = simple_hook_name(body_a);
+    if (fn < 0)
+        goto error;
+
+    pl_str func = {0};
+    pl_str_append_asprintf(p->alloc, &func, "%.*s_fused%d", PL_STR_FMT(name), idx);
+    pl_str body_b;
+    if (!rewrite_pointwise(tmp, hb->pass_body, name, func, &body_b))
+        goto error;
+
+    h.pass_body = (pl_str) {0};
+    pl_str_append(p->alloc, &h.pass_body, pl_str_take(body_a, fn));
+    pl_str_append(p->alloc, &h.pass_body, func);
+    pl_str_append(p->alloc, &h.pass_body, pl_str_drop(body_a, fn + 4));
+    pl_str_append(p->alloc, &h.pass_body, pl_str0("\n"));
+    pl_str_append(p->alloc, &h.pass_body, body_b);
+
+    h.pass_desc = (pl_str) {0};
+    pl_str_append_asprintf(p->alloc, &h.pass_desc, "%.*s + %.*s",
+                           PL_STR_FMT(ha->pass_desc), PL_STR_FMT(hb->pass_desc));
+
+    PL_INFO(p, "Fusing hook passes: %.*s", PL_STR_FMT(h.pass_desc));
+    b->hook = h;
+    for (int i = 0; i < a->release_tex.num; i++)
+        PL_ARRAY_APPEND(p->alloc, b->release_tex, a->release_tex.elem[i]);
+    PL_ARRAY_REMOVE_AT(p->hook_passes, idx);
+    pl_free(tmp);
+    return true;
+
+error:
+    pl_free(tmp);
+    return false;
+}
+
+// Whether the hook's output only depends on its input at a single stage, as
+// opposed to textures saved from other stages, mutable storage resources, or
+// the per-pass `frame` and `random` variables
+static bool hook_is_deterministic(const struct hook_priv *p, enum pl_hook_stage stages)
+{
+    if (!stages || (stages & (stages - 1)))
+        return false;
+
+    for (int i = 0; i < p->descriptors.num; i++) {
+        switch (p->descriptors.elem[i].desc.type) {
+        case PL_DESC_SAMPLED_TEX:
+        case PL_DESC_BUF_UNIFORM:
+        case PL_DESC_BUF_TEXEL_UNIFORM:
+            continue;
+        case PL_DESC_STORAGE_IMG:
+        case PL_DESC_BUF_STORAGE:
+        case PL_DESC_BUF_TEXEL_STORAGE:
+            return false;
+        case PL_DESC_INVALID:
+        case PL_DESC_TYPE_COUNT:
+            break;
+        }
+
+        pl_unreachable();
+    }
+
+    for (int i = 0; i < p->hook_passes.num; i++) {
+        pl_str body = p->hook_passes.elem[i].hook.pass_body;
+        if (find_word(body, pl_str0("frame")) >= 0 ||
+            find_word(body, pl_str0("random")) >= 0)
+            return false;
+    }
+
+    return true;
+}
+
+static int intern_tex_slot(struct hook_priv *p, pl_str name)
+{
+    if (pl_str_equals0(name, "HOOKED"))
+        return SHEXP_SLOT_HOOKED;
+    if (pl_str_equals0(name, "NATIVE_CROPPED"))
+        return SHEXP_SLOT_NATIVE_CROPPED;
+    if (pl_str_equals0(name, "OUTPUT"))
+        return SHEXP_SLOT_OUTPUT;
+    if (pl_str_equals0(name, "MAIN"))
+        name = pl_str0("MAINPRESUB");
+
+    for (int i = 0; i < p->tex_slots.num; i++) {
+        if (pl_str_equals(name, p->tex_slots.elem[i].name))
+            return i;
+    }
+
+    struct tex_slot slot = { .name = name, .idx = -1 };
+    PL_ARRAY_APPEND(p->alloc, p->tex_slots, slot);
+    return p->tex_slots.num - 1;
+}
+
+// Resolves all names in an RPN expression against the shader's parameters
+// and textures, and folds constant subexpressions, so that evaluating it at
+// runtime is a simple loop over pre-resolved slots. Names which fail to
+// resolve are left as SHEXP_VAR, and produce an error when evaluated.
+static void resolve_shexpr(struct hook_priv *p, struct shexp expr[MAX_SHEXP_SIZE])
+{
+    int num = 0;
+    for (int i = 0; i < MAX_SHEXP_SIZE && expr[i].tag != SHEXP_END; i++) {
+        struct shexp exp = expr[i];
+
+        switch (exp.tag) {
+        case SHEXP_END:
+        case SHEXP_CONST:
+        case SHEXP_PARAM:
+            break;
+
+        case SHEXP_TEX_W:
+        case SHEXP_TEX_H:
+            exp.slot = intern_tex_slot(p, exp.val.varname);
+            break;
+
+        case SHEXP_VAR:
+            for (int n = 0; n < p->hook_params.num; n++) {
+                const struct pl_hook_par *hp = &p->hook_params.elem[n];
+                if (pl_str_equals0(exp.val.varname, hp->name)) {
+                    exp.tag = SHEXP_PARAM;
+                    exp.slot = n;
+                    goto resolved;
+                }
+
+                if (!hp->names)
+                    continue;
+
+                for (int j = hp->minimum.i; j <= hp->maximum.i; j++) {
+                    if (pl_str_equals0(exp.val.varname, hp->names[j])) {
+                        exp = (struct shexp) { SHEXP_CONST, { .cval = j }};
+                        goto resolved;
+                    }
+                }
+            }
+resolved:
+            break;
+
+        case SHEXP_OP1:
+            if (num >= 1 && expr[num - 1].tag == SHEXP_CONST) {
+                pl_assert(exp.val.op == SHEXP_OP_NOT);
+                expr[num - 1].val.cval = !expr[num - 1].val.cval;
+                continue;
+            }
+            break;
+
+        case SHEXP_OP2:
+            if (num >= 2 && expr[num - 2].tag == SHEXP_CONST &&
+                expr[num - 1].tag == SHEXP_CONST)
+            {
+                float res;
+                // Leave illegal operations to be diagnosed at runtime
+                if (shexp_op2(exp.val.op, expr[num - 2].val.cval,
+                              expr[num - 1].val.cval, &res))
+                {
+                    expr[num - 2].val.cval = res;
+                    num--;
+                    continue;
+                }
+            }
+            break;
+        }
+
+        expr[num++] = exp;
+    }
+
+    for (int i = num; i < MAX_SHEXP_SIZE; i++)
+        expr[i] = (struct shexp) { SHEXP_END };
+}
+
 const struct pl_hook *pl_mpv_user_shader_parse(pl_gpu gpu,
                                                const char *shader_text,
                                                size_t shader_len)
@@ -1633,26 +2276,35 @@ const struct pl_hook *pl_mpv_user_shader_parse(pl_gpu gpu,
     }
     shader = pl_str_drop(shader, pos);
 
+    void *tmp = pl_tmp(hook);
+    PL_ARRAY(struct payload) payloads = {0};
+
     // Loop over the file
     while (shader.len > 0)
     {
         // Peek at the first header to dispatch the right type
         if (pl_str_startswith0(shader, "//!TEXTURE")) {
             struct pl_shader_desc sd;
-            if (!parse_tex(gpu, hook, &shader, &sd))
+            struct payload payload;
+            if (!parse_tex(gpu, hook, &shader, &sd, &payload))
                 goto error;
 
             PL_INFO(gpu, "Registering named texture '%s'", sd.desc.name);
+            payload.desc_idx = p->descriptors.num;
+            PL_ARRAY_APPEND(tmp, payloads, payload);
             PL_ARRAY_APPEND(hook, p->descriptors, sd);
             continue;
         }
 
         if (pl_str_startswith0(shader, "//!BUFFER")) {
             struct pl_shader_desc sd;
-            if (!parse_buf(gpu, hook, &shader, &sd))
+            struct payload payload;
+            if (!parse_buf(gpu, hook, &shader, &sd, &payload))
                 goto error;
 
             PL_INFO(gpu, "Registering named buffer '%s'", sd.desc.name);
+            payload.desc_idx = p->descriptors.num;
+            PL_ARRAY_APPEND(tmp, payloads, payload);
             PL_ARRAY_APPEND(hook, p->descriptors, sd);
             continue;
         }
@@ -1709,6 +2361,10 @@ const struct pl_hook *pl_mpv_user_shader_parse(pl_gpu gpu,
         PL_ARRAY_APPEND(hook, p->hook_passes, pass);
     }
 
+    if (!upload_payloads(gpu, p->descriptors.elem, payloads.elem, payloads.num))
+        goto error;
+    pl_free_ptr(&tmp);
+
     // We need to hook on both the exec and save stages, so that we can keep
     // track of any textures we might need
     hook->stages |= p->save_stages;
@@ -1718,6 +2374,36 @@ const struct pl_hook *pl_mpv_user_shader_parse(pl_gpu gpu,
     hook->parameters = p->hook_params.elem;
     hook->num_parameters = p->hook_params.num;
 
+    // Parameters may be declared after the passes referencing them, so this
+    // can only happen after the whole file has been parsed
+    for (int i = 0; i < p->hook_passes.num; i++) {
+        struct custom_shader_hook *h = &p->hook_passes.elem[i].hook;
+        resolve_shexpr(p, h->width);
+        resolve_shexpr(p, h->height);
+        resolve_shexpr(p, h->cond);
+    }
+
+    // Stage textures are shared with the renderer and have to be kept
+    for (int i = 0; i < p->hook_passes.num; i++) {
+        pl_str name = p->hook_passes.elem[i].hook.save_tex;
+        if (!name.len || mp_stage_to_pl(name) || pl_str_equals0(name, "HOOKED"))
+            continue;
+
+        bool seen = false;
+        for (int j = 0; j < i; j++)
+            seen |= pl_str_equals(p->hook_passes.elem[j].hook.save_tex, name);
+        if (!seen)
+            analyze_tex_lifetime(p, i, name);
+    }
+
+    // Merge point-wise chains of passes, to avoid round trips through VRAM
+    for (int i = 0; i + 1 < p->hook_passes.num; ) {
+        if (!fuse_passes(p, i))
+            i++;
+    }
+
+    hook->deterministic = hook_is_deterministic(p, hook->stages);
+
     PL_MSG(gpu, PL_LOG_DEBUG, "Loaded user shader:");
     pl_msg_source(gpu->log, PL_LOG_DEBUG, shader_text);
 
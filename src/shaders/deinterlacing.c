@@ -22,6 +22,57 @@
 
 const struct pl_deinterlace_params pl_deinterlace_default_params = { PL_DEINTERLACE_DEFAULTS };
 
+// Temporal neighbours of the field being interpolated. `prev2` and `next2`
+// are the adjacent frames, while `prev1` and `next1` are the frames
+// containing the closest same-parity fields before and after this field
+struct refs {
+    ident_t prev1, prev2;
+    ident_t next1, next2;
+};
+
+static bool bind_refs(pl_shader sh, const struct pl_deinterlace_source *src,
+                      ident_t cur, struct refs *out)
+{
+    const struct pl_tex_params *texparams = &src->cur.top->params;
+    ident_t prev2 = cur, next2 = cur;
+    if (src->prev.top && src->prev.top != src->cur.top) {
+        pl_assert(src->prev.top->params.w == texparams->w);
+        pl_assert(src->prev.top->params.h == texparams->h);
+        prev2 = sh_bind(sh, src->prev.top, PL_TEX_ADDRESS_MIRROR,
+                        PL_TEX_SAMPLE_NEAREST, "prev", NULL, NULL, NULL);
+        if (!prev2)
+            return false;
+    }
+
+    if (src->next.top && src->next.top != src->cur.top) {
+        pl_assert(src->next.top->params.w == texparams->w);
+        pl_assert(src->next.top->params.h == texparams->h);
+        next2 = sh_bind(sh, src->next.top, PL_TEX_ADDRESS_MIRROR,
+                        PL_TEX_SAMPLE_NEAREST, "next", NULL, NULL, NULL);
+        if (!next2)
+            return false;
+    }
+
+    enum pl_field first_field = PL_DEF(src->first_field, PL_FIELD_TOP);
+    *out = (struct refs) {
+        .prev1 = src->field == first_field ? prev2 : cur,
+        .prev2 = prev2,
+        .next1 = src->field == first_field ? cur : next2,
+        .next2 = next2,
+    };
+    return true;
+}
+
+// Try using a compute shader for the motion-adaptive deinterlacers, for the
+// sole reason of optimizing for thread group synchronicity. Otherwise, because
+// we alternate between lines output as-is and lines output deinterlaced, half
+// of our thread group will be mostly idle at any point in time.
+static void try_compute(pl_shader sh)
+{
+    const int bw = PL_DEF(sh_glsl(sh).subgroup_size, 32);
+    sh_try_compute(sh, bw, 1, true, 0);
+}
+
 void pl_shader_deinterlace(pl_shader sh, const struct pl_deinterlace_source *src,
                            const struct pl_deinterlace_params *params)
 {
@@ -87,12 +138,7 @@ void pl_shader_deinterlace(pl_shader sh, const struct pl_deinterlace_source *src
 
 
     case PL_DEINTERLACE_YADIF: {
-        // Try using a compute shader for this, for the sole reason of
-        // optimizing for thread group synchronicity. Otherwise, because we
-        // alternate between lines output as-is and lines output deinterlaced,
-        // half of our thread group will be mostly idle at any point in time.
-        const int bw = PL_DEF(sh_glsl(sh).subgroup_size, 32);
-        sh_try_compute(sh, bw, 1, true, 0);
+        try_compute(sh);
 
         // This magic constant is hard-coded in the original implementation as
         // '1' on an 8-bit scale. Since we work with arbitrary bit depth
@@ -190,28 +236,12 @@ void pl_shader_deinterlace(pl_shader sh, const struct pl_deinterlace_source *src
               "    return spatial_pred;                                         \n"
               "}                                                                \n");
 
-        ident_t prev2 = cur, next2 = cur;
-        if (src->prev.top && src->prev.top != src->cur.top) {
-            pl_assert(src->prev.top->params.w == texparams->w);
-            pl_assert(src->prev.top->params.h == texparams->h);
-            prev2 = sh_bind(sh, src->prev.top, PL_TEX_ADDRESS_MIRROR,
-                            PL_TEX_SAMPLE_NEAREST, "prev", NULL, NULL, NULL);
-            if (!prev2)
-                return;
-        }
+        struct refs refs;
+        if (!bind_refs(sh, src, cur, &refs))
+            return;
 
-        if (src->next.top && src->next.top != src->cur.top) {
-            pl_assert(src->next.top->params.w == texparams->w);
-            pl_assert(src->next.top->params.h == texparams->h);
-            next2 = sh_bind(sh, src->next.top, PL_TEX_ADDRESS_MIRROR,
-                            PL_TEX_SAMPLE_NEAREST, "next", NULL, NULL, NULL);
-            if (!next2)
-                return;
-        }
-
-        enum pl_field first_field = PL_DEF(src->first_field, PL_FIELD_TOP);
-        ident_t prev1 = src->field == first_field ? prev2 : cur;
-        ident_t next1 = src->field == first_field ? cur : next2;
+        ident_t prev1 = refs.prev1, prev2 = refs.prev2;
+        ident_t next1 = refs.next1, next2 = refs.next2;
 
         GLSL("T A = GET("$", 0, -1); \n"
              "T B = GET("$", 0,  1); \n"
@@ -245,6 +275,69 @@ void pl_shader_deinterlace(pl_shader sh, const struct pl_deinterlace_source *src
         break;
     }
 
+    case PL_DEINTERLACE_BWDIF: {
+        try_compute(sh);
+
+        struct refs refs;
+        if (!bind_refs(sh, src, cur, &refs))
+            return;
+
+        // Filter coefficients from FFmpeg's bwdif filter, on a 13-bit scale
+        static const float lf[2] = { 4309 / 8192.0f, 213 / 8192.0f };
+        static const float hf[3] = { 5570 / 8192.0f, 3801 / 8192.0f, 1016 / 8192.0f };
+        static const float sp[2] = { 5077 / 8192.0f, 981 / 8192.0f };
+
+        // Vertical neighbourhood of the missing line: `cur` provides the
+        // adjacent field lines, `prev2`/`next2` the temporally adjacent
+        // opposite field, and `prev1`/`next1` the same-parity fields
+        GLSL("T c   = GET("$", 0, -1);  \n"
+             "T e   = GET("$", 0, +1);  \n"
+             "T cm3 = GET("$", 0, -3);  \n"
+             "T cp3 = GET("$", 0, +3);  \n"
+             "T p0  = GET("$", 0,  0);  \n"
+             "T pm2 = GET("$", 0, -2);  \n"
+             "T pp2 = GET("$", 0, +2);  \n"
+             "T pm4 = GET("$", 0, -4);  \n"
+             "T pp4 = GET("$", 0, +4);  \n"
+             "T n0  = GET("$", 0,  0);  \n"
+             "T nm2 = GET("$", 0, -2);  \n"
+             "T np2 = GET("$", 0, +2);  \n"
+             "T nm4 = GET("$", 0, -4);  \n"
+             "T np4 = GET("$", 0, +4);  \n"
+             "T td0 = abs(p0 - n0);     \n"
+             "T td1 = 0.5 * (abs(GET("$", 0, -1) - c) + abs(GET("$", 0, +1) - e)); \n"
+             "T td2 = 0.5 * (abs(GET("$", 0, -1) - c) + abs(GET("$", 0, +1) - e)); \n"
+             "T d = 0.5 * (p0 + n0);                                    \n"
+             "T diff = max(0.5 * td0, max(td1, td2));                   \n",
+             cur, cur, cur, cur,
+             refs.prev1, refs.prev1, refs.prev1, refs.prev1, refs.prev1,
+             refs.next1, refs.next1, refs.next1, refs.next1, refs.next1,
+             refs.prev2, refs.prev2, refs.next2, refs.next2);
+
+        if (!params->skip_spatial_check) {
+            GLSL("T b = 0.5 * (pm2 + nm2) - c;                          \n"
+                 "T f = 0.5 * (pp2 + np2) - e;                          \n"
+                 "T mx = max(max(d - e, d - c), min(b, f));             \n"
+                 "T mn = min(min(d - e, d - c), max(b, f));             \n"
+                 "diff = max(diff, max(mn, -mx));                       \n");
+        }
+
+        // Use the high-frequency temporal interpolator only where the
+        // vertical detail exceeds the temporal difference, otherwise fall
+        // back to the purely spatial interpolator
+        GLSL("T lf = "$" * (c + e) - "$" * (cm3 + cp3);                      \n"
+             "T hf = 0.25 * ("$" * (p0 + n0) - "$" * (pm2 + nm2 + pp2 + np2) \n"
+             "               + "$" * (pm4 + nm4 + pp4 + np4)) + lf;          \n"
+             "T sp = "$" * (c + e) - "$" * (cm3 + cp3);                      \n"
+             "res = mix(hf, sp, step(abs(c - e), td0));                     \n"
+             "res = clamp(res, d - diff, d + diff);                         \n"
+             "res = clamp(res, T(0.0), T(1.0));                             \n",
+             SH_FLOAT(lf[0]), SH_FLOAT(lf[1]),
+             SH_FLOAT(hf[0]), SH_FLOAT(hf[1]), SH_FLOAT(hf[2]),
+             SH_FLOAT(sp[0]), SH_FLOAT(sp[1]));
+        break;
+    }
+
     case PL_DEINTERLACE_ALGORITHM_COUNT:
         pl_unreachable();
     }
@@ -16,6 +16,7 @@
  */
 
 #include <math.h>
+#include <limits.h>
 #include "shaders.h"
 
 #include <libplacebo/shaders/dithering.h>
@@ -33,20 +34,22 @@ static void sh_dither_uninit(pl_gpu gpu, void *ptr)
     *obj = (struct sh_dither_obj) {0};
 }
 
-static void fill_dither_matrix(void *data, const struct sh_lut_params *params)
+static size_t sh_dither_mem_usage(const void *ptr)
 {
-    pl_assert(params->width > 0 && params->height > 0 && params->comps == 1);
+    const struct sh_dither_obj *obj = ptr;
+    return sh_obj_mem_usage(obj->lut);
+}
 
-    const struct pl_dither_params *dpar = params->priv;
-    switch (dpar->method) {
+static void generate_dither_matrix(float *data, enum pl_dither_method method,
+                                   int size)
+{
+    switch (method) {
     case PL_DITHER_ORDERED_LUT:
-        pl_assert(params->width == params->height);
-        pl_generate_bayer_matrix(data, params->width);
+        pl_generate_bayer_matrix(data, size);
         return;
 
     case PL_DITHER_BLUE_NOISE:
-        pl_assert(params->width == params->height);
-        pl_generate_blue_noise(data, params->width);
+        pl_generate_blue_noise(data, size);
         return;
 
     case PL_DITHER_ORDERED_FIXED:
@@ -58,6 +61,85 @@ static void fill_dither_matrix(void *data, const struct sh_lut_params *params)
     pl_unreachable();
 }
 
+static void fill_dither_matrix(void *data, const struct sh_lut_params *params)
+{
+    pl_assert(params->width > 0 && params->height > 0 && params->comps == 1);
+    pl_assert(params->width == params->height);
+
+    const struct pl_dither_params *dpar = params->priv;
+    generate_dither_matrix(data, dpar->method, params->width);
+}
+
+// Number of layers of the spatio-temporal blue noise texture, i.e. the period
+// of temporal dithering with `PL_DITHER_BLUE_NOISE`
+#define DITHER_LAYERS 16
+
+struct dither_tex_ctx {
+    enum pl_dither_method method;
+    uint64_t signature;
+    pl_cache cache;
+    int size;
+    int layers;
+};
+
+// Expands a 2D dither matrix into `layers` slices, offsetting the threshold of
+// every pixel by the golden ratio per slice. Each slice keeps the spatial
+// spectrum of the original matrix, while every pixel also cycles through a
+// low-discrepancy sequence of thresholds over time.
+static void expand_temporal(float *out, const float *data, int size, int layers)
+{
+    const float phi = 0.61803398875f; // (sqrt(5) - 1) / 2
+    const int size2 = size * size;
+    for (int t = 0; t < layers; t++) {
+        const float offset = fmodf(t * phi, 1.0f);
+        for (int i = 0; i < size2; i++) {
+            float v = data[i] + offset;
+            out[t * size2 + i] = v >= 1.0f ? v - 1.0f : v;
+        }
+    }
+}
+
+// Dither matrices only depend on the method and size, so they can be shared
+// by all shaders (and renderers) using the same `pl_gpu`
+static pl_tex create_dither_tex(pl_gpu gpu, void *priv)
+{
+    const struct dither_tex_ctx *ctx = priv;
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 16, 32, PL_FMT_CAP_SAMPLEABLE);
+    if (!fmt)
+        return NULL;
+
+    // Shares the cache entry with the equivalent `sh_lut`
+    pl_cache_obj obj = { .key = CACHE_KEY_SH_LUT ^ ctx->signature };
+    const size_t size = ctx->size * ctx->size * sizeof(float);
+    if (!pl_cache_get(ctx->cache, &obj) || obj.size != size) {
+        pl_cache_obj_resize(NULL, &obj, size);
+        pl_clock_t start = pl_clock_now();
+        generate_dither_matrix(obj.data, ctx->method, ctx->size);
+        pl_log_cpu_time(gpu->log, start, pl_clock_now(), "generating dither matrix");
+    }
+
+    // Only the 2D matrix is cached, since expanding it is trivial
+    float *layers = NULL;
+    if (ctx->layers) {
+        layers = pl_alloc(NULL, ctx->layers * size);
+        expand_temporal(layers, obj.data, ctx->size, ctx->layers);
+    }
+
+    pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+        .w              = ctx->size,
+        .h              = ctx->size,
+        .d              = ctx->layers,
+        .format         = fmt,
+        .sampleable     = true,
+        .initial_data   = layers ? (void *) layers : obj.data,
+        .debug_tag      = PL_DEBUG_TAG,
+    ));
+
+    pl_free(layers);
+    pl_cache_set(ctx->cache, &obj);
+    return tex;
+}
+
 static bool dither_method_is_lut(enum pl_dither_method method)
 {
     switch (method) {
@@ -120,7 +202,7 @@ void pl_shader_dither(pl_shader sh, int new_depth,
     sh_describef(sh, "dithering (%d bits)", new_depth);
     GLSL("// pl_shader_dither \n"
         "{                    \n"
-        "float bias;          \n");
+        "%sfloat bias;        \n", sh_mediump(sh));
 
     params = PL_DEF(params, &pl_dither_default_params);
     if (params->lut_size < 0 || params->lut_size > 8) {
@@ -129,8 +211,8 @@ void pl_shader_dither(pl_shader sh, int new_depth,
     }
 
     enum pl_dither_method method = params->method;
-    ident_t lut = NULL_IDENT;
-    int lut_size = 0;
+    ident_t lut = NULL_IDENT, lut_tex = NULL_IDENT;
+    int lut_size = 0, layers = 0;
 
     if (dither_method_is_lut(method)) {
         if (!dither_state) {
@@ -144,21 +226,73 @@ void pl_shader_dither(pl_shader sh, int new_depth,
                      struct sh_dither_obj, sh_dither_uninit);
         if (!obj)
             goto fallback;
+        (*dither_state)->mem_usage = sh_dither_mem_usage;
 
         bool cache = method == PL_DITHER_BLUE_NOISE;
         lut_size = 1 << PL_DEF(params->lut_size, pl_dither_default_params.lut_size);
-        lut = sh_lut(sh, sh_lut_params(
-            .object     = &obj->lut,
-            .var_type   = PL_VAR_FLOAT,
-            .width      = lut_size,
-            .height     = lut_size,
-            .comps      = 1,
-            .fill       = fill_dither_matrix,
-            .signature  = (CACHE_KEY_DITHER ^ method) * lut_size,
-            .cache      = cache ? SH_CACHE(sh) : NULL,
-            .priv       = (void *) params,
-        ));
-        if (!lut)
+        const uint64_t signature = (CACHE_KEY_DITHER ^ method) * lut_size;
+
+        pl_gpu gpu = SH_GPU(sh);
+        if (gpu && sh_glsl(sh).version >= 130) {
+            // Use precomputed spatio-temporal noise instead of rotating the
+            // matrix per frame, if 3D textures are available
+            if (params->temporal && method == PL_DITHER_BLUE_NOISE &&
+                gpu->limits.max_tex_3d_dim >= PL_MAX(lut_size, DITHER_LAYERS))
+            {
+                layers = DITHER_LAYERS;
+            }
+
+            uint64_t key = CACHE_KEY_SH_LUT ^ signature;
+            if (layers)
+                pl_hash_merge(&key, layers);
+
+            pl_tex tex = pl_gpu_shared_tex(gpu, key,
+                create_dither_tex, &(struct dither_tex_ctx) {
+                    .method     = method,
+                    .signature  = signature,
+                    .cache      = cache ? SH_CACHE(sh) : NULL,
+                    .size       = lut_size,
+                    .layers     = layers,
+                });
+
+            if (!tex && layers) {
+                // Retry without the temporal layers
+                layers = 0;
+                tex = pl_gpu_shared_tex(gpu, CACHE_KEY_SH_LUT ^ signature,
+                    create_dither_tex, &(struct dither_tex_ctx) {
+                        .method     = method,
+                        .signature  = signature,
+                        .cache      = cache ? SH_CACHE(sh) : NULL,
+                        .size       = lut_size,
+                    });
+            }
+
+            if (tex) {
+                lut_tex = sh_desc(sh, (struct pl_shader_desc) {
+                    .binding.object = tex,
+                    .desc = (struct pl_desc) {
+                        .name = "dither_lut",
+                        .type = PL_DESC_SAMPLED_TEX,
+                    },
+                });
+            }
+        }
+
+        if (!lut_tex) {
+            lut = sh_lut(sh, sh_lut_params(
+                .object     = &obj->lut,
+                .var_type   = PL_VAR_FLOAT,
+                .width      = lut_size,
+                .height     = lut_size,
+                .comps      = 1,
+                .fill       = fill_dither_matrix,
+                .signature  = signature,
+                .cache      = cache ? SH_CACHE(sh) : NULL,
+                .priv       = (void *) params,
+            ));
+        }
+
+        if (!lut && !lut_tex)
             goto fallback;
     }
 
@@ -171,7 +305,17 @@ fallback:
 done: ;
 
     int size = 0;
-    if (lut) {
+    if (layers) {
+        // Temporal offset is baked into the texture, see `expand_temporal`
+        int layer = SH_PARAMS(sh).index % layers;
+        ident_t var = sh_var(sh, (struct pl_shader_var) {
+            .var  = pl_var_int("dither_layer"),
+            .data = &layer,
+            .dynamic = true,
+        });
+        GLSL("ivec3 pos = ivec3(ivec2(gl_FragCoord.xy) & ivec2(%d), "$"); \n",
+             lut_size - 1, var);
+    } else if (lut || lut_tex) {
         size = lut_size;
     } else if (method == PL_DITHER_ORDERED_FIXED) {
         size = 16; // hard-coded size
@@ -225,8 +369,15 @@ done: ;
 
     case PL_DITHER_BLUE_NOISE:
     case PL_DITHER_ORDERED_LUT:
-        pl_assert(lut);
-        GLSL("bias = "$"(ivec2(pos * "$"));\n", lut, SH_FLOAT(lut_size));
+        if (layers) {
+            GLSL("bias = texelFetch("$", pos, 0).x;\n", lut_tex);
+        } else if (lut_tex) {
+            GLSL("bias = texelFetch("$", ivec2(pos * "$"), 0).x;\n",
+                 lut_tex, SH_FLOAT(lut_size));
+        } else {
+            pl_assert(lut);
+            GLSL("bias = "$"(ivec2(pos * "$"));\n", lut, SH_FLOAT(lut_size));
+        }
         break;
 
     case PL_DITHER_METHOD_COUNT:
@@ -322,6 +473,18 @@ size_t pl_error_diffusion_shmem_req(const struct pl_error_diffusion_kernel *kern
     return rows * shifted_columns * sizeof(uint32_t);
 }
 
+int pl_error_diffusion_band_height(const struct pl_error_diffusion_kernel *kernel,
+                                   size_t max_shmem)
+{
+    // Inverse of `pl_error_diffusion_shmem_req`, minus the band overlap
+    size_t shifted_columns = compute_rightmost_shifted_column(kernel) + 1;
+    size_t rows = max_shmem / (shifted_columns * sizeof(uint32_t));
+    if (rows <= PL_EDF_MAX_DY + 2 * PL_EDF_BAND_OVERLAP)
+        return 0;
+
+    return PL_MIN(rows - PL_EDF_MAX_DY - PL_EDF_BAND_OVERLAP, (size_t) INT_MAX);
+}
+
 bool pl_shader_error_diffusion(pl_shader sh, const struct pl_error_diffusion_params *params)
 {
     const int width = params->input_tex->params.w, height = params->input_tex->params.h;
@@ -348,23 +511,37 @@ bool pl_shader_error_diffusion(pl_shader sh, const struct pl_error_diffusion_par
     //           X    7/16                X    7/16
     //    3/16  5/16  1/16   ==>    0     0    3/16  5/16  1/16
 
+    // Optionally, the image is split into horizontal bands which are processed
+    // by independent work groups. Every band except the first additionally
+    // processes the last few rows of the previous band without writing them,
+    // so that the error state has settled by the time its own rows are
+    // reached. (Unlike blending the two results, this keeps every output pixel
+    // quantized to the target depth)
+    int band_height = height, overlap = 0;
+    if (params->band_height > 0 && params->band_height < height) {
+        band_height = params->band_height;
+        overlap = PL_EDF_BAND_OVERLAP;
+    }
+    const int bands = PL_DIV_UP(height, band_height);
+    const int rows = band_height + overlap;
+
     // Figuring out the size of rectangle containing all shifted pixels.
     // The rectangle height is not changed.
-    int shifted_width = width + (height - 1) * kernel->shift;
+    int shifted_width = width + (rows - 1) * kernel->shift;
 
     // We process all pixels from the shifted rectangles column by column, with
-    // a single global work group of size |block_size|.
+    // a single work group of size |block_size| per band.
     // Figuring out how many block are required to process all pixels. We need
     // this explicitly to make the number of barrier() calls match.
-    int block_size = PL_MIN(glsl.max_group_threads, height);
-    int blocks = PL_DIV_UP(height * shifted_width, block_size);
+    int block_size = PL_MIN(glsl.max_group_threads, rows);
+    int blocks = PL_DIV_UP(rows * shifted_width, block_size);
 
     // If we figure out how many of the next columns will be affected while the
     // current columns is being processed. We can store errors of only a few
     // columns in the shared memory. Using a ring buffer will further save the
     // cost while iterating to next column.
     //
-    int ring_buffer_rows = height + PL_EDF_MAX_DY;
+    int ring_buffer_rows = rows + PL_EDF_MAX_DY;
     int ring_buffer_columns = compute_rightmost_shifted_column(kernel) + 1;
     ident_t ring_buffer_size = sh_const(sh, (struct pl_shader_const) {
         .type = PL_VAR_UINT,
@@ -399,15 +576,21 @@ bool pl_shader_error_diffusion(pl_shader sh, const struct pl_error_diffusion_par
     });
 
     sh->output = PL_SHADER_SIG_NONE;
-    sh_describef(sh, "error diffusion (%s, %d bits)",
-                 kernel->name, params->new_depth);
+    if (bands > 1) {
+        sh_describef(sh, "error diffusion (%s, %d bits, %d bands)",
+                     kernel->name, params->new_depth, bands);
+    } else {
+        sh_describef(sh, "error diffusion (%s, %d bits)",
+                     kernel->name, params->new_depth);
+    }
 
     // Defines the ring buffer in shared memory.
     GLSLH("shared uint err_rgb8["$"]; \n", ring_buffer_size);
     GLSL("// pl_shader_error_diffusion                                          \n"
          // Safeguard against accidental over-execution
-         "if (gl_WorkGroupID != uvec3(0))                                       \n"
+         "if (gl_WorkGroupID.xz != uvec2(0) || gl_WorkGroupID.y >= "$")         \n"
          "    return;                                                           \n"
+         "const int band_y0 = int(gl_WorkGroupID.y) * %d - %d;                  \n"
          // Initialize the ring buffer.
          "for (uint i = gl_LocalInvocationIndex; i < "$"; i+=gl_WorkGroupSize.x)\n"
          "    err_rgb8[i] = 0u;                                                 \n"
@@ -422,18 +605,21 @@ bool pl_shader_error_diffusion(pl_shader sh, const struct pl_error_diffusion_par
          "const uint height = "$";                                              \n"
          "int y = int(id %% height), x_shifted = int(id / height);              \n"
          "int x = x_shifted - y * %d;                                           \n"
+         // Position of the pixel within the image
+         "int img_y = band_y0 + y;                                              \n"
          // Proceed only if we are processing a valid pixel.
-         "if (x >= 0 && x < "$") {                                              \n"
+         "if (x >= 0 && x < "$" && img_y >= 0 && img_y < "$") {                 \n"
          // The index that the current pixel have on the ring buffer.
          "uint idx = uint(x_shifted * "$" + y) %% "$";                          \n"
          // Fetch the current pixel.
-         "vec4 pix_orig = texelFetch("$", ivec2(x, y), 0);                      \n"
+         "vec4 pix_orig = texelFetch("$", ivec2(x, img_y), 0);                  \n"
          "vec3 pix = pix_orig.rgb;                                              \n",
+         SH_UINT_DYN(bands), band_height, overlap,
          ring_buffer_size,
-         SH_UINT(blocks),
-         SH_UINT(height),
+         SH_UINT_DYN(blocks),
+         SH_UINT(rows),
          kernel->shift,
-         SH_INT(width),
+         SH_INT_DYN(width), SH_INT_DYN(height),
          SH_INT(ring_buffer_rows),
          ring_buffer_size,
          in_tex);
@@ -474,13 +660,14 @@ bool pl_shader_error_diffusion(pl_shader sh, const struct pl_error_diffusion_par
          "err_rgb8[idx] = 0u;                                                   \n"
          // Write the dithered pixel.
          "vec3 dithered = round(pix);                                           \n"
-         "imageStore("$", ivec2(x, y), vec4(dithered / %d.0, pix_orig.a));      \n"
+         "if (y >= %d)                                                          \n"
+         "    imageStore("$", ivec2(x, img_y), vec4(dithered / %d.0, pix_orig.a));\n"
          // Prepare for error propagation pass
          "vec3 err_divided = (pix - dithered) * %d.0 / %d.0;                    \n"
          "ivec3 tmp;                                                            \n",
          (128u << bitshift_r) | (128u << bitshift_g) | 128u,
          dither_quant, bitshift_r, bitshift_g, uint8_mul,
-         out_img, dither_quant,
+         overlap, out_img, dither_quant,
          uint8_mul, kernel->divisor);
 
     // Group error propagation with same weight factor together, in order to
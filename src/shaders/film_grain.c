@@ -40,6 +40,12 @@ static void sh_grain_uninit(pl_gpu gpu, void *ptr)
     pl_shader_obj_destroy(&obj->h274);
 }
 
+static size_t sh_grain_mem_usage(const void *ptr)
+{
+    const struct sh_grain_obj *obj = ptr;
+    return sh_obj_mem_usage(obj->av1) + sh_obj_mem_usage(obj->h274);
+}
+
 bool pl_shader_film_grain(pl_shader sh, pl_shader_obj *grain_state,
                           const struct pl_film_grain_params *params)
 {
@@ -55,6 +61,7 @@ bool pl_shader_film_grain(pl_shader sh, pl_shader_obj *grain_state,
                  struct sh_grain_obj, sh_grain_uninit);
     if (!obj)
         return false;
+    (*grain_state)->mem_usage = sh_grain_mem_usage;
 
     switch (params->data.type) {
     case PL_FILM_GRAIN_NONE: return false;
@@ -548,6 +548,17 @@ static void av1_grain_uninit(pl_gpu gpu, void *ptr)
     *obj = (struct grain_obj_av1) {0};
 }
 
+static size_t av1_grain_mem_usage(const void *ptr)
+{
+    const struct grain_obj_av1 *obj = ptr;
+    size_t total = sh_obj_mem_usage(obj->lut_offsets);
+    for (int i = 0; i < PL_ARRAY_SIZE(obj->lut_grain); i++)
+        total += sh_obj_mem_usage(obj->lut_grain[i]);
+    for (int i = 0; i < PL_ARRAY_SIZE(obj->lut_scaling); i++)
+        total += sh_obj_mem_usage(obj->lut_scaling[i]);
+    return total;
+}
+
 bool pl_needs_fg_av1(const struct pl_film_grain_params *params)
 {
     const struct pl_av1_grain_data *data = &params->data.params.av1;
@@ -584,11 +595,61 @@ static inline bool av1_grain_data_eq(const struct pl_film_grain_data *da,
            !memcmp(a->ar_coeffs_uv, b->ar_coeffs_uv, sizeof(a->ar_coeffs_uv));
 }
 
-static void fill_grain_lut(void *data, const struct sh_lut_params *params)
+// Uniquely identifies the grain templates generated for a set of parameters
+static uint64_t grain_signature(const struct pl_film_grain_params *params)
+{
+    const struct pl_av1_grain_data *data = &params->data.params.av1;
+    uint64_t sig = pl_var_hash(data->ar_coeffs_y);
+    pl_hash_merge(&sig, pl_var_hash(data->ar_coeffs_uv));
+    pl_hash_merge(&sig, params->data.seed);
+    pl_hash_merge(&sig, bit_depth(params->repr));
+    pl_hash_merge(&sig, data->grain_scale_shift);
+    pl_hash_merge(&sig, data->ar_coeff_lag);
+    pl_hash_merge(&sig, data->ar_coeff_shift);
+    pl_hash_merge(&sig, data->num_points_y > 0);
+    return sig;
+}
+
+struct grain_lut_ctx {
+    struct grain_obj_av1 *obj;
+    const struct pl_film_grain_params *params;
+    enum pl_channel channels[2]; // chroma channels packed into the LUT
+    int sub_x, sub_y;
+    bool has_grain_y; // `obj->grain_tmp_y` is up-to-date
+};
+
+static void fill_grain_y(void *data, const struct sh_lut_params *params)
+{
+    struct grain_lut_ctx *ctx = params->priv;
+    generate_grain_y(data, ctx->obj->grain_tmp_y, ctx->params);
+    ctx->has_grain_y = true;
+}
+
+static void fill_grain_uv(void *data, const struct sh_lut_params *params)
 {
-    struct grain_obj_av1 *obj = params->priv;
-    size_t entries = params->width * params->height * params->comps;
-    memcpy(data, obj->grain, entries * sizeof(float));
+    struct grain_lut_ctx *ctx = params->priv;
+    struct grain_obj_av1 *obj = ctx->obj;
+
+    // Chroma grain is derived from the luma grain, which we may have skipped
+    // (e.g. because the luma LUT was cached, or not needed at all)
+    if (!ctx->has_grain_y && ctx->params->data.params.av1.num_points_y) {
+        generate_grain_y(obj->grain[0], obj->grain_tmp_y, ctx->params);
+        ctx->has_grain_y = true;
+    }
+
+    for (int c = 0; c < params->comps; c++) {
+        generate_grain_uv(&obj->grain[c][0][0], obj->grain_tmp_uv,
+                          obj->grain_tmp_y, ctx->channels[c],
+                          ctx->sub_x, ctx->sub_y, ctx->params);
+    }
+
+    // Interleave the separately generated planes
+    float *out = data;
+    const int size = params->width * params->height;
+    for (int i = 0; i < size; i++) {
+        for (int c = 0; c < params->comps; c++)
+            *out++ = (&obj->grain[c][0][0])[i];
+    }
 }
 
 bool pl_shader_fg_av1(pl_shader sh, pl_shader_obj *grain_state,
@@ -647,6 +708,7 @@ bool pl_shader_fg_av1(pl_shader sh, pl_shader_obj *grain_state,
                  struct grain_obj_av1, av1_grain_uninit);
     if (!obj)
         return false;
+    (*grain_state)->mem_usage = av1_grain_mem_usage;
 
     // Note: In theory we could check only the parameters related to luma or
     // only related to chroma and skip updating for changes to irrelevant
@@ -658,11 +720,18 @@ bool pl_shader_fg_av1(pl_shader sh, pl_shader_obj *grain_state,
                         fg_has_u != obj->fg_has_u ||
                         fg_has_v != obj->fg_has_v;
 
-    if (needs_update) {
-        // This is needed even for chroma, so statically generate it
-        generate_grain_y(obj->grain[0], obj->grain_tmp_y, params);
-    }
+    // The grain templates only depend on the seed and a few parameters, so
+    // they are generated lazily and cached by signature. This avoids the
+    // (relatively expensive) auto-regressive filtering for seeds that have
+    // been seen before, e.g. when looping or seeking.
+    struct grain_lut_ctx grain_ctx = {
+        .obj    = obj,
+        .params = params,
+        .sub_x  = sub_x,
+        .sub_y  = sub_y,
+    };
 
+    const uint64_t grain_sig = grain_signature(params);
     ident_t lut[3];
     int idx[3] = {-1};
 
@@ -674,10 +743,11 @@ bool pl_shader_fg_av1(pl_shader sh, pl_shader_obj *grain_state,
             .width      = GRAIN_WIDTH_LUT,
             .height     = GRAIN_HEIGHT_LUT,
             .comps      = 1,
-            .update     = needs_update,
+            .signature  = grain_sig,
+            .cache      = SH_CACHE(sh),
             .dynamic    = true,
-            .fill       = fill_grain_lut,
-            .priv       = obj,
+            .fill       = fill_grain_y,
+            .priv       = &grain_ctx,
         ));
 
         if (!lut[0]) {
@@ -689,19 +759,18 @@ bool pl_shader_fg_av1(pl_shader sh, pl_shader_obj *grain_state,
     // Try merging the chroma LUTs into a single texture
     int chroma_comps = 0;
     if (fg_has_u) {
-        generate_grain_uv(&obj->grain[chroma_comps][0][0], obj->grain_tmp_uv,
-                          obj->grain_tmp_y, PL_CHANNEL_CB, sub_x, sub_y,
-                          params);
+        grain_ctx.channels[chroma_comps] = PL_CHANNEL_CB;
         idx[1] = chroma_comps++;
     }
     if (fg_has_v) {
-        generate_grain_uv(&obj->grain[chroma_comps][0][0], obj->grain_tmp_uv,
-                          obj->grain_tmp_y, PL_CHANNEL_CR, sub_x, sub_y,
-                          params);
+        grain_ctx.channels[chroma_comps] = PL_CHANNEL_CR;
         idx[2] = chroma_comps++;
     }
 
     if (chroma_comps > 0) {
+        uint64_t chroma_sig = grain_sig;
+        pl_hash_merge(&chroma_sig, fg_has_u | fg_has_v << 1);
+        pl_hash_merge(&chroma_sig, sub_x | sub_y << 1);
         lut[1] = lut[2] = sh_lut(sh, sh_lut_params(
             .object     = &obj->lut_grain[1],
             .var_type   = PL_VAR_FLOAT,
@@ -709,10 +778,11 @@ bool pl_shader_fg_av1(pl_shader sh, pl_shader_obj *grain_state,
             .width      = GRAIN_WIDTH_LUT >> sub_x,
             .height     = GRAIN_HEIGHT_LUT >> sub_y,
             .comps      = chroma_comps,
-            .update     = needs_update,
+            .signature  = chroma_sig,
+            .cache      = SH_CACHE(sh),
             .dynamic    = true,
-            .fill       = fill_grain_lut,
-            .priv       = obj,
+            .fill       = fill_grain_uv,
+            .priv       = &grain_ctx,
         ));
 
         if (!lut[1]) {
@@ -31,7 +31,7 @@ static void prng_shift(uint32_t *state)
 }
 
 
-static void generate_slice(float *out, size_t out_width, uint8_t h, uint8_t v,
+static void generate_slice(int8_t *out, size_t out_width, uint8_t h, uint8_t v,
                            int8_t grain[64][64], int16_t tmp[64][64])
 {
     const uint8_t freq_h = ((h + 3) << 2) - 1;
@@ -87,7 +87,7 @@ static void generate_slice(float *out, size_t out_width, uint8_t h, uint8_t v,
         case 0: case 7:
             // Deblock
             for (int x = 0; x < 64; x++)
-                out[x] = ((grain[y][x] * deblock_coeff) >> 7) / 255.0;
+                out[x] = (grain[y][x] * deblock_coeff) >> 7;
             break;
 
         case 1: case 2:
@@ -95,7 +95,7 @@ static void generate_slice(float *out, size_t out_width, uint8_t h, uint8_t v,
         case 5: case 6:
             // No deblock
             for (int x = 0; x < 64; x++)
-                out[x] = grain[y][x] / 255.0;
+                out[x] = grain[y][x];
             break;
 
         default: pl_unreachable();
@@ -105,26 +105,74 @@ static void generate_slice(float *out, size_t out_width, uint8_t h, uint8_t v,
     }
 }
 
-static void fill_grain_lut(void *data, const struct sh_lut_params *params)
+enum {
+    DB_SIZE = 13 * 64,
+};
+
+// Generates the grain database, with values in the range [-127, 127] that
+// are to be scaled by 1/255
+static void fill_grain_db(int8_t *out)
 {
     struct {
         int8_t grain[64][64];
         int16_t tmp[64][64];
     } *tmp = pl_alloc_ptr(NULL, tmp);
 
-    float *out = data;
-    assert(params->var_type == PL_VAR_FLOAT);
-
     for (int h = 0; h < 13; h++) {
         for (int v = 0; v < 13; v++) {
-            float *slice = out + (h * 64) * params->width + (v * 64);
-            generate_slice(slice, params->width, h, v, tmp->grain, tmp->tmp);
+            int8_t *slice = out + (h * 64) * DB_SIZE + (v * 64);
+            generate_slice(slice, DB_SIZE, h, v, tmp->grain, tmp->tmp);
         }
     }
 
     pl_free(tmp);
 }
 
+// The grain database is static, so it is shared by all shaders on a `pl_gpu`
+// rather than being uploaded for every grain state. Where possible, it is
+// stored as 8-bit SNORM, which represents all values exactly
+static pl_tex create_grain_db(pl_gpu gpu, void *priv)
+{
+    pl_cache cache = priv;
+    pl_cache_obj obj = { .key = CACHE_KEY_H274 };
+    const size_t size = DB_SIZE * DB_SIZE;
+    if (!pl_cache_get(cache, &obj) || obj.size != size) {
+        pl_cache_obj_resize(NULL, &obj, size);
+        pl_clock_t start = pl_clock_now();
+        fill_grain_db(obj.data);
+        pl_log_cpu_time(gpu->log, start, pl_clock_now(), "generating H.274 grain DB");
+    }
+
+    float *data = NULL;
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_SNORM, 1, 8, 8, PL_FMT_CAP_SAMPLEABLE);
+    if (!fmt) {
+        fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 1, 16, 32, PL_FMT_CAP_SAMPLEABLE);
+        data = pl_alloc(NULL, size * sizeof(float));
+        const int8_t *db = obj.data;
+        for (size_t i = 0; i < size; i++)
+            data[i] = db[i] * (1.0f / 127);
+    }
+
+    pl_tex tex = NULL;
+    if (fmt) {
+        tex = pl_tex_create(gpu, pl_tex_params(
+            .w              = DB_SIZE,
+            .h              = DB_SIZE,
+            .format         = fmt,
+            .sampleable     = true,
+            .initial_data   = data ? (void *) data : obj.data,
+            .debug_tag      = PL_DEBUG_TAG,
+        ));
+    }
+
+    if (!tex)
+        PL_ERR(gpu, "Failed creating H.274 grain DB texture!");
+
+    pl_cache_set(cache, &obj);
+    pl_free(data);
+    return tex;
+}
+
 bool pl_needs_fg_h274(const struct pl_film_grain_params *params)
 {
     const struct pl_h274_grain_data *data = &params->data.params.h274;
@@ -151,8 +199,16 @@ bool pl_shader_fg_h274(pl_shader sh, pl_shader_obj *grain_state,
     size_t shmem_req = 0;
     ident_t group_sum = NULL_IDENT;
 
+    // Prefer covering each 8x8 block with a single subgroup, which avoids the
+    // shared memory reduction
     const struct pl_glsl_version glsl = sh_glsl(sh);
-    if (glsl.subgroup_size < 8*8) {
+    uint32_t subgroup_size = glsl.subgroup_size;
+    const bool one_subgroup = glsl.min_subgroup_size <= 8*8 &&
+                              glsl.max_subgroup_size >= 8*8;
+    if (one_subgroup)
+        subgroup_size = 8*8;
+
+    if (subgroup_size < 8*8) {
         group_sum = sh_fresh(sh, "group_sum");
         shmem_req += sizeof(int);
         GLSLH("shared int "$"; \n", group_sum);
@@ -164,17 +220,26 @@ bool pl_shader_fg_h274(pl_shader sh, pl_shader_obj *grain_state,
         return false;
     }
 
-    ident_t db = sh_lut(sh, sh_lut_params(
-        .object     = grain_state,
-        .var_type   = PL_VAR_FLOAT,
-        .lut_type   = SH_LUT_TEXTURE,
-        .width      = 13 * 64,
-        .height     = 13 * 64,
-        .comps      = 1,
-        .fill       = fill_grain_lut,
-        .signature  = CACHE_KEY_H274, // doesn't depend on anything
-        .cache      = SH_CACHE(sh),
-    ));
+    if (one_subgroup && !sh_try_subgroups(sh, 8*8, false)) {
+        SH_FAIL(sh, "Failed requiring subgroup size for H.274 film grain!");
+        return false;
+    }
+
+    pl_gpu gpu = SH_GPU(sh);
+    pl_tex db_tex = pl_gpu_shared_tex(gpu, CACHE_KEY_H274, create_grain_db,
+                                      (void *) SH_CACHE(sh));
+    if (!db_tex) {
+        SH_FAIL(sh, "Failed creating H.274 grain DB!");
+        return false;
+    }
+
+    ident_t db = sh_desc(sh, (struct pl_shader_desc) {
+        .binding.object = db_tex,
+        .desc = (struct pl_desc) {
+            .name = "grain_db",
+            .type = PL_DESC_SAMPLED_TEX,
+        },
+    });
 
     sh_describe(sh, "H.274 film grain");
     GLSL("vec4 color;                       \n"
@@ -195,9 +260,10 @@ bool pl_shader_fg_h274(pl_shader sh, pl_shader_obj *grain_state,
          SH_FLOAT(pl_color_repr_normalize(params->repr)), tex);
 
     const struct pl_h274_grain_data *data = &params->data.params.h274;
+    // Also folds in the scaling of the normalized DB values to [-127, 127] / 255
     ident_t scale_factor = sh_var(sh, (struct pl_shader_var) {
         .var = pl_var_float("scale_factor"),
-        .data = &(float){ 1.0 / (1 << (data->log2_scale_factor + 6)) },
+        .data = &(float){ 127.0 / 255.0 / (1 << (data->log2_scale_factor + 6)) },
     });
 
     // pcg3d (http://www.jcgt.org/published/0009/03/02/)
@@ -228,10 +294,10 @@ bool pl_shader_fg_h274(pl_shader sh, pl_shader_obj *grain_state,
         GLSL("float avg = color[%d] / 64.0; \n", c);
 
         const int precision = 10000000;
-        if (glsl.subgroup_size) {
+        if (subgroup_size) {
             GLSL("avg = subgroupAdd(avg); \n");
 
-            if (glsl.subgroup_size < 8*8) {
+            if (subgroup_size < 8*8) {
                 GLSL("if (subgroupElect())                  \n"
                      "    atomicAdd("$", int(avg * %d.0));  \n"
                      "barrier();                            \n"
@@ -298,7 +364,7 @@ bool pl_shader_fg_h274(pl_shader sh, pl_shader_obj *grain_state,
              // Add local offset and compute grain
              "offset += 8u * (gl_WorkGroupID.xy %% 2u);     \n"
              "offset += gl_LocalInvocationID.xy;            \n"
-             "float grain = "$"(offset);                    \n"
+             "float grain = texelFetch("$", ivec2(offset), 0).x; \n"
              "color[%d] += scale * grain;                   \n",
              scale_factor, c, db, c);
 
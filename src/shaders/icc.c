@@ -17,6 +17,7 @@
 
 #include <math.h>
 #include "shaders.h"
+#include "pl_thread_pool.h"
 
 #include <libplacebo/tone_mapping.h>
 #include <libplacebo/shaders/icc.h>
@@ -256,6 +257,72 @@ static bool detect_contrast(pl_icc_object icc, struct pl_hdr_metadata *hdr,
     return true;
 }
 
+// Results of `detect_csp` and `detect_contrast`, as stored in the cache
+struct cached_info {
+    struct pl_raw_primaries prim;
+    cmsCIEXYZ black;
+    float gamma, gamma_stddev;
+    float min_luma, max_luma;
+    int intent;
+};
+
+static uint64_t info_key(pl_icc_object icc)
+{
+    uint64_t key = CACHE_KEY_ICC_INFO;
+    pl_hash_merge(&key, icc->signature);
+    pl_hash_merge(&key, icc->params.intent);
+    union { double d; uint64_t u; } v = { .d = icc->params.max_luma };
+    pl_hash_merge(&key, v.u);
+    return key;
+}
+
+static bool load_info(struct pl_icc_object_t *icc, uint64_t key)
+{
+    struct icc_priv *p = PL_PRIV(icc);
+    pl_cache cache = icc->params.cache;
+    pl_cache_obj obj = { .key = key };
+    if (!pl_cache_get(cache, &obj))
+        return false;
+
+    bool ok = false;
+    struct cached_info info;
+    if (obj.size != sizeof(info))
+        goto done;
+
+    memcpy(&info, obj.data, sizeof(info));
+    icc->csp.hdr.prim = info.prim;
+    icc->csp.hdr.min_luma = info.min_luma;
+    icc->csp.hdr.max_luma = info.max_luma;
+    icc->params.intent = info.intent;
+    icc->gamma = info.gamma;
+    p->gamma_stddev = info.gamma_stddev;
+    p->black = info.black;
+    PL_DEBUG(p, "Loaded ICC profile detection results from cache");
+    PL_INFO(p, "Using ICC contrast %.0f:1", info.max_luma / info.min_luma);
+    ok = true;
+
+done:
+    pl_cache_set(cache, &obj);
+    return ok;
+}
+
+static void save_info(pl_icc_object icc, uint64_t key)
+{
+    const struct icc_priv *p = PL_PRIV(icc);
+    pl_cache_obj obj = { .key = key };
+    pl_cache_obj_resize(NULL, &obj, sizeof(struct cached_info));
+    memcpy(obj.data, &(struct cached_info) {
+        .prim           = icc->csp.hdr.prim,
+        .black          = p->black,
+        .gamma          = icc->gamma,
+        .gamma_stddev   = p->gamma_stddev,
+        .min_luma       = icc->csp.hdr.min_luma,
+        .max_luma       = icc->csp.hdr.max_luma,
+        .intent         = icc->params.intent,
+    }, sizeof(struct cached_info));
+    pl_cache_set(icc->params.cache, &obj);
+}
+
 static void infer_clut_size(struct pl_icc_object_t *icc)
 {
     struct icc_priv *p = PL_PRIV(icc);
@@ -376,11 +443,17 @@ static bool icc_init(struct pl_icc_object_t *icc)
     if (params->intent < 0 || params->intent > PL_INTENT_ABSOLUTE_COLORIMETRIC)
         params->intent = cmsGetHeaderRenderingIntent(p->profile);
 
+    // The detection results only depend on the profile and these params, so
+    // they can be cached to skip re-running the lcms2 transforms
     struct pl_raw_primaries *out_prim = &icc->csp.hdr.prim;
-    if (!detect_csp(icc, out_prim, &icc->gamma))
-        return false;
-    if (!detect_contrast(icc, &icc->csp.hdr, params, params->max_luma))
-        return false;
+    const uint64_t key = info_key(icc);
+    if (!load_info(icc, key)) {
+        if (!detect_csp(icc, out_prim, &icc->gamma))
+            return false;
+        if (!detect_contrast(icc, &icc->csp.hdr, params, params->max_luma))
+            return false;
+        save_info(icc, key);
+    }
     infer_clut_size(icc);
 
     const struct pl_raw_primaries *best = NULL;
@@ -566,28 +639,22 @@ bool pl_icc_update(pl_log log, pl_icc_object *out_icc,
     return true;
 }
 
-static void fill_lut(void *datap, const struct sh_lut_params *params, bool decode)
-{
-    pl_icc_object icc = params->priv;
-    struct icc_priv *p = PL_PRIV(icc);
-    cmsHPROFILE srcp = decode ? p->profile : p->approx;
-    cmsHPROFILE dstp = decode ? p->approx  : p->profile;
-    int s_r = params->width, s_g = params->height, s_b = params->depth;
-
-    pl_clock_t start = pl_clock_now();
-    cmsHTRANSFORM tf = cmsCreateTransformTHR(p->cms, srcp, TYPE_RGB_16,
-                                             dstp, TYPE_RGBA_16,
-                                             icc->params.intent,
-                                             cmsFLAGS_BLACKPOINTCOMPENSATION |
-                                             cmsFLAGS_NOCACHE | cmsFLAGS_NOOPTIMIZE);
-    if (!tf)
-        return;
-
-    pl_clock_t after_transform = pl_clock_now();
-    pl_log_cpu_time(p->log, start, after_transform, "creating ICC transform");
+struct fill_args {
+    cmsHTRANSFORM tf;
+    uint16_t *data;
+    int s_r, s_g, s_b;
+    int start, count; // range of `b` slices
+    bool force_bpc;
+};
 
+static void fill_slice(void *priv, int idx)
+{
+    const struct fill_args *args = (const struct fill_args *) priv + idx;
+    const int s_r = args->s_r, s_g = args->s_g, s_b = args->s_b;
     uint16_t *tmp = pl_alloc(NULL, s_r * 3 * sizeof(tmp[0]));
-    for (int b = 0; b < s_b; b++) {
+
+    const int end = args->start + args->count;
+    for (int b = args->start; b < end; b++) {
         for (int g = 0; g < s_g; g++) {
             // Transform a single line of the output buffer
             for (int r = 0; r < s_r; r++) {
@@ -597,10 +664,10 @@ static void fill_lut(void *datap, const struct sh_lut_params *params, bool decod
             }
 
             size_t offset = (b * s_g + g) * s_r * 4;
-            uint16_t *data = ((uint16_t *) datap) + offset;
-            cmsDoTransform(tf, tmp, data, s_r);
+            uint16_t *data = args->data + offset;
+            cmsDoTransform(args->tf, tmp, data, s_r);
 
-            if (!icc->params.force_bpc)
+            if (!args->force_bpc)
                 continue;
 
             // Fix the black point manually. Work-around for "improper"
@@ -619,9 +686,54 @@ static void fill_lut(void *datap, const struct sh_lut_params *params, bool decod
         }
     }
 
+    pl_free(tmp);
+}
+
+static void fill_lut(void *datap, const struct sh_lut_params *params, bool decode)
+{
+    pl_icc_object icc = params->priv;
+    struct icc_priv *p = PL_PRIV(icc);
+    cmsHPROFILE srcp = decode ? p->profile : p->approx;
+    cmsHPROFILE dstp = decode ? p->approx  : p->profile;
+    int s_r = params->width, s_g = params->height, s_b = params->depth;
+
+    pl_clock_t start = pl_clock_now();
+    cmsHTRANSFORM tf = cmsCreateTransformTHR(p->cms, srcp, TYPE_RGB_16,
+                                             dstp, TYPE_RGBA_16,
+                                             icc->params.intent,
+                                             cmsFLAGS_BLACKPOINTCOMPENSATION |
+                                             cmsFLAGS_NOCACHE | cmsFLAGS_NOOPTIMIZE);
+    if (!tf)
+        return;
+
+    pl_clock_t after_transform = pl_clock_now();
+    pl_log_cpu_time(p->log, start, after_transform, "creating ICC transform");
+
+    // Split the 3DLUT into slices along the blue axis, and transform them
+    // concurrently. This is safe because `cmsFLAGS_NOCACHE` makes the
+    // transform itself stateless.
+    enum { MAX_SLICES = 32 };
+    struct fill_args args[MAX_SLICES];
+    const int num_per_slice = PL_DIV_UP(s_b, MAX_SLICES);
+    const int num_slices = PL_DIV_UP(s_b, num_per_slice);
+    for (int i = 0; i < num_slices; i++) {
+        const int first = i * num_per_slice;
+        args[i] = (struct fill_args) {
+            .tf         = tf,
+            .data       = datap,
+            .s_r        = s_r,
+            .s_g        = s_g,
+            .s_b        = s_b,
+            .start      = first,
+            .count      = PL_MIN(num_per_slice, s_b - first),
+            .force_bpc  = icc->params.force_bpc,
+        };
+    }
+
+    pl_parallel_for(num_slices, fill_slice, args);
+
     pl_log_cpu_time(p->log, after_transform, pl_clock_now(), "generating ICC 3DLUT");
     cmsDeleteTransform(tf);
-    pl_free(tmp);
 }
 
 static void fill_decode(void *datap, const struct sh_lut_params *params)
@@ -19,6 +19,9 @@
 #include <ctype.h>
 
 #include "shaders.h"
+#include "cache.h"
+#include "pl_thread.h"
+#include "pl_thread_pool.h"
 
 #include <libplacebo/shaders/lut.h>
 
@@ -32,7 +35,137 @@ void pl_lut_free(struct pl_custom_lut **lut)
     pl_free_ptr(lut);
 }
 
+// LUT bodies larger than this are split into chunks parsed in parallel
+#define CUBE_CHUNK_SIZE (1 << 20)
+
+struct cube_chunk {
+    pl_str str;
+    size_t offset; // index of the first value in this chunk
+    size_t count;  // number of values to parse from this chunk
+    size_t parsed;
+};
+
+struct cube_ctx {
+    struct cube_chunk *chunks;
+    float *data;
+    const float *min, *max;
+};
+
+// Number of values in a chunk, using the same delimiters as ccSeqParseDouble
+static void count_cube_chunk(void *priv, int i)
+{
+    struct cube_ctx *ctx = priv;
+    struct cube_chunk *chunk = &ctx->chunks[i];
+    size_t count = 0;
+    bool delim = true;
+    for (size_t n = 0; n < chunk->str.len; n++) {
+        bool d = chunk->str.buf[n] <= ' ';
+        count += delim && !d;
+        delim = d;
+    }
+    chunk->count = count;
+}
+
+static void parse_cube_chunk(void *priv, int i)
+{
+    struct cube_ctx *ctx = priv;
+    struct cube_chunk *chunk = &ctx->chunks[i];
+    float *data = ctx->data + chunk->offset;
+    chunk->parsed = pl_str_parse_floats(&chunk->str, data, chunk->count);
+
+    // Rescale to range 0.0 - 1.0
+    for (size_t n = 0; n < chunk->parsed; n++) {
+        const int c = (chunk->offset + n) % 3;
+        data[n] = (data[n] - ctx->min[c]) / (ctx->max[c] - ctx->min[c]);
+    }
+}
+
+static bool parse_cube_body(pl_log log, pl_str str, float *data, size_t total,
+                            const float min[3], const float max[3])
+{
+    // Split the body on line boundaries, so no value straddles two chunks
+    void *tmp = pl_tmp(NULL);
+    PL_ARRAY(struct cube_chunk) chunks = {0};
+    const uint8_t *end = str.buf + str.len;
+    do {
+        pl_str chunk = pl_str_take(str, CUBE_CHUNK_SIZE);
+        if (chunk.len < str.len) {
+            int eol = pl_strchr(pl_str_drop(str, chunk.len), '\n');
+            chunk.len = eol < 0 ? str.len : chunk.len + eol + 1;
+        }
+        PL_ARRAY_APPEND(tmp, chunks, (struct cube_chunk) { .str = chunk });
+        str = pl_str_drop(str, chunk.len);
+    } while (str.len);
+
+    struct cube_ctx ctx = {
+        .chunks = chunks.elem,
+        .data   = data,
+        .min    = min,
+        .max    = max,
+    };
+
+    // The offset of each chunk depends on the value counts of all previous
+    // chunks, which is much cheaper to determine than the values themselves
+    pl_parallel_for(chunks.num - 1, count_cube_chunk, &ctx);
+    size_t offset = 0;
+    for (int i = 0; i < chunks.num; i++) {
+        struct cube_chunk *chunk = &chunks.elem[i];
+        chunk->offset = PL_MIN(offset, total);
+        chunk->count = i + 1 < chunks.num ? chunk->count : SIZE_MAX;
+        chunk->count = PL_MIN(chunk->count, total - chunk->offset);
+        offset += chunk->count;
+    }
+
+    pl_parallel_for(chunks.num, parse_cube_chunk, &ctx);
+
+    bool ok = false;
+    for (int i = 0; i < chunks.num; i++) {
+        struct cube_chunk *chunk = &chunks.elem[i];
+        if (chunk->parsed == chunk->count && chunk->offset + chunk->count < total)
+            continue;
+
+        if (chunk->parsed < chunk->count && !chunk->str.len) {
+            pl_err(log, "Failed parsing LUT: Unexpected EOF, expected "
+                   "%zu entries, got %zu", total, chunk->offset + chunk->parsed);
+        } else if (chunk->parsed < chunk->count) {
+            pl_err(log, "Failed parsing float value '%.*s'",
+                   PL_STR_FMT(pl_str_split_chars(chunk->str, " \t\r\n", NULL)));
+        } else {
+            // Everything after the last value is contiguous with this chunk
+            pl_str rest = { chunk->str.buf, end - chunk->str.buf };
+            rest = pl_str_strip(rest);
+            if (rest.len)
+                pl_warn(log, "Extra data after LUT?... ignoring '%c'", rest.buf[0]);
+            ok = true;
+        }
+        break;
+    }
+
+    pl_free(tmp);
+    return ok;
+}
+
+static bool load_cube(struct pl_custom_lut *lut, pl_cache cache, uint64_t key,
+                      size_t num_values)
+{
+    pl_cache_obj obj = { .key = key };
+    if (!pl_cache_get(cache, &obj))
+        return false;
+
+    bool ok = obj.size == num_values * sizeof(float);
+    if (ok)
+        lut->data = pl_memdup(lut, obj.data, obj.size);
+    pl_cache_set(cache, &obj);
+    return ok;
+}
+
 struct pl_custom_lut *pl_lut_parse_cube(pl_log log, const char *cstr, size_t cstr_len)
+{
+    return pl_lut_parse_cube_ex(log, NULL, cstr, cstr_len);
+}
+
+struct pl_custom_lut *pl_lut_parse_cube_ex(pl_log log, pl_cache cache,
+                                           const char *cstr, size_t cstr_len)
 {
     struct pl_custom_lut *lut = pl_zalloc_ptr(NULL, lut);
     pl_str str = (pl_str) { (uint8_t *) cstr, cstr_len };
@@ -89,11 +222,7 @@ struct pl_custom_lut *pl_lut_parse_cube(pl_log log, const char *cstr, size_t cst
         }
 
         if (pl_str_eatstart0(&line, "DOMAIN_MIN")) {
-            line = pl_str_strip(line);
-            if (!pl_str_parse_float(pl_str_split_char(line, ' ', &line), &min[0]) ||
-                !pl_str_parse_float(pl_str_split_char(line, ' ', &line), &min[1]) ||
-                !pl_str_parse_float(line, &min[2]))
-            {
+            if (pl_str_parse_floats(&line, min, 3) != 3) {
                 pl_err(log, "Failed parsing domain: '%.*s'", PL_STR_FMT(line));
                 goto error;
             }
@@ -101,11 +230,7 @@ struct pl_custom_lut *pl_lut_parse_cube(pl_log log, const char *cstr, size_t cst
         }
 
         if (pl_str_eatstart0(&line, "DOMAIN_MAX")) {
-            line = pl_str_strip(line);
-            if (!pl_str_parse_float(pl_str_split_char(line, ' ', &line), &max[0]) ||
-                !pl_str_parse_float(pl_str_split_char(line, ' ', &line), &max[1]) ||
-                !pl_str_parse_float(line, &max[2]))
-            {
+            if (pl_str_parse_floats(&line, max, 3) != 3) {
                 pl_err(log, "Failed parsing domain: '%.*s'", PL_STR_FMT(line));
                 goto error;
             }
@@ -133,51 +258,27 @@ struct pl_custom_lut *pl_lut_parse_cube(pl_log log, const char *cstr, size_t cst
         }
     }
 
-    float *data = pl_alloc(lut, sizeof(float[3]) * entries);
-    lut->data = data;
+    const size_t total = (size_t) entries * 3;
+    uint64_t key = CACHE_KEY_CUBE_LUT;
+    pl_hash_merge(&key, lut->signature);
+    if (load_cube(lut, cache, key, total)) {
+        pl_debug(log, "Loaded .cube LUT data from cache");
+        return lut;
+    }
 
     // Parse LUT body
+    float *data = pl_alloc(lut, total * sizeof(float));
+    lut->data = data;
     pl_clock_t start = pl_clock_now();
-    for (int n = 0; n < entries; n++) {
-        for (int c = 0; c < 3; c++) {
-            static const char * const digits = "0123456789.-+e";
-
-            // Extract valid digit sequence
-            size_t len = pl_strspn(str, digits);
-            pl_str entry = (pl_str) { str.buf, len };
-            str.buf += len;
-            str.len -= len;
-
-            if (!entry.len) {
-                if (!str.len) {
-                    pl_err(log, "Failed parsing LUT: Unexpected EOF, expected "
-                           "%d entries, got %d", entries * 3, n * 3 + c + 1);
-                } else {
-                    pl_err(log, "Failed parsing LUT: Unexpected '%c', expected "
-                           "digit", str.buf[0]);
-                }
-                goto error;
-            }
-
-            float num;
-            if (!pl_str_parse_float(entry, &num)) {
-                pl_err(log, "Failed parsing float value '%.*s'", PL_STR_FMT(entry));
-                goto error;
-            }
-
-            // Rescale to range 0.0 - 1.0
-            *data++ = (num - min[c]) / (max[c] - min[c]);
-
-            // Skip whitespace between digits
-            str = pl_str_strip(str);
-        }
-    }
-
-    str = pl_str_strip(str);
-    if (str.len)
-        pl_warn(log, "Extra data after LUT?... ignoring '%c'", str.buf[0]);
+    if (!parse_cube_body(log, str, data, total, min, max))
+        goto error;
 
     pl_log_cpu_time(log, start, pl_clock_now(), "parsing .cube LUT");
+    if (cache) {
+        const size_t size = total * sizeof(float);
+        pl_str buf = { pl_memdup(NULL, data, size), size };
+        pl_cache_str(cache, key, &buf);
+    }
     return lut;
 
 error:
@@ -294,6 +395,32 @@ static ident_t texel_scale(pl_shader sh, int lut_size, bool normalized)
     return name;
 }
 
+// Background generation of the contents of a LUT
+struct lut_job {
+    struct sh_lut_params params; // with `priv` pointing to a private copy
+    pl_thread thread;
+    void *data;
+    size_t size;
+    atomic_bool done;
+};
+
+static PL_THREAD_VOID lut_job_thread(void *arg)
+{
+    struct lut_job *job = arg;
+    job->params.fill(job->data, &job->params);
+    atomic_store(&job->done, true);
+    PL_THREAD_RETURN();
+}
+
+static void lut_job_destroy(struct lut_job **job)
+{
+    if (!*job)
+        return;
+
+    pl_thread_join((*job)->thread);
+    pl_free_ptr(job);
+}
+
 struct sh_lut_obj {
     enum sh_lut_type type;
     enum sh_lut_method method;
@@ -301,24 +428,124 @@ struct sh_lut_obj {
     pl_fmt fmt;
     int width, height, depth, comps;
     uint64_t signature;
+    size_t size; // in bytes, for `pl_shader_info.lut_bytes`
     bool error; // reset if params change
 
     // weights, depending on the lut type
     pl_tex tex;
     pl_str str;
     void *data;
+    bool shared; // `tex` is owned by `pl_gpu_shared_tex_acquire`
+
+    // pending asynchronous LUT generation, or NULL
+    struct lut_job *job;
 };
 
+static void lut_tex_free(pl_gpu gpu, struct sh_lut_obj *lut)
+{
+    if (lut->shared) {
+        pl_gpu_shared_tex_release(gpu, &lut->tex);
+    } else {
+        pl_tex_destroy(gpu, &lut->tex);
+    }
+    lut->shared = false;
+}
+
 static void sh_lut_uninit(pl_gpu gpu, void *ptr)
 {
     struct sh_lut_obj *lut = ptr;
-    pl_tex_destroy(gpu, &lut->tex);
+    lut_job_destroy(&lut->job);
+    lut_tex_free(gpu, lut);
     pl_free(lut->str.buf);
     pl_free(lut->data);
 
     *lut = (struct sh_lut_obj) {0};
 }
 
+static size_t sh_lut_mem_usage(const void *ptr)
+{
+    const struct sh_lut_obj *lut = ptr;
+    return lut->shared ? 0 : pl_tex_mem_size(lut->tex); // shared with others
+}
+
+enum lut_job_status {
+    LUT_JOB_READY,      // `obj` contains the generated LUT data
+    LUT_JOB_PENDING,    // still generating, keep using the previous LUT
+    LUT_JOB_FAILED,     // could not start a background job
+};
+
+// Polls (or starts) the asynchronous generation of the LUT described by
+// `params`, collecting the result into `obj` once done
+static enum lut_job_status lut_job_poll(pl_shader sh, struct sh_lut_obj *lut,
+                                        const struct sh_lut_params *params,
+                                        pl_cache_obj *obj, size_t size)
+{
+    struct lut_job *job = lut->job;
+    if (job && !atomic_load(&job->done)) {
+        pl_cache_obj_free(obj);
+        return LUT_JOB_PENDING;
+    }
+
+    if (job && job->params.signature == params->signature && job->size == size) {
+        pl_thread_join(job->thread);
+        pl_cache_obj_free(obj);
+        obj->data = pl_steal(NULL, job->data);
+        obj->size = size;
+        obj->free = pl_free;
+        pl_free_ptr(&lut->job);
+        PL_DEBUG(sh, "Swapping in asynchronously generated LUT");
+        return LUT_JOB_READY;
+    }
+
+    // No job yet, or it only finished a now-outdated LUT
+    lut_job_destroy(&lut->job);
+    job = pl_zalloc_ptr(NULL, job);
+    job->params = *params;
+    job->params.object = NULL;
+    job->params.cache = NULL;
+    if (params->priv_size)
+        job->params.priv = pl_memdup(job, params->priv, params->priv_size);
+    job->data = pl_zalloc(job, size);
+    job->size = size;
+    atomic_init(&job->done, false);
+    if (pl_thread_create(&job->thread, lut_job_thread, job) != 0) {
+        pl_free(job);
+        return LUT_JOB_FAILED;
+    }
+
+    PL_DEBUG(sh, "Generating LUT asynchronously, keeping previous LUT for now");
+    lut->job = job;
+    pl_cache_obj_free(obj);
+    return LUT_JOB_PENDING;
+}
+
+// Static texture LUTs with the same contents are shared by all LUT objects on
+// the same GPU. The signature identifies the contents, but not the layout.
+static uint64_t lut_shared_key(const struct sh_lut_params *params,
+                               pl_fmt texfmt, int texdim)
+{
+    struct {
+        int w, h, d, texdim;
+        pl_fmt fmt;
+    } layout = {
+        .w      = params->width,
+        .h      = params->height,
+        .d      = params->depth,
+        .texdim = texdim,
+        .fmt    = texfmt,
+    };
+
+    uint64_t key = CACHE_KEY_SH_LUT ^ params->signature;
+    pl_hash_merge(&key, pl_mem_hash(&layout, sizeof(layout)));
+    return key;
+}
+
+static pl_tex create_lut_tex(pl_gpu gpu, void *priv)
+{
+    const struct pl_tex_params *params = priv;
+    return pl_tex_create(gpu, params);
+}
+
 // Maximum number of floats to embed as a literal array (when using SH_LUT_AUTO)
 #define SH_LUT_MAX_LITERAL_SOFT 64
 #define SH_LUT_MAX_LITERAL_HARD 256
@@ -355,11 +582,12 @@ ident_t sh_lut(pl_shader sh, const struct sh_lut_params *params)
 
     if (!lut)
         return NULL_IDENT;
+    (*params->object)->mem_usage = sh_lut_mem_usage;
 
-    bool update = params->update || lut->signature != params->signature ||
-                  vartype != lut->vartype || params->fmt != lut->fmt ||
-                  params->width != lut->width || params->height != lut->height ||
-                  params->depth != lut->depth || params->comps != lut->comps;
+    bool reshape = vartype != lut->vartype || params->fmt != lut->fmt ||
+                   params->width != lut->width || params->height != lut->height ||
+                   params->depth != lut->depth || params->comps != lut->comps;
+    bool update = params->update || lut->signature != params->signature || reshape;
 
     if (lut->error && !update)
         return NULL_IDENT; // suppress error spam until something changes
@@ -462,8 +690,16 @@ next_dim: ; // `continue` out of the inner loop
     }
 
     // Reinitialize the existing LUT if needed
-    update |= type != lut->type;
-    update |= method != lut->method;
+    reshape |= type != lut->type;
+    reshape |= method != lut->method;
+    update |= reshape;
+
+    // The previous LUT can only stand in for the new one if just the
+    // contents changed
+    const bool async = params->async && lut->size && !reshape &&
+                       !params->update && !params->dynamic;
+    if (!async)
+        lut_job_destroy(&lut->job);
 
     if (update) {
         if (params->dynamic)
@@ -474,9 +710,32 @@ next_dim: ; // `continue` out of the inner loop
             el_size = texfmt->texel_size;
 
         size_t buf_size = size * el_size;
+        uint64_t shared_key = 0;
+        if (type == SH_LUT_TEXTURE && texdim && texfmt && params->signature &&
+            !params->dynamic)
+        {
+            shared_key = lut_shared_key(params, texfmt, texdim);
+            pl_tex tex = pl_gpu_shared_tex_acquire(gpu, shared_key, NULL, NULL);
+            if (tex) {
+                PL_DEBUG(sh, "Re-using shared LUT texture (0x%"PRIx64")",
+                         shared_key);
+                lut_job_destroy(&lut->job);
+                lut_tex_free(gpu, lut);
+                lut->tex = tex;
+                lut->shared = true;
+                goto update_done;
+            }
+        }
+
+        enum lut_job_status status = LUT_JOB_FAILED;
         if (pl_cache_get(params->cache, &obj) && obj.size == buf_size) {
             PL_DEBUG(sh, "Re-using cached LUT (0x%"PRIx64") with size %zu",
                      obj.key, obj.size);
+        } else if (async &&
+                   (status = lut_job_poll(sh, lut, params, &obj, buf_size)) != LUT_JOB_FAILED)
+        {
+            if (status == LUT_JOB_PENDING)
+                goto done;
         } else {
             PL_DEBUG(sh, "LUT invalidated, regenerating..");
             pl_cache_obj_resize(NULL, &obj, buf_size);
@@ -514,6 +773,8 @@ next_dim: ; // `continue` out of the inner loop
 
             bool ok;
             if (params->dynamic) {
+                if (lut->shared)
+                    lut_tex_free(gpu, lut);
                 ok = pl_tex_recreate(gpu, &lut->tex, &tex_params);
                 if (ok) {
                     ok = pl_tex_upload(gpu, pl_tex_transfer_params(
@@ -523,8 +784,15 @@ next_dim: ; // `continue` out of the inner loop
                 }
             } else {
                 // Can't use pl_tex_recreate because of `initial_data`
-                pl_tex_destroy(gpu, &lut->tex);
-                lut->tex = pl_tex_create(gpu, &tex_params);
+                lut_tex_free(gpu, lut);
+                if (shared_key) {
+                    lut->tex = pl_gpu_shared_tex_acquire(gpu, shared_key,
+                                                         create_lut_tex,
+                                                         &tex_params);
+                    lut->shared = lut->tex;
+                } else {
+                    lut->tex = pl_tex_create(gpu, &tex_params);
+                }
                 ok = lut->tex;
             }
 
@@ -587,6 +855,9 @@ next_dim: ; // `continue` out of the inner loop
             pl_unreachable();
         }
 
+        pl_cache_set(params->cache, &obj);
+
+update_done:
         lut->type = type;
         lut->method = method;
         lut->vartype = vartype;
@@ -596,10 +867,12 @@ next_dim: ; // `continue` out of the inner loop
         lut->depth = params->depth;
         lut->comps = params->comps;
         lut->signature = params->signature;
-        pl_cache_set(params->cache, &obj);
+        lut->size = buf_size;
     }
 
+done:
     // Done updating, generate the GLSL
+    sh->info->info.lut_bytes += lut->size;
     ident_t name = sh_fresh(sh, "lut");
     ident_t arr_name = NULL_IDENT;
 
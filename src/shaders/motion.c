@@ -0,0 +1,134 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "shaders.h"
+
+#include <libplacebo/shaders/motion.h>
+
+const struct pl_motion_params pl_motion_default_params = { PL_MOTION_DEFAULTS };
+
+bool pl_shader_motion_downscale(pl_shader sh, pl_tex src, bool luma)
+{
+    const int w = PL_DIV_UP(src->params.w, 2), h = PL_DIV_UP(src->params.h, 2);
+    if (!sh_require(sh, PL_SHADER_SIG_NONE, w, h))
+        return false;
+
+    ident_t pos, pt;
+    ident_t tex = sh_bind(sh, src, PL_TEX_ADDRESS_CLAMP, PL_TEX_SAMPLE_NEAREST,
+                          "src", NULL, &pos, &pt);
+    if (!tex)
+        return false;
+
+    // `pos` is the center of each output texel, which is the shared corner
+    // of the four source texels being averaged
+    sh_describe(sh, "motion pyramid");
+    GLSL("vec4 color = vec4(0.0, 0.0, 0.0, 1.0);                            \n"
+         "// pl_shader_motion_downscale                                     \n"
+         "{                                                                 \n"
+         "vec2 pos = "$", pt = "$";                                         \n"
+         "float sum = 0.0;                                                  \n"
+         "for (int y = 0; y < 2; y++) {                                     \n"
+         "    for (int x = 0; x < 2; x++) {                                 \n"
+         "        vec2 off = vec2(float(x), float(y)) - vec2(0.5);          \n"
+         "        vec4 c = textureLod("$", pos + off * pt, 0.0);            \n"
+         "        sum += %s;                                                \n"
+         "    }                                                             \n"
+         "}                                                                 \n"
+         "color.x = 0.25 * sum;                                             \n"
+         "}                                                                 \n",
+         pos, pt, tex,
+         luma ? "dot(c.rgb, vec3(0.2126, 0.7152, 0.0722))" : "c.x");
+    return true;
+}
+
+bool pl_shader_motion_estimate(pl_shader sh, const struct pl_motion_source *src,
+                               const struct pl_motion_params *params)
+{
+    params = PL_DEF(params, &pl_motion_default_params);
+    pl_tex prev = src->prev, next = src->next;
+    pl_assert(prev && next);
+    pl_assert(prev->params.w == next->params.w);
+    pl_assert(prev->params.h == next->params.h);
+
+    const int bs = PL_CLAMP(PL_DEF(params->block_size, 8), 2, 16);
+    const int range = PL_CLAMP(PL_DEF(params->search_radius, 2), 1, 4);
+    const int bw = PL_DIV_UP(prev->params.w, bs), bh = PL_DIV_UP(prev->params.h, bs);
+    if (!sh_require(sh, PL_SHADER_SIG_NONE, bw, bh))
+        return false;
+
+    ident_t pos, pt;
+    ident_t tex_prev = sh_bind(sh, prev, PL_TEX_ADDRESS_CLAMP, PL_TEX_SAMPLE_NEAREST,
+                               "prev", NULL, &pos, &pt);
+    ident_t tex_next = sh_bind(sh, next, PL_TEX_ADDRESS_CLAMP, PL_TEX_SAMPLE_NEAREST,
+                               "next", NULL, NULL, NULL);
+    if (!tex_prev || !tex_next)
+        return false;
+
+    sh_describe(sh, "motion estimation");
+    GLSL("vec4 color = vec4(0.0, 0.0, 0.0, 1.0);                            \n"
+         "// pl_shader_motion_estimate                                      \n"
+         "{                                                                 \n"
+         "vec2 pt = "$";                                                    \n"
+         "vec2 base = floor("$" * vec2(%d.0, %d.0)) * vec2(%d.0) * pt;      \n"
+         "vec2 mv0 = vec2(0.0);                                             \n",
+         pt, pos, bw, bh, bs);
+
+    if (src->coarse) {
+        ident_t cpos;
+        ident_t coarse = sh_bind(sh, src->coarse, PL_TEX_ADDRESS_CLAMP,
+                                 PL_TEX_SAMPLE_NEAREST, "coarse", NULL, &cpos, NULL);
+        if (!coarse)
+            return false;
+
+        // Snap the predictor to the texel grid of this level, so that the
+        // search below only ever compares whole texels
+        GLSL("mv0 = textureLod("$", "$", 0.0).xy;       \n"
+             "mv0 = floor(mv0 / pt + vec2(0.5)) * pt;   \n",
+             coarse, cpos);
+    }
+
+    // Slightly penalize deviations from the predictor, to avoid the field
+    // jittering around in flat regions where every candidate matches equally
+    static const float penalty = 0.02f;
+    GLSL("float best = 1e30;                                                \n"
+         "vec2 best_mv = mv0;                                               \n"
+         "for (int dy = -%d; dy <= %d; dy++) {                              \n"
+         "for (int dx = -%d; dx <= %d; dx++) {                              \n"
+         "    vec2 d = vec2(float(dx), float(dy));                          \n"
+         "    vec2 mv = mv0 + d * pt;                                       \n"
+         "    float cost = 0.0;                                             \n"
+         "    for (int by = 0; by < %d; by++) {                             \n"
+         "        for (int bx = 0; bx < %d; bx++) {                         \n"
+         "            vec2 q = base + (vec2(float(bx), float(by)) + vec2(0.5)) * pt; \n"
+         "            cost += abs(textureLod("$", q, 0.0).x -               \n"
+         "                        textureLod("$", q + mv, 0.0).x);          \n"
+         "        }                                                         \n"
+         "    }                                                             \n"
+         "    cost *= 1.0 + "$" * (abs(d.x) + abs(d.y));                    \n"
+         "    if (cost < best) {                                            \n"
+         "        best = cost;                                              \n"
+         "        best_mv = mv;                                             \n"
+         "    }                                                             \n"
+         "}                                                                 \n"
+         "}                                                                 \n"
+         "color.xyz = vec3(best_mv, best / %d.0);                           \n"
+         "}                                                                 \n",
+         range, range, range, range, bs, bs, tex_prev, tex_next,
+         SH_FLOAT(penalty), bs * bs);
+
+    return true;
+}
@@ -17,6 +17,7 @@
 
 #include <math.h>
 #include "shaders.h"
+#include "filters.h"
 
 #include <libplacebo/colorspace.h>
 #include <libplacebo/shaders/sampling.h>
@@ -34,6 +35,21 @@ static inline struct pl_tex_params src_params(const struct pl_sample_src *src)
     };
 }
 
+// Helper function to compute the effective src/dst sizes
+static void src_dims(const struct pl_sample_src *src, float *src_w, float *src_h,
+                     int *out_w, int *out_h)
+{
+    *src_w = src->tex ? pl_rect_w(src->rect) : src->sampled_w;
+    *src_h = src->tex ? pl_rect_h(src->rect) : src->sampled_h;
+    *src_w = PL_DEF(*src_w, src_params(src).w);
+    *src_h = PL_DEF(*src_h, src_params(src).h);
+    pl_assert(*src_w && *src_h);
+
+    *out_w = PL_DEF(src->new_w, roundf(fabs(*src_w)));
+    *out_h = PL_DEF(src->new_h, roundf(fabs(*src_h)));
+    pl_assert(*out_w && *out_h);
+}
+
 enum filter {
     NEAREST = PL_TEX_SAMPLE_NEAREST,
     LINEAR  = PL_TEX_SAMPLE_LINEAR,
@@ -49,15 +65,12 @@ static bool setup_src(pl_shader sh, const struct pl_sample_src *src,
                       enum filter filter)
 {
     enum pl_shader_sig sig;
-    float src_w, src_h;
     enum pl_tex_sample_mode sample_mode;
     if (src->tex) {
         pl_fmt fmt = src->tex->params.format;
         bool can_linear = fmt->caps & PL_FMT_CAP_LINEAR;
         pl_assert(pl_tex_params_dimension(src->tex->params) == 2);
         sig = PL_SHADER_SIG_NONE;
-        src_w = pl_rect_w(src->rect);
-        src_h = pl_rect_h(src->rect);
         switch (filter) {
         case FASTEST:
         case NEAREST:
@@ -79,8 +92,6 @@ static bool setup_src(pl_shader sh, const struct pl_sample_src *src,
     } else {
         pl_assert(src->tex_w && src->tex_h);
         sig = PL_SHADER_SIG_SAMPLER;
-        src_w = src->sampled_w;
-        src_h = src->sampled_h;
         if (filter == BEST || filter == FASTEST) {
             sample_mode = src->mode;
         } else {
@@ -93,13 +104,9 @@ static bool setup_src(pl_shader sh, const struct pl_sample_src *src,
         }
     }
 
-    src_w = PL_DEF(src_w, src_params(src).w);
-    src_h = PL_DEF(src_h, src_params(src).h);
-    pl_assert(src_w && src_h);
-
-    int out_w = PL_DEF(src->new_w, roundf(fabs(src_w)));
-    int out_h = PL_DEF(src->new_h, roundf(fabs(src_h)));
-    pl_assert(out_w && out_h);
+    float src_w, src_h;
+    int out_w, out_h;
+    src_dims(src, &src_w, &src_h, &out_w, &out_h);
 
     if (ratio_x)
         *ratio_x = out_w / fabs(src_w);
@@ -211,15 +218,17 @@ void pl_shader_deband(pl_shader sh, const struct pl_sample_src *src,
          tex, swiz, sh_float_type(mask));
 
     ident_t prng = sh_prng(sh, true, NULL);
-    GLSL("T avg, diff, bound;   \n"
-         "T res = color.%s;     \n"
+    const char *prec = sh_mediump(sh);
+    GLSL("%sT avg, diff, bound; \n"
+         "%sT res = color.%s;   \n"
          "vec2 d;               \n",
-         swiz);
+         prec, prec, swiz);
 
     if (params->iterations > 0) {
         ident_t radius = sh_const_float(sh, "radius", params->radius);
         ident_t threshold = sh_const_float(sh, "threshold",
                                            params->threshold / (1000 * scale));
+        int nested = 0;
 
         // For each iteration, compute the average at a given distance and
         // pick it instead of the color if the difference is below the threshold.
@@ -245,7 +254,20 @@ void pl_shader_deband(pl_shader sh, const struct pl_sample_src *src,
             } else {
                 GLSL("res = mix(avg, res, diff > bound); \n");
             }
+
+            // Skip the remaining iterations for detailed pixels
+            if (params->early_exit && i < params->iterations) {
+                if (num_comps > 1) {
+                    GLSL("if (!all(greaterThan(diff, bound))) { \n");
+                } else {
+                    GLSL("if (diff <= bound) { \n");
+                }
+                nested++;
+            }
         }
+
+        for (; nested > 0; nested--)
+            GLSL("} \n");
     }
 
     // Add some random noise to smooth out residual differences
@@ -257,9 +279,9 @@ void pl_shader_deband(pl_shader sh, const struct pl_sample_src *src,
                  SH_FLOAT(params->grain_neutral[c] / scale));
         }
         GLSL(");                                        \n"
-             "T strength = min(abs(res - bound), "$");  \n"
+             "%sT strength = min(abs(res - bound), "$");\n"
              "res += strength * (T("$") - T(0.5));      \n",
-             SH_FLOAT(params->grain / (1000.0 * scale)), prng);
+             prec, SH_FLOAT(params->grain / (1000.0 * scale)), prng);
     }
 
     GLSL("color.%s = res;   \n"
@@ -496,9 +518,11 @@ static void describe_filter(pl_shader sh, const struct pl_filter_config *cfg,
 // If `in` is NULL, samples directly
 // If `in` is set, takes the pixel from inX[idx] where X is the component,
 // `in` is the given identifier, and `idx` must be defined by the caller
+// If `tap` is set, the pixel is passed through this function before use
 static void polar_sample(pl_shader sh, pl_filter filter,
                          ident_t tex, ident_t lut, ident_t radius,
-                         int x, int y, uint8_t comp_mask, ident_t in,
+                         ident_t radius_inv, ident_t ar_radius, int x, int y,
+                         uint8_t comp_mask, ident_t in, ident_t tap,
                          bool use_ar, float scale)
 {
     // Since we can't know the subpixel position in advance, assume a
@@ -514,15 +538,14 @@ static void polar_sample(pl_shader sh, pl_filter filter,
     bool maybe_skippable = dmin >= filter->radius - M_SQRT2;
 
     // Check for samples that definitely won't contribute to anti-ringing
-    const float ar_radius = filter->radius_zero;
-    use_ar &= dmin < ar_radius;
+    use_ar &= dmin < filter->radius_zero;
 
 #pragma GLSL                                                    \
     offset = ivec2(${const int: x}, ${const int: y});           \
     d = length(vec2(offset) - fcoord);                          \
     @if (maybe_skippable)                                       \
         if (d < $radius) {                                      \
-    w = $lut(d * 1.0 / $radius);                                \
+    w = $lut(d * $radius_inv);                                  \
     wsum += w;                                                  \
     @if (in != NULL_IDENT) {                                    \
         @for (c : comp_mask)                                    \
@@ -530,10 +553,12 @@ static void polar_sample(pl_shader sh, pl_filter filter,
     @} else {                                                   \
         c = textureLod($tex, base + pt * vec2(offset), 0.0);    \
     @}                                                          \
+    @if (tap != NULL_IDENT)                                     \
+        c = $tap(c);                                            \
     @for (c : comp_mask)                                        \
         color[@c] += w * c[@c];                                 \
     @if (use_ar) {                                              \
-        if (d <= ${const float: ar_radius}) {                   \
+        if (d <= $ar_radius) {                                  \
             @for (c : comp_mask) {                              \
                 cc = vec2(${float: scale} * c[@c]);             \
                 cc.x = 1.0 - cc.x;                              \
@@ -555,6 +580,7 @@ static void polar_sample(pl_shader sh, pl_filter filter,
 
 struct sh_sampler_obj {
     pl_filter filter;
+    uint64_t lut_sig; // identifies the LUT contents derived from `filter`
     pl_shader_obj lut;
     pl_shader_obj pass2; // for pl_shader_sample_ortho
 };
@@ -562,15 +588,40 @@ struct sh_sampler_obj {
 #define SCALER_LUT_SIZE     256
 #define SCALER_LUT_CUTOFF   1e-3f
 
+// Shared memory tiles are rounded up to multiples of this size, so that small
+// changes in the scaling ratio (e.g. while resizing a window) result in the
+// same array dimensions, and hence don't require recompiling the shader
+#define SHMEM_TILE_ALIGN    16
+
 static void sh_sampler_uninit(pl_gpu gpu, void *ptr)
 {
     struct sh_sampler_obj *obj = ptr;
     pl_shader_obj_destroy(&obj->lut);
     pl_shader_obj_destroy(&obj->pass2);
-    pl_filter_free(&obj->filter);
+    pl_filter_release(&obj->filter);
     *obj = (struct sh_sampler_obj) {0};
 }
 
+static size_t sh_sampler_mem_usage(const void *ptr)
+{
+    const struct sh_sampler_obj *obj = ptr;
+    return sh_obj_mem_usage(obj->lut) + sh_obj_mem_usage(obj->pass2);
+}
+
+// Hashes the filter weights, so that samplers using the same filter end up
+// sharing the same LUT texture
+static uint64_t filter_lut_sig(pl_filter filt)
+{
+    pl_assert(filt->params.lut_entries);
+    const int row_stride = filt->params.config.polar ? 1 : filt->row_stride;
+    const size_t entries = filt->params.lut_entries * row_stride;
+    uint64_t sig = pl_mem_hash(filt->weights, entries * sizeof(float));
+    pl_hash_merge(&sig, filt->params.config.polar);
+    pl_hash_merge(&sig, row_stride);
+    pl_hash_merge(&sig, filt->radius == filt->radius_zero);
+    return sig;
+}
+
 static void fill_polar_lut(void *data, const struct sh_lut_params *params)
 {
     const struct sh_sampler_obj *obj = params->priv;
@@ -600,6 +651,22 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
                  sh_sampler_uninit);
     if (!obj)
         return false;
+    (*params->lut)->mem_usage = sh_sampler_mem_usage;
+
+    ident_t tap = NULL_IDENT;
+    if (params->tap_shader) {
+        pl_shader tsh = params->tap_shader;
+        if (tsh->input != PL_SHADER_SIG_COLOR || tsh->output != PL_SHADER_SIG_COLOR) {
+            SH_FAIL(sh, "Polar tap shader must have color input and output!");
+            return false;
+        }
+
+        tap = sh_subpass(sh, tsh);
+        if (!tap) {
+            SH_FAIL(sh, "Failed merging polar tap shader!");
+            return false;
+        }
+    }
 
     float inv_scale = 1.0 / PL_MIN(rx, ry);
     inv_scale = PL_MAX(inv_scale, 1.0);
@@ -611,18 +678,20 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
     cfg.blur = PL_DEF(cfg.blur, 1.0f) * inv_scale;
     bool update = !obj->filter || !pl_filter_config_eq(&obj->filter->params.config, &cfg);
     if (update) {
-        pl_filter_free(&obj->filter);
-        obj->filter = pl_filter_generate(sh->log, pl_filter_params(
+        pl_filter_release(&obj->filter);
+        obj->filter = pl_filter_acquire(sh->log, pl_filter_params(
             .config         = cfg,
             .lut_entries    = SCALER_LUT_SIZE,
             .cutoff         = SCALER_LUT_CUTOFF,
-        ));
+        ), SH_CACHE(sh));
 
         if (!obj->filter) {
             // This should never happen, but just in case ..
             SH_FAIL(sh, "Failed initializing polar filter!");
             return false;
         }
+
+        obj->lut_sig = filter_lut_sig(obj->filter);
     }
 
     describe_filter(sh, &cfg, "polar", rx, ry);
@@ -631,14 +700,14 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
          "{                                             \n"
          "vec2 pos = "$", pt = "$";                     \n"
          "vec2 size = vec2(textureSize("$", 0));        \n"
-         "vec2 fcoord = fract(pos * size - vec2(0.5));  \n"
+         "%svec2 fcoord = fract(pos * size - vec2(0.5));\n"
          "vec2 base = pos - pt * fcoord;                \n"
          "vec2 center = base + pt * vec2(0.5);          \n"
          "ivec2 offset;                                 \n"
-         "float w, d, wsum = 0.0;                       \n"
+         "%sfloat w, d, wsum = 0.0;                     \n"
          "int idx;                                      \n"
          "vec4 c;                                       \n",
-         pos, pt, src_tex);
+         pos, pt, src_tex, sh_mediump(sh), sh_mediump(sh));
 
     bool use_ar = cfg.antiring > 0;
     if (use_ar) {
@@ -663,21 +732,21 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
     const float margin = 1e-5;
     int iw = (int) ceilf(bw / rx - margin) + padding + 1,
         ih = (int) ceilf(bh / ry - margin) + padding + 1;
-    int sizew = iw, sizeh = ih;
-
-    pl_gpu gpu = SH_GPU(sh);
-    bool dynamic_size = SH_PARAMS(sh).dynamic_constants ||
-                        !gpu || !gpu->limits.array_size_constants;
-    if (dynamic_size) {
-        // Overallocate the array slightly to reduce recompilation overhead
-        sizew = PL_ALIGN2(sizew, 8);
-        sizeh = PL_ALIGN2(sizeh, 8);
-    }
 
+    // Overallocate the array to avoid recompilation when the scaling ratio
+    // changes slightly, falling back to the exact size if that doesn't fit
     int num_comps = __builtin_popcount(cmask);
-    int shmem_req = (sizew * sizeh * num_comps + 2) * sizeof(float);
-    bool is_compute = !params->no_compute && sh_glsl(sh).compute &&
-                      sh_try_compute(sh, bw, bh, false, shmem_req);
+    int sizew = PL_ALIGN2(iw, SHMEM_TILE_ALIGN),
+        sizeh = PL_ALIGN2(ih, SHMEM_TILE_ALIGN);
+    bool is_compute = !params->no_compute && sh_glsl(sh).compute;
+    if (is_compute && !sh_try_compute(sh, bw, bh, false,
+                                      (sizew * sizeh * num_comps + 2) * sizeof(float)))
+    {
+        sizew = iw;
+        sizeh = ih;
+        is_compute = sh_try_compute(sh, bw, bh, false,
+                                    (sizew * sizeh * num_comps + 2) * sizeof(float));
+    }
 
     // Note: SH_LUT_LITERAL might be faster in some specific cases, but not by
     // much, and it's catastrophically slow on other platforms.
@@ -689,6 +758,7 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
         .width      = SCALER_LUT_SIZE,
         .comps      = 1,
         .update     = update,
+        .signature  = obj->lut_sig,
         .fill       = fill_polar_lut,
         .priv       = obj,
     ));
@@ -698,7 +768,19 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
         return false;
     }
 
-    ident_t radius_c = sh_const_float(sh, "radius", obj->filter->radius);
+    // When widening the filter for downscaling, the radius varies with the
+    // scaling ratio, so pass it as a variable to avoid recompilation
+    const float radius = obj->filter->radius, ar_radius = obj->filter->radius_zero;
+    ident_t radius_c, radius_inv_c, ar_radius_c;
+    if (inv_scale > 1.0) {
+        radius_c = sh_var_float(sh, "radius", radius, false);
+        radius_inv_c = sh_var_float(sh, "radius_inv", 1.0 / radius, false);
+        ar_radius_c = sh_var_float(sh, "ar_radius", ar_radius, false);
+    } else {
+        radius_c = sh_const_float(sh, "radius", radius);
+        radius_inv_c = sh_const_float(sh, "radius_inv", 1.0 / radius);
+        ar_radius_c = sh_const_float(sh, "ar_radius", ar_radius);
+    }
     ident_t in = sh_fresh(sh, "in");
 
     if (is_compute) {
@@ -731,17 +813,16 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
             .data = &sizeh,
         });
 
-        ident_t iw_c = sizew_c, ih_c = sizeh_c;
-        if (dynamic_size) {
-            iw_c = sh_const_int(sh, "iw", iw);
-            ih_c = sh_const_int(sh, "ih", ih);
-        }
+        ident_t iw_c = sh_var_int(sh, "iw", iw, false);
+        ident_t ih_c = sh_var_int(sh, "ih", ih, false);
 
         // Load all relevant texels into shmem
         GLSL("for (int y = int(gl_LocalInvocationID.y); y < "$"; y += %d) {     \n"
              "for (int x = int(gl_LocalInvocationID.x); x < "$"; x += %d) {     \n"
              "c = textureLod("$", "$"_base + pt * vec2(x - %d, y - %d), 0.0);   \n",
              ih_c, bh, iw_c, bw, src_tex, in, offset, offset);
+        if (tap)
+            GLSL("c = "$"(c); \n", tap);
 
         for (uint8_t comps = cmask; comps;) {
             uint8_t c = __builtin_ctz(comps);
@@ -759,7 +840,8 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
                 GLSL("idx = "$" * rel.y + rel.x + "$" * %d + %d; \n",
                      sizew_c, sizew_c, y + offset, x + offset);
                 polar_sample(sh, obj->filter, src_tex, lut, radius_c,
-                             x, y, cmask, in, use_ar, scale);
+                             radius_inv_c, ar_radius_c, x, y, cmask, in,
+                             NULL_IDENT, use_ar, scale);
             }
         }
     } else {
@@ -777,6 +859,9 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
         // pixels in the next row were already gathered by the previous
         // row.
         uint32_t gathered_cur = 0x0, gathered_next = 0x0;
+        const struct pl_glsl_version glsl = sh_glsl(sh);
+        const bool gather_comp = glsl.gles ? glsl.version >= 310
+                                           : glsl.version >= 400;
         const float radius2 = PL_SQUARE(obj->filter->radius);
         const int base = bound - 1;
 
@@ -806,18 +891,20 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
                 use_gather &= !src->tex || src->tex->params.format->gatherable;
 
                 // Gathering from components other than the R channel requires
-                // support for GLSL 400, which introduces the overload of
-                // textureGather* that allows specifying the component.
+                // support for GLSL 400 (or GLSL ES 310), which introduces the
+                // overload of textureGather* that allows specifying the
+                // component.
                 //
                 // This is also the minimum requirement if we don't know the
                 // texture format capabilities, for the sampler2D interface
                 if (cmask != 0x1 || !src->tex)
-                    use_gather &= sh_glsl(sh).version >= 400;
+                    use_gather &= gather_comp;
 
                 if (!use_gather) {
                     // Switch to direct sampling instead
                     polar_sample(sh, obj->filter, src_tex, lut, radius_c,
-                                 x, y, cmask, NULL_IDENT, use_ar, scale);
+                                 radius_inv_c, ar_radius_c, x, y, cmask,
+                                 NULL_IDENT, tap, use_ar, scale);
                     continue;
                 }
 
@@ -857,7 +944,8 @@ bool pl_shader_sample_polar(pl_shader sh, const struct pl_sample_src *src,
 
                     GLSL("idx = %d;\n", p);
                     polar_sample(sh, obj->filter, src_tex, lut, radius_c,
-                                 x+xo[p], y+yo[p], cmask, in, use_ar, scale);
+                                 radius_inv_c, ar_radius_c, x+xo[p], y+yo[p],
+                                 cmask, in, tap, use_ar, scale);
                 }
 
                 // Mark the other next row's pixels as already gathered
@@ -897,7 +985,7 @@ static void fill_ortho_lut(void *data, const struct sh_lut_params *params)
     if (filt->radius == filt->radius_zero) {
         // Main lobe covers entire radius, so all weights are positive, meaning
         // we can use the linear resampling trick
-        for (int n = 0; n < SCALER_LUT_SIZE; n++) {
+        for (int n = 0; n < filt->params.lut_entries; n++) {
             const float *weights = filt->weights + n * filt->row_stride;
             float *row = (float *) data + n * filt->row_stride;
             pl_assert(filt->row_size % 2 == 0);
@@ -909,7 +997,7 @@ static void fill_ortho_lut(void *data, const struct sh_lut_params *params)
             }
         }
     } else {
-        size_t entries = SCALER_LUT_SIZE * filt->row_stride;
+        size_t entries = filt->params.lut_entries * filt->row_stride;
         pl_assert(params->width * params->height * params->comps == entries);
         memcpy(data, filt->weights, entries * sizeof(float));
     }
@@ -921,104 +1009,399 @@ enum {
     SEP_PASSES
 };
 
-bool pl_shader_sample_ortho2(pl_shader sh, const struct pl_sample_src *src,
-                             const struct pl_sample_filter_params *params)
+// Maximum number of subpixel phases to compute exact filter weights for
+#define SCALER_EXACT_MAX_STEPS 64
+
+// For rational scaling ratios with a short period, the subpixel offsets of
+// all output pixels lie on a regular grid. Returns the number of grid steps
+// (such that every offset is a multiple of 1/steps), or 0 if there is no such
+// grid with at most SCALER_EXACT_MAX_STEPS steps.
+static int exact_phase_steps(pl_shader sh, float src_size, float src_offset,
+                             int out_size)
 {
-    pl_assert(params);
-    if (params->filter.polar) {
-        SH_FAIL(sh, "Trying to use separated sampling with a polar filter?");
-        return false;
-    }
+    const float eps = 1e-3f;
+    if (sh_glsl(sh).version < 130)
+        return 0; // requires integer LUT indexing
+
+    const float in_size = fabsf(src_size);
+    if (fabsf(in_size - roundf(in_size)) > eps)
+        return 0;
+
+    // With a ratio of in/out = q/p in lowest terms, the offset of output
+    // pixel i is fract(x0 + (2i + 1) * q / 2p - 0.5)
+    const size_t in_i = lrintf(in_size);
+    if (!in_i)
+        return 0;
+    const int steps = 2 * (out_size / pl_gcd(in_i, out_size));
+    if (steps > SCALER_EXACT_MAX_STEPS)
+        return 0;
+
+    const float offset = src_offset * steps;
+    if (fabsf(offset - roundf(offset)) > eps)
+        return 0;
+
+    return steps;
+}
 
+// Generates (or updates) the separated filter for a given pass. We store a
+// separate sampler object per dimension, so dispatch the right one. This is
+// needed because anamorphic content can have a different scaling ratio for
+// each dimension. In particular, you could be upscaling in one and
+// downscaling in the other.
+//
+// If `steps` is nonzero, the LUT contains exactly the rows for the subpixel
+// offsets k/steps (see `exact_phase_steps`), rather than interpolated ones.
+static struct sh_sampler_obj *ortho_filter(pl_shader sh,
+                                           const struct pl_sample_filter_params *params,
+                                           int pass, float ratio, int steps,
+                                           struct pl_filter_config *cfg,
+                                           bool *update)
+{
     pl_gpu gpu = SH_GPU(sh);
-    pl_assert(gpu);
-
-    uint8_t comps;
-    float ratio[SEP_PASSES], scale;
-    ident_t src_tex, pos, pt;
-    if (!setup_src(sh, src, &src_tex, &pos, &pt,
-                   &ratio[SEP_HORIZ], &ratio[SEP_VERT],
-                   &comps, &scale, false, LINEAR))
-        return false;
-
-
-    int pass;
-    if (fabs(ratio[SEP_HORIZ] - 1.0f) < 1e-6f) {
-        pass = SEP_VERT;
-    } else if (fabs(ratio[SEP_VERT] - 1.0f) < 1e-6f) {
-        pass = SEP_HORIZ;
-    } else {
-        SH_FAIL(sh, "Trying to use pl_shader_sample_ortho with a "
-                "pl_sample_src that requires scaling in multiple directions "
-                "(rx=%f, ry=%f), this is not possible!",
-                ratio[SEP_HORIZ], ratio[SEP_VERT]);
-        return false;
-    }
-
-    // We can store a separate sampler object per dimension, so dispatch the
-    // right one. This is needed for two reasons:
-    // 1. Anamorphic content can have a different scaling ratio for each
-    //    dimension. In particular, you could be upscaling in one and
-    //    downscaling in the other.
-    // 2. After fixing the source for `setup_src`, we lose information about
-    //    the scaling ratio of the other component. (Although this is only a
-    //    minor reason and could easily be changed with some boilerplate)
     struct sh_sampler_obj *obj;
     obj = SH_OBJ(sh, params->lut, PL_SHADER_OBJ_SAMPLER,
                  struct sh_sampler_obj, sh_sampler_uninit);
     if (!obj)
-        return false;
+        return NULL;
+    (*params->lut)->mem_usage = sh_sampler_mem_usage;
 
     if (pass != 0) {
-        obj = SH_OBJ(sh, &obj->pass2, PL_SHADER_OBJ_SAMPLER,
+        pl_shader_obj *pass2 = &obj->pass2;
+        obj = SH_OBJ(sh, pass2, PL_SHADER_OBJ_SAMPLER,
                      struct sh_sampler_obj, sh_sampler_uninit);
         assert(obj);
+        (*pass2)->mem_usage = sh_sampler_mem_usage;
     }
 
-    float inv_scale = 1.0 / ratio[pass];
+    float inv_scale = 1.0 / ratio;
     inv_scale = PL_MAX(inv_scale, 1.0);
     if (params->no_widening)
         inv_scale = 1.0;
 
-    struct pl_filter_config cfg = params->filter;
-    cfg.antiring = PL_DEF(cfg.antiring, params->antiring);
-    cfg.blur = PL_DEF(cfg.blur, 1.0f) * inv_scale;
-    bool update = !obj->filter || !pl_filter_config_eq(&obj->filter->params.config, &cfg);
-
-    if (update) {
-        pl_filter_free(&obj->filter);
-        obj->filter = pl_filter_generate(sh->log, pl_filter_params(
-            .config             = cfg,
-            .lut_entries        = SCALER_LUT_SIZE,
+    *cfg = params->filter;
+    cfg->antiring = PL_DEF(cfg->antiring, params->antiring);
+    cfg->blur = PL_DEF(cfg->blur, 1.0f) * inv_scale;
+    const int lut_entries = steps ? steps + 1 : SCALER_LUT_SIZE;
+    *update = !obj->filter || !pl_filter_config_eq(&obj->filter->params.config, cfg) ||
+              obj->filter->params.lut_entries != lut_entries;
+
+    if (*update) {
+        pl_filter_release(&obj->filter);
+        obj->filter = pl_filter_acquire(sh->log, pl_filter_params(
+            .config             = *cfg,
+            .lut_entries        = lut_entries,
             .max_row_size       = gpu->limits.max_tex_2d_dim / 4,
             .row_stride_align   = 4,
-        ));
+        ), SH_CACHE(sh));
 
         if (!obj->filter) {
             // This should never happen, but just in case ..
             SH_FAIL(sh, "Failed initializing separated filter!");
-            return false;
+            return NULL;
         }
+
+        obj->lut_sig = filter_lut_sig(obj->filter);
     }
 
-    int N = obj->filter->row_size; // number of samples to convolve
-    int width = obj->filter->row_stride / 4; // width of the LUT texture
+    return obj;
+}
+
+static ident_t ortho_lut(pl_shader sh, struct sh_sampler_obj *obj, int steps,
+                         bool update)
+{
+    // Exact LUTs are small enough to be embedded as literals, but their size
+    // and contents depend on the scaling ratio, so prefer textures instead
     ident_t lut = sh_lut(sh, sh_lut_params(
         .object     = &obj->lut,
+        .lut_type   = SH_LUT_TEXTURE,
         .var_type   = PL_VAR_FLOAT,
-        .method     = SH_LUT_LINEAR,
-        .width      = width,
-        .height     = SCALER_LUT_SIZE,
+        .method     = steps ? SH_LUT_NONE : SH_LUT_LINEAR,
+        .width      = obj->filter->row_stride / 4,
+        .height     = obj->filter->params.lut_entries,
         .comps      = 4,
         .update     = update,
+        .signature  = obj->lut_sig,
         .fill       = fill_ortho_lut,
         .priv       = obj,
     ));
-    if (!lut) {
+
+    if (!lut)
         SH_FAIL(sh, "Failed initializing separated LUT!");
+    return lut;
+}
+
+// Emits the weights of an ortho filter as individual floats `<prefix><n>`,
+// undoing the linear resampling trick (see `fill_ortho_lut`) if needed
+static void ortho_weights(pl_shader sh, pl_filter filter, ident_t lut, int steps,
+                          const char *prefix, const char *fcoord)
+{
+    const int N = filter->row_size;
+    const float denom = PL_MAX(1, filter->row_stride / 4 - 1);
+    const bool use_linear = filter->radius == filter->radius_zero;
+    ident_t denom_c = sh_const_float(sh, "denom", denom);
+    if (steps) {
+        // Passed as a variable, since it depends on the exact scaling ratio
+        GLSL("int %s_phase = int(round(%s * "$")); \n", prefix, fcoord,
+             sh_var_float(sh, "steps", steps, false));
+    }
+    for (int n = 0; n < N; n += 4) {
+        if (steps) {
+            GLSL("ws = "$"(ivec2(%d, %s_phase)); \n", lut, n / 4, prefix);
+        } else {
+            GLSL("ws = "$"(vec2(%d.0 / "$", %s)); \n", lut, n / 4, denom_c, fcoord);
+        }
+        for (int i = n; i < PL_MIN(n + 4, N); i++) {
+            if (!use_linear) {
+                GLSL("float %s%d = ws[%d]; \n", prefix, i, i % 4);
+            } else if (i % 2 == 0) {
+                GLSL("float %s%d = ws[%d] * (1.0 - ws[%d]); \n",
+                     prefix, i, i % 4, i % 4 + 1);
+            } else {
+                GLSL("float %s%d = ws[%d] * ws[%d]; \n",
+                     prefix, i, i % 4 - 1, i % 4);
+            }
+        }
+    }
+}
+
+// Performs both passes of a separated filter in a single compute shader, by
+// loading the source texels (plus halo) into shmem, convolving them
+// horizontally into a second shmem array, and then convolving that
+// vertically. Returns false without modifying `sh` if this is impossible.
+static bool sample_ortho2_compute(pl_shader sh, const struct pl_sample_src *src,
+                                  const struct pl_sample_filter_params *params,
+                                  float rx, float ry)
+{
+    if (params->no_compute || !sh_glsl(sh).compute) {
+        PL_TRACE(sh, "Separated 2D scaling requires compute shaders");
+        return false;
+    }
+
+    float src_w, src_h;
+    int out_w, out_h;
+    src_dims(src, &src_w, &src_h, &out_w, &out_h);
+    const int steps[SEP_PASSES] = {
+        [SEP_HORIZ] = exact_phase_steps(sh, src_w, src->rect.x0, out_w),
+        [SEP_VERT]  = exact_phase_steps(sh, src_h, src->rect.y0, out_h),
+    };
+
+    struct pl_filter_config cfg[SEP_PASSES];
+    struct sh_sampler_obj *obj[SEP_PASSES];
+    const float ratio[SEP_PASSES] = { [SEP_HORIZ] = rx, [SEP_VERT] = ry };
+    bool update[SEP_PASSES];
+    for (int p = 0; p < SEP_PASSES; p++) {
+        obj[p] = ortho_filter(sh, params, p, ratio[p], steps[p], &cfg[p], &update[p]);
+        if (!obj[p])
+            return false;
+
+        // Anti-ringing would require tracking per-row bounds in shmem as well
+        pl_filter f = obj[p]->filter;
+        if (cfg[p].antiring > 0 && ratio[p] > 1.0 && f->radius != f->radius_zero) {
+            PL_TRACE(sh, "Separated 2D scaling does not support anti-ringing");
+            return false;
+        }
+    }
+
+    const int Nx = obj[SEP_HORIZ]->filter->row_size,
+              Ny = obj[SEP_VERT]->filter->row_size;
+
+    // Try progressively smaller work groups until the tile fits into shmem.
+    // The extra margin on the ceilf guards against floating point inaccuracy
+    // on near-integer scaling ratios.
+    static const int group_sizes[][2] = {{16, 16}, {16, 8}, {8, 8}};
+    const float margin = 1e-5;
+    uint8_t cmask = 0x0Fu;
+    if (src->tex)
+        cmask = (1 << src->tex->params.format->num_components) - 1;
+    cmask &= src->component_mask ? src->component_mask
+                                 : (1 << PL_DEF(src->components, 4)) - 1;
+
+    int bw, bh, iw, ih, sizew, sizeh;
+    bool found = false;
+    const int num_comps = __builtin_popcount(cmask);
+    for (int i = 0; !found && i < 2 * PL_ARRAY_SIZE(group_sizes); i++) {
+        bw = group_sizes[i / 2][0];
+        bh = group_sizes[i / 2][1];
+        iw = (int) ceilf(bw / rx - margin) + Nx + 1;
+        ih = (int) ceilf(bh / ry - margin) + Ny + 1;
+
+        // Prefer overallocating the arrays to avoid recompilation when the
+        // scaling ratio changes slightly, before trying the exact size
+        const bool align = i % 2 == 0;
+        sizew = align ? PL_ALIGN2(iw, SHMEM_TILE_ALIGN) : iw;
+        sizeh = align ? PL_ALIGN2(ih, SHMEM_TILE_ALIGN) : ih;
+        size_t shmem_req = ((sizew + bw) * sizeh * num_comps + 2) * sizeof(float);
+        found = sh_try_compute(sh, bw, bh, false, shmem_req);
+    }
+
+    if (!found)
+        return false;
+
+    uint8_t comps;
+    float scale;
+    ident_t src_tex, pos, pt;
+    if (!setup_src(sh, src, &src_tex, &pos, &pt, NULL, NULL,
+                   &comps, &scale, false, FASTEST))
+        return false;
+    pl_assert(comps == cmask);
+
+    ident_t lut[SEP_PASSES];
+    for (int p = 0; p < SEP_PASSES; p++) {
+        lut[p] = ortho_lut(sh, obj[p], steps[p], update[p]);
+        if (!lut[p])
+            return false;
+    }
+
+    describe_filter(sh, &cfg[SEP_HORIZ], "ortho (compute)", rx, ry);
+    GLSL("// pl_shader_sample_ortho2 (compute)                 \n"
+         "vec4 color = vec4(0.0, 0.0, 0.0, 1.0);               \n"
+         "{                                                    \n"
+         "vec2 pos = "$", pt = "$";                            \n"
+         "vec2 size = vec2(textureSize("$", 0));               \n"
+         "vec2 fcoord = fract(pos * size - vec2(0.5));         \n"
+         "vec2 base = pos - pt * fcoord                        \n"
+         "          - pt * vec2(%d.0, %d.0);                   \n"
+         "%svec4 ws;                                           \n"
+         "vec4 c;                                              \n"
+         "int idx;                                             \n"
+         "uvec2 base_id = uvec2(0u);                           \n",
+         pos, pt, src_tex, Nx / 2 - 1, Ny / 2 - 1, sh_mediump(sh));
+
+    if (src->rect.x0 > src->rect.x1)
+        GLSL("base_id.x = gl_WorkGroupSize.x - 1u; \n");
+    if (src->rect.y0 > src->rect.y1)
+        GLSL("base_id.y = gl_WorkGroupSize.y - 1u; \n");
+
+    ident_t in = sh_fresh(sh, "in"), tmp = sh_fresh(sh, "tmp");
+    GLSLH("shared vec2 "$"_base; \n", in);
+    GLSL("if (gl_LocalInvocationID.xy == base_id)               \n"
+         "    "$"_base = base;                                  \n"
+         "barrier();                                            \n"
+         "ivec2 rel = ivec2(round((base - "$"_base) * size));   \n",
+         in, in);
+
+    ident_t sizew_c = sh_const(sh, (struct pl_shader_const) {
+        .type = PL_VAR_SINT,
+        .compile_time = true,
+        .name = "sizew",
+        .data = &sizew,
+    });
+
+    ident_t sizeh_c = sh_const(sh, (struct pl_shader_const) {
+        .type = PL_VAR_SINT,
+        .compile_time = true,
+        .name = "sizeh",
+        .data = &sizeh,
+    });
+
+    ident_t iw_c = sh_var_int(sh, "iw", iw, false);
+    ident_t ih_c = sh_var_int(sh, "ih", ih, false);
+
+    // Load all relevant texels into shmem
+    GLSL("for (int y = int(gl_LocalInvocationID.y); y < "$"; y += %d) {     \n"
+         "for (int x = int(gl_LocalInvocationID.x); x < "$"; x += %d) {     \n"
+         "c = textureLod("$", "$"_base + pt * vec2(x, y), 0.0);             \n",
+         ih_c, bh, iw_c, bw, src_tex, in);
+
+    for (uint8_t mask = cmask; mask;) {
+        uint8_t c = __builtin_ctz(mask);
+        GLSLH("shared float "$"%d["$" * "$"]; \n", in, c, sizeh_c, sizew_c);
+        GLSLH("shared float "$"%d["$" * %d]; \n", tmp, c, sizeh_c, bw);
+        GLSL(""$"%d["$" * y + x] = c[%d]; \n", in, c, sizew_c, c);
+        mask &= ~(1 << c);
+    }
+
+    GLSL("}}                     \n"
+         "barrier();             \n");
+
+    // Convolve each row horizontally, at this invocation's output column
+    ortho_weights(sh, obj[SEP_HORIZ]->filter, lut[SEP_HORIZ], steps[SEP_HORIZ],
+                  "wx", "fcoord.x");
+    GLSL("for (int y = int(gl_LocalInvocationID.y); y < "$"; y += %d) { \n"
+         "idx = "$" * y + rel.x;                                        \n",
+         ih_c, bh, sizew_c);
+    for (uint8_t mask = cmask; mask;) {
+        uint8_t c = __builtin_ctz(mask);
+        GLSL("c[%d] = 0.0; \n", c);
+        for (int n = 0; n < Nx; n++)
+            GLSL("c[%d] += wx%d * "$"%d[idx + %d]; \n", c, n, in, c, n);
+        GLSL(""$"%d[%d * y + int(gl_LocalInvocationID.x)] = c[%d]; \n",
+             tmp, c, bw, c);
+        mask &= ~(1 << c);
+    }
+
+    GLSL("}                      \n"
+         "barrier();             \n");
+
+    // Convolve the intermediate result vertically
+    ident_t scale_c = SH_FLOAT(scale);
+    ortho_weights(sh, obj[SEP_VERT]->filter, lut[SEP_VERT], steps[SEP_VERT],
+                  "wy", "fcoord.y");
+    GLSL("idx = %d * rel.y + int(gl_LocalInvocationID.x); \n", bw);
+    for (uint8_t mask = cmask; mask;) {
+        uint8_t c = __builtin_ctz(mask);
+        GLSL("c[%d] = 0.0; \n", c);
+        for (int n = 0; n < Ny; n++)
+            GLSL("c[%d] += wy%d * "$"%d[idx + %d]; \n", c, n, tmp, c, n * bw);
+        GLSL("color[%d] = "$" * c[%d]; \n", c, scale_c, c);
+        mask &= ~(1 << c);
+    }
+
+    GLSL("}\n");
+    return true;
+}
+
+bool pl_shader_sample_ortho2(pl_shader sh, const struct pl_sample_src *src,
+                             const struct pl_sample_filter_params *params)
+{
+    pl_assert(params);
+    if (params->filter.polar) {
+        SH_FAIL(sh, "Trying to use separated sampling with a polar filter?");
+        return false;
+    }
+
+    if (params->tap_shader) {
+        SH_FAIL(sh, "Tap shaders are not supported for separated sampling!");
         return false;
     }
 
+    pl_gpu gpu = SH_GPU(sh);
+    pl_assert(gpu);
+
+    // Scaling in both directions at once is only possible using shmem
+    float src_w, src_h;
+    int out_w, out_h;
+    src_dims(src, &src_w, &src_h, &out_w, &out_h);
+    const float rx = out_w / fabs(src_w), ry = out_h / fabs(src_h);
+    if (fabs(rx - 1.0f) >= 1e-6f && fabs(ry - 1.0f) >= 1e-6f)
+        return sample_ortho2_compute(sh, src, params, rx, ry);
+
+    uint8_t comps;
+    float ratio[SEP_PASSES], scale;
+    ident_t src_tex, pos, pt;
+    if (!setup_src(sh, src, &src_tex, &pos, &pt,
+                   &ratio[SEP_HORIZ], &ratio[SEP_VERT],
+                   &comps, &scale, false, LINEAR))
+        return false;
+
+    int pass = fabs(ratio[SEP_HORIZ] - 1.0f) < 1e-6f ? SEP_VERT : SEP_HORIZ;
+    const int steps = pass == SEP_HORIZ
+        ? exact_phase_steps(sh, src_w, src->rect.x0, out_w)
+        : exact_phase_steps(sh, src_h, src->rect.y0, out_h);
+
+    struct pl_filter_config cfg;
+    bool update;
+    struct sh_sampler_obj *obj;
+    obj = ortho_filter(sh, params, pass, ratio[pass], steps, &cfg, &update);
+    if (!obj)
+        return false;
+
+    int N = obj->filter->row_size; // number of samples to convolve
+    int width = obj->filter->row_stride / 4; // width of the LUT texture
+    ident_t lut = ortho_lut(sh, obj, steps, update);
+    if (!lut)
+        return false;
+
     const int dir[SEP_PASSES][2] = {
         [SEP_HORIZ] = {1, 0},
         [SEP_VERT]  = {0, 1},
@@ -1032,6 +1415,7 @@ bool pl_shader_sample_ortho2(pl_shader sh, const struct pl_sample_src *src,
     describe_filter(sh, &cfg, names[pass], ratio[pass], ratio[pass]);
 
     float denom = PL_MAX(1, width - 1); // avoid division by zero
+    bool relaxed = sh_mediump(sh)[0] != '\0';
     bool use_ar = cfg.antiring > 0 && ratio[pass] > 1.0;
     bool use_linear = obj->filter->radius == obj->filter->radius_zero;
     use_ar &= !use_linear; // filter has no negative weights
@@ -1046,16 +1430,25 @@ bool pl_shader_sample_ortho2(pl_shader sh, const struct pl_sample_src *src,
     vec2 fcoord2 = fract(pos * size - vec2(0.5));                               \
     float fcoord = dot(fcoord2, dir);                                           \
     vec2 base = pos - fcoord * pt - pt * vec2(${const float: N / 2 - 1});       \
-    vec4 ws;                                                                    \
+    @if (relaxed)                                                               \
+        mediump vec4 ws;                                                        \
+    @else                                                                       \
+        vec4 ws;                                                                \
     float off;                                                                  \
+    @if (steps)                                                                 \
+        int phase = int(round(fcoord * ${const float: (float) steps}));         \
     ${vecType: comps} c, ca = ${vecType: comps}(0.0);                           \
     @if (use_ar) {                                                              \
         ${vecType: comps} hi = ${vecType: comps}(0.0);                          \
         ${vecType: comps} lo = ${vecType: comps}(1e9);                          \
     @}                                                                          \
     @for (n < N) {                                                              \
-        @if @(n % 4 == 0)                                                       \
-            ws = $lut(vec2(float(@n / 4) / ${const float: denom}, fcoord));     \
+        @if @(n % 4 == 0) {                                                     \
+            @if (steps)                                                         \
+                ws = $lut(ivec2(@n / 4, phase));                                \
+            @else                                                               \
+                ws = $lut(vec2(float(@n / 4) / ${const float: denom}, fcoord)); \
+        @}                                                                      \
         @if @(vars.use_ar && (n == vars.n / 2 - 1 || n == vars.n / 2)) {        \
             c = textureLod($src_tex, base + pt * @n.0, 0.0).${swizzle: comps};  \
             ca += ws[@n % 4] * c;                                               \
@@ -90,3 +90,33 @@ void pl_swapchain_swap_buffers(pl_swapchain sw)
     const struct pl_sw_fns *impl = PL_PRIV(sw);
     impl->swap_buffers(sw);
 }
+
+bool pl_swapchain_present_timing(pl_swapchain sw, struct pl_swapchain_timing *out)
+{
+    *out = (struct pl_swapchain_timing) {0};
+
+    const struct pl_sw_fns *impl = PL_PRIV(sw);
+    if (!impl->present_timing)
+        return false;
+
+    return impl->present_timing(sw, out);
+}
+
+bool pl_swapchain_wait_presented(pl_swapchain sw, uint64_t frame_id,
+                                 uint64_t timeout)
+{
+    const struct pl_sw_fns *impl = PL_PRIV(sw);
+    if (!impl->wait_presented || !frame_id)
+        return false;
+
+    return impl->wait_presented(sw, frame_id, timeout);
+}
+
+bool pl_swapchain_adaptive_vsync(pl_swapchain sw, bool enable)
+{
+    const struct pl_sw_fns *impl = PL_PRIV(sw);
+    if (!impl->adaptive_vsync)
+        return false;
+
+    return impl->adaptive_vsync(sw, enable);
+}
@@ -35,5 +35,8 @@ struct pl_sw_fns {
     SW_PFN(start_frame);
     SW_PFN(submit_frame);
     SW_PFN(swap_buffers);
+    SW_PFN(present_timing); // optional
+    SW_PFN(wait_presented); // optional
+    SW_PFN(adaptive_vsync); // optional
 };
 #undef SW_PFN
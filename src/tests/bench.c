@@ -1,10 +1,13 @@
 #include "tests.h"
 
 #include <libplacebo/dispatch.h>
+#include <libplacebo/gamut_mapping.h>
+#include <libplacebo/renderer.h>
 #include <libplacebo/vulkan.h>
 #include <libplacebo/shaders/colorspace.h>
 #include <libplacebo/shaders/deinterlacing.h>
 #include <libplacebo/shaders/sampling.h>
+#include <libplacebo/tone_mapping.h>
 
 enum {
     // Image configuration
@@ -64,21 +67,217 @@ static pl_tex create_test_img(pl_gpu gpu)
     return tex;
 }
 
+enum frame_type {
+    FRAME_SDR,
+    FRAME_HDR10,
+    FRAME_DOVI,
+};
+
+// Configuration for end-to-end rendering of a synthetic YUV 4:2:0 source
+struct bench_frame {
+    const struct pl_render_params *params;
+    enum frame_type type;
+    int depth;              // 8 or 10 bits
+    int src_w, src_h;       // source resolution, or 0 for WIDTH x HEIGHT
+    int dst_w, dst_h;       // target crop (at most WIDTH x HEIGHT), or 0
+    bool mix;               // use `pl_render_image_mix` (with frame mixing)
+};
+
+// Accumulated per-stage GPU times, as reported by `info_callback`
+struct stage_times {
+    struct {
+        char desc[64];
+        uint64_t total;
+        unsigned long count;
+    } stages[64];
+    int num_stages;
+    bool active;
+};
+
 struct bench {
     void (*run_sh)(pl_shader sh, pl_shader_obj *state,
                    pl_tex src);
 
     void (*run_tex)(pl_gpu gpu, pl_tex tex);
+
+    void (*run_render)(pl_renderer rr, pl_tex src, pl_tex fbo);
+
+    const struct bench_frame *frame;
 };
 
-static void run_bench(pl_gpu gpu, pl_dispatch dp,
+static void record_stage(void *priv, const struct pl_render_info *info)
+{
+    struct stage_times *st = priv;
+    const struct pl_dispatch_info *pass = info->pass;
+    if (!st->active || !pass->last || !pass->shader->description)
+        return;
+
+    char desc[sizeof(st->stages[0].desc)];
+    snprintf(desc, sizeof(desc), "%s%s",
+             info->stage == PL_RENDER_STAGE_BLEND ? "(blend) " : "",
+             pass->shader->description);
+
+    int idx;
+    for (idx = 0; idx < st->num_stages; idx++) {
+        if (!strcmp(st->stages[idx].desc, desc))
+            break;
+    }
+
+    if (idx == st->num_stages) {
+        if (idx == PL_ARRAY_SIZE(st->stages))
+            return;
+        strcpy(st->stages[idx].desc, desc);
+        st->num_stages++;
+    }
+
+    st->stages[idx].total += pass->last;
+    st->stages[idx].count++;
+}
+
+static void render_frame(pl_renderer rr, const struct pl_frame *image,
+                         pl_tex fbo, const struct bench_frame *cfg,
+                         struct stage_times *st)
+{
+    struct pl_frame target = {
+        .num_planes = 1,
+        .planes     = {{ .texture = fbo, .components = 4,
+                         .component_mapping = {0, 1, 2, 3} }},
+        .crop       = { 0, 0, PL_DEF(cfg->dst_w, WIDTH), PL_DEF(cfg->dst_h, HEIGHT) },
+        .repr       = pl_color_repr_rgb,
+        .color      = pl_color_space_srgb,
+    };
+
+    struct pl_render_params params = *cfg->params;
+    params.info_callback = record_stage;
+    params.info_priv = st;
+
+    if (!cfg->mix) {
+        REQUIRE(pl_render_image(rr, image, &target, &params));
+        return;
+    }
+
+    // Advance by one frame per vsync, so every iteration uploads (renders)
+    // one new frame and blends it with the previously cached one
+    static uint64_t pts;
+    const struct pl_frame *frames[] = { image, image };
+    const uint64_t sigs[] = { pts, pts + 1 };
+    const float timestamps[] = { -0.4f, 0.6f };
+    pts++;
+
+    REQUIRE(pl_render_image_mix(rr, &(struct pl_frame_mix) {
+        .num_frames     = PL_ARRAY_SIZE(frames),
+        .frames         = frames,
+        .signatures     = sigs,
+        .timestamps     = timestamps,
+        .vsync_duration = 1.0f,
+    }, &target, &params));
+}
+
+static pl_tex create_test_plane(pl_gpu gpu, int w, int h, int comps, int depth)
+{
+    const int bits = depth > 8 ? 16 : 8;
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_UNORM, comps, bits, bits,
+                             PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_LINEAR);
+    REQUIRE(fmt);
+
+    const float xc = (w - 1) / 2.0f, yc = (h - 1) / 2.0f;
+    const float freq = 0.1f * M_PI / sqrtf(xc * xc + yc * yc);
+    const float scale = (1 << depth) - 1;
+    uint8_t *data = malloc(w * h * fmt->texel_size);
+    REQUIRE(data);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x++) {
+            float xx = x - xc, yy = y - yc;
+            float r2 = xx * xx + yy * yy;
+            for (int c = 0; c < comps; c++) {
+                float v = 0.5f * sinf(freq * r2 * (1.0f + c)) + 0.5f;
+                size_t idx = (size_t) (y * w + x) * comps + c;
+                if (bits == 16) {
+                    ((uint16_t *) data)[idx] = lrintf(v * scale);
+                } else {
+                    data[idx] = lrintf(v * scale);
+                }
+            }
+        }
+    }
+
+    pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+        .format         = fmt,
+        .w              = w,
+        .h              = h,
+        .sampleable     = true,
+        .initial_data   = data,
+    ));
+
+    free(data);
+    REQUIRE(tex);
+    return tex;
+}
+
+static struct pl_frame create_test_frame(pl_gpu gpu, const struct bench_frame *cfg)
+{
+    const int w = PL_DEF(cfg->src_w, WIDTH), h = PL_DEF(cfg->src_h, HEIGHT);
+    struct pl_frame image = {
+        .num_planes = 2,
+        .planes     = {
+            {
+                .texture = create_test_plane(gpu, w, h, 1, cfg->depth),
+                .components = 1,
+                .component_mapping = {PL_CHANNEL_Y},
+            }, {
+                .texture = create_test_plane(gpu, w / 2, h / 2, 2, cfg->depth),
+                .components = 2,
+                .component_mapping = {PL_CHANNEL_U, PL_CHANNEL_V},
+            },
+        },
+        .repr = {
+            .sys    = PL_COLOR_SYSTEM_BT_709,
+            .levels = PL_COLOR_LEVELS_LIMITED,
+            .bits   = {
+                .sample_depth = cfg->depth > 8 ? 16 : 8,
+                .color_depth  = cfg->depth,
+            },
+        },
+        .color = pl_color_space_bt709,
+    };
+
+    switch (cfg->type) {
+    case FRAME_SDR: break;
+    case FRAME_HDR10:
+        image.repr.sys = PL_COLOR_SYSTEM_BT_2020_NC;
+        image.color = pl_color_space_hdr10;
+        image.color.hdr = (struct pl_hdr_metadata) {
+            .min_luma = 0.005f,
+            .max_luma = 1000.0f,
+            .max_cll  = 1000.0f,
+            .max_fall = 250.0f,
+        };
+        break;
+    case FRAME_DOVI:
+        image.repr.sys = PL_COLOR_SYSTEM_DOLBYVISION;
+        image.repr.dovi = &dovi_meta;
+        image.repr.levels = PL_COLOR_LEVELS_FULL;
+        image.color = pl_color_space_hdr10;
+        break;
+    }
+
+    pl_frame_set_chroma_location(&image, PL_CHROMA_LEFT);
+    return image;
+}
+
+static void run_bench(pl_gpu gpu, pl_dispatch dp, pl_renderer rr,
                       pl_shader_obj *state, pl_tex src,
+                      const struct pl_frame *image, struct stage_times *st,
                       pl_tex fbo, pl_timer timer,
                       const struct bench *bench)
 {
     REQUIRE(bench);
-    REQUIRE(bench->run_sh || bench->run_tex);
-    if (bench->run_sh) {
+    REQUIRE(bench->run_sh || bench->run_tex || bench->run_render || bench->frame);
+    if (bench->frame) {
+        render_frame(rr, image, fbo, bench->frame, st);
+    } else if (bench->run_render) {
+        bench->run_render(rr, src, fbo);
+    } else if (bench->run_sh) {
         pl_shader sh = pl_dispatch_begin(dp);
         bench->run_sh(sh, state, src);
 
@@ -97,8 +296,17 @@ static void benchmark(pl_gpu gpu, const char *name,
 {
     pl_dispatch dp = pl_dispatch_create(gpu->log, gpu);
     REQUIRE(dp);
+    pl_renderer rr = NULL;
+    if (bench->run_render || bench->frame) {
+        rr = pl_renderer_create(gpu->log, gpu);
+        REQUIRE(rr);
+    }
     pl_shader_obj state = NULL;
     pl_tex src = create_test_img(gpu);
+    struct pl_frame image = {0};
+    struct stage_times stages = {0};
+    if (bench->frame)
+        image = create_test_frame(gpu, bench->frame);
 
     // Create the FBOs
     pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, COMPS, DEPTH, 32,
@@ -123,7 +331,7 @@ static void benchmark(pl_gpu gpu, const char *name,
     }
 
     // Run the benchmark and flush+block once to force shader compilation etc.
-    run_bench(gpu, dp, &state, src, fbos[0], NULL, bench);
+    run_bench(gpu, dp, rr, &state, src, &image, &stages, fbos[0], NULL, bench);
     pl_gpu_finish(gpu);
 
     // Perform the actual benchmark
@@ -134,14 +342,20 @@ static void benchmark(pl_gpu gpu, const char *name,
     uint64_t gputime_total = 0;
     unsigned long gputime_count = 0;
     uint64_t gputime;
+    double cputime_total = 0;
 
     start_warmup = pl_clock_now();
     do {
         const int idx = frames % NUM_TEX;
         while (pl_tex_poll(gpu, fbos[idx], UINT64_MAX))
             ; // do nothing
-        run_bench(gpu, dp, &state, src, fbos[idx], start_test ? timer : NULL, bench);
+        pl_clock_t cpu_start = pl_clock_now();
+        stages.active = start_test;
+        run_bench(gpu, dp, rr, &state, src, &image, &stages, fbos[idx],
+                  start_test ? timer : NULL, bench);
         pl_gpu_flush(gpu);
+        if (start_test)
+            cputime_total += pl_clock_diff(pl_clock_now(), cpu_start);
         frames++;
 
         if (start_test) {
@@ -176,12 +390,20 @@ static void benchmark(pl_gpu gpu, const char *name,
           name, frames, secs, 1000 * secs / frames, frames / secs);
     if (gputime_count)
         printf(", gpu time: %2.6f ms", 1e-6 * gputime_total / gputime_count);
-    printf("\n");
+    printf(", cpu time: %2.6f ms\n", 1000 * cputime_total / frames);
+
+    for (int i = 0; i < stages.num_stages; i++) {
+        printf("    %-60s %2.6f ms\n", stages.stages[i].desc,
+               1e-6 * stages.stages[i].total / stages.stages[i].count);
+    }
 
     pl_timer_destroy(gpu, &timer);
     pl_shader_obj_destroy(&state);
+    pl_renderer_destroy(&rr);
     pl_dispatch_destroy(&dp);
     pl_tex_destroy(gpu, &src);
+    for (int i = 0; i < image.num_planes; i++)
+        pl_tex_destroy(gpu, &image.planes[i].texture);
     for (int i = 0; i < NUM_TEX; i++)
         pl_tex_destroy(gpu, &fbos[i]);
 }
@@ -202,6 +424,17 @@ static void bench_deband_heavy(pl_shader sh, pl_shader_obj *state, pl_tex src)
     ));
 }
 
+static void bench_deband_early_exit(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    pl_shader_deband(sh, pl_sample_src( .tex = src ), pl_deband_params(
+        .iterations = 4,
+        .threshold  = 4.0,
+        .radius     = 4.0,
+        .grain      = 16.0,
+        .early_exit = true,
+    ));
+}
+
 static void bench_bilinear(pl_shader sh, pl_shader_obj *state, pl_tex src)
 {
     REQUIRE(pl_shader_sample_bilinear(sh, pl_sample_src( .tex = src )));
@@ -222,6 +455,24 @@ static void bench_gaussian(pl_shader sh, pl_shader_obj *state, pl_tex src)
     REQUIRE(pl_shader_sample_gaussian(sh, pl_sample_src( .tex = src )));
 }
 
+static void bench_many_passes(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    // Cycle through a few hundred distinct passes, to stress pass lookup
+    static int idx;
+    const int num_trc = PL_COLOR_TRC_COUNT - 1;
+    struct pl_color_space csp = { .transfer = 1 + idx % num_trc };
+    struct pl_color_repr repr = {
+        .sys = 1 + (idx / num_trc) % (PL_COLOR_SYSTEM_COUNT - 1),
+    };
+    if (repr.sys == PL_COLOR_SYSTEM_DOLBYVISION)
+        repr.sys = PL_COLOR_SYSTEM_RGB; // requires metadata
+    idx++;
+
+    REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
+    pl_shader_decode_color(sh, &repr, NULL);
+    pl_shader_delinearize(sh, &csp);
+}
+
 static void bench_dither_blue(pl_shader sh, pl_shader_obj *state, pl_tex src)
 {
     REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
@@ -230,6 +481,15 @@ static void bench_dither_blue(pl_shader sh, pl_shader_obj *state, pl_tex src)
     ));
 }
 
+static void bench_dither_blue_temporal(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
+    pl_shader_dither(sh, 8, state, pl_dither_params(
+        .method   = PL_DITHER_BLUE_NOISE,
+        .temporal = true,
+    ));
+}
+
 static void bench_dither_white(pl_shader sh, pl_shader_obj *state, pl_tex src)
 {
     REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
@@ -267,6 +527,18 @@ static void bench_polar_nocompute(pl_shader sh, pl_shader_obj *state, pl_tex src
     REQUIRE(pl_shader_sample_polar(sh, pl_sample_src( .tex = src ), &params));
 }
 
+static void bench_polar_nocompute_ar(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    struct pl_sample_filter_params params = {
+        .filter = pl_filter_ewa_lanczos,
+        .antiring = 0.8,
+        .no_compute = true,
+        .lut = state,
+    };
+
+    REQUIRE(pl_shader_sample_polar(sh, pl_sample_src( .tex = src ), &params));
+}
+
 static void bench_hdr_peak(pl_shader sh, pl_shader_obj *state, pl_tex src)
 {
     REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
@@ -279,6 +551,14 @@ static void bench_hdr_peak_hq(pl_shader sh, pl_shader_obj *state, pl_tex src)
     REQUIRE(pl_shader_detect_peak(sh, pl_color_space_hdr10, state, &pl_peak_detect_high_quality_params));
 }
 
+static void bench_hdr_peak_fast(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
+    REQUIRE(pl_shader_detect_peak(sh, pl_color_space_hdr10, state, pl_peak_detect_params(
+        .downsample = true,
+    )));
+}
+
 static void bench_hdr_lut(pl_shader sh, pl_shader_obj *state, pl_tex src)
 {
     struct pl_color_map_params params = {
@@ -349,6 +629,20 @@ static void bench_yadif(pl_shader sh, pl_shader_obj *state, pl_tex src)
     ));
 }
 
+static void bench_bwdif(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    struct pl_deinterlace_source dsrc = {
+        .prev = pl_field_pair(src),
+        .cur = pl_field_pair(src),
+        .next = pl_field_pair(src),
+        .field = PL_FIELD_TOP,
+    };
+
+    pl_shader_deinterlace(sh, &dsrc, pl_deinterlace_params(
+        .algo = PL_DEINTERLACE_BWDIF,
+    ));
+}
+
 static void bench_av1_grain(pl_shader sh, pl_shader_obj *state, pl_tex src)
 {
     struct pl_film_grain_params params = {
@@ -439,8 +733,49 @@ static void bench_reshape_mmr(pl_shader sh, pl_shader_obj *state, pl_tex src)
     pl_shader_dovi_reshape(sh, &dovi_meta); // this includes MMR
 }
 
+static void bench_reshape_mmr_lut(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
+    pl_shader_dovi_reshape_lut(sh, &dovi_meta, 0, state);
+}
+
 static float data[WIDTH * HEIGHT * COMPS + 8192];
 
+static void render_contrast(pl_renderer rr, pl_tex src, pl_tex fbo,
+                            float feature_map_downscale)
+{
+    const struct pl_frame image = {
+        .num_planes = 1,
+        .planes     = {{ .texture = src, .components = 4,
+                         .component_mapping = {0, 1, 2, 3} }},
+        .repr       = pl_color_repr_rgb,
+        .color      = pl_color_space_hdr10,
+    };
+
+    const struct pl_frame target = {
+        .num_planes = 1,
+        .planes     = {{ .texture = fbo, .components = 4,
+                         .component_mapping = {0, 1, 2, 3} }},
+        .repr       = pl_color_repr_rgb,
+        .color      = pl_color_space_srgb,
+    };
+
+    struct pl_render_params params = pl_render_fast_params;
+    params.color_map_params = &pl_color_map_high_quality_params;
+    params.feature_map_downscale = feature_map_downscale;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+}
+
+static void bench_contrast_recovery(pl_renderer rr, pl_tex src, pl_tex fbo)
+{
+    render_contrast(rr, src, fbo, 0.0f);
+}
+
+static void bench_contrast_recovery_fast(pl_renderer rr, pl_tex src, pl_tex fbo)
+{
+    render_contrast(rr, src, fbo, 4.0f);
+}
+
 static void bench_download(pl_gpu gpu, pl_tex tex)
 {
     REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
@@ -477,6 +812,212 @@ static void bench_upload_async(pl_gpu gpu, pl_tex tex)
     )));
 }
 
+// Transfer matrix benchmarks
+enum xfer_mode {
+    XFER_PTR,           // host pointer, imported directly if possible
+    XFER_PTR_MEMCPY,    // host pointer, always copied via staging memory
+    XFER_BUF,           // host-mapped `pl_buf`
+};
+
+struct xfer_bench {
+    const char *format;
+    enum xfer_mode mode;
+    size_t pitch_align; // row pitch alignment, or 0 for tightly packed
+    int chunks;         // number of separate transfers per image, or 0
+    bool download;
+};
+
+static void do_transfer(pl_gpu gpu, pl_tex tex, pl_buf buf, size_t row_pitch,
+                        const struct xfer_bench *xb)
+{
+    uint8_t *ptr = (uint8_t *) PL_ALIGN((uintptr_t) data, 4096);
+    const int rows = PL_DIV_UP(HEIGHT, PL_DEF(xb->chunks, 1));
+    for (int y = 0; y < HEIGHT; y += rows) {
+        struct pl_tex_transfer_params params = {
+            .tex        = tex,
+            .rc         = { 0, y, 0, WIDTH, PL_MIN(y + rows, HEIGHT), 1 },
+            .row_pitch  = row_pitch,
+            .no_import  = xb->mode == XFER_PTR_MEMCPY,
+        };
+
+        if (buf) {
+            params.buf = buf;
+            params.buf_offset = y * row_pitch;
+        } else {
+            params.ptr = ptr + y * row_pitch;
+        }
+
+        if (xb->download) {
+            REQUIRE(pl_tex_download(gpu, &params));
+        } else {
+            REQUIRE(pl_tex_upload(gpu, &params));
+        }
+    }
+}
+
+static void bench_transfer(pl_gpu gpu, const struct xfer_bench *xb)
+{
+    static const char *modes[] = {
+        [XFER_PTR]          = "ptr",
+        [XFER_PTR_MEMCPY]   = "memcpy",
+        [XFER_BUF]          = "buf",
+    };
+
+    char name[128];
+    snprintf(name, sizeof(name), "tex_%s %s %s pitch=%zu chunks=%d",
+             xb->download ? "download" : "upload", xb->format, modes[xb->mode],
+             xb->pitch_align, PL_DEF(xb->chunks, 1));
+
+    const enum pl_fmt_caps caps = PL_FMT_CAP_HOST_READABLE;
+    pl_fmt fmt = pl_find_named_fmt(gpu, xb->format);
+    if (!fmt || (fmt->caps & caps) != caps || fmt->emulated) {
+        printf("'%s':\tunsupported\n", name);
+        return;
+    }
+
+    const size_t row_pitch = PL_ALIGN(WIDTH * fmt->texel_size, xb->pitch_align);
+    const size_t size = row_pitch * HEIGHT;
+    pl_assert(size + 4096 <= sizeof(data));
+
+    pl_tex texs[NUM_TEX] = {0};
+    pl_buf bufs[NUM_TEX] = {0};
+    for (int i = 0; i < NUM_TEX; i++) {
+        texs[i] = pl_tex_create(gpu, pl_tex_params(
+            .format         = fmt,
+            .w              = WIDTH,
+            .h              = HEIGHT,
+            .host_writable  = true,
+            .host_readable  = true,
+        ));
+        REQUIRE(texs[i]);
+
+        if (xb->mode == XFER_BUF) {
+            bufs[i] = pl_buf_create(gpu, pl_buf_params(
+                .size        = size,
+                .memory_type = PL_BUF_MEM_HOST,
+                .host_mapped = true,
+            ));
+            REQUIRE(bufs[i]);
+        }
+    }
+
+    // Measure latency first, by waiting for every single transfer
+    double latency[32];
+    for (int i = 0; i < PL_ARRAY_SIZE(latency); i++) {
+        pl_clock_t start = pl_clock_now();
+        do_transfer(gpu, texs[0], bufs[0], row_pitch, xb);
+        pl_gpu_finish(gpu);
+        latency[i] = pl_clock_diff(pl_clock_now(), start);
+    }
+
+    // Then measure throughput, keeping up to NUM_TEX transfers in flight
+    pl_clock_t start_warmup = pl_clock_now(), start_test = 0;
+    unsigned long frames = 0, frames_warmup = 0;
+    do {
+        const int idx = frames % NUM_TEX;
+        while (pl_tex_poll(gpu, texs[idx], UINT64_MAX))
+            ; // do nothing
+        while (bufs[idx] && pl_buf_poll(gpu, bufs[idx], UINT64_MAX))
+            ; // do nothing
+        do_transfer(gpu, texs[idx], bufs[idx], row_pitch, xb);
+        pl_gpu_flush(gpu);
+        frames++;
+
+        pl_clock_t now = pl_clock_now();
+        if (start_test) {
+            if (pl_clock_diff(now, start_test) > TEST_MS * 1e-3)
+                break;
+        } else if (pl_clock_diff(now, start_warmup) > WARMUP_MS * 1e-3) {
+            start_test = now;
+            frames_warmup = frames;
+        }
+    } while (true);
+
+    pl_gpu_finish(gpu);
+    frames -= frames_warmup;
+    double secs = pl_clock_diff(pl_clock_now(), start_test);
+
+    // Report the median latency (insertion sort, the array is tiny)
+    for (int i = 1; i < PL_ARRAY_SIZE(latency); i++) {
+        for (int j = i; j > 0 && latency[j - 1] > latency[j]; j--)
+            PL_SWAP(latency[j - 1], latency[j]);
+    }
+
+    printf("'%s':\t%4lu frames in %1.6f seconds => %6.3f GB/s, latency: %2.6f ms\n",
+           name, frames, secs, 1e-9 * size * frames / secs,
+           1e3 * latency[PL_ARRAY_SIZE(latency) / 2]);
+
+    for (int i = 0; i < NUM_TEX; i++) {
+        pl_tex_destroy(gpu, &texs[i]);
+        pl_buf_destroy(gpu, &bufs[i]);
+    }
+}
+
+static void bench_tone_map(const struct pl_tone_map_function *fun, int lut_size)
+{
+    static float lut[4096];
+    pl_assert(lut_size <= PL_ARRAY_SIZE(lut));
+
+    const struct pl_tone_map_params params = {
+        .function       = fun,
+        .constants      = { PL_TONE_MAP_CONSTANTS },
+        .input_scaling  = PL_HDR_PQ,
+        .output_scaling = PL_HDR_PQ,
+        .lut_size       = lut_size,
+        .input_min      = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 0.005),
+        .input_max      = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 4000.0),
+        .input_avg      = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 100.0),
+        .output_min     = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 0.1),
+        .output_max     = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 1000.0),
+    };
+
+    unsigned long iters = 0;
+    pl_clock_t start = pl_clock_now(), now;
+    do {
+        pl_tone_map_generate(lut, &params);
+        iters++;
+        now = pl_clock_now();
+    } while (pl_clock_diff(now, start) < TEST_MS * 1e-3 / 10);
+
+    double secs = pl_clock_diff(now, start);
+    printf("'tone_map %s (%d)':\t%6lu LUTs in %1.6f seconds => %2.6f ms/LUT\n",
+           fun->name, lut_size, iters, secs, 1000 * secs / iters);
+}
+
+static void bench_gamut_map(const struct pl_gamut_map_function *fun,
+                            int size_I, int size_C, int size_h)
+{
+    const struct pl_gamut_map_params params = {
+        .function     = fun,
+        .constants    = { PL_GAMUT_MAP_CONSTANTS },
+        .input_gamut  = *pl_raw_primaries_get(PL_COLOR_PRIM_BT_2020),
+        .output_gamut = *pl_raw_primaries_get(PL_COLOR_PRIM_BT_709),
+        .max_luma     = pl_hdr_rescale(PL_HDR_NORM, PL_HDR_PQ, 1.0f),
+        .lut_size_I   = size_I,
+        .lut_size_C   = size_C,
+        .lut_size_h   = size_h,
+        .lut_stride   = 3,
+    };
+
+    float *lut = malloc(sizeof(float[3]) * size_I * size_C * size_h);
+    if (!lut)
+        return;
+
+    unsigned long iters = 0;
+    pl_clock_t start = pl_clock_now(), now;
+    do {
+        pl_gamut_map_generate(lut, &params);
+        iters++;
+        now = pl_clock_now();
+    } while (pl_clock_diff(now, start) < TEST_MS * 1e-3 / 10);
+
+    double secs = pl_clock_diff(now, start);
+    printf("'gamut_map %s (%dx%dx%d)':\t%6lu LUTs in %1.6f seconds => "
+           "%2.6f ms/LUT\n", fun->name, size_I, size_C, size_h, iters, secs,
+           1000 * secs / iters);
+    free(lut);
+}
+
 int main()
 {
     setbuf(stdout, NULL);
@@ -494,36 +1035,88 @@ int main()
         .queue_count    = NUM_QUEUES,
     ));
 
+    printf("= Running CPU benchmarks =\n");
+    for (int i = 0; i < pl_num_tone_map_functions; i++) {
+        for (int size = 256; size <= 4096; size *= 4)
+            bench_tone_map(pl_tone_map_functions[i], size);
+    }
+
+    // Default `pl_color_map_params.lut3d_size`, and a large cube
+    for (int i = 0; i < pl_num_gamut_map_functions; i++) {
+        bench_gamut_map(pl_gamut_map_functions[i], 48, 32, 256);
+        bench_gamut_map(pl_gamut_map_functions[i], 65, 65, 65);
+    }
+
     if (!vk)
         return SKIP;
 
 #define BENCH_SH(fn)  &(struct bench) { .run_sh = fn }
 #define BENCH_TEX(fn) &(struct bench) { .run_tex = fn }
+#define BENCH_RENDER(fn) &(struct bench) { .run_render = fn }
+#define BENCH_FRAME(...) &(struct bench) { .frame = &(struct bench_frame) { __VA_ARGS__ } }
 
     printf("= Running benchmarks =\n");
     benchmark(vk->gpu, "tex_download ptr", BENCH_TEX(bench_download));
     benchmark(vk->gpu, "tex_download ptr async", BENCH_TEX(bench_download_async));
     benchmark(vk->gpu, "tex_upload ptr", BENCH_TEX(bench_upload));
     benchmark(vk->gpu, "tex_upload ptr async", BENCH_TEX(bench_upload_async));
+
+    // Transfer matrix, to pick the fastest upload path for software decoding
+    static const char *xfer_formats[] = {
+        "r8", "rg8", "rgba8", "r16", "rg16", "rgba16", "rgb10a2",
+    };
+
+    for (int dl = 0; dl <= 1; dl++) {
+        for (enum xfer_mode mode = XFER_PTR; mode <= XFER_BUF; mode++) {
+            for (int i = 0; i < PL_ARRAY_SIZE(xfer_formats); i++) {
+                bench_transfer(vk->gpu, &(struct xfer_bench) {
+                    .format     = xfer_formats[i],
+                    .mode       = mode,
+                    .download   = dl,
+                });
+            }
+
+            // Row pitch alignment and chunking, for a typical 16-bit plane
+            static const struct { size_t pitch_align; int chunks; } variants[] = {
+                { 256, 0 }, { 4096, 0 }, { 0, 4 }, { 0, 16 },
+            };
+
+            for (int i = 0; i < PL_ARRAY_SIZE(variants); i++) {
+                bench_transfer(vk->gpu, &(struct xfer_bench) {
+                    .format      = "r16",
+                    .mode        = mode,
+                    .pitch_align = variants[i].pitch_align,
+                    .chunks      = variants[i].chunks,
+                    .download    = dl,
+                });
+            }
+        }
+    }
+
     benchmark(vk->gpu, "bilinear", BENCH_SH(bench_bilinear));
     benchmark(vk->gpu, "bicubic", BENCH_SH(bench_bicubic));
     benchmark(vk->gpu, "hermite", BENCH_SH(bench_hermite));
     benchmark(vk->gpu, "gaussian", BENCH_SH(bench_gaussian));
     benchmark(vk->gpu, "deband", BENCH_SH(bench_deband));
     benchmark(vk->gpu, "deband_heavy", BENCH_SH(bench_deband_heavy));
+    benchmark(vk->gpu, "deband_early_exit", BENCH_SH(bench_deband_early_exit));
 
     // Deinterlacing
     benchmark(vk->gpu, "weave", BENCH_SH(bench_weave));
     benchmark(vk->gpu, "bob", BENCH_SH(bench_bob));
     benchmark(vk->gpu, "yadif", BENCH_SH(bench_yadif));
+    benchmark(vk->gpu, "bwdif", BENCH_SH(bench_bwdif));
 
     // Polar sampling
     benchmark(vk->gpu, "polar", BENCH_SH(bench_polar));
-    if (vk->gpu->glsl.compute)
+    if (vk->gpu->glsl.compute) {
         benchmark(vk->gpu, "polar_nocompute", BENCH_SH(bench_polar_nocompute));
+        benchmark(vk->gpu, "polar_nocompute_ar", BENCH_SH(bench_polar_nocompute_ar));
+    }
 
     // Dithering algorithms
     benchmark(vk->gpu, "dither_blue", BENCH_SH(bench_dither_blue));
+    benchmark(vk->gpu, "dither_blue_temporal", BENCH_SH(bench_dither_blue_temporal));
     benchmark(vk->gpu, "dither_white", BENCH_SH(bench_dither_white));
     benchmark(vk->gpu, "dither_ordered_fixed", BENCH_SH(bench_dither_ordered_fix));
 
@@ -531,11 +1124,48 @@ int main()
     if (vk->gpu->glsl.compute) {
         benchmark(vk->gpu, "hdr_peakdetect",    BENCH_SH(bench_hdr_peak));
         benchmark(vk->gpu, "hdr_peakdetect_hq", BENCH_SH(bench_hdr_peak_hq));
+        benchmark(vk->gpu, "hdr_peakdetect_fast", BENCH_SH(bench_hdr_peak_fast));
     }
 
     // Tone mapping
     benchmark(vk->gpu, "hdr_lut", BENCH_SH(bench_hdr_lut));
     benchmark(vk->gpu, "hdr_clip", BENCH_SH(bench_hdr_clip));
+    benchmark(vk->gpu, "contrast_recovery", BENCH_RENDER(bench_contrast_recovery));
+    benchmark(vk->gpu, "contrast_recovery_fast", BENCH_RENDER(bench_contrast_recovery_fast));
+
+    // Dispatch overhead
+    benchmark(vk->gpu, "many_passes", BENCH_SH(bench_many_passes));
+
+    // End-to-end rendering
+    static const struct {
+        const char *name;
+        const struct pl_render_params *params;
+    } presets[] = {
+        { "fast",    &pl_render_fast_params },
+        { "default", &pl_render_default_params },
+        { "hq",      &pl_render_high_quality_params },
+    };
+
+    for (int i = 0; i < PL_ARRAY_SIZE(presets); i++) {
+        const struct pl_render_params *par = presets[i].params;
+        char name[64];
+#define BENCH_PRESET(desc, ...)                                             \
+        snprintf(name, sizeof(name), "render_%s %s", presets[i].name, desc);\
+        benchmark(vk->gpu, name, BENCH_FRAME( .params = par, __VA_ARGS__ ));
+
+        BENCH_PRESET("sdr8 1080p", .type = FRAME_SDR, .depth = 8);
+        BENCH_PRESET("sdr8 720p->1080p", .type = FRAME_SDR, .depth = 8,
+                     .src_w = 1280, .src_h = 720);
+        BENCH_PRESET("sdr8 1080p->720p", .type = FRAME_SDR, .depth = 8,
+                     .dst_w = 1280, .dst_h = 720);
+        BENCH_PRESET("hdr10 1080p", .type = FRAME_HDR10, .depth = 10);
+        BENCH_PRESET("hdr10 2160p->1080p", .type = FRAME_HDR10, .depth = 10,
+                     .src_w = 3840, .src_h = 2160);
+        BENCH_PRESET("dovi 1080p", .type = FRAME_DOVI, .depth = 10);
+        BENCH_PRESET("hdr10 1080p mix", .type = FRAME_HDR10, .depth = 10,
+                     .mix = true);
+#undef BENCH_PRESET
+    }
 
     // Misc stuff
     benchmark(vk->gpu, "av1_grain", BENCH_SH(bench_av1_grain));
@@ -543,6 +1173,7 @@ int main()
     benchmark(vk->gpu, "h274_grain", BENCH_SH(bench_h274_grain));
     benchmark(vk->gpu, "reshape_poly", BENCH_SH(bench_reshape_poly));
     benchmark(vk->gpu, "reshape_mmr", BENCH_SH(bench_reshape_mmr));
+    benchmark(vk->gpu, "reshape_mmr_lut", BENCH_SH(bench_reshape_mmr_lut));
 
     pl_vulkan_destroy(&vk);
     pl_log_destroy(&log);
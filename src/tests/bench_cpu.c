@@ -0,0 +1,439 @@
+#include "tests.h"
+#include "stub_gpu.h"
+
+#include <libplacebo/dispatch.h>
+#include <libplacebo/dummy.h>
+#include <libplacebo/renderer.h>
+#include <libplacebo/shaders/colorspace.h>
+#include <libplacebo/shaders/sampling.h>
+#include <libplacebo/gamut_mapping.h>
+#include <libplacebo/tone_mapping.h>
+
+enum {
+    // Image configuration
+    WIDTH       = 1920,
+    HEIGHT      = 1080,
+
+    // Test configuration
+    TEST_MS     = 1000,
+    WARMUP_MS   = 200,
+};
+
+// Mutable per-frame state, for parameter churn benchmarks
+struct churn {
+    struct pl_render_params params;
+    struct pl_color_map_params color_map;
+    struct pl_filter_config upscaler;
+    struct pl_hdr_metadata hdr;
+};
+
+struct bench {
+    // Builds a shader, which is then either dispatched or aborted
+    void (*run_sh)(pl_shader sh, pl_shader_obj *state, pl_tex src);
+    bool dispatch;
+
+    // Renders a YUV 4:2:0 frame from a source of the given size
+    const struct pl_render_params *render;
+    int src_w, src_h;
+    bool hdr;
+
+    // If set, called before rendering every frame to modify the parameters,
+    // and the distribution of individual frame times is reported instead
+    void (*update)(struct churn *churn, int frame);
+};
+
+static int cmp_double(const void *pa, const void *pb)
+{
+    double a = *(const double *) pa, b = *(const double *) pb;
+    return (a > b) - (a < b);
+}
+
+// Nearest-rank percentile of a sorted array
+static double percentile(const double *times, int num, double p)
+{
+    int idx = ceil(p / 100.0 * num) - 1;
+    return times[PL_CLAMP(idx, 0, num - 1)];
+}
+
+// Prints the distribution of individual frame times, to quantify hitching
+static void print_spikes(const char *name, double *times, int num)
+{
+    REQUIRE(num > 0);
+    qsort(times, num, sizeof(double), cmp_double);
+    printf("'%s':\t%6d frames => p50 %8.3f ms, p99 %8.3f ms, max %8.3f ms\n",
+           name, num, 1e3 * percentile(times, num, 50),
+           1e3 * percentile(times, num, 99), 1e3 * times[num - 1]);
+}
+
+static void render_frame(pl_renderer rr, pl_tex planes[2], pl_tex fbo,
+                         const struct bench *bench, const struct churn *churn)
+{
+    struct pl_frame image = {
+        .num_planes = 2,
+        .planes     = {
+            {
+                .texture = planes[0],
+                .components = 1,
+                .component_mapping = {PL_CHANNEL_Y},
+            }, {
+                .texture = planes[1],
+                .components = 2,
+                .component_mapping = {PL_CHANNEL_U, PL_CHANNEL_V},
+            },
+        },
+        .repr   = {
+            .sys    = bench->hdr ? PL_COLOR_SYSTEM_BT_2020_NC : PL_COLOR_SYSTEM_BT_709,
+            .levels = PL_COLOR_LEVELS_LIMITED,
+        },
+        .color  = bench->hdr ? pl_color_space_hdr10 : pl_color_space_bt709,
+    };
+
+    pl_frame_set_chroma_location(&image, PL_CHROMA_LEFT);
+    if (churn && bench->hdr)
+        image.color.hdr = churn->hdr;
+
+    const struct pl_frame target = {
+        .num_planes = 1,
+        .planes     = {{ .texture = fbo, .components = 4,
+                         .component_mapping = {0, 1, 2, 3} }},
+        .repr       = pl_color_repr_rgb,
+        .color      = pl_color_space_srgb,
+    };
+
+    REQUIRE(pl_render_image(rr, &image, &target,
+                            churn ? &churn->params : bench->render));
+}
+
+static void run_bench(pl_dispatch dp, pl_renderer rr, pl_shader_obj *state,
+                      pl_tex src, pl_tex planes[2], pl_tex fbo,
+                      const struct bench *bench, const struct churn *churn)
+{
+    if (bench->render) {
+        render_frame(rr, planes, fbo, bench, churn);
+        return;
+    }
+
+    pl_shader sh = pl_dispatch_begin(dp);
+    bench->run_sh(sh, state, src);
+    if (bench->dispatch) {
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        )));
+    } else {
+        pl_dispatch_abort(dp, &sh);
+    }
+}
+
+static void benchmark(pl_gpu gpu, const char *name, const struct bench *bench)
+{
+    pl_dispatch dp = pl_dispatch_create(gpu->log, gpu);
+    pl_renderer rr = pl_renderer_create(gpu->log, gpu);
+    REQUIRE(dp && rr);
+    pl_shader_obj state = NULL;
+
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 16, 16, PL_FMT_CAP_RENDERABLE);
+    pl_fmt fmt_y = pl_find_fmt(gpu, PL_FMT_UNORM, 1, 8, 8, PL_FMT_CAP_SAMPLEABLE);
+    pl_fmt fmt_uv = pl_find_fmt(gpu, PL_FMT_UNORM, 2, 8, 8, PL_FMT_CAP_SAMPLEABLE);
+    REQUIRE(fmt && fmt_y && fmt_uv);
+
+    const int src_w = PL_DEF(bench->src_w, WIDTH), src_h = PL_DEF(bench->src_h, HEIGHT);
+    pl_tex src = pl_tex_create(gpu, pl_tex_params(
+        .format     = fmt,
+        .w          = src_w,
+        .h          = src_h,
+        .sampleable = true,
+    ));
+
+    pl_tex planes[2] = {
+        pl_tex_create(gpu, pl_tex_params(
+            .format     = fmt_y,
+            .w          = src_w,
+            .h          = src_h,
+            .sampleable = true,
+        )),
+        pl_tex_create(gpu, pl_tex_params(
+            .format     = fmt_uv,
+            .w          = src_w / 2,
+            .h          = src_h / 2,
+            .sampleable = true,
+        )),
+    };
+
+    pl_tex fbo = pl_tex_create(gpu, pl_tex_params(
+        .format     = fmt,
+        .w          = WIDTH,
+        .h          = HEIGHT,
+        .renderable = true,
+        .storable   = !!(fmt->caps & PL_FMT_CAP_STORABLE),
+    ));
+    REQUIRE(src && planes[0] && planes[1] && fbo);
+
+    struct churn churn = {0};
+    PL_ARRAY(double) times = {0};
+    if (bench->update) {
+        const struct pl_render_params *par = bench->render;
+        churn.params = *par;
+        churn.color_map = *PL_DEF(par->color_map_params, &pl_color_map_default_params);
+        churn.params.color_map_params = &churn.color_map;
+        churn.hdr = pl_hdr_metadata_hdr10;
+        if (par->upscaler) {
+            churn.upscaler = *par->upscaler;
+            churn.params.upscaler = &churn.upscaler;
+        }
+    }
+
+    // Run once to create all passes, LUTs etc.
+    run_bench(dp, rr, &state, src, planes, fbo, bench, bench->update ? &churn : NULL);
+    const size_t glsl_initial = stub_stats.glsl_created;
+
+    pl_clock_t start_warmup = pl_clock_now(), start_test = 0, now;
+    unsigned long frames = 0, frames_warmup = 0;
+    struct pl_alloc_stats stats_start = {0}, stats_end;
+    size_t glsl_start = 0;
+
+    do {
+        if (bench->update) {
+            bench->update(&churn, frames);
+            pl_clock_t frame_start = pl_clock_now();
+            run_bench(dp, rr, &state, src, planes, fbo, bench, &churn);
+            if (start_test)
+                PL_ARRAY_APPEND(NULL, times, pl_clock_diff(pl_clock_now(), frame_start));
+        } else {
+            run_bench(dp, rr, &state, src, planes, fbo, bench, NULL);
+        }
+        frames++;
+
+        now = pl_clock_now();
+        if (start_test) {
+            if (pl_clock_diff(now, start_test) > TEST_MS * 1e-3)
+                break;
+        } else if (pl_clock_diff(now, start_warmup) > WARMUP_MS * 1e-3) {
+            frames_warmup = frames;
+            glsl_start = stub_stats.glsl_created;
+            pl_alloc_get_stats(&stats_start);
+            start_test = pl_clock_now();
+        }
+    } while (true);
+
+    if (bench->update) {
+        print_spikes(name, times.elem, times.num);
+        pl_free(times.elem);
+        goto done;
+    }
+
+    const bool have_stats = pl_alloc_get_stats(&stats_end);
+    frames -= frames_warmup;
+    double secs = pl_clock_diff(now, start_test);
+    printf("'%s':\t%6lu frames => %8.0f ns/frame", name, frames, 1e9 * secs / frames);
+    if (have_stats) {
+        printf(", %6.1f allocs/frame (%7.0f bytes)",
+               (double) (stats_end.count - stats_start.count) / frames,
+               (double) (stats_end.bytes - stats_start.bytes) / frames);
+    }
+    printf(", glsl: %zu bytes initial, %.1f bytes/frame\n", glsl_initial,
+           (double) (stub_stats.glsl_created - glsl_start) / frames);
+
+done:
+    stub_stats.glsl_created = 0;
+
+    pl_shader_obj_destroy(&state);
+    pl_renderer_destroy(&rr);
+    pl_dispatch_destroy(&dp);
+    pl_tex_destroy(gpu, &src);
+    pl_tex_destroy(gpu, &planes[0]);
+    pl_tex_destroy(gpu, &planes[1]);
+    pl_tex_destroy(gpu, &fbo);
+}
+
+// List of benchmarks
+static void bench_bilinear(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    REQUIRE(pl_shader_sample_bilinear(sh, pl_sample_src( .tex = src )));
+}
+
+static void bench_polar(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    struct pl_sample_filter_params params = {
+        .filter = pl_filter_ewa_lanczos,
+        .lut = state,
+    };
+
+    REQUIRE(pl_shader_sample_polar(sh, pl_sample_src( .tex = src ), &params));
+}
+
+static void bench_color_map(pl_shader sh, pl_shader_obj *state, pl_tex src)
+{
+    REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
+    pl_shader_decode_color(sh, &(struct pl_color_repr) {
+        .sys = PL_COLOR_SYSTEM_BT_2020_NC,
+        .levels = PL_COLOR_LEVELS_LIMITED,
+    }, NULL);
+    pl_shader_color_map_ex(sh, &pl_color_map_default_params, pl_color_map_args(
+        .src = pl_color_space_hdr10,
+        .dst = pl_color_space_monitor,
+        .state = state,
+    ));
+    pl_shader_dither(sh, 8, NULL, pl_dither_params(
+        .method = PL_DITHER_ORDERED_FIXED,
+    ));
+}
+
+// Parameter churn, e.g. from interactive tuning or dynamic HDR metadata
+static void churn_metadata(struct churn *churn, int frame)
+{
+    churn->hdr.max_cll = 1000.0f + 10.0f * (frame % 300);
+    churn->hdr.max_fall = churn->hdr.max_cll / 4;
+}
+
+static void churn_tone_map(struct churn *churn, int frame)
+{
+    churn->color_map.tone_constants.knee_adaptation = 0.2f + 1e-3f * (frame % 600);
+}
+
+static void churn_gamut_map(struct churn *churn, int frame)
+{
+    churn->color_map.gamut_mapping = &pl_gamut_map_perceptual;
+    churn->color_map.gamut_constants.perceptual_strength = 0.2f + 1e-3f * (frame % 800);
+}
+
+static void churn_upscaler(struct churn *churn, int frame)
+{
+    churn->upscaler.blur = 1.0f + 1e-3f * (frame % 200);
+}
+
+// Times individual calls of a CPU-side LUT generator with changing inputs
+static void churn_generate(const char *name, void (*gen)(int frame))
+{
+    PL_ARRAY(double) times = {0};
+    pl_clock_t start = pl_clock_now(), now;
+    int frame = 0;
+    do {
+        pl_clock_t call_start = pl_clock_now();
+        gen(frame++);
+        now = pl_clock_now();
+        PL_ARRAY_APPEND(NULL, times, pl_clock_diff(now, call_start));
+    } while (pl_clock_diff(now, start) < TEST_MS * 1e-3 || frame < 10);
+
+    print_spikes(name, times.elem, times.num);
+    pl_free(times.elem);
+}
+
+static void gen_tone_map(int frame)
+{
+    static float lut[256];
+    pl_tone_map_generate(lut, &(struct pl_tone_map_params) {
+        .function       = &pl_tone_map_spline,
+        .constants      = { PL_TONE_MAP_CONSTANTS },
+        .input_scaling  = PL_HDR_PQ,
+        .output_scaling = PL_HDR_PQ,
+        .lut_size       = PL_ARRAY_SIZE(lut),
+        .input_min      = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 0.005),
+        .input_max      = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 1000.0 + frame),
+        .input_avg      = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 100.0),
+        .output_min     = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 0.1),
+        .output_max     = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 203.0),
+    });
+}
+
+static void gen_gamut_map(int frame)
+{
+    const int *size = pl_color_map_default_params.lut3d_size;
+    static float *lut;
+    if (!lut)
+        lut = pl_alloc(NULL, sizeof(float[3]) * size[0] * size[1] * size[2]);
+
+    struct pl_gamut_map_params params = {
+        .function       = &pl_gamut_map_perceptual,
+        .input_gamut    = *pl_raw_primaries_get(PL_COLOR_PRIM_BT_2020),
+        .output_gamut   = *pl_raw_primaries_get(PL_COLOR_PRIM_BT_709),
+        .min_luma       = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 0.1),
+        .max_luma       = pl_hdr_rescale(PL_HDR_NITS, PL_HDR_PQ, 203.0),
+        .constants      = { PL_GAMUT_MAP_CONSTANTS },
+        .lut_size_I     = size[0],
+        .lut_size_C     = size[1],
+        .lut_size_h     = size[2],
+        .lut_stride     = 3,
+    };
+
+    params.constants.perceptual_strength = 0.2f + 1e-3f * (frame % 800);
+    pl_gamut_map_generate(lut, &params);
+}
+
+static void gen_filter(int frame)
+{
+    struct pl_filter_config cfg = pl_filter_ewa_lanczos;
+    cfg.blur = 1.0f + 1e-3f * (frame % 200);
+    pl_filter flt = pl_filter_generate(NULL, pl_filter_params(
+        .config      = cfg,
+        .lut_entries = 256,
+        .cutoff      = 1e-3f,
+    ));
+    REQUIRE(flt);
+    pl_filter_free(&flt);
+}
+
+int main()
+{
+    setbuf(stdout, NULL);
+    setbuf(stderr, NULL);
+
+    pl_log log = pl_log_create(PL_API_VER, pl_log_params(
+        .log_cb     = isatty(fileno(stdout)) ? pl_log_color : pl_log_simple,
+        .log_level  = PL_LOG_ERR, // passes never run, which upsets peak detection
+    ));
+
+    pl_gpu gpu = stub_gpu_create(log);
+
+#define BENCH_SH(fn)       &(struct bench) { .run_sh = fn }
+#define BENCH_DISPATCH(fn) &(struct bench) { .run_sh = fn, .dispatch = true }
+#define BENCH_RENDER(...)  &(struct bench) { __VA_ARGS__ }
+
+    printf("= Running CPU overhead benchmarks =\n");
+
+    // Shader generation only
+    benchmark(gpu, "sh bilinear", BENCH_SH(bench_bilinear));
+    benchmark(gpu, "sh polar", BENCH_SH(bench_polar));
+    benchmark(gpu, "sh color_map", BENCH_SH(bench_color_map));
+
+    // Shader generation + dispatch
+    benchmark(gpu, "dispatch bilinear", BENCH_DISPATCH(bench_bilinear));
+    benchmark(gpu, "dispatch polar", BENCH_DISPATCH(bench_polar));
+    benchmark(gpu, "dispatch color_map", BENCH_DISPATCH(bench_color_map));
+
+    // Full renderer
+    benchmark(gpu, "render_fast sdr 720p->1080p", BENCH_RENDER(
+        .render = &pl_render_fast_params, .src_w = 1280, .src_h = 720));
+    benchmark(gpu, "render_default sdr 720p->1080p", BENCH_RENDER(
+        .render = &pl_render_default_params, .src_w = 1280, .src_h = 720));
+    benchmark(gpu, "render_hq sdr 720p->1080p", BENCH_RENDER(
+        .render = &pl_render_high_quality_params, .src_w = 1280, .src_h = 720));
+    benchmark(gpu, "render_fast hdr10 1080p", BENCH_RENDER(
+        .render = &pl_render_fast_params, .hdr = true));
+    benchmark(gpu, "render_default hdr10 1080p", BENCH_RENDER(
+        .render = &pl_render_default_params, .hdr = true));
+    benchmark(gpu, "render_hq hdr10 1080p", BENCH_RENDER(
+        .render = &pl_render_high_quality_params, .hdr = true));
+
+    printf("= Running parameter churn benchmarks =\n");
+    churn_generate("generate tone_map (256)", gen_tone_map);
+    churn_generate("generate gamut_map (48x32x256)", gen_gamut_map);
+    churn_generate("generate filter (ewa_lanczos)", gen_filter);
+
+    benchmark(gpu, "churn metadata hdr10 1080p", BENCH_RENDER(
+        .render = &pl_render_default_params, .hdr = true,
+        .update = churn_metadata));
+    benchmark(gpu, "churn tone_map hdr10 1080p", BENCH_RENDER(
+        .render = &pl_render_default_params, .hdr = true,
+        .update = churn_tone_map));
+    benchmark(gpu, "churn gamut_map hdr10 1080p", BENCH_RENDER(
+        .render = &pl_render_default_params, .hdr = true,
+        .update = churn_gamut_map));
+    benchmark(gpu, "churn upscaler sdr 720p->1080p", BENCH_RENDER(
+        .render = &pl_render_high_quality_params, .src_w = 1280, .src_h = 720,
+        .update = churn_upscaler));
+
+    pl_gpu_dummy_destroy(&gpu);
+    pl_log_destroy(&log);
+    return 0;
+}
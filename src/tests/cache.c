@@ -2,6 +2,9 @@
 
 #include <libplacebo/cache.h>
 
+#include "pl_clock.h"
+#include "pl_thread.h"
+
 // Returns "foo" for even keys, "bar" for odd
 static pl_cache_obj lookup_foobar(void *priv, uint64_t key)
 {
@@ -18,6 +21,168 @@ static void update_count(void *priv, pl_cache_obj obj)
     *count += obj.size ? 1 : -1;
 }
 
+// Microbenchmark of insertion, lookup and eviction on a large cache
+static void bench_cache(pl_log log)
+{
+    enum { NUM_OBJS = 1 << 16, OBJ_SIZE = 8 };
+    pl_cache cache = pl_cache_create(pl_cache_params(
+        .log            = log,
+        .max_total_size = NUM_OBJS * OBJ_SIZE,
+    ));
+
+    uint8_t data[OBJ_SIZE] = {0};
+    const uint64_t mul = UINT64_C(0x2545f4914f6cdd1d);
+    pl_clock_t start = pl_clock_now();
+    for (uint64_t i = 0; i < 2 * NUM_OBJS; i++) {
+        // The second half of insertions evicts all of the first half
+        pl_cache_obj obj = { .key = i * mul, .data = data, .size = OBJ_SIZE };
+        REQUIRE(pl_cache_try_set(cache, &obj));
+    }
+    pl_clock_t insert = pl_clock_now();
+    REQUIRE_CMP(pl_cache_objects(cache), ==, NUM_OBJS, "d");
+
+    for (uint64_t i = 0; i < 2 * NUM_OBJS; i++) {
+        // Lookup and re-insert, to exercise the LRU list
+        pl_cache_obj obj = { .key = i * mul };
+        REQUIRE(pl_cache_get(cache, &obj) == (i >= NUM_OBJS));
+        if (obj.size)
+            REQUIRE(pl_cache_try_set(cache, &obj));
+    }
+    pl_clock_t lookup = pl_clock_now();
+    REQUIRE_CMP(pl_cache_objects(cache), ==, NUM_OBJS, "d");
+    REQUIRE_CMP(pl_cache_size(cache), ==, NUM_OBJS * OBJ_SIZE, "zu");
+
+    printf("pl_cache with %d objects: %.1f ns/insert, %.1f ns/lookup\n", NUM_OBJS,
+           1e9 * pl_clock_diff(insert, start) / (2 * NUM_OBJS),
+           1e9 * pl_clock_diff(lookup, insert) / (2 * NUM_OBJS));
+    pl_cache_destroy(&cache);
+}
+
+static long file_size(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    REQUIRE(file);
+    fseek(file, 0, SEEK_END);
+    long size = ftell(file);
+    fclose(file);
+    return size;
+}
+
+static void test_journal(pl_log log)
+{
+    static const char *path = "test_cache.journal";
+    remove(path);
+
+    pl_cache cache = pl_cache_create(pl_cache_params( .log = log ));
+    REQUIRE(pl_cache_journal_open(cache, path));
+    const long empty_size = file_size(path);
+    REQUIRE(pl_cache_try_set(cache, &(pl_cache_obj) { .key = 0x1, .data = "abc",  .size = 3 }));
+    REQUIRE(pl_cache_try_set(cache, &(pl_cache_obj) { .key = 0x2, .data = "de",   .size = 2 }));
+    REQUIRE(pl_cache_try_set(cache, &(pl_cache_obj) { .key = 0x3, .data = "xyzw", .size = 4 }));
+    REQUIRE(pl_cache_try_set(cache, &(pl_cache_obj) { .key = 0x2 })); // delete 0x2
+    const long full_size = file_size(path);
+    REQUIRE_CMP(full_size, >, empty_size, "ld");
+
+    // Looking up and re-inserting unmodified objects should not grow the file
+    pl_cache_obj obj = { .key = 0x1 };
+    REQUIRE(pl_cache_get(cache, &obj));
+    pl_cache_set(cache, &obj);
+    REQUIRE(pl_cache_try_set(cache, &(pl_cache_obj) { .key = 0x4 })); // no-op
+    REQUIRE_CMP(file_size(path), ==, full_size, "ld");
+    pl_cache_destroy(&cache);
+
+    // Journals can be loaded like regular cache files
+    cache = pl_cache_create(pl_cache_params( .log = log ));
+    FILE *file = fopen(path, "rb");
+    REQUIRE(file);
+    REQUIRE_CMP(pl_cache_load_file(cache, file), ==, 3, "d"); // includes 0x2
+    fclose(file);
+    REQUIRE_CMP(pl_cache_objects(cache), ==, 2, "d");
+    REQUIRE_CMP(pl_cache_size(cache), ==, 7, "zu");
+    pl_cache_reset(cache);
+
+    // Re-opening the journal compacts it
+    REQUIRE(pl_cache_journal_open(cache, path));
+    REQUIRE_CMP(pl_cache_objects(cache), ==, 2, "d");
+    REQUIRE_CMP(file_size(path), <, full_size, "ld");
+    obj = (pl_cache_obj) { .key = 0x3 };
+    REQUIRE(pl_cache_get(cache, &obj));
+    REQUIRE_MEMEQ(obj.data, "xyzw", 4);
+    pl_cache_obj_free(&obj);
+    REQUIRE(pl_cache_journal_compact(cache));
+    pl_cache_journal_close(cache);
+    pl_cache_destroy(&cache);
+
+    cache = pl_cache_create(pl_cache_params( .log = log ));
+    REQUIRE(pl_cache_journal_open(cache, path));
+    REQUIRE_CMP(pl_cache_objects(cache), ==, 1, "d");
+    pl_cache_destroy(&cache);
+    remove(path);
+}
+
+enum { THREAD_OBJS = 1 << 12, NUM_THREADS = 8 };
+
+struct thread_ctx {
+    pl_cache cache;
+    uint64_t base;
+};
+
+static PL_THREAD_VOID lookup_thread(void *arg)
+{
+    struct thread_ctx *ctx = arg;
+    for (int n = 0; n < 16; n++) {
+        for (uint64_t i = 0; i < THREAD_OBJS; i++) {
+            pl_cache_obj obj = { .key = ctx->base + i };
+            if (!pl_cache_get(ctx->cache, &obj))
+                obj = (pl_cache_obj) { .key = ctx->base + i, .data = "abcd", .size = 4 };
+            pl_cache_set(ctx->cache, &obj);
+        }
+    }
+    PL_THREAD_RETURN();
+}
+
+// Concurrent access from multiple threads, with different numbers of shards
+static void bench_cache_threads(pl_log log, int num_shards)
+{
+    pl_cache cache = pl_cache_create(pl_cache_params(
+        .log        = log,
+        .num_shards = num_shards,
+    ));
+
+    pl_thread threads[NUM_THREADS];
+    struct thread_ctx ctx[NUM_THREADS];
+    pl_clock_t start = pl_clock_now();
+    for (int i = 0; i < NUM_THREADS; i++) {
+        ctx[i] = (struct thread_ctx) { cache, (uint64_t) i * THREAD_OBJS };
+        REQUIRE(pl_thread_create(&threads[i], lookup_thread, &ctx[i]) == 0);
+    }
+    for (int i = 0; i < NUM_THREADS; i++)
+        pl_thread_join(threads[i]);
+
+    printf("pl_cache with %d shard(s), %d threads: %.3f ms\n", num_shards,
+           NUM_THREADS, 1e3 * pl_clock_diff(pl_clock_now(), start));
+    REQUIRE_CMP(pl_cache_objects(cache), ==, NUM_THREADS * THREAD_OBJS, "d");
+    REQUIRE_CMP(pl_cache_size(cache), ==, NUM_THREADS * THREAD_OBJS * 4, "zu");
+
+    // Saving and loading must preserve all objects
+    size_t size = pl_cache_save(cache, NULL, 0);
+    uint8_t *data = malloc(size);
+    REQUIRE_CMP(pl_cache_save(cache, data, size), ==, size, "zu");
+    pl_cache_destroy(&cache);
+
+    cache = pl_cache_create(pl_cache_params( .log = log, .num_shards = 3 ));
+    REQUIRE_CMP(cache->params.num_shards, ==, 4, "d");
+    REQUIRE_CMP(pl_cache_load(cache, data, size), ==, NUM_THREADS * THREAD_OBJS, "d");
+    for (uint64_t i = 0; i < NUM_THREADS * THREAD_OBJS; i++) {
+        pl_cache_obj obj = { .key = i };
+        REQUIRE(pl_cache_get(cache, &obj));
+        REQUIRE_MEMEQ(obj.data, "abcd", 4);
+        pl_cache_obj_free(&obj);
+    }
+    free(data);
+    pl_cache_destroy(&cache);
+}
+
 int main()
 {
     pl_log log = pl_test_logger();
@@ -110,6 +275,20 @@ int main()
     REQUIRE_CMP(pl_cache_save(test2, data, sizeof(data)), ==, sizeof(ref), "zu");
     REQUIRE_MEMEQ(data, ref, sizeof(ref));
 
+    // Test zero-copy loading
+    pl_cache test3 = pl_cache_create(pl_cache_params( .log = log ));
+    REQUIRE_CMP(pl_cache_load_static(test3, data, sizeof(ref)), ==, 2, "d");
+    REQUIRE_CMP(pl_cache_size(test3), ==, 7, "zu");
+    pl_cache_obj sobj = { .key = 0x3 };
+    REQUIRE(pl_cache_get(test3, &sobj));
+    REQUIRE(sobj.data >= (void *) data && sobj.data < (void *) (data + sizeof(data)));
+    REQUIRE_MEMEQ(sobj.data, "xyzw", 4);
+    pl_cache_set(test3, &sobj);
+    REQUIRE_CMP(pl_cache_load_static(test3, ref, 5), <, 0, "d");
+    REQUIRE_CMP(pl_cache_load_static(test3, ref, 64), ==, 1, "d");
+    REQUIRE_CMP(pl_cache_load_mmap(test3, "/nonexistent/pl_cache"), <, 0, "d");
+    pl_cache_destroy(&test3);
+
     // Test loading invalid data
     REQUIRE_CMP(pl_cache_load(test2, ref, 0),   <, 0, "d"); // empty file
     REQUIRE_CMP(pl_cache_load(test2, ref, 5),   <, 0, "d"); // truncated header
@@ -118,6 +297,80 @@ int main()
     REQUIRE_CMP(pl_cache_load(test2, data, sizeof(ref)), ==, 1, "d"); // bad checksum
     pl_cache_destroy(&test2);
 
+    // With deferred verification, only the corrupt object itself is lost
+    pl_cache test4 = pl_cache_create(pl_cache_params(
+        .log         = log,
+        .lazy_verify = true,
+    ));
+    REQUIRE_CMP(pl_cache_load_static(test4, data, sizeof(ref)), ==, 2, "d");
+    sobj = (pl_cache_obj) { .key = 0x1 };
+    REQUIRE(!pl_cache_get(test4, &sobj));
+    REQUIRE_CMP(pl_cache_objects(test4), ==, 1, "d");
+    sobj = (pl_cache_obj) { .key = 0x3 };
+    REQUIRE(pl_cache_get(test4, &sobj));
+    REQUIRE_MEMEQ(sobj.data, "xyzw", 4);
+    pl_cache_obj_free(&sobj);
+    pl_cache_destroy(&test4);
+
+    // Large caches are verified in parallel, but still loaded in order
+    static uint8_t big[64][1 << 15];
+    pl_cache test5 = pl_cache_create(pl_cache_params( .log = log ));
+    for (int i = 0; i < PL_ARRAY_SIZE(big); i++) {
+        memset(big[i], i, sizeof(big[i]));
+        pl_cache_obj bobj = { .key = i + 1, .data = big[i], .size = sizeof(big[i]) };
+        REQUIRE(pl_cache_try_set(test5, &bobj));
+    }
+    size_t big_size = pl_cache_save(test5, NULL, 0);
+    uint8_t *big_data = malloc(big_size);
+    REQUIRE(big_data);
+    REQUIRE_CMP(pl_cache_save(test5, big_data, big_size), ==, big_size, "zu");
+    pl_cache_reset(test5);
+    REQUIRE_CMP(pl_cache_load(test5, big_data, big_size), ==, PL_ARRAY_SIZE(big), "d");
+    pl_cache_reset(test5);
+    big_data[big_size / 2] ^= 0xFF;
+    int num_big = pl_cache_load_static(test5, big_data, big_size);
+    REQUIRE(num_big > 0 && num_big < PL_ARRAY_SIZE(big));
+    pl_cache_reset(test5);
+
+#ifdef PL_HAVE_ZSTD
+    // Compressed caches round-trip, including through zero-copy loading
+    pl_cache test6 = pl_cache_create(pl_cache_params(
+        .log      = log,
+        .compress = true,
+    ));
+    for (int i = 0; i < PL_ARRAY_SIZE(big); i++) {
+        pl_cache_obj bobj = { .key = i + 1, .data = big[i], .size = sizeof(big[i]) };
+        REQUIRE(pl_cache_try_set(test6, &bobj));
+    }
+    pl_cache_obj tiny = { .key = 0x100, .data = "abc", .size = 3 }; // incompressible
+    REQUIRE(pl_cache_try_set(test6, &tiny));
+    size_t packed_size = pl_cache_save(test6, NULL, 0);
+    REQUIRE_CMP(packed_size * 10, <, big_size, "zu");
+    uint8_t *packed_data = malloc(packed_size);
+    REQUIRE(packed_data);
+    REQUIRE_CMP(pl_cache_save(test6, packed_data, packed_size), ==, packed_size, "zu");
+    pl_cache_destroy(&test6);
+
+    REQUIRE_CMP(pl_cache_load_static(test5, packed_data, packed_size), ==,
+                PL_ARRAY_SIZE(big) + 1, "d");
+    for (int i = 0; i < PL_ARRAY_SIZE(big); i++) {
+        pl_cache_obj bobj = { .key = i + 1 };
+        REQUIRE(pl_cache_get(test5, &bobj));
+        REQUIRE_CMP(bobj.size, ==, sizeof(big[i]), "zu");
+        REQUIRE_MEMEQ(bobj.data, big[i], sizeof(big[i]));
+        pl_cache_obj_free(&bobj);
+    }
+    tiny = (pl_cache_obj) { .key = 0x100 };
+    REQUIRE(pl_cache_get(test5, &tiny));
+    REQUIRE(tiny.data >= (void *) packed_data &&
+            tiny.data < (void *) (packed_data + packed_size));
+    pl_cache_obj_free(&tiny);
+    free(packed_data);
+#endif
+
+    pl_cache_destroy(&test5);
+    free(big_data);
+
     // Inserting too large object should fail
     uint8_t zero[32] = {0};
     pl_cache_obj obj4 = { .key = 0x4, .data = zero, .size = 32 };
@@ -200,6 +453,10 @@ int main()
     pl_cache_destroy(&test2);
 
     pl_cache_destroy(&test);
+    test_journal(log);
+    bench_cache(log);
+    bench_cache_threads(log, 1);
+    bench_cache_threads(log, 16);
     pl_log_destroy(&log);
     return 0;
 }
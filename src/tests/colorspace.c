@@ -1,5 +1,161 @@
 #include "tests.h"
 
+// Compares `pl_color_convert_cpu` against the closed-form curves. The odd
+// width exercises the scalar tail after the vector loop.
+static void cpu_convert_tests(void)
+{
+    const float PQ_M1 = 2610./4096 * 1./4,
+                PQ_M2 = 2523./4096 * 128,
+                PQ_C1 = 3424./4096,
+                PQ_C2 = 2413./4096 * 32,
+                PQ_C3 = 2392./4096 * 32;
+
+    enum { CW = 37, CH = 5 };
+    uint8_t yuv8[3][CH][CW];
+    uint16_t yuv16[3][CH][CW];
+    float rgbf[3][CH][CW], out[3][CH][CW];
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < CH; y++) {
+            for (int x = 0; x < CW; x++) {
+                int v = (c * 71 + y * 37 + x * 13) % 256;
+                yuv8[c][y][x]  = 16 + v * (c ? 224 : 219) / 255;
+                yuv16[c][y][x] = (64 + v * (c ? 896 : 876) / 255); // 10-bit
+                rgbf[c][y][x]  = v / 255.0f;
+            }
+        }
+    }
+
+    struct pl_color_cpu_params cpu = {
+        .src        = { yuv8[0], yuv8[1], yuv8[2] },
+        .src_stride = { CW, CW, CW },
+        .src_type   = PL_COLOR_CPU_U8,
+        .repr       = pl_color_repr_hdtv,
+        .color      = {
+            .primaries = PL_COLOR_PRIM_BT_709,
+            .transfer  = PL_COLOR_TRC_SRGB,
+        },
+        .dst        = { out[0][0], out[1][0], out[2][0] },
+        .dst_stride = { CW * sizeof(float), CW * sizeof(float), CW * sizeof(float) },
+        .width      = CW,
+        .height     = CH,
+    };
+
+    float csp_min, csp_max;
+    pl_color_space_nominal_luma_ex(pl_nominal_luma_params(
+        .color      = &cpu.color,
+        .metadata   = PL_HDR_METADATA_HDR10,
+        .scaling    = PL_HDR_NORM,
+        .out_min    = &csp_min,
+        .out_max    = &csp_max,
+    ));
+
+    REQUIRE(pl_color_convert_cpu(&cpu));
+    struct pl_color_repr repr = cpu.repr;
+    pl_transform3x3 dec = pl_color_repr_decode(&repr, NULL);
+    for (int y = 0; y < CH; y++) {
+        for (int x = 0; x < CW; x++) {
+            float v[3] = { yuv8[0][y][x] / 255.0f, yuv8[1][y][x] / 255.0f,
+                           yuv8[2][y][x] / 255.0f };
+            pl_transform3x3_apply(&dec, v);
+            for (int c = 0; c < 3; c++) {
+                float s = PL_CLAMP(v[c], 0.0f, 1.0f);
+                s = s > 0.04045f ? powf((s + 0.055f) / 1.055f, 2.4f) : s / 12.92f;
+                REQUIRE_FEQ(out[c][y][x], (csp_max - csp_min) * s + csp_min, 1e-4);
+            }
+        }
+    }
+
+    // 10-bit PQ in 16-bit words, converted to BT.709 primaries
+    cpu.src[0] = yuv16[0];
+    cpu.src[1] = yuv16[1];
+    cpu.src[2] = yuv16[2];
+    cpu.src_stride[0] = cpu.src_stride[1] = cpu.src_stride[2] = CW * sizeof(uint16_t);
+    cpu.src_type = PL_COLOR_CPU_U16;
+    cpu.repr = pl_color_repr_uhdtv;
+    cpu.repr.bits.color_depth = 10;
+    cpu.color = pl_color_space_hdr10;
+    cpu.dst_primaries = PL_COLOR_PRIM_BT_709;
+    REQUIRE(pl_color_convert_cpu(&cpu));
+
+    repr = cpu.repr;
+    repr.bits.sample_depth = 16;
+    dec = pl_color_repr_decode(&repr, NULL);
+    pl_matrix3x3 map = pl_get_color_mapping_matrix(pl_raw_primaries_get(PL_COLOR_PRIM_BT_2020),
+                                                   pl_raw_primaries_get(PL_COLOR_PRIM_BT_709),
+                                                   PL_INTENT_PERCEPTUAL);
+    for (int y = 0; y < CH; y++) {
+        for (int x = 0; x < CW; x++) {
+            float v[3] = { yuv16[0][y][x] / 65535.0f, yuv16[1][y][x] / 65535.0f,
+                           yuv16[2][y][x] / 65535.0f };
+            pl_transform3x3_apply(&dec, v);
+            for (int c = 0; c < 3; c++) {
+                float s = powf(PL_CLAMP(v[c], 0.0f, 1.0f), 1 / PQ_M2);
+                s = fmaxf(s - PQ_C1, 0.0f) / (PQ_C2 - PQ_C3 * s);
+                v[c] = 10000 / PL_COLOR_SDR_WHITE * powf(s, 1 / PQ_M1);
+            }
+            // The LUT error is relative to the peak, not the output value
+            const float mag = fmaxf(v[0], fmaxf(v[1], v[2]));
+            pl_matrix3x3_apply(&map, v);
+            for (int c = 0; c < 3; c++)
+                REQUIRE_FEQ(out[c][y][x], v[c], 1e-4 * fmaxf(mag, 1.0f));
+        }
+    }
+
+    // In-place float conversion, including the identity path
+    memcpy(out, rgbf, sizeof(out));
+    cpu = (struct pl_color_cpu_params) {
+        .src        = { out[0][0], out[1][0], out[2][0] },
+        .src_stride = { CW * sizeof(float), CW * sizeof(float), CW * sizeof(float) },
+        .src_type   = PL_COLOR_CPU_FLOAT,
+        .repr       = pl_color_repr_rgb,
+        .color      = { .transfer = PL_COLOR_TRC_LINEAR },
+        .dst        = { out[0][0], out[1][0], out[2][0] },
+        .dst_stride = { CW * sizeof(float), CW * sizeof(float), CW * sizeof(float) },
+        .width      = CW,
+        .height     = CH,
+    };
+    REQUIRE(pl_color_convert_cpu(&cpu));
+    for (int c = 0; c < 3; c++) {
+        for (int y = 0; y < CH; y++) {
+            for (int x = 0; x < CW; x++)
+                REQUIRE_FEQ(out[c][y][x], rgbf[c][y][x], 1e-6);
+        }
+    }
+
+    // HLG, which applies the OOTF per pixel
+    memcpy(out, rgbf, sizeof(out));
+    cpu.color = pl_color_space_bt2020_hlg;
+    REQUIRE(pl_color_convert_cpu(&cpu));
+    pl_color_space_nominal_luma_ex(pl_nominal_luma_params(
+        .color      = &cpu.color,
+        .metadata   = PL_HDR_METADATA_HDR10,
+        .scaling    = PL_HDR_NORM,
+        .out_min    = &csp_min,
+        .out_max    = &csp_max,
+    ));
+
+    const float hlg_y = fmaxf(1.2f + 0.42f * log10f(csp_max * PL_COLOR_SDR_WHITE / 1000), 1);
+    const float hlg_b = sqrtf(3 * powf(csp_min / csp_max, 1 / hlg_y));
+    pl_matrix3x3 rgb2xyz = pl_get_rgb2xyz_matrix(pl_raw_primaries_get(PL_COLOR_PRIM_BT_2020));
+    for (int y = 0; y < CH; y++) {
+        for (int x = 0; x < CW; x++) {
+            float v[3], luma = 0.0f;
+            for (int c = 0; c < 3; c++) {
+                float s = (1 - hlg_b) * rgbf[c][y][x] + hlg_b;
+                s = s > 0.5f ? expf((s - 0.55991073f) / 0.17883277f) + 0.28466892f
+                             : 4 * s * s;
+                v[c] = s / 12;
+                luma += rgb2xyz.m[1][c] * v[c];
+            }
+            for (int c = 0; c < 3; c++)
+                REQUIRE_FEQ(out[c][y][x], v[c] * csp_max * powf(luma, hlg_y - 1), 1e-3);
+        }
+    }
+
+    cpu.repr.sys = PL_COLOR_SYSTEM_XYZ;
+    REQUIRE(!pl_color_convert_cpu(&cpu));
+}
+
 int main()
 {
     for (enum pl_color_system sys = 0; sys < PL_COLOR_SYSTEM_COUNT; sys++) {
@@ -485,4 +641,6 @@ int main()
     TEST_METADATA(bogus_vals, PL_HDR_METADATA_HDR10, PL_COLOR_HDR_BLACK, 10000, 0);
     TEST_METADATA(bogus_flip, PL_HDR_METADATA_HDR10, PL_COLOR_HDR_BLACK, 10000, 0);
     TEST_METADATA(bogus_sign, PL_HDR_METADATA_HDR10, PL_COLOR_HDR_BLACK, PL_COLOR_HLG_PEAK, 0);
+
+    cpu_convert_tests();
 }
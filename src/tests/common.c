@@ -1,16 +1,66 @@
 #include "tests.h"
+#include "log.h"
+#include "pl_memcpy.h"
+#include "pl_thread_pool.h"
 
 static int irand()
 {
     return rand() - RAND_MAX / 2;
 }
 
+static void count_cb(void *priv, int i)
+{
+    atomic_int *counts = priv;
+    atomic_fetch_add(&counts[i], 1);
+}
+
+static void nested_cb(void *priv, int i)
+{
+    atomic_int *counts = priv;
+    pl_parallel_for(8, count_cb, &counts[8 * i]);
+}
+
+struct log_count {
+    int num;
+    int num_warn;
+    size_t maxlen;
+};
+
+static void log_count_cb(void *priv, enum pl_log_level level, const char *msg)
+{
+    struct log_count *c = priv;
+    c->num++;
+    c->num_warn += level == PL_LOG_WARN;
+    c->maxlen = PL_MAX(c->maxlen, strlen(msg));
+}
+
 int main()
 {
     pl_log log = pl_test_logger();
     pl_log_update(log, NULL);
     pl_log_destroy(&log);
 
+    // Test asynchronous logging
+    struct log_count count = {0};
+    log = pl_log_create(PL_API_VER, pl_log_params(
+        .log_cb     = log_count_cb,
+        .log_priv   = &count,
+        .log_level  = PL_LOG_TRACE,
+        .async      = true,
+    ));
+    for (int i = 0; i < 100; i++)
+        pl_trace(log, "trace message %d", i);
+    pl_trace(log, "%01000d", 0);
+    pl_warn(log, "warning"); // waits for delivery
+    REQUIRE_CMP(count.num, ==, 103, "d");
+    REQUIRE_CMP(count.num_warn, ==, 1, "d");
+    REQUIRE_CMP(count.maxlen, ==, 1000, "zu");
+    for (int i = 0; i < 100; i++)
+        pl_trace(log, "trace message %d", i);
+    pl_log_update(log, NULL); // flushes the queue
+    REQUIRE_CMP(count.num, ==, 203, "d");
+    pl_log_destroy(&log);
+
     // Test some misc helper functions
     pl_rect2d rc2 = {
         irand(), irand(),
@@ -133,4 +183,96 @@ int main()
     REQUIRE_FEQ(rc.x1, -50, 1e-6);
     REQUIRE_FEQ(rc.y0, 980, 1e-6);
     REQUIRE_FEQ(rc.y1, -100, 1e-6);
+
+    // Thread pool, including nested invocations
+    static atomic_int counts[8 * 64];
+    pl_parallel_for(PL_ARRAY_SIZE(counts), count_cb, counts);
+    pl_parallel_for(64, nested_cb, counts);
+    pl_parallel_for(0, count_cb, counts);
+    for (int i = 0; i < PL_ARRAY_SIZE(counts); i++)
+        REQUIRE_CMP(atomic_load(&counts[i]), ==, 2, "d");
+
+    // Releasing the last reference stops all workers, after which the pool
+    // can be used (and torn down) again
+    for (int round = 0; round < 2; round++) {
+        pl_thread_pool_ref();
+        pl_parallel_for(64, nested_cb, counts);
+        pl_thread_pool_unref();
+    }
+    for (int i = 0; i < PL_ARRAY_SIZE(counts); i++)
+        REQUIRE_CMP(atomic_load(&counts[i]), ==, 4, "d");
+
+    // Streaming copies, at all alignments and around the size thresholds
+    static uint8_t src[4096 + 64], dst[4096 + 64], ref[4096 + 64];
+    for (int i = 0; i < sizeof(src); i++)
+        src[i] = i * 13 + 7;
+    static const size_t sizes[] = { 0, 1, 15, 63, 255, 256, 257, 1000, 4096 };
+    for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+        for (int off = 0; off < 32; off += 3) {
+            memset(dst, 0xAA, sizeof(dst));
+            memset(ref, 0xAA, sizeof(ref));
+            memcpy(ref + off, src + 31 - off, sizes[i]);
+            pl_memcpy_stream(dst + off, src + 31 - off, sizes[i]);
+            REQUIRE_MEMEQ(dst, ref, sizeof(dst));
+        }
+    }
+
+    // Byte-swapping copies, with partial trailing words left as-is
+    for (int wordsize = 1; wordsize <= 4; wordsize *= 2) {
+        for (int i = 0; i < PL_ARRAY_SIZE(sizes); i++) {
+            for (int off = 0; off < 8; off += 3) {
+                const size_t size = sizes[i];
+                memset(dst, 0xAA, sizeof(dst));
+                memset(ref, 0xAA, sizeof(ref));
+                memcpy(ref + off, src + 3, size);
+                for (size_t w = 0; w + wordsize <= size; w += wordsize) {
+                    for (int b = 0; b < wordsize; b++)
+                        ref[off + w + b] = src[3 + w + wordsize - 1 - b];
+                }
+                pl_memcpy_swap(dst + off, src + 3, size, wordsize);
+                REQUIRE_MEMEQ(dst, ref, sizeof(dst));
+            }
+        }
+    }
+
+    // Strided copies never touch the bytes between rows
+    static const size_t row_sizes[] = { 4, 12, 16, 100, 300 };
+    for (int i = 0; i < PL_ARRAY_SIZE(row_sizes); i++) {
+        for (int stream = 0; stream < 2; stream++) {
+            const size_t row = row_sizes[i], rows = 8;
+            const size_t src_pitch = row + 5, dst_pitch = row + 19;
+            memset(dst, 0xAA, sizeof(dst));
+            memset(ref, 0xAA, sizeof(ref));
+            for (int y = 0; y < rows; y++)
+                memcpy(ref + 1 + y * dst_pitch, src + y * src_pitch, row);
+            pl_memcpy_2d(dst + 1, dst_pitch, src, src_pitch, row, rows, stream);
+            REQUIRE_MEMEQ(dst, ref, sizeof(dst));
+        }
+    }
+
+    // Arena allocations survive growth, and are recycled after a reset
+    void *tmp = pl_tmp(NULL);
+    pl_arena arena = pl_arena_init(tmp), other = pl_arena_init(tmp);
+    uint32_t *first = pl_arena_memdup(&arena, &(uint32_t) {0xdeadbeef}, 4, 4);
+    for (int i = 0; i < 1000; i++) {
+        uint64_t *ptr = pl_arena_zalloc(&arena, sizeof(*ptr), alignof(uint64_t));
+        REQUIRE(((uintptr_t) ptr & (alignof(uint64_t) - 1)) == 0);
+        REQUIRE_CMP(*ptr, ==, 0, PRIu64);
+        *ptr = ~0ULL;
+    }
+    REQUIRE_CMP(*first, ==, 0xdeadbeef, "x");
+    const char *str = pl_arena_asprintf(&other, "%d", 1234);
+    pl_arena_steal(&arena, &other);
+    REQUIRE_STREQ(str, "1234");
+
+    // Once grown to the steady-state size, no more allocations happen
+    uint8_t *buf = NULL;
+    for (int round = 0; round < 3; round++) {
+        buf = arena.buf;
+        pl_arena_reset(&arena);
+        for (int i = 0; i < 1000; i++)
+            pl_arena_alloc(&arena, sizeof(uint64_t), alignof(uint64_t));
+    }
+    REQUIRE(arena.buf == buf);
+    pl_free(tmp);
 }
@@ -2,12 +2,701 @@
 
 #include <libplacebo/dummy.h>
 
+static void fill_const(void *data, const struct sh_lut_params *params)
+{
+    const uint32_t *val = params->priv;
+    uint32_t *out = data;
+    for (int i = 0; i < params->width; i++)
+        out[i] = *val;
+}
+
+// Returns the LUT texture bound by `sh`
+static pl_tex lut_tex(pl_shader sh)
+{
+    const struct pl_shader_res *res = pl_shader_finalize(sh);
+    REQUIRE(res);
+    REQUIRE_CMP(res->num_descriptors, ==, 1, "d");
+    return res->descriptors[0].binding.object;
+}
+
+// Returns the first entry of the LUT texture bound by `sh`
+static uint32_t lut_value(pl_shader sh)
+{
+    const uint32_t *data = (uint32_t *) pl_tex_dummy_data(lut_tex(sh));
+    REQUIRE(data);
+    return data[0];
+}
+
+static void async_lut_tests(pl_log log, pl_gpu gpu)
+{
+    pl_shader sh = pl_shader_alloc(log, pl_shader_params( .gpu = gpu ));
+    pl_shader_obj obj = NULL;
+    uint32_t val = 1;
+
+#define ASYNC_LUT(sig)                      \
+    sh_lut(sh, sh_lut_params(               \
+        .object     = &obj,                 \
+        .var_type   = PL_VAR_UINT,          \
+        .lut_type   = SH_LUT_TEXTURE,       \
+        .width      = 64,                   \
+        .comps      = 1,                    \
+        .signature  = (sig),                \
+        .fill       = fill_const,           \
+        .priv       = &val,                 \
+        .priv_size  = sizeof(val),          \
+        .async      = true,                 \
+    ))
+
+    // The first LUT has nothing to fall back to, so must be generated
+    // synchronously
+    REQUIRE(ASYNC_LUT(1));
+    REQUIRE_CMP(lut_value(sh), ==, 1, "u");
+
+    // Subsequent LUTs keep using the previous contents until ready
+    val = 2;
+    pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+    REQUIRE(ASYNC_LUT(2));
+    val = 3; // must not affect the pending job
+    uint32_t cur = lut_value(sh);
+    REQUIRE(cur == 1 || cur == 2);
+    for (int i = 0; cur != 2 && i < 1000; i++) {
+        pl_thread_sleep(1e-3);
+        pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+        REQUIRE(ASYNC_LUT(2));
+        cur = lut_value(sh);
+    }
+    REQUIRE_CMP(cur, ==, 2, "u");
+
+    // Destroying the object with a job in flight must be safe
+    pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+    REQUIRE(ASYNC_LUT(3));
+#undef ASYNC_LUT
+
+    pl_shader_obj_destroy(&obj);
+    pl_shader_free(&sh);
+}
+
+static void shared_lut_tests(pl_log log, pl_gpu gpu)
+{
+    pl_shader sh[2];
+    pl_shader_obj obj[3] = {0};
+    uint32_t val = 1;
+    pl_tex tex[3];
+
+#define SHARED_LUT(i, sig, dyn)             \
+    sh_lut(sh[i], sh_lut_params(            \
+        .object     = &obj[i],              \
+        .var_type   = PL_VAR_UINT,          \
+        .lut_type   = SH_LUT_TEXTURE,       \
+        .width      = 64,                   \
+        .comps      = 1,                    \
+        .signature  = (sig),                \
+        .dynamic    = (dyn),                \
+        .fill       = fill_const,           \
+        .priv       = &val,                 \
+    ))
+
+    // Identical static LUTs share the same texture
+    for (int i = 0; i < 2; i++) {
+        sh[i] = pl_shader_alloc(log, pl_shader_params( .gpu = gpu ));
+        REQUIRE(SHARED_LUT(i, 5, false));
+        tex[i] = lut_tex(sh[i]);
+    }
+    REQUIRE(tex[0] == tex[1]);
+
+    // The texture outlives its first user
+    pl_shader_obj_destroy(&obj[0]);
+    pl_shader_reset(sh[1], pl_shader_params( .gpu = gpu ));
+    REQUIRE(SHARED_LUT(1, 5, false));
+    REQUIRE(lut_tex(sh[1]) == tex[0]);
+    REQUIRE_CMP(lut_value(sh[1]), ==, 1, "u");
+
+    // Different contents get their own texture
+    val = 2;
+    pl_shader_reset(sh[1], pl_shader_params( .gpu = gpu ));
+    REQUIRE(SHARED_LUT(1, 6, false));
+    REQUIRE_CMP(lut_value(sh[1]), ==, 2, "u");
+
+    // Dynamic LUTs are never shared
+    pl_shader_reset(sh[0], pl_shader_params( .gpu = gpu ));
+    REQUIRE(SHARED_LUT(0, 6, true));
+    tex[2] = lut_tex(sh[0]);
+    pl_shader_reset(sh[1], pl_shader_params( .gpu = gpu ));
+    REQUIRE(SHARED_LUT(1, 6, false));
+    REQUIRE(lut_tex(sh[1]) != tex[2]);
+#undef SHARED_LUT
+
+    for (int i = 0; i < PL_ARRAY_SIZE(obj); i++)
+        pl_shader_obj_destroy(&obj[i]);
+    for (int i = 0; i < 2; i++)
+        pl_shader_free(&sh[i]);
+}
+
+static pl_tex dither_tex(pl_shader sh, pl_shader_obj *state, bool temporal)
+{
+    REQUIRE(sh_require(sh, PL_SHADER_SIG_COLOR, 0, 0));
+    pl_shader_dither(sh, 8, state, pl_dither_params(
+        .lut_size = 4,
+        .temporal = temporal,
+    ));
+    return lut_tex(sh);
+}
+
+static void dither_tests(pl_log log, pl_gpu gpu)
+{
+    pl_shader sh = pl_shader_alloc(log, pl_shader_params( .gpu = gpu ));
+    pl_shader_obj state = NULL;
+    pl_tex tex2d = dither_tex(sh, &state, false);
+    REQUIRE_CMP(pl_tex_params_dimension(tex2d->params), ==, 2, "d");
+
+    // Temporal blue noise uses a separate, precomputed 3D texture, which is
+    // shared between frames
+    pl_shader_reset(sh, pl_shader_params( .gpu = gpu, .index = 0 ));
+    pl_tex tex3d = dither_tex(sh, &state, true);
+    REQUIRE_CMP(tex3d->params.w, ==, 16, "d");
+    REQUIRE_CMP(tex3d->params.d, ==, 16, "d");
+    pl_shader_reset(sh, pl_shader_params( .gpu = gpu, .index = 5 ));
+    REQUIRE(dither_tex(sh, &state, true) == tex3d);
+
+    // Every layer is the same matrix with a constant (cyclic) threshold offset
+    const float *data = (float *) pl_tex_dummy_data(tex3d);
+    REQUIRE(data);
+    for (int t = 1; t < 16; t++) {
+        const float *layer = &data[t * 16 * 16];
+        const float offset = fmodf(layer[0] - data[0] + 1.0f, 1.0f);
+        REQUIRE(offset > 0.0f);
+        for (int i = 0; i < 16 * 16; i++) {
+            REQUIRE(layer[i] >= 0.0f && layer[i] < 1.0f);
+            REQUIRE_FEQ(fmodf(data[i] + offset, 1.0f), layer[i], 1e-5);
+        }
+    }
+
+    pl_shader_obj_destroy(&state);
+    pl_shader_free(&sh);
+}
+
+static void count_cb(void *priv)
+{
+    int *count = priv;
+    (*count)++;
+}
+
+static void chunked_upload_tests(pl_gpu gpu)
+{
+    pl_fmt fmt = pl_find_named_fmt(gpu, "rgba16");
+    REQUIRE(fmt);
+
+    // Large enough to be staged in multiple bands, with padded rows
+    const int w = 4096, h = 700;
+    const size_t row_size = w * fmt->texel_size;
+    const size_t row_pitch = row_size + 256;
+    pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+        .w = w,
+        .h = h,
+        .format = fmt,
+        .host_writable = true,
+    ));
+    REQUIRE(tex);
+
+    uint8_t *data = malloc(h * row_pitch);
+    REQUIRE(data);
+    for (size_t i = 0; i < h * row_pitch; i++)
+        data[i] = i * 7 + (i >> 12);
+
+    int count = 0;
+    REQUIRE(pl_tex_upload_pbo(gpu, &(struct pl_tex_transfer_params) {
+        .tex = tex,
+        .rc = { .x1 = w, .y0 = 3, .y1 = h, .z1 = 1 },
+        .row_pitch = row_pitch,
+        .ptr = data,
+        .callback = count_cb,
+        .priv = &count,
+    }));
+    REQUIRE_CMP(count, ==, 1, "d");
+
+    const uint8_t *tex_data = pl_tex_dummy_data(tex);
+    for (int y = 3; y < h; y++) {
+        REQUIRE_MEMEQ(&tex_data[y * row_size], &data[(y - 3) * row_pitch],
+                      row_size);
+    }
+
+    free(data);
+    pl_tex_destroy(gpu, &tex);
+}
+
+static void swapped_upload_tests(pl_gpu gpu)
+{
+    // Host data is swapped while staging, without requiring compute shaders
+    static uint16_t src[64 * 16];
+    for (int i = 0; i < PL_ARRAY_SIZE(src); i++)
+        src[i] = i * 0x0103u;
+
+    int count = 0;
+    pl_tex tex = NULL;
+    struct pl_plane plane;
+    REQUIRE(pl_upload_plane(gpu, &plane, &tex, &(struct pl_plane_data) {
+        .type           = PL_FMT_UNORM,
+        .width          = 64,
+        .height         = 16,
+        .component_size = {16},
+        .component_map  = {0},
+        .pixel_stride   = sizeof(uint16_t),
+        .swapped        = true,
+        .pixels         = src,
+        .callback       = count_cb,
+        .priv           = &count,
+    }));
+    REQUIRE_CMP(count, ==, 1, "d");
+
+    const uint16_t *tex_data = (uint16_t *) pl_tex_dummy_data(tex);
+    for (int i = 0; i < PL_ARRAY_SIZE(src); i++)
+        REQUIRE_CMP(tex_data[i], ==, (uint16_t) ((src[i] << 8) | (src[i] >> 8)), "u");
+
+    pl_tex_destroy(gpu, &tex);
+}
+
+static void multi_upload_tests(pl_gpu gpu)
+{
+    // Y plane with padded rows, plus two subsampled chroma planes
+    static uint8_t luma[32 * 40], chroma[2][16 * 8];
+    for (int i = 0; i < PL_ARRAY_SIZE(luma); i++)
+        luma[i] = i * 7;
+    for (int i = 0; i < PL_ARRAY_SIZE(chroma[0]); i++) {
+        chroma[0][i] = i * 3;
+        chroma[1][i] = 255 - i;
+    }
+
+    int count = 0;
+    struct pl_plane_data data[3];
+    for (int p = 0; p < 3; p++) {
+        data[p] = (struct pl_plane_data) {
+            .type           = PL_FMT_UNORM,
+            .width          = p ? 16 : 30,
+            .height         = p ? 8 : 16,
+            .row_stride     = p ? 0 : 40,
+            .component_size = {8},
+            .component_map  = {p},
+            .pixel_stride   = 1,
+            .pixels         = p ? chroma[p - 1] : luma,
+            .callback       = count_cb,
+            .priv           = &count,
+        };
+    }
+
+    pl_tex tex[3] = {0};
+    struct pl_plane planes[3];
+    REQUIRE(pl_upload_planes(gpu, planes, tex, data, 3));
+    REQUIRE_CMP(count, ==, 3, "d");
+
+    for (int p = 0; p < 3; p++) {
+        REQUIRE(planes[p].texture == tex[p]);
+        REQUIRE_CMP(planes[p].component_mapping[0], ==, p, "d");
+        const uint8_t *tex_data = pl_tex_dummy_data(tex[p]);
+        const uint8_t *src = data[p].pixels;
+        const size_t stride = PL_DEF(data[p].row_stride, (size_t) data[p].width);
+        for (int y = 0; y < data[p].height; y++) {
+            for (int x = 0; x < data[p].width; x++) {
+                REQUIRE_CMP(tex_data[y * data[p].width + x], ==,
+                            src[y * stride + x], "u");
+            }
+        }
+        pl_tex_destroy(gpu, &tex[p]);
+    }
+}
+
+static void ring_tests(pl_gpu gpu)
+{
+    struct pl_gpu_ring_alloc a, b;
+    REQUIRE(pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, 100, 16, &a));
+    REQUIRE(pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, 100, 48, &b));
+    REQUIRE(a.buf == b.buf);
+    REQUIRE(a.buf->params.host_mapped && a.buf->params.drawable);
+    REQUIRE(b.offset == PL_ALIGN(b.offset, 48));
+    REQUIRE_CMP(b.offset, >=, a.offset + 100, "zu");
+    REQUIRE(a.data == a.buf->data + a.offset);
+    pl_gpu_ring_done(gpu, &a);
+    pl_gpu_ring_done(gpu, &b);
+    REQUIRE(!a.buf && !b.buf);
+
+    // Oversized requests are rejected, so callers fall back
+    REQUIRE(!pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, SIZE_MAX, 16, &a));
+
+    // Idle slabs are recycled rather than growing the ring
+    pl_buf first = NULL;
+    for (int i = 0; i < 64; i++) {
+        REQUIRE(pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, 1 << 20, 16, &a));
+        if (!first)
+            first = a.buf;
+        pl_gpu_ring_done(gpu, &a);
+    }
+    REQUIRE(pl_gpu_ring_alloc(gpu, PL_GPU_RING_DOWNLOAD, 4, 4, &a));
+    REQUIRE(a.buf->params.host_readable);
+    pl_gpu_ring_done(gpu, &a);
+
+    const struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    REQUIRE_CMP(impl->rings[PL_GPU_RING_UPLOAD].num_slabs, ==, 1, "d");
+    REQUIRE(impl->rings[PL_GPU_RING_UPLOAD].slabs[0].buf == first);
+
+    // Transfers round-trip through the rings
+    pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+        .w = 64,
+        .h = 64,
+        .format = pl_find_named_fmt(gpu, "rgba8"),
+        .host_writable = true,
+        .host_readable = true,
+    ));
+    REQUIRE(tex);
+
+    static uint32_t src[64 * 64], dst[64 * 64];
+    for (int i = 0; i < PL_ARRAY_SIZE(src); i++)
+        src[i] = i * 0x01020304u;
+    REQUIRE(pl_tex_upload_pbo(gpu, &(struct pl_tex_transfer_params) {
+        .tex = tex,
+        .rc = { .x1 = 64, .y1 = 64, .z1 = 1 },
+        .row_pitch = 64 * sizeof(uint32_t),
+        .ptr = src,
+    }));
+    REQUIRE(pl_tex_download_pbo(gpu, &(struct pl_tex_transfer_params) {
+        .tex = tex,
+        .rc = { .x1 = 64, .y1 = 64, .z1 = 1 },
+        .row_pitch = 64 * sizeof(uint32_t),
+        .ptr = dst,
+    }));
+    REQUIRE_MEMEQ(src, dst, sizeof(src));
+    REQUIRE_CMP(impl->rings[PL_GPU_RING_UPLOAD].num_slabs, ==, 1, "d");
+    REQUIRE_CMP(impl->rings[PL_GPU_RING_DOWNLOAD].num_slabs, ==, 1, "d");
+    pl_tex_destroy(gpu, &tex);
+}
+
+static pl_tex blit_tex(pl_gpu gpu, const char *fmt, int w, int h)
+{
+    pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+        .w = w,
+        .h = h,
+        .format = pl_find_named_fmt(gpu, fmt),
+        .blit_src = true,
+        .blit_dst = true,
+    ));
+    REQUIRE(tex);
+    return tex;
+}
+
+static void blit_tests(pl_gpu gpu)
+{
+    // Clears are encoded according to the format
+    pl_tex a = blit_tex(gpu, "rgba8", 2, 2);
+    pl_tex_clear(gpu, a, (float[]) { 1.0, 0.5, 0.0, 1.0 });
+    const uint8_t *px = pl_tex_dummy_data(a);
+    REQUIRE_CMP(px[0], ==, 0xFF, "u");
+    REQUIRE_CMP(px[1], ==, 0x80, "u");
+    REQUIRE_CMP(px[2], ==, 0x00, "u");
+    REQUIRE_CMP(px[15], ==, 0xFF, "u");
+    pl_tex_destroy(gpu, &a);
+
+    // Flipped blits copy texels in reverse order
+    a = blit_tex(gpu, "r8", 4, 1);
+    pl_tex b = blit_tex(gpu, "r8", 4, 1);
+    memcpy(pl_tex_dummy_data(a), (uint8_t[]) { 1, 2, 3, 4 }, 4);
+    pl_tex_clear(gpu, b, (float[4]) {0});
+    pl_tex_blit(gpu, pl_tex_blit_params(
+        .src = a,
+        .dst = b,
+        .src_rc = { .x0 = 0, .x1 = 2, .y1 = 1, .z1 = 1 },
+        .dst_rc = { .x0 = 3, .x1 = 1, .y1 = 1, .z1 = 1 },
+    ));
+    REQUIRE_MEMEQ(pl_tex_dummy_data(b), ((uint8_t[]) { 0, 2, 1, 0 }), 4);
+    pl_tex_destroy(gpu, &a);
+    pl_tex_destroy(gpu, &b);
+
+    // Linear upscaling clamps to the edges of the source rect
+    a = blit_tex(gpu, "r32f", 2, 1);
+    b = blit_tex(gpu, "r32f", 4, 1);
+    memcpy(pl_tex_dummy_data(a), (float[]) { 0.0, 1.0 }, 2 * sizeof(float));
+    pl_tex_blit(gpu, pl_tex_blit_params(
+        .src = a,
+        .dst = b,
+        .sample_mode = PL_TEX_SAMPLE_LINEAR,
+    ));
+    const float *f = (float *) pl_tex_dummy_data(b);
+    REQUIRE_FEQ(f[0], 0.00, 1e-6);
+    REQUIRE_FEQ(f[1], 0.25, 1e-6);
+    REQUIRE_FEQ(f[2], 0.75, 1e-6);
+    REQUIRE_FEQ(f[3], 1.00, 1e-6);
+    pl_tex_destroy(gpu, &a);
+    pl_tex_destroy(gpu, &b);
+
+    // Blits convert between formats of the same size
+    a = blit_tex(gpu, "r16", 2, 1);
+    b = blit_tex(gpu, "r16hf", 2, 1);
+    memcpy(pl_tex_dummy_data(a), (uint16_t[]) { 0xFFFF, 0x8000 }, 4);
+    pl_tex_blit(gpu, pl_tex_blit_params( .src = a, .dst = b ));
+    const uint16_t *h = (uint16_t *) pl_tex_dummy_data(b);
+    REQUIRE_CMP(h[0], ==, 0x3C00, "x"); // 1.0
+    REQUIRE_CMP(h[1], ==, 0x3800, "x"); // 0.5, rounded
+    pl_tex_destroy(gpu, &a);
+    pl_tex_destroy(gpu, &b);
+
+    // Batched blits behave like the equivalent sequence of blits, including
+    // when later blits overwrite the results of earlier ones
+    a = blit_tex(gpu, "r8", 4, 1);
+    b = blit_tex(gpu, "r8", 4, 1);
+    memcpy(pl_tex_dummy_data(a), (uint8_t[]) { 1, 2, 3, 4 }, 4);
+    pl_tex_clear(gpu, b, (float[4]) {0});
+    pl_tex_blit_batch(gpu, (struct pl_tex_blit_params[]) {
+        { .src = a, .dst = b, .src_rc = {0, 0, 0, 1, 1, 1}, .dst_rc = {3, 0, 0, 4, 1, 1} },
+        { .src = a, .dst = b, .src_rc = {1, 0, 0, 2, 1, 1}, .dst_rc = {2, 0, 0, 3, 1, 1} },
+        { .src = a, .dst = b, .src_rc = {2, 0, 0, 3, 1, 1}, .dst_rc = {1, 0, 0, 2, 1, 1} },
+        { .src = a, .dst = b, .src_rc = {3, 0, 0, 4, 1, 1}, .dst_rc = {2, 0, 0, 3, 1, 1} },
+    }, 4);
+    REQUIRE_MEMEQ(pl_tex_dummy_data(b), ((uint8_t[]) { 0, 3, 4, 1 }), 4);
+    pl_tex_destroy(gpu, &a);
+    pl_tex_destroy(gpu, &b);
+
+    // Large downscales are split into parallel jobs
+    a = blit_tex(gpu, "r8", 1024, 1024);
+    b = blit_tex(gpu, "r8", 512, 512);
+    uint8_t *src = pl_tex_dummy_data(a);
+    for (int i = 0; i < 1024 * 1024; i++)
+        src[i] = (i ^ (i >> 10)) & 0xFF;
+    pl_tex_blit(gpu, pl_tex_blit_params( .src = a, .dst = b ));
+    const uint8_t *dst = pl_tex_dummy_data(b);
+    for (int y = 0; y < 512; y++) {
+        for (int x = 0; x < 512; x++)
+            REQUIRE_CMP(dst[y * 512 + x], ==, src[(2 * y + 1) * 1024 + 2 * x + 1], "u");
+    }
+    pl_tex_destroy(gpu, &a);
+    pl_tex_destroy(gpu, &b);
+}
+
+// Hashes everything about a shader that would require recompilation
+static uint64_t shader_sig(pl_shader sh)
+{
+    const struct pl_shader_res *res = pl_shader_finalize(sh);
+    REQUIRE(res);
+    uint64_t sig = pl_str0_hash(res->glsl);
+    for (int i = 0; i < res->num_constants; i++) {
+        const struct pl_shader_const *sc = &res->constants[i];
+        pl_hash_merge(&sig, pl_mem_hash(sc->data, pl_var_type_size(sc->type)));
+    }
+    return sig;
+}
+
+// Generates scalers for slightly different output sizes, as happens while
+// interactively resizing a window, and makes sure the shaders stay the same
+static void resize_tests(pl_log log, pl_gpu gpu)
+{
+    pl_tex tex = pl_tex_dummy_create(gpu, pl_tex_dummy_params(
+        .w = 100,
+        .h = 100,
+        .format = pl_find_named_fmt(gpu, "rgba8"),
+    ));
+
+    static const struct {
+        bool ortho, no_compute;
+        int sizes[2];
+    } tests[] = {
+        { .sizes = {150, 160} },
+        { .sizes = {60, 61} },
+        { .sizes = {60, 61}, .no_compute = true },
+        { .sizes = {200, 300}, .ortho = true },
+        { .sizes = {150, 160}, .ortho = true },
+    };
+
+    pl_shader sh = pl_shader_alloc(log, pl_shader_params( .gpu = gpu ));
+    for (int i = 0; i < PL_ARRAY_SIZE(tests); i++) {
+        pl_shader_obj lut = NULL;
+        struct pl_sample_filter_params params = {
+            .filter     = tests[i].ortho ? pl_filter_lanczos : pl_filter_ewa_lanczos,
+            .no_compute = tests[i].no_compute,
+            .lut        = &lut,
+        };
+
+        uint64_t sig[2];
+        for (int n = 0; n < 2; n++) {
+            struct pl_sample_src src = {
+                .tex   = tex,
+                .new_w = tests[i].sizes[n],
+                .new_h = tests[i].sizes[n],
+            };
+
+            pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+            if (tests[i].ortho) {
+                REQUIRE(pl_shader_sample_ortho2(sh, &src, &params));
+            } else {
+                REQUIRE(pl_shader_sample_polar(sh, &src, &params));
+            }
+            REQUIRE_CMP(pl_shader_is_compute(sh), ==, !tests[i].no_compute, "d");
+            sig[n] = shader_sig(sh);
+        }
+
+        REQUIRE_CMP(sig[0], ==, sig[1], PRIu64);
+        pl_shader_obj_destroy(&lut);
+    }
+
+    pl_shader_free(&sh);
+    pl_tex_destroy(gpu, &tex);
+}
+
+static void format_tests(pl_gpu gpu)
+{
+    pl_fmt rgba8 = pl_find_named_fmt(gpu, "rgba8");
+    REQUIRE(rgba8);
+    REQUIRE_CMP(pl_find_fmt(gpu, PL_FMT_UNORM, 4, 8, 8, PL_FMT_CAP_SAMPLEABLE),
+                ==, rgba8, "p");
+    REQUIRE(!pl_find_fmt(gpu, PL_FMT_UNKNOWN, 4, 8, 8, 0));
+    REQUIRE(!pl_find_fmt(gpu, PL_FMT_UNORM, 5, 8, 8, 0));
+
+    // Every format must be found by its own properties
+    for (int n = 0; n < gpu->num_formats; n++) {
+        pl_fmt fmt = gpu->formats[n];
+        pl_fmt found = pl_find_fmt(gpu, fmt->type, fmt->num_components,
+                                   fmt->component_depth[0], 0, fmt->caps);
+        REQUIRE(found);
+        REQUIRE_CMP(found->type, ==, fmt->type, "d");
+        REQUIRE_CMP(found->num_components, ==, fmt->num_components, "d");
+        REQUIRE_CMP(found->caps & fmt->caps, ==, fmt->caps, "u");
+    }
+
+    // Repeated lookups of the same plane shape must give the same result
+    struct pl_plane_data data = {
+        .type           = PL_FMT_UNORM,
+        .width          = 16,
+        .height         = 16,
+        .pixel_stride   = 4,
+        .component_size = {8, 8, 8, 8},
+        .component_map  = {2, 1, 0, 3},
+    };
+
+    int map[4], map2[4];
+    pl_fmt fmt = pl_plane_find_fmt(gpu, map, &data);
+    REQUIRE_CMP(fmt, ==, rgba8, "p");
+    REQUIRE_CMP(map[0], ==, 2, "d");
+    REQUIRE_CMP(map[2], ==, 0, "d");
+    for (int i = 0; i < 3; i++) {
+        REQUIRE_CMP(pl_plane_find_fmt(gpu, map2, &data), ==, fmt, "p");
+        REQUIRE_MEMEQ(map, map2, sizeof(map));
+    }
+
+    data.component_map[0] = 0;
+    data.component_map[2] = 2;
+    REQUIRE_CMP(pl_plane_find_fmt(gpu, map2, &data), ==, fmt, "p");
+    REQUIRE_CMP(map2[0], ==, 0, "d");
+    REQUIRE_CMP(map2[2], ==, 2, "d");
+
+    data.pixel_stride = 5; // no format with this texel size
+    REQUIRE(!pl_plane_find_fmt(gpu, NULL, &data));
+    REQUIRE(!pl_plane_find_fmt(gpu, NULL, &data));
+}
+
+static void capture_cb(void *priv, const void *data, size_t size)
+{
+    pl_str *str = priv;
+    pl_str_append_raw(NULL, str, data, size);
+}
+
+static void capture_tests(pl_log log)
+{
+    pl_str cap = {0}, recap = {0};
+    pl_gpu gpu = pl_gpu_dummy_create(log, pl_gpu_dummy_params(
+        .capture = capture_cb,
+        .capture_priv = &cap,
+    ));
+    REQUIRE(gpu);
+    REQUIRE_CMP(gpu->limits.max_mapped_size, ==, 0, "zu");
+
+    pl_fmt fmt = pl_find_named_fmt(gpu, "rgba8");
+    pl_tex src = pl_tex_create(gpu, pl_tex_params(
+        .w = 16,
+        .h = 16,
+        .format = fmt,
+        .sampleable = true,
+        .blit_src = true,
+        .host_writable = true,
+    ));
+    pl_tex dst = pl_tex_create(gpu, pl_tex_params(
+        .w = 16,
+        .h = 16,
+        .format = fmt,
+        .renderable = true,
+        .blit_dst = true,
+        .host_readable = true,
+    ));
+    REQUIRE(src && dst);
+
+    static uint32_t data[16 * 16];
+    for (int i = 0; i < PL_ARRAY_SIZE(data); i++)
+        data[i] = i;
+    REQUIRE(pl_tex_upload(gpu, pl_tex_transfer_params( .tex = src, .ptr = data )));
+    pl_tex_clear(gpu, dst, (float[]) { 0.0, 0.0, 0.0, 1.0 });
+    pl_tex_blit(gpu, pl_tex_blit_params(
+        .src = src,
+        .dst = dst,
+        .dst_rc = { .x1 = 8, .y1 = 8, .z1 = 1 },
+        .sample_mode = PL_TEX_SAMPLE_LINEAR,
+    ));
+
+    // Capture mode accepts passes, so shaders can be dispatched
+    pl_dispatch dp = pl_dispatch_create(log, gpu);
+    for (int i = 0; i < 2; i++) {
+        pl_shader sh = pl_dispatch_begin(dp);
+        REQUIRE(pl_shader_sample_direct(sh, pl_sample_src( .tex = src )));
+        pl_shader_color_map_ex(sh, NULL, pl_color_map_args(
+            .src = pl_color_space_bt709,
+            .dst = pl_color_space_srgb,
+        ));
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = dst,
+        )));
+    }
+
+    REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params( .tex = dst, .ptr = data )));
+    pl_gpu_finish(gpu);
+    pl_dispatch_destroy(&dp);
+    pl_tex_destroy(gpu, &src);
+    pl_tex_destroy(gpu, &dst);
+    pl_gpu_dummy_destroy(&gpu);
+    REQUIRE(pl_str_find(cap, pl_str0("void main")) >= 0);
+
+    // Replaying onto another capturing GPU reproduces the identical stream
+    pl_gpu replay = pl_gpu_dummy_create(log, pl_gpu_dummy_params(
+        .capture = capture_cb,
+        .capture_priv = &recap,
+    ));
+    REQUIRE(pl_gpu_dummy_replay(replay, cap.buf, cap.len, 1));
+    REQUIRE_CMP(recap.len, ==, cap.len, "zu");
+    REQUIRE_MEMEQ(recap.buf, cap.buf, cap.len);
+
+    // Looping reuses the objects created by the first iteration
+    recap.len = 0;
+    REQUIRE(pl_gpu_dummy_replay(replay, cap.buf, cap.len, 3));
+    REQUIRE(pl_str_find(pl_str_drop(recap, cap.len), pl_str0("void main")) < 0);
+
+    // Truncated and invalid streams are rejected
+    pl_log_level_update(log, PL_LOG_NONE);
+    REQUIRE(!pl_gpu_dummy_replay(replay, cap.buf, cap.len - 1, 1));
+    REQUIRE(!pl_gpu_dummy_replay(replay, cap.buf + 4, cap.len - 4, 1));
+    pl_log_level_update(log, PL_LOG_DEBUG);
+
+    pl_gpu_dummy_destroy(&replay);
+    pl_free(cap.buf);
+    pl_free(recap.buf);
+}
+
 int main()
 {
     pl_log log = pl_test_logger();
     pl_gpu gpu = pl_gpu_dummy_create(log, NULL);
     pl_buffer_tests(gpu);
     pl_texture_tests(gpu);
+    chunked_upload_tests(gpu);
+    swapped_upload_tests(gpu);
+    multi_upload_tests(gpu);
+    ring_tests(gpu);
+    blit_tests(gpu);
+    format_tests(gpu);
+    dither_tests(log, gpu);
+    capture_tests(log);
 
     // Attempt creating a shader and accessing the resulting LUT
     pl_tex dummy = pl_tex_dummy_create(gpu, pl_tex_dummy_params(
@@ -49,6 +738,37 @@ int main()
 #endif
     }
 
+    // Try out applying a transform to each polar tap
+    pl_shader tap = pl_shader_alloc(log, pl_shader_params( .gpu = gpu, .id = 1 ));
+    pl_shader_sigmoidize(tap, &pl_sigmoid_default_params);
+    filter_params.tap_shader = tap;
+    pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+    REQUIRE(pl_shader_sample_polar(sh, &src, &filter_params));
+    REQUIRE(pl_shader_finalize(sh));
+    REQUIRE(pl_shader_is_failed(tap)); // merged into `sh`
+    pl_shader_free(&tap);
+    filter_params.tap_shader = NULL;
+
+    // Try out separated scaling in both directions at once
+    pl_shader_obj ortho_lut = NULL;
+    struct pl_sample_filter_params ortho_params = {
+        .filter = pl_filter_lanczos,
+        .lut = &ortho_lut,
+    };
+
+    if (gpu->glsl.compute) {
+        pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+        REQUIRE(pl_shader_sample_ortho2(sh, &src, &ortho_params));
+        REQUIRE(pl_shader_is_compute(sh));
+        REQUIRE(pl_shader_finalize(sh));
+    }
+
+    ortho_params.no_compute = true;
+    pl_shader_reset(sh, pl_shader_params( .gpu = gpu ));
+    REQUIRE(!pl_shader_sample_ortho2(sh, &src, &ortho_params));
+    REQUIRE(!pl_shader_is_failed(sh));
+    pl_shader_obj_destroy(&ortho_lut);
+
     // Try out generation of the sampler2D interface
     src.tex = NULL;
     src.tex_w = 100;
@@ -65,6 +785,10 @@ int main()
     pl_shader_free(&sh);
     pl_shader_obj_destroy(&lut);
     pl_tex_destroy(gpu, &dummy);
+
+    async_lut_tests(log, gpu);
+    shared_lut_tests(log, gpu);
+    resize_tests(log, gpu);
     pl_gpu_dummy_destroy(&gpu);
     pl_log_destroy(&log);
 }
@@ -1,6 +1,7 @@
 #include "tests.h"
+#include "filters.h"
 
-#include <libplacebo/filters.h>
+#include <libplacebo/cache.h>
 
 int main()
 {
@@ -77,5 +78,44 @@ int main()
         pl_filter_free(&flt);
     }
 
+    // Test shared and cached filters
+    pl_cache cache = pl_cache_create(pl_cache_params( .log = log ));
+    for (int c = 0; c < pl_num_filter_configs; c++) {
+        const struct pl_filter_config *conf = pl_filter_configs[c];
+        if (conf->kernel->opaque)
+            continue;
+
+        const struct pl_filter_params params = {
+            .config           = *conf,
+            .lut_entries      = 64,
+            .cutoff           = conf->polar ? 1e-3 : 0.0,
+            .row_stride_align = 4,
+        };
+
+        pl_filter ref = pl_filter_generate(log, &params);
+        pl_filter a = pl_filter_acquire(log, &params, cache);
+        pl_filter b = pl_filter_acquire(log, &params, cache);
+        REQUIRE(ref && a && b);
+        REQUIRE(a == b);
+        pl_filter_release(&a);
+        pl_filter_release(&b);
+        REQUIRE(!a && !b);
+
+        // Re-created from the cache
+        a = pl_filter_acquire(log, &params, cache);
+        REQUIRE(a);
+        REQUIRE_CMP(a->radius, ==, ref->radius, "f");
+        REQUIRE_CMP(a->radius_zero, ==, ref->radius_zero, "f");
+        REQUIRE_CMP(a->row_size, ==, ref->row_size, "d");
+        REQUIRE_CMP(a->row_stride, ==, ref->row_stride, "d");
+        const int num = conf->polar ? params.lut_entries
+                                    : params.lut_entries * ref->row_stride;
+        REQUIRE_MEMEQ(a->weights, ref->weights, num * sizeof(float));
+        pl_filter_release(&a);
+        pl_filter_free(&ref);
+    }
+    REQUIRE_CMP(pl_cache_objects(cache), >, 0, "d");
+    pl_cache_destroy(&cache);
+
     pl_log_destroy(&log);
 }
@@ -1,5 +1,6 @@
 #include "tests.h"
 #include "shaders.h"
+#include "pl_thread.h"
 
 #include <libplacebo/renderer.h>
 #include <libplacebo/utils/frame_queue.h>
@@ -273,6 +274,72 @@ static void pl_texture_tests(pl_gpu gpu)
     }
 
     free(test_src);
+
+    // Test texture recycling through a pool
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 4, 8, 8, PL_FMT_CAP_SAMPLEABLE);
+    if (fmt && gpu->limits.max_tex_2d_dim >= 32) {
+        printf("testing texture pool\n");
+        pl_tex_pool pool = pl_tex_pool_create(gpu, 2);
+        struct pl_tex_params params = {
+            .format     = fmt,
+            .w          = 16,
+            .h          = 16,
+            .sampleable = true,
+        };
+
+        pl_tex tex = NULL, tex2 = NULL;
+        REQUIRE(pl_tex_pool_recreate(pool, &tex, &params));
+        pl_tex orig = tex;
+        pl_tex_pool_put(pool, &tex);
+        REQUIRE(!tex);
+        REQUIRE(pl_tex_pool_recreate(pool, &tex, &params));
+        REQUIRE(tex == orig);
+
+        // Incompatible textures get returned to the pool, for later reuse
+        params.w = 32;
+        REQUIRE(pl_tex_pool_recreate(pool, &tex, &params));
+        REQUIRE(tex != orig);
+        params.w = 16;
+        REQUIRE(pl_tex_pool_recreate(pool, &tex2, &params));
+        REQUIRE(tex2 == orig);
+
+        pl_tex_pool_put(pool, &tex);
+        pl_tex_pool_put(pool, &tex2);
+        pl_tex_pool_destroy(&pool);
+        REQUIRE(!pool);
+    }
+
+    // Test texture allocation with headroom
+    if (fmt && gpu->limits.max_tex_2d_dim >= 2048) {
+        printf("testing texture headroom\n");
+        struct pl_tex_params params = {
+            .format     = fmt,
+            .w          = 1920,
+            .h          = 1080,
+            .sampleable = true,
+        };
+
+        pl_tex tex = NULL;
+        REQUIRE(pl_tex_recreate_headroom(gpu, &tex, &params));
+        REQUIRE_CMP(tex->params.w, >=, params.w, "d");
+        REQUIRE_CMP(tex->params.h, >=, params.h, "d");
+        REQUIRE_CMP(tex->params.w, <=, params.w * 5 / 4, "d");
+        REQUIRE_CMP(tex->params.h, <=, params.h * 5 / 4, "d");
+
+        // Small changes in size reuse the same texture
+        pl_tex orig = tex;
+        params.w = 1900;
+        params.h = 1000;
+        REQUIRE(pl_tex_recreate_headroom(gpu, &tex, &params));
+        REQUIRE(tex == orig);
+
+        // Large changes do not
+        params.w = 640;
+        params.h = 360;
+        REQUIRE(pl_tex_recreate_headroom(gpu, &tex, &params));
+        REQUIRE_CMP(tex->params.w, <, 1000, "d");
+        pl_tex_destroy(gpu, &tex);
+    }
 }
 
 static void pl_planar_tests(pl_gpu gpu)
@@ -312,6 +379,86 @@ static void pl_planar_tests(pl_gpu gpu)
     pl_tex_destroy(gpu, &tex);
 }
 
+static void pl_packed_tests(pl_gpu gpu)
+{
+    const struct pl_packed_layout *layouts[] = { &pl_packed_v210, &pl_packed_y210 };
+    for (int l = 0; l < PL_ARRAY_SIZE(layouts); l++) {
+        const struct pl_packed_layout *layout = layouts[l];
+        if (!pl_packed_upload_supported(gpu, layout))
+            continue;
+
+        // Use a width which does not fill the last group
+        enum { width = 10, height = 3, max_groups = 5, max_words = 4 };
+        const int groups = PL_DIV_UP(width, layout->group_pixels);
+        const int row_words = groups * layout->group_size / sizeof(uint32_t);
+        REQUIRE_CMP(groups * layout->group_size, <=, max_groups * max_words * 4, "d");
+        uint32_t packed[height][max_groups * max_words] = {0};
+        uint16_t ref[3][height][width] = {0};
+
+        for (int y = 0; y < height; y++) {
+            for (int g = 0; g < groups; g++) {
+                for (int i = 0; i < layout->num_samples; i++) {
+                    const struct pl_packed_sample *smp = &layout->samples[i];
+                    const uint32_t val = (y * 131 + g * 37 + i * 59) & ((1 << smp->bits) - 1);
+                    const int word = g * layout->group_size / 4 + smp->offset / 32;
+                    packed[y][word] |= val << (smp->offset % 32);
+                    const int px = g * (smp->plane ? 1 : 2) * layout->group_pixels / 2 + smp->x;
+                    if (px < width)
+                        ref[smp->plane][y][px] = val;
+                }
+            }
+        }
+
+        pl_tex tex[3] = {0};
+        struct pl_plane planes[3];
+        REQUIRE(pl_upload_packed(gpu, planes, tex, &(struct pl_packed_data) {
+            .layout     = layout,
+            .width      = width,
+            .height     = height,
+            .row_stride = sizeof(packed[0]),
+            .pixels     = packed,
+        }));
+        REQUIRE_CMP(row_words * 4, <=, (int) sizeof(packed[0]), "d");
+
+        for (int p = 0; p < 3; p++) {
+            const int plane_w = p ? PL_DIV_UP(width, 2) : width;
+            REQUIRE_CMP(tex[p]->params.w, ==, plane_w, "d");
+            REQUIRE_CMP(planes[p].component_mapping[0], ==, p, "d");
+            pl_fmt fmt = tex[p]->params.format;
+            if (!tex[p]->params.host_readable || fmt->texel_size != sizeof(uint16_t))
+                continue;
+
+            uint16_t data[height][width];
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex        = tex[p],
+                .ptr        = data,
+                .row_pitch  = sizeof(data[0]),
+            )));
+            for (int y = 0; y < height; y++) {
+                for (int x = 0; x < plane_w; x++) {
+                    const float expected = ref[p][y][x] / 1023.0f * 0xFFFF;
+                    REQUIRE_FEQ(data[y][x], expected, 1.0);
+                }
+            }
+        }
+
+        for (int p = 0; p < 3; p++)
+            pl_tex_destroy(gpu, &tex[p]);
+    }
+}
+
+static void async_info_cb(void *priv, const struct pl_dispatch_info *info)
+{
+    bool *skipped = priv;
+    *skipped = info->skipped;
+}
+
+static void trace_write_cb(void *priv, size_t size, const void *ptr)
+{
+    pl_str *str = priv;
+    pl_str_append_raw(NULL, str, ptr, size);
+}
+
 static void pl_shader_tests(pl_gpu gpu)
 {
     if (gpu->glsl.version < 410)
@@ -538,6 +685,24 @@ static void pl_shader_tests(pl_gpu gpu)
         }));
 
         TEST_FBO_PATTERN(1e-6, "%s", "pl_tex_blit_compute");
+
+        // Test batched blits, copying each quadrant separately
+        struct pl_tex_blit_params blits[4];
+        for (int i = 0; i < 4; i++) {
+            const int x0 = (i % 2) * FBO_W / 2, y0 = (i / 2) * FBO_H / 2;
+            const pl_rect3d rc = { x0, y0, 0, x0 + FBO_W / 2, y0 + FBO_H / 2, 1 };
+            blits[i] = (struct pl_tex_blit_params) {
+                .src = src,
+                .dst = fbo,
+                .src_rc = rc,
+                .dst_rc = rc,
+                .sample_mode = PL_TEX_SAMPLE_NEAREST,
+            };
+        }
+
+        pl_tex_clear(gpu, fbo, (float[4]){0});
+        REQUIRE(pl_tex_blit_compute_batch(gpu, blits, 4));
+        TEST_FBO_PATTERN(1e-6, "%s", "pl_tex_blit_compute_batch");
     }
 
     // Test encoding/decoding of all gamma functions, color spaces, etc.
@@ -591,6 +756,22 @@ static void pl_shader_tests(pl_gpu gpu)
         TEST_FBO_PATTERN(epsilon, "color system %d", (int) sys);
     }
 
+    // Test passes shared between multiple dispatch objects, making sure they
+    // outlive the dispatch object that first created them
+    pl_dispatch dp2 = pl_dispatch_create(gpu->log, gpu);
+    for (int i = 0; i < 3; i++) {
+        pl_dispatch d = i == 0 ? dp2 : dp;
+        sh = pl_dispatch_begin(d);
+        pl_shader_sample_nearest(sh, pl_sample_src( .tex = src ));
+        REQUIRE(pl_dispatch_finish(d, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        )));
+        TEST_FBO_PATTERN(1e-6, "shared pass %d", i);
+        if (i == 1)
+            pl_dispatch_destroy(&dp2);
+    }
+
     // Repeat this a few times to test the caching
     pl_cache cache = pl_cache_create(pl_cache_params( .log = gpu->log ));
     pl_gpu_set_cache(gpu, cache);
@@ -639,6 +820,23 @@ static void pl_shader_tests(pl_gpu gpu)
     pl_gpu_set_cache(gpu, NULL);
     pl_cache_destroy(&cache);
 
+    // Test that evicted passes are transparently re-created
+    pl_dispatch_set_cache_params(dp, pl_dispatch_cache_params( .max_passes = 1 ));
+    for (int i = 0; i < 6; i++) {
+        sh = pl_dispatch_begin(dp);
+        pl_shader_sample_nearest(sh, pl_sample_src( .tex = src ));
+        pl_shader_linearize(sh, &(struct pl_color_space) { .transfer = 1 + i % 3 });
+        pl_shader_delinearize(sh, &(struct pl_color_space) { .transfer = 1 + i % 3 });
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        )));
+        TEST_FBO_PATTERN(1e-6, "evicted pass %d", i);
+        for (int n = 0; n < 20; n++)
+            pl_dispatch_reset_frame(dp);
+    }
+    pl_dispatch_set_cache_params(dp, pl_dispatch_cache_params(0));
+
     // Test peak detection and readback if possible
     sh = pl_dispatch_begin(dp);
     pl_shader_sample_nearest(sh, pl_sample_src( .tex = src ));
@@ -671,6 +869,180 @@ static void pl_shader_tests(pl_gpu gpu)
         real_avg = real_avg / (FBO_W * FBO_H);
         REQUIRE_FEQ(hdr.max_pq_y, real_peak, 1e-4);
         REQUIRE_FEQ(hdr.avg_pq_y, real_avg,  1e-3);
+
+        // The raw result of the first frame matches the smoothed result
+        struct pl_peak_detect_frame frame;
+        REQUIRE(pl_get_detected_peak_frame(peak_state, &frame));
+        REQUIRE_CMP(frame.index, ==, 0, PRIu64);
+        REQUIRE(!frame.cheap && !frame.scene_change);
+        REQUIRE_FEQ(frame.max_pq_y, hdr.max_pq_y, 1e-6);
+        REQUIRE_FEQ(frame.avg_pq_y, hdr.avg_pq_y, 1e-6);
+        REQUIRE_FEQ(frame.max_cll, pl_hdr_rescale(PL_HDR_PQ, PL_HDR_NITS, real_peak), 1e-2);
+        REQUIRE(!pl_get_detected_peak_frame(peak_state, &frame));
+    }
+
+    pl_dispatch_abort(dp, &sh);
+    pl_shader_obj_destroy(&peak_state);
+
+    // Test downsampled peak detection, which only measures even pixels
+    sh = pl_dispatch_begin(dp);
+    pl_shader_sample_nearest(sh, pl_sample_src( .tex = src ));
+    peak_params.downsample = true;
+    if (pl_shader_detect_peak(sh, csp_gamma22, &peak_state, &peak_params)) {
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .width = fbo->params.w,
+            .height = fbo->params.h,
+        }));
+
+        struct pl_hdr_metadata hdr;
+        REQUIRE(pl_get_detected_hdr_metadata(peak_state, &hdr));
+
+        float real_peak = 0, real_avg = 0;
+        for (int y = 0; y < FBO_H; y += 2) {
+            for (int x = 0; x < FBO_W; x += 2) {
+                float *color = &src_data[(y * FBO_W + x) * 4];
+                float luma = 0.212639f * powf(color[0], 2.2f) +
+                             0.715169f * powf(color[1], 2.2f) +
+                             0.072192f * powf(color[2], 2.2f);
+                luma = pl_hdr_rescale(PL_HDR_NORM, PL_HDR_PQ, luma);
+                real_peak = PL_MAX(real_peak, luma);
+                real_avg += luma;
+            }
+        }
+        real_avg = real_avg / ((FBO_W / 2) * (FBO_H / 2));
+        REQUIRE_FEQ(hdr.max_pq_y, real_peak, 1e-4);
+        REQUIRE_FEQ(hdr.avg_pq_y, real_avg,  1e-3);
+    }
+
+    pl_dispatch_abort(dp, &sh);
+    pl_shader_obj_destroy(&peak_state);
+
+    // Test temporal reuse of peak detection results
+    peak_params.downsample = false;
+    peak_params.detect_interval = 4;
+    peak_params.scene_threshold_low = 1.0;
+    peak_params.scene_threshold_high = 3.0;
+    struct pl_hdr_metadata hdr_full = {0};
+    for (int i = 0; i < 3; i++) {
+        sh = pl_dispatch_begin(dp);
+        if (i < 2) {
+            pl_shader_sample_nearest(sh, pl_sample_src( .tex = src ));
+        } else {
+            // Solid black frame, triggers a scene change
+            pl_shader_custom(sh, &(struct pl_custom_shader) {
+                .body   = "color = vec4(0.0);",
+                .input  = PL_SHADER_SIG_NONE,
+                .output = PL_SHADER_SIG_COLOR,
+            });
+        }
+
+        if (!pl_shader_detect_peak(sh, csp_gamma22, &peak_state, &peak_params))
+            break;
+
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .width = fbo->params.w,
+            .height = fbo->params.h,
+        }));
+
+        struct pl_hdr_metadata hdr;
+        REQUIRE(pl_get_detected_hdr_metadata(peak_state, &hdr));
+        switch (i) {
+        case 0: hdr_full = hdr; break;
+        case 1: // cheap measurement, result must be reused as-is
+            REQUIRE_FEQ(hdr.max_pq_y, hdr_full.max_pq_y, 1e-6);
+            REQUIRE_FEQ(hdr.avg_pq_y, hdr_full.avg_pq_y, 1e-6);
+            break;
+        case 2: // scene change, result must be adopted immediately
+            REQUIRE_CMP(hdr.avg_pq_y, <, hdr_full.avg_pq_y, "f");
+            break;
+        }
+    }
+
+    pl_dispatch_abort(dp, &sh);
+    pl_shader_obj_destroy(&peak_state);
+
+    // Test delayed readback, which cycles through several peak buffers
+    peak_params.detect_interval = 0;
+    peak_params.allow_delayed = true;
+    for (int i = 0; i < 10; i++) {
+        sh = pl_dispatch_begin(dp);
+        pl_shader_sample_nearest(sh, pl_sample_src( .tex = src ));
+        if (!pl_shader_detect_peak(sh, csp_gamma22, &peak_state, &peak_params))
+            break;
+
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .width = fbo->params.w,
+            .height = fbo->params.h,
+        }));
+
+        struct pl_hdr_metadata hdr;
+        if (i == 9) {
+            pl_gpu_finish(gpu);
+            REQUIRE(pl_get_detected_hdr_metadata(peak_state, &hdr));
+            REQUIRE_FEQ(hdr.max_pq_y, hdr_full.max_pq_y, 1e-4);
+            REQUIRE_FEQ(hdr.avg_pq_y, hdr_full.avg_pq_y, 1e-3);
+        } else {
+            pl_get_detected_hdr_metadata(peak_state, &hdr);
+        }
+    }
+
+    // Every delayed result is retained, in submission order
+    struct pl_peak_detect_frame frame;
+    for (uint64_t i = 0; pl_get_detected_peak_frame(peak_state, &frame); i++) {
+        REQUIRE_CMP(frame.index, ==, i, PRIu64);
+        if (frame.index == 9)
+            REQUIRE_FEQ(frame.max_pq_y, hdr_full.max_pq_y, 1e-4);
+    }
+
+    pl_dispatch_abort(dp, &sh);
+    pl_shader_obj_destroy(&peak_state);
+
+    // Test histogram export
+    peak_params.allow_delayed = false;
+    peak_params.percentile = 99.0f;
+    sh = pl_dispatch_begin(dp);
+    pl_shader_sample_nearest(sh, pl_sample_src( .tex = src ));
+    if (pl_shader_detect_peak(sh, csp_gamma22, &peak_state, &peak_params)) {
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .width = fbo->params.w,
+            .height = fbo->params.h,
+        }));
+
+        REQUIRE(pl_get_detected_peak_frame(peak_state, &frame));
+        uint64_t total = 0;
+        for (int i = 0; i < PL_PEAK_HIST_BINS; i++)
+            total += frame.histogram[i];
+        REQUIRE_CMP(total, >=, FBO_W * FBO_H, PRIu64);
+        REQUIRE_CMP(frame.max_pq_y, <=, hdr_full.max_pq_y + 1e-4, "f");
+    }
+
+    pl_dispatch_abort(dp, &sh);
+    pl_shader_obj_destroy(&peak_state);
+
+    // Test GPU-resident peak detection, which must reset its own accumulators
+    peak_params.percentile = 0.0f;
+    peak_params.gpu_resident = true;
+    for (int i = 0; i < 3; i++) {
+        sh = pl_dispatch_begin(dp);
+        pl_shader_sample_nearest(sh, pl_sample_src( .tex = src ));
+        if (!pl_shader_detect_peak(sh, csp_gamma22, &peak_state, &peak_params))
+            break;
+
+        REQUIRE(pl_dispatch_compute(dp, &(struct pl_dispatch_compute_params) {
+            .shader = &sh,
+            .width = fbo->params.w,
+            .height = fbo->params.h,
+        }));
+
+        struct pl_hdr_metadata hdr;
+        REQUIRE(pl_get_detected_hdr_metadata(peak_state, &hdr));
+        REQUIRE_FEQ(hdr.max_pq_y, hdr_full.max_pq_y, 1e-4);
+        REQUIRE_FEQ(hdr.avg_pq_y, hdr_full.avg_pq_y, 1e-3);
+        REQUIRE(!pl_get_detected_peak_frame(peak_state, &frame));
     }
 
     pl_dispatch_abort(dp, &sh);
@@ -760,6 +1132,19 @@ static void pl_shader_tests(pl_gpu gpu)
         .target = fbo,
     }));
 
+    // Test dolbyvision reshaping via LUT
+    pl_shader_obj dovi_state = NULL;
+    for (int i = 0; i < 2; i++) {
+        sh = pl_dispatch_begin(dp);
+        pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+        pl_shader_dovi_reshape_lut(sh, &dovi_meta, 0, &dovi_state);
+        REQUIRE(pl_dispatch_finish(dp, &(struct pl_dispatch_params) {
+            .shader = &sh,
+            .target = fbo,
+        }));
+    }
+    pl_shader_obj_destroy(&dovi_state);
+
     // Test deinterlacing
     sh = pl_dispatch_begin(dp);
     pl_shader_deinterlace(sh, pl_deinterlace_source( .cur = pl_field_pair(src) ), NULL);
@@ -768,6 +1153,31 @@ static void pl_shader_tests(pl_gpu gpu)
         .target = fbo,
     )));
 
+    for (enum pl_deinterlace_algorithm algo = 0; algo < PL_DEINTERLACE_ALGORITHM_COUNT; algo++) {
+        sh = pl_dispatch_begin(dp);
+        pl_shader_deinterlace(sh, pl_deinterlace_source(
+            .prev  = pl_field_pair(src),
+            .cur   = pl_field_pair(src),
+            .next  = pl_field_pair(src),
+            .field = PL_FIELD_BOTTOM,
+        ), pl_deinterlace_params( .algo = algo ));
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        )));
+    }
+
+    // Test debanding with early exit
+    sh = pl_dispatch_begin(dp);
+    pl_shader_deband(sh, pl_sample_src( .tex = src ), pl_deband_params(
+        .iterations = 4,
+        .early_exit = true,
+    ));
+    REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+        .shader = &sh,
+        .target = fbo,
+    )));
+
     // Test error diffusion
     if (fbo->params.storable) {
         for (int i = 0; i < pl_num_error_diffusion_kernels; i++) {
@@ -791,6 +1201,154 @@ static void pl_shader_tests(pl_gpu gpu)
                 .dispatch_size = {1, 1, 1},
             )));
         }
+
+        // Test banded error diffusion
+        const int band_height = PL_MAX(fbo->params.h / 3, 1);
+        sh = pl_dispatch_begin(dp);
+        if (pl_shader_error_diffusion(sh, pl_error_diffusion_params(
+                .input_tex   = src,
+                .output_tex  = fbo,
+                .new_depth   = 8,
+                .band_height = band_height,
+            )))
+        {
+            REQUIRE(pl_dispatch_compute(dp, pl_dispatch_compute_params(
+                .shader = &sh,
+                .dispatch_size = {1, PL_DIV_UP(fbo->params.h, band_height), 1},
+            )));
+        } else {
+            pl_dispatch_abort(dp, &sh);
+        }
+    }
+
+    // Synchronous dispatches must never be reported as skipped
+    {
+        bool skipped = true;
+        pl_dispatch_callback(dp, &skipped, async_info_cb);
+        sh = pl_dispatch_begin(dp);
+        pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        )));
+        REQUIRE(!skipped);
+        pl_dispatch_callback(dp, NULL, NULL);
+    }
+
+    // Test dispatch tracing
+    pl_str trace = {0};
+    pl_dispatch_trace_begin(dp);
+    for (int i = 0; i < 3; i++) {
+        sh = pl_dispatch_begin(dp);
+        pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        )));
+    }
+    pl_dispatch_trace_end(dp, trace_write_cb, &trace);
+    REQUIRE(pl_str_startswith0(trace, "{\"displayTimeUnit\""));
+    REQUIRE(pl_str_endswith0(trace, "]}\n"));
+    int num_events = 0;
+    for (pl_str rest = trace; rest.len; num_events++) {
+        int idx = pl_str_find(rest, pl_str0("\"cat\":\"cpu\""));
+        if (idx < 0)
+            break;
+        rest = pl_str_drop(rest, idx + 1);
+    }
+    REQUIRE_CMP(num_events, ==, 3, "d");
+    pl_free(trace.buf);
+
+    // Test uniform updates across frames, including frames that leave the
+    // (per-frame cycled) uniform buffer contents unchanged
+    static const float ubo_vals[] = { 0.25, 0.5, 0.75, 0.75, 0.75, 1.0, 0.25 };
+    for (int i = 0; i < PL_ARRAY_SIZE(ubo_vals); i++) {
+        pl_dispatch_reset_frame(dp);
+        sh = pl_dispatch_begin(dp);
+        REQUIRE(pl_shader_custom(sh, &(struct pl_custom_shader) {
+            .body           = "color = vec4(ubo_val, 0.0, 0.0, 1.0);",
+            .output         = PL_SHADER_SIG_COLOR,
+            .num_variables  = 1,
+            .variables      = &(struct pl_shader_var) {
+                .var  = pl_var_float("ubo_val"),
+                .data = &ubo_vals[i],
+            },
+        }));
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = fbo,
+        )));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = fbo,
+            .ptr = test_data,
+        )));
+        REQUIRE_FEQ(test_data[0], ubo_vals[i], 1e-6);
+    }
+
+    // Test asynchronous pass compilation
+    if (gpu->limits.thread_safe || pl_gpu_compiles_async(gpu)) {
+        bool skipped = false;
+        pl_dispatch_async(dp, true);
+        pl_dispatch_callback(dp, &skipped, async_info_cb);
+        for (int i = 0; i < 1000; i++) {
+            sh = pl_dispatch_begin(dp);
+            pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+            GLSL("color *= vec4(0.25, 0.5, 0.75, 1.0); \n");
+            REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+                .shader = &sh,
+                .target = fbo,
+            )));
+            if (!skipped)
+                break;
+            pl_thread_sleep(1e-3);
+        }
+        REQUIRE(!skipped);
+        pl_dispatch_callback(dp, NULL, NULL);
+        pl_dispatch_async(dp, false);
+    }
+
+    // Test workgroup size auto-tuning, which must not affect the output
+    if (fbo->params.storable && gpu->glsl.compute) {
+        static uint8_t ref[sizeof(test_data)], out[sizeof(test_data)];
+        pl_dispatch_autotune(dp, true);
+        for (int i = 0; i < 32; i++) {
+            sh = pl_dispatch_begin(dp);
+            REQUIRE(sh_try_compute(sh, 16, 16, true, 0));
+            pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+            REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+                .shader = &sh,
+                .target = fbo,
+            )));
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = fbo,
+                .ptr = i ? out : ref,
+            )));
+            REQUIRE(!i || memcmp(ref, out, sizeof(ref)) == 0);
+        }
+        pl_dispatch_autotune(dp, false);
+    }
+
+    // Test explicitly requested subgroup sizes
+    const struct pl_glsl_version glsl = gpu->glsl;
+    if (fbo->params.storable && glsl.max_subgroup_size) {
+        for (uint32_t size = glsl.min_subgroup_size; size <= glsl.max_subgroup_size;
+             size <<= 1)
+        {
+            sh = pl_dispatch_begin(dp);
+            REQUIRE(sh_try_compute(sh, glsl.max_subgroup_size, 1, false, 0));
+            REQUIRE(sh_try_subgroups(sh, size, true));
+            pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+            GLSL("color = vec4(float(gl_SubgroupSize)); \n");
+            REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+                .shader = &sh,
+                .target = fbo,
+            )));
+            REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+                .tex = fbo,
+                .ptr = test_data,
+            )));
+            REQUIRE_FEQ(test_data[0], size, 1e-6);
+        }
     }
 
     pl_dispatch_destroy(&dp);
@@ -876,6 +1434,67 @@ static void pl_scaler_tests(pl_gpu gpu)
 #endif
     }
 
+    // Test exact-phase separated scaling for a rational ratio (2:3), against
+    // a reference computed directly from the filter weights
+    enum { src_w = 20, dst_w = src_w * 3 / 2 };
+    static float line[src_w], ref[dst_w], out[dst_w];
+    for (int i = 0; i < src_w; i++)
+        line[i] = (i * 7 % 11) / 10.0f;
+
+    const struct pl_filter_config *filter = &pl_filter_lanczos;
+    for (int i = 0; i < dst_w; i++) {
+        const double x = (i + 0.5) * src_w / dst_w;
+        double sum = 0.0, wsum = 0.0;
+        for (int k = floor(x) - 4; k <= floor(x) + 4; k++) {
+            const double w = pl_filter_sample(filter, x - (k + 0.5));
+            sum += w * line[PL_CLAMP(k, 0, src_w - 1)];
+            wsum += w;
+        }
+        ref[i] = sum / wsum;
+    }
+
+    pl_tex line_src = pl_tex_create(gpu, pl_tex_params(
+        .w              = src_w,
+        .h              = 1,
+        .format         = src_fmt,
+        .sampleable     = true,
+        .initial_data   = line,
+    ));
+
+    fbo_params.w = dst_w;
+    fbo_params.h = 1;
+    pl_tex line_dst = pl_tex_create(gpu, &fbo_params);
+    if (line_src && line_dst && line_dst->params.host_readable) {
+        pl_shader_obj line_lut = NULL;
+        sh = pl_dispatch_begin(dp);
+        REQUIRE(pl_shader_sample_ortho2(sh,
+            pl_sample_src(
+                .tex        = line_src,
+                .new_w      = dst_w,
+                .new_h      = 1,
+            ),
+            pl_sample_filter_params(
+                .filter     = *filter,
+                .lut        = &line_lut,
+                .no_compute = true,
+            )
+        ));
+        REQUIRE(pl_dispatch_finish(dp, pl_dispatch_params(
+            .shader = &sh,
+            .target = line_dst,
+        )));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = line_dst,
+            .ptr = out,
+        )));
+        for (int i = 0; i < dst_w; i++)
+            REQUIRE_FEQ(out[i], ref[i], 1e-3);
+        pl_shader_obj_destroy(&line_lut);
+    }
+
+    pl_tex_destroy(gpu, &line_src);
+    pl_tex_destroy(gpu, &line_dst);
+
 error:
     free(fbo_data);
     pl_shader_obj_destroy(&lut);
@@ -961,7 +1580,28 @@ static const char *user_shader_tests[] = {
     "#if testenum == BAR                                                    \n"
     " #error bad                                                            \n"
     "#endif                                                                 \n"
-    "vec4 hook() { return vec4(0.0); }                                      \n"
+    "vec4 hook() { return vec4(0.0); }                                      \n",
+
+    // Test fusion of point-wise pass chains
+    "//!HOOK MAIN                                                           \n"
+    "//!DESC scale down                                                     \n"
+    "//!BIND HOOKED                                                         \n"
+    "//!SAVE HALF                                                           \n"
+    "                                                                       \n"
+    "vec4 hook()                                                            \n"
+    "{                                                                      \n"
+    "    return 0.5 * HOOKED_tex(HOOKED_pos);                               \n"
+    "}                                                                      \n"
+    "                                                                       \n"
+    "//!HOOK MAIN                                                           \n"
+    "//!DESC add back                                                       \n"
+    "//!BIND HOOKED                                                         \n"
+    "//!BIND HALF                                                           \n"
+    "                                                                       \n"
+    "vec4 hook()                                                            \n"
+    "{                                                                      \n"
+    "    return HALF_texOff(0) + 0.5 * HOOKED_texOff(0);                    \n"
+    "}                                                                      \n"
 };
 
 static const char *compute_shader_tests[] = {
@@ -1023,6 +1663,15 @@ static bool frame_passthrough(pl_gpu gpu, pl_tex *tex,
     return true;
 }
 
+static int frames_mapped;
+
+static bool frame_count_map(pl_gpu gpu, pl_tex *tex,
+                            const struct pl_source_frame *src, struct pl_frame *out_frame)
+{
+    frames_mapped++;
+    return frame_passthrough(gpu, tex, src, out_frame);
+}
+
 static enum pl_queue_status get_frame_ptr(struct pl_source_frame *out_frame,
                                           const struct pl_queue_params *qparams)
 {
@@ -1040,9 +1689,61 @@ static void render_info_cb(void *priv, const struct pl_render_info *info)
            info->pass->shader->description);
 }
 
+// Sums up the executed passes, for comparison with the frame stats
+static void sum_frame_stats(void *priv, const struct pl_render_info *info)
+{
+    struct pl_render_frame_stats *sum = priv;
+    if (info->pass->skipped)
+        return;
+    sum->passes++;
+    sum->gpu_time += info->pass->last;
+}
+
+static void count_frame_passes(void *priv, const struct pl_render_info *info)
+{
+    int *num = priv;
+    if (info->stage == PL_RENDER_STAGE_FRAME)
+        (*num)++;
+}
+
+static void check_deferred_info(void *priv, const struct pl_render_info *info)
+{
+    int *num = priv;
+    REQUIRE(info->pass && info->pass->shader);
+    REQUIRE_CMP(info->index, >=, 0, "d");
+    (*num)++;
+}
+
+static void count_low_fbos(void *priv, const struct pl_render_info *info)
+{
+    int *num = priv;
+    if (info->fbo_format && strcmp(info->fbo_format->name, "rgb10a2") == 0)
+        (*num)++;
+}
+
+static struct pl_hook_res counting_hook(void *priv, const struct pl_hook_params *params)
+{
+    int *calls = priv;
+    pl_tex tex = params->get_tex(params->priv, params->tex->params.w,
+                                 params->tex->params.h);
+    if (!tex)
+        return (struct pl_hook_res) { .failed = true };
+
+    (*calls)++;
+    pl_tex_clear(params->gpu, tex, (float[4]) {0});
+    return (struct pl_hook_res) {
+        .output     = PL_HOOK_SIG_TEX,
+        .tex        = tex,
+        .repr       = params->repr,
+        .color      = params->color,
+        .components = params->components,
+        .rect       = params->rect,
+    };
+}
+
 static void pl_render_tests(pl_gpu gpu)
 {
-    pl_tex img_tex = NULL, fbo = NULL;
+    pl_tex img_tex = NULL, fbo = NULL, ol_tex = NULL;
     pl_renderer rr = NULL;
 
     enum { width = 50, height = 50 };
@@ -1143,6 +1844,20 @@ static void pl_render_tests(pl_gpu gpu)
         pl_gpu_flush(gpu);
         REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
     }
+
+    // Test multi-stage downscaling, including an anamorphic ratio and
+    // downscaling without anti-aliasing
+    for (int i = 0; i < 3; i++) {
+        struct pl_render_params params = pl_render_default_params;
+        params.multistage_downscaling = true;
+        params.skip_anti_aliasing = i == 2;
+        target.crop.x1 = width / 7.0;
+        target.crop.y1 = i == 1 ? height / 2.0 : height / 5.0;
+        printf("testing `params.multistage_downscaling = true`\n");
+        REQUIRE(pl_render_image(rr, &image, &target, &params));
+        pl_gpu_flush(gpu);
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    }
     target.crop.x1 = target.crop.y1 = 0;
 
     TEST_PARAMS(deband, iterations, 3);
@@ -1163,8 +1878,46 @@ static void pl_render_tests(pl_gpu gpu)
     // Test HDR tone mapping
     image.color = pl_color_space_hdr10;
     TEST_PARAMS(color_map, visualize_lut, true);
-    if (gpu->limits.max_ssbo_size)
+    TEST_PARAMS(color_map, lut3d_adaptive, true);
+    if (gpu->limits.max_ssbo_size) {
         TEST_PARAMS(peak_detect, allow_delayed, true);
+        TEST_PARAMS(peak_detect, downsample, true);
+        TEST_PARAMS(peak_detect, detect_interval, 3);
+        TEST_PARAMS(peak_detect, gpu_resident, true);
+
+        // Test peak detection as a standalone (async) compute pass
+        struct pl_render_params params = pl_render_default_params;
+        struct pl_peak_detect_params peak_params = pl_peak_detect_default_params;
+        struct pl_render_frame_stats stats;
+        peak_params.allow_delayed = true;
+        params.peak_detect_params = &peak_params;
+        params.async_compute = true;
+        printf("testing `params.async_compute = true`\n");
+        for (int i = 0; i < 3; i++) {
+            REQUIRE(pl_render_image(rr, &image, &target, &params));
+            pl_gpu_flush(gpu);
+            REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+            REQUIRE(pl_renderer_get_frame_stats(rr, &stats));
+            REQUIRE_CMP(stats.async_passes, <=, 1, "d");
+        }
+
+        params.async_compute = false;
+        REQUIRE(pl_render_image(rr, &image, &target, &params));
+        REQUIRE(pl_renderer_get_frame_stats(rr, &stats));
+        REQUIRE_CMP(stats.async_passes, ==, 0, "d");
+    }
+
+    // Test contrast recovery, with both full and reduced resolution features
+    for (int i = 0; i < 2; i++) {
+        struct pl_render_params params = pl_render_default_params;
+        params.color_map_params = &pl_color_map_high_quality_params;
+        params.feature_map_downscale = i ? 2.0f : 0.0f;
+        printf("testing `params.feature_map_downscale = %f`\n",
+               params.feature_map_downscale);
+        REQUIRE(pl_render_image(rr, &image, &target, &params));
+        pl_gpu_flush(gpu);
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    }
 
     // Test inverse tone-mapping and pure BPC
     image.color.hdr.max_luma = 1000;
@@ -1200,6 +1953,26 @@ static void pl_render_tests(pl_gpu gpu)
     REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
     params = pl_render_default_params;
 
+    // Test reduced precision arithmetic
+    params.relaxed_precision = true;
+    params.deband_params = &pl_deband_default_params;
+    params.force_dither = true;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    params = pl_render_default_params;
+
+    // Test color passthrough, both with matching and mismatching color spaces
+    params.color_passthrough = true;
+    image.color = target.color = pl_color_space_hdr10;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    image.color = pl_color_space_srgb;
+    target.color = pl_color_space_bt709;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    target.color = pl_color_space_srgb;
+    params = pl_render_default_params;
+
     // Test film grain synthesis
     image.film_grain.type = PL_FILM_GRAIN_AV1;
     image.film_grain.params.av1 = av1_grain_data;
@@ -1342,7 +2115,58 @@ static void pl_render_tests(pl_gpu gpu)
     REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
     REQUIRE(pl_render_image(rr, NULL, &target, &params));
     REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
+    // Test batching overlays into an atlas, which must match drawing them
+    // individually
+    struct pl_plane ol_plane = {0};
+    REQUIRE(pl_upload_plane(gpu, &ol_plane, &ol_tex, &plane_data));
+    struct pl_overlay_part ol_parts[3] = {
+        { .src = {0, 0, 10, 10},    .dst = {0, 0, 10, 10} },
+        { .src = {20, 20, 30, 35},  .dst = {5, 5, 20, 20} },
+        { .src = {40, 5, 48.5, 12}, .dst = {10, 10, 30, 30} },
+    };
+    struct pl_overlay ols[3];
+    for (int i = 0; i < 3; i++) {
+        ols[i] = (struct pl_overlay) {
+            .tex        = i == 1 ? ol_tex : img_plane.texture,
+            .mode       = PL_OVERLAY_NORMAL,
+            .parts      = &ol_parts[i],
+            .num_parts  = 1,
+            .signature  = i == 1 ? 2 : 1,
+        };
+    }
+
+    static float ol_ref[height][width], ol_res[height][width];
+    const struct pl_overlay *target_ol = target.overlays;
+    target.overlays = ols;
+    target.num_overlays = 3;
+    const bool readable = fbo->params.host_readable;
+    REQUIRE(pl_render_image(rr, NULL, &target, &params));
+    if (readable)
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params( .tex = fbo, .ptr = ol_ref )));
+    params.overlay_atlas = true;
+    for (int i = 0; i < 2; i++) { // second iteration reuses the cached atlas
+        REQUIRE(pl_render_image(rr, NULL, &target, &params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+        if (!readable)
+            continue;
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params( .tex = fbo, .ptr = ol_res )));
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++)
+                REQUIRE_FEQ(ol_res[y][x], ol_ref[y][x], 1e-3);
+        }
+    }
+    params.overlay_atlas = false;
+    target.overlays = target_ol;
+    target.num_overlays = 1;
+
+    // Test redrawing a signed image with only the target overlays changing
+    image.signature = 0xFFF0;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
     target.num_overlays = 0;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    image.signature = 0;
 
     // Test rotation
     for (pl_rotation rot = 0; rot < PL_ROTATION_360; rot += PL_ROTATION_90) {
@@ -1351,6 +2175,83 @@ static void pl_render_tests(pl_gpu gpu)
         REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
     }
 
+    // Test tiled rendering
+    pl_rotation rot = image.rotation;
+    image.rotation = PL_ROTATION_0;
+    params.render_tile_size = 16;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    params.render_tile_size = 0;
+
+    // Test split-frame rendering, blitting each band into the target
+    if (fbo->params.blit_dst) {
+        pl_tex band_tex = NULL;
+        struct pl_frame band_target = target;
+        int last_y = 0;
+        for (int i = 0; i < 3; i++) {
+            struct pl_render_band band;
+            REQUIRE(pl_frames_split_band(&image, &target, &params, i, 3, &band));
+            REQUIRE_CMP(pl_rect_w(band.src_rc), ==, pl_rect_w(band.dst_rc), "d");
+            REQUIRE_CMP(pl_rect_h(band.src_rc), ==, pl_rect_h(band.dst_rc), "d");
+            REQUIRE_CMP(band.src_rc.y1, <=, band.height, "d");
+            if (i)
+                REQUIRE_CMP(band.dst_rc.y0, ==, last_y, "d");
+            last_y = band.dst_rc.y1;
+
+            REQUIRE(pl_tex_recreate(gpu, &band_tex, pl_tex_params(
+                .w          = band.width,
+                .h          = band.height,
+                .format     = fbo->params.format,
+                .renderable = true,
+                .blit_src   = true,
+            )));
+
+            band_target.planes[0].texture = band_tex;
+            band_target.crop = band.target_crop;
+            REQUIRE(pl_render_image(rr, &band.image, &band_target, &params));
+            REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+            pl_tex_blit(gpu, pl_tex_blit_params(
+                .src    = band_tex,
+                .dst    = fbo,
+                .src_rc = { band.src_rc.x0, band.src_rc.y0, 0,
+                            band.src_rc.x1, band.src_rc.y1, 1 },
+                .dst_rc = { band.dst_rc.x0, band.dst_rc.y0, 0,
+                            band.dst_rc.x1, band.dst_rc.y1, 1 },
+            ));
+        }
+        pl_tex_destroy(gpu, &band_tex);
+    }
+    image.rotation = rot;
+
+    // Test rendering to multiple targets at once
+    struct pl_frame multi_targets[2] = { target, target };
+    multi_targets[1].crop = (pl_rect2df) { 0, 0, width / 2.0, height / 2.0 };
+    const struct pl_render_params *multi_params[2] = { &params, &pl_render_fast_params };
+    REQUIRE(pl_render_image_multi(rr, &image, multi_targets, 2, multi_params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    REQUIRE(pl_render_image_multi(rr, &image, multi_targets, 2, NULL));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
+    // Test rendering a batch of thumbnails into a single target
+    struct pl_frame thumbs[4];
+    pl_rect2df thumb_rects[4];
+    for (int i = 0; i < 4; i++) {
+        thumbs[i] = image;
+        thumbs[i].crop = (pl_rect2df) { i, i, width - i, height - i };
+        thumb_rects[i] = (pl_rect2df) {
+            .x0 = (i % 2) * width / 2.0,
+            .y0 = (i / 2) * height / 2.0,
+            .x1 = (i % 2 + 1) * width / 2.0,
+            .y1 = (i / 2 + 1) * height / 2.0,
+        };
+    }
+    REQUIRE(pl_render_image_batch(rr, thumbs, thumb_rects, 4, &target, &params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
+    // Test compositing the same images in linear light
+    REQUIRE(pl_render_image_composite(rr, thumbs, thumb_rects, 4, &target, &params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
     // Attempt frame mixing, using the mixer queue helper
     printf("testing frame mixing \n");
     struct pl_render_params mix_params = {
@@ -1378,6 +2279,144 @@ static void pl_render_tests(pl_gpu gpu)
     pl_frames_infer_mix(rr, &mix, &inferred_target, &inferred_image);
     REQUIRE(pl_render_image_mix(rr, &mix, &target, &mix_params));
 
+    // Test reusing the mixed output across redundant redraws, which must
+    // reproduce a fresh render without running any passes
+    const struct pl_tex_params *fbo_params = &fbo->params;
+    if (fbo_params->blit_src && fbo_params->blit_dst && fbo_params->host_readable) {
+        static float fresh[width][height], reused[width][height];
+        struct pl_frame reuse_target = {
+            .num_planes = 1,
+            .planes     = {{
+                .texture            = fbo,
+                .components         = 1,
+                .component_mapping  = {0},
+            }},
+            .repr       = target.repr,
+            .color      = target.color,
+        };
+
+        struct pl_render_frame_stats stats;
+        REQUIRE(pl_render_image_mix(rr, &mix, &reuse_target, &mix_params));
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = fbo,
+            .ptr = fresh,
+        )));
+
+        mix_params.reuse_mixed_output = true;
+        REQUIRE(pl_render_image_mix(rr, &mix, &reuse_target, &mix_params));
+        pl_tex_clear_ex(gpu, fbo, (union pl_clear_color){0});
+        REQUIRE(pl_render_image_mix(rr, &mix, &reuse_target, &mix_params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+        REQUIRE(pl_renderer_get_frame_stats(rr, &stats));
+        REQUIRE_CMP(stats.passes, ==, 0, "d");
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = fbo,
+            .ptr = reused,
+        )));
+        REQUIRE_MEMEQ(fresh, reused, sizeof(fresh));
+
+        // The output depends on the previous target contents when not
+        // clearing it, so it must not be reused
+        mix_params.skip_target_clearing = true;
+        REQUIRE(pl_render_image_mix(rr, &mix, &reuse_target, &mix_params));
+        REQUIRE(pl_render_image_mix(rr, &mix, &reuse_target, &mix_params));
+        REQUIRE(pl_renderer_get_frame_stats(rr, &stats));
+        REQUIRE_CMP(stats.passes, >, 0, "d");
+        mix_params.skip_target_clearing = false;
+        mix_params.reuse_mixed_output = false;
+    }
+
+    // Test reusing frames from the frame cache history after a seek
+    struct pl_render_params hist_params = pl_render_default_params;
+    int num_frame_passes = 0;
+    hist_params.frame_cache_memory = 16;
+    hist_params.info_callback = count_frame_passes;
+    hist_params.info_priv = &num_frame_passes;
+    static const uint64_t hist_sigs[] = { 0xFFF3, 0xFFF4, 0xFFF3 };
+    for (int i = 0; i < PL_ARRAY_SIZE(hist_sigs); i++) {
+        num_frame_passes = 0;
+        mix = (struct pl_frame_mix) {
+            .num_frames = 1,
+            .frames = (const struct pl_frame *[]) { &image },
+            .signatures = &hist_sigs[i],
+            .timestamps = (float[]) { 0.0 },
+            .vsync_duration = 1.0,
+        };
+        REQUIRE(pl_render_image_mix(rr, &mix, &target, &hist_params));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    }
+    REQUIRE_CMP(num_frame_passes, ==, 0, "d");
+
+    // Test automatic FBO precision reduction, which must never kick in
+    // while debanding is active
+    struct pl_render_params low_params = pl_render_default_params;
+    int num_low_fbos = 0;
+    low_params.auto_fbo_precision = true;
+    low_params.info_callback = count_low_fbos;
+    low_params.info_priv = &num_low_fbos;
+    REQUIRE(pl_render_image(rr, &image, &target, &low_params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    REQUIRE_CMP(num_low_fbos, ==, 0, "d");
+    low_params.deband_params = NULL;
+    REQUIRE(pl_render_image(rr, &image, &target, &low_params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
+    // Test deferred delivery of pass information
+    struct pl_render_params defer_params = pl_render_default_params;
+    int num_deferred = 0;
+    defer_params.defer_info_callback = true;
+    defer_params.info_callback = check_deferred_info;
+    defer_params.info_priv = &num_deferred;
+    REQUIRE(pl_render_image(rr, &image, &target, &defer_params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    const struct pl_render_info *infos;
+    REQUIRE_CMP(pl_renderer_get_info(rr, &infos), ==, num_deferred, "d");
+    REQUIRE_CMP(num_deferred, >, 0, "d");
+    REQUIRE(infos[num_deferred - 1].pass);
+    REQUIRE(pl_render_image(rr, &image, &target, &low_params));
+    REQUIRE_CMP(pl_renderer_get_info(rr, &infos), ==, 0, "d");
+
+    // Test limiting the number of frames per mixing pass
+    struct pl_render_params wide_params = hist_params;
+    wide_params.frame_mixer = &pl_filter_mitchell_clamp;
+    wide_params.frame_cache_memory = 0;
+    wide_params.max_mix_frames = 2;
+    num_frame_passes = 0;
+    struct pl_frame wide_frames[4] = { image, image, image, image };
+    mix = (struct pl_frame_mix) {
+        .num_frames = 4,
+        .frames = (const struct pl_frame *[]) {
+            &wide_frames[0], &wide_frames[1], &wide_frames[2], &wide_frames[3],
+        },
+        .signatures = (uint64_t[]) { 0xFFF5, 0xFFF6, 0xFFF7, 0xFFF8 },
+        .timestamps = (float[]) { -0.9, -0.3, 0.3, 0.9 },
+        .vsync_duration = 1.0,
+    };
+    REQUIRE(pl_render_image_mix(rr, &mix, &target, &wide_params));
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    REQUIRE_CMP(num_frame_passes, ==, 2, "d");
+
+    // Test motion-compensated interpolation, which only needs the two frames
+    // straddling the vsync
+    struct pl_render_params memc_params = wide_params;
+    memc_params.max_mix_frames = 0;
+    memc_params.motion_params = &pl_motion_default_params;
+    num_frame_passes = 0;
+    mix.signatures = (uint64_t[]) { 0xFFF9, 0xFFFA, 0xFFFB, 0xFFFC };
+    REQUIRE(pl_render_image_mix(rr, &mix, &target, &memc_params));
+    REQUIRE(!(pl_renderer_get_errors(rr).errors & ~PL_RENDER_ERR_MOTION)); // optional
+    REQUIRE_CMP(num_frame_passes, ==, 2, "d");
+
+    // Test memory accounting, and that flushing releases all cached textures
+    struct pl_renderer_memory_usage mem;
+    pl_renderer_get_memory_usage(rr, &mem);
+    REQUIRE_CMP(mem.frame_cache, >, 0, "zu");
+    REQUIRE_CMP(mem.total, ==, mem.fbos + mem.frame_cache + mem.hook_cache +
+                mem.overlays + mem.shader_objects + mem.dispatch, "zu");
+    pl_renderer_flush_cache(rr);
+    pl_renderer_get_memory_usage(rr, &mem);
+    REQUIRE_CMP(mem.frame_cache + mem.hook_cache + mem.overlays, ==, 0, "zu");
+
     // Test empty frame mix
     mix = (struct pl_frame_mix) {0};
     REQUIRE(pl_render_image_mix(rr, &mix, &target, &mix_params));
@@ -1427,6 +2466,21 @@ static void pl_render_tests(pl_gpu gpu)
         qparams.pts += qparams.vsync_duration;
     }
 
+    // Test pushing all frames (and EOF) from the lock-free producer path
+    pl_queue_reset(queue);
+    for (int i = 0; i <= NUM_MIX_FRAMES; i++)
+        REQUIRE(pl_queue_push_async(queue, i < NUM_MIX_FRAMES ? &srcframes[i] : NULL));
+    REQUIRE_CMP(pl_queue_num_frames(queue), ==, NUM_MIX_FRAMES, "d");
+
+    // ... while also mapping frames in advance
+    qparams.pts = 0.0;
+    qparams.lookahead = 4;
+    while ((ret = pl_queue_update(queue, &mix, &qparams)) != PL_QUEUE_EOF) {
+        REQUIRE_CMP(ret, ==, PL_QUEUE_OK, "u");
+        REQUIRE(pl_render_image_mix(rr, &mix, &target, &mix_params));
+        qparams.pts += qparams.vsync_duration;
+    }
+
     // Test dynamically pulling all frames, with oversample mixer
     const struct pl_source_frame *frame_ptr = &srcframes[0];
     mix_params.frame_mixer = &pl_oversample_frame_mixer;
@@ -1470,11 +2524,164 @@ static void pl_render_tests(pl_gpu gpu)
         qparams.pts += qparams.vsync_duration;
     }
 
+    // Test VRR mode, which should present every frame exactly once
+    pl_queue_reset(queue);
+    for (int i = 0; i < NUM_MIX_FRAMES; i++) {
+        srcframes[i].first_field = PL_FIELD_NONE;
+        pl_queue_push(queue, &srcframes[i]);
+    }
+    pl_queue_push(queue, NULL);
+
+    int num_presented = 0;
+    double frame_pts, next_pts;
+    qparams.pts = 0;
+    qparams.vrr = true;
+    REQUIRE(!pl_queue_vrr_timing(queue, &frame_pts, &next_pts));
+    while ((ret = pl_queue_update(queue, &mix, &qparams)) != PL_QUEUE_EOF) {
+        REQUIRE_CMP(ret, ==, PL_QUEUE_OK, "u");
+        REQUIRE_CMP(mix.num_frames, ==, 1, "d");
+        REQUIRE(pl_queue_vrr_timing(queue, &frame_pts, &next_pts));
+        REQUIRE_FEQ(frame_pts, num_presented * frame_duration, 1e-6);
+        REQUIRE(pl_render_image_mix(rr, &mix, &target, &mix_params));
+        num_presented++;
+        qparams.pts = isfinite(next_pts) ? next_pts : qparams.pts + 2 * frame_duration;
+    }
+    REQUIRE_CMP(num_presented, ==, NUM_MIX_FRAMES, "d");
+    qparams.vrr = false;
+
+    // Test a second view of the same queue at a different display rate,
+    // which must share (and thus not re-map) all frames
+    pl_queue_reset(queue);
+    for (int i = 0; i < NUM_MIX_FRAMES; i++) {
+        srcframes[i].map = frame_count_map;
+        pl_queue_push(queue, &srcframes[i]);
+    }
+    pl_queue_push(queue, NULL);
+
+    pl_queue_view view = pl_queue_view_create(queue);
+    struct pl_queue_params vparams = qparams;
+    vparams.vsync_duration = 1.0 / 30.0;
+    qparams.pts = vparams.pts = 0;
+    frames_mapped = 0;
+
+    enum pl_queue_status vret = PL_QUEUE_OK;
+    ret = PL_QUEUE_OK;
+    while (ret != PL_QUEUE_EOF || vret != PL_QUEUE_EOF) {
+        bool use_view = ret == PL_QUEUE_EOF ||
+                        (vret != PL_QUEUE_EOF && vparams.pts < qparams.pts);
+        struct pl_queue_params *cur = use_view ? &vparams : &qparams;
+        enum pl_queue_status st;
+        if (use_view) {
+            st = vret = pl_queue_view_update(view, &mix, cur);
+        } else {
+            st = ret = pl_queue_update(queue, &mix, cur);
+        }
+        if (st == PL_QUEUE_EOF)
+            continue;
+        REQUIRE_CMP(st, ==, PL_QUEUE_OK, "u");
+        REQUIRE(pl_render_image_mix(rr, &mix, &target, &mix_params));
+        cur->pts += cur->vsync_duration;
+    }
+    REQUIRE_CMP(frames_mapped, ==, NUM_MIX_FRAMES, "d");
+    REQUIRE_CMP(pl_queue_view_estimate_vps(view), >, 25.0f, "f");
+    REQUIRE_CMP(pl_queue_view_estimate_vps(view), <, 35.0f, "f");
+    pl_queue_view_destroy(&view);
+
+    // Test the adaptive quality controller using synthetic render times
+    struct pl_dispatch_info aq_pass = { .last = 20000000 }; // 20 ms
+    struct pl_render_params aq_params;
+    enum pl_queue_quality level;
+    for (int i = 0; i < 100; i++) {
+        pl_queue_render_info(queue, &(struct pl_render_info) { .pass = &aq_pass });
+        aq_params = mix_params;
+        level = pl_queue_adapt_params(queue, &aq_params);
+    }
+    REQUIRE_CMP(level, ==, PL_QUEUE_QUALITY_NO_PEAK_DETECT, "d");
+    REQUIRE(!aq_params.frame_mixer);
+
+    aq_pass.last = 1000000; // 1 ms
+    for (int i = 0; i < 1000; i++) {
+        pl_queue_render_info(queue, &(struct pl_render_info) { .pass = &aq_pass });
+        aq_params = mix_params;
+        level = pl_queue_adapt_params(queue, &aq_params);
+    }
+    REQUIRE_CMP(level, ==, PL_QUEUE_QUALITY_FULL, "d");
+    REQUIRE(aq_params.frame_mixer == mix_params.frame_mixer);
+
     pl_queue_destroy(&queue);
 
+    // Test prewarming, which must leave the target untouched
+    printf("testing renderer prewarming\n");
+    pl_renderer_flush_cache(rr);
+    pl_tex_clear_ex(gpu, fbo, (union pl_clear_color){0});
+    REQUIRE(pl_renderer_prewarm(rr, &image, &target, &mix_params));
+    REQUIRE(pl_renderer_prewarm(rr, &image, &target, NULL));
+    if (fbo->params.host_readable && fbo->params.format->texel_size == sizeof(float)) {
+        static float fbo_data[height][width];
+        REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+            .tex = fbo,
+            .ptr = fbo_data,
+        )));
+        for (int y = 0; y < height; y++) {
+            for (int x = 0; x < width; x++)
+                REQUIRE_CMP(fbo_data[y][x], ==, 0.0f, "f");
+        }
+    }
+
+    // Test per-frame statistics, which must account for exactly the passes
+    // reported to the info callback
+    struct pl_render_frame_stats stats, sum = {0};
+    struct pl_render_params stats_params = pl_render_default_params;
+    stats_params.info_callback = sum_frame_stats;
+    stats_params.info_priv = &sum;
+    REQUIRE(pl_render_image(rr, &image, &target, &stats_params));
+    REQUIRE(pl_renderer_get_frame_stats(rr, &stats));
+    REQUIRE_CMP(stats.passes, >, 0, "d");
+    REQUIRE_CMP(stats.passes, ==, sum.passes, "d");
+    REQUIRE_CMP(stats.gpu_time, ==, sum.gpu_time, PRIu64);
+    REQUIRE_CMP(stats.ops[PL_RENDER_OP_OUTPUT].passes, >, 0, "d");
+    for (int i = 0; i < PL_RENDER_OP_COUNT; i++) {
+        REQUIRE(pl_render_op_name(i));
+        REQUIRE_CMP(stats.ops[i].passes, <=, stats.passes, "d");
+        REQUIRE_CMP(stats.ops[i].fbo_bytes, <=, stats.fbo_bytes, "zu");
+    }
+
+    // Test reuse of deterministic hook outputs for repeated frames
+    int hook_calls = 0;
+    const struct pl_hook *hook = &(struct pl_hook) {
+        .stages = PL_HOOK_LUMA_INPUT,
+        .input = PL_HOOK_SIG_TEX,
+        .priv = &hook_calls,
+        .hook = counting_hook,
+        .signature = 0x1234,
+        .deterministic = true,
+    };
+
+    image.signature = 0xdead;
+    params = pl_render_default_params;
+    params.hooks = &hook;
+    params.num_hooks = 1;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE_CMP(hook_calls, ==, 1, "d");
+
+    // Changing the target invalidates the frame cache, but not the input
+    // stage hook output
+    target.color = pl_color_space_bt709;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE_CMP(hook_calls, ==, 1, "d");
+
+    image.signature = 0xbeef;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE_CMP(hook_calls, ==, 2, "d");
+    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+    target.color = pl_color_space_srgb;
+    image.signature = 0;
+    params = pl_render_default_params;
+
 error:
     pl_renderer_destroy(&rr);
     pl_tex_destroy(gpu, &img_tex);
+    pl_tex_destroy(gpu, &ol_tex);
     pl_tex_destroy(gpu, &fbo);
 }
 
@@ -1570,36 +2777,46 @@ static void pl_ycbcr_tests(pl_gpu gpu)
         target.planes[i].texture = dst_tex[i];
     }
 
-    REQUIRE(pl_render_image(rr, &img, &target, &(struct pl_render_params) {
-        .num_hooks = 1,
-        .hooks = &(const struct pl_hook *){&(struct pl_hook) {
-            // Forces chroma merging, to test the chroma merging code
-            .stages = PL_HOOK_CHROMA_INPUT,
-            .hook = noop_hook,
-        }},
-    }));
-    REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
-
     size_t buf_size = data[0].height * data[0].row_stride;
     dst_buffer = malloc(buf_size);
     if (!dst_buffer)
         goto error;
 
-    for (int i = 0; i < 3; i++) {
-        memset(dst_buffer, 0xAA, buf_size);
-        REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
-            .tex = dst_tex[i],
-            .ptr = dst_buffer,
-            .row_pitch = data[i].row_stride,
-        }));
+    const struct pl_render_params rparams[] = {
+        {
+            .num_hooks = 1,
+            .hooks = &(const struct pl_hook *){&(struct pl_hook) {
+                // Forces chroma merging, to test the chroma merging code
+                .stages = PL_HOOK_CHROMA_INPUT,
+                .hook = noop_hook,
+            }},
+        },
+        {
+            // No hooks and a builtin scaler, to test the fused path
+            .upscaler = &pl_filter_bilinear,
+        },
+    };
 
-        for (int y = 0; y < data[i].height; y++) {
-            for (int x = 0; x < data[i].width; x++) {
-                size_t off = y * data[i].row_stride + x * data[i].pixel_stride;
-                uint16_t *src_pixel = (uint16_t *) &src_buffer[i][off];
-                uint16_t *dst_pixel = (uint16_t *) &dst_buffer[off];
-                int diff = abs((int) *src_pixel - (int) *dst_pixel);
-                REQUIRE_CMP(diff, <=, 50, "d"); // a little under 0.1%
+    for (int n = 0; n < PL_ARRAY_SIZE(rparams); n++) {
+        REQUIRE(pl_render_image(rr, &img, &target, &rparams[n]));
+        REQUIRE(pl_renderer_get_errors(rr).errors == PL_RENDER_ERR_NONE);
+
+        for (int i = 0; i < 3; i++) {
+            memset(dst_buffer, 0xAA, buf_size);
+            REQUIRE(pl_tex_download(gpu, &(struct pl_tex_transfer_params) {
+                .tex = dst_tex[i],
+                .ptr = dst_buffer,
+                .row_pitch = data[i].row_stride,
+            }));
+
+            for (int y = 0; y < data[i].height; y++) {
+                for (int x = 0; x < data[i].width; x++) {
+                    size_t off = y * data[i].row_stride + x * data[i].pixel_stride;
+                    uint16_t *src_pixel = (uint16_t *) &src_buffer[i][off];
+                    uint16_t *dst_pixel = (uint16_t *) &dst_buffer[off];
+                    int diff = abs((int) *src_pixel - (int) *dst_pixel);
+                    REQUIRE_CMP(diff, <=, 50, "d"); // a little under 0.1%
+                }
             }
         }
     }
@@ -1716,11 +2933,30 @@ static void pl_test_host_ptr(pl_gpu gpu)
 #endif // unix
 }
 
+static void pl_test_memory_budget(pl_gpu gpu)
+{
+    struct pl_gpu_memory_budget budget;
+    if (!pl_gpu_get_memory_budget(gpu, &budget)) {
+        REQUIRE_CMP(budget.num_heaps, ==, 0, "d");
+        return;
+    }
+
+    REQUIRE_CMP(budget.num_heaps, >, 0, "d");
+    REQUIRE_CMP(budget.num_heaps, <=, PL_GPU_MAX_HEAPS, "d");
+    for (int i = 0; i < budget.num_heaps; i++) {
+        const struct pl_gpu_heap_budget *heap = &budget.heaps[i];
+        REQUIRE_CMP(heap->size, >, 0, "zu");
+        REQUIRE_CMP(heap->budget, <=, heap->size, "zu");
+    }
+}
+
 static void gpu_shader_tests(pl_gpu gpu)
 {
+    pl_test_memory_budget(gpu);
     pl_buffer_tests(gpu);
     pl_texture_tests(gpu);
     pl_planar_tests(gpu);
+    pl_packed_tests(gpu);
     pl_shader_tests(gpu);
     pl_scaler_tests(gpu);
     pl_render_tests(gpu);
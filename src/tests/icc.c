@@ -102,5 +102,20 @@ int main()
     REQUIRE_CMP(icc->csp.primaries, ==, PL_COLOR_PRIM_BT_2020, "u");
     pl_icc_close(&icc);
 
+    // Detection results must round-trip through the cache
+    pl_cache cache = pl_cache_create(pl_cache_params( .log = log ));
+    struct pl_icc_params params = pl_icc_default_params;
+    params.cache = cache;
+    icc = pl_icc_open(log, &TEST_PROFILE(DisplayP3_v2_micro_icc), &params);
+    REQUIRE_CMP(pl_cache_objects(cache), ==, 1, "d");
+    pl_icc_object cached = pl_icc_open(log, &TEST_PROFILE(DisplayP3_v2_micro_icc), &params);
+    REQUIRE_CMP(pl_cache_objects(cache), ==, 1, "d");
+    REQUIRE(pl_color_space_equal(&icc->csp, &cached->csp));
+    REQUIRE_FEQ(icc->gamma, cached->gamma, 1e-6);
+    REQUIRE_CMP(icc->params.intent, ==, cached->params.intent, "d");
+    pl_icc_close(&cached);
+    pl_icc_close(&icc);
+    pl_cache_destroy(&cache);
+
     pl_log_destroy(&log);
 }
@@ -79,6 +79,37 @@ int main()
         pl_lut_free(&lut);
     }
 
+    // Large enough to be split into multiple chunks
+    const int size = 48;
+    pl_str big = {0};
+    pl_str_append_asprintf(NULL, &big, "LUT_3D_SIZE %d\nDOMAIN_MAX 2 2 2\n", size);
+    for (int i = 0; i < size * size * size; i++) {
+        pl_str_append_asprintf(NULL, &big, "%f %f %f\n", (i % size) / 32.0,
+                               (i / size % size) / 32.0, (i / size / size) / 32.0);
+    }
+
+    pl_cache cache = pl_cache_create(pl_cache_params( .log = log ));
+    for (int i = 0; i < 2; i++) {
+        struct pl_custom_lut *lut;
+        lut = pl_lut_parse_cube_ex(log, cache, (char *) big.buf, big.len);
+        REQUIRE(lut);
+        REQUIRE_CMP(pl_cache_objects(cache), ==, 1, "d");
+        for (int n = 0; n < size * size * size; n += 997) {
+            const float r = (n % size) / 64.0, g = (n / size % size) / 64.0,
+                        b = (n / size / size) / 64.0;
+            REQUIRE_FEQ(lut->data[3 * n + 0], r, 1e-6);
+            REQUIRE_FEQ(lut->data[3 * n + 1], g, 1e-6);
+            REQUIRE_FEQ(lut->data[3 * n + 2], b, 1e-6);
+        }
+        pl_lut_free(&lut);
+    }
+    pl_cache_destroy(&cache);
+
+    REQUIRE(!pl_lut_parse_cube(log, (char *) big.buf, big.len - 10));
+    big.buf[big.len / 2] = 'x';
+    REQUIRE(!pl_lut_parse_cube(log, (char *) big.buf, big.len));
+    pl_free(big.buf);
+
     pl_shader_obj_destroy(&obj);
     pl_shader_free(&sh);
     pl_gpu_dummy_destroy(&gpu);
@@ -0,0 +1,356 @@
+#include "tests.h"
+#include "stub_gpu.h"
+
+#include <libplacebo/cache.h>
+#include <libplacebo/dummy.h>
+#include <libplacebo/options.h>
+#include <libplacebo/renderer.h>
+
+// Performance regression corpus for the shader generator. Every value of
+// every option in `pl_option_list` is loaded on top of each built-in preset,
+// and the result used to render a frame on the dummy GPU. The test fails if
+// any of these combinations logs an error or exceeds the budgets below,
+// which are meant to catch pathological blowups rather than small
+// regressions. Wall clock time per frame is always reported, but only
+// checked if a budget (in ms) is given via $RENDER_BUDGET_FRAME_MS, since it
+// depends heavily on the machine and its load.
+enum {
+    // Image configuration
+    SRC_W           = 1280,
+    SRC_H           = 720,
+    DST_W           = 1920,
+    DST_H           = 1080,
+
+    // Number of (warm) frames to average each measurement over
+    FRAMES          = 2,
+
+    // Budgets per frame, for any combination
+    MAX_PASSES      = 32,
+    MAX_GLSL_BYTES  = 512 << 10,
+    MAX_FBOS        = 16,
+};
+
+static double max_frame_ms;
+
+static const char * const presets[] = {
+    "preset=fast",
+    "preset=default",
+    "preset=high_quality",
+};
+
+// Valid values of string options are discovered by deliberately failing to
+// set them, and collecting the list of alternatives from the error message
+static PL_ARRAY(char *) values;
+
+static void add_value(const char *val)
+{
+    PL_ARRAY_APPEND(NULL, values, pl_strdup0(NULL, pl_str0(val)));
+}
+
+static void add_number(const char *fmt, double val)
+{
+    char buf[32];
+    snprintf(buf, sizeof(buf), fmt, val);
+    add_value(buf);
+}
+
+// Any error logged while rendering fails the combination
+static int errors;
+
+static void count_errors(void *priv, enum pl_log_level level, const char *msg)
+{
+    if (level <= PL_LOG_ERR)
+        errors++;
+    pl_log_simple(priv, level, msg);
+}
+
+static void collect_values(void *priv, enum pl_log_level level, const char *msg)
+{
+    if (strncmp(msg, "  ", 2) == 0)
+        add_value(msg + 2);
+}
+
+static void list_values(pl_options probe, pl_opt opt)
+{
+    for (int i = 0; i < values.num; i++)
+        pl_free(values.elem[i]);
+    values.num = 0;
+
+    switch (opt->type) {
+    case PL_OPT_BOOL:
+        add_value("no");
+        add_value("yes");
+        return;
+    case PL_OPT_INT:
+    case PL_OPT_FLOAT:;
+        // Only the extremes are interesting, and only if there are any
+        const char *fmt = opt->type == PL_OPT_INT ? "%.0f" : "%.9g";
+        if (opt->min || opt->max) {
+            add_number(fmt, opt->min);
+            add_number(fmt, opt->max);
+        }
+        return;
+    case PL_OPT_STRING:
+        REQUIRE(!pl_options_set_str(probe, opt->key, "?"));
+        for (int i = 0; i < values.num; i++) {
+            // Custom scalers are invalid without a kernel
+            if (strcmp(values.elem[i], "custom") == 0) {
+                pl_free(values.elem[i]);
+                values.elem[i] = pl_asprintf(NULL, "custom,%s_kernel=triangle",
+                                             opt->key);
+            }
+        }
+        return;
+    case PL_OPT_TYPE_COUNT:
+        break;
+    }
+
+    pl_unreachable();
+}
+
+struct stats {
+    double passes;
+    double glsl_bytes;
+    int fbos;
+    double frame_ms;
+};
+
+struct worst {
+    struct stats stats;
+    char desc[3][128]; // per field of `struct stats`, except `frame_ms`
+    char desc_ms[128];
+};
+
+static bool render_frame(pl_renderer rr, pl_tex planes[2], pl_tex fbo,
+                         const struct pl_render_params *params)
+{
+    struct pl_frame image = {
+        .num_planes = 2,
+        .planes     = {
+            {
+                .texture = planes[0],
+                .components = 1,
+                .component_mapping = {PL_CHANNEL_Y},
+            }, {
+                .texture = planes[1],
+                .components = 2,
+                .component_mapping = {PL_CHANNEL_U, PL_CHANNEL_V},
+            },
+        },
+        .repr   = {
+            .sys    = PL_COLOR_SYSTEM_BT_2020_NC,
+            .levels = PL_COLOR_LEVELS_LIMITED,
+        },
+        .color  = pl_color_space_hdr10,
+    };
+
+    pl_frame_set_chroma_location(&image, PL_CHROMA_LEFT);
+    image.color.hdr = pl_hdr_metadata_hdr10;
+
+    const struct pl_frame target = {
+        .num_planes = 1,
+        .planes     = {{ .texture = fbo, .components = 4,
+                         .component_mapping = {0, 1, 2, 3} }},
+        .repr       = pl_color_repr_rgb,
+        .color      = pl_color_space_srgb,
+    };
+
+    return pl_render_image(rr, &image, &target, params);
+}
+
+static bool measure(pl_gpu gpu, pl_tex planes[2], pl_tex fbo,
+                    const struct pl_render_params *params, struct stats *stats)
+{
+    pl_renderer rr = pl_renderer_create(gpu->log, gpu);
+    REQUIRE(rr);
+
+    // The first frame creates all passes, LUTs etc.
+    const int fbos_start = stub_stats.fbos;
+    bool ok = render_frame(rr, planes, fbo, params);
+
+    stub_stats.passes_executed = stub_stats.glsl_executed = 0;
+    pl_clock_t start = pl_clock_now();
+    for (int i = 0; i < FRAMES; i++) {
+        const int passes_start = stub_stats.passes_executed;
+        if (!render_frame(rr, planes, fbo, params)) {
+            ok = false;
+            continue;
+        }
+
+        // Every executed pass must show up in the renderer's frame stats
+        struct pl_render_frame_stats fs;
+        REQUIRE(pl_renderer_get_frame_stats(rr, &fs));
+        const int passes = stub_stats.passes_executed - passes_start;
+        REQUIRE_CMP(fs.passes, ==, passes, "d");
+        REQUIRE_CMP(fs.gpu_time, >=, (uint64_t) fs.passes * STUB_PASS_NS, PRIu64);
+        REQUIRE_CMP(fs.passes, >, 0, "d");
+    }
+
+    *stats = (struct stats) {
+        .passes     = (double) stub_stats.passes_executed / FRAMES,
+        .glsl_bytes = (double) stub_stats.glsl_executed / FRAMES,
+        .fbos       = stub_stats.fbos - fbos_start,
+        .frame_ms   = 1e3 * pl_clock_diff(pl_clock_now(), start) / FRAMES,
+    };
+
+    pl_renderer_destroy(&rr);
+    REQUIRE_CMP(stub_stats.fbos, ==, fbos_start, "d");
+    return ok;
+}
+
+static bool check(const struct stats *s, const char *desc)
+{
+    bool ok = true;
+#define BUDGET(field, max, fmt)                                                 \
+    if (s->field > max) {                                                       \
+        fprintf(stderr, "'%s' exceeds budget: " #field " = " fmt " > %d\n",    \
+                desc, s->field, max);                                           \
+        ok = false;                                                             \
+    }
+
+    BUDGET(passes,      MAX_PASSES,     "%.1f");
+    BUDGET(glsl_bytes,  MAX_GLSL_BYTES, "%.0f");
+    BUDGET(fbos,        MAX_FBOS,       "%d");
+#undef BUDGET
+
+    if (max_frame_ms && s->frame_ms > max_frame_ms) {
+        fprintf(stderr, "'%s' exceeds budget: frame_ms = %.3f > %.3f\n",
+                desc, s->frame_ms, max_frame_ms);
+        ok = false;
+    }
+    return ok;
+}
+
+static void update_worst(struct worst *w, const struct stats *s, const char *desc)
+{
+#define WORST(field, idx)                                                       \
+    if (s->field > w->stats.field) {                                            \
+        w->stats.field = s->field;                                              \
+        snprintf(w->desc[idx], sizeof(w->desc[idx]), "%s", desc);               \
+    }
+
+    WORST(passes, 0);
+    WORST(glsl_bytes, 1);
+    WORST(fbos, 2);
+#undef WORST
+
+    if (s->frame_ms > w->stats.frame_ms) {
+        w->stats.frame_ms = s->frame_ms;
+        snprintf(w->desc_ms, sizeof(w->desc_ms), "%s", desc);
+    }
+}
+
+int main()
+{
+    setbuf(stdout, NULL);
+    setbuf(stderr, NULL);
+
+    pl_log log = pl_log_create(PL_API_VER, pl_log_params(
+        .log_cb     = count_errors,
+        .log_level  = PL_LOG_ERR,
+    ));
+
+    pl_log probe_log = pl_log_create(PL_API_VER, pl_log_params(
+        .log_cb     = collect_values,
+        .log_level  = PL_LOG_ERR,
+    ));
+
+    const char *env = getenv("RENDER_BUDGET_FRAME_MS");
+    max_frame_ms = env ? atof(env) : 0.0;
+
+    pl_gpu gpu = stub_gpu_create(log);
+    pl_cache cache = pl_cache_create(pl_cache_params( .log = log ));
+    pl_gpu_set_cache(gpu, cache);
+    pl_options opts = pl_options_alloc(log);
+    pl_options probe = pl_options_alloc(probe_log);
+
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_FLOAT, 4, 16, 16, PL_FMT_CAP_RENDERABLE);
+    pl_fmt fmt_y = pl_find_fmt(gpu, PL_FMT_UNORM, 1, 8, 8, PL_FMT_CAP_SAMPLEABLE);
+    pl_fmt fmt_uv = pl_find_fmt(gpu, PL_FMT_UNORM, 2, 8, 8, PL_FMT_CAP_SAMPLEABLE);
+    REQUIRE(fmt && fmt_y && fmt_uv);
+
+    pl_tex planes[2] = {
+        pl_tex_create(gpu, pl_tex_params(
+            .format     = fmt_y,
+            .w          = SRC_W,
+            .h          = SRC_H,
+            .sampleable = true,
+        )),
+        pl_tex_create(gpu, pl_tex_params(
+            .format     = fmt_uv,
+            .w          = SRC_W / 2,
+            .h          = SRC_H / 2,
+            .sampleable = true,
+        )),
+    };
+
+    pl_tex fbo = pl_tex_create(gpu, pl_tex_params(
+        .format     = fmt,
+        .w          = DST_W,
+        .h          = DST_H,
+        .renderable = true,
+        .storable   = !!(fmt->caps & PL_FMT_CAP_STORABLE),
+    ));
+    REQUIRE(planes[0] && planes[1] && fbo);
+
+    struct worst worst = {0};
+    int combinations = 0, failed = 0;
+    char desc[128];
+
+    for (int n = 0; n < PL_ARRAY_SIZE(presets); n++) {
+        pl_options_reset(opts, NULL);
+        REQUIRE(pl_options_load(opts, presets[n]));
+        struct stats base;
+        errors = 0;
+        REQUIRE(measure(gpu, planes, fbo, &opts->params, &base));
+        REQUIRE_CMP(errors, ==, 0, "d");
+        printf("'%s':\t%5.1f passes, %7.0f bytes glsl, %2d fbos, %7.3f ms/frame\n",
+               presets[n], base.passes, base.glsl_bytes, base.fbos, base.frame_ms);
+
+        for (pl_opt opt = pl_option_list; opt->key; opt++) {
+            if (opt->deprecated)
+                continue;
+
+            list_values(probe, opt);
+            for (int i = 0; i < values.num; i++) {
+                snprintf(desc, sizeof(desc), "%s,%s=%s", presets[n], opt->key,
+                         values.elem[i]);
+
+                pl_options_reset(opts, NULL);
+                REQUIRE(pl_options_load(opts, desc));
+                struct stats stats;
+                errors = 0;
+                bool ok = measure(gpu, planes, fbo, &opts->params, &stats);
+                if (!ok || errors) {
+                    fprintf(stderr, "'%s' failed rendering\n", desc);
+                    failed++;
+                    continue;
+                }
+                update_worst(&worst, &stats, desc);
+                failed += !check(&stats, desc);
+                combinations++;
+            }
+        }
+    }
+
+    printf("= Tested %d combinations =\n", combinations);
+    printf("most passes:\t%5.1f for '%s'\n", worst.stats.passes, worst.desc[0]);
+    printf("most glsl:\t%7.0f bytes for '%s'\n", worst.stats.glsl_bytes, worst.desc[1]);
+    printf("most fbos:\t%2d for '%s'\n", worst.stats.fbos, worst.desc[2]);
+    printf("slowest:\t%7.3f ms/frame for '%s'\n", worst.stats.frame_ms, worst.desc_ms);
+    REQUIRE_CMP(failed, ==, 0, "d");
+
+    for (int i = 0; i < values.num; i++)
+        pl_free(values.elem[i]);
+    pl_free(values.elem);
+    pl_tex_destroy(gpu, &planes[0]);
+    pl_tex_destroy(gpu, &planes[1]);
+    pl_tex_destroy(gpu, &fbo);
+    pl_options_free(&probe);
+    pl_options_free(&opts);
+    pl_gpu_dummy_destroy(&gpu);
+    pl_cache_destroy(&cache);
+    pl_log_destroy(&probe_log);
+    pl_log_destroy(&log);
+    return 0;
+}
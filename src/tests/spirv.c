@@ -0,0 +1,67 @@
+#include "tests.h"
+#include "glsl/spirv.h"
+
+#define NUM_JOBS 32
+
+int main()
+{
+    pl_log log = pl_test_logger();
+    struct pl_spirv_version spirv_ver = {
+        .spv_version = PL_SPV_VERSION(1, 0),
+        .env_version = pl_spirv_version_to_vulkan(PL_SPV_VERSION(1, 0)),
+    };
+
+    pl_spirv spirv = pl_spirv_create(log, spirv_ver, false);
+    if (!spirv)
+        return SKIP;
+
+    const struct pl_glsl_version glsl = {
+        .version = 450,
+        .vulkan = true,
+        .compute = true,
+        .max_group_size = {1024, 1024, 64},
+    };
+
+    void *tmp = pl_tmp(NULL);
+    struct pl_spirv_job jobs[NUM_JOBS];
+    for (int i = 0; i < NUM_JOBS; i++) {
+        jobs[i] = (struct pl_spirv_job) {
+            .stage = GLSL_SHADER_COMPUTE,
+            .shader = pl_asprintf(tmp,
+                "#version 450\n"
+                "layout(local_size_x = %d) in;\n"
+                "layout(std430, binding = 0) buffer B { float data[]; };\n"
+                "void main() { data[gl_GlobalInvocationID.x] *= %d.0; }\n",
+                1 << (i % 8), i),
+        };
+    }
+
+    // Concurrently compiled results must match serially compiled ones
+    REQUIRE(pl_spirv_compile_glsl_batch(spirv, tmp, glsl, jobs, NUM_JOBS));
+    for (int i = 0; i < NUM_JOBS; i++) {
+        pl_str ref = pl_spirv_compile_glsl(spirv, tmp, glsl, jobs[i].stage,
+                                           jobs[i].shader);
+        REQUIRE(ref.len);
+        REQUIRE(pl_str_equals(jobs[i].spirv, ref));
+    }
+
+    // A single broken shader only fails its own job
+    jobs[NUM_JOBS / 2].shader = "#version 450\nvoid main() { syntax error }\n";
+    REQUIRE(!pl_spirv_compile_glsl_batch(spirv, tmp, glsl, jobs, NUM_JOBS));
+    for (int i = 0; i < NUM_JOBS; i++)
+        REQUIRE_CMP(!jobs[i].spirv.len, ==, i == NUM_JOBS / 2, "d");
+
+    // Performance-optimized SPIR-V must not share cache entries with the
+    // size-optimized SPIR-V, unless the compiler ignores the setting
+    pl_spirv perf = pl_spirv_create(log, spirv_ver, true);
+    REQUIRE(perf);
+    if (perf->opt_performance != spirv->opt_performance)
+        REQUIRE_CMP(perf->signature, !=, spirv->signature, PRIu64);
+    REQUIRE(pl_spirv_compile_glsl(perf, tmp, glsl, jobs[0].stage,
+                                  jobs[0].shader).len);
+
+    pl_free(tmp);
+    pl_spirv_destroy(&perf);
+    pl_spirv_destroy(&spirv);
+    pl_log_destroy(&log);
+}
@@ -76,6 +76,14 @@ int main()
     pl_str out;
     REQUIRE(pl_str_decode_hex(tmp, null, &out) && is_empty(out));
     REQUIRE(!pl_str_decode_hex(tmp, pl_str0("invalid"), &out));
+    REQUIRE(pl_str_decode_hex(tmp, pl_str0("00112233445566778899AaBbCcDdEeFf\n"
+                                           "0 1 23\t4567"), &out));
+    REQUIRE_CMP(out.len, ==, 20, "zu");
+    REQUIRE_MEMEQ(out.buf, "\x00\x11\x22\x33\x44\x55\x66\x77\x88\x99"
+                           "\xaa\xbb\xcc\xdd\xee\xff\x01\x23\x45\x67", 20);
+    REQUIRE(!pl_str_decode_hex(tmp, pl_str0("00112233445566778899aabbccddeegg"), &out));
+    REQUIRE(!pl_str_decode_hex(tmp, pl_str0("00112233445566778899aabbccddeef\xc6"), &out));
+    REQUIRE(!pl_str_decode_hex(tmp, pl_str0("00112233445566778899aabbccddeeff0"), &out));
 
     REQUIRE(pl_str_equals(null, null));
     REQUIRE(pl_str_equals(null, empty));
@@ -121,6 +129,19 @@ int main()
     REQUIRE(!pl_str_parse_uint(test, &u));
     REQUIRE(!pl_str_parse_uint(empty, &u));
 
+    float fs[4];
+    pl_str floats = pl_str0("  1.5 -2\t\n0.25e2\r\n0.000000000000000001 junk");
+    REQUIRE_CMP(pl_str_parse_floats(&floats, fs, 2), ==, 2, "zu");
+    REQUIRE_FEQ(fs[0], 1.5f, 1e-8);
+    REQUIRE_FEQ(fs[1], -2.0f, 1e-8);
+    REQUIRE_CMP(pl_str_parse_floats(&floats, fs, 4), ==, 2, "zu");
+    REQUIRE_FEQ(fs[0], 25.0f, 1e-8);
+    REQUIRE_FEQ(fs[1], 1e-18f, 1e-8);
+    REQUIRE(pl_str_equals0(floats, "junk"));
+    REQUIRE_CMP(pl_str_parse_floats(&floats, fs, 4), ==, 0, "zu");
+    floats = null;
+    REQUIRE_CMP(pl_str_parse_floats(&floats, fs, 4), ==, 0, "zu");
+
     pl_str_builder builder = pl_str_builder_alloc(tmp);
     pl_str_builder_const_str(builder, "hello");
     pl_str_builder_str(builder, pl_str0("world"));
@@ -134,6 +155,18 @@ int main()
     res = pl_str_builder_exec(builder);
     REQUIRE(pl_str_equals0(res, "foo 123 bar 56 bat quack baz 3735928559 test123"));
 
+    // Rendered output is re-used by repeated execs and concatenation
+    REQUIRE(pl_str_builder_exec(builder).buf == res.buf);
+    pl_str_builder other = pl_str_builder_alloc(tmp);
+    pl_str_builder_const_str(other, "<");
+    pl_str_builder_concat(other, builder);
+    pl_str_builder_printf_c(other, ">%d", 1);
+    res = pl_str_builder_exec(other);
+    REQUIRE(pl_str_equals0(res, "<foo 123 bar 56 bat quack baz 3735928559 test123>1"));
+    pl_str_builder_const_str(other, "!");
+    res = pl_str_builder_exec(other);
+    REQUIRE(pl_str_equals0(res, "<foo 123 bar 56 bat quack baz 3735928559 test123>1!"));
+
     pl_free(tmp);
     return 0;
 }
@@ -0,0 +1,109 @@
+#pragma once
+
+#include "tests.h"
+#include "gpu.h"
+
+#include <libplacebo/dummy.h>
+
+// The dummy GPU refuses to create passes, so replace its pass functions by
+// stubs that don't execute anything. This allows driving the full shader
+// generation and dispatch machinery without a device, while keeping track of
+// the amount of work done. Every timed pass reports a fixed GPU time of
+// STUB_PASS_NS, and renderable textures are counted to track FBO usage.
+enum { STUB_PASS_NS = 1000 };
+
+static struct {
+    size_t glsl_created;    // GLSL bytes of all passes created
+    size_t glsl_executed;   // GLSL bytes of all passes executed
+    int passes_executed;
+    int fbos;               // number of live renderable textures
+} stub_stats;
+
+struct pl_timer_t {
+    uint64_t ts;
+};
+
+struct stub_pass {
+    struct pl_pass_t pass; // must be first
+    size_t glsl_bytes;
+};
+
+static pl_tex (*stub_dummy_tex_create)(pl_gpu, const struct pl_tex_params *);
+static void (*stub_dummy_tex_destroy)(pl_gpu, pl_tex);
+
+static pl_pass stub_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
+{
+    struct stub_pass *p = pl_zalloc_ptr(NULL, p);
+    p->pass.params = pl_pass_params_copy(p, params);
+    p->glsl_bytes = strlen(params->glsl_shader);
+    if (params->vertex_shader)
+        p->glsl_bytes += strlen(params->vertex_shader);
+    stub_stats.glsl_created += p->glsl_bytes;
+    return &p->pass;
+}
+
+static void stub_pass_destroy(pl_gpu gpu, pl_pass pass)
+{
+    pl_free((void *) pass);
+}
+
+static void stub_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
+{
+    const struct stub_pass *p = (const struct stub_pass *) params->pass;
+    stub_stats.glsl_executed += p->glsl_bytes;
+    stub_stats.passes_executed++;
+    if (params->timer)
+        params->timer->ts = STUB_PASS_NS;
+}
+
+static pl_timer stub_timer_create(pl_gpu gpu)
+{
+    pl_timer timer = pl_zalloc_ptr(NULL, timer);
+    return timer;
+}
+
+static void stub_timer_destroy(pl_gpu gpu, pl_timer timer)
+{
+    pl_free(timer);
+}
+
+static uint64_t stub_timer_query(pl_gpu gpu, pl_timer timer)
+{
+    uint64_t ts = timer->ts;
+    timer->ts = 0;
+    return ts;
+}
+
+static pl_tex stub_tex_create(pl_gpu gpu, const struct pl_tex_params *params)
+{
+    pl_tex tex = stub_dummy_tex_create(gpu, params);
+    if (tex && params->renderable)
+        stub_stats.fbos++;
+    return tex;
+}
+
+static void stub_tex_destroy(pl_gpu gpu, pl_tex tex)
+{
+    if (tex->params.renderable)
+        stub_stats.fbos--;
+    stub_dummy_tex_destroy(gpu, tex);
+}
+
+static pl_gpu stub_gpu_create(pl_log log)
+{
+    pl_gpu gpu = pl_gpu_dummy_create(log, NULL);
+    REQUIRE(gpu);
+
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    stub_dummy_tex_create = impl->tex_create;
+    stub_dummy_tex_destroy = impl->tex_destroy;
+    impl->tex_create = stub_tex_create;
+    impl->tex_destroy = stub_tex_destroy;
+    impl->pass_create = stub_pass_create;
+    impl->pass_destroy = stub_pass_destroy;
+    impl->pass_run = stub_pass_run;
+    impl->timer_create = stub_timer_create;
+    impl->timer_destroy = stub_timer_destroy;
+    impl->timer_query = stub_timer_query;
+    return gpu;
+}
@@ -1,5 +1,6 @@
 #include "tests.h"
 #include "log.h"
+#include "tone_mapping.h"
 
 #include <libplacebo/gamut_mapping.h>
 #include <libplacebo/tone_mapping.h>
@@ -85,6 +86,20 @@ int main()
         REQUIRE_FEQ(x, lut[j], 1e-5);
     }
 
+    // Test that the closed-form spline matches its LUT
+    struct pl_tone_map_curve curve;
+    REQUIRE(pl_tone_map_curve(&curve, &params));
+    for (int j = 0; j < PL_ARRAY_SIZE(lut); j++) {
+        const float *k = curve.k;
+        float x = j / (PL_ARRAY_SIZE(lut) - 1.0f);
+        x = PL_MIX(params.input_min, params.input_max, x) - k[0];
+        x = x > 0 ? ((k[4] * x + k[5]) * x + k[6]) * x : (k[2] * x + k[3]) * x;
+        REQUIRE_FEQ(x + k[1], lut[j], 1e-5);
+    }
+
+    params.function = &pl_tone_map_st2094_40;
+    REQUIRE(!pl_tone_map_curve(&curve, &params));
+
     // Test some gamut mapping methods
     for (int i = 0; i < pl_num_gamut_map_functions; i++) {
         static const float min_rgb = 0.1f, max_rgb = PL_COLOR_SDR_WHITE;
@@ -3,9 +3,83 @@
 #include "gpu_tests.h"
 #include "vulkan/command.h"
 #include "vulkan/gpu.h"
+#include "pl_thread.h"
 
 #include <libplacebo/vulkan.h>
 
+struct interop_state {
+    enum pl_handle_type handle_type;
+    int calls;
+};
+
+static bool interop_process(void *priv, const struct pl_vulkan_interop_frame *frame)
+{
+    struct interop_state *st = priv;
+    REQUIRE(frame->reimport);
+    REQUIRE_HANDLE(frame->in->shared_mem, st->handle_type);
+    REQUIRE_HANDLE(frame->out->shared_mem, st->handle_type);
+    REQUIRE_CMP(frame->signal_value, >, frame->wait_value, PRIu64);
+    st->calls++;
+
+    // There's no external API to signal the semaphore here, so fail the
+    // hook instead, which must not deadlock or break rendering
+    return false;
+}
+
+static void vulkan_interop_hook_tests(pl_gpu gpu, enum pl_handle_type handle_type)
+{
+    if (!(gpu->export_caps.tex & handle_type) || !(gpu->export_caps.sync & handle_type))
+        return;
+
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 4, 16, 16, PL_FMT_CAP_RENDERABLE |
+                             PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_LINEAR);
+    if (!fmt)
+        return;
+
+    struct interop_state st = { .handle_type = handle_type };
+    const struct pl_hook *hook = pl_vulkan_interop_hook(gpu, pl_vulkan_interop_hook_params(
+        .stages         = PL_HOOK_RGB,
+        .handle_type    = handle_type,
+        .process        = interop_process,
+        .priv           = &st,
+    ));
+    REQUIRE(hook);
+
+    pl_tex src = pl_tex_create(gpu, pl_tex_params(
+        .w = 32, .h = 32, .format = fmt, .sampleable = true, .renderable = true,
+    ));
+    pl_tex dst = pl_tex_create(gpu, pl_tex_params(
+        .w = 64, .h = 64, .format = fmt, .renderable = true,
+    ));
+    REQUIRE(src && dst);
+    pl_tex_clear(gpu, src, (float[4]){ 0.5, 0.5, 0.5, 1.0 });
+
+    struct pl_frame image = {
+        .num_planes = 1,
+        .planes     = {{ .texture = src, .components = 4,
+                         .component_mapping = {0, 1, 2, 3} }},
+        .repr       = pl_color_repr_rgb,
+        .color      = pl_color_space_srgb,
+    };
+
+    struct pl_frame target = image;
+    target.planes[0].texture = dst;
+
+    pl_renderer rr = pl_renderer_create(gpu->log, gpu);
+    struct pl_render_params params = pl_render_default_params;
+    params.hooks = &hook;
+    params.num_hooks = 1;
+    REQUIRE(pl_render_image(rr, &image, &target, &params));
+    REQUIRE_CMP(st.calls, ==, 1, "d");
+    REQUIRE(pl_renderer_get_errors(rr).errors & PL_RENDER_ERR_HOOKS);
+    pl_renderer_destroy(&rr);
+
+    pl_vulkan_interop_hook_destroy(&hook);
+    REQUIRE(!hook);
+    pl_tex_destroy(gpu, &src);
+    pl_tex_destroy(gpu, &dst);
+}
+
 static void vulkan_interop_tests(pl_vulkan pl_vk,
                                  enum pl_handle_type handle_type)
 {
@@ -68,6 +142,83 @@ static void vulkan_interop_tests(pl_vulkan pl_vk,
         pl_vulkan_sem_destroy(gpu, &sem);
         pl_tex_destroy(gpu, &tex);
     }
+
+    vulkan_interop_hook_tests(gpu, handle_type);
+}
+
+static void download_cb(void *priv)
+{
+    atomic_bool *done = priv;
+    *done = true;
+}
+
+static void vulkan_completion_tests(pl_vulkan pl_vk)
+{
+    pl_gpu gpu = pl_vk->gpu;
+    pl_fmt fmt = pl_find_fmt(gpu, PL_FMT_UNORM, 1, 8, 8, PL_FMT_CAP_HOST_READABLE);
+    if (!fmt)
+        return;
+
+    pl_tex tex = pl_tex_create(gpu, pl_tex_params(
+        .w              = 16,
+        .h              = 16,
+        .format         = fmt,
+        .host_readable  = true,
+    ));
+    REQUIRE(tex);
+
+    // The callback must fire without any further calls into libplacebo
+    uint8_t data[16 * 16];
+    atomic_bool done = false;
+    REQUIRE(pl_tex_download(gpu, pl_tex_transfer_params(
+        .tex        = tex,
+        .ptr        = data,
+        .callback   = download_cb,
+        .priv       = &done,
+    )));
+    pl_gpu_flush(gpu);
+
+    for (int i = 0; i < 1000 && !done; i++)
+        pl_thread_sleep(1e-3);
+    REQUIRE(done);
+
+    pl_tex_destroy(gpu, &tex);
+}
+
+static PL_THREAD_VOID parallel_thread(void *arg)
+{
+    pl_gpu gpu = arg;
+    pl_buffer_tests(gpu);
+    pl_texture_tests(gpu);
+    PL_THREAD_RETURN();
+}
+
+static void vulkan_parallel_tests(pl_vulkan vk)
+{
+    pl_gpu gpu = pl_vulkan_gpu_create(vk);
+    REQUIRE(gpu);
+    REQUIRE(pl_vulkan_get(gpu) == vk);
+
+    // Record on both GPUs concurrently
+    pl_thread thread;
+    REQUIRE(pl_thread_create(&thread, parallel_thread, (void *) gpu) == 0);
+    pl_buffer_tests(vk->gpu);
+    pl_texture_tests(vk->gpu);
+    pl_thread_join(thread);
+
+    REQUIRE(!pl_gpu_is_failed(gpu));
+    pl_gpu_destroy(gpu);
+}
+
+static void compare_formats(pl_gpu gpu, pl_gpu gpu2)
+{
+    REQUIRE_CMP(gpu2->num_formats, ==, gpu->num_formats, "d");
+    for (int n = 0; n < gpu->num_formats; n++) {
+        pl_fmt fmt = gpu->formats[n], fmt2 = gpu2->formats[n];
+        REQUIRE_STREQ(fmt2->name, fmt->name);
+        REQUIRE_CMP(fmt2->caps, ==, fmt->caps, "u");
+        REQUIRE_CMP(fmt2->num_modifiers, ==, fmt->num_modifiers, "d");
+    }
 }
 
 static void vulkan_swapchain_tests(pl_vulkan vk, VkSurfaceKHR surf)
@@ -229,6 +380,7 @@ int main()
         vulkan_interop_tests(vk, PL_HANDLE_WIN32_KMT);
 #endif
         gpu_interop_tests(vk->gpu);
+        vulkan_parallel_tests(vk);
         pl_vulkan_destroy(&vk);
 
         // Re-run the same export/import tests with async queues disabled
@@ -248,6 +400,52 @@ int main()
         gpu_interop_tests(vk->gpu);
         pl_vulkan_destroy(&vk);
 
+        // Re-run the shader tests using the buddy allocator
+        params.buddy_allocator = true;
+        vk = pl_vulkan_create(log, &params);
+        REQUIRE(vk);
+        gpu_shader_tests(vk->gpu);
+        pl_vk_print_heap(vk->gpu, PL_LOG_DEBUG);
+        pl_vulkan_destroy(&vk);
+
+        // Re-run the shader tests with a background completion thread
+        params.buddy_allocator = false;
+        params.completion_thread = true;
+        vk = pl_vulkan_create(log, &params);
+        REQUIRE(vk);
+        gpu_shader_tests(vk->gpu);
+        vulkan_completion_tests(vk);
+        pl_vulkan_destroy(&vk);
+
+        // Re-run the shader tests with load-aware queue selection
+        params.completion_thread = false;
+        params.balance_queues = true;
+        vk = pl_vulkan_create(log, &params);
+        REQUIRE(vk);
+        gpu_shader_tests(vk->gpu);
+        pl_vulkan_destroy(&vk);
+
+        // Make sure cached format probing results reproduce the same formats
+        params.balance_queues = false;
+        params.cache = pl_cache_create(pl_cache_params( .log = log ));
+        vk = pl_vulkan_create(log, &params);
+        REQUIRE(vk);
+        REQUIRE_CMP(pl_cache_objects(params.cache), ==, 1, "d");
+        vk2 = pl_vulkan_create(log, &params);
+        REQUIRE(vk2);
+        compare_formats(vk->gpu, vk2->gpu);
+        pl_vulkan_destroy(&vk2);
+        pl_cache_destroy(&params.cache);
+
+        // Same for formats probed concurrently with device creation
+        params.async_formats = true;
+        vk2 = pl_vulkan_create(log, &params);
+        REQUIRE(vk2);
+        compare_formats(vk->gpu, vk2->gpu);
+        pl_vulkan_destroy(&vk2);
+        pl_vulkan_destroy(&vk);
+        params.async_formats = false;
+
         // Reduce log spam after first tested device
         pl_log_level_update(log, PL_LOG_INFO);
     }
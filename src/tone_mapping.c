@@ -18,8 +18,7 @@
 #include <math.h>
 
 #include "common.h"
-
-#include <libplacebo/tone_mapping.h>
+#include "tone_mapping.h"
 
 #define fclampf(x, lo, hi) fminf(fmaxf(x, lo), hi)
 static void fix_constants(struct pl_tone_map_constants *c)
@@ -108,6 +107,73 @@ void pl_tone_map_params_infer(struct pl_tone_map_params *par)
         par->output_max = fminf(par->output_max, par->input_max);
 }
 
+static const float PQ_M1 = 2610./4096 * 1./4,
+                   PQ_M2 = 2523./4096 * 128,
+                   PQ_C1 = 3424./4096,
+                   PQ_C2 = 2413./4096 * 32,
+                   PQ_C3 = 2392./4096 * 32;
+
+// Batch version of `pl_hdr_rescale`, with the scaling selection hoisted out
+// of the (branch-free, auto-vectorizable) inner loops
+static void rescale_lut(float *lut, int num, enum pl_hdr_scaling from,
+                        enum pl_hdr_scaling to)
+{
+    if (from == to)
+        return;
+
+    // Convert input to PL_HDR_NORM
+    switch (from) {
+    case PL_HDR_PQ:
+        for (int i = 0; i < num; i++) {
+            float x = powf(fmaxf(lut[i], 0.0f), 1.0f / PQ_M2);
+            x = fmaxf(x - PQ_C1, 0.0f) / (PQ_C2 - PQ_C3 * x);
+            lut[i] = powf(x, 1.0f / PQ_M1) * (10000.0f / PL_COLOR_SDR_WHITE);
+        }
+        break;
+    case PL_HDR_NITS:
+        for (int i = 0; i < num; i++)
+            lut[i] = fmaxf(lut[i], 0.0f) / PL_COLOR_SDR_WHITE;
+        break;
+    case PL_HDR_NORM:
+        for (int i = 0; i < num; i++)
+            lut[i] = fmaxf(lut[i], 0.0f);
+        break;
+    case PL_HDR_SQRT:
+        for (int i = 0; i < num; i++) {
+            const float x = fmaxf(lut[i], 0.0f);
+            lut[i] = x * x;
+        }
+        break;
+    case PL_HDR_SCALING_COUNT:
+        pl_unreachable();
+    }
+
+    // Convert PL_HDR_NORM to output
+    switch (to) {
+    case PL_HDR_NORM:
+        break;
+    case PL_HDR_SQRT:
+        for (int i = 0; i < num; i++)
+            lut[i] = sqrtf(lut[i]);
+        break;
+    case PL_HDR_NITS:
+        for (int i = 0; i < num; i++)
+            lut[i] *= PL_COLOR_SDR_WHITE;
+        break;
+    case PL_HDR_PQ:
+        for (int i = 0; i < num; i++) {
+            float x = lut[i] * (PL_COLOR_SDR_WHITE / 10000.0f);
+            x = powf(x, PQ_M1);
+            x = (PQ_C1 + PQ_C2 * x) / (1.0f + PQ_C3 * x);
+            x = powf(x, PQ_M2);
+            lut[i] = lut[i] ? x : 0.0f; // match `pl_hdr_rescale`
+        }
+        break;
+    case PL_HDR_SCALING_COUNT:
+        pl_unreachable();
+    }
+}
+
 // Infer params and rescale to function scaling
 static struct pl_tone_map_params fix_params(const struct pl_tone_map_params *params)
 {
@@ -146,20 +212,21 @@ void pl_tone_map_generate(float *out, const struct pl_tone_map_params *params)
 {
     struct pl_tone_map_params fixed = fix_params(params);
 
+    const int lut_size = params->lut_size;
+
     // Generate input values evenly spaced in `params->input_scaling`
-    for (size_t i = 0; i < params->lut_size; i++) {
-        float x = (float) i / (params->lut_size - 1);
-        x = PL_MIX(params->input_min, params->input_max, x);
-        out[i] = pl_hdr_rescale(params->input_scaling, fixed.function->scaling, x);
+    for (int i = 0; i < lut_size; i++) {
+        const float x = (float) i / (lut_size - 1);
+        out[i] = PL_MIX(params->input_min, params->input_max, x);
     }
+    rescale_lut(out, lut_size, params->input_scaling, fixed.function->scaling);
 
     map_lut(out, &fixed);
 
     // Sanitize outputs and adapt back to `params->scaling`
-    for (size_t i = 0; i < params->lut_size; i++) {
-        float x = PL_CLAMP(out[i], fixed.output_min, fixed.output_max);
-        out[i] = pl_hdr_rescale(fixed.function->scaling, params->output_scaling, x);
-    }
+    for (int i = 0; i < lut_size; i++)
+        out[i] = PL_CLAMP(out[i], fixed.output_min, fixed.output_max);
+    rescale_lut(out, lut_size, fixed.function->scaling, params->output_scaling);
 }
 
 float pl_tone_map_sample(float x, const struct pl_tone_map_params *params)
@@ -193,18 +260,27 @@ static inline float rescale_out(float x, const struct pl_tone_map_params *params
     return x * (params->output_max - params->output_min) + params->output_min;
 }
 
-static inline float bt1886_eotf(float x, float min, float max)
+// BT.1886 black/white points, precomputed once per LUT
+struct bt1886 {
+    float lb, lw;
+};
+
+static inline struct bt1886 bt1886_init(float min, float max)
 {
-    const float lb = powf(min, 1/2.4f);
-    const float lw = powf(max, 1/2.4f);
-    return powf((lw - lb) * x + lb, 2.4f);
+    return (struct bt1886) {
+        .lb = powf(min, 1/2.4f),
+        .lw = powf(max, 1/2.4f),
+    };
 }
 
-static inline float bt1886_oetf(float x, float min, float max)
+static inline float bt1886_eotf(float x, struct bt1886 c)
 {
-    const float lb = powf(min, 1/2.4f);
-    const float lw = powf(max, 1/2.4f);
-    return (powf(x, 1/2.4f) - lb) / (lw - lb);
+    return powf((c.lw - c.lb) * x + c.lb, 2.4f);
+}
+
+static inline float bt1886_oetf(float x, struct bt1886 c)
+{
+    return (powf(x, 1/2.4f) - c.lb) / (c.lw - c.lb);
 }
 
 static void noop(float *lut, const struct pl_tone_map_params *params)
@@ -381,26 +457,41 @@ static void st2094_40(float *lut, const struct pl_tone_map_params *params)
     pl_assert(Kx >= 0 && Kx <= 1);
     pl_assert(Ky >= 0 && Ky <= 1);
 
+    // Fold the binomial coefficients into the control points
+    float BP[PL_ARRAY_SIZE(P)];
+    for (uint8_t p = 0; p <= N; p++)
+        BP[p] = binom[N][p] * P[p];
+
+    const struct bt1886 src = bt1886_init(params->input_min, params->input_max);
+    const struct bt1886 dst = bt1886_init(params->output_min, params->output_max);
+    const float linear = Kx ? Ky / Kx : 0.0f;
+
     FOREACH_LUT(lut, x) {
-        x = bt1886_oetf(x, params->input_min, params->input_max);
-        x = bt1886_eotf(x, 0.0f, 1.0f);
+        x = powf(bt1886_oetf(x, src), 2.4f);
 
         if (x <= Kx && Kx) {
             // Linear section
-            x *= Ky / Kx;
+            x *= linear;
         } else {
-            // Bezier section
-            const float t = (x - Kx) / (1 - Kx);
-
+            // Bezier section, with the powers of t and (1 - t) computed
+            // incrementally instead of through powf()
+            const float t = (x - Kx) / (1 - Kx), s = 1 - t;
+            float sp[PL_ARRAY_SIZE(P)];
+            sp[0] = 1.0f;
+            for (uint8_t p = 1; p <= N; p++)
+                sp[p] = sp[p - 1] * s;
+
+            float tp = 1.0f;
             x = 0; // Bn
-            for (uint8_t p = 0; p <= N; p++)
-                x += binom[N][p] * powf(t, p) * powf(1 - t, N - p) * P[p];
+            for (uint8_t p = 0; p <= N; p++) {
+                x += BP[p] * tp * sp[N - p];
+                tp *= t;
+            }
 
             x = Ky + (1 - Ky) * x;
         }
 
-        x = bt1886_oetf(x, 0.0f, 1.0f);
-        x = bt1886_eotf(x, params->output_min, params->output_max);
+        x = bt1886_eotf(powf(x, 1/2.4f), dst);
     }
 }
 
@@ -457,15 +548,25 @@ const struct pl_tone_map_function pl_tone_map_st2094_10 = {
     .map = st2094_10,
 };
 
-static void bt2390(float *lut, const struct pl_tone_map_params *params)
+static void bt2390_coeffs(float k[], const struct pl_tone_map_params *params)
 {
     const float minLum = rescale_in(params->output_min, params);
     const float maxLum = rescale_in(params->output_max, params);
     const float offset = params->constants.knee_offset;
-    const float ks = (1 + offset) * maxLum - offset;
     const float bp = minLum > 0 ? fminf(1 / minLum, 4) : 4;
     const float gain_inv = 1 + minLum / maxLum * powf(1 - maxLum, bp);
-    const float gain = maxLum < 1 ? 1 / gain_inv : 1;
+    k[0] = minLum;
+    k[1] = maxLum;
+    k[2] = (1 + offset) * maxLum - offset; // ks
+    k[3] = bp;
+    k[4] = maxLum < 1 ? 1 / gain_inv : 1; // gain
+}
+
+static void bt2390(float *lut, const struct pl_tone_map_params *params)
+{
+    float k[5];
+    bt2390_coeffs(k, params);
+    const float minLum = k[0], maxLum = k[1], ks = k[2], bp = k[3], gain = k[4];
 
     FOREACH_LUT(lut, x) {
         x = rescale_in(x, params);
@@ -506,6 +607,7 @@ static void bt2446a(float *lut, const struct pl_tone_map_params *params)
 {
     const float phdr = 1 + 32 * powf(params->input_max / 10000, 1/2.4f);
     const float psdr = 1 + 32 * powf(params->output_max / 10000, 1/2.4f);
+    const struct bt1886 dst = bt1886_init(params->output_min, params->output_max);
 
     FOREACH_LUT(lut, x) {
         x = powf(rescale_in(x, params), 1/2.4f);
@@ -520,14 +622,16 @@ static void bt2446a(float *lut, const struct pl_tone_map_params *params)
         }
 
         x = (powf(psdr, x) - 1) / (psdr - 1);
-        x = bt1886_eotf(x, params->output_min, params->output_max);
+        x = bt1886_eotf(x, dst);
     }
 }
 
 static void bt2446a_inv(float *lut, const struct pl_tone_map_params *params)
 {
+    const struct bt1886 src = bt1886_init(params->input_min, params->input_max);
+
     FOREACH_LUT(lut, x) {
-        x = bt1886_oetf(x, params->input_min, params->input_max);
+        x = bt1886_oetf(x, src);
         x *= 255.0;
         if (x > 70) {
             x = powf(x, (2.8305e-6f * x - 7.4622e-4f) * x + 1.2528f);
@@ -547,7 +651,7 @@ const struct pl_tone_map_function pl_tone_map_bt2446a = {
     .map_inverse = bt2446a_inv,
 };
 
-static void spline(float *lut, const struct pl_tone_map_params *params)
+static void spline_coeffs(float k[], const struct pl_tone_map_params *params)
 {
     float src_pivot, dst_pivot;
     st2094_pick_knee(&src_pivot, &dst_pivot, params);
@@ -589,6 +693,18 @@ static void spline(float *lut, const struct pl_tone_map_params *params)
     const float Qb = -3 * (slope * in_max - out_max) / t;
     const float Qc = slope;
 
+    k[0] = src_pivot; k[1] = dst_pivot;
+    k[2] = Pa; k[3] = Pb;
+    k[4] = Qa; k[5] = Qb; k[6] = Qc;
+}
+
+static void spline(float *lut, const struct pl_tone_map_params *params)
+{
+    float k[7];
+    spline_coeffs(k, params);
+    const float src_pivot = k[0], dst_pivot = k[1];
+    const float Pa = k[2], Pb = k[3], Qa = k[4], Qb = k[5], Qc = k[6];
+
     FOREACH_LUT(lut, x) {
         x -= src_pivot;
         x = x > 0 ? ((Qa * x + Qb) * x + Qc) * x : (Pa * x + Pb) * x;
@@ -608,12 +724,20 @@ const struct pl_tone_map_function pl_tone_map_spline = {
     .map_inverse = spline,
 };
 
-static void reinhard(float *lut, const struct pl_tone_map_params *params)
+static void reinhard_coeffs(float k[], const struct pl_tone_map_params *params)
 {
     const float peak = rescale(params->input_max, params),
                 contrast = params->constants.reinhard_contrast,
-                offset = (1.0 - contrast) / contrast,
-                scale = (peak + offset) / peak;
+                offset = (1.0 - contrast) / contrast;
+    k[0] = offset;
+    k[1] = (peak + offset) / peak; // scale
+}
+
+static void reinhard(float *lut, const struct pl_tone_map_params *params)
+{
+    float k[2];
+    reinhard_coeffs(k, params);
+    const float offset = k[0], scale = k[1];
 
     FOREACH_LUT(lut, x) {
         x = rescale(x, params);
@@ -633,7 +757,7 @@ const struct pl_tone_map_function pl_tone_map_reinhard = {
     .map = reinhard,
 };
 
-static void mobius(float *lut, const struct pl_tone_map_params *params)
+static void mobius_coeffs(float k[], const struct pl_tone_map_params *params)
 {
     const float peak = rescale(params->input_max, params),
                 j = params->constants.linear_knee;
@@ -643,7 +767,17 @@ static void mobius(float *lut, const struct pl_tone_map_params *params)
     const float a = -j*j * (peak - 1.0f) / (j*j - 2.0f * j + peak);
     const float b = (j*j - 2.0f * j * peak + peak) /
                     fmaxf(1e-6f, peak - 1.0f);
-    const float scale = (b*b + 2.0f * b*j + j*j) / (b - a);
+    k[0] = j;
+    k[1] = a;
+    k[2] = b;
+    k[3] = (b*b + 2.0f * b*j + j*j) / (b - a); // scale
+}
+
+static void mobius(float *lut, const struct pl_tone_map_params *params)
+{
+    float k[4];
+    mobius_coeffs(k, params);
+    const float j = k[0], a = k[1], b = k[2], scale = k[3];
 
     FOREACH_LUT(lut, x) {
         x = rescale(x, params);
@@ -668,17 +802,27 @@ static inline float hable(float x)
     return ((x * (A*x + C*B) + D*E) / (x * (A*x + B) + D*F)) - E/F;
 }
 
+static void hable_coeffs(float k[], const struct pl_tone_map_params *params)
+{
+    k[0] = params->input_max / params->output_max; // peak
+    k[1] = 1.0f / hable(k[0]); // scale
+}
+
 static void hable_map(float *lut, const struct pl_tone_map_params *params)
 {
-    const float peak = params->input_max / params->output_max,
-                scale = 1.0f / hable(peak);
+    float k[2];
+    hable_coeffs(k, params);
+    const float peak = k[0], scale = k[1];
+    const struct bt1886 src = bt1886_init(params->input_min, params->input_max);
+    const struct bt1886 mid = bt1886_init(0, peak);
+    const struct bt1886 dst = bt1886_init(params->output_min, params->output_max);
 
     FOREACH_LUT(lut, x) {
-        x = bt1886_oetf(x, params->input_min, params->input_max);
-        x = bt1886_eotf(x, 0, peak);
+        x = bt1886_oetf(x, src);
+        x = bt1886_eotf(x, mid);
         x = scale * hable(x);
-        x = bt1886_oetf(x, 0, 1);
-        x = bt1886_eotf(x, params->output_min, params->output_max);
+        x = powf(x, 1/2.4f);
+        x = bt1886_eotf(x, dst);
     }
 }
 
@@ -746,6 +890,41 @@ const struct pl_tone_map_function pl_tone_map_linear_light = {
     .map_inverse = linear,
 };
 
+bool pl_tone_map_curve(struct pl_tone_map_curve *out,
+                       const struct pl_tone_map_params *params)
+{
+    const struct pl_tone_map_params fixed = fix_params(params);
+    const struct pl_tone_map_function *fun = fixed.function;
+    *out = (struct pl_tone_map_curve) {
+        .function   = fun,
+        .input_min  = fixed.input_min,
+        .input_max  = fixed.input_max,
+        .output_min = fixed.output_min,
+        .output_max = fixed.output_max,
+    };
+
+    // Only spline is its own inverse, see `map_lut`
+    const bool inverse = fixed.output_max > fixed.input_max + 1e-4;
+    if (inverse && fun->map_inverse != fun->map)
+        return false;
+
+    if (fun == &pl_tone_map_spline) {
+        spline_coeffs(out->k, &fixed);
+    } else if (fun == &pl_tone_map_bt2390) {
+        bt2390_coeffs(out->k, &fixed);
+    } else if (fun == &pl_tone_map_reinhard) {
+        reinhard_coeffs(out->k, &fixed);
+    } else if (fun == &pl_tone_map_mobius) {
+        mobius_coeffs(out->k, &fixed);
+    } else if (fun == &pl_tone_map_hable) {
+        hable_coeffs(out->k, &fixed);
+    } else {
+        return false;
+    }
+
+    return true;
+}
+
 const struct pl_tone_map_function * const pl_tone_map_functions[] = {
     &pl_tone_map_clip,
     &pl_tone_map_st2094_40,
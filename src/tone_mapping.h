@@ -0,0 +1,45 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <libplacebo/tone_mapping.h>
+
+// Closed-form description of a tone-mapping curve, for evaluating it directly
+// in shaders instead of baking it into a LUT. All values are in the scaling
+// of `function->scaling`, and the input/output must be clamped to the given
+// ranges. The meaning of the coefficients `k` depends on the function:
+//
+//   spline:   src_pivot, dst_pivot, Pa, Pb, Qa, Qb, Qc
+//   bt2390:   minLum, maxLum, ks, bp, gain
+//   reinhard: offset, scale
+//   mobius:   j, a, b, scale
+//   hable:    peak, scale
+//
+// Refer to the corresponding LUT functions in `tone_mapping.c` for the
+// formulas these coefficients are used in.
+struct pl_tone_map_curve {
+    const struct pl_tone_map_function *function;
+    float input_min, input_max;
+    float output_min, output_max;
+    float k[7];
+};
+
+// Returns false if there is no closed form for the given parameters, in which
+// case the caller should fall back to `pl_tone_map_generate`.
+bool pl_tone_map_curve(struct pl_tone_map_curve *out,
+                       const struct pl_tone_map_params *params);
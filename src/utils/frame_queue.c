@@ -36,7 +36,9 @@ struct entry {
     struct pl_frame frame;
     uint64_t signature;
     bool mapped;
+    bool mapping; // currently being mapped by the lookahead thread
     bool ok;
+    int users; // number of active views still referencing this frame
 
     // for interlaced frames
     enum pl_field field;
@@ -60,6 +62,36 @@ struct entry {
 // Maximum number of not-yet-mapped frames to allow queueing in advance
 #define PREFETCH_FRAMES 2
 
+// Maximum number of recycled texture sets to keep around for reuse
+#define MAX_CACHE 16
+
+// Capacity of the lock-free input ring used by `pl_queue_push_async`
+#define RING_SIZE 64
+
+// Adaptive quality controller tuning. Quality is lowered when the smoothed
+// render time exceeds OVERLOAD_RATIO of the vsync budget, and raised again
+// after RECOVER_FRAMES consecutive frames below HEADROOM_RATIO. No decision
+// is made for SETTLE_FRAMES after a change, which also covers the latency of
+// the timer results.
+#define QUALITY_OVERLOAD_RATIO 0.9f
+#define QUALITY_HEADROOM_RATIO 0.5f
+#define QUALITY_SETTLE_FRAMES 8
+#define QUALITY_RECOVER_FRAMES 120
+#define QUALITY_EMA_WEIGHT 0.125f
+
+// Single-producer/single-consumer ring of frames pushed by
+// `pl_queue_push_async`. The producer only ever writes `head` and the
+// consumer (anybody holding `lock_weak`) only ever writes `tail`.
+struct ring {
+    struct {
+        struct pl_source_frame src;
+        bool eof;
+    } entries[RING_SIZE];
+    atomic_uint head;
+    atomic_uint tail;
+    atomic_bool waiting; // consumer is (about to be) blocked on `wakeup`
+};
+
 struct pool {
     float samples[MAX_SAMPLES];
     float estimate;
@@ -69,6 +101,37 @@ struct pool {
     int total;
 };
 
+// Consumer-side state. Every queue has a built-in view for `pl_queue_update`,
+// plus any number of views created by `pl_queue_view_create`. All views share
+// the same frames (and thus mapped textures), but advance independently.
+struct pl_queue_view_t {
+    pl_queue parent;
+
+    // Whether this view takes part in deciding which frames to keep alive.
+    // The built-in view only becomes active on the first `pl_queue_update`.
+    bool active;
+
+    // References to the frames still visible to this view, sorted by PTS
+    PL_ARRAY(struct entry *) queue;
+    int threshold_frames;
+
+    // Average vsync estimation state
+    struct pool vps;
+    float reported_vps;
+    float reported_fps;
+    double prev_pts;
+
+    // Timing of the last frame returned in VRR mode, see `pl_queue_vrr_timing`
+    bool vrr_valid;
+    double vrr_pts;
+    double vrr_next_pts;
+
+    // Storage for temporary arrays
+    PL_ARRAY(uint64_t) tmp_sig;
+    PL_ARRAY(float) tmp_ts;
+    PL_ARRAY(const struct pl_frame *) tmp_frame;
+};
+
 struct pl_queue_t {
     pl_gpu gpu;
     pl_log log;
@@ -85,28 +148,57 @@ struct pl_queue_t {
     pl_mutex lock_weak;
     pl_cond wakeup;
 
-    // Frame queue and state
+    // Frames pushed without taking any lock, drained into `queue` by the
+    // consumer side while holding `lock_weak`
+    struct ring *ring;
+
+    // Background mapping of upcoming frames (`pl_queue_params.lookahead`),
+    // guarded by `lock_weak`. `map_wakeup` is signalled both for new work
+    // and for completed mappings.
+    pl_thread map_thread;
+    pl_cond map_wakeup;
+    bool map_running;
+    bool map_quit;
+    int lookahead;
+    double map_pts;
+
+    // All frames still needed by at least one view, sorted by PTS
     PL_ARRAY(struct entry *) queue;
     uint64_t signature;
-    int threshold_frames;
     bool want_frame;
     bool eof;
 
-    // Average vsync/frame fps estimation state
-    struct pool vps, fps;
-    float reported_vps;
-    float reported_fps;
-    double prev_pts;
-
-    // Storage for temporary arrays
-    PL_ARRAY(uint64_t) tmp_sig;
-    PL_ARRAY(float) tmp_ts;
-    PL_ARRAY(const struct pl_frame *) tmp_frame;
+    // Average frame fps estimation state
+    struct pool fps;
+
+    // All views of this queue, starting with the built-in one (`main`)
+    PL_ARRAY(pl_queue_view) views;
+    pl_queue_view main;
+
+    // Adaptive quality controller state, guarded by `lock_weak`
+    struct {
+        enum pl_queue_quality level;
+        uint64_t frame_ns; // render time accumulated for the current frame
+        float render_time; // smoothed render time, or 0 if no estimate
+        float vsync_hint;
+        int settle_frames;
+        int headroom_frames;
+        void (*cb)(void *priv, const struct pl_queue_quality_info *info);
+        void *priv;
+    } quality;
 
     // Queue of GPU objects to reuse
     PL_ARRAY(struct cache_entry) cache;
 };
 
+static pl_queue_view view_alloc(pl_queue p)
+{
+    pl_queue_view v = pl_zalloc_ptr(p, v);
+    v->parent = p;
+    PL_ARRAY_APPEND(p, p->views, v);
+    return v;
+}
+
 pl_queue pl_queue_create(pl_gpu gpu)
 {
     pl_queue p = pl_alloc_ptr(NULL, p);
@@ -115,9 +207,17 @@ pl_queue pl_queue_create(pl_gpu gpu)
         .log = gpu->log,
     };
 
+    p->ring = pl_zalloc_ptr(p, p->ring);
+    atomic_init(&p->ring->head, 0);
+    atomic_init(&p->ring->tail, 0);
+    atomic_init(&p->ring->waiting, false);
+    p->main = view_alloc(p);
+
     pl_mutex_init(&p->lock_strong);
     pl_mutex_init(&p->lock_weak);
     int ret = pl_cond_init(&p->wakeup);
+    if (!ret)
+        ret = pl_cond_init(&p->map_wakeup);
     if (ret) {
         PL_ERR(p, "Failed to init conditional variable: %d", ret);
         return NULL;
@@ -140,12 +240,44 @@ static void recycle_cache(pl_queue p, struct cache_entry *cache, bool recycle)
         }
     }
 
-    if (recycle && has_textures)
+    if (recycle && has_textures) {
+        if (p->cache.num == MAX_CACHE) {
+            struct cache_entry *old = &p->cache.elem[0];
+            for (int i = 0; i < PL_ARRAY_SIZE(old->tex); i++)
+                pl_tex_destroy(p->gpu, &old->tex[i]);
+            PL_ARRAY_REMOVE_AT(p->cache, 0);
+        }
         PL_ARRAY_APPEND(p, p->cache, *cache);
+    }
 
     memset(cache, 0, sizeof(*cache)); // sanity
 }
 
+static bool cache_busy(pl_queue p, const struct cache_entry *cache)
+{
+    for (int i = 0; i < PL_ARRAY_SIZE(cache->tex); i++) {
+        if (cache->tex[i] && pl_tex_poll(p->gpu, cache->tex[i], 0))
+            return true;
+    }
+
+    return false;
+}
+
+// Takes the most recently recycled set of textures that the GPU is no longer
+// using, or failing that, the most recently recycled set overall
+static void cache_pop(pl_queue p, struct cache_entry *out)
+{
+    for (int n = p->cache.num - 1; n >= 0; n--) {
+        if (!cache_busy(p, &p->cache.elem[n])) {
+            *out = p->cache.elem[n];
+            PL_ARRAY_REMOVE_AT(p->cache, n);
+            return;
+        }
+    }
+
+    PL_ARRAY_POP(p->cache, out);
+}
+
 static void entry_deref(pl_queue p, struct entry **pentry, bool recycle)
 {
     struct entry *entry = *pentry;
@@ -185,12 +317,99 @@ static void entry_cull(pl_queue p, struct entry *entry, bool recycle)
     entry_deref(p, &entry, recycle);
 }
 
+// Makes a frame visible to a view, keeping the view sorted by PTS
+static void view_insert(pl_queue_view v, struct entry *entry)
+{
+    int i = v->queue.num;
+    while (i > 0 && v->queue.elem[i - 1]->pts > entry->pts)
+        i--;
+    entry->users++;
+    PL_ARRAY_INSERT_AT(v, v->queue, i, entry_ref(entry));
+}
+
+// Drops the first `num` frames from a view. The frames themselves are only
+// culled by `queue_gc`, once no other view needs them either.
+static void view_cull(pl_queue_view v, int num)
+{
+    for (int i = 0; i < num; i++) {
+        struct entry *entry = v->queue.elem[i];
+        entry->users--;
+        entry_deref(v->parent, &entry, true);
+    }
+    PL_ARRAY_REMOVE_RANGE(v->queue, 0, num);
+}
+
+// Starts tracking all frames currently in the queue
+static void view_activate(pl_queue_view v)
+{
+    pl_queue p = v->parent;
+    for (int i = 0; i < p->queue.num; i++)
+        view_insert(v, p->queue.elem[i]);
+    v->active = true;
+}
+
+static void view_reset(pl_queue_view v)
+{
+    view_cull(v, v->queue.num);
+    *v = (struct pl_queue_view_t) {
+        .parent = v->parent,
+        .active = v->active,
+
+        // Explicitly preserve allocations
+        .queue.elem = v->queue.elem,
+        .tmp_sig.elem = v->tmp_sig.elem,
+        .tmp_ts.elem = v->tmp_ts.elem,
+        .tmp_frame.elem = v->tmp_frame.elem,
+    };
+}
+
+// Culls all frames at the head of the queue which no active view needs any
+// longer. Frames are kept around indefinitely while no view is active yet.
+static void queue_gc(pl_queue p)
+{
+    bool active = false;
+    for (int i = 0; i < p->views.num; i++)
+        active |= p->views.elem[i]->active;
+    if (!active)
+        return;
+
+    int culled = 0;
+    while (culled < p->queue.num && !p->queue.elem[culled]->users)
+        entry_cull(p, p->queue.elem[culled++], true);
+    PL_ARRAY_REMOVE_RANGE(p->queue, 0, culled);
+}
+
+// Drops all frames still pending in the input ring
+static void ring_discard(pl_queue p)
+{
+    struct ring *ring = p->ring;
+    unsigned head = atomic_load(&ring->head);
+    unsigned tail = atomic_load(&ring->tail);
+    for (; tail != head; tail++) {
+        const struct pl_source_frame *src = &ring->entries[tail % RING_SIZE].src;
+        if (!ring->entries[tail % RING_SIZE].eof && src->discard)
+            src->discard(src);
+    }
+    atomic_store(&ring->tail, tail);
+}
+
 void pl_queue_destroy(pl_queue *queue)
 {
     pl_queue p = *queue;
     if (!p)
         return;
 
+    if (p->map_running) {
+        pl_mutex_lock(&p->lock_weak);
+        p->map_quit = true;
+        pl_cond_broadcast(&p->map_wakeup);
+        pl_mutex_unlock(&p->lock_weak);
+        pl_thread_join(p->map_thread);
+    }
+
+    ring_discard(p);
+    for (int n = 0; n < p->views.num; n++)
+        view_reset(p->views.elem[n]);
     for (int n = 0; n < p->queue.num; n++)
         entry_cull(p, p->queue.elem[n], false);
     for (int n = 0; n < p->cache.num; n++) {
@@ -199,6 +418,7 @@ void pl_queue_destroy(pl_queue *queue)
     }
 
     pl_cond_destroy(&p->wakeup);
+    pl_cond_destroy(&p->map_wakeup);
     pl_mutex_destroy(&p->lock_weak);
     pl_mutex_destroy(&p->lock_strong);
     pl_free(p);
@@ -210,6 +430,9 @@ void pl_queue_reset(pl_queue p)
     pl_mutex_lock(&p->lock_strong);
     pl_mutex_lock(&p->lock_weak);
 
+    ring_discard(p);
+    for (int i = 0; i < p->views.num; i++)
+        view_reset(p->views.elem[i]);
     for (int i = 0; i < p->queue.num; i++)
         entry_cull(p, p->queue.elem[i], false);
 
@@ -221,16 +444,28 @@ void pl_queue_reset(pl_queue p)
         .lock_strong = p->lock_strong,
         .lock_weak = p->lock_weak,
         .wakeup = p->wakeup,
+        .ring = p->ring,
+
+        // Keep the lookahead thread running, it will simply find no work
+        .map_thread = p->map_thread,
+        .map_wakeup = p->map_wakeup,
+        .map_running = p->map_running,
 
         // Explicitly preserve allocations
         .queue.elem = p->queue.elem,
-        .tmp_sig.elem = p->tmp_sig.elem,
-        .tmp_ts.elem = p->tmp_ts.elem,
-        .tmp_frame.elem = p->tmp_frame.elem,
+
+        // Views outlive resets, and have already been reset above
+        .views = p->views,
+        .main = p->main,
 
         // Reuse GPU object cache entirely
         .cache = p->cache,
+
+        // Rendering cost is unaffected by discontinuities, so keep the
+        // current quality level
+        .quality = p->quality,
     };
+    p->quality.frame_ns = 0;
 
     pl_cond_signal(&p->wakeup);
     pl_mutex_unlock(&p->lock_weak);
@@ -315,11 +550,12 @@ static void queue_push(pl_queue p, const struct pl_source_frame *src)
         .src = *src,
     };
     pl_rc_init(&entry->rc);
-    PL_ARRAY_POP(p->cache, &entry->cache);
+    cache_pop(p, &entry->cache);
     PL_TRACE(p, "Added new frame id %"PRIu64" with PTS %f",
              entry->signature, entry->pts);
 
     // Insert new entry into the correct spot in the queue, sorted by PTS
+    struct entry *field2 = NULL;
     for (int i = p->queue.num;; i--) {
         if (i == 0 || p->queue.elem[i - 1]->pts <= entry->pts) {
             if (src->first_field == PL_FIELD_NONE) {
@@ -393,21 +629,75 @@ static void queue_push(pl_queue p, const struct pl_source_frame *src)
 
                 PL_ARRAY_INSERT_AT(p, p->queue, i, entry);
                 PL_ARRAY_INSERT_AT(p, p->queue, i+1, entry2);
+                field2 = entry2;
                 break;
             }
         }
     }
 
+    for (int i = 0; i < p->views.num; i++) {
+        pl_queue_view v = p->views.elem[i];
+        if (!v->active)
+            continue;
+        view_insert(v, entry);
+        if (field2)
+            view_insert(v, field2);
+    }
+
     p->want_frame = false;
+    if (p->map_running)
+        pl_cond_broadcast(&p->map_wakeup);
+}
+
+// Moves all frames pushed by `pl_queue_push_async` into the queue proper.
+// Must be called with `lock_weak` held.
+static void ring_drain(pl_queue p)
+{
+    struct ring *ring = p->ring;
+    unsigned head = atomic_load(&ring->head);
+    unsigned tail = atomic_load(&ring->tail);
+    for (; tail != head; tail++) {
+        const struct pl_source_frame src = ring->entries[tail % RING_SIZE].src;
+        bool eof = ring->entries[tail % RING_SIZE].eof;
+        atomic_store(&ring->tail, tail + 1);
+        queue_push(p, eof ? NULL : &src);
+    }
 }
 
 void pl_queue_push(pl_queue p, const struct pl_source_frame *frame)
 {
     pl_mutex_lock(&p->lock_weak);
+    ring_drain(p);
     queue_push(p, frame);
     pl_mutex_unlock(&p->lock_weak);
 }
 
+bool pl_queue_push_async(pl_queue p, const struct pl_source_frame *frame)
+{
+    struct ring *ring = p->ring;
+    unsigned head = atomic_load(&ring->head);
+    if (head - atomic_load(&ring->tail) == RING_SIZE)
+        return false;
+
+    ring->entries[head % RING_SIZE].eof = !frame;
+    if (frame)
+        ring->entries[head % RING_SIZE].src = *frame;
+    atomic_store(&ring->head, head + 1);
+
+    // Wake up the consumer if it's blocked waiting for new frames. The flag
+    // is only set while the consumer is about to block on (or blocked on)
+    // `wakeup`, so taking the lock here only waits for it to enter the wait,
+    // which atomically releases the lock again
+    if (atomic_load(&ring->waiting)) {
+        pl_mutex_lock(&p->lock_weak);
+        if (atomic_load(&ring->waiting))
+            pl_cond_signal(&p->wakeup);
+        pl_mutex_unlock(&p->lock_weak);
+    }
+
+    return true;
+}
+
 static inline bool entry_mapped(struct entry *entry)
 {
     return entry->mapped || (entry->primary && entry->primary->mapped);
@@ -418,9 +708,17 @@ static bool queue_has_room(pl_queue p)
     if (p->want_frame)
         return true;
 
+    // Make room for the view with the slowest display
+    float vps = 0.0f;
+    for (int i = 0; i < p->views.num; i++) {
+        float estimate = p->views.elem[i]->vps.estimate;
+        if (estimate <= 1.0f / MIN_FPS)
+            vps = fmaxf(vps, estimate);
+    }
+
     int wanted_frames = PREFETCH_FRAMES;
-    if (p->fps.estimate && p->vps.estimate && p->vps.estimate <= 1.0f / MIN_FPS)
-        wanted_frames += ceilf(p->vps.estimate / p->fps.estimate) - 1;
+    if (p->fps.estimate && vps)
+        wanted_frames += ceilf(vps / p->fps.estimate) - 1;
 
     // Examine the queue tail
     for (int i = p->queue.num - 1; i >= 0; i--) {
@@ -437,6 +735,7 @@ bool pl_queue_push_block(pl_queue p, uint64_t timeout,
                          const struct pl_source_frame *frame)
 {
     pl_mutex_lock(&p->lock_weak);
+    ring_drain(p);
     if (!timeout || !frame || p->eof)
         goto skip_blocking;
 
@@ -454,24 +753,25 @@ skip_blocking:
     return true;
 }
 
-static void report_estimates(pl_queue p)
+static void report_estimates(pl_queue_view v)
 {
-    if (p->fps.total >= MIN_SAMPLES && p->vps.total >= MIN_SAMPLES) {
-        if (p->reported_fps && p->reported_vps) {
+    pl_queue p = v->parent;
+    if (p->fps.total >= MIN_SAMPLES && v->vps.total >= MIN_SAMPLES) {
+        if (v->reported_fps && v->reported_vps) {
             // Only re-report the estimates if they've changed considerably
             // from the previously reported values
             static const float report_delta = 0.3f;
-            float delta_fps = delta(p->reported_fps, p->fps.estimate);
-            float delta_vps = delta(p->reported_vps, p->vps.estimate);
+            float delta_fps = delta(v->reported_fps, p->fps.estimate);
+            float delta_vps = delta(v->reported_vps, v->vps.estimate);
             if (delta_fps < report_delta && delta_vps < report_delta)
                 return;
         }
 
         PL_INFO(p, "Estimated source FPS: %.3f, display FPS: %.3f",
-                1.0 / p->fps.estimate, 1.0 / p->vps.estimate);
+                1.0 / p->fps.estimate, 1.0 / v->vps.estimate);
 
-        p->reported_fps = p->fps.estimate;
-        p->reported_vps = p->vps.estimate;
+        v->reported_fps = p->fps.estimate;
+        v->reported_vps = v->vps.estimate;
     }
 }
 
@@ -489,7 +789,15 @@ static enum pl_queue_status get_frame(pl_queue p, const struct pl_queue_params *
         pl_cond_signal(&p->wakeup);
 
         while (p->want_frame) {
-            if (pl_cond_timedwait(&p->wakeup, &p->lock_weak, params->timeout) == ETIMEDOUT)
+            // Set the flag before checking the ring one final time, so that
+            // any frame pushed after this point sees it and wakes us up
+            atomic_store(&p->ring->waiting, true);
+            ring_drain(p);
+            int ret = 0;
+            if (p->want_frame)
+                ret = pl_cond_timedwait(&p->wakeup, &p->lock_weak, params->timeout);
+            atomic_store(&p->ring->waiting, false);
+            if (ret == ETIMEDOUT)
                 return PL_QUEUE_MORE;
         }
 
@@ -520,6 +828,11 @@ static enum pl_queue_status get_frame(pl_queue p, const struct pl_queue_params *
 
 static inline bool map_frame(pl_queue p, struct entry *entry)
 {
+    // If the lookahead thread is already busy mapping this frame, just wait
+    // for it to finish instead of mapping it a second time
+    while (entry->mapping)
+        pl_cond_wait(&p->map_wakeup, &p->lock_weak);
+
     if (!entry->mapped) {
         PL_TRACE(p, "Mapping frame id %"PRIu64" with PTS %f",
                  entry->signature, entry->pts);
@@ -558,6 +871,91 @@ static bool map_entry(pl_queue p, struct entry *entry)
     return true;
 }
 
+static PL_THREAD_VOID map_thread(void *arg)
+{
+    pl_queue p = arg;
+    pl_mutex_lock(&p->lock_weak);
+
+    while (!p->map_quit) {
+        // Find the first unmapped frame among the next `lookahead` frames
+        // after the most recently requested PTS. Frames at or before it are
+        // mapped by `pl_queue_update` itself, as they're needed right away.
+        struct entry *entry = NULL;
+        int ahead = 0;
+        for (int i = 0; i < p->queue.num && ahead < p->lookahead; i++) {
+            struct entry *e = p->queue.elem[i];
+            if (e->pts <= p->map_pts)
+                continue;
+            ahead++;
+            e = PL_DEF(e->primary, e);
+            if (!e->mapped && !e->mapping) {
+                entry = entry_ref(e);
+                break;
+            }
+        }
+
+        if (!entry) {
+            pl_cond_wait(&p->map_wakeup, &p->lock_weak);
+            continue;
+        }
+
+        // Map the frame without holding the lock, so that the decoder can
+        // keep pushing frames and `pl_queue_update` can keep rendering
+        PL_TRACE(p, "Mapping frame id %"PRIu64" with PTS %f in advance",
+                 entry->signature, entry->pts);
+        entry->mapping = true;
+        pl_mutex_unlock(&p->lock_weak);
+        bool ok = entry->src.map(p->gpu, entry->cache.tex, &entry->src, &entry->frame);
+        pl_mutex_lock(&p->lock_weak);
+
+        if (!ok) {
+            PL_ERR(p, "Failed mapping frame id %"PRIu64" with PTS %f",
+                   entry->signature, entry->pts);
+        }
+
+        entry->ok = ok;
+        entry->mapped = true;
+        entry->mapping = false;
+        pl_cond_broadcast(&p->map_wakeup);
+        entry_deref(p, &entry, true); // may have been evicted in the meantime
+    }
+
+    pl_mutex_unlock(&p->lock_weak);
+    PL_THREAD_RETURN();
+}
+
+static void update_lookahead(pl_queue p, const struct pl_queue_params *params)
+{
+    if (params->lookahead > 0 && !p->map_running) {
+        if (!p->gpu->limits.thread_safe) {
+            if (!p->lookahead)
+                PL_WARN(p, "Frame lookahead requires a thread-safe GPU, ignoring!");
+            p->lookahead = params->lookahead;
+            return;
+        }
+
+        p->map_quit = false;
+        if (pl_thread_create(&p->map_thread, map_thread, p) != 0) {
+            PL_ERR(p, "Failed creating frame lookahead thread!");
+            return;
+        }
+
+        p->map_running = true;
+    }
+
+    // Map ahead of the view lagging furthest behind, since anything before
+    // that is needed right away anyway
+    p->lookahead = params->lookahead;
+    p->map_pts = params->pts;
+    for (int i = 0; i < p->views.num; i++) {
+        pl_queue_view v = p->views.elem[i];
+        if (v->active)
+            p->map_pts = fmin(p->map_pts, v->prev_pts);
+    }
+    if (p->map_running)
+        pl_cond_broadcast(&p->map_wakeup);
+}
+
 static bool entry_complete(struct entry *entry)
 {
     return entry->field ? !!entry->next : true;
@@ -567,42 +965,40 @@ static bool entry_complete(struct entry *entry)
 // `pts`, and idx 1 is the first frame after `pts` (unless this is the last).
 //
 // Returns PL_QUEUE_OK only if idx 0 is still legal under ZOH semantics.
-static enum pl_queue_status advance(pl_queue p, double pts,
+static enum pl_queue_status advance(pl_queue_view v, double pts,
                                     const struct pl_queue_params *params)
 {
+    pl_queue p = v->parent;
+
     // Cull all frames except the last frame before `pts`
     int culled = 0;
-    for (int i = 1; i < p->queue.num; i++) {
-        if (p->queue.elem[i]->pts <= pts) {
-            entry_cull(p, p->queue.elem[i - 1], true);
+    for (int i = 1; i < v->queue.num; i++) {
+        if (v->queue.elem[i]->pts <= pts)
             culled++;
-        }
     }
-    PL_ARRAY_REMOVE_RANGE(p->queue, 0, culled);
+    view_cull(v, culled);
 
     // Keep adding new frames until we find one in the future, or EOF
     enum pl_queue_status ret = PL_QUEUE_OK;
-    while (p->queue.num < 2) {
+    while (v->queue.num < 2) {
         switch ((ret = get_frame(p, params))) {
         case PL_QUEUE_ERR:
             return ret;
         case PL_QUEUE_EOF:
-            if (!p->queue.num)
+            if (!v->queue.num)
                 return ret;
             goto done;
         case PL_QUEUE_MORE:
         case PL_QUEUE_OK:
-            while (p->queue.num > 1 && p->queue.elem[1]->pts <= pts) {
-                entry_cull(p, p->queue.elem[0], true);
-                PL_ARRAY_REMOVE_AT(p->queue, 0);
-            }
+            while (v->queue.num > 1 && v->queue.elem[1]->pts <= pts)
+                view_cull(v, 1);
             if (ret == PL_QUEUE_MORE)
                 return ret;
             continue;
         }
     }
 
-    if (!entry_complete(p->queue.elem[1])) {
+    if (!entry_complete(v->queue.elem[1])) {
         switch (get_frame(p, params)) {
         case PL_QUEUE_ERR:
             return PL_QUEUE_ERR;
@@ -616,8 +1012,8 @@ static enum pl_queue_status advance(pl_queue p, double pts,
     }
 
 done:
-    if (p->eof && p->queue.num == 1) {
-        if (p->queue.elem[0]->pts == 0.0 || !p->fps.estimate) {
+    if (p->eof && v->queue.num == 1) {
+        if (v->queue.elem[0]->pts == 0.0 || !p->fps.estimate) {
             // If the last frame has PTS 0.0, or we have no FPS estimate, then
             // this is probably a single-frame file, in which case we want to
             // extend the ZOH to infinity, rather than returning. Not a perfect
@@ -627,39 +1023,56 @@ done:
 
         // Last frame is held for an extra `p->fps.estimate` duration,
         // afterwards this function just returns EOF.
-        if (pts < p->queue.elem[0]->pts + p->fps.estimate) {
+        if (pts < v->queue.elem[0]->pts + p->fps.estimate) {
             ret = PL_QUEUE_OK;
         } else {
-            entry_cull(p, p->queue.elem[0], true);
-            p->queue.num = 0;
+            view_cull(v, 1);
             return PL_QUEUE_EOF;
         }
     }
 
-    pl_assert(p->queue.num);
+    pl_assert(v->queue.num);
     return ret;
 }
 
-static inline enum pl_queue_status point(pl_queue p, struct pl_frame_mix *mix,
+// Return a mix containing only this single (mapped) frame
+static void single_frame_mix(pl_queue_view v, struct pl_frame_mix *mix,
+                             struct entry *entry)
+{
+    v->tmp_sig.num = v->tmp_ts.num = v->tmp_frame.num = 0;
+    PL_ARRAY_APPEND(v, v->tmp_sig, entry->signature);
+    PL_ARRAY_APPEND(v, v->tmp_frame, &entry->frame);
+    PL_ARRAY_APPEND(v, v->tmp_ts, 0.0);
+    *mix = (struct pl_frame_mix) {
+        .num_frames = 1,
+        .frames = v->tmp_frame.elem,
+        .signatures = v->tmp_sig.elem,
+        .timestamps = v->tmp_ts.elem,
+        .vsync_duration = 1.0,
+    };
+}
+
+static inline enum pl_queue_status point(pl_queue_view v, struct pl_frame_mix *mix,
                                          const struct pl_queue_params *params)
 {
-    if (!p->queue.num) {
+    pl_queue p = v->parent;
+    if (!v->queue.num) {
         *mix = (struct pl_frame_mix) {0};
         return PL_QUEUE_MORE;
     }
 
     // Find closest frame (nearest neighbour semantics)
-    struct entry *entry = p->queue.elem[0];
+    struct entry *entry = v->queue.elem[0];
     if (entry->pts > params->pts) { // first frame not visible yet
         *mix = (struct pl_frame_mix) {0};
         return PL_QUEUE_OK;
     }
 
     double best = fabs(entry->pts - params->pts);
-    for (int i = 1; i < p->queue.num; i++) {
-        double dist = fabs(p->queue.elem[i]->pts - params->pts);
+    for (int i = 1; i < v->queue.num; i++) {
+        double dist = fabs(v->queue.elem[i]->pts - params->pts);
         if (dist < best) {
-            entry = p->queue.elem[i];
+            entry = v->queue.elem[i];
             best = dist;
             continue;
         } else {
@@ -670,38 +1083,26 @@ static inline enum pl_queue_status point(pl_queue p, struct pl_frame_mix *mix,
     if (!map_entry(p, entry))
         return PL_QUEUE_ERR;
 
-    // Return a mix containing only this single frame
-    p->tmp_sig.num = p->tmp_ts.num = p->tmp_frame.num = 0;
-    PL_ARRAY_APPEND(p, p->tmp_sig, entry->signature);
-    PL_ARRAY_APPEND(p, p->tmp_frame, &entry->frame);
-    PL_ARRAY_APPEND(p, p->tmp_ts, 0.0);
-    *mix = (struct pl_frame_mix) {
-        .num_frames = 1,
-        .frames = p->tmp_frame.elem,
-        .signatures = p->tmp_sig.elem,
-        .timestamps = p->tmp_ts.elem,
-        .vsync_duration = 1.0,
-    };
-
+    single_frame_mix(v, mix, entry);
     PL_TRACE(p, "Showing single frame id %"PRIu64" with PTS %f for target PTS %f",
              entry->signature, entry->pts, params->pts);
 
-    report_estimates(p);
+    report_estimates(v);
     return PL_QUEUE_OK;
 }
 
 // Present a single frame as appropriate for `pts`
-static enum pl_queue_status nearest(pl_queue p, struct pl_frame_mix *mix,
+static enum pl_queue_status nearest(pl_queue_view v, struct pl_frame_mix *mix,
                                     const struct pl_queue_params *params)
 {
     enum pl_queue_status ret;
-    switch ((ret = advance(p, params->pts, params))) {
+    switch ((ret = advance(v, params->pts, params))) {
     case PL_QUEUE_ERR:
     case PL_QUEUE_EOF:
         return ret;
     case PL_QUEUE_OK:
     case PL_QUEUE_MORE:
-        if (mix && point(p, mix, params) == PL_QUEUE_ERR)
+        if (mix && point(v, mix, params) == PL_QUEUE_ERR)
             return PL_QUEUE_ERR;
         return ret;
     }
@@ -709,20 +1110,62 @@ static enum pl_queue_status nearest(pl_queue p, struct pl_frame_mix *mix,
     pl_unreachable();
 }
 
+// Present each frame exactly once, at its own PTS (ZOH semantics)
+static enum pl_queue_status vrr(pl_queue_view v, struct pl_frame_mix *mix,
+                                const struct pl_queue_params *params)
+{
+    pl_queue p = v->parent;
+    enum pl_queue_status ret;
+    switch ((ret = advance(v, params->pts, params))) {
+    case PL_QUEUE_ERR:
+    case PL_QUEUE_EOF:
+        return ret;
+    case PL_QUEUE_OK:
+    case PL_QUEUE_MORE:
+        break;
+    }
+
+    if (!v->queue.num || v->queue.elem[0]->pts > params->pts) {
+        // First frame not visible yet
+        if (mix)
+            *mix = (struct pl_frame_mix) {0};
+        return ret;
+    }
+
+    // `advance` guarantees idx 1 (if present) is the first frame after `pts`
+    struct entry *entry = v->queue.elem[0];
+    v->vrr_valid = true;
+    v->vrr_pts = entry->pts;
+    v->vrr_next_pts = v->queue.num > 1 ? v->queue.elem[1]->pts : INFINITY;
+    if (!mix)
+        return ret;
+
+    if (!map_entry(p, entry))
+        return PL_QUEUE_ERR;
+
+    single_frame_mix(v, mix, entry);
+    PL_TRACE(p, "Presenting frame id %"PRIu64" with PTS %f, next PTS %f",
+             entry->signature, entry->pts, v->vrr_next_pts);
+
+    report_estimates(v);
+    return ret;
+}
+
 // Special case of `interpolate` for radius = 0, in which case we need exactly
 // the previous frame and the following frame
-static enum pl_queue_status oversample(pl_queue p, struct pl_frame_mix *mix,
+static enum pl_queue_status oversample(pl_queue_view v, struct pl_frame_mix *mix,
                                        const struct pl_queue_params *params)
 {
+    pl_queue p = v->parent;
     enum pl_queue_status ret;
-    switch ((ret = advance(p, params->pts, params))) {
+    switch ((ret = advance(v, params->pts, params))) {
     case PL_QUEUE_ERR:
     case PL_QUEUE_EOF:
         return ret;
     case PL_QUEUE_OK:
         break;
     case PL_QUEUE_MORE:
-        if (!p->queue.num) {
+        if (!v->queue.num) {
             if (mix)
                 *mix = (struct pl_frame_mix) {0};
             return ret;
@@ -734,88 +1177,89 @@ static enum pl_queue_status oversample(pl_queue p, struct pl_frame_mix *mix,
         return PL_QUEUE_OK;
 
     // Can't oversample with only a single frame, fall back to point sampling
-    if (p->queue.num < 2 || p->queue.elem[0]->pts > params->pts) {
-        if (point(p, mix, params) != PL_QUEUE_OK)
+    if (v->queue.num < 2 || v->queue.elem[0]->pts > params->pts) {
+        if (point(v, mix, params) != PL_QUEUE_OK)
             return PL_QUEUE_ERR;
         return ret;
     }
 
-    struct entry *entries[2] = { p->queue.elem[0], p->queue.elem[1] };
+    struct entry *entries[2] = { v->queue.elem[0], v->queue.elem[1] };
     pl_assert(entries[0]->pts <= params->pts);
     pl_assert(entries[1]->pts >= params->pts);
 
     // Returning a mix containing both of these two frames
-    p->tmp_sig.num = p->tmp_ts.num = p->tmp_frame.num = 0;
+    v->tmp_sig.num = v->tmp_ts.num = v->tmp_frame.num = 0;
     for (int i = 0; i < 2; i++) {
         if (!map_entry(p, entries[i]))
             return PL_QUEUE_ERR;
         float ts = (entries[i]->pts - params->pts) / p->fps.estimate;
-        PL_ARRAY_APPEND(p, p->tmp_sig, entries[i]->signature);
-        PL_ARRAY_APPEND(p, p->tmp_frame, &entries[i]->frame);
-        PL_ARRAY_APPEND(p, p->tmp_ts, ts);
+        PL_ARRAY_APPEND(v, v->tmp_sig, entries[i]->signature);
+        PL_ARRAY_APPEND(v, v->tmp_frame, &entries[i]->frame);
+        PL_ARRAY_APPEND(v, v->tmp_ts, ts);
     }
 
     *mix = (struct pl_frame_mix) {
         .num_frames = 2,
-        .frames = p->tmp_frame.elem,
-        .signatures = p->tmp_sig.elem,
-        .timestamps = p->tmp_ts.elem,
-        .vsync_duration = p->vps.estimate / p->fps.estimate,
+        .frames = v->tmp_frame.elem,
+        .signatures = v->tmp_sig.elem,
+        .timestamps = v->tmp_ts.elem,
+        .vsync_duration = v->vps.estimate / p->fps.estimate,
     };
 
     PL_TRACE(p, "Oversampling 2 frames for target PTS %f:", params->pts);
     for (int i = 0; i < mix->num_frames; i++)
         PL_TRACE(p, "    id %"PRIu64" ts %f", mix->signatures[i], mix->timestamps[i]);
 
-    report_estimates(p);
+    report_estimates(v);
     return ret;
 }
 
 // Present a mixture of frames, relative to the vsync ratio
-static enum pl_queue_status interpolate(pl_queue p, struct pl_frame_mix *mix,
+static enum pl_queue_status interpolate(pl_queue_view v, struct pl_frame_mix *mix,
                                         const struct pl_queue_params *params)
 {
+    pl_queue p = v->parent;
     // No FPS estimate available, possibly source contains only a single frame,
     // or this is the first frame to be rendered. Fall back to point sampling.
     if (!p->fps.estimate)
-        return nearest(p, mix, params);
+        return nearest(v, mix, params);
 
     // Silently disable interpolation if the ratio dips lower than the
     // configured threshold
-    float ratio = fabs(p->fps.estimate / p->vps.estimate - 1.0);
+    float ratio = fabs(p->fps.estimate / v->vps.estimate - 1.0);
     if (ratio < params->interpolation_threshold) {
-        if (!p->threshold_frames) {
+        if (!v->threshold_frames) {
             PL_INFO(p, "Detected fps ratio %.4f below threshold %.4f, "
                     "disabling interpolation",
                     ratio, params->interpolation_threshold);
         }
 
-        p->threshold_frames = THRESHOLD_FRAMES + 1;
-        return nearest(p, mix, params);
-    } else if (ratio < THRESHOLD_MAX_RATIO && p->threshold_frames > 1) {
-        p->threshold_frames--;
-        return nearest(p, mix, params);
+        v->threshold_frames = THRESHOLD_FRAMES + 1;
+        return nearest(v, mix, params);
+    } else if (ratio < THRESHOLD_MAX_RATIO && v->threshold_frames > 1) {
+        v->threshold_frames--;
+        return nearest(v, mix, params);
     } else {
-        if (p->threshold_frames) {
+        if (v->threshold_frames) {
             PL_INFO(p, "Detected fps ratio %.4f exceeds threshold %.4f, "
                     "re-enabling interpolation",
                     ratio, params->interpolation_threshold);
         }
-        p->threshold_frames = 0;
+        v->threshold_frames = 0;
     }
 
     // No radius information, special case in which we only need the previous
     // and next frames.
     if (!params->radius)
-        return oversample(p, mix, params);
+        return oversample(v, mix, params);
 
-    pl_assert(p->fps.estimate && p->vps.estimate);
-    float radius = params->radius * fmaxf(1.0f, p->vps.estimate / p->fps.estimate);
+    pl_assert(p->fps.estimate && v->vps.estimate);
+    float radius = params->radius * fmaxf(1.0f, v->vps.estimate / p->fps.estimate);
     double min_pts = params->pts - radius * p->fps.estimate,
            max_pts = params->pts + radius * p->fps.estimate;
 
     enum pl_queue_status ret;
-    switch ((ret = advance(p, min_pts, params))) {
+    switch ((ret = advance(v, min_pts, params))) {
     case PL_QUEUE_ERR:
     case PL_QUEUE_EOF:
         return ret;
@@ -826,8 +1270,8 @@ static enum pl_queue_status interpolate(pl_queue p, struct pl_frame_mix *mix,
     }
 
     // Keep adding new frames until we've covered the range we care about
-    pl_assert(p->queue.num);
-    while (p->queue.elem[p->queue.num - 1]->pts < max_pts) {
+    pl_assert(v->queue.num);
+    while (v->queue.elem[v->queue.num - 1]->pts < max_pts) {
         switch ((ret = get_frame(p, params))) {
         case PL_QUEUE_ERR:
             return ret;
@@ -836,7 +1280,7 @@ static enum pl_queue_status interpolate(pl_queue p, struct pl_frame_mix *mix,
         case PL_QUEUE_EOF:;
             // Don't forward EOF until we've held the last frame for the
             // desired ZOH hold duration
-            double last_pts = p->queue.elem[p->queue.num - 1]->pts;
+            double last_pts = v->queue.elem[v->queue.num - 1]->pts;
             if (last_pts && params->pts >= last_pts + p->fps.estimate)
                 return ret;
             ret = PL_QUEUE_OK;
@@ -846,7 +1290,7 @@ static enum pl_queue_status interpolate(pl_queue p, struct pl_frame_mix *mix,
         }
     }
 
-    if (!entry_complete(p->queue.elem[p->queue.num - 1])) {
+    if (!entry_complete(v->queue.elem[v->queue.num - 1])) {
         switch ((ret = get_frame(p, params))) {
         case PL_QUEUE_MORE:
         case PL_QUEUE_OK:
@@ -865,25 +1309,25 @@ done: ;
     // Construct a mix object representing the current queue state, starting at
     // the last frame before `min_pts` to make sure there's a fallback frame
     // available for ZOH semantics.
-    p->tmp_sig.num = p->tmp_ts.num = p->tmp_frame.num = 0;
-    for (int i = 0; i < p->queue.num; i++) {
-        struct entry *entry = p->queue.elem[i];
+    v->tmp_sig.num = v->tmp_ts.num = v->tmp_frame.num = 0;
+    for (int i = 0; i < v->queue.num; i++) {
+        struct entry *entry = v->queue.elem[i];
         if (entry->pts > max_pts)
             break;
         if (!map_entry(p, entry))
             return PL_QUEUE_ERR;
         float ts = (entry->pts - params->pts) / p->fps.estimate;
-        PL_ARRAY_APPEND(p, p->tmp_sig, entry->signature);
-        PL_ARRAY_APPEND(p, p->tmp_frame, &entry->frame);
-        PL_ARRAY_APPEND(p, p->tmp_ts, ts);
+        PL_ARRAY_APPEND(v, v->tmp_sig, entry->signature);
+        PL_ARRAY_APPEND(v, v->tmp_frame, &entry->frame);
+        PL_ARRAY_APPEND(v, v->tmp_ts, ts);
     }
 
     *mix = (struct pl_frame_mix) {
-        .num_frames = p->tmp_frame.num,
-        .frames = p->tmp_frame.elem,
-        .signatures = p->tmp_sig.elem,
-        .timestamps = p->tmp_ts.elem,
-        .vsync_duration = p->vps.estimate / p->fps.estimate,
+        .num_frames = v->tmp_frame.num,
+        .frames = v->tmp_frame.elem,
+        .signatures = v->tmp_sig.elem,
+        .timestamps = v->tmp_ts.elem,
+        .vsync_duration = v->vps.estimate / p->fps.estimate,
     };
 
     PL_TRACE(p, "Showing mix of %d frames for target PTS %f:",
@@ -891,18 +1335,19 @@ done: ;
     for (int i = 0; i < mix->num_frames; i++)
         PL_TRACE(p, "    id %"PRIu64" ts %f", mix->signatures[i], mix->timestamps[i]);
 
-    report_estimates(p);
+    report_estimates(v);
     return ret;
 }
 
-static bool prefill(pl_queue p, const struct pl_queue_params *params)
+static bool prefill(pl_queue_view v, const struct pl_queue_params *params)
 {
+    pl_queue p = v->parent;
     int min_frames = 2 * ceilf(params->radius);
-    if (p->fps.estimate && p->vps.estimate && p->vps.estimate <= 1.0f / MIN_FPS)
-        min_frames *= ceilf(p->vps.estimate / p->fps.estimate);
+    if (p->fps.estimate && v->vps.estimate && v->vps.estimate <= 1.0f / MIN_FPS)
+        min_frames *= ceilf(v->vps.estimate / p->fps.estimate);
     min_frames = PL_MAX(min_frames, PREFETCH_FRAMES);
 
-    while (p->queue.num < min_frames) {
+    while (v->queue.num < min_frames) {
         switch (get_frame(p, params)) {
         case PL_QUEUE_ERR:
             return false;
@@ -919,34 +1364,35 @@ static bool prefill(pl_queue p, const struct pl_queue_params *params)
     // better than the alternative of missing the cache later, when timing is
     // more relevant.
     for (int i = 0; i < min_frames; i++) {
-        if (!map_entry(p, p->queue.elem[i]))
+        if (!map_entry(p, v->queue.elem[i]))
             return false;
     }
 
     return true;
 }
 
-enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
-                                     const struct pl_queue_params *params)
+// Must be called with both locks held
+static enum pl_queue_status view_update(pl_queue_view v, struct pl_frame_mix *out_mix,
+                                        const struct pl_queue_params *params)
 {
-    pl_mutex_lock(&p->lock_strong);
-    pl_mutex_lock(&p->lock_weak);
-    default_estimate(&p->vps, params->vsync_duration);
+    pl_queue p = v->parent;
+    ring_drain(p);
+    if (!v->active)
+        view_activate(v);
+    default_estimate(&v->vps, params->vsync_duration);
 
-    float delta = params->pts - p->prev_pts;
+    float delta = params->pts - v->prev_pts;
     if (delta < 0.0f) {
 
         // This is a backwards PTS jump. This is something we can handle
         // semi-gracefully, but only if we haven't culled past the current
         // frame yet.
-        if (p->queue.num && p->queue.elem[0]->pts > params->pts) {
+        if (v->queue.num && v->queue.elem[0]->pts > params->pts) {
             PL_ERR(p, "Requested PTS %f is lower than the oldest frame "
                    "PTS %f. This is not supported, PTS must be monotonically "
                    "increasing! Please use `pl_queue_reset` to reset the frame "
                    "queue on discontinuous PTS jumps.",
-                   params->pts, p->queue.elem[0]->pts);
-            pl_mutex_unlock(&p->lock_weak);
-            pl_mutex_unlock(&p->lock_strong);
+                   params->pts, v->queue.elem[0]->pts);
             return PL_QUEUE_ERR;
         }
 
@@ -956,64 +1402,152 @@ enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
         // discontinuous jump after a suspend. To prevent this from exploding
         // the FPS estimate, treat this as a new frame.
         PL_TRACE(p, "Discontinuous target PTS jump %f -> %f, ignoring...",
-                 p->prev_pts, params->pts);
+                 v->prev_pts, params->pts);
 
-    } else if (delta > 0) {
+    } else if (delta > 0 && !params->vrr) {
 
-        update_estimate(&p->vps, params->pts - p->prev_pts);
+        // In VRR mode, the PTS intervals follow the source rather than the
+        // display, so they say nothing about the vsync duration
+        update_estimate(&v->vps, params->pts - v->prev_pts);
 
     }
 
-    p->prev_pts = params->pts;
+    v->prev_pts = params->pts;
 
     // As a special case, prefill the queue if this is the first frame
-    if (!params->pts && !p->queue.num) {
-        if (!prefill(p, params)) {
-            pl_mutex_unlock(&p->lock_weak);
-            pl_mutex_unlock(&p->lock_strong);
+    if (!params->pts && !v->queue.num) {
+        if (!prefill(v, params))
             return PL_QUEUE_ERR;
-        }
     }
 
     // Ignore unrealistically high or low FPS, common near start of playback
     static const float max_vsync = 1.0 / MIN_FPS;
     static const float min_vsync = 1.0 / MAX_FPS;
-    bool estimation_ok = p->vps.estimate > min_vsync && p->vps.estimate < max_vsync;
+    bool estimation_ok = v->vps.estimate > min_vsync && v->vps.estimate < max_vsync;
     enum pl_queue_status ret;
 
-    if (estimation_ok || params->vsync_duration > 0) {
+    if (params->vrr) {
+        // Each frame is presented once, at its own PTS, so no mixing needed
+        ret = vrr(v, out_mix, params);
+    } else if (estimation_ok || params->vsync_duration > 0) {
         // We know the vsync duration, so construct an interpolation mix
-        ret = interpolate(p, out_mix, params);
+        ret = interpolate(v, out_mix, params);
     } else {
         // We don't know the vsync duration (yet), so just point-sample
-        ret = nearest(p, out_mix, params);
+        ret = nearest(v, out_mix, params);
     }
 
+    queue_gc(p);
+    update_lookahead(p, params);
     pl_cond_signal(&p->wakeup);
+    return ret;
+}
+
+enum pl_queue_status pl_queue_update(pl_queue p, struct pl_frame_mix *out_mix,
+                                     const struct pl_queue_params *params)
+{
+    pl_mutex_lock(&p->lock_strong);
+    pl_mutex_lock(&p->lock_weak);
+    p->quality.vsync_hint = params->vsync_duration;
+    p->quality.cb = params->quality_cb;
+    p->quality.priv = params->priv;
+    enum pl_queue_status ret = view_update(p->main, out_mix, params);
     pl_mutex_unlock(&p->lock_weak);
     pl_mutex_unlock(&p->lock_strong);
     return ret;
 }
 
-float pl_queue_estimate_fps(pl_queue p)
+pl_queue_view pl_queue_view_create(pl_queue p)
 {
+    pl_mutex_lock(&p->lock_strong);
     pl_mutex_lock(&p->lock_weak);
-    float estimate = p->fps.estimate;
+    pl_queue_view v = view_alloc(p);
+    view_activate(v);
+    pl_mutex_unlock(&p->lock_weak);
+    pl_mutex_unlock(&p->lock_strong);
+    return v;
+}
+
+void pl_queue_view_destroy(pl_queue_view *view)
+{
+    pl_queue_view v = *view;
+    if (!v)
+        return;
+
+    pl_queue p = v->parent;
+    pl_mutex_lock(&p->lock_strong);
+    pl_mutex_lock(&p->lock_weak);
+    view_cull(v, v->queue.num);
+    for (int i = 0; i < p->views.num; i++) {
+        if (p->views.elem[i] == v) {
+            PL_ARRAY_REMOVE_AT(p->views, i);
+            break;
+        }
+    }
+    queue_gc(p);
+    pl_cond_signal(&p->wakeup);
+    pl_mutex_unlock(&p->lock_weak);
+    pl_mutex_unlock(&p->lock_strong);
+    pl_free(v);
+    *view = NULL;
+}
+
+enum pl_queue_status pl_queue_view_update(pl_queue_view v, struct pl_frame_mix *out_mix,
+                                          const struct pl_queue_params *params)
+{
+    pl_queue p = v->parent;
+    pl_mutex_lock(&p->lock_strong);
+    pl_mutex_lock(&p->lock_weak);
+    enum pl_queue_status ret = view_update(v, out_mix, params);
+    pl_mutex_unlock(&p->lock_weak);
+    pl_mutex_unlock(&p->lock_strong);
+    return ret;
+}
+
+float pl_queue_view_estimate_vps(pl_queue_view v)
+{
+    pl_queue p = v->parent;
+    pl_mutex_lock(&p->lock_weak);
+    float estimate = v->vps.estimate;
     pl_mutex_unlock(&p->lock_weak);
     return estimate ? 1.0f / estimate : 0.0f;
 }
 
-float pl_queue_estimate_vps(pl_queue p)
+bool pl_queue_view_vrr_timing(pl_queue_view v, double *frame_pts, double *next_pts)
+{
+    pl_queue p = v->parent;
+    pl_mutex_lock(&p->lock_weak);
+    bool ok = v->vrr_valid;
+    if (ok && frame_pts)
+        *frame_pts = v->vrr_pts;
+    if (ok && next_pts)
+        *next_pts = v->vrr_next_pts;
+    pl_mutex_unlock(&p->lock_weak);
+    return ok;
+}
+
+float pl_queue_estimate_fps(pl_queue p)
 {
     pl_mutex_lock(&p->lock_weak);
-    float estimate = p->vps.estimate;
+    float estimate = p->fps.estimate;
     pl_mutex_unlock(&p->lock_weak);
     return estimate ? 1.0f / estimate : 0.0f;
 }
 
+float pl_queue_estimate_vps(pl_queue p)
+{
+    return pl_queue_view_estimate_vps(p->main);
+}
+
+bool pl_queue_vrr_timing(pl_queue p, double *frame_pts, double *next_pts)
+{
+    return pl_queue_view_vrr_timing(p->main, frame_pts, next_pts);
+}
+
 int pl_queue_num_frames(pl_queue p)
 {
     pl_mutex_lock(&p->lock_weak);
+    ring_drain(p);
     int count = p->queue.num;
     pl_mutex_unlock(&p->lock_weak);
     return count;
@@ -1022,9 +1556,99 @@ int pl_queue_num_frames(pl_queue p)
 bool pl_queue_peek(pl_queue p, int idx, struct pl_source_frame *out)
 {
     pl_mutex_lock(&p->lock_weak);
+    ring_drain(p);
     bool ok = idx >= 0 && idx < p->queue.num;
     if (ok)
         *out = p->queue.elem[idx]->src;
     pl_mutex_unlock(&p->lock_weak);
     return ok;
 }
+
+void pl_queue_render_info(void *priv, const struct pl_render_info *info)
+{
+    pl_queue p = priv;
+    if (info->pass->skipped)
+        return;
+
+    pl_mutex_lock(&p->lock_weak);
+    p->quality.frame_ns += info->pass->last;
+    pl_mutex_unlock(&p->lock_weak);
+}
+
+static void quality_apply(enum pl_queue_quality level, struct pl_render_params *params)
+{
+    if (level >= PL_QUEUE_QUALITY_NO_MIXER)
+        params->frame_mixer = NULL;
+    if (level >= PL_QUEUE_QUALITY_FAST_SCALING) {
+        params->upscaler = params->downscaler = NULL;
+        params->plane_upscaler = params->plane_downscaler = NULL;
+    }
+    if (level >= PL_QUEUE_QUALITY_NO_PEAK_DETECT)
+        params->peak_detect_params = NULL;
+}
+
+enum pl_queue_quality pl_queue_adapt_params(pl_queue p, struct pl_render_params *params)
+{
+    pl_mutex_lock(&p->lock_weak);
+    float frame_time = p->quality.frame_ns * 1e-9f;
+    p->quality.frame_ns = 0;
+    if (frame_time > 0) {
+        float *ema = &p->quality.render_time;
+        *ema = *ema ? *ema + (frame_time - *ema) * QUALITY_EMA_WEIGHT : frame_time;
+    }
+
+    // Prefer the measured vsync duration over the user-provided hint
+    static const float max_vsync = 1.0 / MIN_FPS;
+    static const float min_vsync = 1.0 / MAX_FPS;
+    float budget = p->quality.vsync_hint;
+    if (p->main->vps.estimate > min_vsync && p->main->vps.estimate < max_vsync)
+        budget = p->main->vps.estimate;
+
+    const enum pl_queue_quality prev_level = p->quality.level;
+    enum pl_queue_quality level = prev_level;
+    float render_time = p->quality.render_time;
+    if (p->quality.settle_frames > 0) {
+        p->quality.settle_frames--;
+    } else if (budget > 0 && render_time > 0) {
+        if (render_time > QUALITY_OVERLOAD_RATIO * budget) {
+            p->quality.headroom_frames = 0;
+            if (level + 1 < PL_QUEUE_QUALITY_COUNT)
+                level++;
+        } else if (render_time < QUALITY_HEADROOM_RATIO * budget) {
+            if (++p->quality.headroom_frames >= QUALITY_RECOVER_FRAMES && level > 0)
+                level--;
+        } else {
+            p->quality.headroom_frames = 0;
+        }
+    }
+
+    void (*cb)(void *priv, const struct pl_queue_quality_info *info) = NULL;
+    void *cb_priv = NULL;
+    if (level != prev_level) {
+        PL_INFO(p, "Render time %.2f ms %s vsync budget %.2f ms, %s quality "
+                "to level %d", render_time * 1e3, level > prev_level ? ">" : "<",
+                budget * 1e3, level > prev_level ? "lowering" : "raising",
+                (int) level);
+
+        // Re-measure from scratch at the new level
+        p->quality.level = level;
+        p->quality.render_time = 0;
+        p->quality.headroom_frames = 0;
+        p->quality.settle_frames = QUALITY_SETTLE_FRAMES;
+        cb = p->quality.cb;
+        cb_priv = p->quality.priv;
+    }
+    pl_mutex_unlock(&p->lock_weak);
+
+    if (cb) {
+        cb(cb_priv, &(struct pl_queue_quality_info) {
+            .level = level,
+            .prev_level = prev_level,
+            .render_time = render_time,
+            .budget = budget,
+        });
+    }
+
+    quality_apply(level, params);
+    return level;
+}
@@ -18,6 +18,9 @@
 #include "log.h"
 #include "common.h"
 #include "gpu.h"
+#include "shaders.h"
+#include "pl_memcpy.h"
+#include "pl_thread.h"
 
 #include <libplacebo/utils/upload.h>
 
@@ -166,6 +169,19 @@ misaligned:
     return false;
 }
 
+// Upper bound on the number of distinct plane shapes to remember
+#define PLANE_FMT_CACHE_SIZE 64
+
+static uint64_t plane_fmt_key(const struct pl_plane_data *data)
+{
+    uint64_t key = data->type;
+    pl_hash_merge(&key, data->pixel_stride);
+    pl_hash_merge(&key, pl_var_hash(data->component_size));
+    pl_hash_merge(&key, pl_var_hash(data->component_pad));
+    pl_hash_merge(&key, pl_var_hash(data->component_map));
+    return key;
+}
+
 pl_fmt pl_plane_find_fmt(pl_gpu gpu, int out_map[4], const struct pl_plane_data *data)
 {
     int dummy[4] = {0};
@@ -183,8 +199,31 @@ pl_fmt pl_plane_find_fmt(pl_gpu gpu, int out_map[4], const struct pl_plane_data
             num = i+1;
     }
 
+    // The result only depends on the shape of the plane (and the row stride
+    // alignment, which is checked separately), so look it up in the cache
+    struct pl_gpu_fns *impl = PL_PRIV(gpu);
+    const uint64_t key = plane_fmt_key(data);
+    pl_fmt fmt = NULL;
+    bool found = false;
+    pl_mutex_lock(&impl->fmt_lock);
+    for (int i = 0; i < impl->plane_fmts.num; i++) {
+        const struct pl_plane_fmt *entry = &impl->plane_fmts.elem[i];
+        if (entry->key != key)
+            continue;
+        if (!entry->fmt || data->row_stride % entry->fmt->texel_align == 0) {
+            fmt = entry->fmt;
+            memcpy(out_map, entry->map, sizeof(entry->map));
+            found = true;
+        }
+        break;
+    }
+    pl_mutex_unlock(&impl->fmt_lock);
+    if (found)
+        return fmt;
+
+    bool misaligned = false;
     for (int n = 0; n < gpu->num_formats; n++) {
-        pl_fmt fmt = gpu->formats[n];
+        fmt = gpu->formats[n];
         if (fmt->opaque || fmt->num_components < num)
             continue;
         if (fmt->type != data->type || fmt->texel_size != data->pixel_stride)
@@ -217,32 +256,134 @@ pl_fmt pl_plane_find_fmt(pl_gpu gpu, int out_map[4], const struct pl_plane_data
                     "Row stride %zu is not a clean multiple of texel size %zu! "
                     "This is likely an API usage bug.",
                     fmt->name, data->row_stride, fmt->texel_align);
+            misaligned = true;
             continue;
         }
 
-        return fmt;
+        goto done;
 
 next_fmt: ; // acts as `continue`
     }
 
-    return NULL;
+    fmt = NULL;
+
+done:
+    // Only remember results that were not affected by the row stride
+    if (!misaligned) {
+        pl_mutex_lock(&impl->fmt_lock);
+        if (impl->plane_fmts.num >= PLANE_FMT_CACHE_SIZE)
+            impl->plane_fmts.num = 0;
+        struct pl_plane_fmt new = { .key = key, .fmt = fmt };
+        memcpy(new.map, out_map, sizeof(new.map));
+        PL_ARRAY_APPEND((void *) gpu, impl->plane_fmts, new);
+        pl_mutex_unlock(&impl->fmt_lock);
+    }
+
+    return fmt;
 }
 
-bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
-                     pl_tex *tex, const struct pl_plane_data *data)
+#define DEFAULT_POOL_SIZE 16
+
+struct pl_tex_pool_t {
+    pl_gpu gpu;
+    pl_mutex lock;
+    int max_textures;
+    PL_ARRAY(pl_tex) textures; // unused textures, oldest first
+};
+
+pl_tex_pool pl_tex_pool_create(pl_gpu gpu, int max_textures)
 {
-    pl_assert(!data->buf ^ !data->pixels); // exactly one
+    pl_tex_pool pool = pl_zalloc_ptr(NULL, pool);
+    pool->gpu = gpu;
+    pool->max_textures = PL_DEF(max_textures, DEFAULT_POOL_SIZE);
+    pl_mutex_init(&pool->lock);
+    return pool;
+}
 
+void pl_tex_pool_destroy(pl_tex_pool *ppool)
+{
+    pl_tex_pool pool = *ppool;
+    if (!pool)
+        return;
+
+    for (int i = 0; i < pool->textures.num; i++)
+        pl_tex_destroy(pool->gpu, &pool->textures.elem[i]);
+    pl_mutex_destroy(&pool->lock);
+    pl_free(pool);
+    *ppool = NULL;
+}
+
+void pl_tex_pool_put(pl_tex_pool pool, pl_tex *tex)
+{
+    if (!*tex)
+        return;
+
+    pl_mutex_lock(&pool->lock);
+    if (pool->textures.num == pool->max_textures) {
+        pl_tex_destroy(pool->gpu, &pool->textures.elem[0]);
+        PL_ARRAY_REMOVE_AT(pool->textures, 0);
+    }
+    PL_ARRAY_APPEND(pool, pool->textures, *tex);
+    pl_mutex_unlock(&pool->lock);
+    *tex = NULL;
+}
+
+bool pl_tex_pool_recreate(pl_tex_pool pool, pl_tex *tex,
+                          const struct pl_tex_params *params)
+{
+    pl_gpu gpu = pool->gpu;
+    if (*tex && pl_tex_params_superset((*tex)->params, *params))
+        return pl_tex_recreate(gpu, tex, params); // no-op, but validates params
+
+    pl_tex_pool_put(pool, tex);
+
+    // Prefer the most recently returned texture that the GPU is done with,
+    // but fall back to a busy one rather than growing beyond the pool size
+    pl_mutex_lock(&pool->lock);
+    int found = -1;
+    for (int i = pool->textures.num - 1; i >= 0; i--) {
+        pl_tex t = pool->textures.elem[i];
+        if (!pl_tex_params_superset(t->params, *params))
+            continue;
+        if (!pl_tex_poll(gpu, t, 0)) {
+            found = i;
+            break;
+        }
+        if (found < 0 && pool->textures.num == pool->max_textures)
+            found = i;
+    }
+
+    if (found >= 0) {
+        *tex = pool->textures.elem[found];
+        PL_ARRAY_REMOVE_AT(pool->textures, found);
+    }
+    pl_mutex_unlock(&pool->lock);
+
+    return pl_tex_recreate(gpu, tex, params);
+}
+
+static bool plane_recreate(pl_gpu gpu, pl_tex_pool pool, pl_tex *tex,
+                           const struct pl_tex_params *params)
+{
+    if (pool)
+        return pl_tex_pool_recreate(pool, tex, params);
+    return pl_tex_recreate(gpu, tex, params);
+}
+
+// (Re)creates the texture for uploading `data`, returning its format
+static pl_fmt upload_plane_tex(pl_gpu gpu, struct pl_plane *out_plane,
+                               pl_tex *tex, const struct pl_plane_data *data)
+{
     int out_map[4];
     pl_fmt fmt = pl_plane_find_fmt(gpu, out_map, data);
     if (!fmt) {
         PL_ERR(gpu, "Failed picking any compatible texture format for a plane!");
-        return false;
+        return NULL;
 
         // TODO: try soft-converting to a supported format using e.g zimg?
     }
 
-    bool ok = pl_tex_recreate(gpu, tex, pl_tex_params(
+    bool ok = plane_recreate(gpu, data->pool, tex, pl_tex_params(
         .w = data->width,
         .h = data->height,
         .format = fmt,
@@ -253,7 +394,7 @@ bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
 
     if (!ok) {
         PL_ERR(gpu, "Failed initializing plane texture!");
-        return false;
+        return NULL;
     }
 
     if (out_plane) {
@@ -266,6 +407,19 @@ bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
         }
     }
 
+    return fmt;
+}
+
+bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
+                     pl_tex *tex, const struct pl_plane_data *data)
+{
+    pl_assert(!data->buf ^ !data->pixels); // exactly one
+
+    pl_fmt fmt = upload_plane_tex(gpu, out_plane, tex, data);
+    if (!fmt)
+        return false;
+
+    bool ok;
     struct pl_tex_transfer_params params = {
         .tex        = *tex,
         .rc.x1      = data->width, // set these for `pl_tex_transfer_size`
@@ -279,8 +433,31 @@ bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
         .priv       = data->priv,
     };
 
+    // Swap host data on the CPU while copying it into a staging buffer, which
+    // avoids both the dedicated storage buffer and the compute pass
+    const int wordsize = fmt->texel_size / fmt->num_components;
+    struct pl_gpu_ring_alloc ring;
+    bool staged = false;
+    if (data->swapped && params.ptr && gpu->limits.buf_transfer &&
+        (wordsize == 2 || wordsize == 4))
+    {
+        const size_t size = pl_tex_transfer_size(&params);
+        size_t align = PL_MAX(gpu->limits.align_tex_xfer_offset, 4);
+        align = pl_lcm(align, fmt->texel_size);
+        staged = pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, size, align, &ring);
+        if (staged) {
+            pl_memcpy_swap(ring.data, params.ptr, size, wordsize);
+            if (params.callback)
+                params.callback(params.priv);
+            params.callback = NULL;
+            params.ptr = NULL;
+            params.buf = ring.buf;
+            params.buf_offset = ring.offset;
+        }
+    }
+
     pl_buf swapbuf = NULL;
-    if (data->swapped) {
+    if (data->swapped && !staged) {
         const size_t aligned = PL_ALIGN2(pl_tex_transfer_size(&params), 4);
         swapbuf = pl_buf_create(gpu, pl_buf_params(
             .size           = aligned,
@@ -300,7 +477,7 @@ bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
             .src        = swapbuf,
             .dst        = swapbuf,
             .size       = aligned,
-            .wordsize   = fmt->texel_size / fmt->num_components,
+            .wordsize   = wordsize,
         };
 
         bool can_reuse = params.buf && params.buf->params.storable &&
@@ -332,11 +509,110 @@ bool pl_upload_plane(pl_gpu gpu, struct pl_plane *out_plane,
         params.buf_offset = 0;
     }
 
-    ok = pl_tex_upload(gpu, &params);
+    // For asynchronous uploads from host memory, go through the PBO helper
+    // directly whenever the GPU can import host pointers, so the pixel data
+    // is read in-place instead of being copied to a staging buffer first.
+    // The helper falls back to a regular memcpy if the import fails.
+    bool can_import = gpu->import_caps.buf & PL_HANDLE_HOST_PTR;
+    can_import &= gpu->limits.buf_transfer;
+    can_import &= params.ptr && params.callback;
+    can_import &= pl_tex_transfer_size(&params) <= gpu->limits.max_buf_size;
+    if (can_import) {
+        ok = pl_tex_upload_pbo(gpu, &params);
+    } else {
+        ok = pl_tex_upload(gpu, &params);
+    }
+
+    if (staged)
+        pl_gpu_ring_done(gpu, &ring);
     pl_buf_destroy(gpu, &swapbuf);
     return ok;
 }
 
+bool pl_upload_planes(pl_gpu gpu, struct pl_plane out_planes[], pl_tex tex[],
+                      const struct pl_plane_data data[], int num_planes)
+{
+    pl_assert(num_planes > 0 && num_planes <= 4);
+
+    // Only host memory can be coalesced, and planes which are either swapped
+    // or eligible for host pointer import are better served individually
+    bool coalesce = gpu->limits.buf_transfer && num_planes > 1;
+    for (int p = 0; p < num_planes; p++) {
+        pl_assert(!data[p].buf ^ !data[p].pixels); // exactly one
+        coalesce &= data[p].pixels && !data[p].swapped;
+        coalesce &= !data[p].callback || !(gpu->import_caps.buf & PL_HANDLE_HOST_PTR);
+    }
+
+    if (!coalesce)
+        goto fallback;
+
+    size_t offsets[4], pitches[4], total = 0, align = 4;
+    pl_fmt fmts[4];
+    for (int p = 0; p < num_planes; p++) {
+        struct pl_plane *out_plane = out_planes ? &out_planes[p] : NULL;
+        fmts[p] = upload_plane_tex(gpu, out_plane, &tex[p], &data[p]);
+        if (!fmts[p])
+            goto fallback; // for consistent error semantics
+
+        const size_t texel = fmts[p]->texel_size;
+        const size_t pitch_align = PL_DEF(gpu->limits.align_tex_xfer_pitch, 1);
+        size_t plane_align = PL_MAX(gpu->limits.align_tex_xfer_offset, 4);
+        plane_align = pl_lcm(plane_align, texel);
+        align = pl_lcm(align, plane_align);
+        pitches[p] = PL_ALIGN(data[p].width * texel, pl_lcm(pitch_align, texel));
+        offsets[p] = PL_ALIGN(total, plane_align);
+        total = offsets[p] + pitches[p] * data[p].height;
+    }
+
+    struct pl_gpu_ring_alloc ring;
+    if (!pl_gpu_ring_alloc(gpu, PL_GPU_RING_UPLOAD, total, align, &ring)) {
+        PL_TRACE(gpu, "Failed allocating %zu bytes of staging memory for "
+                 "coalesced plane upload, uploading planes separately", total);
+        goto fallback;
+    }
+
+    // Do all host->staging copies up-front, so the transfers below can all
+    // be recorded back-to-back and submitted together
+    for (int p = 0; p < num_planes; p++) {
+        const size_t row_size = data[p].width * fmts[p]->texel_size;
+        const size_t stride = PL_DEF(data[p].row_stride, row_size);
+        const uint8_t *src = data[p].pixels;
+        uint8_t *dst = ring.data + offsets[p];
+        if (stride == pitches[p]) {
+            memcpy(dst, src, pitches[p] * (data[p].height - 1) + row_size);
+        } else {
+            for (int y = 0; y < data[p].height; y++)
+                memcpy(dst + y * pitches[p], src + y * stride, row_size);
+        }
+    }
+
+    bool ok = true;
+    for (int p = 0; ok && p < num_planes; p++) {
+        ok = pl_tex_upload(gpu, pl_tex_transfer_params(
+            .tex        = tex[p],
+            .row_pitch  = pitches[p],
+            .buf        = ring.buf,
+            .buf_offset = ring.offset + offsets[p],
+        ));
+
+        // The host memory is no longer needed, so release it immediately
+        if (ok && data[p].callback)
+            data[p].callback(data[p].priv);
+    }
+
+    pl_gpu_ring_done(gpu, &ring);
+    return ok;
+
+fallback:
+    for (int p = 0; p < num_planes; p++) {
+        struct pl_plane *out_plane = out_planes ? &out_planes[p] : NULL;
+        if (!pl_upload_plane(gpu, out_plane, &tex[p], &data[p]))
+            return false;
+    }
+
+    return true;
+}
+
 bool pl_recreate_plane(pl_gpu gpu, struct pl_plane *out_plane,
                        pl_tex *tex, const struct pl_plane_data *data)
 {
@@ -353,7 +629,7 @@ bool pl_recreate_plane(pl_gpu gpu, struct pl_plane *out_plane,
         return false;
     }
 
-    bool ok = pl_tex_recreate(gpu, tex, pl_tex_params(
+    bool ok = plane_recreate(gpu, data->pool, tex, pl_tex_params(
         .w = data->width,
         .h = data->height,
         .format = fmt,
@@ -380,3 +656,258 @@ bool pl_recreate_plane(pl_gpu gpu, struct pl_plane *out_plane,
 
     return true;
 }
+
+const struct pl_packed_layout pl_packed_v210 = {
+    .group_pixels = 6,
+    .group_size   = 16,
+    .num_planes   = 3,
+    .num_samples  = 12,
+    .samples = {
+        {1, 0,  0, 10}, {0, 0,  10, 10}, {2, 0,  20, 10},
+        {0, 1, 32, 10}, {1, 1,  42, 10}, {0, 2,  52, 10},
+        {2, 1, 64, 10}, {0, 3,  74, 10}, {1, 2,  84, 10},
+        {0, 4, 96, 10}, {2, 2, 106, 10}, {0, 5, 116, 10},
+    },
+};
+
+const struct pl_packed_layout pl_packed_y210 = {
+    .group_pixels = 2,
+    .group_size   = 8,
+    .num_planes   = 3,
+    .num_samples  = 4,
+    .samples = {
+        {0, 0, 6, 10}, {1, 0, 22, 10}, {0, 1, 38, 10}, {2, 0, 54, 10},
+    },
+};
+
+// Number of samples per group (i.e. maximum `x` + 1) of a given plane
+static int packed_plane_pixels(const struct pl_packed_layout *layout, int plane)
+{
+    int num = 0;
+    for (int i = 0; i < layout->num_samples; i++) {
+        if (layout->samples[i].plane == plane)
+            num = PL_MAX(num, layout->samples[i].x + 1);
+    }
+    return num;
+}
+
+static pl_fmt packed_plane_fmt(pl_gpu gpu, const struct pl_packed_layout *layout,
+                               int plane)
+{
+    int bits = 0;
+    for (int i = 0; i < layout->num_samples; i++) {
+        if (layout->samples[i].plane == plane)
+            bits = PL_MAX(bits, layout->samples[i].bits);
+    }
+
+    return pl_find_fmt(gpu, PL_FMT_UNORM, 1, bits, 0,
+                       PL_FMT_CAP_SAMPLEABLE | PL_FMT_CAP_STORABLE);
+}
+
+static bool packed_layout_valid(const struct pl_packed_layout *layout)
+{
+    if (layout->group_pixels <= 0 || layout->group_size <= 0 ||
+        layout->group_size % sizeof(uint32_t))
+        return false;
+    if (layout->num_planes <= 0 || layout->num_planes > 4)
+        return false;
+    if (layout->num_samples <= 0 || layout->num_samples > PL_PACKED_MAX_SAMPLES)
+        return false;
+
+    for (int i = 0; i < layout->num_samples; i++) {
+        const struct pl_packed_sample *smp = &layout->samples[i];
+        if (smp->plane < 0 || smp->plane >= layout->num_planes || smp->x < 0)
+            return false;
+        if (smp->bits <= 0 || smp->bits > 16 || smp->offset < 0)
+            return false;
+        if (smp->offset + smp->bits > layout->group_size * 8)
+            return false;
+        if (smp->offset % 32 + smp->bits > 32)
+            return false; // straddles two words
+    }
+
+    for (int p = 0; p < layout->num_planes; p++) {
+        if (!packed_plane_pixels(layout, p))
+            return false;
+    }
+
+    return true;
+}
+
+bool pl_packed_upload_supported(pl_gpu gpu, const struct pl_packed_layout *layout)
+{
+    if (!gpu->glsl.compute || !gpu->limits.max_ssbo_size)
+        return false;
+    if (!packed_layout_valid(layout))
+        return false;
+
+    for (int p = 0; p < layout->num_planes; p++) {
+        if (!packed_plane_fmt(gpu, layout, p))
+            return false;
+    }
+
+    return true;
+}
+
+bool pl_upload_packed(pl_gpu gpu, struct pl_plane out_planes[], pl_tex tex[],
+                      const struct pl_packed_data *data)
+{
+    pl_assert(!data->buf ^ !data->pixels); // exactly one
+    const struct pl_packed_layout *layout = data->layout;
+    if (!pl_packed_upload_supported(gpu, layout)) {
+        PL_ERR(gpu, "Packed upload unsupported, requires compute shaders and "
+               "storable single-channel UNORM formats (or invalid layout)!");
+        return false;
+    }
+
+    pl_buf buf = data->buf, tmpbuf = NULL;
+    size_t offset = data->buf_offset;
+    pl_require(gpu, data->width > 0 && data->height > 0);
+
+    const int groups = PL_DIV_UP(data->width, layout->group_pixels);
+    const size_t row_size = (size_t) groups * layout->group_size;
+    const size_t size = (data->height - 1) * data->row_stride + row_size;
+    pl_require(gpu, data->row_stride >= row_size);
+    pl_require(gpu, data->row_stride % sizeof(uint32_t) == 0);
+    pl_require(gpu, offset % sizeof(uint32_t) == 0);
+
+    if (!buf) {
+        tmpbuf = buf = pl_buf_create(gpu, pl_buf_params(
+            .size           = size,
+            .storable       = true,
+            .initial_data   = data->pixels,
+        ));
+        offset = 0;
+        if (!buf) {
+            PL_ERR(gpu, "Failed creating buffer for packed upload!");
+            return false;
+        }
+    }
+
+    pl_require(gpu, buf->params.storable);
+    pl_require(gpu, offset + size <= buf->params.size);
+    pl_require(gpu, offset + size <= gpu->limits.max_ssbo_size);
+
+    int plane_w[4], plane_px[4];
+    for (int p = 0; p < layout->num_planes; p++) {
+        plane_px[p] = packed_plane_pixels(layout, p);
+        plane_w[p] = PL_DIV_UP(data->width * plane_px[p], layout->group_pixels);
+        pl_fmt fmt = packed_plane_fmt(gpu, layout, p);
+        bool ok = plane_recreate(gpu, NULL, &tex[p], pl_tex_params(
+            .w              = plane_w[p],
+            .h              = data->height,
+            .format         = fmt,
+            .sampleable     = true,
+            .storable       = true,
+            .host_readable  = fmt->caps & PL_FMT_CAP_HOST_READABLE,
+            .blit_src       = fmt->caps & PL_FMT_CAP_BLITTABLE,
+        ));
+
+        if (!ok) {
+            PL_ERR(gpu, "Failed initializing plane texture!");
+            goto error;
+        }
+
+        if (out_planes) {
+            out_planes[p].texture = tex[p];
+            out_planes[p].components = 1;
+            out_planes[p].component_mapping[0] = p;
+            for (int c = 1; c < 4; c++)
+                out_planes[p].component_mapping[c] = PL_CHANNEL_NONE;
+        }
+    }
+
+    const int threads = PL_MIN(256, groups);
+    pl_dispatch dp = pl_gpu_dispatch(gpu);
+    pl_shader sh = pl_dispatch_begin(dp);
+    if (!sh_try_compute(sh, threads, 1, false, 0)) {
+        PL_ERR(gpu, "Failed dispatching packed upload shader!");
+        pl_dispatch_abort(dp, &sh);
+        goto error;
+    }
+
+    const size_t words = (offset + size) / sizeof(uint32_t);
+    sh_desc(sh, (struct pl_shader_desc) {
+        .binding.object = buf,
+        .desc = {
+            .name = "PackedBuf",
+            .type = PL_DESC_BUF_STORAGE,
+            .access = PL_DESC_ACCESS_READONLY,
+        },
+        .num_buffer_vars = 1,
+        .buffer_vars = &(struct pl_buffer_var) {
+            .var = {
+                .name = "src_words",
+                .type = PL_VAR_UINT,
+                .dim_v = 1,
+                .dim_m = 1,
+                .dim_a = words,
+            },
+        },
+    });
+
+    ident_t img[4];
+    for (int p = 0; p < layout->num_planes; p++) {
+        img[p] = sh_desc(sh, (struct pl_shader_desc) {
+            .binding.object = tex[p],
+            .desc = {
+                .name = "plane",
+                .type = PL_DESC_STORAGE_IMG,
+                .access = PL_DESC_ACCESS_WRITEONLY,
+            },
+        });
+    }
+
+    GLSL("// pl_upload_packed \n");
+    if (groups % threads) {
+        GLSL("if (gl_GlobalInvocationID.x >= %d) \n"
+             "    return;                        \n",
+             groups);
+    }
+
+    GLSL("uint base = "$" + gl_GlobalInvocationID.y * "$" +        \n"
+         "            gl_GlobalInvocationID.x * "$";                \n"
+         "int gx = int(gl_GlobalInvocationID.x);                    \n"
+         "int y = int(gl_GlobalInvocationID.y);                     \n"
+         "uint word;                                                \n",
+         SH_UINT_DYN(offset / sizeof(uint32_t)),
+         SH_UINT(data->row_stride / sizeof(uint32_t)),
+         SH_UINT(layout->group_size / sizeof(uint32_t)));
+
+    ident_t scale[17] = {0}; // indexed by sample bits
+    int cur_word = -1;
+    for (int i = 0; i < layout->num_samples; i++) {
+        const struct pl_packed_sample *smp = &layout->samples[i];
+        if (smp->offset / 32 != cur_word) {
+            cur_word = smp->offset / 32;
+            GLSL("word = src_words[base + %du]; \n", cur_word);
+        }
+
+        const int p = smp->plane;
+        const unsigned mask = (1u << smp->bits) - 1;
+        if (!scale[smp->bits])
+            scale[smp->bits] = SH_FLOAT(1.0 / mask);
+        if (groups * plane_px[p] != plane_w[p])
+            GLSL("if (gx * %d + %d < %d) \n", plane_px[p], smp->x, plane_w[p]);
+        GLSL("imageStore("$", ivec2(gx * %d + %d, y),                       \n"
+             "           vec4(float((word >> %du) & %uu) * "$"));           \n",
+             img[p], plane_px[p], smp->x, smp->offset % 32, mask,
+             scale[smp->bits]);
+    }
+
+    bool ok = pl_dispatch_compute(dp, pl_dispatch_compute_params(
+        .shader = &sh,
+        .dispatch_size = {
+            PL_DIV_UP(groups, threads),
+            data->height,
+            1,
+        },
+    ));
+
+    pl_buf_destroy(gpu, &tmpbuf);
+    return ok;
+
+error:
+    pl_buf_destroy(gpu, &tmpbuf);
+    return false;
+}
@@ -199,12 +199,18 @@ void vk_cmd_barrier(struct vk_cmd *cmd, const VkDependencyInfo *info)
 
     pl_assert(!info->pNext);
     pl_assert(info->memoryBarrierCount == 0);
-    pl_assert(info->bufferMemoryBarrierCount + info->imageMemoryBarrierCount == 1);
 
-    if (info->bufferMemoryBarrierCount) {
-
-        const VkBufferMemoryBarrier2 *barr2 = info->pBufferMemoryBarriers;
-        const VkBufferMemoryBarrier barr = {
+    // Legacy barriers only have a single set of stage masks, so merge the
+    // stages of all barriers together
+    VkPipelineStageFlags2 src_stage = 0, dst_stage = 0;
+    void *tmp = pl_tmp(NULL);
+    VkBufferMemoryBarrier *bufs;
+    bufs = pl_calloc_ptr(tmp, info->bufferMemoryBarrierCount, bufs);
+    for (uint32_t i = 0; i < info->bufferMemoryBarrierCount; i++) {
+        const VkBufferMemoryBarrier2 *barr2 = &info->pBufferMemoryBarriers[i];
+        src_stage |= barr2->srcStageMask;
+        dst_stage |= barr2->dstStageMask;
+        bufs[i] = (VkBufferMemoryBarrier) {
             .sType               = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER,
             .pNext               = barr2->pNext,
             .srcAccessMask       = lower_access2(barr2->srcAccessMask),
@@ -215,16 +221,15 @@ void vk_cmd_barrier(struct vk_cmd *cmd, const VkDependencyInfo *info)
             .offset              = barr2->offset,
             .size                = barr2->size,
         };
+    }
 
-        vk->CmdPipelineBarrier(cmd->buf, lower_stage2(barr2->srcStageMask),
-                               lower_stage2(barr2->dstStageMask),
-                               info->dependencyFlags,
-                               0, NULL, 1, &barr, 0, NULL);
-
-    } else {
-
-        const VkImageMemoryBarrier2 *barr2 = info->pImageMemoryBarriers;
-        const VkImageMemoryBarrier barr = {
+    VkImageMemoryBarrier *imgs;
+    imgs = pl_calloc_ptr(tmp, info->imageMemoryBarrierCount, imgs);
+    for (uint32_t i = 0; i < info->imageMemoryBarrierCount; i++) {
+        const VkImageMemoryBarrier2 *barr2 = &info->pImageMemoryBarriers[i];
+        src_stage |= barr2->srcStageMask;
+        dst_stage |= barr2->dstStageMask;
+        imgs[i] = (VkImageMemoryBarrier) {
             .sType               = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
             .pNext               = barr2->pNext,
             .srcAccessMask       = lower_access2(barr2->srcAccessMask),
@@ -236,12 +241,108 @@ void vk_cmd_barrier(struct vk_cmd *cmd, const VkDependencyInfo *info)
             .image               = barr2->image,
             .subresourceRange    = barr2->subresourceRange,
         };
+    }
+
+    vk->CmdPipelineBarrier(cmd->buf, lower_stage2(src_stage),
+                           lower_stage2(dst_stage), info->dependencyFlags,
+                           0, NULL,
+                           info->bufferMemoryBarrierCount, bufs,
+                           info->imageMemoryBarrierCount, imgs);
+    pl_free(tmp);
+}
+
+void vk_cmd_img_barrier(struct vk_cmd *cmd, const VkImageMemoryBarrier2 *barr)
+{
+    if (!cmd->batch_barriers) {
+        vk_cmd_barrier(cmd, &(VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .imageMemoryBarrierCount = 1,
+            .pImageMemoryBarriers = barr,
+        });
+        return;
+    }
+
+    for (int i = 0; i < cmd->img_barriers.num; i++) {
+        VkImageMemoryBarrier2 *prev = &cmd->img_barriers.elem[i];
+        if (prev->image != barr->image)
+            continue;
+
+        // Barriers within a single command are not ordered with respect to
+        // each other, so only merge those not performing any transitions
+        bool is_trans = barr->oldLayout != barr->newLayout ||
+                        barr->srcQueueFamilyIndex != barr->dstQueueFamilyIndex;
+        if (is_trans) {
+            vk_cmd_barrier_flush(cmd);
+            cmd->batch_barriers = true;
+            break;
+        }
+
+        prev->srcStageMask  |= barr->srcStageMask;
+        prev->srcAccessMask |= barr->srcAccessMask;
+        prev->dstStageMask  |= barr->dstStageMask;
+        prev->dstAccessMask |= barr->dstAccessMask;
+        return;
+    }
+
+    PL_ARRAY_APPEND(cmd, cmd->img_barriers, *barr);
+}
+
+void vk_cmd_buf_barrier(struct vk_cmd *cmd, const VkBufferMemoryBarrier2 *barr)
+{
+    if (!cmd->batch_barriers) {
+        vk_cmd_barrier(cmd, &(VkDependencyInfo) {
+            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+            .bufferMemoryBarrierCount = 1,
+            .pBufferMemoryBarriers = barr,
+        });
+        return;
+    }
 
-        vk->CmdPipelineBarrier(cmd->buf, lower_stage2(barr2->srcStageMask),
-                               lower_stage2(barr2->dstStageMask),
-                               info->dependencyFlags,
-                               0, NULL, 0, NULL, 1, &barr);
+    for (int i = 0; i < cmd->buf_barriers.num; i++) {
+        VkBufferMemoryBarrier2 *prev = &cmd->buf_barriers.elem[i];
+        if (prev->buffer != barr->buffer)
+            continue;
+
+        bool same_range = prev->offset == barr->offset && prev->size == barr->size;
+        bool is_xfer = barr->srcQueueFamilyIndex != barr->dstQueueFamilyIndex;
+        if (!same_range || is_xfer) {
+            vk_cmd_barrier_flush(cmd);
+            cmd->batch_barriers = true;
+            break;
+        }
+
+        prev->srcStageMask  |= barr->srcStageMask;
+        prev->srcAccessMask |= barr->srcAccessMask;
+        prev->dstStageMask  |= barr->dstStageMask;
+        prev->dstAccessMask |= barr->dstAccessMask;
+        return;
     }
+
+    PL_ARRAY_APPEND(cmd, cmd->buf_barriers, *barr);
+}
+
+void vk_cmd_barrier_begin(struct vk_cmd *cmd)
+{
+    pl_assert(!cmd->batch_barriers);
+    cmd->batch_barriers = true;
+}
+
+void vk_cmd_barrier_flush(struct vk_cmd *cmd)
+{
+    cmd->batch_barriers = false;
+    if (!cmd->img_barriers.num && !cmd->buf_barriers.num)
+        return;
+
+    vk_cmd_barrier(cmd, &(VkDependencyInfo) {
+        .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
+        .bufferMemoryBarrierCount = cmd->buf_barriers.num,
+        .pBufferMemoryBarriers = cmd->buf_barriers.elem,
+        .imageMemoryBarrierCount = cmd->img_barriers.num,
+        .pImageMemoryBarriers = cmd->img_barriers.elem,
+    });
+
+    cmd->img_barriers.num = 0;
+    cmd->buf_barriers.num = 0;
 }
 
 struct vk_sync_scope vk_sem_barrier(struct vk_cmd *cmd, struct vk_sem *sem,
@@ -323,6 +424,7 @@ struct vk_cmdpool *vk_cmdpool_create(struct vk_ctx *vk, int qf, int qnum,
         .props      = props,
         .qf         = qf,
         .queues     = pl_calloc(pool, qnum, sizeof(VkQueue)),
+        .pending    = pl_calloc(pool, qnum, sizeof(int)),
         .num_queues = qnum,
     };
 
@@ -377,6 +479,15 @@ struct vk_cmd *vk_cmd_begin(struct vk_cmdpool *pool, pl_debug_tag debug_tag)
     }
 
     cmd->qindex = pool->idx_queues;
+    if (vk->balance_queues) {
+        // Pick the queue with the fewest pending commands, preferring the
+        // current queue (as rotated by `vk_rotate_queues`) on ties
+        for (int i = 1; i < pool->num_queues; i++) {
+            int idx = (pool->idx_queues + i) % pool->num_queues;
+            if (pool->pending[idx] < pool->pending[cmd->qindex])
+                cmd->qindex = idx;
+        }
+    }
     cmd->queue = pool->queues[cmd->qindex];
     pl_mutex_unlock(&vk->lock);
 
@@ -468,6 +579,8 @@ bool vk_cmd_submit(struct vk_cmd **pcmd)
     struct vk_cmdpool *pool = cmd->pool;
     struct vk_ctx *vk = pool->vk;
 
+    pl_assert(!cmd->batch_barriers);
+    pl_assert(!cmd->img_barriers.num && !cmd->buf_barriers.num);
     VK(vk->EndCommandBuffer(cmd->buf));
 
     VkSubmitInfo2 sinfo = {
@@ -505,6 +618,9 @@ bool vk_cmd_submit(struct vk_cmd **pcmd)
 
     pl_mutex_lock(&vk->lock);
     PL_ARRAY_APPEND(vk->alloc, vk->cmds_pending, cmd);
+    pool->pending[cmd->qindex]++;
+    if (vk->completion_active)
+        pl_cond_signal(&vk->completion_cond);
     pl_mutex_unlock(&vk->lock);
     return true;
 
@@ -517,7 +633,7 @@ error:
     return false;
 }
 
-bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
+static bool poll_commands(struct vk_ctx *vk, uint64_t timeout)
 {
     bool ret = false;
     pl_mutex_lock(&vk->lock);
@@ -535,6 +651,7 @@ bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
         PL_TRACE(vk, "VkSemaphore signalled: 0x%"PRIx64" = %"PRIu64,
                  (uint64_t) cmd->sync.sem, cmd->sync.value);
         PL_ARRAY_REMOVE_AT(vk->cmds_pending, 0); // remove before callbacks
+        pool->pending[cmd->qindex]--;
         vk_cmd_reset(cmd);
         PL_ARRAY_APPEND(pool, pool->cmds, cmd);
         ret = true;
@@ -551,18 +668,104 @@ bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
     return ret;
 }
 
-void vk_rotate_queues(struct vk_ctx *vk)
+bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout)
+{
+    // Completed commands are already being retired in the background, so
+    // there's no need to query any semaphores unless we want to block
+    if (!timeout && vk->completion_active)
+        return false;
+
+    return poll_commands(vk, timeout);
+}
+
+static PL_THREAD_VOID completion_thread(void *arg)
 {
+    struct vk_ctx *vk = arg;
     pl_mutex_lock(&vk->lock);
 
-    // Rotate the queues to ensure good parallelism across frames
-    for (int i = 0; i < vk->pools.num; i++) {
-        struct vk_cmdpool *pool = vk->pools.elem[i];
-        pool->idx_queues = (pool->idx_queues + 1) % pool->num_queues;
-        PL_TRACE(vk, "QF %d: %d/%d", pool->qf, pool->idx_queues, pool->num_queues);
+    while (!vk->completion_exit) {
+        if (!vk->cmds_pending.num) {
+            pl_cond_wait(&vk->completion_cond, &vk->lock);
+            continue;
+        }
+
+        // Commands are retired in submission order, so it's sufficient to
+        // block on the oldest one. Its semaphore stays valid (and its value
+        // monotonic) even if another thread retires and recycles it first.
+        pl_vulkan_sem sync = vk->cmds_pending.elem[0]->sync;
+        pl_mutex_unlock(&vk->lock);
+        VkResult res = vk->WaitSemaphores(vk->dev, &(VkSemaphoreWaitInfo) {
+            .sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO,
+            .semaphoreCount = 1,
+            .pSemaphores = &sync.sem,
+            .pValues = &sync.value,
+        }, UINT64_MAX);
+
+        if (res != VK_SUCCESS) {
+            PL_ERR(vk, "Failed waiting for command completion: %s",
+                   vk_res_str(res));
+            pl_mutex_lock(&vk->lock);
+            vk->failed = true;
+            break;
+        }
+
+        poll_commands(vk, 0);
+        pl_mutex_lock(&vk->lock);
     }
 
+    // Fall back to polling from the calling threads
+    vk->completion_active = false;
     pl_mutex_unlock(&vk->lock);
+    PL_THREAD_RETURN();
+}
+
+bool vk_completion_start(struct vk_ctx *vk)
+{
+    pl_assert(!vk->completion_started);
+    if (pl_cond_init(&vk->completion_cond))
+        return false;
+
+    vk->completion_exit = false;
+    vk->completion_active = true;
+    if (pl_thread_create(&vk->completion_thread, completion_thread, vk)) {
+        vk->completion_active = false;
+        pl_cond_destroy(&vk->completion_cond);
+        return false;
+    }
+
+    vk->completion_started = true;
+    return true;
+}
+
+void vk_completion_stop(struct vk_ctx *vk)
+{
+    if (!vk->completion_started)
+        return;
+
+    pl_mutex_lock(&vk->lock);
+    vk->completion_exit = true;
+    pl_cond_signal(&vk->completion_cond);
+    pl_mutex_unlock(&vk->lock);
+
+    pl_thread_join(vk->completion_thread);
+    pl_cond_destroy(&vk->completion_cond);
+    vk->completion_started = false;
+}
+
+void vk_cmdpool_rotate(struct vk_cmdpool *pool)
+{
+    struct vk_ctx *vk = pool->vk;
+    pl_mutex_lock(&vk->lock);
+    pool->idx_queues = (pool->idx_queues + 1) % pool->num_queues;
+    PL_TRACE(vk, "QF %d: %d/%d", pool->qf, pool->idx_queues, pool->num_queues);
+    pl_mutex_unlock(&vk->lock);
+}
+
+void vk_rotate_queues(struct vk_ctx *vk)
+{
+    // Rotate the queues to ensure good parallelism across frames
+    for (int i = 0; i < vk->pools.num; i++)
+        vk_cmdpool_rotate(vk->pools.elem[i]);
 }
 
 void vk_wait_idle(struct vk_ctx *vk)
@@ -51,6 +51,10 @@ struct vk_cmd {
     // "Callbacks" to fire once a command completes. These are used for
     // multiple purposes, ranging from resource deallocation to fencing.
     PL_ARRAY(struct vk_callback) callbacks;
+    // Pending pipeline barriers, see `vk_cmd_barrier_begin`
+    PL_ARRAY(VkImageMemoryBarrier2) img_barriers;
+    PL_ARRAY(VkBufferMemoryBarrier2) buf_barriers;
+    bool batch_barriers;
 };
 
 // Associate a callback with the completion of the current command. This
@@ -69,6 +73,16 @@ void vk_cmd_sig(struct vk_cmd *cmd, VkPipelineStageFlags2 stage, pl_vulkan_sem s
 // Compatibility wrappers for vkCmdPipelineBarrier2 (works with pre-1.3)
 void vk_cmd_barrier(struct vk_cmd *cmd, const VkDependencyInfo *info);
 
+// Record a single image/buffer memory barrier. Between `vk_cmd_barrier_begin`
+// and `vk_cmd_barrier_flush`, these are instead accumulated and emitted
+// together as a single pipeline barrier upon flush. This must only be used
+// for barriers guarding commands recorded after the flush, e.g. for all of
+// the resources used by a single draw or dispatch.
+void vk_cmd_img_barrier(struct vk_cmd *cmd, const VkImageMemoryBarrier2 *barr);
+void vk_cmd_buf_barrier(struct vk_cmd *cmd, const VkBufferMemoryBarrier2 *barr);
+void vk_cmd_barrier_begin(struct vk_cmd *cmd);
+void vk_cmd_barrier_flush(struct vk_cmd *cmd);
+
 // Synchronization scope
 struct vk_sync_scope {
     pl_vulkan_sem sync;         // semaphore of last access
@@ -98,6 +112,7 @@ struct vk_cmdpool {
     int qf; // queue family index
     VkCommandPool pool;
     VkQueue *queues;
+    int *pending; // number of pending commands, per queue
     int num_queues;
     int idx_queues;
     // Command buffers associated with this queue. These are available for
@@ -131,11 +146,23 @@ bool vk_cmd_submit(struct vk_cmd **cmd);
 // never flushed!
 bool vk_poll_commands(struct vk_ctx *vk, uint64_t timeout);
 
+// Start a background thread which blocks on the oldest pending command and
+// retires commands (i.e. runs their callbacks) as soon as they complete. While
+// this is running, `vk_poll_commands` with a timeout of 0 becomes a no-op.
+// Returns false if the thread could not be created.
+bool vk_completion_start(struct vk_ctx *vk);
+
+// Stop and join the background thread, if running. Safe to call otherwise.
+void vk_completion_stop(struct vk_ctx *vk);
+
 // Rotate through queues in each command pool. Call this once per frame, after
 // submitting all of the command buffers for that frame. Calling this more
 // often than that is possible but bad for performance.
 void vk_rotate_queues(struct vk_ctx *vk);
 
+// Like `vk_rotate_queues`, but for a single (possibly non-shared) pool.
+void vk_cmdpool_rotate(struct vk_cmdpool *pool);
+
 // Wait until all commands are complete, i.e. the device is idle. This is
 // basically equivalent to calling `vk_poll_commands` with a timeout of
 // UINT64_MAX until it returns `false`.
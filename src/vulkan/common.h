@@ -67,12 +67,24 @@ struct vk_ctx {
     // Generic error flag for catching "failed" devices
     bool failed;
 
+    // Optional cache for persisting format probing results
+    pl_cache cache;
+
+    // Pending background format probe, see `vk_probe_formats_start`
+    struct vk_fmt_probes *fmt_probes;
+
     // Enabled extensions
     PL_ARRAY(const char *) exts;
 
     // Command pools (one per queue family)
     PL_ARRAY(struct vk_cmdpool *) pools;
 
+    // Pick the least loaded queue for each command, see `vk_cmd_begin`
+    bool balance_queues;
+
+    // Use the performance SPIR-V optimization passes
+    bool spirv_opt_performance;
+
     // Pointers into `pools` (always set)
     struct vk_cmdpool *pool_graphics;
     struct vk_cmdpool *pool_compute;
@@ -94,6 +106,14 @@ struct vk_ctx {
     const struct vk_callback *pending_callbacks;
     int num_pending_callbacks;
 
+    // Optional background thread retiring pending commands, see
+    // `vk_completion_start`
+    pl_thread completion_thread;
+    pl_cond completion_cond;        // signalled on new pending commands / exit
+    atomic_bool completion_active;  // thread is running and retiring commands
+    bool completion_started;        // thread was created and must be joined
+    bool completion_exit;           // thread should terminate
+
     // Instance-level function pointers
     PL_VK_FUN(CreateDevice);
     PL_VK_FUN(EnumerateDeviceExtensionProperties);
@@ -106,6 +126,7 @@ struct vk_ctx {
     PL_VK_FUN(GetPhysicalDeviceFormatProperties2KHR);
     PL_VK_FUN(GetPhysicalDeviceImageFormatProperties2KHR);
     PL_VK_FUN(GetPhysicalDeviceMemoryProperties);
+    PL_VK_FUN(GetPhysicalDeviceMemoryProperties2);
     PL_VK_FUN(GetPhysicalDeviceProperties);
     PL_VK_FUN(GetPhysicalDeviceProperties2);
     PL_VK_FUN(GetPhysicalDeviceQueueFamilyProperties);
@@ -194,6 +215,7 @@ struct vk_ctx {
     PL_VK_FUN(FlushMappedMemoryRanges);
     PL_VK_FUN(FreeCommandBuffers);
     PL_VK_FUN(FreeMemory);
+    PL_VK_FUN(GetBufferDeviceAddress);
     PL_VK_FUN(GetBufferMemoryRequirements);
     PL_VK_FUN(GetDeviceQueue);
     PL_VK_FUN(GetImageDrmFormatModifierPropertiesEXT);
@@ -202,6 +224,8 @@ struct vk_ctx {
     PL_VK_FUN(GetMemoryFdKHR);
     PL_VK_FUN(GetMemoryFdPropertiesKHR);
     PL_VK_FUN(GetMemoryHostPointerPropertiesEXT);
+    PL_VK_FUN(GetPastPresentationTimingGOOGLE);
+    PL_VK_FUN(GetRefreshCycleDurationGOOGLE);
     PL_VK_FUN(GetPipelineCacheData);
     PL_VK_FUN(GetQueryPoolResults);
     PL_VK_FUN(GetSemaphoreFdKHR);
@@ -231,4 +255,14 @@ struct vk_ctx {
 #ifdef VK_EXT_full_screen_exclusive
     PL_VK_FUN(AcquireFullScreenExclusiveModeEXT);
 #endif
+#ifdef VK_EXT_descriptor_buffer
+    PL_VK_FUN(CmdBindDescriptorBuffersEXT);
+    PL_VK_FUN(CmdSetDescriptorBufferOffsetsEXT);
+    PL_VK_FUN(GetDescriptorEXT);
+    PL_VK_FUN(GetDescriptorSetLayoutBindingOffsetEXT);
+    PL_VK_FUN(GetDescriptorSetLayoutSizeEXT);
+#endif
+#ifdef VK_KHR_present_wait
+    PL_VK_FUN(WaitForPresentKHR);
+#endif
 };
@@ -72,6 +72,7 @@ static const struct vk_fun vk_inst_funs[] = {
     PL_VK_INST_FUN(GetPhysicalDeviceFormatProperties2KHR),
     PL_VK_INST_FUN(GetPhysicalDeviceImageFormatProperties2KHR),
     PL_VK_INST_FUN(GetPhysicalDeviceMemoryProperties),
+    PL_VK_INST_FUN(GetPhysicalDeviceMemoryProperties2),
     PL_VK_INST_FUN(GetPhysicalDeviceProperties),
     PL_VK_INST_FUN(GetPhysicalDeviceProperties2),
     PL_VK_INST_FUN(GetPhysicalDeviceQueueFamilyProperties),
@@ -148,6 +149,8 @@ static const struct vk_ext vk_device_extensions[] = {
 #endif
     }, {
         .name = VK_EXT_PCI_BUS_INFO_EXTENSION_NAME,
+    }, {
+        .name = VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
     }, {
         .name = VK_EXT_HDR_METADATA_EXTENSION_NAME,
         .funs = (const struct vk_fun[]) {
@@ -187,6 +190,41 @@ static const struct vk_ext vk_device_extensions[] = {
             PL_VK_DEV_FUN(QueueSubmit2KHR),
             {0}
         },
+#ifdef VK_EXT_graphics_pipeline_library
+    }, {
+        .name = VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+    }, {
+        .name = VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_descriptor_buffer
+    }, {
+        .name = VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME,
+        .funs = (const struct vk_fun[]) {
+            PL_VK_DEV_FUN(CmdBindDescriptorBuffersEXT),
+            PL_VK_DEV_FUN(CmdSetDescriptorBufferOffsetsEXT),
+            PL_VK_DEV_FUN(GetDescriptorEXT),
+            PL_VK_DEV_FUN(GetDescriptorSetLayoutBindingOffsetEXT),
+            PL_VK_DEV_FUN(GetDescriptorSetLayoutSizeEXT),
+            {0}
+        },
+#endif
+#ifdef VK_KHR_present_wait
+    }, {
+        .name = VK_KHR_PRESENT_ID_EXTENSION_NAME,
+    }, {
+        .name = VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+        .funs = (const struct vk_fun[]) {
+            PL_VK_DEV_FUN(WaitForPresentKHR),
+            {0}
+        },
+#endif
+    }, {
+        .name = VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME,
+        .funs = (const struct vk_fun[]) {
+            PL_VK_DEV_FUN(GetPastPresentationTimingGOOGLE),
+            PL_VK_DEV_FUN(GetRefreshCycleDurationGOOGLE),
+            {0}
+        },
     },
 };
 
@@ -202,6 +240,7 @@ const char * const pl_vulkan_recommended_extensions[] = {
     VK_KHR_EXTERNAL_SEMAPHORE_WIN32_EXTENSION_NAME,
 #endif
     VK_EXT_PCI_BUS_INFO_EXTENSION_NAME,
+    VK_EXT_MEMORY_BUDGET_EXTENSION_NAME,
     VK_EXT_HDR_METADATA_EXTENSION_NAME,
     VK_EXT_IMAGE_DRM_FORMAT_MODIFIER_EXTENSION_NAME,
 #ifdef VK_KHR_portability_subset
@@ -214,6 +253,18 @@ const char * const pl_vulkan_recommended_extensions[] = {
     VK_EXT_FULL_SCREEN_EXCLUSIVE_EXTENSION_NAME,
 #endif
     VK_KHR_SYNCHRONIZATION_2_EXTENSION_NAME,
+#ifdef VK_EXT_graphics_pipeline_library
+    VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME,
+    VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME,
+#endif
+#ifdef VK_EXT_descriptor_buffer
+    VK_EXT_DESCRIPTOR_BUFFER_EXTENSION_NAME,
+#endif
+#ifdef VK_KHR_present_wait
+    VK_KHR_PRESENT_ID_EXTENSION_NAME,
+    VK_KHR_PRESENT_WAIT_EXTENSION_NAME,
+#endif
+    VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME,
 };
 
 const int pl_vulkan_num_recommended_extensions =
@@ -226,11 +277,34 @@ static_assert(PL_ARRAY_SIZE(pl_vulkan_recommended_extensions) + 1 ==
               "vk_device_extensions?");
 
 // Recommended features; keep in sync with libavutil vulkan hwcontext
+#ifdef VK_EXT_descriptor_buffer
+static const VkPhysicalDeviceDescriptorBufferFeaturesEXT recommended_db = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT,
+    .descriptorBuffer = true,
+};
+#endif
+
+#ifdef VK_EXT_graphics_pipeline_library
+static const VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT recommended_gpl = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT,
+#ifdef VK_EXT_descriptor_buffer
+    .pNext = (void *) &recommended_db,
+#endif
+    .graphicsPipelineLibrary = true,
+};
+#endif
+
 static const VkPhysicalDeviceVulkan13Features recommended_vk13 = {
     .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES,
+#if defined(VK_EXT_graphics_pipeline_library)
+    .pNext = (void *) &recommended_gpl,
+#elif defined(VK_EXT_descriptor_buffer)
+    .pNext = (void *) &recommended_db,
+#endif
     .computeFullSubgroups = true,
     .maintenance4 = true,
     .shaderZeroInitializeWorkgroupMemory = true,
+    .subgroupSizeControl = true,
     .synchronization2 = true,
 };
 
@@ -255,9 +329,27 @@ static const VkPhysicalDeviceVulkan11Features recommended_vk11 = {
     .storagePushConstant16 = true,
 };
 
+#ifdef VK_KHR_present_wait
+static const VkPhysicalDevicePresentIdFeaturesKHR recommended_present_id = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR,
+    .pNext = (void *) &recommended_vk11,
+    .presentId = true,
+};
+
+static const VkPhysicalDevicePresentWaitFeaturesKHR recommended_present_wait = {
+    .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR,
+    .pNext = (void *) &recommended_present_id,
+    .presentWait = true,
+};
+#endif
+
 const VkPhysicalDeviceFeatures2 pl_vulkan_recommended_features = {
     .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2,
+#ifdef VK_KHR_present_wait
+    .pNext = (void *) &recommended_present_wait,
+#else
     .pNext = (void *) &recommended_vk11,
+#endif
     .features = {
         .shaderImageGatherExtended = true,
         .shaderStorageImageReadWithoutFormat = true,
@@ -384,6 +476,7 @@ static const struct vk_fun vk_dev_funs[] = {
     PL_VK_DEV_FUN(FlushMappedMemoryRanges),
     PL_VK_DEV_FUN(FreeCommandBuffers),
     PL_VK_DEV_FUN(FreeMemory),
+    PL_VK_DEV_FUN(GetBufferDeviceAddress),
     PL_VK_DEV_FUN(GetBufferMemoryRequirements),
     PL_VK_DEV_FUN(GetDeviceQueue),
     PL_VK_DEV_FUN(GetImageMemoryRequirements2),
@@ -910,6 +1003,7 @@ void pl_vulkan_destroy(pl_vulkan *pl_vk)
         return;
 
     struct vk_ctx *vk = PL_PRIV(*pl_vk);
+    vk_probe_formats_stop(vk);
     if (vk->dev) {
         if ((*pl_vk)->gpu) {
             PL_DEBUG(vk, "Waiting for remaining commands...");
@@ -918,6 +1012,7 @@ void pl_vulkan_destroy(pl_vulkan *pl_vk)
 
             pl_gpu_destroy((*pl_vk)->gpu);
         }
+        vk_completion_stop(vk);
         vk_malloc_destroy(&vk->ma);
         for (int i = 0; i < vk->pools.num; i++)
             vk_cmdpool_destroy(vk->pools.elem[i]);
@@ -1365,7 +1460,8 @@ static void unlock_queue(pl_vulkan pl_vk, uint32_t qf, uint32_t qidx)
     vk->unlock_queue(vk->queue_ctx, qf, qidx);
 }
 
-static bool finalize_context(struct pl_vulkan_t *pl_vk, int max_glsl_version)
+static bool finalize_context(struct pl_vulkan_t *pl_vk, int max_glsl_version,
+                             bool buddy_allocator)
 {
     struct vk_ctx *vk = PL_PRIV(pl_vk);
 
@@ -1373,7 +1469,7 @@ static bool finalize_context(struct pl_vulkan_t *pl_vk, int max_glsl_version)
     pl_assert(vk->pool_compute);
     pl_assert(vk->pool_transfer);
 
-    vk->ma = vk_malloc_create(vk);
+    vk->ma = vk_malloc_create(vk, buddy_allocator);
     if (!vk->ma)
         return false;
 
@@ -1435,6 +1531,9 @@ pl_vulkan pl_vulkan_create(pl_log log, const struct pl_vulkan_params *params)
         .log = log,
         .inst = params->instance,
         .GetInstanceProcAddr = get_proc_addr_fallback(log, params->get_proc_addr),
+        .balance_queues = params->balance_queues,
+        .spirv_opt_performance = params->spirv_opt_performance,
+        .cache = params->cache,
     };
 
     pl_mutex_init_type(&vk->lock, PL_MUTEX_RECURSIVE);
@@ -1517,13 +1616,21 @@ pl_vulkan pl_vulkan_create(pl_log log, const struct pl_vulkan_params *params)
         goto error;
     }
 
+    // Format probing only depends on the physical device, so it can overlap
+    // with the (potentially slow) creation of the logical device
+    if (params->async_formats && !vk_probe_formats_start(vk))
+        PL_WARN(vk, "Failed creating format probing thread, ignoring...");
+
     // Finally, initialize the logical device and the rest of the vk_ctx
     if (!device_init(vk, params))
         goto error;
 
-    if (!finalize_context(pl_vk, params->max_glsl_version))
+    if (!finalize_context(pl_vk, params->max_glsl_version, params->buddy_allocator))
         goto error;
 
+    if (params->completion_thread && !vk_completion_start(vk))
+        PL_WARN(vk, "Failed creating command completion thread, ignoring...");
+
     return pl_vk;
 
 error:
@@ -1550,6 +1657,8 @@ pl_vulkan pl_vulkan_import(pl_log log, const struct pl_vulkan_import_params *par
         .lock_queue = params->lock_queue,
         .unlock_queue = params->unlock_queue,
         .queue_ctx = params->queue_ctx,
+        .spirv_opt_performance = params->spirv_opt_performance,
+        .cache = params->cache,
     };
 
     pl_mutex_init_type(&vk->lock, PL_MUTEX_RECURSIVE);
@@ -1690,7 +1799,7 @@ next_qf: ;
         goto error;
     }
 
-    if (!finalize_context(pl_vk, params->max_glsl_version))
+    if (!finalize_context(pl_vk, params->max_glsl_version, false))
         goto error;
 
     pl_free(tmp);
@@ -16,6 +16,7 @@
  */
 
 #include "formats.h"
+#include "cache.h"
 
 #define FMT(_name, num, size, ftype, bits, idx) \
     (struct pl_fmt_t) {                         \
@@ -379,6 +380,214 @@ static const struct vk_format vk_formats[] = {
 #undef REGFMT
 #undef FMT
 
+// Raw results of querying the driver for a single entry of `vk_formats`
+struct vk_fmt_probe {
+    uint32_t emu_depth;             // number of `emufmt` fallbacks taken
+    VkFormatFeatureFlags texflags;
+    VkFormatFeatureFlags bufflags;
+    uint32_t num_mods;
+    VkDrmFormatModifierPropertiesEXT mods[16];
+};
+
+static void probe_format(struct vk_ctx *vk, const struct vk_format *vk_fmt,
+                         bool has_emu, bool has_drm_mods,
+                         struct vk_fmt_probe *out)
+{
+    VkDrmFormatModifierPropertiesListEXT drm_props = {
+        .sType = VK_STRUCTURE_TYPE_DRM_FORMAT_MODIFIER_PROPERTIES_LIST_EXT,
+        .drmFormatModifierCount = PL_ARRAY_SIZE(out->mods),
+        .pDrmFormatModifierProperties = out->mods,
+    };
+
+    VkFormatProperties2KHR prop2 = {
+        .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
+        .pNext = has_drm_mods ? &drm_props : NULL,
+    };
+
+    vk->GetPhysicalDeviceFormatProperties2KHR(vk->physd, vk_fmt->tfmt, &prop2);
+
+    // If wholly unsupported, try falling back to the emulation formats
+    // for texture operations
+    VkFormatProperties *prop = &prop2.formatProperties;
+    while (has_emu && !prop->optimalTilingFeatures && vk_fmt->emufmt) {
+        vk_fmt = vk_fmt->emufmt;
+        out->emu_depth++;
+        vk->GetPhysicalDeviceFormatProperties2KHR(vk->physd, vk_fmt->tfmt, &prop2);
+    }
+
+    out->texflags = prop->optimalTilingFeatures;
+    out->bufflags = prop->bufferFeatures;
+    out->num_mods = has_drm_mods ? drm_props.drmFormatModifierCount : 0;
+    if (vk_fmt->fmt.emulated) {
+        // Emulated formats might have a different buffer representation
+        // than their texture representation. If they don't, assume their
+        // buffer representation is nonsensical (e.g. r16f)
+        if (vk_fmt->bfmt) {
+            vk->GetPhysicalDeviceFormatProperties(vk->physd, vk_fmt->bfmt, prop);
+            out->bufflags = prop->bufferFeatures;
+        } else {
+            out->bufflags = 0;
+        }
+    } else if (vk_fmt->fmt.num_planes) {
+        // Planar textures cannot be used directly
+        out->texflags = out->bufflags = 0;
+    }
+}
+
+// The probed capabilities only depend on the physical device, driver and
+// API version, so they can be persisted across device creations
+static uint64_t probe_key(const struct vk_ctx *vk, bool has_emu,
+                          bool has_drm_mods, int num_probes)
+{
+    uint64_t key = CACHE_KEY_VK_FMTS;
+    pl_hash_merge(&key, vk->props.vendorID);
+    pl_hash_merge(&key, vk->props.deviceID);
+    pl_hash_merge(&key, vk->props.driverVersion);
+    pl_hash_merge(&key, pl_var_hash(vk->props.pipelineCacheUUID));
+    pl_hash_merge(&key, vk->api_ver);
+    pl_hash_merge(&key, (has_emu << 1) | has_drm_mods);
+    pl_hash_merge(&key, num_probes);
+    pl_hash_merge(&key, sizeof(struct vk_fmt_probe));
+    return key;
+}
+
+static bool load_probes(pl_cache cache, uint64_t key,
+                        struct vk_fmt_probe *probes, int num_probes)
+{
+    pl_cache_obj obj = { .key = key };
+    if (!pl_cache_get(cache, &obj))
+        return false;
+
+    bool ok = false;
+    if (obj.size != num_probes * sizeof(*probes))
+        goto done;
+
+    memcpy(probes, obj.data, obj.size);
+    for (int i = 0; i < num_probes; i++) {
+        const struct vk_format *vk_fmt = &vk_formats[i];
+        for (uint32_t d = 0; d < probes[i].emu_depth; d++) {
+            if (!(vk_fmt = vk_fmt->emufmt))
+                goto done;
+        }
+        if (probes[i].num_mods > PL_ARRAY_SIZE(probes[i].mods))
+            goto done;
+    }
+
+    ok = true;
+
+done:
+    pl_cache_set(cache, &obj);
+    return ok;
+}
+
+static int num_vk_formats(void)
+{
+    int num = 0;
+    while (vk_formats[num].tfmt)
+        num++;
+    return num;
+}
+
+// Fills `probes` either from `vk->cache` or by querying the driver, storing
+// fresh results back into the cache. Safe to call from any thread.
+static void get_probes(struct vk_ctx *vk, bool has_emu, bool has_drm_mods,
+                       struct vk_fmt_probe *probes, int num_probes)
+{
+    const uint64_t key = probe_key(vk, has_emu, has_drm_mods, num_probes);
+    if (vk->cache && load_probes(vk->cache, key, probes, num_probes)) {
+        PL_DEBUG(vk, "Loaded format capabilities from cache");
+        return;
+    }
+
+    memset(probes, 0, num_probes * sizeof(*probes));
+    for (int i = 0; i < num_probes; i++) {
+        const struct vk_format *vk_fmt = &vk_formats[i];
+        if (vk_fmt->min_ver > vk->api_ver)
+            continue;
+        if (vk_fmt->fmt.emulated && !has_emu)
+            continue;
+        probe_format(vk, vk_fmt, has_emu, has_drm_mods, &probes[i]);
+    }
+
+    if (vk->cache) {
+        pl_cache_set(vk->cache, &(pl_cache_obj) {
+            .key  = key,
+            .data = pl_memdup(NULL, probes, num_probes * sizeof(*probes)),
+            .size = num_probes * sizeof(*probes),
+            .free = pl_free,
+        });
+    }
+}
+
+struct vk_fmt_probes {
+    struct vk_ctx *vk;
+    pl_thread thread;
+    bool has_emu;
+    bool has_drm_mods;
+    int num_probes;
+    struct vk_fmt_probe *probes; // valid after joining `thread`
+};
+
+static PL_THREAD_VOID probe_thread(void *arg)
+{
+    struct vk_fmt_probes *bg = arg;
+    pl_clock_t start = pl_clock_now();
+    get_probes(bg->vk, bg->has_emu, bg->has_drm_mods, bg->probes, bg->num_probes);
+    pl_log_cpu_time(bg->vk->log, start, pl_clock_now(), "probing formats (async)");
+    PL_THREAD_RETURN();
+}
+
+bool vk_probe_formats_start(struct vk_ctx *vk)
+{
+    pl_assert(!vk->fmt_probes);
+    struct vk_fmt_probes *bg = pl_zalloc_ptr(NULL, bg);
+    bg->vk = vk;
+    bg->num_probes = num_vk_formats();
+    bg->probes = pl_calloc_ptr(bg, bg->num_probes, bg->probes);
+
+    // The logical device does not exist yet, so guess what `vk_setup_formats`
+    // will end up using. Wrong guesses merely fall back to synchronous probing
+    bg->has_emu = vk->props.limits.maxTexelBufferElements > 0;
+
+    uint32_t num_exts = 0;
+    VkExtensionProperties *exts = NULL;
+    if (vk->EnumerateDeviceExtensionProperties(vk->physd, NULL, &num_exts, NULL) == VK_SUCCESS) {
+        exts = pl_calloc_ptr(bg, num_exts, exts);
+        if (vk->EnumerateDeviceExtensionProperties(vk->physd, NULL, &num_exts, exts) != VK_SUCCESS)
+            num_exts = 0;
+    }
+    for (uint32_t i = 0; i < num_exts; i++) {
+        if (!strcmp(exts[i].extensionName, VK_EXT_IMAGE_DRM_FORMAT_MODIFIER_EXTENSION_NAME)) {
+            bg->has_drm_mods = true;
+            break;
+        }
+    }
+    pl_free(exts);
+
+    if (pl_thread_create(&bg->thread, probe_thread, bg)) {
+        pl_free(bg);
+        return false;
+    }
+
+    vk->fmt_probes = bg;
+    return true;
+}
+
+static struct vk_fmt_probes *join_probes(struct vk_ctx *vk)
+{
+    struct vk_fmt_probes *bg = vk->fmt_probes;
+    if (bg) {
+        pl_thread_join(bg->thread);
+        vk->fmt_probes = NULL;
+    }
+    return bg;
+}
+
+void vk_probe_formats_stop(struct vk_ctx *vk)
+{
+    pl_free(join_probes(vk));
+}
+
 void vk_setup_formats(struct pl_gpu_t *gpu)
 {
     struct pl_vk *p = PL_PRIV(gpu);
@@ -387,9 +596,33 @@ void vk_setup_formats(struct pl_gpu_t *gpu)
 
     // Texture format emulation requires at least support for texel buffers
     bool has_emu = gpu->glsl.compute && gpu->limits.max_buffer_texels;
+    bool has_drm_mods = vk->GetImageDrmFormatModifierPropertiesEXT;
+
+    const int num_probes = num_vk_formats();
+    struct vk_fmt_probe *probes = NULL;
+    struct vk_fmt_probes *bg = join_probes(vk);
+    if (bg) {
+        pl_assert(bg->num_probes == num_probes);
+        if (bg->has_emu == has_emu && bg->has_drm_mods == has_drm_mods) {
+            probes = pl_steal(NULL, bg->probes);
+        } else {
+            PL_DEBUG(gpu, "Discarding asynchronously probed formats due to "
+                     "mismatched device configuration");
+        }
+        pl_free(bg);
+    }
 
-    for (const struct vk_format *pvk_fmt = vk_formats; pvk_fmt->tfmt; pvk_fmt++) {
-        const struct vk_format *vk_fmt = pvk_fmt;
+    if (!probes) {
+        probes = pl_calloc_ptr(NULL, num_probes, probes);
+        // Suppress some errors/warnings spit out by the format probing code
+        pl_log_level_cap(vk->log, PL_LOG_INFO);
+        get_probes(vk, has_emu, has_drm_mods, probes, num_probes);
+        pl_log_level_cap(vk->log, PL_LOG_NONE);
+    }
+
+    for (int idx = 0; idx < num_probes; idx++) {
+        const struct vk_format *vk_fmt = &vk_formats[idx];
+        const struct vk_fmt_probe *probe = &probes[idx];
 
         // Skip formats that require a too new version of Vulkan
         if (vk_fmt->min_ver > vk->api_ver)
@@ -399,50 +632,12 @@ void vk_setup_formats(struct pl_gpu_t *gpu)
         if (vk_fmt->fmt.emulated && !has_emu)
             continue;
 
-        // Suppress some errors/warnings spit out by the format probing code
-        pl_log_level_cap(vk->log, PL_LOG_INFO);
-
-        bool has_drm_mods = vk->GetImageDrmFormatModifierPropertiesEXT;
-        VkDrmFormatModifierPropertiesEXT modifiers[16] = {0};
-        VkDrmFormatModifierPropertiesListEXT drm_props = {
-            .sType = VK_STRUCTURE_TYPE_DRM_FORMAT_MODIFIER_PROPERTIES_LIST_EXT,
-            .drmFormatModifierCount = PL_ARRAY_SIZE(modifiers),
-            .pDrmFormatModifierProperties = modifiers,
-        };
-
-        VkFormatProperties2KHR prop2 = {
-            .sType = VK_STRUCTURE_TYPE_FORMAT_PROPERTIES_2,
-            .pNext = has_drm_mods ? &drm_props : NULL,
-        };
-
-        vk->GetPhysicalDeviceFormatProperties2KHR(vk->physd, vk_fmt->tfmt, &prop2);
-
-        // If wholly unsupported, try falling back to the emulation formats
-        // for texture operations
-        VkFormatProperties *prop = &prop2.formatProperties;
-        while (has_emu && !prop->optimalTilingFeatures && vk_fmt->emufmt) {
+        for (uint32_t d = 0; d < probe->emu_depth; d++)
             vk_fmt = vk_fmt->emufmt;
-            vk->GetPhysicalDeviceFormatProperties2KHR(vk->physd, vk_fmt->tfmt, &prop2);
-        }
 
-        VkFormatFeatureFlags texflags = prop->optimalTilingFeatures;
-        VkFormatFeatureFlags bufflags = prop->bufferFeatures;
-        if (vk_fmt->fmt.emulated) {
-            // Emulated formats might have a different buffer representation
-            // than their texture representation. If they don't, assume their
-            // buffer representation is nonsensical (e.g. r16f)
-            if (vk_fmt->bfmt) {
-                vk->GetPhysicalDeviceFormatProperties(vk->physd, vk_fmt->bfmt, prop);
-                bufflags = prop->bufferFeatures;
-            } else {
-                bufflags = 0;
-            }
-        } else if (vk_fmt->fmt.num_planes) {
-            // Planar textures cannot be used directly
-            texflags = bufflags = 0;
-        }
-
-        pl_log_level_cap(vk->log, PL_LOG_NONE);
+        VkFormatFeatureFlags texflags = probe->texflags;
+        VkFormatFeatureFlags bufflags = probe->bufflags;
+        const VkDrmFormatModifierPropertiesEXT *modifiers = probe->mods;
 
         struct pl_fmt_t *fmt = pl_alloc_obj(gpu, fmt, struct pl_fmt_vk);
         struct pl_fmt_vk *fmtp = PL_PRIV(fmt);
@@ -467,14 +662,14 @@ void vk_setup_formats(struct pl_gpu_t *gpu)
 
         if (has_drm_mods) {
 
-            if (drm_props.drmFormatModifierCount == PL_ARRAY_SIZE(modifiers)) {
+            if (probe->num_mods == PL_ARRAY_SIZE(probe->mods)) {
                 PL_WARN(gpu, "DRM modifier list for format %s possibly truncated",
                         fmt->name);
             }
 
             // Query the list of supported DRM modifiers from the driver
             PL_ARRAY(uint64_t) modlist = {0};
-            for (int i = 0; i < drm_props.drmFormatModifierCount; i++) {
+            for (int i = 0; i < probe->num_mods; i++) {
                 if (modifiers[i].drmFormatModifierPlaneCount > 1) {
                     PL_TRACE(gpu, "Ignoring format modifier %s of "
                              "format %s because its plane count %d > 1",
@@ -611,6 +806,7 @@ void vk_setup_formats(struct pl_gpu_t *gpu)
         PL_ARRAY_APPEND(gpu, formats, fmt);
     }
 
+    pl_free(probes);
     gpu->formats = formats.elem;
     gpu->num_formats = formats.num;
 }
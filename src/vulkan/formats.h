@@ -32,3 +32,12 @@ struct vk_format {
 
 // Add all supported formats to the `pl_gpu` format list
 void vk_setup_formats(struct pl_gpu_t *gpu);
+
+// Start probing the format capabilities on a background thread, concurrently
+// with device creation. Requires `vk->physd`, `vk->props` and `vk->api_ver`.
+// The results are picked up by `vk_setup_formats`, if still applicable.
+bool vk_probe_formats_start(struct vk_ctx *vk);
+
+// Wait for and discard any results of `vk_probe_formats_start`. Must be
+// called before destroying `vk`.
+void vk_probe_formats_stop(struct vk_ctx *vk);
@@ -26,11 +26,15 @@
 // Gives us enough queries for 8 results
 #define QUERY_POOL_SIZE 16
 
+// Size of the descriptor buffer ring, enough for some thousands of passes
+#define DB_RING_SIZE (1 << 20)
+#define VBO_RING_SIZE (4 << 20)
+
 struct pl_timer_t {
     VkQueryPool qpool; // even=start, odd=stop
     int index_write; // next index to write to
     int index_read; // next index to read from
-    uint64_t pending; // bitmask of queries that are still running
+    atomic_uint_fast64_t pending; // bitmask of queries that are still running
 };
 
 static inline uint64_t timer_bit(int index)
@@ -145,19 +149,36 @@ static inline bool supports_marks(struct vk_cmd *cmd) {
     return flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
 }
 
+bool vk_end_render_pass(pl_gpu gpu)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    if (!p->rp_target)
+        return true;
+
+    // Submit right away, preserving the per-pass submission granularity
+    vk->CmdEndRenderPass(p->cmd->buf);
+    p->rp_target = NULL;
+    return vk_cmd_submit(&p->cmd);
+}
+
 struct vk_cmd *_begin_cmd(pl_gpu gpu, enum queue_type type, const char *label,
-                          pl_timer timer)
+                          pl_timer timer, pl_tex rp_target)
 {
     struct pl_vk *p = PL_PRIV(gpu);
     struct vk_ctx *vk = p->vk;
     pl_mutex_lock(&p->recording);
 
+    // Timestamps are only written around whole render pass instances
+    if (!rp_target || rp_target != p->rp_target || timer)
+        vk_end_render_pass(gpu);
+
     struct vk_cmdpool *pool;
     switch (type) {
-    case ANY:      pool = p->cmd ? p->cmd->pool : vk->pool_graphics; break;
-    case GRAPHICS: pool = vk->pool_graphics; break;
-    case COMPUTE:  pool = vk->pool_compute;  break;
-    case TRANSFER: pool = vk->pool_transfer; break;
+    case ANY:      pool = p->cmd ? p->cmd->pool : p->pool_graphics; break;
+    case GRAPHICS: pool = p->pool_graphics; break;
+    case COMPUTE:  pool = p->pool_compute;  break;
+    case TRANSFER: pool = p->pool_transfer; break;
     default: pl_unreachable();
     }
 
@@ -196,7 +217,8 @@ bool _end_cmd(pl_gpu gpu, struct vk_cmd **pcmd, bool submit)
     if (!pcmd) {
         if (submit) {
             pl_mutex_lock(&p->recording);
-            ret = vk_cmd_submit(&p->cmd);
+            ret = vk_end_render_pass(gpu);
+            ret &= vk_cmd_submit(&p->cmd);
             pl_mutex_unlock(&p->recording);
         }
         return ret;
@@ -226,8 +248,10 @@ bool _end_cmd(pl_gpu gpu, struct vk_cmd **pcmd, bool submit)
     if (vk->CmdEndDebugUtilsLabelEXT && supports_marks(cmd))
         vk->CmdEndDebugUtilsLabelEXT(cmd->buf);
 
-    if (submit)
-        ret = vk_cmd_submit(&p->cmd);
+    if (submit) {
+        ret = vk_end_render_pass(gpu);
+        ret &= vk_cmd_submit(&p->cmd);
+    }
 
     pl_mutex_unlock(&p->recording);
     return ret;
@@ -252,6 +276,7 @@ static void vk_gpu_destroy(pl_gpu gpu)
     struct pl_vk *p = PL_PRIV(gpu);
     struct vk_ctx *vk = p->vk;
 
+    vk_end_render_pass(gpu);
     vk_cmd_submit(&p->cmd);
     vk_wait_idle(vk);
 
@@ -260,6 +285,12 @@ static void vk_gpu_destroy(pl_gpu gpu)
             vk->DestroySampler(vk->dev, p->samplers[s][a], PL_VK_ALLOC);
     }
 
+    for (int i = 0; i < p->own_pools.num; i++)
+        vk_cmdpool_destroy(p->own_pools.elem[i]);
+
+    vk_malloc_free(vk->ma, &p->db_mem);
+    vk_malloc_free(vk->ma, &p->vbo_mem);
+
     pl_spirv_destroy(&p->spirv);
     pl_mutex_destroy(&p->recording);
     pl_free((void *) gpu);
@@ -276,6 +307,41 @@ pl_vulkan pl_vulkan_get(pl_gpu gpu)
     return NULL;
 }
 
+pl_gpu pl_vulkan_gpu_create(pl_vulkan pl_vk)
+{
+    struct vk_ctx *vk = PL_PRIV(pl_vk);
+    pl_gpu gpu = pl_gpu_create_vk(vk);
+    if (!gpu)
+        return NULL;
+
+    // Mirror any restrictions applied to the primary GPU
+    *(struct pl_glsl_version *) &gpu->glsl = pl_vk->gpu->glsl;
+
+    struct pl_vk *p = PL_PRIV(gpu);
+    for (int i = 0; i < vk->pools.num; i++) {
+        const struct vk_cmdpool *src = vk->pools.elem[i];
+        struct vk_cmdpool *pool = vk_cmdpool_create(vk, src->qf, src->num_queues,
+                                                    src->props);
+        if (!pool)
+            goto error;
+
+        PL_ARRAY_APPEND((void *) gpu, p->own_pools, pool);
+        if (src == vk->pool_graphics)
+            p->pool_graphics = pool;
+        if (src == vk->pool_compute)
+            p->pool_compute = pool;
+        if (src == vk->pool_transfer)
+            p->pool_transfer = pool;
+    }
+
+    return gpu;
+
+error:
+    PL_ERR(vk, "Failed creating command pools for secondary GPU");
+    pl_gpu_destroy(gpu);
+    return NULL;
+}
+
 static pl_handle_caps vk_sync_handle_caps(struct vk_ctx *vk)
 {
     pl_handle_caps caps = 0;
@@ -416,8 +482,12 @@ pl_gpu pl_gpu_create_vk(struct vk_ctx *vk)
     struct pl_vk *p = PL_PRIV(gpu);
     pl_mutex_init(&p->recording);
     p->vk = vk;
+    p->pool_graphics = vk->pool_graphics;
+    p->pool_compute = vk->pool_compute;
+    p->pool_transfer = vk->pool_transfer;
     p->impl = pl_fns_vk;
-    p->spirv = pl_spirv_create(vk->log, get_spirv_version(vk));
+    p->spirv = pl_spirv_create(vk->log, get_spirv_version(vk),
+                               vk->spirv_opt_performance);
     if (!p->spirv)
         goto error;
 
@@ -453,6 +523,20 @@ pl_gpu pl_gpu_create_vk(struct vk_ctx *vk)
 
     bool is_portability = false;
 
+    VkPhysicalDeviceSubgroupSizeControlProperties sgsc_props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SUBGROUP_SIZE_CONTROL_PROPERTIES,
+    };
+
+    const VkPhysicalDeviceVulkan13Features *vk13_feats = NULL;
+    if (vk->api_ver >= VK_API_VERSION_1_3) {
+        vk13_feats = vk_find_struct(&vk->features,
+            VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_3_FEATURES);
+    }
+    bool has_sgsc = vk13_feats && vk13_feats->subgroupSizeControl &&
+                    vk13_feats->computeFullSubgroups;
+    if (has_sgsc)
+        vk_link_struct(&props, &sgsc_props);
+
 #ifdef VK_KHR_portability_subset
     VkPhysicalDevicePortabilitySubsetPropertiesKHR port_props = {
         .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PORTABILITY_SUBSET_PROPERTIES_KHR,
@@ -467,7 +551,50 @@ pl_gpu pl_gpu_create_vk(struct vk_ctx *vk)
     }
 #endif
 
+#ifdef VK_EXT_graphics_pipeline_library
+    VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT gpl_props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT,
+    };
+
+    const VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT *gpl_feats;
+    gpl_feats = vk_find_struct(&vk->features,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT);
+    bool has_gpl = gpl_feats && gpl_feats->graphicsPipelineLibrary;
+    for (int i = 0; has_gpl && i < vk->exts.num; i++) {
+        if (!strcmp(vk->exts.elem[i], VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME)) {
+            vk_link_struct(&props, &gpl_props);
+            break;
+        }
+    }
+#endif
+
+#ifdef VK_EXT_descriptor_buffer
+    VkPhysicalDeviceDescriptorBufferPropertiesEXT db_props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_PROPERTIES_EXT,
+    };
+
+    const VkPhysicalDeviceDescriptorBufferFeaturesEXT *db_feats;
+    const VkPhysicalDeviceVulkan12Features *vk12_feats;
+    db_feats = vk_find_struct(&vk->features,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_BUFFER_FEATURES_EXT);
+    vk12_feats = vk_find_struct(&vk->features,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES);
+    bool has_db = db_feats && db_feats->descriptorBuffer &&
+                  vk12_feats && vk12_feats->bufferDeviceAddress &&
+                  vk->GetDescriptorEXT;
+    if (has_db)
+        vk_link_struct(&props, &db_props);
+#endif
+
     vk->GetPhysicalDeviceProperties2(vk->physd, &props);
+
+#ifdef VK_EXT_graphics_pipeline_library
+    // Only worth it if linking is actually cheap, otherwise we would just pay
+    // for the (slower) linked pipelines without saving any compilation time
+    p->use_gpl = gpl_props.graphicsPipelineLibraryFastLinking;
+    if (p->use_gpl)
+        PL_DEBUG(gpu, "Using graphics pipeline libraries for raster passes");
+#endif
     VkPhysicalDeviceLimits limits = props.properties.limits;
 
     // Determine GLSL features and limits
@@ -498,6 +625,22 @@ pl_gpu pl_gpu_create_vk(struct vk_ctx *vk)
         gpu->glsl.subgroup_size = group_props.subgroupSize;
     }
 
+    if (gpu->glsl.subgroup_size && has_sgsc &&
+        (sgsc_props.requiredSubgroupSizeStages & VK_SHADER_STAGE_COMPUTE_BIT))
+    {
+        // Skip sizes that would limit the maximum work group size
+        uint32_t min_size = sgsc_props.minSubgroupSize;
+        while (min_size < sgsc_props.maxSubgroupSize &&
+               (uint64_t) min_size * sgsc_props.maxComputeWorkgroupSubgroups <
+                   limits.maxComputeWorkGroupInvocations)
+        {
+            min_size <<= 1;
+        }
+
+        gpu->glsl.min_subgroup_size = min_size;
+        gpu->glsl.max_subgroup_size = sgsc_props.maxSubgroupSize;
+    }
+
     if (vk->features.features.shaderImageGatherExtended) {
         gpu->glsl.min_gather_offset = limits.minTexelGatherOffset;
         gpu->glsl.max_gather_offset = limits.maxTexelGatherOffset;
@@ -599,6 +742,62 @@ pl_gpu pl_gpu_create_vk(struct vk_ctx *vk)
         }
     }
 
+#ifdef VK_EXT_descriptor_buffer
+    if (has_db) {
+        struct vk_malloc_params mparams = {
+            .reqs = {
+                .size = DB_RING_SIZE,
+                .alignment = db_props.descriptorBufferOffsetAlignment,
+                .memoryTypeBits = UINT32_MAX,
+            },
+            .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                        VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            .optimal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            .buf_usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
+                         VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT |
+                         VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            .debug_tag = PL_DEBUG_TAG,
+        };
+
+        if (vk_malloc_slice(vk->ma, &p->db_mem, &mparams)) {
+            VkBufferDeviceAddressInfo ainfo = {
+                .sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO,
+                .buffer = p->db_mem.buf,
+            };
+
+            p->db_addr = vk->GetBufferDeviceAddress(vk->dev, &ainfo) + p->db_mem.offset;
+            p->db_align = db_props.descriptorBufferOffsetAlignment;
+            p->db_sizes[PL_DESC_SAMPLED_TEX] = db_props.combinedImageSamplerDescriptorSize;
+            p->db_sizes[PL_DESC_STORAGE_IMG] = db_props.storageImageDescriptorSize;
+            p->use_db = true;
+            PL_DEBUG(gpu, "Using descriptor buffers for image-only passes");
+        } else {
+            PL_WARN(gpu, "Failed allocating descriptor buffer ring, falling "
+                    "back to descriptor sets!");
+        }
+    }
+#endif
+
+    struct vk_malloc_params vbo_params = {
+        .reqs = {
+            .size = VBO_RING_SIZE,
+            .alignment = 16,
+            .memoryTypeBits = UINT32_MAX,
+        },
+        .required = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                    VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        .optimal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .buf_usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT |
+                     VK_BUFFER_USAGE_INDEX_BUFFER_BIT,
+        .debug_tag = PL_DEBUG_TAG,
+    };
+
+    if (!vk_malloc_slice(vk->ma, &p->vbo_mem, &vbo_params)) {
+        PL_WARN(gpu, "Failed allocating vertex buffer ring, falling back to "
+                "temporary vertex buffers!");
+        p->vbo_mem = (struct vk_memslice) {0};
+    }
+
     return pl_gpu_finalize(gpu);
 
 error:
@@ -719,6 +918,8 @@ static void vk_gpu_flush(pl_gpu gpu)
     struct vk_ctx *vk = p->vk;
     CMD_SUBMIT(NULL);
     vk_rotate_queues(vk);
+    for (int i = 0; i < p->own_pools.num; i++)
+        vk_cmdpool_rotate(p->own_pools.elem[i]);
     vk_malloc_garbage_collect(vk->ma);
 }
 
@@ -737,17 +938,22 @@ static bool vk_gpu_is_failed(pl_gpu gpu)
     return vk->failed;
 }
 
-struct vk_cmd *pl_vk_steal_cmd(pl_gpu gpu)
+static bool vk_gpu_get_memory_budget(pl_gpu gpu, struct pl_gpu_memory_budget *out)
 {
     struct pl_vk *p = PL_PRIV(gpu);
-    struct vk_ctx *vk = p->vk;
+    return vk_malloc_get_budget(p->vk->ma, out);
+}
 
+struct vk_cmd *pl_vk_steal_cmd(pl_gpu gpu)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
     pl_mutex_lock(&p->recording);
+    vk_end_render_pass(gpu);
     struct vk_cmd *cmd = p->cmd;
     p->cmd = NULL;
     pl_mutex_unlock(&p->recording);
 
-    struct vk_cmdpool *pool = vk->pool_graphics;
+    struct vk_cmdpool *pool = p->pool_graphics;
     if (!cmd || cmd->pool != pool) {
         vk_cmd_submit(&cmd);
         cmd = vk_cmd_begin(pool, NULL);
@@ -790,4 +996,5 @@ static const struct pl_gpu_fns pl_fns_vk = {
     .gpu_flush              = vk_gpu_flush,
     .gpu_finish             = vk_gpu_finish,
     .gpu_is_failed          = vk_gpu_is_failed,
+    .gpu_get_memory_budget  = vk_gpu_get_memory_budget,
 };
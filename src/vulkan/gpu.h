@@ -59,6 +59,33 @@ struct pl_vk {
     // Some additional cached device limits and features checks
     uint32_t max_push_descriptors;
     size_t min_texel_alignment;
+    bool use_gpl; // VK_EXT_graphics_pipeline_library with fast linking
+
+    // Descriptor buffer ring (VK_EXT_descriptor_buffer). Descriptors are
+    // written directly into `db_mem` and released in submission order, so
+    // this is a simple FIFO ring buffer spanning `db_mem.size` bytes.
+    bool use_db;
+    struct vk_memslice db_mem;
+    VkDeviceAddress db_addr;
+    VkDeviceSize db_align;
+    size_t db_sizes[PL_DESC_TYPE_COUNT]; // descriptor sizes, 0 if unsupported
+    size_t db_head;
+    atomic_size_t db_busy; // updated from command callbacks
+
+    // Vertex buffer ring, used to stream `vertex_data` / `index_data` without
+    // creating temporary buffers. Same FIFO scheme as the descriptor buffer
+    // ring, but available unconditionally (`vbo_mem.size` is 0 on failure)
+    struct vk_memslice vbo_mem;
+    size_t vbo_head;
+    atomic_size_t vbo_busy; // updated from command callbacks
+
+    // Command pools to record commands from. These point into `vk->pools`,
+    // except for GPUs created by `pl_vulkan_gpu_create`, which record from
+    // their own (otherwise identical) pools stored in `own_pools`.
+    struct vk_cmdpool *pool_graphics;
+    struct vk_cmdpool *pool_compute;
+    struct vk_cmdpool *pool_transfer;
+    PL_ARRAY(struct vk_cmdpool *) own_pools;
 
     // The "currently recording" command. This will be queued and replaced by
     // a new command every time we need to "switch" between queue families.
@@ -66,18 +93,38 @@ struct pl_vk {
     struct vk_cmd *cmd;
     pl_timer cmd_timer;
 
+    // Target of the render pass instance left open in `cmd` by `vk_pass_run`,
+    // so that subsequent raster passes drawing to the same texture can be
+    // recorded into it instead of flushing the tile memory in between. If
+    // set, `cmd` is also still pending submission.
+    pl_tex rp_target;
+
     // Array of VkSamplers for every combination of sample/address modes
     VkSampler samplers[PL_TEX_SAMPLE_MODE_COUNT][PL_TEX_ADDRESS_MODE_COUNT];
 
+    // Incremented whenever a texture or buffer is destroyed, since their
+    // Vulkan handles may then be recycled by new objects. Invalidates the
+    // contents remembered for descriptor sets (see `pl_pass_vk.ds_sig`).
+    atomic_uint_fast64_t desc_gen;
+
     // To avoid spamming warnings
     bool warned_modless;
 };
 
-struct vk_cmd *_begin_cmd(pl_gpu, enum queue_type, const char *label, pl_timer);
+struct vk_cmd *_begin_cmd(pl_gpu, enum queue_type, const char *label, pl_timer,
+                          pl_tex rp_target);
 bool _end_cmd(pl_gpu, struct vk_cmd **, bool submit);
 
-#define CMD_BEGIN(type)              _begin_cmd(gpu, type, __func__, NULL)
-#define CMD_BEGIN_TIMED(type, timer) _begin_cmd(gpu, type, __func__, timer)
+// Ends (and submits) the render pass instance left open by `vk_pass_run`,
+// if any. Must be called with `pl_vk.recording` held.
+bool vk_end_render_pass(pl_gpu);
+
+#define CMD_BEGIN(type)              _begin_cmd(gpu, type, __func__, NULL, NULL)
+#define CMD_BEGIN_TIMED(type, timer) _begin_cmd(gpu, type, __func__, timer, NULL)
+
+// Like CMD_BEGIN_TIMED, but keeps the open render pass instance (see
+// `pl_vk.rp_target`) if it targets `tex`
+#define CMD_BEGIN_RP(type, timer, tex) _begin_cmd(gpu, type, __func__, timer, tex)
 #define CMD_FINISH(cmd) _end_cmd(gpu, cmd, false)
 #define CMD_SUBMIT(cmd) _end_cmd(gpu, cmd, true)
 
@@ -16,6 +16,7 @@
  */
 
 #include "gpu.h"
+#include "../pl_memcpy.h"
 
 void vk_buf_barrier(pl_gpu gpu, struct vk_cmd *cmd, pl_buf buf,
                     VkPipelineStageFlags2 stage, VkAccessFlags2 access,
@@ -53,21 +54,17 @@ void vk_buf_barrier(pl_gpu gpu, struct vk_cmd *cmd, pl_buf buf,
     uint32_t dst_qf = export ? VK_QUEUE_FAMILY_EXTERNAL_KHR : qf;
 
     if (last.access || src_qf != dst_qf) {
-        vk_cmd_barrier(cmd, &(VkDependencyInfo) {
-            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-            .bufferMemoryBarrierCount = 1,
-            .pBufferMemoryBarriers = &(VkBufferMemoryBarrier2) {
-                .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
-                .srcStageMask = last.stage,
-                .srcAccessMask = last.access,
-                .dstStageMask = stage,
-                .dstAccessMask = access,
-                .srcQueueFamilyIndex = src_qf,
-                .dstQueueFamilyIndex = dst_qf,
-                .buffer = buf_vk->mem.buf,
-                .offset = buf_vk->mem.offset + offset,
-                .size = size,
-            },
+        vk_cmd_buf_barrier(cmd, &(VkBufferMemoryBarrier2) {
+            .sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER_2,
+            .srcStageMask = last.stage,
+            .srcAccessMask = last.access,
+            .dstStageMask = stage,
+            .dstAccessMask = access,
+            .srcQueueFamilyIndex = src_qf,
+            .dstQueueFamilyIndex = dst_qf,
+            .buffer = buf_vk->mem.buf,
+            .offset = buf_vk->mem.offset + offset,
+            .size = size,
         });
     }
 
@@ -86,6 +83,7 @@ void vk_buf_deref(pl_gpu gpu, pl_buf buf)
     struct pl_buf_vk *buf_vk = PL_PRIV(buf);
 
     if (pl_rc_deref(&buf_vk->rc)) {
+        atomic_fetch_add(&p->desc_gen, 1);
         vk->DestroyBufferView(vk->dev, buf_vk->view, PL_VK_ALLOC);
         vk_malloc_free(vk->ma, &buf_vk->mem);
         pl_free((void *) buf);
@@ -344,7 +342,7 @@ void vk_buf_write(pl_gpu gpu, pl_buf buf, size_t offset,
             ; // do nothing
 
         uintptr_t addr = (uintptr_t) buf_vk->mem.data + offset;
-        memcpy((void *) addr, data, size);
+        pl_memcpy_stream((void *) addr, data, size);
         buf_vk->needs_flush = true;
     } else {
         struct vk_cmd *cmd = CMD_BEGIN(buf_vk->update_queue);
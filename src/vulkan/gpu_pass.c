@@ -18,6 +18,7 @@
 #include "gpu.h"
 #include "cache.h"
 #include "glsl/spirv.h"
+#include "../pl_memcpy.h"
 
 // For pl_pass.priv
 struct pl_pass_vk {
@@ -33,7 +34,16 @@ struct pl_pass_vk {
     // To keep track of which descriptor sets are and aren't available, we
     // allocate a fixed number and use a bitmask of all available sets.
     VkDescriptorSet dss[16];
-    uint16_t dmask;
+    atomic_uint_least16_t dmask; // updated from command callbacks
+    // Signature of the contents last written to each descriptor set, so
+    // that re-binding the same resources can skip the descriptor update
+    uint64_t ds_sig[16];
+    // Descriptor buffers (VK_EXT_descriptor_buffer), for image-only passes.
+    // Descriptors are written to the `pl_vk` ring buffer on every run.
+    bool use_db;
+    VkDeviceSize db_size;
+    VkDeviceSize *db_offsets;
+    VkPipelineCreateFlags pipe_flags;
 
     // For recompilation
     VkVertexInputAttributeDescription *attrs;
@@ -47,6 +57,13 @@ struct pl_pass_vk {
     VkDescriptorBufferInfo *dsbinfo;
     VkSpecializationInfo specInfo;
     size_t spec_size;
+
+    // Pipeline libraries (VK_EXT_graphics_pipeline_library). The vertex input,
+    // pre-rasterization and output interface libraries are created once, the
+    // fragment shader library whenever the pass is re-specialized.
+    bool use_gpl;
+    VkPipeline libs[3];
+    VkPipeline lib_frag;
 };
 
 int vk_desc_namespace(pl_gpu gpu, enum pl_desc_type type)
@@ -62,6 +79,9 @@ static void pass_destroy_cb(pl_gpu gpu, pl_pass pass)
 
     vk->DestroyPipeline(vk->dev, pass_vk->pipe, PL_VK_ALLOC);
     vk->DestroyPipeline(vk->dev, pass_vk->base, PL_VK_ALLOC);
+    vk->DestroyPipeline(vk->dev, pass_vk->lib_frag, PL_VK_ALLOC);
+    for (int i = 0; i < PL_ARRAY_SIZE(pass_vk->libs); i++)
+        vk->DestroyPipeline(vk->dev, pass_vk->libs[i], PL_VK_ALLOC);
     vk->DestroyRenderPass(vk->dev, pass_vk->renderPass, PL_VK_ALLOC);
     vk->DestroyPipelineLayout(vk->dev, pass_vk->pipeLayout, PL_VK_ALLOC);
     vk->DestroyPipelineCache(vk->dev, pass_vk->cache, PL_VK_ALLOC);
@@ -87,31 +107,53 @@ static const VkDescriptorType dsType[] = {
     [PL_DESC_BUF_TEXEL_STORAGE] = VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER,
 };
 
+// Compiles a set of independent shaders, re-using cached SPIR-V where
+// possible. All remaining shaders are translated in parallel.
 static VkResult vk_compile_glsl(pl_gpu gpu, void *alloc,
-                                enum glsl_shader_stage stage,
-                                const char *shader,
+                                struct pl_spirv_job *jobs, int num_jobs,
                                 pl_cache_obj *out_spirv)
 {
     struct pl_vk *p = PL_PRIV(gpu);
     pl_cache cache = pl_gpu_cache(gpu);
-    uint64_t key = CACHE_KEY_SPIRV;
-    if (cache) { // skip computing key if `cache
-        pl_hash_merge(&key, p->spirv->signature);
-        pl_hash_merge(&key, pl_str0_hash(shader));
-        out_spirv->key = key;
-        if (pl_cache_get(cache, out_spirv)) {
-            PL_DEBUG(gpu, "Re-using cached SPIR-V object 0x%"PRIx64, key);
-            return VK_SUCCESS;
+    PL_ARRAY(struct pl_spirv_job) pending = {0};
+    PL_ARRAY(int) pending_idx = {0};
+    VkResult res = VK_SUCCESS;
+
+    for (int i = 0; i < num_jobs; i++) {
+        if (cache) {
+            uint64_t key = CACHE_KEY_SPIRV;
+            pl_hash_merge(&key, p->spirv->signature);
+            pl_hash_merge(&key, pl_str0_hash(jobs[i].shader));
+            out_spirv[i].key = key;
+            if (pl_cache_get(cache, &out_spirv[i])) {
+                PL_DEBUG(gpu, "Re-using cached SPIR-V object 0x%"PRIx64, key);
+                continue;
+            }
         }
+
+        PL_ARRAY_APPEND(alloc, pending, jobs[i]);
+        PL_ARRAY_APPEND(alloc, pending_idx, i);
     }
 
+    if (!pending.num)
+        return VK_SUCCESS;
+
     pl_clock_t start = pl_clock_now();
-    pl_str spirv = pl_spirv_compile_glsl(p->spirv, alloc, gpu->glsl, stage, shader);
+    if (!pl_spirv_compile_glsl_batch(p->spirv, alloc, gpu->glsl,
+                                     pending.elem, pending.num))
+        res = VK_ERROR_INITIALIZATION_FAILED;
     pl_log_cpu_time(gpu->log, start, pl_clock_now(), "translating SPIR-V");
-    out_spirv->data = spirv.buf;
-    out_spirv->size = spirv.len;
-    out_spirv->free = pl_free;
-    return spirv.len ? VK_SUCCESS : VK_ERROR_INITIALIZATION_FAILED;
+
+    for (int i = 0; i < pending.num; i++) {
+        pl_cache_obj *obj = &out_spirv[pending_idx.elem[i]];
+        obj->data = pending.elem[i].spirv.buf;
+        obj->size = pending.elem[i].spirv.len;
+        obj->free = pl_free;
+    }
+
+    pl_free(pending.elem);
+    pl_free(pending_idx.elem);
+    return res;
 }
 
 static const VkShaderStageFlags stageFlags[] = {
@@ -125,6 +167,102 @@ static void destroy_pipeline(struct vk_ctx *vk, void *pipeline)
     vk->DestroyPipeline(vk->dev, vk_unwrap_handle(pipeline), PL_VK_ALLOC);
 }
 
+#ifdef VK_EXT_graphics_pipeline_library
+
+static VkResult vk_create_pipeline_library(struct vk_ctx *vk, pl_pass pass,
+                                           const VkGraphicsPipelineCreateInfo *tmpl,
+                                           VkGraphicsPipelineLibraryFlagsEXT part,
+                                           VkPipeline *out_lib)
+{
+    struct pl_pass_vk *pass_vk = PL_PRIV(pass);
+
+    // State not belonging to `part` is ignored by the driver, so we can
+    // re-use the complete pipeline description, except for the stages
+    VkGraphicsPipelineCreateInfo cinfo = *tmpl;
+    cinfo.pNext = &(VkGraphicsPipelineLibraryCreateInfoEXT) {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT,
+        .flags = part,
+    };
+    cinfo.flags = VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | pass_vk->pipe_flags;
+    cinfo.basePipelineHandle = VK_NULL_HANDLE;
+    cinfo.stageCount = 0;
+    cinfo.pStages = NULL;
+
+    switch (part) {
+    case VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT:
+        cinfo.stageCount = 1;
+        cinfo.pStages = &tmpl->pStages[0];
+        break;
+    case VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT:
+        cinfo.stageCount = 1;
+        cinfo.pStages = &tmpl->pStages[1];
+        break;
+    default:
+        break;
+    }
+
+    return vk->CreateGraphicsPipelines(vk->dev, pass_vk->cache, 1, &cinfo,
+                                       PL_VK_ALLOC, out_lib);
+}
+
+// Creates the graphics pipeline by fast-linking separately compiled pipeline
+// libraries. Only the fragment shader library depends on the specialization
+// constants, so re-specializing the pass does not recompile anything else.
+static VkResult vk_link_pipeline_libraries(struct vk_ctx *vk, pl_pass pass,
+                                           const VkGraphicsPipelineCreateInfo *tmpl,
+                                           VkPipeline *out_pipe)
+{
+    struct pl_pass_vk *pass_vk = PL_PRIV(pass);
+    VkResult res;
+
+    static const VkGraphicsPipelineLibraryFlagsEXT parts[] = {
+        VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT,
+        VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT,
+    };
+
+    for (int i = 0; i < PL_ARRAY_SIZE(parts); i++) {
+        if (pass_vk->libs[i])
+            continue;
+        res = vk_create_pipeline_library(vk, pass, tmpl, parts[i], &pass_vk->libs[i]);
+        if (res != VK_SUCCESS)
+            return res;
+    }
+
+    // Like the pipeline itself, the old library might still be in use
+    if (pass_vk->lib_frag) {
+        vk_dev_callback(vk, (vk_cb) destroy_pipeline, vk, vk_wrap_handle(pass_vk->lib_frag));
+        pass_vk->lib_frag = VK_NULL_HANDLE;
+    }
+
+    res = vk_create_pipeline_library(vk, pass, tmpl,
+                                     VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT,
+                                     &pass_vk->lib_frag);
+    if (res != VK_SUCCESS)
+        return res;
+
+    const VkPipeline libs[] = {
+        pass_vk->libs[0], pass_vk->libs[1], pass_vk->libs[2], pass_vk->lib_frag,
+    };
+
+    VkGraphicsPipelineCreateInfo cinfo = {
+        .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
+        .pNext = &(VkPipelineLibraryCreateInfoKHR) {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR,
+            .libraryCount = PL_ARRAY_SIZE(libs),
+            .pLibraries = libs,
+        },
+        .flags = pass_vk->pipe_flags,
+        .layout = pass_vk->pipeLayout,
+        .basePipelineIndex = -1,
+    };
+
+    return vk->CreateGraphicsPipelines(vk->dev, pass_vk->cache, 1, &cinfo,
+                                       PL_VK_ALLOC, out_pipe);
+}
+
+#endif // VK_EXT_graphics_pipeline_library
+
 static VkResult vk_recreate_pipelines(struct vk_ctx *vk, pl_pass pass,
                                       bool derivable, VkPipeline base,
                                       VkPipeline *out_pipe)
@@ -136,12 +274,13 @@ static VkResult vk_recreate_pipelines(struct vk_ctx *vk, pl_pass pass,
     // asynchronously with a device idle callback
     if (*out_pipe) {
         // We don't need to use `vk_gpu_idle_callback` because the only command
-        // that can access a VkPipeline, `vk_pass_run`, always flushes `p->cmd`.
+        // that can access a VkPipeline, `vk_pass_run`, always flushes `p->cmd`
+        // (or, for a render pass left open, does so before re-specializing).
         vk_dev_callback(vk, (vk_cb) destroy_pipeline, vk, vk_wrap_handle(*out_pipe));
         *out_pipe = VK_NULL_HANDLE;
     }
 
-    VkPipelineCreateFlags flags = 0;
+    VkPipelineCreateFlags flags = pass_vk->pipe_flags;
     if (derivable)
         flags |= VK_PIPELINE_CREATE_ALLOW_DERIVATIVES_BIT;
     if (base)
@@ -183,24 +322,26 @@ static VkResult vk_recreate_pipelines(struct vk_ctx *vk, pl_pass pass,
             [PL_PRIM_TRIANGLE_STRIP] = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP,
         };
 
+        VkPipelineShaderStageCreateInfo stages[] = {
+            {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_VERTEX_BIT,
+                .module = pass_vk->vert,
+                .pName = "main",
+            }, {
+                .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
+                .module = pass_vk->shader,
+                .pName = "main",
+                .pSpecializationInfo = specInfo,
+            }
+        };
+
         VkGraphicsPipelineCreateInfo cinfo = {
             .sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO,
             .flags = flags,
-            .stageCount = 2,
-            .pStages = (VkPipelineShaderStageCreateInfo[]) {
-                {
-                    .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-                    .stage = VK_SHADER_STAGE_VERTEX_BIT,
-                    .module = pass_vk->vert,
-                    .pName = "main",
-                }, {
-                    .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
-                    .stage = VK_SHADER_STAGE_FRAGMENT_BIT,
-                    .module = pass_vk->shader,
-                    .pName = "main",
-                    .pSpecializationInfo = specInfo,
-                }
-            },
+            .stageCount = PL_ARRAY_SIZE(stages),
+            .pStages = stages,
             .pVertexInputState = &(VkPipelineVertexInputStateCreateInfo) {
                 .sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO,
                 .vertexBindingDescriptionCount = 1,
@@ -250,16 +391,30 @@ static VkResult vk_recreate_pipelines(struct vk_ctx *vk, pl_pass pass,
             .basePipelineIndex = -1,
         };
 
+#ifdef VK_EXT_graphics_pipeline_library
+        if (pass_vk->use_gpl)
+            return vk_link_pipeline_libraries(vk, pass, &cinfo, out_pipe);
+#endif
+
         return vk->CreateGraphicsPipelines(vk->dev, pass_vk->cache, 1, &cinfo,
                                            PL_VK_ALLOC, out_pipe);
     }
 
     case PL_PASS_COMPUTE: {
+        VkPipelineShaderStageRequiredSubgroupSizeCreateInfo sgsize = {
+            .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_REQUIRED_SUBGROUP_SIZE_CREATE_INFO,
+            .requiredSubgroupSize = params->subgroup_size,
+        };
+
         VkComputePipelineCreateInfo cinfo = {
             .sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO,
             .flags = flags,
             .stage = {
                 .sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO,
+                .pNext = params->subgroup_size ? &sgsize : NULL,
+                .flags = params->full_subgroups
+                    ? VK_PIPELINE_SHADER_STAGE_CREATE_REQUIRE_FULL_SUBGROUPS_BIT
+                    : 0,
                 .stage = VK_SHADER_STAGE_COMPUTE_BIT,
                 .module = pass_vk->shader,
                 .pName = "main",
@@ -293,6 +448,7 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
 
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
     pass_vk->dmask = -1; // all descriptors available
+    pass_vk->use_gpl = p->use_gpl && params->type == PL_PASS_RASTER;
 
     // temporary allocations
     void *tmp = pl_tmp(NULL);
@@ -315,6 +471,7 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
 
     int dsSize[PL_DESC_TYPE_COUNT] = {0};
     VkDescriptorSetLayoutBinding *bindings = pl_calloc_ptr(tmp, num_desc, bindings);
+    bool image_only = true;
 
     uint32_t max_tex = vk->props.limits.maxPerStageDescriptorSampledImages,
              max_img = vk->props.limits.maxPerStageDescriptorStorageImages,
@@ -339,6 +496,7 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
         }
 
         dsSize[desc->type]++;
+        image_only &= p->db_sizes[desc->type] > 0;
         bindings[i] = (VkDescriptorSetLayoutBinding) {
             .binding = desc->binding,
             .descriptorType = dsType[desc->type],
@@ -353,6 +511,35 @@ pl_pass vk_pass_create(pl_gpu gpu, const struct pl_pass_params *params)
         .bindingCount = num_desc,
     };
 
+#ifdef VK_EXT_descriptor_buffer
+    // Descriptor buffers are only used for passes without buffer descriptors,
+    // which would require device addresses for all buffer allocations
+    if (p->use_db && image_only) {
+        dinfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+        VK(vk->CreateDescriptorSetLayout(vk->dev, &dinfo, PL_VK_ALLOC,
+                                         &pass_vk->dsLayout));
+
+        vk->GetDescriptorSetLayoutSizeEXT(vk->dev, pass_vk->dsLayout,
+                                          &pass_vk->db_size);
+        if (pass_vk->db_size <= p->db_mem.size / 4) {
+            pass_vk->db_offsets = pl_calloc_ptr(pass, num_desc, pass_vk->db_offsets);
+            for (int i = 0; i < num_desc; i++) {
+                vk->GetDescriptorSetLayoutBindingOffsetEXT(vk->dev, pass_vk->dsLayout,
+                                                           bindings[i].binding,
+                                                           &pass_vk->db_offsets[i]);
+            }
+
+            pass_vk->pipe_flags |= VK_PIPELINE_CREATE_DESCRIPTOR_BUFFER_BIT_EXT;
+            pass_vk->use_db = true;
+            goto no_descriptors;
+        }
+
+        vk->DestroyDescriptorSetLayout(vk->dev, pass_vk->dsLayout, PL_VK_ALLOC);
+        pass_vk->dsLayout = VK_NULL_HANDLE;
+        dinfo.flags = 0;
+    }
+#endif
+
     if (p->max_push_descriptors && num_desc <= p->max_push_descriptors) {
         dinfo.flags |= VK_DESCRIPTOR_SET_LAYOUT_CREATE_PUSH_DESCRIPTOR_BIT_KHR;
         pass_vk->use_pushd = true;
@@ -453,11 +640,21 @@ no_descriptors: ;
     pl_cache_obj vert = {0}, frag = {0}, comp = {0};
     switch (params->type) {
     case PL_PASS_RASTER: ;
-        VK(vk_compile_glsl(gpu, tmp, GLSL_SHADER_VERTEX, params->vertex_shader, &vert));
-        VK(vk_compile_glsl(gpu, tmp, GLSL_SHADER_FRAGMENT, params->glsl_shader, &frag));
+        struct pl_spirv_job raster_jobs[] = {
+            { .stage = GLSL_SHADER_VERTEX,   .shader = params->vertex_shader },
+            { .stage = GLSL_SHADER_FRAGMENT, .shader = params->glsl_shader },
+        };
+        pl_cache_obj raster_spirv[2] = {0};
+        VK(vk_compile_glsl(gpu, tmp, raster_jobs, 2, raster_spirv));
+        vert = raster_spirv[0];
+        frag = raster_spirv[1];
         break;
-    case PL_PASS_COMPUTE:
-        VK(vk_compile_glsl(gpu, tmp, GLSL_SHADER_COMPUTE, params->glsl_shader, &comp));
+    case PL_PASS_COMPUTE: ;
+        struct pl_spirv_job comp_job = {
+            .stage = GLSL_SHADER_COMPUTE,
+            .shader = params->glsl_shader,
+        };
+        VK(vk_compile_glsl(gpu, tmp, &comp_job, 1, &comp));
         break;
     case PL_PASS_INVALID:
     case PL_PASS_TYPE_COUNT:
@@ -473,6 +670,8 @@ no_descriptors: ;
         pl_hash_merge(&pipecache.key, pl_mem_hash(vert.data, vert.size));
         pl_hash_merge(&pipecache.key, pl_mem_hash(frag.data, frag.size));
         pl_hash_merge(&pipecache.key, pl_mem_hash(comp.data, comp.size));
+        pl_hash_merge(&pipecache.key, (uint64_t) params->subgroup_size << 1 |
+                                      params->full_subgroups);
         pl_cache_get(cache, &pipecache);
     }
 
@@ -614,8 +813,7 @@ static const VkPipelineStageFlags2 shaderStages[] = {
 };
 
 static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
-                                 struct pl_desc_binding db,
-                                 VkDescriptorSet ds, int idx)
+                                 struct pl_desc_binding db, int idx)
 {
     struct pl_vk *p = PL_PRIV(gpu);
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
@@ -624,7 +822,6 @@ static void vk_update_descriptor(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
     VkWriteDescriptorSet *wds = &pass_vk->dswrite[idx];
     *wds = (VkWriteDescriptorSet) {
         .sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET,
-        .dstSet = ds,
         .dstBinding = desc->binding,
         .descriptorCount = 1,
         .descriptorType = dsType[desc->type],
@@ -750,6 +947,167 @@ static void set_ds(struct pl_pass_vk *pass_vk, void *dsbit)
     pass_vk->dmask |= (uintptr_t) dsbit;
 }
 
+// Hashes the descriptor contents prepared by `vk_update_descriptor`
+static uint64_t ds_signature(pl_gpu gpu, pl_pass pass)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct pl_pass_vk *pass_vk = PL_PRIV(pass);
+    uint64_t sig = atomic_load(&p->desc_gen);
+
+#define HASH_FIELD(x) pl_hash_merge(&sig, pl_mem_hash(&(x), sizeof(x)))
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        const VkWriteDescriptorSet *wds = &pass_vk->dswrite[i];
+        if (wds->pImageInfo) {
+            HASH_FIELD(wds->pImageInfo->sampler);
+            HASH_FIELD(wds->pImageInfo->imageView);
+            HASH_FIELD(wds->pImageInfo->imageLayout);
+        } else if (wds->pBufferInfo) {
+            HASH_FIELD(wds->pBufferInfo->buffer);
+            HASH_FIELD(wds->pBufferInfo->offset);
+            HASH_FIELD(wds->pBufferInfo->range);
+        } else if (wds->pTexelBufferView) {
+            HASH_FIELD(*wds->pTexelBufferView);
+        }
+    }
+#undef HASH_FIELD
+
+    // Never collide with the zero-initialized (never written) state
+    return sig ? sig : 1;
+}
+
+#ifdef VK_EXT_descriptor_buffer
+
+static void release_db(struct pl_vk *p, void *size)
+{
+    p->db_busy -= (uintptr_t) size;
+}
+
+// Reserves space for the descriptors of `pass` in the descriptor buffer ring,
+// writes them and binds the result to `cmd`. Must be called after
+// `vk_update_descriptor` for all descriptors.
+static void vk_write_db(pl_gpu gpu, struct vk_cmd *cmd, pl_pass pass,
+                        VkPipelineBindPoint bindPoint)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+    struct pl_pass_vk *pass_vk = PL_PRIV(pass);
+
+    // Allocations are released in submission order, so the free space is
+    // always contiguous (modulo wrap-around, which wastes the ring's tail)
+    const size_t ring_size = p->db_mem.size;
+    const size_t size = PL_ALIGN(pass_vk->db_size, p->db_align);
+    const bool wrap = p->db_head + size > ring_size;
+    const size_t pad = wrap ? ring_size - p->db_head : 0;
+    while (p->db_busy + pad + size > ring_size) {
+        PL_TRACE(gpu, "Descriptor buffer ring full! ...blocking (slow path)");
+        vk_poll_commands(vk, 10000000); // 10 ms
+    }
+
+    const size_t offset = wrap ? 0 : p->db_head;
+    p->db_head = offset + size;
+    p->db_busy += pad + size;
+    vk_cmd_callback(cmd, (vk_cb) release_db, p, (void *)(uintptr_t) (pad + size));
+
+    uint8_t *data = (uint8_t *) p->db_mem.data + offset;
+    for (int i = 0; i < pass->params.num_descriptors; i++) {
+        const struct pl_desc *desc = &pass->params.descriptors[i];
+        VkDescriptorGetInfoEXT ginfo = {
+            .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_GET_INFO_EXT,
+            .type = dsType[desc->type],
+        };
+
+        switch (desc->type) {
+        case PL_DESC_SAMPLED_TEX:
+            ginfo.data.pCombinedImageSampler = &pass_vk->dsiinfo[i];
+            break;
+        case PL_DESC_STORAGE_IMG:
+            ginfo.data.pStorageImage = &pass_vk->dsiinfo[i];
+            break;
+        default: pl_unreachable();
+        }
+
+        vk->GetDescriptorEXT(vk->dev, &ginfo, p->db_sizes[desc->type],
+                             data + pass_vk->db_offsets[i]);
+    }
+
+    VkDescriptorBufferBindingInfoEXT binfo = {
+        .sType = VK_STRUCTURE_TYPE_DESCRIPTOR_BUFFER_BINDING_INFO_EXT,
+        .address = p->db_addr,
+        .usage = VK_BUFFER_USAGE_SAMPLER_DESCRIPTOR_BUFFER_BIT_EXT |
+                 VK_BUFFER_USAGE_RESOURCE_DESCRIPTOR_BUFFER_BIT_EXT,
+    };
+
+    const uint32_t buf_idx = 0;
+    const VkDeviceSize buf_offset = offset;
+    vk->CmdBindDescriptorBuffersEXT(cmd->buf, 1, &binfo);
+    vk->CmdSetDescriptorBufferOffsetsEXT(cmd->buf, bindPoint, pass_vk->pipeLayout,
+                                         0, 1, &buf_idx, &buf_offset);
+}
+
+#endif // VK_EXT_descriptor_buffer
+
+static void release_vbo(struct pl_vk *p, void *size)
+{
+    p->vbo_busy -= (uintptr_t) size;
+}
+
+// Copies `size` bytes of `data` into the vertex buffer ring, reserving the
+// space until `cmd` completes. Returns the offset relative to `vbo_mem.buf`.
+static VkDeviceSize vk_write_vbo(pl_gpu gpu, struct vk_cmd *cmd,
+                                 const void *data, size_t size)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct vk_ctx *vk = p->vk;
+
+    // Same FIFO scheme as the descriptor buffer ring
+    // (aligned generously enough for any vertex or index format)
+    const size_t ring_size = p->vbo_mem.size;
+    const size_t aligned = PL_ALIGN2(size, 16);
+    const bool wrap = p->vbo_head + aligned > ring_size;
+    const size_t pad = wrap ? ring_size - p->vbo_head : 0;
+    while (p->vbo_busy + pad + aligned > ring_size) {
+        PL_TRACE(gpu, "Vertex buffer ring full! ...blocking (slow path)");
+        vk_poll_commands(vk, 10000000); // 10 ms
+    }
+
+    const size_t offset = wrap ? 0 : p->vbo_head;
+    p->vbo_head = offset + aligned;
+    p->vbo_busy += pad + aligned;
+    vk_cmd_callback(cmd, (vk_cb) release_vbo, p, (void *)(uintptr_t) (pad + aligned));
+
+    pl_memcpy_stream((uint8_t *) p->vbo_mem.data + offset, data, size);
+    return p->vbo_mem.offset + offset;
+}
+
+// Returns whether the ring allocations of this pass are guaranteed not to
+// block, even if the ring wraps around
+static bool rings_fit(pl_gpu gpu, pl_pass pass,
+                      const struct pl_pass_run_params *params)
+{
+    struct pl_vk *p = PL_PRIV(gpu);
+    struct pl_pass_vk *pass_vk = PL_PRIV(pass);
+
+    if (params->vertex_data || params->index_data) {
+        size_t size = 0;
+        if (params->vertex_data)
+            size += PL_ALIGN2(pl_vertex_buf_size(params), 16);
+        if (params->index_data)
+            size += PL_ALIGN2(pl_index_buf_size(params), 16);
+        const size_t pad = p->vbo_mem.size - p->vbo_head;
+        if (p->vbo_busy + pad + size > p->vbo_mem.size)
+            return false;
+    }
+
+    if (pass_vk->use_db) {
+        const size_t size = PL_ALIGN(pass_vk->db_size, p->db_align);
+        const size_t pad = p->db_mem.size - p->db_head;
+        if (p->db_busy + pad + size > p->db_mem.size)
+            return false;
+    }
+
+    return true;
+}
+
 static bool need_respec(pl_pass pass, const struct pl_pass_run_params *params)
 {
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
@@ -781,20 +1139,30 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     pl_pass pass = params->pass;
     struct pl_pass_vk *pass_vk = PL_PRIV(pass);
 
-    if (params->vertex_data || params->index_data)
-        return pl_pass_run_vbo(gpu, params);
+    // Small client-side vertex/index arrays are streamed through the vertex
+    // buffer ring, which avoids creating a temporary buffer per draw call
+    if (params->vertex_data || params->index_data) {
+        const size_t max_size = p->vbo_mem.size / 4;
+        size_t vbo_size = params->vertex_data ? pl_vertex_buf_size(params) : 0;
+        size_t ibo_size = params->index_data ? pl_index_buf_size(params) : 0;
+        if (!max_size || vbo_size > max_size || ibo_size > max_size)
+            return pl_pass_run_vbo(gpu, params);
+    }
 
     // Check if we need to re-specialize this pipeline
     if (need_respec(pass, params)) {
+        CMD_SUBMIT(NULL); // flush any open render pass using the old pipeline
         pl_clock_t start = pl_clock_now();
         VK(vk_recreate_pipelines(vk, pass, false, pass_vk->base, &pass_vk->pipe));
         pl_log_cpu_time(gpu->log, start, pl_clock_now(), "re-specializing shader");
     }
 
-    if (!pass_vk->use_pushd) {
+    const bool use_ds = !pass_vk->use_pushd && !pass_vk->use_db;
+    if (use_ds) {
         // Wait for a free descriptor set
         while (!pass_vk->dmask) {
             PL_TRACE(gpu, "No free descriptor sets! ...blocking (slow path)");
+            CMD_SUBMIT(NULL); // they may be held by an open render pass
             vk_poll_commands(vk, 10000000); // 10 ms
         }
     }
@@ -804,32 +1172,66 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
         [PL_PASS_COMPUTE] = COMPUTE,
     };
 
-    struct vk_cmd *cmd = CMD_BEGIN_TIMED(types[pass->params.type], params->timer);
+    // Passes blending onto the target of the previous pass may be recorded
+    // into the same render pass instance, avoiding a round trip through
+    // memory for the target on tiled GPUs
+    const bool is_raster = pass->params.type == PL_PASS_RASTER;
+    pl_tex rp_target = is_raster && pass->params.load_target ? params->target : NULL;
+    struct vk_cmd *cmd = CMD_BEGIN_RP(types[pass->params.type], params->timer,
+                                      rp_target);
     if (!cmd)
         goto error;
 
-    // Find a descriptor set to use
+    bool in_rp = p->rp_target;
+    p->rp_target = NULL;
+    if (in_rp && !rings_fit(gpu, pass, params)) {
+        // Blocking on the rings would never finish while `cmd` is pending
+        vk->CmdEndRenderPass(cmd->buf);
+        in_rp = false;
+        CMD_SUBMIT(&cmd);
+        cmd = CMD_BEGIN_TIMED(types[pass->params.type], params->timer);
+        if (!cmd)
+            goto error;
+    }
+
+    // Collect the barriers for all resources used by this pass, and emit them
+    // together right before the draw/dispatch
+    vk_cmd_barrier_begin(cmd);
+
+    // Update the dswrite structure with all of the new values
+    for (int i = 0; i < pass->params.num_descriptors; i++)
+        vk_update_descriptor(gpu, cmd, pass, params->desc_bindings[i], i);
+
+    // Find a descriptor set to use, preferring one which already contains
+    // exactly these descriptors (e.g. from the previous frame)
     VkDescriptorSet ds = VK_NULL_HANDLE;
-    if (!pass_vk->use_pushd) {
+    if (use_ds) {
+        const uint64_t sig = ds_signature(gpu, pass);
+        int idx = -1;
         for (int i = 0; i < PL_ARRAY_SIZE(pass_vk->dss); i++) {
-            uint16_t dsbit = 1u << i;
-            if (pass_vk->dmask & dsbit) {
-                ds = pass_vk->dss[i];
-                pass_vk->dmask &= ~dsbit; // unset
-                vk_cmd_callback(cmd, (vk_cb) set_ds, pass_vk,
-                                (void *)(uintptr_t) dsbit);
+            if (!(pass_vk->dmask & (1u << i)))
+                continue;
+            if (idx < 0)
+                idx = i;
+            if (pass_vk->ds_sig[i] == sig) {
+                idx = i;
                 break;
             }
         }
-    }
 
-    // Update the dswrite structure with all of the new values
-    for (int i = 0; i < pass->params.num_descriptors; i++)
-        vk_update_descriptor(gpu, cmd, pass, params->desc_bindings[i], ds, i);
-
-    if (!pass_vk->use_pushd) {
-        vk->UpdateDescriptorSets(vk->dev, pass->params.num_descriptors,
-                                 pass_vk->dswrite, 0, NULL);
+        pl_assert(idx >= 0);
+        uint16_t dsbit = 1u << idx;
+        ds = pass_vk->dss[idx];
+        pass_vk->dmask &= ~dsbit; // unset
+        vk_cmd_callback(cmd, (vk_cb) set_ds, pass_vk, (void *)(uintptr_t) dsbit);
+
+        if (pass_vk->ds_sig[idx] != sig) {
+            for (int i = 0; i < pass->params.num_descriptors; i++)
+                pass_vk->dswrite[i].dstSet = ds;
+            vk->UpdateDescriptorSets(vk->dev, pass->params.num_descriptors,
+                                     pass_vk->dswrite, 0, NULL);
+            pass_vk->ds_sig[idx] = sig;
+        }
     }
 
     // Bind the pipeline, descriptor set, etc.
@@ -853,6 +1255,11 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
                                     pass_vk->dswrite);
     }
 
+#ifdef VK_EXT_descriptor_buffer
+    if (pass_vk->use_db)
+        vk_write_db(gpu, cmd, pass, bindPoint[pass->params.type]);
+#endif
+
     if (pass->params.push_constants_size) {
         vk->CmdPushConstants(cmd->buf, pass_vk->pipeLayout,
                              stageFlags[pass->params.type], 0,
@@ -865,50 +1272,81 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
         pl_tex tex = params->target;
         struct pl_tex_vk *tex_vk = PL_PRIV(tex);
         pl_buf vert = params->vertex_buf;
-        struct pl_buf_vk *vert_vk = PL_PRIV(vert);
         pl_buf index = params->index_buf;
-        struct pl_buf_vk *index_vk = index ? PL_PRIV(index) : NULL;
-        pl_assert(vert);
-
-        // In the edge case that vert = index buffer, we need to synchronize
-        // for both flags simultaneously
-        VkPipelineStageFlags2 vbo_stage = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
-        VkAccessFlags2 vbo_flags = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
-        if (index == vert) {
-            vbo_stage |= VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
-            vbo_flags |= VK_ACCESS_2_INDEX_READ_BIT;
-        }
+        VkBuffer vert_buf, index_buf = VK_NULL_HANDLE;
+        VkDeviceSize vert_offset, index_offset = 0;
+
+        if (params->vertex_data) {
+            // Host-coherent ring memory is implicitly made visible by the
+            // queue submission, so no barrier is needed
+            vert_buf = p->vbo_mem.buf;
+            vert_offset = vk_write_vbo(gpu, cmd, params->vertex_data,
+                                       pl_vertex_buf_size(params));
+        } else {
+            pl_assert(vert);
+            struct pl_buf_vk *vert_vk = PL_PRIV(vert);
+
+            // In the edge case that vert = index buffer, we need to synchronize
+            // for both flags simultaneously
+            VkPipelineStageFlags2 vbo_stage = VK_PIPELINE_STAGE_2_VERTEX_ATTRIBUTE_INPUT_BIT;
+            VkAccessFlags2 vbo_flags = VK_ACCESS_2_VERTEX_ATTRIBUTE_READ_BIT;
+            if (index == vert) {
+                vbo_stage |= VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT;
+                vbo_flags |= VK_ACCESS_2_INDEX_READ_BIT;
+            }
 
-        vk_buf_barrier(gpu, cmd, vert, vbo_stage, vbo_flags, 0, vert->params.size, false);
+            vk_buf_barrier(gpu, cmd, vert, vbo_stage, vbo_flags, 0, vert->params.size, false);
+            vert_buf = vert_vk->mem.buf;
+            vert_offset = vert_vk->mem.offset + params->buf_offset;
+        }
 
-        VkDeviceSize offset = vert_vk->mem.offset + params->buf_offset;
-        vk->CmdBindVertexBuffers(cmd->buf, 0, 1, &vert_vk->mem.buf, &offset);
+        vk->CmdBindVertexBuffers(cmd->buf, 0, 1, &vert_buf, &vert_offset);
 
-        if (index) {
+        if (params->index_data) {
+            index_buf = p->vbo_mem.buf;
+            index_offset = vk_write_vbo(gpu, cmd, params->index_data,
+                                        pl_index_buf_size(params));
+        } else if (index) {
+            struct pl_buf_vk *index_vk = PL_PRIV(index);
             if (index != vert) {
                 vk_buf_barrier(gpu, cmd, index, VK_PIPELINE_STAGE_2_INDEX_INPUT_BIT,
                                VK_ACCESS_2_INDEX_READ_BIT, 0, index->params.size,
                                false);
             }
 
+            index_buf = index_vk->mem.buf;
+            index_offset = index_vk->mem.offset + params->index_offset;
+        }
+
+        if (index_buf) {
             static const VkIndexType index_fmts[PL_INDEX_FORMAT_COUNT] = {
                 [PL_INDEX_UINT16] = VK_INDEX_TYPE_UINT16,
                 [PL_INDEX_UINT32] = VK_INDEX_TYPE_UINT32,
             };
 
-            vk->CmdBindIndexBuffer(cmd->buf, index_vk->mem.buf,
-                                   index_vk->mem.offset + params->index_offset,
+            vk->CmdBindIndexBuffer(cmd->buf, index_buf, index_offset,
                                    index_fmts[params->index_fmt]);
         }
 
 
-        VkAccessFlags2 fbo_access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
-        if (pass->params.load_target)
-            fbo_access |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
+        // Pipeline barriers can't be recorded inside of a render pass
+        // instance, so end it if any other resource needs one. Otherwise, the
+        // target needs no barrier, since blending is implicitly ordered
+        // within a subpass
+        if (in_rp && (cmd->img_barriers.num || cmd->buf_barriers.num)) {
+            vk->CmdEndRenderPass(cmd->buf);
+            in_rp = false;
+        }
+
+        if (!in_rp) {
+            VkAccessFlags2 fbo_access = VK_ACCESS_2_COLOR_ATTACHMENT_WRITE_BIT;
+            if (pass->params.load_target)
+                fbo_access |= VK_ACCESS_2_COLOR_ATTACHMENT_READ_BIT;
 
-        vk_tex_barrier(gpu, cmd, tex, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
-                       fbo_access, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
-                       VK_QUEUE_FAMILY_IGNORED);
+            vk_tex_barrier(gpu, cmd, tex, VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT,
+                           fbo_access, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL,
+                           VK_QUEUE_FAMILY_IGNORED);
+        }
 
         VkViewport viewport = {
             .x = params->viewport.x0,
@@ -924,15 +1362,18 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
 
         vk->CmdSetViewport(cmd->buf, 0, 1, &viewport);
         vk->CmdSetScissor(cmd->buf, 0, 1, &scissor);
+        vk_cmd_barrier_flush(cmd);
+
+        if (!in_rp) {
+            VkRenderPassBeginInfo binfo = {
+                .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
+                .renderPass = pass_vk->renderPass,
+                .framebuffer = tex_vk->framebuffer,
+                .renderArea.extent = {tex->params.w, tex->params.h},
+            };
 
-        VkRenderPassBeginInfo binfo = {
-            .sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO,
-            .renderPass = pass_vk->renderPass,
-            .framebuffer = tex_vk->framebuffer,
-            .renderArea.extent = {tex->params.w, tex->params.h},
-        };
-
-        vk->CmdBeginRenderPass(cmd->buf, &binfo, VK_SUBPASS_CONTENTS_INLINE);
+            vk->CmdBeginRenderPass(cmd->buf, &binfo, VK_SUBPASS_CONTENTS_INLINE);
+        }
 
         if (index) {
             vk->CmdDrawIndexed(cmd->buf, params->vertex_count, 1, 0, 0, 0);
@@ -940,10 +1381,26 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
             vk->CmdDraw(cmd->buf, params->vertex_count, 1, 0, 0);
         }
 
-        vk->CmdEndRenderPass(cmd->buf);
+        // Leave the render pass instance open for the next pass, unless
+        // releasing our descriptors requires recording barriers. All render
+        // passes targeting the same texture are compatible, since they only
+        // differ in their load op
+        bool keep_rp = true;
+        for (int i = 0; i < pass->params.num_descriptors; i++) {
+            const struct pl_desc *desc = &pass->params.descriptors[i];
+            keep_rp &= desc->type == PL_DESC_SAMPLED_TEX ||
+                       desc->access == PL_DESC_ACCESS_READONLY;
+        }
+
+        if (keep_rp) {
+            p->rp_target = tex;
+        } else {
+            vk->CmdEndRenderPass(cmd->buf);
+        }
         break;
     }
     case PL_PASS_COMPUTE:
+        vk_cmd_barrier_flush(cmd);
         vk->CmdDispatch(cmd->buf, params->compute_groups[0],
                         params->compute_groups[1],
                         params->compute_groups[2]);
@@ -956,8 +1413,13 @@ void vk_pass_run(pl_gpu gpu, const struct pl_pass_run_params *params)
     for (int i = 0; i < pass->params.num_descriptors; i++)
         vk_release_descriptor(gpu, cmd, pass, params->desc_bindings[i], i);
 
-    // submit this command buffer for better intra-frame granularity
-    CMD_SUBMIT(&cmd);
+    // submit this command buffer for better intra-frame granularity, or
+    // defer this until the open render pass instance is ended
+    if (p->rp_target) {
+        CMD_FINISH(&cmd);
+    } else {
+        CMD_SUBMIT(&cmd);
+    }
 
 error:
     return;
@@ -64,13 +64,8 @@ void vk_tex_barrier(pl_gpu gpu, struct vk_cmd *cmd, pl_tex tex,
         barr.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
     }
 
-    if (last.access || is_trans || is_xfer) {
-        vk_cmd_barrier(cmd, &(VkDependencyInfo) {
-            .sType = VK_STRUCTURE_TYPE_DEPENDENCY_INFO,
-            .imageMemoryBarrierCount = 1,
-            .pImageMemoryBarriers = &barr,
-        });
-    }
+    if (last.access || is_trans || is_xfer)
+        vk_cmd_img_barrier(cmd, &barr);
 
     tex_vk->qf = qf;
     tex_vk->layout = layout;
@@ -90,6 +85,7 @@ static void vk_tex_destroy(pl_gpu gpu, struct pl_tex_t *tex)
     struct vk_ctx *vk = p->vk;
     struct pl_tex_vk *tex_vk = PL_PRIV(tex);
 
+    atomic_fetch_add(&p->desc_gen, 1);
     vk->DestroyFramebuffer(vk->dev, tex_vk->framebuffer, PL_VK_ALLOC);
     vk->DestroyImageView(vk->dev, tex_vk->view, PL_VK_ALLOC);
     for (int i = 0; i < tex_vk->num_planes; i++)
@@ -292,6 +288,13 @@ pl_tex vk_tex_create(pl_gpu gpu, const struct pl_tex_params *params)
     if (tex->params.host_writable || tex->params.blit_dst || params->initial_data)
         usage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
 
+    // Attachment-only images may be lazily allocated, see `pl_tex_params`
+    const bool lazy = params->transient && !params->export_handle &&
+                      !params->import_handle && !tex_vk->num_planes &&
+                      usage == VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    if (lazy)
+        usage |= VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT;
+
     if (!usage) {
         // Vulkan requires images have at least *some* image usage set, but our
         // API is perfectly happy with a (useless) image. So just put
@@ -370,7 +373,8 @@ pl_tex vk_tex_create(pl_gpu gpu, const struct pl_tex_params *params)
     };
 
     struct vk_malloc_params mparams = {
-        .optimal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        .optimal = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT |
+                   (lazy ? VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT : 0),
         .export_handle = params->export_handle,
         .import_handle = params->import_handle,
         .shared_mem = params->shared_mem,
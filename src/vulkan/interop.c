@@ -0,0 +1,262 @@
+/*
+ * This file is part of libplacebo.
+ *
+ * libplacebo is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * libplacebo is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with libplacebo. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "gpu.h"
+
+#include <libplacebo/shaders/sampling.h>
+
+#ifdef PL_HAVE_UNIX
+#include <unistd.h>
+#endif
+
+struct interop_hook {
+    pl_gpu gpu;
+    struct pl_vulkan_interop_hook_params params;
+
+    pl_tex in, out;
+    bool reimport;
+
+    // `sem` is signalled by holding `in` and by the external API, `out_sem`
+    // only by holding `out`. Two separate semaphores are needed because the
+    // two holds may end up on different queues, which would make the order
+    // of their signal operations (and thus timeline values) undefined
+    VkSemaphore sem, out_sem;
+    union pl_handle sem_handle, out_sem_handle;
+    uint64_t value, out_value;
+};
+
+static void close_handle(enum pl_handle_type type, union pl_handle *handle)
+{
+#ifdef PL_HAVE_UNIX
+    if (type == PL_HANDLE_FD && handle->fd > -1) {
+        close(handle->fd);
+        handle->fd = -1;
+    }
+#endif
+#ifdef PL_HAVE_WIN32
+    if (type == PL_HANDLE_WIN32 && handle->handle) {
+        CloseHandle(handle->handle);
+        handle->handle = NULL;
+    }
+    // PL_HANDLE_WIN32_KMT is just an identifier. It doesn't get closed.
+#endif
+}
+
+static bool recreate_tex(pl_gpu gpu, struct interop_hook *p, pl_tex *tex,
+                         pl_fmt fmt, int w, int h)
+{
+    pl_tex old = *tex;
+    bool ok = pl_tex_recreate(gpu, tex, pl_tex_params(
+        .w              = w,
+        .h              = h,
+        .format         = fmt,
+        .sampleable     = true,
+        .renderable     = true,
+        .export_handle  = p->params.handle_type,
+        .debug_tag      = PL_DEBUG_TAG,
+    ));
+
+    p->reimport |= *tex != old;
+    return ok;
+}
+
+static struct pl_hook_res interop_hook(void *priv, const struct pl_hook_params *params)
+{
+    struct interop_hook *p = priv;
+    pl_gpu gpu = p->gpu;
+    pl_tex src = params->tex;
+    pl_fmt fmt = PL_DEF(p->params.format, src->params.format);
+    const int scale = PL_DEF(p->params.scale, 1);
+
+    if (!recreate_tex(gpu, p, &p->in, fmt, src->params.w, src->params.h) ||
+        !recreate_tex(gpu, p, &p->out, fmt, scale * src->params.w,
+                      scale * src->params.h))
+    {
+        PL_ERR(gpu, "Failed creating exportable textures for interop hook!");
+        return (struct pl_hook_res) { .failed = true };
+    }
+
+    // The hooked texture is owned by the renderer and generally not
+    // exportable, so copy it into our shared texture first
+    pl_shader sh = pl_dispatch_begin(params->dispatch);
+    pl_shader_sample_direct(sh, pl_sample_src( .tex = src ));
+    if (!pl_dispatch_finish(params->dispatch, pl_dispatch_params(
+            .shader = &sh,
+            .target = p->in,
+        )))
+    {
+        return (struct pl_hook_res) { .failed = true };
+    }
+
+    // Hand both textures over to the external API
+    const uint64_t wait_value = ++p->value;
+    if (!pl_vulkan_hold_ex(gpu, pl_vulkan_hold_params(
+            .tex        = p->in,
+            .layout     = VK_IMAGE_LAYOUT_GENERAL,
+            .qf         = VK_QUEUE_FAMILY_EXTERNAL,
+            .semaphore  = { p->sem, wait_value },
+        )))
+    {
+        return (struct pl_hook_res) { .failed = true };
+    }
+
+    const uint64_t out_wait_value = ++p->out_value;
+    if (!pl_vulkan_hold_ex(gpu, pl_vulkan_hold_params(
+            .tex        = p->out,
+            .layout     = VK_IMAGE_LAYOUT_UNDEFINED,
+            .qf         = VK_QUEUE_FAMILY_EXTERNAL,
+            .semaphore  = { p->out_sem, out_wait_value },
+        )))
+    {
+        pl_vulkan_release_ex(gpu, pl_vulkan_release_params(
+            .tex    = p->in,
+            .layout = VK_IMAGE_LAYOUT_GENERAL,
+            .qf     = VK_QUEUE_FAMILY_EXTERNAL,
+        ));
+        return (struct pl_hook_res) { .failed = true };
+    }
+
+    // Make sure the signal operations actually get submitted, since the
+    // external API may otherwise wait on them indefinitely
+    pl_gpu_flush(gpu);
+
+    const struct pl_vulkan_interop_frame frame = {
+        .in             = p->in,
+        .out            = p->out,
+        .reimport       = p->reimport,
+        .sem            = p->sem_handle,
+        .out_sem        = p->out_sem_handle,
+        .wait_value     = wait_value,
+        .out_wait_value = out_wait_value,
+        .signal_value   = wait_value + 1,
+        .params         = params,
+    };
+
+    bool ok = p->params.process(p->params.priv, &frame);
+    pl_vulkan_sem done = {0};
+    if (ok) {
+        done = (pl_vulkan_sem) { p->sem, ++p->value };
+        p->reimport = false;
+    }
+
+    pl_vulkan_release_ex(gpu, pl_vulkan_release_params(
+        .tex        = p->in,
+        .layout     = VK_IMAGE_LAYOUT_GENERAL,
+        .qf         = VK_QUEUE_FAMILY_EXTERNAL,
+        .semaphore  = done,
+    ));
+
+    pl_vulkan_release_ex(gpu, pl_vulkan_release_params(
+        .tex        = p->out,
+        .layout     = ok ? VK_IMAGE_LAYOUT_GENERAL : VK_IMAGE_LAYOUT_UNDEFINED,
+        .qf         = VK_QUEUE_FAMILY_EXTERNAL,
+        .semaphore  = done,
+    ));
+
+    if (!ok) {
+        PL_ERR(gpu, "Interop hook failed processing frame!");
+        return (struct pl_hook_res) { .failed = true };
+    }
+
+    return (struct pl_hook_res) {
+        .output     = PL_HOOK_SIG_TEX,
+        .tex        = p->out,
+        .repr       = params->repr,
+        .color      = params->color,
+        .components = params->components,
+        .rect       = {
+            .x0 = scale * params->rect.x0,
+            .y0 = scale * params->rect.y0,
+            .x1 = scale * params->rect.x1,
+            .y1 = scale * params->rect.y1,
+        },
+    };
+}
+
+const struct pl_hook *
+pl_vulkan_interop_hook(pl_gpu gpu, const struct pl_vulkan_interop_hook_params *params)
+{
+    if (!pl_vulkan_get(gpu)) {
+        PL_ERR(gpu, "`pl_vulkan_interop_hook` requires a Vulkan GPU!");
+        return NULL;
+    }
+
+    pl_assert(params->stages && params->process);
+    pl_assert(params->scale >= 0);
+    enum pl_handle_type type = params->handle_type;
+    if (!PL_ISPOT(type) || !(type & gpu->export_caps.tex) ||
+        !(type & gpu->export_caps.sync))
+    {
+        PL_ERR(gpu, "Handle type 0x%"PRIx64" not supported for both textures "
+               "and semaphores!", (uint64_t) type);
+        return NULL;
+    }
+
+    struct pl_hook *hook = pl_zalloc_obj(NULL, hook, struct interop_hook);
+    struct interop_hook *p = PL_PRIV(hook);
+    *p = (struct interop_hook) {
+        .gpu    = gpu,
+        .params = *params,
+    };
+
+    *hook = (struct pl_hook) {
+        .stages     = params->stages,
+        .input      = PL_HOOK_SIG_TEX,
+        .priv       = p,
+        .hook       = interop_hook,
+        .signature  = (uintptr_t) p,
+    };
+
+    p->sem = pl_vulkan_sem_create(gpu, pl_vulkan_sem_params(
+        .type           = VK_SEMAPHORE_TYPE_TIMELINE,
+        .export_handle  = type,
+        .out_handle     = &p->sem_handle,
+    ));
+
+    p->out_sem = pl_vulkan_sem_create(gpu, pl_vulkan_sem_params(
+        .type           = VK_SEMAPHORE_TYPE_TIMELINE,
+        .export_handle  = type,
+        .out_handle     = &p->out_sem_handle,
+    ));
+
+    if (!p->sem || !p->out_sem) {
+        PL_ERR(gpu, "Failed creating semaphores for interop hook!");
+        pl_vulkan_interop_hook_destroy((const struct pl_hook **) &hook);
+        return NULL;
+    }
+
+    return hook;
+}
+
+void pl_vulkan_interop_hook_destroy(const struct pl_hook **hookp)
+{
+    const struct pl_hook *hook = *hookp;
+    if (!hook)
+        return;
+
+    struct interop_hook *p = PL_PRIV(hook);
+    pl_gpu gpu = p->gpu;
+    pl_gpu_finish(gpu);
+    pl_tex_destroy(gpu, &p->in);
+    pl_tex_destroy(gpu, &p->out);
+    close_handle(p->params.handle_type, &p->sem_handle);
+    close_handle(p->params.handle_type, &p->out_sem_handle);
+    pl_vulkan_sem_destroy(gpu, &p->sem);
+    pl_vulkan_sem_destroy(gpu, &p->out_sem);
+    pl_free((void *) hook);
+    *hookp = NULL;
+}
@@ -19,6 +19,7 @@
 #include "command.h"
 #include "utils.h"
 #include "pl_thread.h"
+#include "hash.h"
 
 #ifdef PL_HAVE_UNIX
 #include <errno.h>
@@ -47,6 +48,30 @@
 // small slabs. (Default: 256 KB)
 #define MINIMUM_SLAB_SIZE (1LLU << 18)
 
+// Controls the smallest block size of buddy-allocated slabs, as well as the
+// maximum number of block orders (and hence the maximum slab size) they support.
+#define BUDDY_MIN_BLOCK PAGE_SIZE_ALIGN
+#define BUDDY_MAX_ORDERS 32
+
+// Controls the maximum size of new buddy-allocated slabs, unless a single
+// allocation requires more. (Default: 256 MB)
+#define BUDDY_MAX_SLAB_SIZE (1LLU << 28)
+
+// How often (in invocations of `vk_malloc_garbage_collect`) to re-query the
+// memory budget, if supported. Device-local heaps using more than
+// BUDGET_PRESSURE percent of their budget are considered under pressure, in
+// which case empty slabs are garbage collected immediately.
+#define BUDGET_INTERVAL 8
+#define BUDGET_PRESSURE 90
+
+// Number of slots in the cache of recently freed slices, and the number of
+// consecutive slots probed per lookup. Cached slices not reused within
+// CACHE_MAX_AGE invocations of `vk_malloc_garbage_collect` are returned to
+// their slabs.
+#define CACHE_SLOTS 64
+#define CACHE_PROBES 4
+#define CACHE_MAX_AGE 4
+
 // How long to wait before garbage collecting empty slabs. Slabs older than
 // this many invocations of `vk_malloc_garbage_collect` will be released.
 #define MAXIMUM_SLAB_AGE 32
@@ -68,6 +93,14 @@ struct vk_slab {
     size_t pagesize;        // size in bytes per page
     size_t used;            // number of bytes actually in use
     uint64_t age;           // timestamp of last use
+    uint64_t pool_hash;     // hash of the owning pool's params (or 0)
+
+    // buddy allocator state (only for slabs with `buddy` set, which ignore
+    // `spacemap` and `pagesize`)
+    bool buddy;
+    int max_order;          // managed size is `BUDDY_MIN_BLOCK << max_order`
+    uint64_t *freemap;      // bitset of free blocks, for all orders
+    int free_count[BUDDY_MAX_ORDERS];
 
     // optional, depends on the memory type:
     VkBuffer buffer;        // buffer spanning the entire slab
@@ -90,6 +123,21 @@ struct vk_pool {
     int index;                        // running index in `vk_malloc.pools`
 };
 
+// A single slot in the slice cache. Slots are claimed by atomically moving
+// `state` to CACHE_BUSY, so accessing the cache never requires `vk_malloc.lock`
+enum {
+    CACHE_EMPTY,
+    CACHE_BUSY,
+    CACHE_FULL,
+};
+
+struct vk_cached_slice {
+    atomic_int state;
+    uint64_t key;               // pool hash merged with the slice size
+    uint64_t age;               // timestamp of insertion
+    struct vk_memslice slice;
+};
+
 // The overall state of the allocator, which keeps track of a vk_pool for each
 // memory type.
 struct vk_malloc {
@@ -99,8 +147,121 @@ struct vk_malloc {
     size_t maximum_page_size;
     PL_ARRAY(struct vk_pool) pools;
     uint64_t age;
+    bool buddy;
+    bool has_budget;    // VK_EXT_memory_budget is enabled
+    bool pressure;      // result of the last budget query
+
+    // recently freed pool slices, for lock-free reuse
+    struct vk_cached_slice cache[CACHE_SLOTS];
 };
 
+// Buddy allocator helpers. Blocks of order `o` have size `BUDDY_MIN_BLOCK << o`
+// and are tracked by `1 << (max_order - o)` consecutive bits in `freemap`,
+// with the orders laid out one after the other, starting from order 0.
+static inline size_t buddy_bit(const struct vk_slab *slab, int order, size_t block)
+{
+    const size_t total = (size_t) 2 << slab->max_order;
+    return total - (total >> order) + block;
+}
+
+static inline bool buddy_test(const struct vk_slab *slab, size_t bit)
+{
+    return slab->freemap[bit / 64] & (1LLU << (bit % 64));
+}
+
+static inline void buddy_flip(struct vk_slab *slab, size_t bit)
+{
+    slab->freemap[bit / 64] ^= 1LLU << (bit % 64);
+}
+
+// Smallest order whose block size is at least `size`
+static inline int buddy_order(size_t size)
+{
+    int order = 0;
+    while ((BUDDY_MIN_BLOCK << order) < size)
+        order++;
+    return order;
+}
+
+static size_t buddy_avail(const struct vk_slab *slab)
+{
+    size_t avail = 0;
+    for (int o = 0; o <= slab->max_order; o++)
+        avail += (size_t) slab->free_count[o] * (BUDDY_MIN_BLOCK << o);
+    return avail;
+}
+
+// `size` may be smaller than `slab->size`, in which case the excess is unused
+static void buddy_init(struct vk_slab *slab, size_t size)
+{
+    slab->buddy = true;
+    slab->max_order = buddy_order(size);
+    pl_assert((BUDDY_MIN_BLOCK << slab->max_order) == size);
+    pl_assert(size <= slab->size);
+    pl_assert(slab->max_order < BUDDY_MAX_ORDERS);
+    size_t bits = (size_t) 2 << slab->max_order;
+    slab->freemap = pl_calloc(slab, PL_DIV_UP(bits, 64), sizeof(uint64_t));
+    buddy_flip(slab, buddy_bit(slab, slab->max_order, 0));
+    slab->free_count[slab->max_order] = 1;
+}
+
+// Allocates a block of the given order, splitting larger blocks as needed
+static bool buddy_alloc(struct vk_slab *slab, int order, VkDeviceSize *offset)
+{
+    int o = order;
+    while (o <= slab->max_order && !slab->free_count[o])
+        o++;
+    if (o > slab->max_order)
+        return false;
+
+    // Find the first free block of this order
+    const size_t start = buddy_bit(slab, o, 0);
+    const size_t end = start + ((size_t) 1 << (slab->max_order - o));
+    size_t bit = start;
+    while (bit < end) {
+        uint64_t word = slab->freemap[bit / 64] >> (bit % 64);
+        if (word) {
+            bit += __builtin_ctzll(word);
+            break;
+        }
+        bit = PL_ALIGN2(bit + 1, 64);
+    }
+    pl_assert(bit < end && buddy_test(slab, bit));
+
+    size_t block = bit - start;
+    buddy_flip(slab, bit);
+    slab->free_count[o]--;
+
+    // Split it down to the requested order, freeing the upper halves
+    while (o > order) {
+        block <<= 1;
+        buddy_flip(slab, buddy_bit(slab, --o, block + 1));
+        slab->free_count[o]++;
+    }
+
+    *offset = (VkDeviceSize) block * (BUDDY_MIN_BLOCK << order);
+    return true;
+}
+
+// Frees a block of the given order, merging it with free buddies
+static void buddy_free(struct vk_slab *slab, int order, VkDeviceSize offset)
+{
+    size_t block = offset / (BUDDY_MIN_BLOCK << order);
+    pl_assert(offset % (BUDDY_MIN_BLOCK << order) == 0);
+    while (order < slab->max_order) {
+        size_t buddy = buddy_bit(slab, order, block ^ 1);
+        if (!buddy_test(slab, buddy))
+            break;
+        buddy_flip(slab, buddy);
+        slab->free_count[order++]--;
+        block >>= 1;
+    }
+
+    pl_assert(!buddy_test(slab, buddy_bit(slab, order, block)));
+    buddy_flip(slab, buddy_bit(slab, order, block));
+    slab->free_count[order]++;
+}
+
 static inline float efficiency(size_t used, size_t total)
 {
     if (!total)
@@ -170,16 +331,28 @@ void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level lev)
             struct vk_slab *slab = pool->slabs.elem[j];
             pl_mutex_lock(&slab->lock);
 
-            size_t avail = __builtin_popcountll(slab->spacemap) * slab->pagesize;
-            size_t slab_res = slab->size - avail;
-
-            PL_MSG(vk, lev, "    Slab %2d: %8"PRIx64" x %s: "
-                   "%s used %s res %s alloc from heap %d, efficiency %.2f%%  [%s]",
-                   j, slab->spacemap, PRINT_SIZE(slab->pagesize),
-                   PRINT_SIZE(slab->used), PRINT_SIZE(slab_res),
-                   PRINT_SIZE(slab->size), (int) slab->mtype.heapIndex,
-                   efficiency(slab->used, slab_res),
-                   PL_DEF(slab->debug_tag, "unknown"));
+            size_t avail, slab_res;
+            if (slab->buddy) {
+                avail = buddy_avail(slab);
+                slab_res = slab->size - avail;
+                PL_MSG(vk, lev, "    Slab %2d: buddy %2d orders: "
+                       "%s used %s res %s alloc from heap %d, efficiency %.2f%%  [%s]",
+                       j, slab->max_order + 1,
+                       PRINT_SIZE(slab->used), PRINT_SIZE(slab_res),
+                       PRINT_SIZE(slab->size), (int) slab->mtype.heapIndex,
+                       efficiency(slab->used, slab_res),
+                       PL_DEF(slab->debug_tag, "unknown"));
+            } else {
+                avail = __builtin_popcountll(slab->spacemap) * slab->pagesize;
+                slab_res = slab->size - avail;
+                PL_MSG(vk, lev, "    Slab %2d: %8"PRIx64" x %s: "
+                       "%s used %s res %s alloc from heap %d, efficiency %.2f%%  [%s]",
+                       j, slab->spacemap, PRINT_SIZE(slab->pagesize),
+                       PRINT_SIZE(slab->used), PRINT_SIZE(slab_res),
+                       PRINT_SIZE(slab->size), (int) slab->mtype.heapIndex,
+                       efficiency(slab->used, slab_res),
+                       PL_DEF(slab->debug_tag, "unknown"));
+            }
 
             pool_size += slab->size;
             pool_used += slab->used;
@@ -200,11 +373,11 @@ void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level lev)
     pl_mutex_unlock(&ma->lock);
 
     PL_MSG(vk, lev, "Memory summary: %s used %s res %s alloc, "
-           "efficiency %.2f%%, utilization %.2f%%, max page: %s",
+           "efficiency %.2f%%, utilization %.2f%%, max page: %s, allocator: %s",
            PRINT_SIZE(total_used), PRINT_SIZE(total_res),
            PRINT_SIZE(total_size), efficiency(total_used, total_res),
            efficiency(total_res, total_size),
-           PRINT_SIZE(ma->maximum_page_size));
+           PRINT_SIZE(ma->maximum_page_size), ma->buddy ? "buddy" : "pages");
 }
 
 static void slab_free(struct vk_ctx *vk, struct vk_slab *slab)
@@ -357,6 +530,8 @@ static bool buf_external_check(struct vk_ctx *vk, VkBufferUsageFlags usage,
                                  handle_type, import);
 }
 
+static size_t collect_slabs(struct vk_malloc *ma, bool force);
+
 // thread-safety: safe
 static struct vk_slab *slab_alloc(struct vk_malloc *ma,
                                   const struct vk_malloc_params *params)
@@ -451,6 +626,14 @@ static struct vk_slab *slab_alloc(struct vk_malloc *ma,
     if (params->ded_image)
         vk_link_struct(&minfo, &dinfo);
 
+    VkMemoryAllocateFlagsInfo finfo = {
+        .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO,
+        .flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT,
+    };
+
+    if (params->buf_usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+        vk_link_struct(&minfo, &finfo);
+
     if (!find_best_memtype(ma, type_mask, params, &minfo.memoryTypeIndex))
         goto error;
 
@@ -463,6 +646,18 @@ static struct vk_slab *slab_alloc(struct vk_malloc *ma,
     pl_clock_t start = pl_clock_now();
 
     VkResult res = vk->AllocateMemory(vk->dev, &minfo, PL_VK_ALLOC, &slab->mem);
+    if (res == VK_ERROR_OUT_OF_DEVICE_MEMORY) {
+        // Release all empty slabs and try again before giving up
+        pl_mutex_lock(&ma->lock);
+        size_t freed = collect_slabs(ma, true);
+        pl_mutex_unlock(&ma->lock);
+        if (freed) {
+            PL_DEBUG(vk, "Out of device memory, retrying after releasing %s "
+                     "of empty slabs", PRINT_SIZE(freed));
+            res = vk->AllocateMemory(vk->dev, &minfo, PL_VK_ALLOC, &slab->mem);
+        }
+    }
+
     switch (res) {
     case VK_ERROR_OUT_OF_DEVICE_MEMORY:
     case VK_ERROR_OUT_OF_HOST_MEMORY:
@@ -527,6 +722,120 @@ error:
     return NULL;
 }
 
+static inline uint64_t pool_hash(const struct vk_malloc_params *params)
+{
+    uint64_t hash = params->reqs.memoryTypeBits;
+    pl_hash_merge(&hash, params->required);
+    pl_hash_merge(&hash, params->optimal);
+    pl_hash_merge(&hash, params->buf_usage);
+    pl_hash_merge(&hash, params->export_handle);
+    return hash ? hash : 1; // 0 is reserved for slabs not owned by a pool
+}
+
+static inline uint64_t cache_key(uint64_t pool_hash, VkDeviceSize size)
+{
+    pl_hash_merge(&pool_hash, size);
+    return pool_hash;
+}
+
+// Returns a slice back to its (non-dedicated) slab
+static void slice_release(struct vk_malloc *ma, const struct vk_memslice *slice)
+{
+    struct vk_slab *slab = slice->priv;
+    pl_mutex_lock(&slab->lock);
+
+    if (slab->buddy) {
+        buddy_free(slab, buddy_order(slice->size), slice->offset);
+    } else {
+        int page_idx = slice->offset / slab->pagesize;
+        slab->spacemap |= 0x1LLU << page_idx;
+    }
+    slab->used -= slice->size;
+    slab->age = ma->age;
+    pl_assert(slab->used >= 0);
+
+    pl_mutex_unlock(&slab->lock);
+}
+
+// Tries stashing a freed slice in the cache. Returns false if no free slot
+// was found, in which case the caller must release the slice normally.
+//
+// thread-safety: safe, lock-free
+static bool cache_put(struct vk_malloc *ma, const struct vk_memslice *slice)
+{
+    const struct vk_slab *slab = slice->priv;
+    const uint64_t key = cache_key(slab->pool_hash, slice->size);
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        struct vk_cached_slice *c = &ma->cache[(key + i) % CACHE_SLOTS];
+        int state = CACHE_EMPTY;
+        if (!atomic_compare_exchange_strong_explicit(&c->state, &state, CACHE_BUSY,
+                                                     memory_order_acquire,
+                                                     memory_order_relaxed))
+            continue;
+
+        c->key = key;
+        c->age = ma->age;
+        c->slice = *slice;
+        atomic_store_explicit(&c->state, CACHE_FULL, memory_order_release);
+        return true;
+    }
+
+    return false;
+}
+
+// Tries taking a matching slice from the cache. `size` must already be
+// aligned to `align`.
+//
+// thread-safety: safe, lock-free
+static bool cache_get(struct vk_malloc *ma, uint64_t key, VkDeviceSize size,
+                      VkDeviceSize align, struct vk_memslice *out)
+{
+    for (int i = 0; i < CACHE_PROBES; i++) {
+        struct vk_cached_slice *c = &ma->cache[(key + i) % CACHE_SLOTS];
+        int state = CACHE_FULL;
+        if (atomic_load_explicit(&c->state, memory_order_relaxed) != state)
+            continue;
+        if (!atomic_compare_exchange_strong_explicit(&c->state, &state, CACHE_BUSY,
+                                                     memory_order_acquire,
+                                                     memory_order_relaxed))
+            continue;
+
+        if (c->key == key && c->slice.size == size && c->slice.offset % align == 0) {
+            *out = c->slice;
+            atomic_store_explicit(&c->state, CACHE_EMPTY, memory_order_release);
+            return true;
+        }
+
+        atomic_store_explicit(&c->state, CACHE_FULL, memory_order_release);
+    }
+
+    return false;
+}
+
+// Returns cached slices to their slabs, either all of them (if `force`) or
+// only those which have not been reused for a while.
+//
+// Note: Must be called with `ma->lock` held
+static void cache_flush(struct vk_malloc *ma, bool force)
+{
+    for (int i = 0; i < CACHE_SLOTS; i++) {
+        struct vk_cached_slice *c = &ma->cache[i];
+        int state = CACHE_FULL;
+        if (!atomic_compare_exchange_strong_explicit(&c->state, &state, CACHE_BUSY,
+                                                     memory_order_acquire,
+                                                     memory_order_relaxed))
+            continue;
+
+        if (!force && ma->age - c->age <= CACHE_MAX_AGE) {
+            atomic_store_explicit(&c->state, CACHE_FULL, memory_order_release);
+            continue;
+        }
+
+        slice_release(ma, &c->slice);
+        atomic_store_explicit(&c->state, CACHE_EMPTY, memory_order_release);
+    }
+}
+
 static void pool_uninit(struct vk_ctx *vk, struct vk_pool *pool)
 {
     for (int i = 0; i < pool->slabs.num; i++)
@@ -536,12 +845,19 @@ static void pool_uninit(struct vk_ctx *vk, struct vk_pool *pool)
     *pool = (struct vk_pool) {0};
 }
 
-struct vk_malloc *vk_malloc_create(struct vk_ctx *vk)
+struct vk_malloc *vk_malloc_create(struct vk_ctx *vk, bool buddy)
 {
     struct vk_malloc *ma = pl_zalloc_ptr(NULL, ma);
     pl_mutex_init(&ma->lock);
     vk->GetPhysicalDeviceMemoryProperties(vk->physd, &ma->props);
     ma->vk = vk;
+    ma->buddy = buddy;
+    for (int i = 0; i < CACHE_SLOTS; i++)
+        atomic_init(&ma->cache[i].state, CACHE_EMPTY);
+    for (int i = 0; i < vk->exts.num; i++) {
+        if (!strcmp(vk->exts.elem[i], VK_EXT_MEMORY_BUDGET_EXTENSION_NAME))
+            ma->has_budget = true;
+    }
 
     // Determine maximum page size
     ma->maximum_page_size = MAXIMUM_PAGE_SIZE_ABSOLUTE;
@@ -563,6 +879,7 @@ void vk_malloc_destroy(struct vk_malloc **ma_ptr)
     if (!ma)
         return;
 
+    cache_flush(ma, true);
     vk_malloc_print_stats(ma, PL_LOG_DEBUG);
     for (int i = 0; i < ma->pools.num; i++)
         pool_uninit(ma->vk, &ma->pools.elem[i]);
@@ -571,19 +888,60 @@ void vk_malloc_destroy(struct vk_malloc **ma_ptr)
     pl_free_ptr(ma_ptr);
 }
 
-void vk_malloc_garbage_collect(struct vk_malloc *ma)
+bool vk_malloc_get_budget(struct vk_malloc *ma, struct pl_gpu_memory_budget *out)
 {
     struct vk_ctx *vk = ma->vk;
+    *out = (struct pl_gpu_memory_budget) {0};
+    if (!ma->has_budget)
+        return false;
 
-    pl_mutex_lock(&ma->lock);
-    ma->age++;
+    VkPhysicalDeviceMemoryBudgetPropertiesEXT budget = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_BUDGET_PROPERTIES_EXT,
+    };
+
+    VkPhysicalDeviceMemoryProperties2 props = {
+        .sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MEMORY_PROPERTIES_2,
+        .pNext = &budget,
+    };
+
+    vk->GetPhysicalDeviceMemoryProperties2(vk->physd, &props);
+    out->num_heaps = PL_MIN(props.memoryProperties.memoryHeapCount, PL_GPU_MAX_HEAPS);
+    for (int i = 0; i < out->num_heaps; i++) {
+        const VkMemoryHeap *heap = &props.memoryProperties.memoryHeaps[i];
+        struct pl_gpu_heap_budget *hb = &out->heaps[i];
+        *hb = (struct pl_gpu_heap_budget) {
+            .size = heap->size,
+            .usage = budget.heapUsage[i],
+            .budget = budget.heapBudget[i],
+            .device_local = heap->flags & VK_MEMORY_HEAP_DEVICE_LOCAL_BIT,
+        };
+
+        if (hb->device_local && hb->budget &&
+            hb->usage > hb->budget / 100 * BUDGET_PRESSURE)
+        {
+            out->pressure = true;
+        }
+    }
+
+    return true;
+}
+
+// Releases empty slabs, either all of them (if `force`) or only those which
+// have not been used for a while. Returns the number of bytes freed.
+//
+// Note: Must be called with `ma->lock` held
+static size_t collect_slabs(struct vk_malloc *ma, bool force)
+{
+    struct vk_ctx *vk = ma->vk;
+    size_t freed = 0;
+    cache_flush(ma, force);
 
     for (int i = 0; i < ma->pools.num; i++) {
         struct vk_pool *pool = &ma->pools.elem[i];
         for (int n = 0; n < pool->slabs.num; n++) {
             struct vk_slab *slab = pool->slabs.elem[n];
             pl_mutex_lock(&slab->lock);
-            if (slab->used || (ma->age - slab->age) <= MAXIMUM_SLAB_AGE) {
+            if (slab->used || (!force && (ma->age - slab->age) <= MAXIMUM_SLAB_AGE)) {
                 pl_mutex_unlock(&slab->lock);
                 continue;
             }
@@ -591,12 +949,31 @@ void vk_malloc_garbage_collect(struct vk_malloc *ma)
             PL_DEBUG(vk, "Garbage collected slab of size %s from pool %d",
                      PRINT_SIZE(slab->size), pool->index);
 
+            freed += slab->size;
             pl_mutex_unlock(&slab->lock);
             slab_free(ma->vk, slab);
             PL_ARRAY_REMOVE_AT(pool->slabs, n--);
         }
     }
 
+    return freed;
+}
+
+void vk_malloc_garbage_collect(struct vk_malloc *ma)
+{
+    pl_mutex_lock(&ma->lock);
+    ma->age++;
+
+    if (ma->has_budget && ma->age % BUDGET_INTERVAL == 0) {
+        struct pl_gpu_memory_budget budget;
+        bool pressure = vk_malloc_get_budget(ma, &budget) && budget.pressure;
+        if (pressure && !ma->pressure)
+            PL_DEBUG(ma->vk, "Device memory usage is close to budget, releasing "
+                     "empty slabs eagerly");
+        ma->pressure = pressure;
+    }
+
+    collect_slabs(ma, ma->pressure);
     pl_mutex_unlock(&ma->lock);
 }
 
@@ -627,15 +1004,8 @@ void vk_malloc_free(struct vk_malloc *ma, struct vk_memslice *slice)
         goto done;
     }
 
-    pl_mutex_lock(&slab->lock);
-
-    int page_idx = slice->offset / slab->pagesize;
-    slab->spacemap |= 0x1LLU << page_idx;
-    slab->used -= slice->size;
-    slab->age = ma->age;
-    pl_assert(slab->used >= 0);
-
-    pl_mutex_unlock(&slab->lock);
+    if (!cache_put(ma, slice))
+        slice_release(ma, slice);
 
 done:
     *slice = (struct vk_memslice) {0};
@@ -679,6 +1049,56 @@ static struct vk_pool *find_pool(struct vk_malloc *ma,
     return &ma->pools.elem[idx];
 }
 
+// Like `pool_get_page`, but for buddy-allocated slabs. `size` must already
+// include the (power of two) alignment.
+//
+// Note: This locks the slab it returns
+static struct vk_slab *pool_get_block(struct vk_malloc *ma, struct vk_pool *pool,
+                                      size_t size, VkDeviceSize *offset)
+{
+    const int order = buddy_order(size);
+    const VkDeviceSize block_size = BUDDY_MIN_BLOCK << order;
+    VkDeviceSize slab_size = PL_MAX(block_size * MINIMUM_PAGE_COUNT, MINIMUM_SLAB_SIZE);
+
+    for (int i = 0; i < pool->slabs.num; i++) {
+        struct vk_slab *slab = pool->slabs.elem[i];
+        if (!slab->buddy || slab->max_order < order)
+            continue;
+
+        pl_mutex_lock(&slab->lock);
+        if (buddy_alloc(slab, order, offset))
+            return slab;
+        pl_mutex_unlock(&slab->lock);
+
+        // Grow new slabs the more existing slabs are full
+        slab_size = PL_MAX(slab_size, slab->size << 1);
+    }
+
+    // Otherwise, allocate a new power-of-two sized slab
+    slab_size = PL_MIN(slab_size, BUDDY_MAX_SLAB_SIZE);
+    slab_size = PL_MAX(slab_size, block_size);
+    pl_assert(buddy_order(slab_size) < BUDDY_MAX_ORDERS);
+    slab_size = BUDDY_MIN_BLOCK << buddy_order(slab_size);
+
+    struct vk_malloc_params params = pool->params;
+    params.reqs.size = slab_size;
+
+    pl_mutex_unlock(&ma->lock);
+    struct vk_slab *slab = slab_alloc(ma, &params);
+    pl_mutex_lock(&ma->lock);
+    if (!slab)
+        return NULL;
+    pl_mutex_lock(&slab->lock);
+
+    buddy_init(slab, slab_size);
+    slab->pool_hash = pool_hash(&pool->params);
+    PL_ARRAY_APPEND(NULL, pool->slabs, slab);
+
+    bool ok = buddy_alloc(slab, order, offset);
+    pl_assert(ok);
+    return slab;
+}
+
 // Returns a suitable memory page from the pool. A new slab will be allocated
 // under the hood, if necessary.
 //
@@ -694,7 +1114,7 @@ static struct vk_slab *pool_get_page(struct vk_malloc *ma, struct vk_pool *pool,
 
     for (int i = 0; i < pool->slabs.num; i++) {
         slab = pool->slabs.elem[i];
-        if (slab->pagesize < size)
+        if (slab->buddy || slab->pagesize < size)
             continue;
         if (slab->pagesize > pagesize * MINIMUM_PAGE_COUNT) // rough heuristic
             continue;
@@ -739,6 +1159,7 @@ static struct vk_slab *pool_get_page(struct vk_malloc *ma, struct vk_pool *pool,
 
     slab->spacemap = (slab_pages == sizeof(uint64_t) * 8) ? ~0LLU : ~(~0LLU << slab_pages);
     slab->pagesize = pagesize;
+    slab->pool_hash = pool_hash(&pool->params);
     PL_ARRAY_APPEND(NULL, pool->slabs, slab);
 
     // Return the first page in this newly allocated slab
@@ -1015,9 +1436,18 @@ bool vk_malloc_slice(struct vk_malloc *ma, struct vk_memslice *out,
         slab->dedicated = true;
         offset = 0;
     } else {
+        // Fast path: reuse a recently freed slice of the same size and pool
+        const uint64_t key = cache_key(pool_hash(params), PL_ALIGN(size, align));
+        if (cache_get(ma, key, PL_ALIGN(size, align), align, out))
+            return true;
+
         pl_mutex_lock(&ma->lock);
         struct vk_pool *pool = find_pool(ma, params);
-        slab = pool_get_page(ma, pool, size, align, &offset);
+        if (ma->buddy && !(align & (align - 1))) {
+            slab = pool_get_block(ma, pool, PL_ALIGN2(size, align), &offset);
+        } else {
+            slab = pool_get_page(ma, pool, size, align, &offset);
+        }
         pl_mutex_unlock(&ma->lock);
         if (!slab) {
             PL_ERR(ma->vk, "No slab to serve request for %s bytes (with "
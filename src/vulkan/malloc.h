@@ -20,8 +20,9 @@
 #include "common.h"
 
 // All memory allocated from a vk_malloc MUST be explicitly released by
-// the caller before vk_malloc_destroy is called.
-struct vk_malloc *vk_malloc_create(struct vk_ctx *vk);
+// the caller before vk_malloc_destroy is called. If `buddy` is true, slabs
+// are sub-allocated using a buddy allocator instead of uniform pages.
+struct vk_malloc *vk_malloc_create(struct vk_ctx *vk, bool buddy);
 void vk_malloc_destroy(struct vk_malloc **ma);
 
 // Get the supported handle types for this malloc instance
@@ -68,5 +69,9 @@ void vk_malloc_free(struct vk_malloc *ma, struct vk_memslice *slice);
 // memory pressure / memory leaks.
 void vk_malloc_garbage_collect(struct vk_malloc *ma);
 
+// Queries the current memory budget. Returns false if VK_EXT_memory_budget
+// is unavailable.
+bool vk_malloc_get_budget(struct vk_malloc *ma, struct pl_gpu_memory_budget *out);
+
 // For debugging purposes. Doesn't include dedicated slab allocations!
 void vk_malloc_print_stats(struct vk_malloc *ma, enum pl_log_level);
@@ -52,6 +52,12 @@ pl_vulkan pl_vulkan_get(pl_gpu gpu)
     return NULL;
 }
 
+pl_gpu pl_vulkan_gpu_create(pl_vulkan vk)
+{
+    pl_assert(!vk);
+    return NULL;
+}
+
 VkPhysicalDevice pl_vulkan_choose_device(pl_log log,
                               const struct pl_vulkan_device_params *params)
 {
@@ -106,3 +112,14 @@ void pl_vulkan_sem_destroy(pl_gpu gpu, VkSemaphore *semaphore)
 {
     pl_unreachable();
 }
+
+const struct pl_hook *
+pl_vulkan_interop_hook(pl_gpu gpu, const struct pl_vulkan_interop_hook_params *params)
+{
+    return NULL;
+}
+
+void pl_vulkan_interop_hook_destroy(const struct pl_hook **hook)
+{
+    pl_assert(!*hook);
+}
@@ -45,6 +45,7 @@ struct priv {
     pl_rc_t frames_in_flight;       // number of frames currently queued
     bool suboptimal;                // true once VK_SUBOPTIMAL_KHR is returned
     bool needs_recreate;            // swapchain needs to be recreated
+    bool has_fifo_relaxed;          // VK_PRESENT_MODE_FIFO_RELAXED_KHR supported
     struct pl_color_repr color_repr;
     struct pl_color_space color_space;
     struct pl_hdr_metadata hdr_metadata;
@@ -54,6 +55,16 @@ struct priv {
     PL_ARRAY(struct sem_pair) sems; // pool of semaphores used to synchronize images
     int idx_sems;                   // index of next free semaphore pair
     int last_imgidx;                // the image index last acquired (for submit)
+
+    // presentation feedback (VK_KHR_present_wait / VK_GOOGLE_display_timing):
+    bool has_present_wait;
+    bool has_display_timing;
+    uint64_t frame_id;              // ID of the frame last acquired
+    uint64_t submitted_id;          // ID of the frame last presented to the queue
+    uint64_t presented_id;          // ID of the frame last known to be visible
+    uint64_t first_id;              // ID of the first frame of this swapchain
+    uint64_t present_time;
+    uint64_t refresh_duration;
 };
 
 static const struct pl_sw_fns vulkan_swapchain;
@@ -340,6 +351,18 @@ pl_swapchain pl_vulkan_create_swapchain(pl_vulkan plvk,
     pl_assert(p->swapchain_depth > 0);
     atomic_init(&p->frames_in_flight, 0);
     p->last_imgidx = -1;
+    p->has_display_timing = vk->GetPastPresentationTimingGOOGLE;
+#ifdef VK_KHR_present_wait
+    const VkPhysicalDevicePresentWaitFeaturesKHR *wait_feats;
+    const VkPhysicalDevicePresentIdFeaturesKHR *id_feats;
+    wait_feats = vk_find_struct(&vk->features,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_WAIT_FEATURES_KHR);
+    id_feats = vk_find_struct(&vk->features,
+        VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PRESENT_ID_FEATURES_KHR);
+    p->has_present_wait = vk->WaitForPresentKHR &&
+                          wait_feats && wait_feats->presentWait &&
+                          id_feats && id_feats->presentId;
+#endif
     p->protoInfo = (VkSwapchainCreateInfoKHR) {
         .sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR,
         .surface = p->surf,
@@ -366,8 +389,10 @@ pl_swapchain pl_vulkan_create_swapchain(pl_vulkan plvk,
     VK(vk->GetPhysicalDeviceSurfacePresentModesKHR(vk->physd, p->surf, &num_modes, modes));
 
     bool supported = false;
-    for (int i = 0; i < num_modes; i++)
+    for (int i = 0; i < num_modes; i++) {
         supported |= (modes[i] == p->protoInfo.presentMode);
+        p->has_fifo_relaxed |= (modes[i] == VK_PRESENT_MODE_FIFO_RELAXED_KHR);
+    }
     pl_free_ptr(&modes);
 
     if (!supported) {
@@ -619,6 +644,16 @@ static bool vk_sw_recreate(pl_swapchain sw, int w, int h)
     vk_dev_callback(vk, (vk_cb) destroy_swapchain, vk, vk_wrap_handle(sinfo.oldSwapchain));
     PL_VK_ASSERT(res, "vk->CreateSwapchainKHR(...)");
 
+    // Frames submitted to the old swapchain can no longer be tracked
+    p->first_id = p->frame_id + 1;
+    p->presented_id = p->submitted_id;
+    p->present_time = 0;
+    if (p->has_display_timing) {
+        VkRefreshCycleDurationGOOGLE cycle;
+        res = vk->GetRefreshCycleDurationGOOGLE(vk->dev, p->swapchain, &cycle);
+        p->refresh_duration = res == VK_SUCCESS ? cycle.refreshDuration : 0;
+    }
+
     // Get the new swapchain images
     VK(vk->GetSwapchainImagesKHR(vk->dev, p->swapchain, &num_images, NULL));
     vkimages = pl_calloc_ptr(NULL, num_images, vkimages);
@@ -727,6 +762,7 @@ static bool vk_sw_start_frame(pl_swapchain sw,
             // fall through
         case VK_SUCCESS:
             p->last_imgidx = imgidx;
+            p->frame_id++;
             pl_vulkan_release_ex(sw->gpu, pl_vulkan_release_params(
                 .tex        = p->images.elem[imgidx],
                 .layout     = VK_IMAGE_LAYOUT_UNDEFINED,
@@ -738,6 +774,7 @@ static bool vk_sw_start_frame(pl_swapchain sw,
                 .flipped = false,
                 .color_repr = p->color_repr,
                 .color_space = p->color_space,
+                .id = (p->has_present_wait || p->has_display_timing) ? p->frame_id : 0,
             };
             // keep lock held
             return true;
@@ -823,10 +860,32 @@ static bool vk_sw_submit_frame(pl_swapchain sw)
         .pImageIndices = &idx,
     };
 
+#ifdef VK_KHR_present_wait
+    VkPresentIdKHR present_id = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_ID_KHR,
+        .swapchainCount = 1,
+        .pPresentIds = &p->frame_id,
+    };
+    if (p->has_present_wait)
+        vk_link_struct(&pinfo, &present_id);
+#endif
+
+    // The presentation engine only reports 32-bit IDs, see `update_timing`
+    VkPresentTimesInfoGOOGLE present_times = {
+        .sType = VK_STRUCTURE_TYPE_PRESENT_TIMES_INFO_GOOGLE,
+        .swapchainCount = 1,
+        .pTimes = &(VkPresentTimeGOOGLE) {
+            .presentID = (uint32_t) p->frame_id,
+        },
+    };
+    if (p->has_display_timing)
+        vk_link_struct(&pinfo, &present_times);
+
     PL_TRACE(vk, "vkQueuePresentKHR waits on 0x%"PRIx64, (uint64_t) sem_out);
     vk->lock_queue(vk->queue_ctx, pool->qf, qidx);
     VkResult res = vk->QueuePresentKHR(queue, &pinfo);
     vk->unlock_queue(vk->queue_ctx, pool->qf, qidx);
+    p->submitted_id = p->frame_id;
     pl_mutex_unlock(&p->lock);
 
     switch (res) {
@@ -894,6 +953,152 @@ static void vk_sw_colorspace_hint(pl_swapchain sw, const struct pl_color_space *
     pl_mutex_unlock(&p->lock);
 }
 
+// Updates `p->presented_id` from the presentation engine without blocking.
+// Must be called with `p->lock` held.
+static void update_timing(struct priv *p)
+{
+    struct vk_ctx *vk = p->vk;
+    if (!p->swapchain)
+        return;
+
+#ifdef VK_KHR_present_wait
+    // Frames are presented in order, and skipped frames are considered
+    // complete once any later frame is presented
+    while (p->has_present_wait && p->presented_id < p->submitted_id) {
+        uint64_t id = PL_MAX(p->presented_id + 1, p->first_id);
+        if (vk->WaitForPresentKHR(vk->dev, p->swapchain, id, 0) != VK_SUCCESS)
+            break;
+        p->presented_id = id;
+    }
+#endif
+
+    if (!p->has_display_timing)
+        return;
+
+    VkPastPresentationTimingGOOGLE timings[8];
+    VkResult res;
+    do {
+        uint32_t num = PL_ARRAY_SIZE(timings);
+        res = vk->GetPastPresentationTimingGOOGLE(vk->dev, p->swapchain, &num,
+                                                  timings);
+        if (res != VK_SUCCESS && res != VK_INCOMPLETE)
+            return;
+
+        for (int i = 0; i < num; i++) {
+            // Reconstruct the full ID from the truncated 32-bit `presentID`
+            uint64_t id = p->submitted_id -
+                          (uint32_t) (p->submitted_id - timings[i].presentID);
+            if (id < p->first_id || id < p->presented_id)
+                continue;
+            p->presented_id = id;
+            p->present_time = timings[i].actualPresentTime;
+        }
+    } while (res == VK_INCOMPLETE);
+}
+
+static bool vk_sw_present_timing(pl_swapchain sw, struct pl_swapchain_timing *out)
+{
+    struct priv *p = PL_PRIV(sw);
+    if (!p->has_present_wait && !p->has_display_timing)
+        return false;
+
+    pl_mutex_lock(&p->lock);
+    update_timing(p);
+    *out = (struct pl_swapchain_timing) {
+        .frame_id = p->presented_id,
+        .queued = p->submitted_id - p->presented_id,
+        .present_time = p->present_time,
+        .refresh_duration = p->refresh_duration,
+    };
+    pl_mutex_unlock(&p->lock);
+    return true;
+}
+
+static bool vk_sw_wait_presented(pl_swapchain sw, uint64_t id, uint64_t timeout)
+{
+    struct priv *p = PL_PRIV(sw);
+    struct vk_ctx *vk = p->vk;
+    if (!p->has_present_wait && !p->has_display_timing)
+        return false;
+
+    pl_mutex_lock(&p->lock);
+    if (id > p->submitted_id) {
+        PL_ERR(vk, "Trying to wait on frame %"PRIu64" which was never "
+               "submitted!", id);
+        pl_mutex_unlock(&p->lock);
+        return false;
+    }
+
+    pl_clock_t start = pl_clock_now();
+    update_timing(p);
+    while (id > p->presented_id && id >= p->first_id) {
+#ifdef VK_KHR_present_wait
+        if (p->has_present_wait) {
+            // Hold the lock while blocking, to prevent the swapchain from
+            // being recreated (and destroyed) underneath us
+            VkResult res = vk->WaitForPresentKHR(vk->dev, p->swapchain, id, timeout);
+            switch (res) {
+            case VK_SUBOPTIMAL_KHR:
+                p->suboptimal = true;
+                // fall through
+            case VK_SUCCESS:
+                p->presented_id = id;
+                break;
+            case VK_TIMEOUT:
+                pl_mutex_unlock(&p->lock);
+                return false;
+            case VK_ERROR_OUT_OF_DATE_KHR:
+                // This frame will never be presented
+                p->needs_recreate = true;
+                p->presented_id = id;
+                break;
+            default:
+                PL_ERR(vk, "Failed waiting for presentation: %s", vk_res_str(res));
+                pl_mutex_unlock(&p->lock);
+                return false;
+            }
+            continue;
+        }
+#endif
+
+        // VK_GOOGLE_display_timing can't block, so poll it instead
+        if (pl_clock_diff(pl_clock_now(), start) * 1e9 >= timeout) {
+            pl_mutex_unlock(&p->lock);
+            return false;
+        }
+
+        pl_mutex_unlock(&p->lock); // don't hold mutex while sleeping
+        pl_thread_sleep(1e-3);
+        pl_mutex_lock(&p->lock);
+        update_timing(p);
+    }
+
+    pl_mutex_unlock(&p->lock);
+    return true;
+}
+
+// Adaptive vsync maps directly onto FIFO_RELAXED, which only tears for frames
+// that miss their vblank, so there's no need to measure frame times here.
+// Switching modes requires recreating the swapchain, which is deferred to the
+// next `vk_sw_start_frame`.
+static bool vk_sw_adaptive_vsync(pl_swapchain sw, bool enable)
+{
+    struct priv *p = PL_PRIV(sw);
+    pl_mutex_lock(&p->lock);
+    VkPresentModeKHR cur = p->protoInfo.presentMode;
+    bool ok = p->has_fifo_relaxed && (cur == VK_PRESENT_MODE_FIFO_KHR ||
+                                      cur == VK_PRESENT_MODE_FIFO_RELAXED_KHR);
+    VkPresentModeKHR mode = enable ? VK_PRESENT_MODE_FIFO_RELAXED_KHR
+                                   : VK_PRESENT_MODE_FIFO_KHR;
+    if (ok && mode != cur) {
+        PL_DEBUG(sw, "%s adaptive vsync", enable ? "Enabling" : "Disabling");
+        p->protoInfo.presentMode = mode;
+        p->needs_recreate = true;
+    }
+    pl_mutex_unlock(&p->lock);
+    return ok;
+}
+
 bool pl_vulkan_swapchain_suboptimal(pl_swapchain sw)
 {
     struct priv *p = PL_PRIV(sw);
@@ -908,4 +1113,7 @@ static const struct pl_sw_fns vulkan_swapchain = {
     .start_frame        = vk_sw_start_frame,
     .submit_frame       = vk_sw_submit_frame,
     .swap_buffers       = vk_sw_swap_buffers,
+    .present_timing     = vk_sw_present_timing,
+    .wait_presented     = vk_sw_wait_presented,
+    .adaptive_vsync     = vk_sw_adaptive_vsync,
 };